@@ -17,6 +17,12 @@ esp_err_t bmu_balancer_init(const bmu_balancer_config_t *) { return ESP_OK; }
 esp_err_t bmu_balancer_start_task(UBaseType_t, uint32_t) { return ESP_OK; }
 bool bmu_balancer_is_off(uint8_t) { return false; }
 int bmu_balancer_get_duty_pct(uint8_t) { return 100; }
+bool bmu_balancer_get_duty_all(uint8_t *duty_pct, uint32_t *off_mask, uint8_t n)
+{
+    for (uint8_t i = 0; i < n && i < BMU_MAX_BATTERIES; i++) duty_pct[i] = 100;
+    *off_mask = 0;
+    return true;
+}
 
 #else
 
@@ -167,4 +173,20 @@ int bmu_balancer_get_duty_pct(uint8_t idx)
     return (CONFIG_BMU_BALANCE_DUTY_ON * 100) / total;
 }
 
+bool bmu_balancer_get_duty_all(uint8_t *duty_pct, uint32_t *off_mask, uint8_t n)
+{
+    if (n > BMU_MAX_BATTERIES) n = BMU_MAX_BATTERIES;
+    if (xSemaphoreTake(s_bat_mutex, pdMS_TO_TICKS(5)) != pdTRUE) return false;
+    const uint8_t duty = (uint8_t)((CONFIG_BMU_BALANCE_DUTY_ON * 100) /
+                                   (CONFIG_BMU_BALANCE_DUTY_ON + CONFIG_BMU_BALANCE_DUTY_OFF));
+    uint32_t off = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        duty_pct[i] = s_bat[i].balancing ? duty : 100;
+        if (s_bat[i].off_counter > 0) off |= 1u << i;
+    }
+    xSemaphoreGive(s_bat_mutex);
+    *off_mask = off;
+    return true;
+}
+
 #endif /* CONFIG_BMU_BALANCER_ENABLED */
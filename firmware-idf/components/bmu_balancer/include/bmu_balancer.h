@@ -17,6 +17,15 @@ esp_err_t bmu_balancer_start_task(UBaseType_t priority, uint32_t stack_size);
 bool      bmu_balancer_is_off(uint8_t idx);
 int       bmu_balancer_get_duty_pct(uint8_t idx);
 
+/**
+ * @brief État des n premières batteries sous un seul verrou (notifications
+ *        BLE) : duty_pct comme bmu_balancer_get_duty_pct (100 = pas
+ *        d'équilibrage, duty configuré aussi pendant la phase OFF), bit i
+ *        de *off_mask comme bmu_balancer_is_off.
+ *        Verrou indisponible : sorties inchangées, retourne false.
+ */
+bool      bmu_balancer_get_duty_all(uint8_t *duty_pct, uint32_t *off_mask, uint8_t n);
+
 #ifdef __cplusplus
 }
 #endif
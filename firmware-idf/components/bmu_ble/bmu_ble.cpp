@@ -2,8 +2,11 @@
  * @file bmu_ble.cpp
  * @brief NimBLE BLE init, GAP advertising, pairing/bonding — Phase 9.
  *
- * Initialise le stack NimBLE, configure 3 services GATT (Battery, System, Control),
+ * Initialise le stack NimBLE, configure les services GATT (Battery, System,
+ * Control, History, Victron),
  * demarre l'advertising BLE connectable avec bonding Secure Connections.
+ * Une seule tache sert les notifications de tous les services, au rythme
+ * des snapshots protection (ordonnanceur bmu_ble_sched.h).
  */
 #include "sdkconfig.h"
 
@@ -11,6 +14,8 @@
 
 #include "bmu_ble.h"
 #include "bmu_ble_internal.h"
+#include "bmu_ble_sched.h"
+#include "bmu_config.h"
 
 #include "esp_log.h"
 #include "esp_nimble_hci.h"
@@ -34,6 +39,12 @@ static bmu_protection_ctx_t  *s_prot   = NULL;
 static bmu_battery_manager_t *s_mgr    = NULL;
 static uint8_t                s_nb_ina = 0;
 static std::atomic<int>       s_connected_count{0};
+static QueueHandle_t          s_q_snapshot = NULL;
+
+/* Connexions ouvertes (cadence des notifications, bmu_ble_notify_period_ms) */
+static portMUX_TYPE s_conn_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t     s_conn_handles[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+static int          s_nb_conn = 0;
 
 /* Fenêtre d'autorisation de re-pairing (audit sécu) : 0 = fermée.
  * Ouverte par l'écran via bmu_ble_allow_repair() ; un REPEAT_PAIRING n'est
@@ -46,10 +57,106 @@ void bmu_ble_allow_repair(uint32_t window_ms)
     ESP_LOGW(TAG, "Fenêtre de réappairage ouverte %u ms", (unsigned)window_ms);
 }
 
+/* ── Ordonnanceur des notifications ──────────────────────────────── */
+/* Sources par priorité : batteries/flotte, SmartShunt Victron, système,
+ * WiFi. Toutes passent par le crédit radio : une source due sans crédit
+ * attend jusqu'à son max_ms. Remis à zéro au premier client. */
+#define NOTIFY_IDLE_MS       1000    /* Sans snapshot : heartbeats quand même */
+#define VIC_PERIOD_MS        1000
+#define VIC_PERIOD_MAX_MS    5000
+#define SLOW_PERIOD_MS       10000   /* Heap, solaire, statut WiFi */
+#define SLOW_PERIOD_MAX_MS   30000
+
+static bmu_ble_sched_t   s_sched;
+static bmu_snapshot_t    s_snap;
+static TaskHandle_t      s_notify_task = NULL;
+static std::atomic<bool> s_sched_reset{false};
+
 bmu_protection_ctx_t  *bmu_ble_get_prot(void)   { return s_prot; }
 bmu_battery_manager_t *bmu_ble_get_mgr(void)    { return s_mgr; }
 uint8_t                bmu_ble_get_nb_ina(void)  { return s_nb_ina; }
 void                   bmu_ble_set_nb_ina(uint8_t n) { s_nb_ina = n; }
+QueueHandle_t          bmu_ble_get_snapshot_queue(void) { return s_q_snapshot; }
+void                   bmu_ble_set_snapshot_queue(QueueHandle_t q) { s_q_snapshot = q; }
+const bmu_snapshot_t  *bmu_ble_get_snapshot(void) { return &s_snap; }
+
+static void conn_track(uint16_t conn_handle, bool open)
+{
+    portENTER_CRITICAL(&s_conn_mux);
+    int k = 0;
+    while (k < s_nb_conn && s_conn_handles[k] != conn_handle) k++;
+    if (open && k == s_nb_conn && k < CONFIG_BMU_BLE_MAX_CONNECTIONS) {
+        s_conn_handles[s_nb_conn++] = conn_handle;
+    } else if (!open && k < s_nb_conn) {
+        s_conn_handles[k] = s_conn_handles[--s_nb_conn];
+    }
+    portEXIT_CRITICAL(&s_conn_mux);
+}
+
+int bmu_ble_get_itvls_of(const uint16_t *conn, int n, uint16_t *itvl_1m25)
+{
+    int out = 0;
+    for (int k = 0; k < n; k++) {
+        struct ble_gap_conn_desc desc;
+        if (ble_gap_conn_find(conn[k], &desc) == 0) itvl_1m25[out++] = desc.conn_itvl;
+    }
+    return out;
+}
+
+int bmu_ble_get_conn_itvls(uint16_t *itvl_1m25, int max)
+{
+    uint16_t conn[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+    portENTER_CRITICAL(&s_conn_mux);
+    int n = s_nb_conn < max ? s_nb_conn : max;
+    memcpy(conn, s_conn_handles, (size_t)n * sizeof(uint16_t));
+    portEXIT_CRITICAL(&s_conn_mux);
+    return bmu_ble_get_itvls_of(conn, n, itvl_1m25);
+}
+
+static void notify_task(void *pv)
+{
+    (void)pv;
+    for (;;) {
+        /* Réveil à chaque cycle protection ; sans snapshot (protection
+         * arrêtée), le dernier reste servi pour garder les heartbeats. */
+        if (s_q_snapshot) {
+            (void)xQueueReceive(s_q_snapshot, &s_snap, pdMS_TO_TICKS(NOTIFY_IDLE_MS));
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(NOTIFY_IDLE_MS));
+        }
+        if (s_connected_count.load() <= 0) continue;
+
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        if (s_sched_reset.exchange(false)) bmu_ble_sched_reset(&s_sched, now_ms);
+        uint16_t itvl[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+        int n = bmu_ble_get_conn_itvls(itvl, CONFIG_BMU_BLE_MAX_CONNECTIONS);
+        bmu_ble_sched_run(&s_sched, now_ms, itvl, n);
+    }
+}
+
+static void notify_sched_init(void)
+{
+    bmu_ble_sched_init(&s_sched, BMU_LOOP_PERIOD_MS / 2);
+    bmu_ble_sched_add(&s_sched, "battery", BMU_BLE_BATT_PERIOD_MS, BMU_BLE_BATT_PERIOD_MAX_MS,
+                      bmu_ble_battery_notify_tick, NULL);
+#ifdef CONFIG_BMU_VICTRON_GATT_ENABLED
+    bmu_ble_sched_add(&s_sched, "vic_gatt", VIC_PERIOD_MS, VIC_PERIOD_MAX_MS,
+                      bmu_ble_victron_gatt_notify_tick, NULL);
+#endif
+    bmu_ble_sched_add(&s_sched, "system", SLOW_PERIOD_MS, SLOW_PERIOD_MAX_MS,
+                      bmu_ble_system_notify_tick, NULL);
+    bmu_ble_sched_add(&s_sched, "wifi", SLOW_PERIOD_MS, SLOW_PERIOD_MAX_MS,
+                      bmu_ble_wifi_notify_tick, NULL);
+
+    if (s_q_snapshot == NULL) {
+        ESP_LOGW(TAG, "Pas de file snapshot : notifications batterie desactivees");
+    }
+    /* Inactive jusqu'au premier client */
+    if (xTaskCreate(notify_task, "ble_notify", 4096, NULL, 3, &s_notify_task) != pdPASS) {
+        ESP_LOGE(TAG, "xTaskCreate (ble notify) échec");
+        s_notify_task = NULL;
+    }
+}
 
 /* ── Forward declarations ────────────────────────────────────────── */
 static void start_advertising(void);
@@ -118,20 +225,24 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
     case BLE_GAP_EVENT_CONNECT:
         if (event->connect.status == 0) {
             s_connected_count.fetch_add(1);
+            conn_track(event->connect.conn_handle, true);
             ESP_LOGI(TAG, "Client connecte (conn_handle=%d, total=%d)",
                      event->connect.conn_handle, s_connected_count.load());
 
-            /* Demarrer les timers de notification si c'est le premier client */
+            /* Premier client : toutes les sources dues au prochain cycle */
             if (s_connected_count.load() == 1) {
                 bmu_ble_battery_notify_start();
-                bmu_ble_system_notify_start();
-                bmu_ble_wifi_notify_start();
                 bmu_ble_victron_gatt_notify_start();
+                s_sched_reset.store(true);
             }
 
             /* Demander connexion securisee */
             ble_gap_security_initiate(event->connect.conn_handle);
 
+            /* MTU max (CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU) même si le client
+             * ne l'échange pas : trames flotte et historique plus longues */
+            ble_gattc_exchange_mtu(event->connect.conn_handle, NULL, NULL);
+
             /* Reprendre l'advertising si places restantes */
             start_advertising();
         } else {
@@ -142,15 +253,17 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
 
     case BLE_GAP_EVENT_DISCONNECT:
         s_connected_count.fetch_sub(1);
+        conn_track(event->disconnect.conn.conn_handle, false);
+#if CONFIG_BMU_BLE_HISTORY_ENABLED
+        bmu_ble_history_on_disconnect(event->disconnect.conn.conn_handle);
+#endif
         ESP_LOGI(TAG, "Client deconnecte (reason=0x%02x, total=%d)",
                  event->disconnect.reason, s_connected_count.load());
 
-        /* Stopper les timers si plus aucun client */
+        /* Plus aucun client : la tâche de notification se met en veille */
         if (s_connected_count.load() <= 0) {
             s_connected_count.store(0);
             bmu_ble_battery_notify_stop();
-            bmu_ble_system_notify_stop();
-            bmu_ble_wifi_notify_stop();
             bmu_ble_victron_gatt_notify_stop();
         }
 
@@ -196,6 +309,10 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
                  event->subscribe.conn_handle,
                  event->subscribe.attr_handle,
                  event->subscribe.cur_notify);
+        /* Déconnexion comprise (reason TERM, cur_notify = 0) */
+        bmu_ble_battery_on_subscribe(event->subscribe.conn_handle,
+                                     event->subscribe.attr_handle,
+                                     event->subscribe.cur_notify != 0);
         return 0;
 
     default:
@@ -287,7 +404,7 @@ esp_err_t bmu_ble_init(bmu_protection_ctx_t *prot,
 
     /* 5. Construire et enregistrer la table GATT unifiee */
     /* NimBLE attend un tableau termine par un element {0} */
-    static struct ble_gatt_svc_def gatt_svcs[5]; /* 4 services max + terminateur */
+    static struct ble_gatt_svc_def gatt_svcs[6]; /* 5 services max + terminateur */
     int svc_idx = 0;
 
     const struct ble_gatt_svc_def *batt_svc = bmu_ble_battery_svc_defs();
@@ -297,6 +414,9 @@ esp_err_t bmu_ble_init(bmu_protection_ctx_t *prot,
     gatt_svcs[svc_idx++] = batt_svc[0];
     gatt_svcs[svc_idx++] = sys_svc[0];
     gatt_svcs[svc_idx++] = ctrl_svc[0];
+#if CONFIG_BMU_BLE_HISTORY_ENABLED
+    gatt_svcs[svc_idx++] = bmu_ble_history_svc_defs()[0];
+#endif
 
 #ifdef CONFIG_BMU_VICTRON_GATT_ENABLED
     const struct ble_gatt_svc_def *vic_svc = bmu_ble_victron_gatt_svc_defs();
@@ -319,7 +439,10 @@ esp_err_t bmu_ble_init(bmu_protection_ctx_t *prot,
         return ESP_FAIL;
     }
 
-    /* 6. Demarrer le host NimBLE dans une tache FreeRTOS */
+    /* 6. Ordonnanceur des notifications (une tache pour tous les services) */
+    notify_sched_init();
+
+    /* 7. Demarrer le host NimBLE dans une tache FreeRTOS */
     nimble_port_freertos_init(nimble_host_task);
 
     ESP_LOGI(TAG, "NimBLE initialise — services GATT enregistres");
@@ -1,9 +1,14 @@
 /**
  * @file bmu_ble_battery_svc.cpp
- * @brief Service GATT Battery — 32 characteristics (READ + NOTIFY), timer 1s.
+ * @brief Service GATT Battery — 32 characteristics (READ + NOTIFY).
+ *        Notifiees par la source "battery" de l'ordonnanceur BLE commun
+ *        (bmu_ble_sched.h), cadence plancher BMU_BLE_BATT_PERIOD_MS
+ *        relevee selon les intervalles de connexion.
  *
  * Chaque batterie est encodee dans une struct packed de 15 octets (integer only).
  * UUIDs : Service 0x0001, Chars 0x0010..0x002F.
+ * Flotte 0x003E (CONFIG_BMU_BLE_FLEET_ENABLED) : trames delta MTU
+ * (bmu_ble_fleet.h), sous-cadence CONFIG_BMU_BLE_FLEET_PERIOD_MS.
  */
 #include "sdkconfig.h"
 
@@ -17,11 +22,16 @@
 
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
 #include "host/ble_hs.h"
 #include "host/ble_gatt.h"
 #include "os/os_mbuf.h"
 
+#include <math.h>
+
 #include "bmu_balancer.h"
+#include "bmu_rbe.h"
+#include "bmu_ble_fleet.h"
 
 #if CONFIG_BMU_RINT_ENABLED
 #include "bmu_rint.h"
@@ -41,7 +51,138 @@ typedef struct __attribute__((packed)) {
 
 /* ── Value handles pour les notifications ────────────────────────── */
 static uint16_t s_battery_val_handles[BMU_MAX_BATTERIES];
-static esp_timer_handle_t s_notify_timer = NULL;
+
+/* Report-by-exception (bmu_rbe.h) : une batterie n'est notifiée que si
+ * V, I, état, nb_switch ou balancer a changé, ou au heartbeat. */
+enum { BLE_RBE_V, BLE_RBE_I, BLE_RBE_STATE, BLE_RBE_NBSW, BLE_RBE_BAL, BLE_RBE_NB };
+static const float s_rbe_db[BLE_RBE_NB] = { BMU_RBE_DB_MV, BMU_RBE_DB_MA, 0.0f, 0.0f, 0.0f };
+static const bmu_rbe_cfg_t s_rbe = { s_rbe_db, BLE_RBE_NB, BMU_RBE_HEARTBEAT_MS };
+static bmu_rbe_slot_t s_rbe_slot[BMU_MAX_BATTERIES];
+
+/* Cadences : planchers de configuration, relevés selon les intervalles de
+ * connexion des clients et le nombre de notifications du dernier cycle
+ * (bmu_ble_notify_period_ms) pour ne pas empiler plus que la radio n'écoule. */
+#define LEGACY_PERIOD_MS     1000
+#define LEGACY_PERIOD_MAX_MS BMU_BLE_BATT_PERIOD_MAX_MS
+#define NOTIFY_TOL_MS        (BMU_LOOP_PERIOD_MS / 2)
+static uint32_t s_legacy_last_ms = 0;
+static uint32_t s_legacy_period_ms = LEGACY_PERIOD_MS;
+
+/* ── Flotte 0x003E : trames delta MTU ────────────────────────────── */
+#if CONFIG_BMU_BLE_FLEET_ENABLED
+/* Ah : 10 mAh, sinon chaque cycle en charge renvoie les deux compteurs */
+static const int32_t s_fleet_db[BMU_BLE_FLEET_NB_FIELDS] = {
+    (int32_t)BMU_RBE_DB_MV, (int32_t)BMU_RBE_DB_MA, 0, 10, 10, 0, 0,
+};
+static const bmu_ble_fleet_cfg_t s_fleet_cfg = { s_fleet_db, BMU_RBE_HEARTBEAT_MS };
+static bmu_ble_fleet_t s_fleet;
+static bmu_ble_fleet_batt_t s_fleet_cur[BMU_MAX_BATTERIES];
+static uint8_t s_fleet_buf[512];
+static uint16_t s_fleet_val_handle = 0;
+static ble_uuid128_t s_fleet_uuid = BMU_BLE_UUID128_DECLARE(0x3E, 0x00);
+
+/* Abonnés : écrits par la tâche host NimBLE, lus par le timer */
+static portMUX_TYPE s_fleet_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_fleet_subs[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+static int s_fleet_nb_subs = 0;
+static volatile bool s_fleet_resync_req = false;
+static uint32_t s_fleet_last_ms = 0;
+static uint32_t s_fleet_period_ms = CONFIG_BMU_BLE_FLEET_PERIOD_MS;
+
+/* WRITE (tout contenu) : le client a vu un trou de seq → keyframe */
+static int fleet_access_cb(uint16_t conn, uint16_t attr,
+                           struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)conn; (void)attr; (void)arg;
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) return BLE_ATT_ERR_UNLIKELY;
+    s_fleet_resync_req = true;
+    return 0;
+}
+
+/* Retourne le nombre de trames émises (cadence du cycle suivant) */
+static int fleet_notify(uint8_t nb, uint32_t now_ms)
+{
+    uint16_t subs[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+    portENTER_CRITICAL(&s_fleet_mux);
+    int n = s_fleet_nb_subs;
+    memcpy(subs, s_fleet_subs, sizeof(subs));
+    portEXIT_CRITICAL(&s_fleet_mux);
+    if (n == 0) return 0;
+
+    /* Trames dimensionnées sur le plus petit MTU des abonnés */
+    uint16_t mtu = UINT16_MAX;
+    for (int k = 0; k < n; k++) {
+        uint16_t m = ble_att_mtu(subs[k]);
+        if (m != 0 && m < mtu) mtu = m;
+    }
+    if (mtu < BMU_BLE_FLEET_MIN_MTU) {
+        ESP_LOGD(TAG, "Flotte : MTU %u < %d, pas de notification", mtu, BMU_BLE_FLEET_MIN_MTU);
+        return 0;
+    }
+    size_t cap = (size_t)mtu - 3;
+    if (cap > sizeof(s_fleet_buf)) cap = sizeof(s_fleet_buf);
+
+    if (s_fleet_resync_req) {
+        s_fleet_resync_req = false;
+        bmu_ble_fleet_resync(&s_fleet);
+    }
+    if (bmu_ble_fleet_prepare(&s_fleet, s_fleet_cur, nb, now_ms) == 0) return 0;
+
+    bool ok = true;
+    int frames = 0;
+    size_t len;
+    while ((len = bmu_ble_fleet_next(&s_fleet, s_fleet_buf, cap)) > 0) {
+        frames++;
+        for (int k = 0; k < n; k++) {
+            struct os_mbuf *om = ble_hs_mbuf_from_flat(s_fleet_buf, len);
+            if (om == NULL || ble_gatts_notify_custom(subs[k], s_fleet_val_handle, om) != 0) {
+                ok = false;
+            }
+        }
+    }
+    /* Une trame refusée par la pile : la référence n'avance pas, keyframe */
+    if (ok) {
+        bmu_ble_fleet_commit(&s_fleet);
+    } else {
+        bmu_ble_fleet_resync(&s_fleet);
+    }
+    return frames;
+}
+
+/* Cadence flotte : intervalles des seuls abonnés */
+static void fleet_adapt_period(int frames)
+{
+    uint16_t subs[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+    uint16_t itvl[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+    portENTER_CRITICAL(&s_fleet_mux);
+    int n = s_fleet_nb_subs;
+    memcpy(subs, s_fleet_subs, sizeof(subs));
+    portEXIT_CRITICAL(&s_fleet_mux);
+    n = bmu_ble_get_itvls_of(subs, n, itvl);
+    s_fleet_period_ms = bmu_ble_notify_period_ms(itvl, n, frames,
+                                                 CONFIG_BMU_BLE_FLEET_PERIOD_MS,
+                                                 LEGACY_PERIOD_MAX_MS);
+}
+#endif /* CONFIG_BMU_BLE_FLEET_ENABLED */
+
+void bmu_ble_battery_on_subscribe(uint16_t conn_handle, uint16_t attr_handle, bool notify)
+{
+#if CONFIG_BMU_BLE_FLEET_ENABLED
+    if (s_fleet_val_handle == 0 || attr_handle != s_fleet_val_handle) return;
+    portENTER_CRITICAL(&s_fleet_mux);
+    int k = 0;
+    while (k < s_fleet_nb_subs && s_fleet_subs[k] != conn_handle) k++;
+    if (notify && k == s_fleet_nb_subs && k < CONFIG_BMU_BLE_MAX_CONNECTIONS) {
+        s_fleet_subs[s_fleet_nb_subs++] = conn_handle;
+    } else if (!notify && k < s_fleet_nb_subs) {
+        s_fleet_subs[k] = s_fleet_subs[--s_fleet_nb_subs];
+    }
+    portEXIT_CRITICAL(&s_fleet_mux);
+    if (notify) s_fleet_resync_req = true;   /* nouvel abonné : keyframe */
+#else
+    (void)conn_handle; (void)attr_handle; (void)notify;
+#endif
+}
 
 /* ── Construction du payload pour une batterie ───────────────────── */
 static void build_battery_payload(int idx, ble_battery_char_t *out)
@@ -123,15 +264,26 @@ typedef struct __attribute__((packed)) {
 static ble_uuid128_t s_bal_state_uuid = BMU_BLE_UUID128_DECLARE(0x3B, 0x00);
 static uint16_t s_bal_val_handle = 0;
 
+/* Cache SOH et R_int des n premieres batteries : une copie par cycle de
+ * notification (un verrou R_int) ou par lecture GATT */
+static float             s_soh[BMU_MAX_BATTERIES];
+static bmu_rint_result_t s_rint[BMU_MAX_BATTERIES];
+
+static void soh_snapshot(uint8_t nb)
+{
+    for (int i = 0; i < nb; i++) s_soh[i] = bmu_soh_get_cached(i);
+    if (!bmu_rint_get_cached_all(s_rint, nb)) memset(s_rint, 0, sizeof(s_rint));
+}
+
 static void build_soh_payload(int idx, ble_soh_char_t *out)
 {
-    float soh = bmu_soh_get_cached(idx);
+    float soh = s_soh[idx];
     out->soh_pct = (soh >= 0.0f) ? (uint8_t)(soh * 100.0f) : 0;
 
-    bmu_rint_result_t rint = bmu_rint_get_cached((uint8_t)idx);
-    out->r_ohmic_mohm_x10 = (uint16_t)(rint.r_ohmic_mohm * 10.0f);
-    out->r_total_mohm_x10 = (uint16_t)(rint.r_total_mohm * 10.0f);
-    out->rint_valid        = (uint8_t)(rint.valid ? 1 : 0);
+    const bmu_rint_result_t *rint = &s_rint[idx];
+    out->r_ohmic_mohm_x10 = (uint16_t)(rint->r_ohmic_mohm * 10.0f);
+    out->r_total_mohm_x10 = (uint16_t)(rint->r_total_mohm * 10.0f);
+    out->rint_valid        = (uint8_t)(rint->valid ? 1 : 0);
 
     /* Confidence proxy: clamp SOH accumulator sample count to 0-100 */
     /* soh_pct == 0 && soh < 0 means "not yet computed" → confidence 0 */
@@ -149,6 +301,7 @@ static int soh_result_access_cb(uint16_t conn_handle, uint16_t attr_handle,
     uint8_t nb_ina = bmu_ble_get_nb_ina();
     if (nb_ina > BMU_MAX_BATTERIES) nb_ina = BMU_MAX_BATTERIES; /* clamp défensif */
 
+    soh_snapshot(nb_ina);
     for (int i = 0; i < nb_ina; i++) {
         ble_soh_char_t payload;
         build_soh_payload(i, &payload);
@@ -183,18 +336,193 @@ static int bal_state_access_cb(uint16_t conn, uint16_t attr,
 
 #endif /* CONFIG_BMU_BLE_SOH_ENABLED */
 
-/* ── Timer notification 1s ───────────────────────────────────────── */
-static void notify_timer_cb(void *arg)
+/* ── SOC EKF 0x003C (CONFIG_BMU_SOC_ENABLED) ─────────────────────── */
+#if CONFIG_BMU_SOC_ENABLED
+
+#include "bmu_soc.h"
+
+/* Payload : nb (1 octet) puis 3 octets par batterie */
+typedef struct __attribute__((packed)) {
+    uint16_t soc_permille;      /* SOC 0-1000, 0xFFFF si pas encore estimé */
+    uint8_t  sigma_pct;         /* Incertitude 1σ en % (0-255) */
+} ble_soc_char_t;
+
+static ble_uuid128_t s_soc_uuid = BMU_BLE_UUID128_DECLARE(0x3C, 0x00);
+static uint16_t s_soc_val_handle = 0;
+
+/* SOC et sigma lus sous un seul verrou EKF par notification ou lecture */
+static float s_soc[BMU_MAX_BATTERIES];
+static float s_soc_sigma[BMU_MAX_BATTERIES];
+
+static int append_soc_payload(struct os_mbuf *om, uint8_t nb)
+{
+    if (nb > BMU_MAX_BATTERIES) nb = BMU_MAX_BATTERIES;
+    if (!bmu_soc_get_all(s_soc, s_soc_sigma, nb)) {
+        for (int i = 0; i < nb; i++) s_soc[i] = s_soc_sigma[i] = -1.0f;
+    }
+    if (os_mbuf_append(om, &nb, 1) != 0) return -1;
+    for (int i = 0; i < nb; i++) {
+        float soc = s_soc[i];
+        float sigma = s_soc_sigma[i];
+        ble_soc_char_t c;
+        c.soc_permille = (soc >= 0.0f) ? (uint16_t)(soc * 10.0f + 0.5f) : 0xFFFF;
+        c.sigma_pct    = (sigma >= 0.0f) ? (uint8_t)(sigma > 255.0f ? 255.0f : sigma + 0.5f) : 255;
+        if (os_mbuf_append(om, &c, sizeof(c)) != 0) return -1;
+    }
+    return 0;
+}
+
+static int soc_access_cb(uint16_t conn, uint16_t attr,
+                         struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
-    /* Utiliser nb_ina dynamique depuis le contexte protection */
+    (void)conn; (void)attr; (void)arg;
+    if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) return BLE_ATT_ERR_UNLIKELY;
     bmu_protection_ctx_t *prot = bmu_ble_get_prot();
-    uint8_t nb_ina = prot ? prot->nb_ina : bmu_ble_get_nb_ina();
+    uint8_t nb = prot ? prot->nb_ina : bmu_ble_get_nb_ina();
+    return append_soc_payload(ctxt->om, nb) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+#endif /* CONFIG_BMU_SOC_ENABLED */
+
+/* ── RUL / tendance 0x003D (CONFIG_BMU_RUL_ENABLED), READ seul ───── */
+#if CONFIG_BMU_RUL_ENABLED
+
+#include "bmu_rul.h"
+
+/* Payload : nb (1 octet) puis 10 octets par batterie */
+typedef struct __attribute__((packed)) {
+    uint16_t rul_days;          /* 0xFFFF si inconnue */
+    int16_t  rint_slope_uohm_d; /* Pente R_int (µΩ/jour), INT16_MIN si inconnue */
+    int16_t  soh_slope_mpct_d;  /* Pente SOH (millième de %/jour), INT16_MIN si inconnue */
+    uint16_t capacity_cah;      /* Capacité tendancielle (0.01 Ah), 0 si inconnue */
+    uint8_t  n_points;          /* Points d'historique (saturé à 255) */
+    uint8_t  flags;             /* bit0=alerte, bits4-7=métrique limitante */
+} ble_rul_char_t;
+
+static ble_uuid128_t s_rul_uuid = BMU_BLE_UUID128_DECLARE(0x3D, 0x00);
+static uint16_t s_rul_val_handle = 0;
+
+static int16_t clamp_i16(float v)
+{
+    if (isnan(v)) return INT16_MIN;
+    if (v > 32767.0f) return 32767;
+    if (v < -32767.0f) return -32767;
+    return (int16_t)lroundf(v);
+}
 
+static int rul_access_cb(uint16_t conn, uint16_t attr,
+                         struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)conn; (void)attr; (void)arg;
+    if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) return BLE_ATT_ERR_UNLIKELY;
+    bmu_protection_ctx_t *prot = bmu_ble_get_prot();
+    uint8_t nb = prot ? prot->nb_ina : bmu_ble_get_nb_ina();
+    if (nb > BMU_MAX_BATTERIES) nb = BMU_MAX_BATTERIES;
+    if (os_mbuf_append(ctxt->om, &nb, 1) != 0) return BLE_ATT_ERR_INSUFFICIENT_RES;
+    for (int i = 0; i < nb; i++) {
+        bmu_rul_result_t r = {};
+        ble_rul_char_t c = {};
+        if (bmu_rul_get(i, &r)) {
+            c.rul_days = (r.rul_days < 0.0f) ? 0xFFFF
+                       : (uint16_t)(r.rul_days > 65534.0f ? 65534.0f : r.rul_days);
+            c.rint_slope_uohm_d = clamp_i16(r.rint_slope_mohm_day * 1000.0f);
+            c.soh_slope_mpct_d  = clamp_i16(r.soh_slope_pct_day * 1000.0f);
+            c.capacity_cah = isnan(r.capacity_ah) || r.capacity_ah <= 0.0f ? 0
+                           : (uint16_t)(r.capacity_ah > 655.0f ? 65500.0f : r.capacity_ah * 100.0f);
+            c.n_points = r.n_points > 255 ? 255 : (uint8_t)r.n_points;
+            c.flags = (uint8_t)((r.alert ? 0x01 : 0x00) | ((uint8_t)r.limit << 4));
+        } else {
+            c.rul_days = 0xFFFF;
+            c.rint_slope_uohm_d = INT16_MIN;
+            c.soh_slope_mpct_d = INT16_MIN;
+        }
+        if (os_mbuf_append(ctxt->om, &c, sizeof(c)) != 0) return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return 0;
+}
+
+#endif /* CONFIG_BMU_RUL_ENABLED */
+
+/* ── Notifications : source prioritaire de l'ordonnanceur BLE ───── */
+/* Tension, courant, état et commutations viennent du snapshot ; les Ah,
+ * l'état balancer, SOH/R_int et SOC, absents du snapshot, sont copiés une
+ * fois par cycle (un verrou chacun) au lieu d'un getter par batterie et
+ * par champ. */
+static const bmu_snapshot_t *s_snap = NULL;
+static bmu_coulomb_t  s_coulomb[BMU_MAX_BATTERIES];
+static uint8_t        s_bal_duty[BMU_MAX_BATTERIES];
+static uint32_t       s_bal_off;        /* bit i = phase OFF */
+static volatile bool  s_notify_active = false;
+
+static void snapshot_payload(int idx, ble_battery_char_t *out)
+{
+    out->voltage_mv       = (int32_t)s_snap->battery[idx].voltage_mv;
+    out->current_ma       = (int32_t)(s_snap->battery[idx].current_a * 1000.0f);
+    out->state            = (uint8_t)s_snap->battery[idx].state;
+    out->ah_discharge_mah = (int32_t)(s_coulomb[idx].ah_discharge * 1000.0f);
+    out->ah_charge_mah    = (int32_t)(s_coulomb[idx].ah_charge * 1000.0f);
+    uint16_t nsw = s_snap->battery[idx].nb_switches;
+    out->nb_switch        = (uint8_t)(nsw > 255 ? 255 : nsw);
+}
+
+static void legacy_adapt_period(int notified)
+{
+    uint16_t itvl[CONFIG_BMU_BLE_MAX_CONNECTIONS];
+    int n = bmu_ble_get_conn_itvls(itvl, CONFIG_BMU_BLE_MAX_CONNECTIONS);
+    s_legacy_period_ms = bmu_ble_notify_period_ms(itvl, n, notified,
+                                                  LEGACY_PERIOD_MS, LEGACY_PERIOD_MAX_MS);
+}
+
+static int notify_cycle(uint32_t now_ms)
+{
+    uint8_t nb_ina = s_snap->nb_batteries;
+    if (nb_ina > BMU_MAX_BATTERIES) nb_ina = BMU_MAX_BATTERIES;
+
+    bool legacy = (uint32_t)(now_ms - s_legacy_last_ms) + NOTIFY_TOL_MS >= s_legacy_period_ms;
+#if CONFIG_BMU_BLE_FLEET_ENABLED
+    bool fleet = s_fleet_nb_subs > 0 &&
+                 (uint32_t)(now_ms - s_fleet_last_ms) + NOTIFY_TOL_MS >= s_fleet_period_ms;
+#else
+    bool fleet = false;
+#endif
+    if (!legacy && !fleet) return 0;
+    if (legacy) s_legacy_last_ms = now_ms;
+
+    if (bmu_battery_manager_get_coulomb_all(bmu_ble_get_mgr(), s_coulomb, nb_ina) != ESP_OK) {
+        memset(s_coulomb, 0, sizeof(s_coulomb));
+    }
+    if (!bmu_balancer_get_duty_all(s_bal_duty, &s_bal_off, nb_ina)) {
+        memset(s_bal_duty, 100, sizeof(s_bal_duty));
+        s_bal_off = 0;
+    }
+
+    int notified = 0;
     for (int i = 0; i < nb_ina; i++) {
-        if (s_battery_val_handles[i] == 0) continue;
+        if (!fleet && s_battery_val_handles[i] == 0) continue;
 
         ble_battery_char_t payload;
-        build_battery_payload(i, &payload);
+        snapshot_payload(i, &payload);
+        /* -1 = phase OFF, sinon duty (fleet, seuil de notification) */
+        int bal = (s_bal_off >> i) & 1u ? -1 : s_bal_duty[i];
+
+#if CONFIG_BMU_BLE_FLEET_ENABLED
+        bmu_ble_fleet_batt_t *fc = &s_fleet_cur[i];
+        fc->f[BMU_BLE_FLEET_V]     = payload.voltage_mv;
+        fc->f[BMU_BLE_FLEET_I]     = payload.current_ma;
+        fc->f[BMU_BLE_FLEET_STATE] = payload.state;
+        fc->f[BMU_BLE_FLEET_AH_D]  = payload.ah_discharge_mah;
+        fc->f[BMU_BLE_FLEET_AH_C]  = payload.ah_charge_mah;
+        fc->f[BMU_BLE_FLEET_NBSW]  = payload.nb_switch;
+        fc->f[BMU_BLE_FLEET_BAL]   = bal < 0 ? BMU_BLE_FLEET_BAL_OFF : bal;
+#endif
+        if (!legacy || s_battery_val_handles[i] == 0) continue;
+
+        const float cur[BLE_RBE_NB] = {
+            (float)payload.voltage_mv, (float)payload.current_ma, (float)payload.state,
+            (float)payload.nb_switch, (float)bal,
+        };
+        if (!bmu_rbe_check(&s_rbe, &s_rbe_slot[i], cur, now_ms)) continue;
+        notified++;
 
         /* Envoyer la notification a tous les clients connectes */
         struct os_mbuf *om = ble_hs_mbuf_from_flat(&payload, sizeof(payload));
@@ -208,64 +536,106 @@ static void notify_timer_cb(void *arg)
         }
     }
 
+    int frames = 0;
+#if CONFIG_BMU_BLE_FLEET_ENABLED
+    if (fleet) {
+        s_fleet_last_ms = now_ms;
+        frames = fleet_notify(nb_ina, now_ms);
+        fleet_adapt_period(frames);
+    }
+#endif
+    if (!legacy) return frames;
+
+    /* Caractéristiques agrégées : suivent les batteries (changement ou heartbeat) */
+    if (notified > 0) {
 #if CONFIG_BMU_BLE_SOH_ENABLED
-    /* Notify SOH characteristic (all batteries concatenated) */
-    if (s_soh_val_handle != 0) {
-        struct os_mbuf *om_soh = ble_hs_mbuf_from_flat(NULL, 0);
-        if (om_soh) {
-            bool ok = true;
-            for (int i = 0; i < nb_ina && ok; i++) {
-                ble_soh_char_t soh_payload;
-                build_soh_payload(i, &soh_payload);
-                if (os_mbuf_append(om_soh, &soh_payload, sizeof(soh_payload)) != 0) {
-                    ok = false;
+        /* Notify SOH characteristic (all batteries concatenated) */
+        if (s_soh_val_handle != 0) {
+            struct os_mbuf *om_soh = ble_hs_mbuf_from_flat(NULL, 0);
+            if (om_soh) {
+                soh_snapshot(nb_ina);
+                bool ok = true;
+                for (int i = 0; i < nb_ina && ok; i++) {
+                    ble_soh_char_t soh_payload;
+                    build_soh_payload(i, &soh_payload);
+                    if (os_mbuf_append(om_soh, &soh_payload, sizeof(soh_payload)) != 0) {
+                        ok = false;
+                    }
+                }
+                if (ok) {
+                    int rc = ble_gatts_notify_custom(0xFFFF, s_soh_val_handle, om_soh);
+                    if (rc != 0 && rc != BLE_HS_ENOTCONN) {
+                        ESP_LOGD(TAG, "Notify SOH rc=%d", rc);
+                    }
+                } else {
+                    os_mbuf_free_chain(om_soh);
                 }
             }
-            if (ok) {
-                int rc = ble_gatts_notify_custom(0xFFFF, s_soh_val_handle, om_soh);
-                if (rc != 0 && rc != BLE_HS_ENOTCONN) {
-                    ESP_LOGD(TAG, "Notify SOH rc=%d", rc);
+            notified++;
+        }
+
+        /* Balancer state notify */
+        if (s_bal_val_handle != 0) {
+            struct os_mbuf *om_bal = ble_hs_mbuf_from_flat(NULL, 0);
+            if (om_bal) {
+                uint8_t nb_bal = nb_ina > 32 ? 32 : nb_ina;
+                os_mbuf_append(om_bal, &nb_bal, 1);
+                for (int i = 0; i < nb_bal; i++) {
+                    ble_balancer_char_t bl;
+                    bl.flags = 0;
+                    if ((s_bal_off >> i) & 1u) bl.flags |= 0x01;
+                    if (s_bal_duty[i] < 100) bl.flags |= 0x02;
+                    bl.duty_pct = s_bal_duty[i];
+                    os_mbuf_append(om_bal, &bl, sizeof(bl));
                 }
-            } else {
-                os_mbuf_free_chain(om_soh);
+                ble_gatts_notify_custom(0xFFFF, s_bal_val_handle, om_bal);
             }
+            notified++;
         }
-    }
+#endif
 
-    /* Balancer state notify */
-    if (s_bal_val_handle != 0) {
-        struct os_mbuf *om_bal = ble_hs_mbuf_from_flat(NULL, 0);
-        if (om_bal) {
-            uint8_t nb_bal = nb_ina > 32 ? 32 : nb_ina;
-            os_mbuf_append(om_bal, &nb_bal, 1);
-            for (int i = 0; i < nb_bal; i++) {
-                ble_balancer_char_t bl;
-                bl.flags = 0;
-                if (bmu_balancer_is_off((uint8_t)i)) bl.flags |= 0x01;
-                if (bmu_balancer_get_duty_pct((uint8_t)i) < 100) bl.flags |= 0x02;
-                bl.duty_pct = (uint8_t)bmu_balancer_get_duty_pct((uint8_t)i);
-                os_mbuf_append(om_bal, &bl, sizeof(bl));
+#if CONFIG_BMU_SOC_ENABLED
+        if (s_soc_val_handle != 0) {
+            struct os_mbuf *om_soc = ble_hs_mbuf_from_flat(NULL, 0);
+            if (om_soc) {
+                if (append_soc_payload(om_soc, nb_ina) == 0) {
+                    ble_gatts_notify_custom(0xFFFF, s_soc_val_handle, om_soc);
+                } else {
+                    os_mbuf_free_chain(om_soc);
+                }
             }
-            ble_gatts_notify_custom(0xFFFF, s_bal_val_handle, om_bal);
+            notified++;
         }
-    }
 #endif
+    }
+    legacy_adapt_period(notified);
+    return notified + frames;
+}
+
+/* Appelée par l'ordonnanceur à BMU_BLE_BATT_PERIOD_MS au plus vite : les
+ * sous-cadences legacy et flotte restent gérées ici, les notifications
+ * émises sont décomptées du crédit radio commun. */
+int bmu_ble_battery_notify_tick(uint32_t now_ms, int budget, void *arg)
+{
+    (void)budget; (void)arg;
+    if (!s_notify_active) return 0;
+    s_snap = bmu_ble_get_snapshot();
+    return notify_cycle(now_ms);
 }
 
 void bmu_ble_battery_notify_start(void)
 {
-    if (s_notify_timer) {
-        esp_timer_start_periodic(s_notify_timer, 1000000); /* 1s */
-        ESP_LOGI(TAG, "Battery notify timer demarre (1s)");
-    }
+    /* Nouveau client : tout renvoyer au premier cycle */
+    for (int i = 0; i < BMU_MAX_BATTERIES; i++) bmu_rbe_reset(&s_rbe_slot[i]);
+    s_legacy_last_ms = (uint32_t)(esp_timer_get_time() / 1000) - LEGACY_PERIOD_MAX_MS;
+    s_notify_active = true;
+    ESP_LOGI(TAG, "Battery notify actif (snapshots protection)");
 }
 
 void bmu_ble_battery_notify_stop(void)
 {
-    if (s_notify_timer) {
-        esp_timer_stop(s_notify_timer);
-        ESP_LOGI(TAG, "Battery notify timer arrete");
-    }
+    s_notify_active = false;
+    ESP_LOGI(TAG, "Battery notify suspendu");
 }
 
 /* ── Definition du service GATT Battery ──────────────────────────── */
@@ -390,8 +760,9 @@ static int rint_result_access_cb(uint16_t conn_handle, uint16_t attr_handle,
 #endif /* CONFIG_BMU_RINT_ENABLED */
 
 /* Tableau de characteristics — construit dynamiquement car arg = index */
-/* +1 terminateur, +2 pour R_int, +1 pour SOH, +1 pour Balancer */
-static struct ble_gatt_chr_def s_bat_chr_defs[BMU_MAX_BATTERIES + 5];
+/* +1 terminateur, +2 pour R_int, +1 pour SOH, +1 pour Balancer, +1 pour SOC, +1 pour RUL,
+ * +1 pour la flotte */
+static struct ble_gatt_chr_def s_bat_chr_defs[BMU_MAX_BATTERIES + 8];
 
 static struct ble_gatt_svc_def s_bat_svc[] = {
     {
@@ -450,29 +821,48 @@ const struct ble_gatt_svc_def *bmu_ble_battery_svc_defs(void)
         s_bat_chr_defs[bal_base].flags      = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY;
         s_bat_chr_defs[bal_base].val_handle = &s_bal_val_handle;
 
-        /* Terminateur */
-        memset(&s_bat_chr_defs[bal_base + 1], 0, sizeof(struct ble_gatt_chr_def));
+        int end = bal_base + 1;
 #else
-        /* Terminateur (RINT sans SOH) */
-        memset(&s_bat_chr_defs[BMU_MAX_BATTERIES + 2], 0, sizeof(struct ble_gatt_chr_def));
+        int end = BMU_MAX_BATTERIES + 2;   /* RINT sans SOH */
 #endif
 #else
-        /* Terminateur */
-        memset(&s_bat_chr_defs[BMU_MAX_BATTERIES], 0, sizeof(struct ble_gatt_chr_def));
+        int end = BMU_MAX_BATTERIES;
 #endif
 
-        /* Creer le timer de notification (pas encore demarre) */
-        const esp_timer_create_args_t timer_args = {
-            .callback = notify_timer_cb,
-            .arg = NULL,
-            .dispatch_method = ESP_TIMER_TASK,
-            .name = "ble_bat_notify",
-            .skip_unhandled_events = true,
-        };
-        if (esp_timer_create(&timer_args, &s_notify_timer) != ESP_OK) {
-            ESP_LOGE(TAG, "esp_timer_create (bat notify) échec");
-            s_notify_timer = NULL;
-        }
+#if CONFIG_BMU_SOC_ENABLED
+        /* SOC EKF 0x003C */
+        s_bat_chr_defs[end].uuid       = &s_soc_uuid.u;
+        s_bat_chr_defs[end].access_cb  = soc_access_cb;
+        s_bat_chr_defs[end].arg        = NULL;
+        s_bat_chr_defs[end].flags      = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY;
+        s_bat_chr_defs[end].val_handle = &s_soc_val_handle;
+        end++;
+#endif
+
+#if CONFIG_BMU_RUL_ENABLED
+        /* RUL / tendance 0x003D */
+        s_bat_chr_defs[end].uuid       = &s_rul_uuid.u;
+        s_bat_chr_defs[end].access_cb  = rul_access_cb;
+        s_bat_chr_defs[end].arg        = NULL;
+        s_bat_chr_defs[end].flags      = BLE_GATT_CHR_F_READ;
+        s_bat_chr_defs[end].val_handle = &s_rul_val_handle;
+        end++;
+#endif
+
+#if CONFIG_BMU_BLE_FLEET_ENABLED
+        /* Flotte 0x003E : NOTIFY + WRITE (demande de keyframe) */
+        bmu_ble_fleet_init(&s_fleet, &s_fleet_cfg);
+        s_bat_chr_defs[end].uuid       = &s_fleet_uuid.u;
+        s_bat_chr_defs[end].access_cb  = fleet_access_cb;
+        s_bat_chr_defs[end].arg        = NULL;
+        s_bat_chr_defs[end].flags      = BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_WRITE |
+                                         BLE_GATT_CHR_F_WRITE_NO_RSP;
+        s_bat_chr_defs[end].val_handle = &s_fleet_val_handle;
+        end++;
+#endif
+
+        /* Terminateur */
+        memset(&s_bat_chr_defs[end], 0, sizeof(struct ble_gatt_chr_def));
 
         s_inited = true;
     }
@@ -61,7 +61,6 @@ static ble_uuid128_t s_dev_name_chr_uuid  = BMU_BLE_UUID128_DECLARE(0x38, 0x00);
 
 static uint16_t s_wifi_sts_val_handle = 0;
 static uint16_t s_bat_label_val_handle = 0;
-static esp_timer_handle_t s_wifi_notify_timer = NULL;
 
 enum ctrl_chr_id {
     CTRL_CHR_SWITCH = 0,
@@ -503,40 +502,13 @@ static struct ble_gatt_chr_def s_ctrl_chr_defs[] = {
     {}, /* Terminateur */
 };
 
-/* ── WiFi status notify timer ─────────────────────────────────────── */
-static void wifi_notify_cb(void *arg)
+/* ── WiFi status notify 10s, ordonnanceur BLE ─────────────────────── */
+int bmu_ble_wifi_notify_tick(uint32_t now_ms, int budget, void *arg)
 {
-    (void)arg;
-    if (s_wifi_sts_val_handle != 0) {
-        ble_gatts_chr_updated(s_wifi_sts_val_handle);
-    }
-}
-
-void bmu_ble_wifi_notify_start(void)
-{
-    if (s_wifi_notify_timer != NULL) return;
-    const esp_timer_create_args_t args = {
-        .callback = wifi_notify_cb,
-        .arg = NULL,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "ble_wifi_ntf",
-        .skip_unhandled_events = true,
-    };
-    if (esp_timer_create(&args, &s_wifi_notify_timer) == ESP_OK) {
-        esp_timer_start_periodic(s_wifi_notify_timer, 10000000ULL); /* 10s */
-    } else {
-        ESP_LOGE(TAG, "esp_timer_create (wifi notify) échec");
-        s_wifi_notify_timer = NULL;
-    }
-}
-
-void bmu_ble_wifi_notify_stop(void)
-{
-    if (s_wifi_notify_timer != NULL) {
-        esp_timer_stop(s_wifi_notify_timer);
-        esp_timer_delete(s_wifi_notify_timer);
-        s_wifi_notify_timer = NULL;
-    }
+    (void)now_ms; (void)budget; (void)arg;
+    if (s_wifi_sts_val_handle == 0) return 0;
+    ble_gatts_chr_updated(s_wifi_sts_val_handle);
+    return 1;
 }
 
 static struct ble_gatt_svc_def s_ctrl_svc[] = {
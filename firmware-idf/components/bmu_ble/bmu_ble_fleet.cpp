@@ -0,0 +1,137 @@
+/**
+ * bmu_ble_fleet — Trames delta de la caractéristique flotte (voir bmu_ble_fleet.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_ble_fleet). Les valeurs
+ * sont saturées à la plage du champ à l'encodage ; la comparaison avec la
+ * référence se fait sur les valeurs saturées, comme le client les voit.
+ */
+
+#include "bmu_ble_fleet.h"
+
+#include <cstring>
+
+static const uint8_t FIELD_LEN[BMU_BLE_FLEET_NB_FIELDS] = { 2, 4, 1, 4, 4, 1, 1 };
+
+/* ── Conversion bornée ───────────────────────────────────────────────── */
+
+static int32_t clamp_field(int k, int32_t v)
+{
+    switch (FIELD_LEN[k]) {
+    case 1: return v < 0 ? (k == BMU_BLE_FLEET_BAL ? BMU_BLE_FLEET_BAL_OFF : 0) : v > 255 ? 255 : v;
+    case 2: return v < 0 ? 0 : v > UINT16_MAX ? UINT16_MAX : v;
+    default: return v;
+    }
+}
+
+static inline uint8_t *put(uint8_t *p, uint32_t v, uint8_t len)
+{
+    for (uint8_t b = 0; b < len; b++) p[b] = (uint8_t)(v >> (8 * b));
+    return p + len;
+}
+
+static uint8_t rec_len(uint8_t mask)
+{
+    uint8_t len = 2;
+    for (int k = 0; k < BMU_BLE_FLEET_NB_FIELDS; k++) {
+        if (mask & (1u << k)) len += FIELD_LEN[k];
+    }
+    return len;
+}
+
+/* ── API ─────────────────────────────────────────────────────────────── */
+
+void bmu_ble_fleet_init(bmu_ble_fleet_t *f, const bmu_ble_fleet_cfg_t *cfg)
+{
+    memset(f, 0, sizeof(*f));
+    f->cfg = cfg;
+    f->resync = true;
+}
+
+void bmu_ble_fleet_resync(bmu_ble_fleet_t *f)
+{
+    f->resync = true;
+}
+
+int bmu_ble_fleet_prepare(bmu_ble_fleet_t *f, const bmu_ble_fleet_batt_t *cur,
+                          uint8_t nb, uint32_t now_ms)
+{
+    if (nb > BMU_BLE_FLEET_MAX_BATT) nb = BMU_BLE_FLEET_MAX_BATT;
+    const uint8_t all = (uint8_t)((1u << BMU_BLE_FLEET_NB_FIELDS) - 1);
+
+    f->key = f->resync || nb != f->nb || f->cfg->key_ms == 0 ||
+             (uint32_t)(now_ms - f->key_last_ms) >= f->cfg->key_ms;
+    f->nb = nb;
+    f->next = 0;
+
+    int due = 0;
+    for (uint8_t i = 0; i < nb; i++) {
+        uint8_t mask = 0;
+        for (int k = 0; k < BMU_BLE_FLEET_NB_FIELDS; k++) {
+            int32_t v = clamp_field(k, cur[i].f[k]);
+            f->cur[i].f[k] = v;
+            int64_t d = (int64_t)v - f->last[i].f[k];
+            if (d < 0) d = -d;
+            int32_t db = f->cfg->deadband[k];
+            if (db == 0 ? d != 0 : d > db) mask |= (uint8_t)(1u << k);
+        }
+        f->mask[i] = f->key ? all : mask;
+        if (f->mask[i]) due++;
+    }
+    if (f->key) f->key_last_ms = now_ms;
+    return due;
+}
+
+size_t bmu_ble_fleet_next(bmu_ble_fleet_t *f, uint8_t *out, size_t cap)
+{
+    if (cap < BMU_BLE_FLEET_HDR_LEN + BMU_BLE_FLEET_REC_MAX) return 0;
+    while (f->next < f->nb && f->mask[f->next] == 0) f->next++;
+    if (f->next >= f->nb) return 0;
+
+    uint8_t *p = out + BMU_BLE_FLEET_HDR_LEN;
+    uint8_t n_rec = 0;
+    while (f->next < f->nb) {
+        uint8_t i = f->next;
+        uint8_t mask = f->mask[i];
+        if (mask != 0) {
+            if ((size_t)(p - out) + rec_len(mask) > cap) break;
+            *p++ = i;
+            *p++ = mask;
+            for (int k = 0; k < BMU_BLE_FLEET_NB_FIELDS; k++) {
+                if (mask & (1u << k)) p = put(p, (uint32_t)f->cur[i].f[k], FIELD_LEN[k]);
+            }
+            n_rec++;
+        }
+        f->next++;
+    }
+    while (f->next < f->nb && f->mask[f->next] == 0) f->next++;
+
+    out[0] = (uint8_t)((f->key ? BMU_BLE_FLEET_F_KEY : 0) |
+                       (f->next >= f->nb ? BMU_BLE_FLEET_F_LAST : 0));
+    put(out + 1, ++f->seq, 2);
+    out[3] = f->nb;
+    out[4] = n_rec;
+    return (size_t)(p - out);
+}
+
+void bmu_ble_fleet_commit(bmu_ble_fleet_t *f)
+{
+    for (uint8_t i = 0; i < f->nb; i++) {
+        for (int k = 0; k < BMU_BLE_FLEET_NB_FIELDS; k++) {
+            if (f->mask[i] & (1u << k)) f->last[i].f[k] = f->cur[i].f[k];
+        }
+    }
+    if (f->key) f->resync = false;
+}
+
+uint32_t bmu_ble_notify_period_ms(const uint16_t *itvl_1m25, int n, int frames,
+                                  uint32_t min_ms, uint32_t max_ms)
+{
+    if (frames < 1) frames = 1;
+    uint32_t events = (uint32_t)(frames + BMU_BLE_PKTS_PER_EVENT - 1) / BMU_BLE_PKTS_PER_EVENT;
+    uint32_t sum_1m25 = 0;
+    for (int k = 0; k < n; k++) sum_1m25 += itvl_1m25[k];
+    uint32_t period = (events * sum_1m25 * 5 + 3) / 4;             /* × 1.25 ms, arrondi sup. */
+    if (period < min_ms) period = min_ms;
+    if (period > max_ms) period = max_ms;
+    return period;
+}
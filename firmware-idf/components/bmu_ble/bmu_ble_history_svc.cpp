@@ -0,0 +1,379 @@
+/**
+ * @file bmu_ble_history_svc.cpp
+ * @brief Service GATT History — téléchargement du journal SD et du store
+ *        Influx offline (protocole : bmu_ble_xfer.h).
+ *
+ * UUIDs : Service 0x0004, Chars 0x0040 (contrôle) et 0x0041 (données).
+ * Un transfert à la fois, servi par la tâche ble_hist : le callback GATT ne
+ * fait que poster OPEN dans une file et relayer ACK/ABORT. Pendant le
+ * transfert, la connexion passe en intervalle court, 2M PHY et trames
+ * LL longues si le téléphone les accepte, puis revient à un intervalle
+ * économe.
+ */
+#include "sdkconfig.h"
+
+#if CONFIG_BMU_BLE_ENABLED && CONFIG_BMU_BLE_HISTORY_ENABLED
+
+#include "bmu_ble_internal.h"
+#include "bmu_ble_xfer.h"
+#include "bmu_storage.h"
+#include "bmu_influx_store.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "host/ble_hs.h"
+#include "host/ble_gatt.h"
+#include "os/os_mbuf.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char *TAG = "BLE_HIST";
+
+#define HIST_ACK_TIMEOUT_MS  5000
+#define HIST_IO_BUF          4096
+
+static ble_uuid128_t s_hist_svc_uuid  = BMU_BLE_UUID128_DECLARE(0x04, 0x00);
+static ble_uuid128_t s_hist_ctrl_uuid = BMU_BLE_UUID128_DECLARE(0x40, 0x00);
+static ble_uuid128_t s_hist_data_uuid = BMU_BLE_UUID128_DECLARE(0x41, 0x00);
+
+static uint16_t s_ctrl_val_handle = 0;
+static uint16_t s_data_val_handle = 0;
+
+typedef struct {
+    uint16_t           conn;
+    bmu_ble_xfer_cmd_t cmd;
+} hist_req_t;
+
+typedef struct {
+    uint16_t          conn;
+    uint8_t           format;
+    uint8_t           err;
+    bmu_ble_xfer_tx_t tx;
+} hist_job_t;
+
+static QueueHandle_t s_req_q = NULL;
+static TaskHandle_t  s_task = NULL;
+static hist_job_t   *s_job = NULL;          /* PSRAM, propriété de ble_hist */
+
+/* Écrits par la tâche host NimBLE, lus par ble_hist */
+static portMUX_TYPE      s_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint16_t s_active_conn = BLE_HS_CONN_HANDLE_NONE;
+static uint32_t          s_ack = 0;
+static volatile bool     s_abort = false;
+
+static void send_status(uint16_t conn, uint8_t op, uint32_t a, uint32_t b)
+{
+    uint8_t buf[BMU_BLE_XFER_STATUS_LEN];
+    size_t len = bmu_ble_xfer_encode_status(op, a, b, buf);
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(buf, len);
+    if (om) ble_gatts_notify_custom(conn, s_ctrl_val_handle, om);
+}
+
+/* ── Lien : débit pendant le transfert ───────────────────────────── */
+static void link_fast(uint16_t conn, bool fast)
+{
+    struct ble_gap_upd_params p = {};
+    p.itvl_min = fast ? 6 : 24;                 /* 7.5–15 ms, puis 30–50 ms */
+    p.itvl_max = fast ? 12 : 40;
+    p.latency = 0;
+    p.supervision_timeout = 400;                /* 4 s */
+    int rc = ble_gap_update_params(conn, &p);
+    if (rc != 0) ESP_LOGD(TAG, "update_params rc=%d", rc);
+    if (!fast) return;
+
+    ble_gap_set_data_len(conn, 251, 2120);
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    rc = ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK | BLE_GAP_LE_PHY_1M_MASK,
+                                     BLE_GAP_LE_PHY_2M_MASK | BLE_GAP_LE_PHY_1M_MASK,
+                                     BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) ESP_LOGD(TAG, "set_prefered_le_phy rc=%d", rc);
+#endif
+}
+
+/* ── Émission avec fenêtre ───────────────────────────────────────── */
+static bool hist_emit(const uint8_t *frame, size_t len, void *arg)
+{
+    hist_job_t *job = (hist_job_t *)arg;
+
+    /* Fenêtre pleine : attendre un ACK du client */
+    for (;;) {
+        portENTER_CRITICAL(&s_mux);
+        uint32_t ack = s_ack;
+        portEXIT_CRITICAL(&s_mux);
+        bmu_ble_xfer_tx_ack(&job->tx, ack);
+        if (s_abort) {
+            job->err = BMU_BLE_XFER_ERR_ABORTED;
+            return false;
+        }
+        if (bmu_ble_xfer_tx_inflight(&job->tx) < job->tx.window) break;
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HIST_ACK_TIMEOUT_MS)) == 0) {
+            job->err = BMU_BLE_XFER_ERR_TIMEOUT;
+            return false;
+        }
+    }
+
+    /* Pool mbuf épuisé : la radio vide la file, on réessaie */
+    for (int attempt = 0; attempt < 100 && !s_abort; attempt++) {
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(frame, len);
+        int rc = om ? ble_gatts_notify_custom(job->conn, s_data_val_handle, om) : BLE_HS_ENOMEM;
+        if (rc == 0) return true;
+        if (rc != BLE_HS_ENOMEM) break;
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    job->err = s_abort ? BMU_BLE_XFER_ERR_ABORTED : BMU_BLE_XFER_ERR_IO;
+    return false;
+}
+
+/* ── Sources ─────────────────────────────────────────────────────── */
+static bool sd_row_cb(const char *row, size_t len, void *arg)
+{
+    hist_job_t *job = (hist_job_t *)arg;
+    if (job->format == BMU_BLE_XFER_FMT_BIN) {
+        uint8_t bin[BMU_BLE_XFER_ROW_LEN];
+        if (!bmu_ble_xfer_pack_row(row, len, bin)) return true;   /* ligne ignorée */
+        return bmu_ble_xfer_tx_write(&job->tx, bin, sizeof(bin), hist_emit, job);
+    }
+    return bmu_ble_xfer_tx_write(&job->tx, row, len, hist_emit, job) &&
+           bmu_ble_xfer_tx_write(&job->tx, "\n", 1, hist_emit, job);
+}
+
+static bool stream_sd_log(hist_job_t *job, const bmu_ble_xfer_cmd_t *cmd)
+{
+    bmu_sd_query_t q = { cmd->from_ms, cmd->to_ms, cmd->key, cmd->step_s };
+    esp_err_t ret = bmu_sd_log_query(&q, sd_row_cb, job, NULL);
+    if (ret != ESP_OK && job->err == 0) {
+        job->err = ret == ESP_ERR_INVALID_ARG ? BMU_BLE_XFER_ERR_ARG : BMU_BLE_XFER_ERR_NOT_FOUND;
+    }
+    return job->err == 0;
+}
+
+/* Segments colonnaires bruts, chacun précédé de u32 seq | u32 taille :
+ * l'application les décode comme le replay (bmu_influx_columnar.h).
+ * Segments épinglés par l'appelant : le replay ne les supprime pas. */
+static bool stream_influx(hist_job_t *job, uint32_t first, uint32_t end)
+{
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(HIST_IO_BUF, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (buf == NULL) buf = (uint8_t *)malloc(HIST_IO_BUF);
+    if (buf == NULL) {
+        job->err = BMU_BLE_XFER_ERR_IO;
+        return false;
+    }
+    for (uint32_t seq = first; seq < end && job->err == 0; seq++) {
+        char path[48];
+        bmu_influx_store_seg_path(seq, path, sizeof(path));
+        FILE *f = fopen(path, "rb");
+        if (f == NULL) continue;                /* trou dans la numérotation */
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+
+        uint8_t hdr[8];
+        for (int b = 0; b < 4; b++) {
+            hdr[b]     = (uint8_t)(seq >> (8 * b));
+            hdr[4 + b] = (uint8_t)((uint32_t)size >> (8 * b));
+        }
+        bool ok = bmu_ble_xfer_tx_write(&job->tx, hdr, sizeof(hdr), hist_emit, job);
+        long left = size;
+        while (ok && left > 0) {
+            size_t n = fread(buf, 1, left < HIST_IO_BUF ? (size_t)left : HIST_IO_BUF, f);
+            if (n == 0) {
+                job->err = BMU_BLE_XFER_ERR_IO;
+                break;
+            }
+            left -= (long)n;
+            ok = bmu_ble_xfer_tx_write(&job->tx, buf, n, hist_emit, job);
+        }
+        fclose(f);
+    }
+    free(buf);
+    return job->err == 0;
+}
+
+/* ── Tâche transfert ─────────────────────────────────────────────── */
+static void run_job(const hist_req_t *req)
+{
+    hist_job_t *job = s_job;
+    const bmu_ble_xfer_cmd_t *cmd = &req->cmd;
+    uint16_t mtu = ble_att_mtu(req->conn);
+    if (mtu < 3 + BMU_BLE_XFER_HDR_LEN + BMU_BLE_XFER_ROW_LEN ||
+        cmd->source > BMU_BLE_XFER_SRC_INFLUX || cmd->format > BMU_BLE_XFER_FMT_BIN) {
+        send_status(req->conn, BMU_BLE_XFER_ST_ERROR, BMU_BLE_XFER_ERR_ARG, 0);
+        return;
+    }
+
+    uint16_t window = cmd->window ? cmd->window : CONFIG_BMU_BLE_HISTORY_WINDOW;
+    if (window > CONFIG_BMU_BLE_HISTORY_WINDOW) window = CONFIG_BMU_BLE_HISTORY_WINDOW;
+    job->conn = req->conn;
+    job->format = cmd->format;
+    job->err = 0;
+    /* Trames alignées sur les PDU LL de 251 o demandés par link_fast */
+    bmu_ble_xfer_tx_open(&job->tx, cmd->offset, bmu_ble_xfer_frame_cap((size_t)mtu - 3, 251),
+                         window);
+
+    portENTER_CRITICAL(&s_mux);
+    s_ack = cmd->offset;
+    portEXIT_CRITICAL(&s_mux);
+    ulTaskNotifyTake(pdTRUE, 0);                /* ACK d'un transfert précédent */
+
+    link_fast(req->conn, true);
+    send_status(req->conn, BMU_BLE_XFER_ST_OPENED, job->tx.payload, job->tx.window);
+    int64_t t0 = esp_timer_get_time();
+
+    bool ok;
+    if (cmd->source == BMU_BLE_XFER_SRC_SD_LOG) {
+        ok = stream_sd_log(job, cmd);
+        if (ok) ok = bmu_ble_xfer_tx_finish(&job->tx, hist_emit, job);
+    } else {
+        /* Épinglé jusqu'à la fin ; retenu si interrompu, pour que la
+         * reprise à cmd->offset relise le même flux */
+        uint32_t first, end;
+        ok = bmu_influx_store_pin(&first, &end);
+        if (!ok) {
+            job->err = BMU_BLE_XFER_ERR_NOT_FOUND;
+        } else {
+            ok = stream_influx(job, first, end);
+            if (ok) ok = bmu_ble_xfer_tx_finish(&job->tx, hist_emit, job);
+            bmu_influx_store_unpin(!ok);
+        }
+    }
+
+    if (ok) {
+        send_status(req->conn, BMU_BLE_XFER_ST_DONE, job->tx.pos, job->tx.crc);
+        int64_t dt_ms = (esp_timer_get_time() - t0) / 1000;
+        ESP_LOGI(TAG, "Transfert source %u : %lu octets en %lld ms (%lu o/s, MTU %u)",
+                 cmd->source, (unsigned long)(job->tx.sent - cmd->offset), (long long)dt_ms,
+                 (unsigned long)(dt_ms > 0 ? (job->tx.sent - cmd->offset) * 1000ULL / dt_ms : 0),
+                 mtu);
+    } else {
+        if (job->err == 0) job->err = BMU_BLE_XFER_ERR_IO;
+        send_status(req->conn, BMU_BLE_XFER_ST_ERROR, job->err, job->tx.sent);
+        ESP_LOGW(TAG, "Transfert interrompu err=%u à %lu", job->err, (unsigned long)job->tx.sent);
+    }
+    if (job->err != BMU_BLE_XFER_ERR_ABORTED) link_fast(req->conn, false);
+}
+
+static void hist_task(void *pv)
+{
+    (void)pv;
+    hist_req_t req;
+    for (;;) {
+        if (xQueueReceive(s_req_q, &req, portMAX_DELAY) != pdTRUE) continue;
+        s_abort = false;
+        s_active_conn = req.conn;
+        run_job(&req);
+        s_active_conn = BLE_HS_CONN_HANDLE_NONE;
+    }
+}
+
+/* ── Callback accès GATT (contrôle) ──────────────────────────────── */
+static int hist_ctrl_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                               struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)attr_handle; (void)arg;
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) return BLE_ATT_ERR_UNLIKELY;
+
+    uint8_t buf[BMU_BLE_XFER_OPEN_LEN];
+    uint16_t len = 0;
+    if (OS_MBUF_PKTLEN(ctxt->om) > sizeof(buf) ||
+        ble_hs_mbuf_to_flat(ctxt->om, buf, sizeof(buf), &len) != 0) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    hist_req_t req;
+    req.conn = conn_handle;
+    if (!bmu_ble_xfer_parse_cmd(buf, len, &req.cmd)) return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+
+    switch (req.cmd.op) {
+    case BMU_BLE_XFER_OP_OPEN:
+        if (s_task == NULL || s_active_conn != BLE_HS_CONN_HANDLE_NONE ||
+            xQueueSend(s_req_q, &req, 0) != pdTRUE) {
+            send_status(conn_handle, BMU_BLE_XFER_ST_ERROR, BMU_BLE_XFER_ERR_BUSY, 0);
+        }
+        return 0;
+    case BMU_BLE_XFER_OP_ACK:
+        if (conn_handle != s_active_conn) return 0;
+        portENTER_CRITICAL(&s_mux);
+        if (req.cmd.offset > s_ack) s_ack = req.cmd.offset;
+        portEXIT_CRITICAL(&s_mux);
+        xTaskNotifyGive(s_task);
+        return 0;
+    default:                                    /* ABORT */
+        if (conn_handle == s_active_conn) {
+            s_abort = true;
+            xTaskNotifyGive(s_task);
+        }
+        return 0;
+    }
+}
+
+static int hist_data_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                               struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    (void)conn_handle; (void)attr_handle; (void)ctxt; (void)arg;
+    return BLE_ATT_ERR_READ_NOT_PERMITTED;      /* NOTIFY seul */
+}
+
+void bmu_ble_history_on_disconnect(uint16_t conn_handle)
+{
+    if (s_task != NULL && conn_handle == s_active_conn) {
+        s_abort = true;
+        xTaskNotifyGive(s_task);
+    }
+}
+
+/* ── Definition du service GATT History ──────────────────────────── */
+static const struct ble_gatt_chr_def s_hist_chr_defs[] = {
+    {
+        .uuid       = &s_hist_ctrl_uuid.u,
+        .access_cb  = hist_ctrl_access_cb,
+        .arg        = NULL,
+        .descriptors = nullptr,
+        .flags      = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_NOTIFY,
+        .min_key_size = 0,
+        .val_handle = &s_ctrl_val_handle,
+        .cpfd = nullptr,
+    },
+    {
+        .uuid       = &s_hist_data_uuid.u,
+        .access_cb  = hist_data_access_cb,
+        .arg        = NULL,
+        .descriptors = nullptr,
+        .flags      = BLE_GATT_CHR_F_NOTIFY,
+        .min_key_size = 0,
+        .val_handle = &s_data_val_handle,
+        .cpfd = nullptr,
+    },
+    {}, /* Terminateur */
+};
+
+static const struct ble_gatt_svc_def s_hist_svc[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = &s_hist_svc_uuid.u,
+        .includes = nullptr,
+        .characteristics = s_hist_chr_defs,
+    },
+    {},
+};
+
+const struct ble_gatt_svc_def *bmu_ble_history_svc_defs(void)
+{
+    if (s_task == NULL) {
+        s_job = (hist_job_t *)heap_caps_calloc(1, sizeof(hist_job_t),
+                                               MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (s_job == NULL) s_job = (hist_job_t *)calloc(1, sizeof(hist_job_t));
+        s_req_q = xQueueCreate(1, sizeof(hist_req_t));
+        if (s_job == NULL || s_req_q == NULL ||
+            xTaskCreate(hist_task, "ble_hist", 4096, NULL, 2, &s_task) != pdPASS) {
+            ESP_LOGE(TAG, "Init service historique échouée");
+            s_task = NULL;
+        }
+    }
+    return s_hist_svc;
+}
+
+#endif /* CONFIG_BMU_BLE_ENABLED && CONFIG_BMU_BLE_HISTORY_ENABLED */
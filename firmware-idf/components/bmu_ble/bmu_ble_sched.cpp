@@ -0,0 +1,111 @@
+/**
+ * bmu_ble_sched — Ordonnanceur des notifications BLE (voir bmu_ble_sched.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_ble_sched).
+ */
+
+#include "bmu_ble_sched.h"
+
+#include <cstring>
+
+static uint32_t sum_itvl(const uint16_t *itvl_1m25, int n)
+{
+    uint32_t sum = 0;
+    for (int k = 0; k < n; k++) sum += itvl_1m25[k];
+    return sum;
+}
+
+/* Temps radio (ms) des événements de connexion qu'occupent `sent` notifications */
+static int32_t cost_ms(int sent, uint32_t sum_1m25)
+{
+    if (sent <= 0 || sum_1m25 == 0) return 0;
+    uint32_t events = (uint32_t)(sent + BMU_BLE_PKTS_PER_EVENT - 1) / BMU_BLE_PKTS_PER_EVENT;
+    uint32_t ms = (events * sum_1m25 * 5 + 3) / 4;
+    return ms > 2u * BMU_BLE_SCHED_WINDOW_MS ? 2 * BMU_BLE_SCHED_WINDOW_MS : (int32_t)ms;
+}
+
+static int32_t clamp_credit(int32_t c)
+{
+    if (c > BMU_BLE_SCHED_WINDOW_MS) return BMU_BLE_SCHED_WINDOW_MS;
+    if (c < -BMU_BLE_SCHED_WINDOW_MS) return -BMU_BLE_SCHED_WINDOW_MS;
+    return c;
+}
+
+void bmu_ble_sched_init(bmu_ble_sched_t *s, uint32_t tol_ms)
+{
+    memset(s, 0, sizeof(*s));
+    s->tol_ms = tol_ms;
+    s->credit_ms = BMU_BLE_SCHED_WINDOW_MS;
+}
+
+int bmu_ble_sched_add(bmu_ble_sched_t *s, const char *name,
+                      uint32_t min_ms, uint32_t max_ms,
+                      bmu_ble_sched_fn_t fn, void *arg)
+{
+    if (s->n >= BMU_BLE_SCHED_MAX_SRC || fn == nullptr) return -1;
+    if (max_ms < min_ms) max_ms = min_ms;
+    bmu_ble_sched_src_t *src = &s->src[s->n];
+    memset(src, 0, sizeof(*src));
+    src->name = name;
+    src->fn = fn;
+    src->arg = arg;
+    src->min_ms = min_ms;
+    src->max_ms = max_ms;
+    src->period_ms = min_ms;
+    return s->n++;
+}
+
+void bmu_ble_sched_reset(bmu_ble_sched_t *s, uint32_t now_ms)
+{
+    for (uint8_t k = 0; k < s->n; k++) {
+        bmu_ble_sched_src_t *src = &s->src[k];
+        src->period_ms = src->min_ms;
+        src->last_ms = now_ms - src->max_ms;
+    }
+    s->last_run_ms = now_ms;
+    s->credit_ms = BMU_BLE_SCHED_WINDOW_MS;
+}
+
+int bmu_ble_sched_budget(int32_t credit_ms, const uint16_t *itvl_1m25, int n)
+{
+    uint32_t sum = sum_itvl(itvl_1m25, n);
+    if (sum == 0) return BMU_BLE_SCHED_UNLIMITED;
+    if (credit_ms <= 0) return 0;
+    uint32_t events = ((uint32_t)credit_ms * 4) / (sum * 5);
+    uint32_t budget = events * BMU_BLE_PKTS_PER_EVENT;
+    return budget > BMU_BLE_SCHED_UNLIMITED ? BMU_BLE_SCHED_UNLIMITED : (int)budget;
+}
+
+int bmu_ble_sched_run(bmu_ble_sched_t *s, uint32_t now_ms,
+                      const uint16_t *itvl_1m25, int n)
+{
+    uint32_t sum = sum_itvl(itvl_1m25, n);
+    uint32_t elapsed = now_ms - s->last_run_ms;
+    if (elapsed > BMU_BLE_SCHED_WINDOW_MS) elapsed = BMU_BLE_SCHED_WINDOW_MS;
+    s->credit_ms = clamp_credit(s->credit_ms + (int32_t)elapsed);
+    s->last_run_ms = now_ms;
+
+    int total = 0;
+    for (uint8_t k = 0; k < s->n; k++) {
+        bmu_ble_sched_src_t *src = &s->src[k];
+        uint32_t since = now_ms - src->last_ms;
+        if (since + s->tol_ms < src->period_ms) continue;
+
+        int budget = bmu_ble_sched_budget(s->credit_ms, itvl_1m25, n);
+        if (budget <= 0 && since < src->max_ms) {
+            src->deferred++;
+            continue;
+        }
+
+        int sent = src->fn(now_ms, budget, src->arg);
+        if (sent < 0) sent = 0;
+        src->last_ms = now_ms;
+        src->runs++;
+        src->sent += (uint32_t)sent;
+        s->credit_ms = clamp_credit(s->credit_ms - cost_ms(sent, sum));
+        src->period_ms = bmu_ble_notify_period_ms(itvl_1m25, n, sent,
+                                                  src->min_ms, src->max_ms);
+        total += sent;
+    }
+    return total;
+}
@@ -25,8 +25,6 @@
 
 #include <cstring>
 
-static const char *TAG = "BLE_SYS";
-
 /* ── Structs packed pour topologie et solar ───────────────────────── */
 typedef struct __attribute__((packed)) {
     uint8_t nb_ina;
@@ -45,10 +43,26 @@ typedef struct __attribute__((packed)) {
     uint8_t  valid;
 } ble_solar_char_t;
 
+/* Modele agrege de tous les chargeurs VE.Direct */
+static void fill_solar(ble_solar_char_t *solar)
+{
+    bmu_vedirect_solar_t agg;
+    memset(solar, 0, sizeof(*solar));
+    if (!bmu_vedirect_get_solar(&agg)) return;
+    const bmu_vedirect_data_t *vd = &agg.total;
+    solar->battery_voltage_mv = (int16_t)(vd->battery_voltage_v * 1000.0f);
+    solar->battery_current_ma = (int16_t)(vd->battery_current_a * 1000.0f);
+    solar->panel_voltage_mv   = (uint16_t)(vd->panel_voltage_v * 1000.0f);
+    solar->panel_power_w      = vd->panel_power_w;
+    solar->charge_state       = vd->charge_state;
+    solar->error_code         = vd->error_code;
+    solar->yield_today_wh     = vd->yield_today_wh;
+    solar->valid              = 1;
+}
+
 /* ── Value handles pour les notifications ────────────────────────── */
 static uint16_t s_heap_val_handle   = 0;
 static uint16_t s_solar_val_handle  = 0;
-static esp_timer_handle_t s_notify_timer = NULL;
 
 /* ── UUIDs ────────────────────────────────────────────────────────── */
 static ble_uuid128_t s_sys_svc_uuid       = BMU_BLE_UUID128_DECLARE(0x02, 0x00);
@@ -131,21 +145,8 @@ static int system_chr_access_cb(uint16_t conn_handle, uint16_t attr_handle,
         break;
     }
     case SYS_CHR_SOLAR: {
-        const bmu_vedirect_data_t *vd = bmu_vedirect_get_data();
         ble_solar_char_t solar;
-        if (vd && bmu_vedirect_is_connected()) {
-            solar.battery_voltage_mv = (int16_t)(vd->battery_voltage_v * 1000.0f);
-            solar.battery_current_ma = (int16_t)(vd->battery_current_a * 1000.0f);
-            solar.panel_voltage_mv   = (uint16_t)(vd->panel_voltage_v * 1000.0f);
-            solar.panel_power_w      = vd->panel_power_w;
-            solar.charge_state       = vd->charge_state;
-            solar.error_code         = vd->error_code;
-            solar.yield_today_wh     = vd->yield_today_wh;
-            solar.valid              = 1;
-        } else {
-            memset(&solar, 0, sizeof(solar));
-            solar.valid = 0;
-        }
+        fill_solar(&solar);
         rc = os_mbuf_append(ctxt->om, &solar, sizeof(solar));
         break;
     }
@@ -173,56 +174,33 @@ static int system_chr_access_cb(uint16_t conn_handle, uint16_t attr_handle,
     return (rc == 0) ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
 }
 
-/* ── Timer notification 10s (heap + solar) ───────────────────────── */
-static void sys_notify_timer_cb(void *arg)
+/* ── Notification 10s (heap + solar), ordonnanceur BLE ─────────── */
+int bmu_ble_system_notify_tick(uint32_t now_ms, int budget, void *arg)
 {
+    (void)now_ms; (void)budget; (void)arg;
+    int sent = 0;
+
     /* Notify Heap */
     if (s_heap_val_handle != 0) {
         uint32_t heap = (uint32_t)esp_get_free_heap_size();
         struct os_mbuf *om = ble_hs_mbuf_from_flat(&heap, sizeof(heap));
         if (om) {
             ble_gatts_notify_custom(0xFFFF, s_heap_val_handle, om);
+            sent++;
         }
     }
 
     /* Notify Solar */
     if (s_solar_val_handle != 0) {
-        const bmu_vedirect_data_t *vd = bmu_vedirect_get_data();
         ble_solar_char_t solar;
-        if (vd && bmu_vedirect_is_connected()) {
-            solar.battery_voltage_mv = (int16_t)(vd->battery_voltage_v * 1000.0f);
-            solar.battery_current_ma = (int16_t)(vd->battery_current_a * 1000.0f);
-            solar.panel_voltage_mv   = (uint16_t)(vd->panel_voltage_v * 1000.0f);
-            solar.panel_power_w      = vd->panel_power_w;
-            solar.charge_state       = vd->charge_state;
-            solar.error_code         = vd->error_code;
-            solar.yield_today_wh     = vd->yield_today_wh;
-            solar.valid              = 1;
-        } else {
-            memset(&solar, 0, sizeof(solar));
-            solar.valid = 0;
-        }
+        fill_solar(&solar);
         struct os_mbuf *om = ble_hs_mbuf_from_flat(&solar, sizeof(solar));
         if (om) {
             ble_gatts_notify_custom(0xFFFF, s_solar_val_handle, om);
+            sent++;
         }
     }
-}
-
-void bmu_ble_system_notify_start(void)
-{
-    if (s_notify_timer) {
-        esp_timer_start_periodic(s_notify_timer, 10000000); /* 10s */
-        ESP_LOGI(TAG, "System notify timer demarre (10s)");
-    }
-}
-
-void bmu_ble_system_notify_stop(void)
-{
-    if (s_notify_timer) {
-        esp_timer_stop(s_notify_timer);
-        ESP_LOGI(TAG, "System notify timer arrete");
-    }
+    return sent;
 }
 
 /* ── Definition du service GATT System ───────────────────────────── */
@@ -307,24 +285,8 @@ static struct ble_gatt_svc_def s_sys_svc[] = {
     {},
 };
 
-static bool s_inited = false;
-
 const struct ble_gatt_svc_def *bmu_ble_system_svc_defs(void)
 {
-    if (!s_inited) {
-        const esp_timer_create_args_t timer_args = {
-            .callback = sys_notify_timer_cb,
-            .arg = NULL,
-            .dispatch_method = ESP_TIMER_TASK,
-            .name = "ble_sys_notify",
-            .skip_unhandled_events = true,
-        };
-        if (esp_timer_create(&timer_args, &s_notify_timer) != ESP_OK) {
-            ESP_LOGE(TAG, "esp_timer_create (sys notify) échec");
-            s_notify_timer = NULL;
-        }
-        s_inited = true;
-    }
     return s_sys_svc;
 }
 
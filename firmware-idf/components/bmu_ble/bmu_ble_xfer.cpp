@@ -0,0 +1,234 @@
+/**
+ * bmu_ble_xfer — Téléchargement d'historique BLE (voir bmu_ble_xfer.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_ble_xfer). CRC-32 IEEE
+ * partagé avec le store Influx (bmu_gzip_crc32).
+ */
+
+#include "bmu_ble_xfer.h"
+#include "bmu_influx_gzip.h"
+
+#include <cstring>
+
+static inline uint8_t *put(uint8_t *p, uint64_t v, uint8_t len)
+{
+    for (uint8_t b = 0; b < len; b++) p[b] = (uint8_t)(v >> (8 * b));
+    return p + len;
+}
+
+static inline uint64_t get(const uint8_t *p, uint8_t len)
+{
+    uint64_t v = 0;
+    for (uint8_t b = 0; b < len; b++) v |= (uint64_t)p[b] << (8 * b);
+    return v;
+}
+
+/* ── Commandes et états ──────────────────────────────────────────── */
+
+bool bmu_ble_xfer_parse_cmd(const uint8_t *p, size_t len, bmu_ble_xfer_cmd_t *out)
+{
+    if (len < 1) return false;
+    memset(out, 0, sizeof(*out));
+    out->op = p[0];
+    switch (p[0]) {
+    case BMU_BLE_XFER_OP_OPEN:
+        if (len != BMU_BLE_XFER_OPEN_LEN) return false;
+        out->source  = p[1];
+        out->format  = p[2];
+        out->key     = p[3];
+        out->step_s  = (uint32_t)get(p + 4, 4);
+        out->offset  = (uint32_t)get(p + 8, 4);
+        out->from_ms = (int64_t)get(p + 12, 8);
+        out->to_ms   = (int64_t)get(p + 20, 8);
+        out->window  = (uint16_t)get(p + 28, 2);
+        return true;
+    case BMU_BLE_XFER_OP_ACK:
+        if (len != 5) return false;
+        out->offset = (uint32_t)get(p + 1, 4);
+        return true;
+    case BMU_BLE_XFER_OP_ABORT:
+        return len == 1;
+    default:
+        return false;
+    }
+}
+
+size_t bmu_ble_xfer_encode_cmd(const bmu_ble_xfer_cmd_t *cmd, uint8_t *out)
+{
+    uint8_t *p = out;
+    *p++ = cmd->op;
+    if (cmd->op == BMU_BLE_XFER_OP_OPEN) {
+        *p++ = cmd->source;
+        *p++ = cmd->format;
+        *p++ = cmd->key;
+        p = put(p, cmd->step_s, 4);
+        p = put(p, cmd->offset, 4);
+        p = put(p, (uint64_t)cmd->from_ms, 8);
+        p = put(p, (uint64_t)cmd->to_ms, 8);
+        p = put(p, cmd->window, 2);
+    } else if (cmd->op == BMU_BLE_XFER_OP_ACK) {
+        p = put(p, cmd->offset, 4);
+    }
+    return (size_t)(p - out);
+}
+
+size_t bmu_ble_xfer_encode_status(uint8_t op, uint32_t a, uint32_t b, uint8_t *out)
+{
+    out[0] = op;
+    put(out + 1, a, 4);
+    put(out + 5, b, 4);
+    return BMU_BLE_XFER_STATUS_LEN;
+}
+
+/* ── Ligne BIN ───────────────────────────────────────────────────── */
+
+/* Entier décimal signé en tête de [*p, end), suivi de ',' ou de la fin */
+static bool next_int(const char **p, const char *end, int64_t *v)
+{
+    const char *s = *p;
+    bool neg = s < end && *s == '-';
+    if (neg) s++;
+    int64_t x = 0;
+    const char *d = s;
+    while (s < end && *s >= '0' && *s <= '9' && s - d < 19) x = x * 10 + (*s++ - '0');
+    if (s == d || (s < end && *s != ',')) return false;
+    *v = neg ? -x : x;
+    *p = s < end ? s + 1 : s;
+    return true;
+}
+
+bool bmu_ble_xfer_pack_row(const char *row, size_t len, uint8_t out[BMU_BLE_XFER_ROW_LEN])
+{
+    /* utc_ms,uptime_ms,bat,mv,ma,state,switches,health */
+    int64_t c[8];
+    const char *p = row, *end = row + len;
+    for (int k = 0; k < 8; k++) {
+        if (!next_int(&p, end, &c[k])) return false;
+    }
+    if (c[0] <= 0) return false;
+
+    uint8_t *o = put(out, (uint64_t)(c[0] / 1000), 4);
+    *o++ = (uint8_t)c[2];
+    *o++ = (uint8_t)c[5];
+    o = put(o, (uint64_t)(c[3] < 0 ? 0 : c[3] > UINT16_MAX ? UINT16_MAX : c[3]), 2);
+    o = put(o, (uint64_t)(int64_t)(int32_t)c[4], 4);
+    *o++ = (uint8_t)(c[6] > 255 ? 255 : c[6]);
+    *o++ = (uint8_t)c[7];
+    return true;
+}
+
+/* ── Dimensionnement ─────────────────────────────────────────────── */
+
+size_t bmu_ble_xfer_frame_cap(size_t att_cap, uint16_t ll_octets)
+{
+    if (att_cap > BMU_BLE_XFER_FRAME_MAX) att_cap = BMU_BLE_XFER_FRAME_MAX;
+    size_t sdu = att_cap + 7;
+    if (ll_octets == 0 || sdu < ll_octets) return att_cap;
+    size_t aligned = sdu / ll_octets * ll_octets - 7;
+    /* Pas d'alignement si la trame perd plus qu'un PDU n'en économise */
+    return aligned >= BMU_BLE_XFER_HDR_LEN + BMU_BLE_XFER_ROW_LEN ? aligned : att_cap;
+}
+
+/* ── Émetteur ────────────────────────────────────────────────────── */
+
+void bmu_ble_xfer_tx_open(bmu_ble_xfer_tx_t *tx, uint32_t resume, size_t frame_cap,
+                          uint16_t window)
+{
+    memset(tx, 0, sizeof(*tx));
+    if (frame_cap > BMU_BLE_XFER_FRAME_MAX) frame_cap = BMU_BLE_XFER_FRAME_MAX;
+    tx->payload = (uint16_t)(frame_cap - BMU_BLE_XFER_HDR_LEN);
+    tx->window  = window < 1 ? 1 : window > BMU_BLE_XFER_WINDOW_MAX ? BMU_BLE_XFER_WINDOW_MAX : window;
+    tx->resume  = resume;
+    tx->sent    = resume;
+    tx->acked   = resume;
+}
+
+static bool emit_frame(bmu_ble_xfer_tx_t *tx, uint8_t flags,
+                       bmu_ble_xfer_emit_fn_t emit, void *arg)
+{
+    put(tx->frame, tx->sent, 4);
+    tx->frame[4] = flags;
+    if (!emit(tx->frame, BMU_BLE_XFER_HDR_LEN + tx->fill, arg)) return false;
+    tx->sent += tx->fill;
+    tx->fill = 0;
+    return true;
+}
+
+bool bmu_ble_xfer_tx_write(bmu_ble_xfer_tx_t *tx, const void *data, size_t len,
+                           bmu_ble_xfer_emit_fn_t emit, void *arg)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    tx->crc = bmu_gzip_crc32(tx->crc, p, len);
+
+    /* Octets déjà reçus par le client : comptés, pas émis */
+    if (tx->pos < tx->resume) {
+        size_t skip = tx->resume - tx->pos;
+        if (skip > len) skip = len;
+        tx->pos += (uint32_t)skip;
+        p += skip;
+        len -= skip;
+    }
+    tx->pos += (uint32_t)len;
+
+    while (len > 0) {
+        size_t n = tx->payload - tx->fill;
+        if (n > len) n = len;
+        memcpy(tx->frame + BMU_BLE_XFER_HDR_LEN + tx->fill, p, n);
+        tx->fill += (uint16_t)n;
+        p += n;
+        len -= n;
+        if (tx->fill == tx->payload && !emit_frame(tx, 0, emit, arg)) return false;
+    }
+    return true;
+}
+
+bool bmu_ble_xfer_tx_finish(bmu_ble_xfer_tx_t *tx, bmu_ble_xfer_emit_fn_t emit, void *arg)
+{
+    return emit_frame(tx, BMU_BLE_XFER_F_END, emit, arg);
+}
+
+void bmu_ble_xfer_tx_ack(bmu_ble_xfer_tx_t *tx, uint32_t offset)
+{
+    if (offset > tx->acked && offset <= tx->sent) tx->acked = offset;
+}
+
+uint16_t bmu_ble_xfer_tx_inflight(const bmu_ble_xfer_tx_t *tx)
+{
+    uint32_t bytes = tx->sent - tx->acked;
+    return (uint16_t)((bytes + tx->payload - 1) / tx->payload);
+}
+
+/* ── Récepteur ───────────────────────────────────────────────────── */
+
+void bmu_ble_xfer_rx_init(bmu_ble_xfer_rx_t *rx, uint32_t resume, uint32_t crc,
+                          uint16_t window)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->next = resume;
+    rx->crc = crc;
+    rx->ack_every = window / 2 ? window / 2 : 1;
+}
+
+bool bmu_ble_xfer_rx_feed(bmu_ble_xfer_rx_t *rx, const uint8_t *frame, size_t len,
+                          const uint8_t **data, size_t *data_len)
+{
+    *data = NULL;
+    *data_len = 0;
+    if (len < BMU_BLE_XFER_HDR_LEN || rx->done) return false;
+    uint32_t off = (uint32_t)get(frame, 4);
+    if (off != rx->next) {
+        rx->gap = off > rx->next;       /* doublon (off < next) : ignoré */
+        return false;
+    }
+    *data = frame + BMU_BLE_XFER_HDR_LEN;
+    *data_len = len - BMU_BLE_XFER_HDR_LEN;
+    rx->crc = bmu_gzip_crc32(rx->crc, *data, *data_len);
+    rx->next += (uint32_t)*data_len;
+    rx->done = (frame[4] & BMU_BLE_XFER_F_END) != 0;
+
+    if (rx->done || ++rx->since_ack >= rx->ack_every) {
+        rx->since_ack = 0;
+        return true;
+    }
+    return false;
+}
@@ -29,6 +29,13 @@ esp_err_t bmu_ble_init(bmu_protection_ctx_t *prot,
                         bmu_battery_manager_t *mgr,
                         uint8_t nb_ina);
 
+/**
+ * @brief File des snapshots protection (s_q_ble) : les notifications batterie
+ *        et flotte en sont construites, au rythme des cycles protection.
+ *        A appeler avant bmu_ble_init.
+ */
+void bmu_ble_set_snapshot_queue(QueueHandle_t q);
+
 /** @brief Met a jour le nombre de batteries apres le scan I2C. */
 void bmu_ble_set_nb_ina(uint8_t nb_ina);
 
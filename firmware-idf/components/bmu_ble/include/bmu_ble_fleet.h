@@ -0,0 +1,123 @@
+/**
+ * @file bmu_ble_fleet.h
+ * @brief Caractéristique BLE de flotte : toutes les batteries en trames MTU.
+ *
+ * Remplace, pour les clients qui s'y abonnent, les 32 notifications
+ * batterie (0x0010..0x002F) par une ou deux notifications par cycle. Seuls
+ * les champs qui ont bougé depuis la dernière trame acceptée par la pile
+ * (bande morte par champ) sont encodés ; une keyframe complète part au
+ * premier cycle, au changement du nombre de batteries, toutes les
+ * key_ms, ou sur demande du client (écriture sur la caractéristique).
+ * Little-endian, sans padding :
+ *
+ *   en-tête (5 o) :
+ *     0  u8  flags        bit0 = keyframe, bit1 = dernière trame du cycle
+ *     1  u16 seq          +1 par trame : un trou → le client écrit pour resync
+ *     3  u8  nb           batteries dans la flotte
+ *     4  u8  n_rec        enregistrements dans la trame
+ *
+ *   enregistrement (2 + 0..17 o) :
+ *     0  u8  id           0-indexé
+ *     1  u8  mask         champs présents, dans l'ordre des bits :
+ *        bit0 u16 v_mv    bit1 i32 i_ma       bit2 u8 state
+ *        bit3 u32 ah_d_mah                    bit4 u32 ah_c_mah
+ *        bit5 u8 nb_switch                    bit6 u8 bal (% ; 0xFF = phase OFF)
+ *
+ * Un enregistrement n'est jamais coupé : l'ATT MTU doit valoir au moins
+ * BMU_BLE_FLEET_MIN_MTU (en-tête + un enregistrement complet).
+ * Aucune dépendance ESP-IDF : testé sur host (test_ble_fleet).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_BLE_FLEET_MAX_BATT   32
+#define BMU_BLE_FLEET_HDR_LEN    5
+#define BMU_BLE_FLEET_REC_MAX    19
+#define BMU_BLE_FLEET_MIN_MTU    (3 + BMU_BLE_FLEET_HDR_LEN + BMU_BLE_FLEET_REC_MAX)
+
+#define BMU_BLE_FLEET_F_KEY      0x01
+#define BMU_BLE_FLEET_F_LAST     0x02
+
+#define BMU_BLE_FLEET_BAL_OFF    0xFF
+
+enum {
+    BMU_BLE_FLEET_V = 0,
+    BMU_BLE_FLEET_I,
+    BMU_BLE_FLEET_STATE,
+    BMU_BLE_FLEET_AH_D,
+    BMU_BLE_FLEET_AH_C,
+    BMU_BLE_FLEET_NBSW,
+    BMU_BLE_FLEET_BAL,
+    BMU_BLE_FLEET_NB_FIELDS
+};
+
+/** Valeurs entières d'une batterie, dans l'unité de la trame */
+typedef struct {
+    int32_t f[BMU_BLE_FLEET_NB_FIELDS];
+} bmu_ble_fleet_batt_t;
+
+typedef struct {
+    const int32_t *deadband;   /**< BMU_BLE_FLEET_NB_FIELDS bandes, 0 = tout changement */
+    uint32_t       key_ms;     /**< Période des keyframes, 0 = keyframe à chaque cycle */
+} bmu_ble_fleet_cfg_t;
+
+typedef struct {
+    const bmu_ble_fleet_cfg_t *cfg;
+    bmu_ble_fleet_batt_t last[BMU_BLE_FLEET_MAX_BATT];  /**< Dernières valeurs acceptées */
+    bmu_ble_fleet_batt_t cur[BMU_BLE_FLEET_MAX_BATT];   /**< Cycle en cours */
+    uint8_t  mask[BMU_BLE_FLEET_MAX_BATT];              /**< Champs à envoyer ce cycle */
+    uint8_t  nb;
+    uint8_t  next;            /**< Prochaine batterie à encoder */
+    uint16_t seq;
+    uint32_t key_last_ms;
+    bool     key;             /**< Cycle en cours = keyframe */
+    bool     resync;          /**< Keyframe au prochain cycle */
+} bmu_ble_fleet_t;
+
+void bmu_ble_fleet_init(bmu_ble_fleet_t *f, const bmu_ble_fleet_cfg_t *cfg);
+
+/** Keyframe au prochain cycle (nouvel abonné, demande client, envoi échoué) */
+void bmu_ble_fleet_resync(bmu_ble_fleet_t *f);
+
+/**
+ * @brief Démarre un cycle : compare cur[0..nb) aux dernières valeurs acceptées.
+ * @return nombre de batteries à envoyer, 0 = rien à notifier
+ */
+int bmu_ble_fleet_prepare(bmu_ble_fleet_t *f, const bmu_ble_fleet_batt_t *cur,
+                          uint8_t nb, uint32_t now_ms);
+
+/**
+ * @brief Encode la trame suivante du cycle dans out[cap] (cap = MTU - 3).
+ * @return octets écrits, 0 en fin de cycle ou si cap < en-tête + un enregistrement
+ */
+size_t bmu_ble_fleet_next(bmu_ble_fleet_t *f, uint8_t *out, size_t cap);
+
+/** Toutes les trames du cycle ont été acceptées : elles deviennent la référence */
+void bmu_ble_fleet_commit(bmu_ble_fleet_t *f);
+
+/* ── Cadence adaptée aux connexions ──────────────────────────────── */
+
+/** Notifications écoulées par événement de connexion (hypothèse prudente) */
+#define BMU_BLE_PKTS_PER_EVENT   4
+
+/**
+ * @brief Période de notification pour que chaque client écoule les `frames`
+ *        notifications d'un cycle : ceil(frames / BMU_BLE_PKTS_PER_EVENT)
+ *        événements de connexion par client, les connexions se partageant
+ *        la radio (somme des intervalles).
+ * @param itvl_1m25 Intervalles de connexion des clients (unités 1.25 ms)
+ * @return période bornée à [min_ms, max_ms] ; min_ms sans client
+ */
+uint32_t bmu_ble_notify_period_ms(const uint16_t *itvl_1m25, int n, int frames,
+                                  uint32_t min_ms, uint32_t max_ms);
+
+#ifdef __cplusplus
+}
+#endif
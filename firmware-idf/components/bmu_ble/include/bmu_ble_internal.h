@@ -6,6 +6,7 @@
  *        Ne pas inclure depuis l'exterieur du composant.
  */
 
+#include "sdkconfig.h"
 #include "bmu_protection.h"
 #include "bmu_battery_manager.h"
 #include "host/ble_gatt.h"
@@ -18,6 +19,12 @@ extern "C" {
 bmu_protection_ctx_t    *bmu_ble_get_prot(void);
 bmu_battery_manager_t   *bmu_ble_get_mgr(void);
 uint8_t                  bmu_ble_get_nb_ina(void);
+QueueHandle_t            bmu_ble_get_snapshot_queue(void);
+
+/** Intervalles de connexion (unites 1.25 ms) des clients connectes ; retourne n */
+int bmu_ble_get_conn_itvls(uint16_t *itvl_1m25, int max);
+/** Idem pour une liste de connexions (abonnes d'une caracteristique) */
+int bmu_ble_get_itvls_of(const uint16_t *conn, int n, uint16_t *itvl_1m25);
 
 /* ── UUID base personnalise KXKM-BMU ─────────────────────────────── */
 /* 4b584b4d-xxxx-4b4d-424d-55424c450000
@@ -37,14 +44,34 @@ uint8_t                  bmu_ble_get_nb_ina(void);
 const struct ble_gatt_svc_def *bmu_ble_battery_svc_defs(void);
 const struct ble_gatt_svc_def *bmu_ble_system_svc_defs(void);
 const struct ble_gatt_svc_def *bmu_ble_control_svc_defs(void);
+const struct ble_gatt_svc_def *bmu_ble_history_svc_defs(void);
+
+/** Snapshot protection du cycle en cours (tache de notification uniquement) */
+const bmu_snapshot_t    *bmu_ble_get_snapshot(void);
+
+/* ── Sources de l'ordonnanceur de notifications (bmu_ble_sched.h) ── */
+/* Batteries : cadence plancher = sa sous-cadence la plus rapide (flotte ou
+ * caractéristiques par batterie), plafond = celui des caractéristiques */
+#define BMU_BLE_BATT_PERIOD_MAX_MS  5000
+#if CONFIG_BMU_BLE_FLEET_ENABLED && CONFIG_BMU_BLE_FLEET_PERIOD_MS < 1000
+#define BMU_BLE_BATT_PERIOD_MS      CONFIG_BMU_BLE_FLEET_PERIOD_MS
+#else
+#define BMU_BLE_BATT_PERIOD_MS      1000
+#endif
 
-/* ── Timers de notification (demarrage/arret) ────────────────────── */
+int  bmu_ble_battery_notify_tick(uint32_t now_ms, int budget, void *arg);
+int  bmu_ble_system_notify_tick(uint32_t now_ms, int budget, void *arg);
+int  bmu_ble_wifi_notify_tick(uint32_t now_ms, int budget, void *arg);
+
+/* Batteries : RBE remis a zero au premier client, suspendu au dernier */
 void bmu_ble_battery_notify_start(void);
 void bmu_ble_battery_notify_stop(void);
-void bmu_ble_system_notify_start(void);
-void bmu_ble_system_notify_stop(void);
-void bmu_ble_wifi_notify_start(void);
-void bmu_ble_wifi_notify_stop(void);
+
+/* ── Abonnements (BLE_GAP_EVENT_SUBSCRIBE, tâche host) ───────────── */
+void bmu_ble_battery_on_subscribe(uint16_t conn_handle, uint16_t attr_handle, bool notify);
+
+/* ── Historique : transfert en cours interrompu par la déconnexion ── */
+void bmu_ble_history_on_disconnect(uint16_t conn_handle);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,92 @@
+/**
+ * @file bmu_ble_sched.h
+ * @brief Ordonnanceur unique des notifications BLE (tous services).
+ *
+ * Une seule tâche réveillée à chaque cycle protection sert toutes les
+ * sources de notification (batteries/flotte, SmartShunt Victron, système,
+ * WiFi) au lieu d'un timer par service. Les sources sont servies dans
+ * l'ordre d'enregistrement (= priorité) et partagent un crédit de temps
+ * radio :
+ *   - le crédit croît avec le temps écoulé, plafonné à BMU_BLE_SCHED_WINDOW_MS ;
+ *   - chaque notification consomme sa part d'événements de connexion
+ *     (BMU_BLE_PKTS_PER_EVENT par événement, intervalles des clients sommés,
+ *     même hypothèse que bmu_ble_notify_period_ms) ;
+ *   - une source due sans crédit est reportée au cycle suivant, sauf si son
+ *     dernier envoi date de plus de max_ms.
+ * Ainsi VictronConnect et l'application BMU connectés ensemble se partagent
+ * la radio au lieu d'empiler chacun leurs notifications.
+ *
+ * Cadence d'une source : bornée à [min_ms, max_ms], relevée après chaque
+ * envoi selon les intervalles de connexion et le nombre de notifications
+ * (bmu_ble_notify_period_ms). min_ms = max_ms = 0 : servie à chaque cycle
+ * sans jamais être reportée (hors budget) ; aucune source du firmware
+ * n'utilise ce mode, le crédit ne serait plus partagé.
+ *
+ * Aucune dépendance ESP-IDF : testé sur host (test_ble_sched).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bmu_ble_fleet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_BLE_SCHED_MAX_SRC     6
+#define BMU_BLE_SCHED_WINDOW_MS   1000   /**< Crédit max (rafale) et dette max */
+#define BMU_BLE_SCHED_UNLIMITED   0x7FFF /**< Budget sans client connecté */
+
+/**
+ * @brief Envoie les notifications dues d'une source.
+ * @param budget Notifications que la radio écoule encore ce cycle (indicatif)
+ * @return nombre de notifications émises
+ */
+typedef int (*bmu_ble_sched_fn_t)(uint32_t now_ms, int budget, void *arg);
+
+typedef struct {
+    const char        *name;
+    bmu_ble_sched_fn_t fn;
+    void              *arg;
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t period_ms;     /**< Cadence courante */
+    uint32_t last_ms;       /**< Dernier passage */
+    uint32_t runs;
+    uint32_t deferred;      /**< Cycles reportés faute de crédit */
+    uint32_t sent;
+} bmu_ble_sched_src_t;
+
+typedef struct {
+    bmu_ble_sched_src_t src[BMU_BLE_SCHED_MAX_SRC];
+    uint8_t  n;
+    uint32_t tol_ms;        /**< Tolérance d'échéance (demi-cycle) */
+    uint32_t last_run_ms;
+    int32_t  credit_ms;     /**< Temps radio disponible, < 0 = dette */
+} bmu_ble_sched_t;
+
+void bmu_ble_sched_init(bmu_ble_sched_t *s, uint32_t tol_ms);
+
+/** @return identifiant de la source, -1 si la table est pleine */
+int bmu_ble_sched_add(bmu_ble_sched_t *s, const char *name,
+                      uint32_t min_ms, uint32_t max_ms,
+                      bmu_ble_sched_fn_t fn, void *arg);
+
+/** Nouveau client : toutes les sources dues au prochain cycle, crédit plein */
+void bmu_ble_sched_reset(bmu_ble_sched_t *s, uint32_t now_ms);
+
+/** Notifications écoulées avec credit_ms de temps radio */
+int bmu_ble_sched_budget(int32_t credit_ms, const uint16_t *itvl_1m25, int n);
+
+/**
+ * @brief Un cycle : sert les sources dues dans l'ordre de priorité.
+ * @param itvl_1m25 Intervalles de connexion des clients (unités 1.25 ms)
+ * @return notifications émises
+ */
+int bmu_ble_sched_run(bmu_ble_sched_t *s, uint32_t now_ms,
+                      const uint16_t *itvl_1m25, int n);
+
+#ifdef __cplusplus
+}
+#endif
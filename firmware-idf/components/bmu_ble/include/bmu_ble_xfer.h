@@ -0,0 +1,171 @@
+/**
+ * @file bmu_ble_xfer.h
+ * @brief Téléchargement d'historique BLE : flux d'octets en trames MTU,
+ *        fenêtre glissante acquittée par le client, reprise à un offset.
+ *
+ * Service 0x0004, deux caractéristiques :
+ *   0x0040 contrôle (WRITE + NOTIFY) : commandes client, états BMU
+ *   0x0041 données  (NOTIFY)         : trames du flux
+ *
+ * Commandes (client → BMU), little-endian :
+ *   OPEN   01 | u8 source | u8 format | u8 key | u32 step_s | u32 resume
+ *              | i64 from_ms | i64 to_ms | u16 window               (30 o)
+ *   ACK    02 | u32 offset      octets reçus sans trou depuis le début
+ *   ABORT  03
+ *
+ * États (BMU → client, contrôle) : op | u32 a | u32 b
+ *   OPENED 81  a = octets utiles par trame, b = fenêtre accordée
+ *   DONE   82  a = taille totale du flux,   b = CRC-32 du flux entier
+ *   ERROR  83  a = BMU_BLE_XFER_ERR_*
+ *
+ * Trame de données : u32 offset | u8 flags (bit0 = fin) | données
+ *
+ * Le BMU n'a jamais plus de `window` trames non acquittées ; le client
+ * acquitte toutes les window / 2 trames. Reprise après coupure : OPEN avec
+ * les mêmes paramètres et resume = octets déjà reçus. Le flux est regénéré
+ * et les octets avant resume entrent dans le CRC sans être émis : une plage
+ * entièrement passée (to_ms < maintenant) redonne le même flux.
+ *
+ * Format BIN du journal : lignes de BMU_BLE_XFER_ROW_LEN octets
+ *   u32 utc_s | u8 bat | u8 state | u16 mv | i32 ma | u8 switches | u8 health
+ *
+ * Aucune dépendance ESP-IDF : testé sur host (test_ble_xfer).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_BLE_XFER_HDR_LEN       5
+#define BMU_BLE_XFER_FRAME_MAX     512    /**< Valeur d'attribut max (ATT) */
+#define BMU_BLE_XFER_OPEN_LEN      30
+#define BMU_BLE_XFER_STATUS_LEN    9
+#define BMU_BLE_XFER_ROW_LEN       14
+#define BMU_BLE_XFER_WINDOW_MAX    64
+
+#define BMU_BLE_XFER_F_END         0x01
+
+enum {
+    BMU_BLE_XFER_OP_OPEN   = 0x01,
+    BMU_BLE_XFER_OP_ACK    = 0x02,
+    BMU_BLE_XFER_OP_ABORT  = 0x03,
+    BMU_BLE_XFER_ST_OPENED = 0x81,
+    BMU_BLE_XFER_ST_DONE   = 0x82,
+    BMU_BLE_XFER_ST_ERROR  = 0x83,
+};
+
+enum {
+    BMU_BLE_XFER_SRC_SD_LOG = 0,    /**< Journal CSV de la carte SD (plage, clé, pas) */
+    BMU_BLE_XFER_SRC_INFLUX = 1,    /**< Segments colonnaires scellés du store offline */
+};
+
+enum {
+    BMU_BLE_XFER_FMT_CSV = 0,
+    BMU_BLE_XFER_FMT_BIN = 1,
+};
+
+enum {
+    BMU_BLE_XFER_ERR_ARG = 1,
+    BMU_BLE_XFER_ERR_NOT_FOUND,
+    BMU_BLE_XFER_ERR_BUSY,
+    BMU_BLE_XFER_ERR_IO,
+    BMU_BLE_XFER_ERR_TIMEOUT,
+    BMU_BLE_XFER_ERR_ABORTED,
+};
+
+typedef struct {
+    uint8_t  op;
+    uint8_t  source;
+    uint8_t  format;
+    uint8_t  key;        /**< Batterie (1..32), 0 = toutes */
+    uint32_t step_s;     /**< 0 = toutes les lignes */
+    uint32_t offset;     /**< OPEN : reprise ; ACK : octets reçus */
+    int64_t  from_ms;
+    int64_t  to_ms;
+    uint16_t window;
+} bmu_ble_xfer_cmd_t;
+
+/** @return false si longueur ou opcode invalide */
+bool   bmu_ble_xfer_parse_cmd(const uint8_t *p, size_t len, bmu_ble_xfer_cmd_t *out);
+size_t bmu_ble_xfer_encode_cmd(const bmu_ble_xfer_cmd_t *cmd, uint8_t *out);
+size_t bmu_ble_xfer_encode_status(uint8_t op, uint32_t a, uint32_t b, uint8_t *out);
+
+/** Ligne CSV du journal → ligne BIN ; false si colonnes manquantes ou heure invalide */
+bool bmu_ble_xfer_pack_row(const char *row, size_t len, uint8_t out[BMU_BLE_XFER_ROW_LEN]);
+
+/**
+ * @brief Taille de trame ≤ att_cap (MTU - 3) alignée sur les PDU de la couche
+ *        liaison : trame + 7 (en-têtes L2CAP et ATT) multiple de ll_octets,
+ *        sans PDU presque vide en fin de notification (509 o avec DLE 251 =
+ *        3 PDU, 495 o = 2 PDU pleins).
+ */
+size_t bmu_ble_xfer_frame_cap(size_t att_cap, uint16_t ll_octets);
+
+/* ── Émetteur (BMU) ──────────────────────────────────────────────── */
+
+/** Émet une trame complète ; false = abandon (coupure, ABORT, délai) */
+typedef bool (*bmu_ble_xfer_emit_fn_t)(const uint8_t *frame, size_t len, void *arg);
+
+typedef struct {
+    uint32_t pos;        /**< Octets produits depuis le début du flux */
+    uint32_t resume;     /**< Premier octet émis */
+    uint32_t sent;       /**< Fin de la dernière trame émise */
+    uint32_t acked;
+    uint32_t crc;        /**< CRC-32 de [0, pos) */
+    uint16_t payload;    /**< Octets utiles par trame */
+    uint16_t window;
+    uint16_t fill;
+    uint8_t  frame[BMU_BLE_XFER_FRAME_MAX];
+} bmu_ble_xfer_tx_t;
+
+/**
+ * @param frame_cap  ATT MTU - 3, borné à BMU_BLE_XFER_FRAME_MAX
+ * @param window     trames non acquittées max, bornée à [1, BMU_BLE_XFER_WINDOW_MAX]
+ */
+void bmu_ble_xfer_tx_open(bmu_ble_xfer_tx_t *tx, uint32_t resume, size_t frame_cap,
+                          uint16_t window);
+
+/** Ajoute des octets au flux ; une trame part dès qu'elle est pleine */
+bool bmu_ble_xfer_tx_write(bmu_ble_xfer_tx_t *tx, const void *data, size_t len,
+                           bmu_ble_xfer_emit_fn_t emit, void *arg);
+
+/** Dernière trame (drapeau fin, éventuellement vide) */
+bool bmu_ble_xfer_tx_finish(bmu_ble_xfer_tx_t *tx, bmu_ble_xfer_emit_fn_t emit, void *arg);
+
+/** ACK client : ignoré s'il recule ou dépasse ce qui a été émis */
+void bmu_ble_xfer_tx_ack(bmu_ble_xfer_tx_t *tx, uint32_t offset);
+
+/** Trames émises non acquittées */
+uint16_t bmu_ble_xfer_tx_inflight(const bmu_ble_xfer_tx_t *tx);
+
+/* ── Récepteur (référence pour l'application) ────────────────────── */
+
+typedef struct {
+    uint32_t next;       /**< Octets reçus sans trou */
+    uint32_t crc;
+    uint16_t ack_every;
+    uint16_t since_ack;
+    bool     done;
+    bool     gap;        /**< Trame hors séquence : ABORT puis OPEN avec resume = next */
+} bmu_ble_xfer_rx_t;
+
+/** resume/crc : état d'un transfert interrompu (0, 0 au départ) */
+void bmu_ble_xfer_rx_init(bmu_ble_xfer_rx_t *rx, uint32_t resume, uint32_t crc,
+                          uint16_t window);
+
+/**
+ * @brief Trame de données reçue.
+ * @param data, data_len  octets nouveaux du flux (0 si doublon ou trou)
+ * @return true si un ACK (offset rx->next) doit partir maintenant
+ */
+bool bmu_ble_xfer_rx_feed(bmu_ble_xfer_rx_t *rx, const uint8_t *frame, size_t len,
+                          const uint8_t **data, size_t *data_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -142,9 +142,10 @@ static int build_battery_adv(uint8_t *buf, size_t buf_len)
 
 static int build_solar_adv(uint8_t *buf, size_t buf_len)
 {
-    if (!bmu_vedirect_is_connected()) return 0;
-    const bmu_vedirect_data_t *d = bmu_vedirect_get_data();
-    if (!d || !d->valid) return 0;
+    /* Un seul « SmartSolar » annonce : somme de tous les MPPT */
+    bmu_vedirect_solar_t solar;
+    if (!bmu_vedirect_get_solar(&solar)) return 0;
+    const bmu_vedirect_data_t *d = &solar.total;
 
     /* Pack plaintext (10 bytes LE):
      * state(u8), error(u8), yield_today(u16 0.01kWh),
@@ -2,31 +2,43 @@
  * bmu_ble_victron_gatt — Service GATT emulant un SmartShunt Victron.
  * VictronConnect detecte ce service et affiche les donnees BMU.
  * Lecture seule — aucune commande d'ecriture.
+ *
+ * Alimente par la trame de telemetrie (sink "vic_gatt", actif tant qu'un
+ * client est connecte) : V, I, SOC, consomme, TTG sont calcules une fois
+ * par cycle (bmu_vic_shunt.h), les lectures et notifications servent ce
+ * cache. Notifications emises par l'ordonnanceur BLE commun (bmu_ble_sched.h).
  */
 
 #include "bmu_ble_victron_gatt.h"
 
 #include "host/ble_hs.h"
 #include "host/ble_gatt.h"
-#include "bmu_protection.h"
-#include "bmu_battery_manager.h"
-#include "bmu_climate.h"
 #include "bmu_config.h"
+#include "bmu_rbe.h"
+#include "bmu_telemetry.h"
+#include "bmu_vic_shunt.h"
 #include "esp_log.h"
-#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
 #include <cstring>
-#include <cmath>
 
 #if !CONFIG_BMU_VICTRON_GATT_ENABLED
 
 const struct ble_gatt_svc_def *bmu_ble_victron_gatt_svc_defs(void) { return NULL; }
+esp_err_t bmu_ble_victron_gatt_init(void) { return ESP_OK; }
 void bmu_ble_victron_gatt_notify_start(void) {}
 void bmu_ble_victron_gatt_notify_stop(void) {}
+int bmu_ble_victron_gatt_notify_tick(uint32_t now_ms, int budget, void *arg)
+{
+    (void)now_ms; (void)budget; (void)arg;
+    return 0;
+}
 
 #else
 
 static const char *TAG = "VIC_GATT";
 
+#define SINK_PERIOD_MS  1000    /* Cadence VictronConnect */
+
 /* ── Victron-like UUIDs (community reverse-engineered) ────────────── */
 /* Service:        68c10001-b17f-4d3a-a290-34ad6499937c */
 /* Characteristics: 68c100xx-... where xx = suffix below */
@@ -38,143 +50,62 @@ static const char *TAG = "VIC_GATT";
     BLE_UUID128_INIT(0x7c, 0x93, 0x99, 0x64, 0xad, 0x34, 0x90, 0xa2, \
                      0x3a, 0x4d, 0x7f, 0xb1, (suffix), 0x00, 0xc1, 0x68)
 
-/* Characteristic value handles (populated by NimBLE) */
-static uint16_t s_hdl_voltage     = 0;
-static uint16_t s_hdl_current     = 0;
-static uint16_t s_hdl_soc         = 0;
-static uint16_t s_hdl_consumed_ah = 0;
-static uint16_t s_hdl_ttg         = 0;
-static uint16_t s_hdl_temperature = 0;
-static uint16_t s_hdl_alarm       = 0;
-
-static esp_timer_handle_t s_notify_timer = NULL;
-
-/* ── Extern accessors from bmu_ble ────────────────────────────────── */
-extern "C" bmu_protection_ctx_t  *bmu_ble_get_prot(void);
-extern "C" bmu_battery_manager_t *bmu_ble_get_mgr(void);
-extern "C" uint8_t                bmu_ble_get_nb_ina(void);
-
-/* ── Read callbacks ───────────────────────────────────────────────── */
-
-static int read_voltage(uint16_t conn, uint16_t attr,
-                        struct ble_gatt_access_ctxt *ctxt, void *arg)
-{
-    (void)conn; (void)attr; (void)arg;
-    bmu_protection_ctx_t *prot = bmu_ble_get_prot();
-    uint8_t nb = bmu_ble_get_nb_ina();
-    float sum = 0; int n = 0;
-    for (int i = 0; i < nb; i++) {
-        if (bmu_protection_get_state(prot, i) == BMU_STATE_CONNECTED) {
-            sum += bmu_protection_get_voltage(prot, i);
-            n++;
-        }
-    }
-    uint16_t val = (n > 0) ? (uint16_t)((sum / n) / 10.0f) : 0; /* 0.01V */
-    os_mbuf_append(ctxt->om, &val, 2);
-    return 0;
-}
-
-static int read_current(uint16_t conn, uint16_t attr,
-                        struct ble_gatt_access_ctxt *ctxt, void *arg)
-{
-    (void)conn; (void)attr; (void)arg;
-    /* Sum discharge rate as proxy for total current (0.1A signed) */
-    int16_t val = 0;
-    os_mbuf_append(ctxt->om, &val, 2);
-    return 0;
-}
-
-static int read_soc(uint16_t conn, uint16_t attr,
-                    struct ble_gatt_access_ctxt *ctxt, void *arg)
-{
-    (void)conn; (void)attr; (void)arg;
-    bmu_protection_ctx_t *prot = bmu_ble_get_prot();
-    uint8_t nb = bmu_ble_get_nb_ina();
-    uint16_t min_mv, max_mv, dummy1, dummy2;
-    bmu_config_get_thresholds(&min_mv, &max_mv, &dummy1, &dummy2);
-    float sum = 0; int n = 0;
-    for (int i = 0; i < nb; i++) {
-        if (bmu_protection_get_state(prot, i) == BMU_STATE_CONNECTED) {
-            sum += bmu_protection_get_voltage(prot, i);
-            n++;
-        }
-    }
-    float avg_mv = (n > 0) ? sum / n : 0;
-    float soc = (avg_mv - min_mv) / (float)(max_mv - min_mv) * 100.0f;
-    if (soc < 0) soc = 0;
-    if (soc > 100) soc = 100;
-    uint16_t val = (uint16_t)(soc * 100.0f); /* 0-10000 */
-    os_mbuf_append(ctxt->om, &val, 2);
-    return 0;
-}
-
-static int read_consumed(uint16_t conn, uint16_t attr,
-                         struct ble_gatt_access_ctxt *ctxt, void *arg)
+/* Characteristic value handles (populated by NimBLE), indices BMU_VIC_CHR_* */
+static uint16_t s_hdl[BMU_VIC_CHR_NB];
+
+/* ── Valeurs SmartShunt : calculees une fois par cycle pipeline ──── */
+/* Ecrites par le sink telemetrie, lues par les callbacks GATT et la
+ * source de notification (tache ordonnanceur bmu_ble). */
+static portMUX_TYPE    s_mux = portMUX_INITIALIZER_UNLOCKED;
+static bmu_vic_shunt_t s_val;
+static uint8_t         s_pending = 0;      /* Caracteristiques a notifier */
+static bool            s_have = false;
+static uint32_t        s_last_full_ms = 0;
+static int             s_sink_id = -1;
+static volatile bool   s_active = false;   /* Au moins un client BLE */
+
+static void telem_sink_cb(const bmu_telem_frame_t *frame, void *arg)
 {
-    (void)conn; (void)attr; (void)arg;
-    bmu_battery_manager_t *mgr = bmu_ble_get_mgr();
-    uint8_t nb = bmu_ble_get_nb_ina();
-    float sum = 0;
-    for (int i = 0; i < nb; i++) sum += bmu_battery_manager_get_ah_discharge(mgr, i);
-    int32_t val = (int32_t)(sum * 10.0f); /* 0.1Ah */
-    os_mbuf_append(ctxt->om, &val, 4);
-    return 0;
-}
-
-static int read_ttg(uint16_t conn, uint16_t attr,
-                    struct ble_gatt_access_ctxt *ctxt, void *arg)
-{
-    (void)conn; (void)attr; (void)arg;
-    uint16_t val = 0xFFFF; /* infinite (no discharge estimation) */
-    os_mbuf_append(ctxt->om, &val, 2);
-    return 0;
+    (void)arg;
+    bmu_vic_shunt_cfg_t cfg = {};
+    uint16_t max_ma, dummy;
+    bmu_config_get_thresholds(&cfg.v_min_mv, &cfg.v_max_mv, &max_ma, &dummy);
+#if defined(CONFIG_BMU_SOC_ENABLED) && CONFIG_BMU_SOC_ENABLED
+    cfg.capacity_ah = CONFIG_BMU_SOC_CAPACITY_MAH / 1000.0f;
+#endif
+    bmu_vic_shunt_t v;
+    bmu_vic_shunt_compute(frame, &cfg, &v);
+
+    portENTER_CRITICAL(&s_mux);
+    s_pending |= s_have ? bmu_vic_shunt_diff(&v, &s_val) : BMU_VIC_CHR_ALL;
+    s_val = v;
+    s_have = true;
+    portEXIT_CRITICAL(&s_mux);
 }
 
-static int read_temperature(uint16_t conn, uint16_t attr,
-                            struct ble_gatt_access_ctxt *ctxt, void *arg)
-{
-    (void)conn; (void)attr; (void)arg;
-    int16_t val = 0;
-    if (bmu_climate_is_available()) {
-        val = (int16_t)(bmu_climate_get_temperature() * 100.0f + 27315); /* 0.01K */
-    }
-    os_mbuf_append(ctxt->om, &val, 2);
-    return 0;
-}
+/* ── Read callback : valeur en cache, aucun getter ───────────────── */
 
-static int read_alarm(uint16_t conn, uint16_t attr,
+static int read_value(uint16_t conn, uint16_t attr,
                       struct ble_gatt_access_ctxt *ctxt, void *arg)
 {
-    (void)conn; (void)attr; (void)arg;
-    bmu_protection_ctx_t *prot = bmu_ble_get_prot();
-    uint8_t nb = bmu_ble_get_nb_ina();
-    uint16_t min_mv, max_mv, max_ma, dummy;
-    bmu_config_get_thresholds(&min_mv, &max_mv, &max_ma, &dummy);
-
-    uint16_t alarm = 0;
-    float sum = 0; int n = 0;
-    bool has_error = false, has_locked = false;
-    for (int i = 0; i < nb; i++) {
-        bmu_battery_state_t st = bmu_protection_get_state(prot, i);
-        if (st == BMU_STATE_ERROR) has_error = true;
-        if (st == BMU_STATE_LOCKED) has_locked = true;
-        if (st == BMU_STATE_CONNECTED) {
-            sum += bmu_protection_get_voltage(prot, i);
-            n++;
-        }
-    }
-    if (n > 0) {
-        float avg = sum / n;
-        if (avg < min_mv) alarm |= (1 << 0); /* low V */
-        if (avg > max_mv) alarm |= (1 << 1); /* high V */
+    (void)conn; (void)attr;
+    bmu_vic_shunt_t v;
+    portENTER_CRITICAL(&s_mux);
+    v = s_val;
+    portEXIT_CRITICAL(&s_mux);
+
+    int rc;
+    switch ((int)(intptr_t)arg) {
+    case BMU_VIC_CHR_VOLTAGE:  rc = os_mbuf_append(ctxt->om, &v.voltage_cv, 2); break;
+    case BMU_VIC_CHR_CURRENT:  rc = os_mbuf_append(ctxt->om, &v.current_da, 2); break;
+    case BMU_VIC_CHR_SOC:      rc = os_mbuf_append(ctxt->om, &v.soc_cpct, 2); break;
+    case BMU_VIC_CHR_CONSUMED: rc = os_mbuf_append(ctxt->om, &v.consumed_dah, 4); break;
+    case BMU_VIC_CHR_TTG:      rc = os_mbuf_append(ctxt->om, &v.ttg_min, 2); break;
+    case BMU_VIC_CHR_TEMP:     rc = os_mbuf_append(ctxt->om, &v.temp_ck, 2); break;
+    case BMU_VIC_CHR_ALARM:    rc = os_mbuf_append(ctxt->om, &v.alarm, 2); break;
+    default: return BLE_ATT_ERR_UNLIKELY;
     }
-    if (has_error)  alarm |= (1 << 4);
-    if (has_locked) alarm |= (1 << 5);
-    if (bmu_climate_is_available() && bmu_climate_get_temperature() > 60.0f)
-        alarm |= (1 << 3);
-
-    os_mbuf_append(ctxt->om, &alarm, 2);
-    return 0;
+    return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
 }
 
 static int read_model(uint16_t conn, uint16_t attr,
@@ -208,14 +139,18 @@ static const ble_uuid128_t chr_alarm_uuid        = VIC_CHR_UUID(0x17);
 static const ble_uuid128_t chr_model_uuid        = VIC_CHR_UUID(0x20);
 static const ble_uuid128_t chr_serial_uuid       = VIC_CHR_UUID(0x21);
 
+#define VIC_NOTIFY_CHR(uuid_, idx) \
+    { .uuid = &(uuid_).u, .access_cb = read_value, .arg = (void *)(intptr_t)(idx), \
+      .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl[idx] }
+
 static const struct ble_gatt_chr_def vic_chrs[] = {
-    { .uuid = &chr_voltage_uuid.u,  .access_cb = read_voltage,     .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_voltage },
-    { .uuid = &chr_current_uuid.u,  .access_cb = read_current,     .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_current },
-    { .uuid = &chr_soc_uuid.u,      .access_cb = read_soc,         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_soc },
-    { .uuid = &chr_consumed_uuid.u, .access_cb = read_consumed,    .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_consumed_ah },
-    { .uuid = &chr_ttg_uuid.u,      .access_cb = read_ttg,         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_ttg },
-    { .uuid = &chr_temp_uuid.u,     .access_cb = read_temperature, .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_temperature },
-    { .uuid = &chr_alarm_uuid.u,    .access_cb = read_alarm,       .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY, .val_handle = &s_hdl_alarm },
+    VIC_NOTIFY_CHR(chr_voltage_uuid,  BMU_VIC_CHR_VOLTAGE),
+    VIC_NOTIFY_CHR(chr_current_uuid,  BMU_VIC_CHR_CURRENT),
+    VIC_NOTIFY_CHR(chr_soc_uuid,      BMU_VIC_CHR_SOC),
+    VIC_NOTIFY_CHR(chr_consumed_uuid, BMU_VIC_CHR_CONSUMED),
+    VIC_NOTIFY_CHR(chr_ttg_uuid,      BMU_VIC_CHR_TTG),
+    VIC_NOTIFY_CHR(chr_temp_uuid,     BMU_VIC_CHR_TEMP),
+    VIC_NOTIFY_CHR(chr_alarm_uuid,    BMU_VIC_CHR_ALARM),
     { .uuid = &chr_model_uuid.u,    .access_cb = read_model,       .flags = BLE_GATT_CHR_F_READ },
     { .uuid = &chr_serial_uuid.u,   .access_cb = read_serial,      .flags = BLE_GATT_CHR_F_READ },
     { .uuid = NULL } /* terminateur */
@@ -235,43 +170,66 @@ const struct ble_gatt_svc_def *bmu_ble_victron_gatt_svc_defs(void)
     return vic_svc_def;
 }
 
-/* ── Notification timer (1s) ──────────────────────────────────────── */
+/* ── Notifications : source de l'ordonnanceur bmu_ble ─────────── */
+/* Seules les caracteristiques modifiees depuis le dernier envoi partent,
+ * toutes au heartbeat RBE. ble_gatts_chr_updated n'ecrit qu'aux clients
+ * abonnes ; leur lecture sert la valeur en cache. */
+
+esp_err_t bmu_ble_victron_gatt_init(void)
+{
+    if (s_sink_id >= 0) return ESP_OK;
+    /* Suspendu (periode 0) tant qu'aucun client n'est connecte */
+    s_sink_id = bmu_telem_subscribe("vic_gatt", s_active ? SINK_PERIOD_MS : 0,
+                                    telem_sink_cb, NULL);
+    return s_sink_id >= 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
 
-static void notify_timer_cb(void *arg)
+int bmu_ble_victron_gatt_notify_tick(uint32_t now_ms, int budget, void *arg)
 {
     (void)arg;
-    /* Notify all subscribed clients on voltage + current + soc */
-    uint16_t handles[] = { s_hdl_voltage, s_hdl_current, s_hdl_soc,
-                           s_hdl_consumed_ah, s_hdl_alarm };
-    for (int h = 0; h < 5; h++) {
-        if (handles[h] == 0) continue;
-        ble_gatts_chr_updated(handles[h]);
+    if (BMU_RBE_HEARTBEAT_MS == 0 || (uint32_t)(now_ms - s_last_full_ms) >= BMU_RBE_HEARTBEAT_MS) {
+        portENTER_CRITICAL(&s_mux);
+        if (s_have) s_pending = BMU_VIC_CHR_ALL;
+        portEXIT_CRITICAL(&s_mux);
+        s_last_full_ms = now_ms;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    uint8_t pending = s_pending;
+    portEXIT_CRITICAL(&s_mux);
+
+    /* Budget nul : source forcee par l'ordonnanceur (max_ms), tout part */
+    int max = budget > 0 ? budget : BMU_VIC_CHR_NB;
+    uint8_t done = 0;
+    int sent = 0;
+    for (int k = 0; k < BMU_VIC_CHR_NB && sent < max; k++) {
+        if (!(pending & (1u << k))) continue;
+        done |= (uint8_t)(1u << k);
+        if (s_hdl[k] == 0) continue;
+        ble_gatts_chr_updated(s_hdl[k]);
+        sent++;
     }
+
+    portENTER_CRITICAL(&s_mux);
+    s_pending &= (uint8_t)~done;
+    portEXIT_CRITICAL(&s_mux);
+    return sent;
 }
 
 void bmu_ble_victron_gatt_notify_start(void)
 {
-    if (s_notify_timer != NULL) return;
-    const esp_timer_create_args_t args = {
-        .callback = notify_timer_cb, .arg = NULL,
-        .dispatch_method = ESP_TIMER_TASK, .name = "vic_gatt",
-        .skip_unhandled_events = true,
-    };
-    if (esp_timer_create(&args, &s_notify_timer) != ESP_OK) {
-        ESP_LOGE(TAG, "esp_timer_create (victron gatt) échec");
-        s_notify_timer = NULL;
-        return;
-    }
-    esp_timer_start_periodic(s_notify_timer, 1000000ULL); /* 1s */
+    s_active = true;
+    portENTER_CRITICAL(&s_mux);
+    if (s_have) s_pending = BMU_VIC_CHR_ALL;
+    portEXIT_CRITICAL(&s_mux);
+    bmu_telem_set_period(s_sink_id, SINK_PERIOD_MS);
     ESP_LOGI(TAG, "Victron GATT notifications started");
 }
 
 void bmu_ble_victron_gatt_notify_stop(void)
 {
-    if (s_notify_timer == NULL) return;
-    esp_timer_stop(s_notify_timer);
-    esp_timer_delete(s_notify_timer);
-    s_notify_timer = NULL;
+    s_active = false;
+    bmu_telem_set_period(s_sink_id, 0);
     ESP_LOGI(TAG, "Victron GATT notifications stopped");
 }
 
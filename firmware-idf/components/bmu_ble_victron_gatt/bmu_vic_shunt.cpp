@@ -0,0 +1,90 @@
+/**
+ * bmu_vic_shunt — Grandeurs SmartShunt (voir bmu_vic_shunt.h).
+ *
+ * Pas de dependance ESP-IDF (teste sur host, test_victron_gatt).
+ */
+
+#include "bmu_vic_shunt.h"
+
+#include <cmath>
+
+static int32_t clamp_round(float v, int32_t lo, int32_t hi)
+{
+    if (std::isnan(v)) return 0;
+    if (v <= (float)lo) return lo;
+    if (v >= (float)hi) return hi;
+    return (int32_t)lroundf(v);
+}
+
+static float fallback_soc(float v_mv, const bmu_vic_shunt_cfg_t *cfg)
+{
+    if (v_mv <= 0.0f || cfg->v_max_mv <= cfg->v_min_mv) return 0.0f;
+    return (v_mv - cfg->v_min_mv) / (float)(cfg->v_max_mv - cfg->v_min_mv) * 100.0f;
+}
+
+void bmu_vic_shunt_compute(const bmu_telem_frame_t *f, const bmu_vic_shunt_cfg_t *cfg,
+                           bmu_vic_shunt_t *out)
+{
+    uint8_t nb = f->nb_batteries > BMU_MAX_BATTERIES ? BMU_MAX_BATTERIES : f->nb_batteries;
+
+    /* Tension et capacite des batteries en ligne, alarmes d'etat : un seul
+     * passage. Une batterie isolee (sur/sous-tension) ne compte pas dans V :
+     * v_avg_mv de la trame inclut les deconnectees, d'ou le calcul local */
+    float cap_ah = 0.0f;
+    float v_sum = 0.0f;
+    uint8_t n_conn = 0;
+    uint16_t alarm = 0;
+    for (uint8_t i = 0; i < nb; i++) {
+        const bmu_telem_batt_t *b = &f->batt[i];
+        if (b->state == BMU_STATE_ERROR)  alarm |= BMU_VIC_ALARM_ERROR;
+        if (b->state == BMU_STATE_LOCKED) alarm |= BMU_VIC_ALARM_LOCKED;
+        if (b->state != BMU_STATE_CONNECTED) continue;
+        v_sum += b->voltage_mv;
+        n_conn++;
+        if (cfg->capacity_ah <= 0.0f) continue;
+        bool soh_ok = !std::isnan(b->soh_percent) && b->soh_percent > 0.0f;
+        cap_ah += cfg->capacity_ah * (soh_ok ? b->soh_percent / 100.0f : 1.0f);
+    }
+
+    float v_mv = n_conn > 0 ? v_sum / n_conn : 0.0f;
+    if (n_conn > 0) {
+        if (v_mv < cfg->v_min_mv) alarm |= BMU_VIC_ALARM_LOW_V;
+        if (v_mv > cfg->v_max_mv) alarm |= BMU_VIC_ALARM_HIGH_V;
+    }
+    if (!std::isnan(f->temp_c) && f->temp_c > BMU_VIC_TEMP_ALARM_C) alarm |= BMU_VIC_ALARM_HIGH_T;
+
+    float soc = f->soc_fleet >= 0.0f ? f->soc_fleet : fallback_soc(v_mv, cfg);
+    if (soc < 0.0f) soc = 0.0f;
+    if (soc > 100.0f) soc = 100.0f;
+
+    float remaining_ah = cap_ah * soc / 100.0f;
+    float consumed_ah = cap_ah > 0.0f ? cap_ah - remaining_ah : f->ah_discharge_total;
+
+    /* Convention protection : I > 0 en decharge */
+    uint16_t ttg = BMU_VIC_TTG_INFINITE;
+    if (cap_ah > 0.0f && f->i_total_a > BMU_VIC_TTG_MIN_A) {
+        ttg = (uint16_t)clamp_round(remaining_ah / f->i_total_a * 60.0f, 0, BMU_VIC_TTG_INFINITE - 1);
+    }
+
+    out->voltage_cv   = (uint16_t)clamp_round(v_mv / 10.0f, 0, UINT16_MAX);
+    out->current_da   = (int16_t)clamp_round(-f->i_total_a * 10.0f, -INT16_MAX, INT16_MAX);
+    out->soc_cpct     = (uint16_t)clamp_round(soc * 100.0f, 0, 10000);
+    out->consumed_dah = clamp_round(consumed_ah * 10.0f, INT32_MIN / 2, INT32_MAX / 2);
+    out->ttg_min      = ttg;
+    out->temp_ck      = std::isnan(f->temp_c) ? 0
+                      : (uint16_t)clamp_round(f->temp_c * 100.0f + 27315.0f, 1, UINT16_MAX);
+    out->alarm        = alarm;
+}
+
+uint8_t bmu_vic_shunt_diff(const bmu_vic_shunt_t *a, const bmu_vic_shunt_t *b)
+{
+    uint8_t m = 0;
+    if (a->voltage_cv   != b->voltage_cv)   m |= 1u << BMU_VIC_CHR_VOLTAGE;
+    if (a->current_da   != b->current_da)   m |= 1u << BMU_VIC_CHR_CURRENT;
+    if (a->soc_cpct     != b->soc_cpct)     m |= 1u << BMU_VIC_CHR_SOC;
+    if (a->consumed_dah != b->consumed_dah) m |= 1u << BMU_VIC_CHR_CONSUMED;
+    if (a->ttg_min      != b->ttg_min)      m |= 1u << BMU_VIC_CHR_TTG;
+    if (a->temp_ck      != b->temp_ck)      m |= 1u << BMU_VIC_CHR_TEMP;
+    if (a->alarm        != b->alarm)        m |= 1u << BMU_VIC_CHR_ALARM;
+    return m;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -9,12 +10,19 @@ extern "C" {
  *  A enregistrer dans le tableau GATT de bmu_ble.cpp. */
 const struct ble_gatt_svc_def *bmu_ble_victron_gatt_svc_defs(void);
 
-/** Demarre le timer de notification (1s). Appeler quand un client BLE se connecte. */
+/** Abonne le service au pipeline de telemetrie. Appeler apres bmu_telem_init. */
+esp_err_t bmu_ble_victron_gatt_init(void);
+
+/** Premier client BLE connecte : reprend le calcul par cycle, tout renvoyer. */
 void bmu_ble_victron_gatt_notify_start(void);
 
-/** Arrete le timer de notification. Appeler quand le dernier client BLE se deconnecte. */
+/** Dernier client BLE deconnecte : suspend le calcul. */
 void bmu_ble_victron_gatt_notify_stop(void);
 
+/** Source de l'ordonnanceur BLE (bmu_ble_sched_fn_t) : notifie les
+ *  caracteristiques modifiees, au plus budget. @return notifications emises */
+int bmu_ble_victron_gatt_notify_tick(uint32_t now_ms, int budget, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,73 @@
+/**
+ * @file bmu_vic_shunt.h
+ * @brief Grandeurs SmartShunt derivees de la trame de telemetrie.
+ *
+ * Calculees une fois par cycle pipeline (sink bmu_telemetry) et servies
+ * telles quelles par le service GATT, quel que soit le nombre de clients :
+ *   V        moyenne des batteries connectees (0.01 V), alarmes V idem
+ *   I        somme, convention Victron : < 0 en decharge (0.1 A)
+ *   SOC      SOC flotte (bmu_soc), sinon lineaire entre seuils V min/max
+ *   Capacite nominale x SOH des batteries connectees
+ *   Consomme capacite x (1 - SOC) ; sans capacite, Ah decharges cumules
+ *   TTG      restant / courant de decharge (minutes), 0xFFFF = infini
+ *
+ * Aucune dependance ESP-IDF : teste sur host (test_victron_gatt).
+ */
+#pragma once
+
+#include <stdint.h>
+#include "bmu_telemetry_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Caracteristiques notifiees (bit i de bmu_vic_shunt_diff) */
+enum {
+    BMU_VIC_CHR_VOLTAGE = 0,
+    BMU_VIC_CHR_CURRENT,
+    BMU_VIC_CHR_SOC,
+    BMU_VIC_CHR_CONSUMED,
+    BMU_VIC_CHR_TTG,
+    BMU_VIC_CHR_TEMP,
+    BMU_VIC_CHR_ALARM,
+    BMU_VIC_CHR_NB
+};
+#define BMU_VIC_CHR_ALL       ((uint8_t)((1u << BMU_VIC_CHR_NB) - 1))
+
+/* Bits d'alarme */
+#define BMU_VIC_ALARM_LOW_V   (1u << 0)
+#define BMU_VIC_ALARM_HIGH_V  (1u << 1)
+#define BMU_VIC_ALARM_HIGH_T  (1u << 3)
+#define BMU_VIC_ALARM_ERROR   (1u << 4)
+#define BMU_VIC_ALARM_LOCKED  (1u << 5)
+
+#define BMU_VIC_TTG_INFINITE  0xFFFF
+#define BMU_VIC_TTG_MIN_A     0.1f      /**< Decharge minimale pour un TTG fini */
+#define BMU_VIC_TEMP_ALARM_C  60.0f
+
+typedef struct {
+    uint16_t voltage_cv;        /**< 0.01 V */
+    int16_t  current_da;        /**< 0.1 A */
+    uint16_t soc_cpct;          /**< 0.01 %, 0..10000 */
+    int32_t  consumed_dah;      /**< 0.1 Ah */
+    uint16_t ttg_min;
+    uint16_t temp_ck;           /**< 0.01 K, 0 = capteur absent */
+    uint16_t alarm;
+} bmu_vic_shunt_t;
+
+typedef struct {
+    uint16_t v_min_mv;          /**< Seuils protection : SOC de repli, alarmes */
+    uint16_t v_max_mv;
+    float    capacity_ah;       /**< Nominale par batterie, 0 = inconnue */
+} bmu_vic_shunt_cfg_t;
+
+void bmu_vic_shunt_compute(const bmu_telem_frame_t *f, const bmu_vic_shunt_cfg_t *cfg,
+                           bmu_vic_shunt_t *out);
+
+/** Masque des caracteristiques dont la valeur differe (bit BMU_VIC_CHR_*) */
+uint8_t bmu_vic_shunt_diff(const bmu_vic_shunt_t *a, const bmu_vic_shunt_t *b);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,4 +1,15 @@
+/**
+ * @file bmu_ble_victron_scan.cpp
+ * @brief Scanner des annonces Victron Instant Readout.
+ *
+ * Chaque appareil garde son contexte AES (cle lue en NVS et expansee une
+ * fois par scan, reexpansee seulement si elle change) et sa derniere trame :
+ * une annonce au meme compteur n'est pas redechiffree. Les annonces non
+ * Victron sont rejetees sur les donnees constructeur brutes (bmu_vic_adv).
+ */
+
 #include "bmu_ble_victron_scan.h"
+#include "bmu_vic_adv.h"
 #include "bmu_config.h"
 #include "host/ble_hs.h"
 #include "host/ble_gap.h"
@@ -15,43 +26,78 @@ void bmu_vic_scan_stop(void) {}
 int bmu_vic_scan_get_devices(bmu_vic_device_t *, int) { return 0; }
 const bmu_vic_device_t *bmu_vic_scan_get_device_by_mac(const uint8_t *) { return NULL; }
 int bmu_vic_scan_count(void) { return 0; }
+void bmu_vic_scan_reload_keys(void) {}
+void bmu_vic_scan_get_stats(bmu_vic_scan_stats_t *out) { memset(out, 0, sizeof(*out)); }
 #else
 
 static const char *TAG = "VIC_SCAN";
-#define VICTRON_COMPANY_ID 0x02E1
 #define EXPIRY_MS (5 * 60 * 1000) /* 5 minutes */
 
+/* Etat prive par appareil, meme indice que s_devices[] */
+typedef struct {
+    mbedtls_aes_context aes;       /* cle expansee (CTR : chiffrement seul) */
+    uint8_t             key[16];
+    bool                aes_ready;
+    uint32_t            key_gen;   /* s_key_gen a la derniere lecture NVS */
+    bmu_vic_adv_last_t  last;      /* derniere trame dechiffree */
+} vic_slot_t;
+
 static bmu_vic_device_t s_devices[CONFIG_BMU_VIC_SCAN_MAX_DEVICES];
+static vic_slot_t s_slots[CONFIG_BMU_VIC_SCAN_MAX_DEVICES];
 static int s_device_count = 0;
+static uint32_t s_key_gen = 1;     /* incremente a chaque scan : cles relues */
+static bmu_vic_scan_stats_t s_stats = {};
 static esp_timer_handle_t s_scan_timer = NULL;
 static int64_t now_ms(void) { return esp_timer_get_time() / 1000; }
 
-/* ── AES decrypt (same algo as bmu_ble_victron) ──────────────────── */
-static bool decrypt_payload(const uint8_t mac[6], const uint8_t *cipher,
-                            uint8_t *plain, size_t len, uint16_t counter)
+/* ── Cle AES par appareil ─────────────────────────────────────────── */
+
+static void slot_reset(vic_slot_t *slot)
 {
-    char hex_key[33];
-    if (bmu_config_get_victron_device_key(mac, hex_key, sizeof(hex_key)) != ESP_OK)
-        return false;
+    mbedtls_aes_free(&slot->aes);
+    memset(slot, 0, sizeof(*slot));
+    mbedtls_aes_init(&slot->aes);
+}
 
+/* Relit la cle en NVS ; expansion seulement si elle a change */
+static void slot_load_key(vic_slot_t *slot, bmu_vic_device_t *dev)
+{
+    slot->key_gen = s_key_gen;
+    s_stats.key_loads++;
+
+    char hex_key[33];
     uint8_t key[16];
-    for (int i = 0; i < 16; i++) {
-        unsigned b = 0;
-        sscanf(hex_key + i * 2, "%02x", &b);
-        key[i] = (uint8_t)b;
+    bool ok = bmu_config_get_victron_device_key(dev->mac, hex_key, sizeof(hex_key)) == ESP_OK &&
+              bmu_vic_adv_parse_key(hex_key, key);
+    dev->key_configured = ok;
+
+    if (!ok) {
+        if (slot->aes_ready) {
+            uint32_t gen = slot->key_gen;
+            slot_reset(slot);
+            slot->key_gen = gen;
+        }
+        return;
     }
+    if (slot->aes_ready && memcmp(slot->key, key, sizeof(key)) == 0) return;
+
+    mbedtls_aes_setkey_enc(&slot->aes, key, 128);
+    memcpy(slot->key, key, sizeof(key));
+    slot->aes_ready = true;
+    slot->last.valid = false;      /* nouvelle cle : redechiffrer */
+    s_stats.key_schedules++;
+}
 
-    mbedtls_aes_context aes;
-    mbedtls_aes_init(&aes);
-    mbedtls_aes_setkey_enc(&aes, key, 128);
+/* ── AES-CTR decrypt (same algo as bmu_ble_victron) ────────────────── */
+static void decrypt_payload(vic_slot_t *slot, const bmu_vic_adv_t *adv, uint8_t *plain)
+{
     uint8_t nonce[16] = {};
-    nonce[0] = (uint8_t)(counter & 0xFF);
-    nonce[1] = (uint8_t)(counter >> 8);
+    nonce[0] = (uint8_t)(adv->counter & 0xFF);
+    nonce[1] = (uint8_t)(adv->counter >> 8);
     size_t nc_off = 0;
     uint8_t stream[16] = {};
-    mbedtls_aes_crypt_ctr(&aes, len, &nc_off, nonce, stream, cipher, plain);
-    mbedtls_aes_free(&aes);
-    return true;
+    mbedtls_aes_crypt_ctr(&slot->aes, BMU_VIC_ADV_CIPHER_LEN, &nc_off, nonce, stream,
+                          adv->cipher, plain);
 }
 
 /* ── Parse decoded payload by record type ─────────────────────────── */
@@ -88,80 +134,87 @@ static void parse_payload(bmu_vic_device_t *dev)
 }
 
 /* ── Find or allocate device slot ─────────────────────────────────── */
-static bmu_vic_device_t *find_or_alloc(const uint8_t mac[6])
+static int find_or_alloc(const uint8_t mac[6])
 {
     for (int i = 0; i < s_device_count; i++) {
-        if (memcmp(s_devices[i].mac, mac, 6) == 0) return &s_devices[i];
+        if (memcmp(s_devices[i].mac, mac, 6) == 0) return i;
     }
+    int idx;
     if (s_device_count < CONFIG_BMU_VIC_SCAN_MAX_DEVICES) {
-        bmu_vic_device_t *d = &s_devices[s_device_count++];
-        memset(d, 0, sizeof(*d));
-        memcpy(d->mac, mac, 6);
-        /* Load label from NVS */
-        bmu_config_get_victron_device_label(mac, d->label, sizeof(d->label));
-        return d;
-    }
-    /* Evict oldest */
-    int oldest = 0;
-    for (int i = 1; i < s_device_count; i++) {
-        if (s_devices[i].last_seen_ms < s_devices[oldest].last_seen_ms)
-            oldest = i;
+        idx = s_device_count++;
+    } else {
+        /* Evict oldest */
+        idx = 0;
+        for (int i = 1; i < s_device_count; i++) {
+            if (s_devices[i].last_seen_ms < s_devices[idx].last_seen_ms)
+                idx = i;
+        }
     }
-    bmu_vic_device_t *d = &s_devices[oldest];
+    bmu_vic_device_t *d = &s_devices[idx];
     memset(d, 0, sizeof(*d));
     memcpy(d->mac, mac, 6);
+    /* Load label from NVS */
     bmu_config_get_victron_device_label(mac, d->label, sizeof(d->label));
-    return d;
+    slot_reset(&s_slots[idx]);
+    return idx;
 }
 
 /* ── GAP event handler for scan results ───────────────────────────── */
+static void account_handler(int64_t t0_us)
+{
+    uint32_t d = (uint32_t)(esp_timer_get_time() - t0_us);
+    s_stats.handler_us += d;
+    if (d > s_stats.handler_max_us) s_stats.handler_max_us = d;
+}
+
 static int scan_event_handler(struct ble_gap_event *event, void *arg)
 {
+    if (event->type == BLE_GAP_EVENT_DISC_COMPLETE) {
+        ESP_LOGD(TAG, "Scan fini : %lu annonces, %lu Victron, %lu doublons, %lu dechiffrees, "
+                 "%llu us cumules (max %lu us)",
+                 (unsigned long)s_stats.adv_rx, (unsigned long)s_stats.victron_rx,
+                 (unsigned long)s_stats.dup_skipped, (unsigned long)s_stats.decrypted,
+                 (unsigned long long)s_stats.handler_us, (unsigned long)s_stats.handler_max_us);
+        return 0;
+    }
     if (event->type != BLE_GAP_EVENT_DISC) return 0;
 
-    struct ble_hs_adv_fields parsed;
-    if (ble_hs_adv_parse_fields(&parsed, event->disc.data,
-                                 event->disc.length_data) != 0)
-        return 0;
+    const int64_t t0 = esp_timer_get_time();
+    s_stats.adv_rx++;
 
-    /* Filter: must have manufacturer data with Victron company ID */
-    if (parsed.mfg_data == NULL || parsed.mfg_data_len < 15) return 0;
-    uint16_t company = parsed.mfg_data[0] | (parsed.mfg_data[1] << 8);
-    if (company != VICTRON_COMPANY_ID) return 0;
-
-    /* Detect format: 0x10 at byte 2 = new Instant Readout with PID (18 bytes) */
-    uint8_t record_type;
-    uint16_t counter;
-    const uint8_t *cipher;
-    if (parsed.mfg_data[2] == 0x10 && parsed.mfg_data_len >= 18) {
-        /* New format: [company(2)] [0x10] [pid(2)] [record] [nonce(2)] [encrypted(10)] */
-        record_type = parsed.mfg_data[5];
-        counter = parsed.mfg_data[6] | (parsed.mfg_data[7] << 8);
-        cipher = parsed.mfg_data + 8;
-    } else {
-        /* Legacy format: [company(2)] [record] [nonce(2)] [encrypted(10)] */
-        record_type = parsed.mfg_data[2];
-        counter = parsed.mfg_data[3] | (parsed.mfg_data[4] << 8);
-        cipher = parsed.mfg_data + 5;
+    /* Filter: manufacturer data with Victron company ID, sans decoder le reste */
+    bmu_vic_adv_t adv;
+    if (!bmu_vic_adv_find(event->disc.data, event->disc.length_data, &adv)) {
+        account_handler(t0);
+        return 0;
     }
+    s_stats.victron_rx++;
 
-    uint8_t mac[6];
-    memcpy(mac, event->disc.addr.val, 6);
+    int idx = find_or_alloc(event->disc.addr.val);
+    bmu_vic_device_t *dev = &s_devices[idx];
+    vic_slot_t *slot = &s_slots[idx];
+    dev->record_type = adv.record_type;
+    dev->last_seen_ms = t0 / 1000;
 
-    bmu_vic_device_t *dev = find_or_alloc(mac);
-    dev->record_type = record_type;
-    dev->last_seen_ms = now_ms();
+    /* Cle relue une fois par scan (changement via la config) */
+    if (slot->key_gen != s_key_gen) slot_load_key(slot, dev);
 
-    /* Try decryption */
-    char hex_key[33];
-    dev->key_configured = (bmu_config_get_victron_device_key(mac, hex_key, sizeof(hex_key)) == ESP_OK);
-    if (dev->key_configured) {
-        dev->decrypted = decrypt_payload(mac, cipher, dev->raw_decrypted, 10, counter);
-        if (dev->decrypted) parse_payload(dev);
-    } else {
+    if (!slot->aes_ready) {
         dev->decrypted = false;
+        s_stats.no_key++;
+    } else if (dev->decrypted && bmu_vic_adv_is_dup(&slot->last, &adv)) {
+        s_stats.dup_skipped++;      /* compteur inchange : donnees inchangees */
+    } else {
+        const int64_t t1 = esp_timer_get_time();
+        decrypt_payload(slot, &adv, dev->raw_decrypted);
+        parse_payload(dev);
+        dev->decrypted = true;
+        bmu_vic_adv_remember(&slot->last, &adv);
+        s_stats.decrypted++;
+        s_stats.decrypt_us += (uint64_t)(esp_timer_get_time() - t1);
     }
 
+    account_handler(t0);
     return 0;
 }
 
@@ -169,6 +222,7 @@ static int scan_event_handler(struct ble_gap_event *event, void *arg)
 static void scan_timer_cb(void *arg)
 {
     (void)arg;
+    s_key_gen++;
     struct ble_gap_disc_params params = {};
     params.passive = 1;
     params.filter_duplicates = 0;
@@ -188,6 +242,10 @@ esp_err_t bmu_vic_scan_init(void)
 {
     s_device_count = 0;
     memset(s_devices, 0, sizeof(s_devices));
+    for (int i = 0; i < CONFIG_BMU_VIC_SCAN_MAX_DEVICES; i++) {
+        mbedtls_aes_init(&s_slots[i].aes);
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
     ESP_LOGI(TAG, "Init OK — scan %ds every %ds, max %d devices",
              CONFIG_BMU_VIC_SCAN_DURATION_S, CONFIG_BMU_VIC_SCAN_PERIOD_S,
              CONFIG_BMU_VIC_SCAN_MAX_DEVICES);
@@ -241,6 +299,16 @@ const bmu_vic_device_t *bmu_vic_scan_get_device_by_mac(const uint8_t mac[6])
     return NULL;
 }
 
+void bmu_vic_scan_reload_keys(void)
+{
+    s_key_gen++;
+}
+
+void bmu_vic_scan_get_stats(bmu_vic_scan_stats_t *out)
+{
+    *out = s_stats;
+}
+
 int bmu_vic_scan_count(void)
 {
     int count = 0;
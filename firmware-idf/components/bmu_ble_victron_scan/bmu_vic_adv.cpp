@@ -0,0 +1,82 @@
+/**
+ * bmu_vic_adv — Annonces Victron (voir bmu_vic_adv.h).
+ *
+ * Pas de dependance ESP-IDF (teste sur host, test_victron_scan).
+ */
+
+#include "bmu_vic_adv.h"
+
+#include <cstring>
+
+#define AD_TYPE_MFG_DATA  0xFF
+
+/* ── Donnees constructeur ────────────────────────────────────────── */
+
+static bool parse_mfg(const uint8_t *m, size_t len, bmu_vic_adv_t *out)
+{
+    if (len < 15) return false;
+    if ((uint16_t)(m[0] | (m[1] << 8)) != BMU_VIC_ADV_COMPANY_ID) return false;
+
+    if (m[2] == 0x10 && len >= 18) {
+        out->record_type = m[5];
+        out->counter     = (uint16_t)(m[6] | (m[7] << 8));
+        out->cipher      = m + 8;
+    } else {
+        out->record_type = m[2];
+        out->counter     = (uint16_t)(m[3] | (m[4] << 8));
+        out->cipher      = m + 5;
+    }
+    return true;
+}
+
+bool bmu_vic_adv_find(const uint8_t *ad, size_t len, bmu_vic_adv_t *out)
+{
+    size_t i = 0;
+    while (i < len) {
+        uint8_t flen = ad[i];
+        if (flen == 0) return false;                 /* fin des donnees utiles */
+        if (i + 1 + flen > len) return false;         /* structure tronquee */
+        if (ad[i + 1] == AD_TYPE_MFG_DATA) {
+            return parse_mfg(ad + i + 2, flen - 1u, out);
+        }
+        i += 1u + flen;
+    }
+    return false;
+}
+
+/* ── Deduplication ───────────────────────────────────────────────── */
+
+bool bmu_vic_adv_is_dup(const bmu_vic_adv_last_t *last, const bmu_vic_adv_t *adv)
+{
+    return last->valid && last->counter == adv->counter &&
+           memcmp(last->cipher, adv->cipher, BMU_VIC_ADV_CIPHER_LEN) == 0;
+}
+
+void bmu_vic_adv_remember(bmu_vic_adv_last_t *last, const bmu_vic_adv_t *adv)
+{
+    last->counter = adv->counter;
+    memcpy(last->cipher, adv->cipher, BMU_VIC_ADV_CIPHER_LEN);
+    last->valid = true;
+}
+
+/* ── Cle ─────────────────────────────────────────────────────────── */
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool bmu_vic_adv_parse_key(const char *hex, uint8_t key[16])
+{
+    for (int i = 0; i < 16; i++) {
+        int hi = hex_nibble(hex[2 * i]);
+        if (hi < 0) return false;
+        int lo = hex_nibble(hex[2 * i + 1]);
+        if (lo < 0) return false;
+        key[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return hex[32] == '\0';
+}
@@ -28,12 +28,29 @@ typedef struct {
     };
 } bmu_vic_device_t;
 
+/** Cout du traitement des annonces, cumule depuis bmu_vic_scan_init */
+typedef struct {
+    uint32_t adv_rx;          /**< Annonces recues (tous appareils) */
+    uint32_t victron_rx;      /**< Dont Victron */
+    uint32_t dup_skipped;     /**< Compteur inchange : pas de dechiffrement */
+    uint32_t no_key;          /**< Pas de cle configuree */
+    uint32_t decrypted;
+    uint32_t key_loads;       /**< Lectures NVS de cle (une par appareil et par scan) */
+    uint32_t key_schedules;   /**< Expansions AES (cle nouvelle ou changee) */
+    uint32_t handler_max_us;
+    uint64_t handler_us;      /**< Temps cumule dans le callback de scan */
+    uint64_t decrypt_us;      /**< Dont dechiffrement + decodage */
+} bmu_vic_scan_stats_t;
+
 esp_err_t bmu_vic_scan_init(void);
 esp_err_t bmu_vic_scan_start(void);
 void      bmu_vic_scan_stop(void);
 int       bmu_vic_scan_get_devices(bmu_vic_device_t *out, int max);
 const bmu_vic_device_t *bmu_vic_scan_get_device_by_mac(const uint8_t mac[6]);
 int       bmu_vic_scan_count(void);
+/** Cles relues au prochain paquet (apres modification en NVS) */
+void      bmu_vic_scan_reload_keys(void);
+void      bmu_vic_scan_get_stats(bmu_vic_scan_stats_t *out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,56 @@
+/**
+ * @file bmu_vic_adv.h
+ * @brief Annonces Victron « Instant Readout » : extraction directe depuis les
+ *        structures AD brutes et detection des trames deja dechiffrees.
+ *
+ * Les annonces non Victron sont rejetees sur la premiere structure 0xFF
+ * (donnees constructeur) sans decoder les autres champs. Un appareil ne
+ * change de compteur (nonce AES-CTR) que quand ses donnees changent : meme
+ * compteur et meme chiffre = trame deja traitee, pas de dechiffrement.
+ *
+ * Aucune dependance ESP-IDF : teste sur host (test_victron_scan).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_VIC_ADV_COMPANY_ID   0x02E1
+#define BMU_VIC_ADV_CIPHER_LEN   10
+
+typedef struct {
+    uint8_t        record_type;   /**< 0x01 solaire, 0x02 batterie, 0x03 onduleur, 0x04 DC-DC */
+    uint16_t       counter;       /**< Nonce AES-CTR */
+    const uint8_t *cipher;        /**< BMU_VIC_ADV_CIPHER_LEN octets, dans l'annonce */
+} bmu_vic_adv_t;
+
+/** Derniere trame dechiffree d'un appareil */
+typedef struct {
+    uint16_t counter;
+    uint8_t  cipher[BMU_VIC_ADV_CIPHER_LEN];
+    bool     valid;
+} bmu_vic_adv_last_t;
+
+/**
+ * @brief Cherche les donnees constructeur Victron dans une annonce brute.
+ *        Formats : [id(2)] [0x10] [pid(2)] [type] [nonce(2)] [chiffre(10)]
+ *                  [id(2)] [type] [nonce(2)] [chiffre(10)] (ancien)
+ * @return false si pas Victron, trop court ou structures AD invalides
+ */
+bool bmu_vic_adv_find(const uint8_t *ad, size_t len, bmu_vic_adv_t *out);
+
+/** Meme compteur et meme chiffre que la derniere trame dechiffree */
+bool bmu_vic_adv_is_dup(const bmu_vic_adv_last_t *last, const bmu_vic_adv_t *adv);
+void bmu_vic_adv_remember(bmu_vic_adv_last_t *last, const bmu_vic_adv_t *adv);
+
+/** Cle hexadecimale (32 caracteres) → 16 octets ; false si invalide */
+bool bmu_vic_adv_parse_key(const char *hex, uint8_t key[16]);
+
+#ifdef __cplusplus
+}
+#endif
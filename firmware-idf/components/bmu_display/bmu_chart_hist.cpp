@@ -0,0 +1,155 @@
+/**
+ * bmu_chart_hist — Historique graphique multi-niveaux (voir bmu_chart_hist.h).
+ *
+ * Pas de dependance ESP-IDF (teste sur host, test_chart_hist). Un point
+ * complet du niveau k alimente l'accumulateur du niveau k+1 : les moyennes
+ * portent sur des seaux de meme taille, min/max se propagent tels quels.
+ */
+
+#include "bmu_chart_hist.h"
+
+#include <cstring>
+
+typedef struct {
+    uint8_t  cap;        /* points dans l'anneau */
+    uint8_t  ratio;      /* points du niveau inferieur par point */
+    uint8_t  offset;     /* debut de l'anneau dans pts[] */
+    uint32_t step_ms;
+} tier_t;
+
+static const tier_t TIERS[BMU_CHART_TIERS] = {
+    { 30, 1,   0,   BMU_CHART_SAMPLE_MS },
+    { 60, 30,  30,  BMU_CHART_SAMPLE_MS * 30 },
+    { 48, 120, 90,  BMU_CHART_SAMPLE_MS * 30 * 120 },
+    { 42, 8,   138, BMU_CHART_SAMPLE_MS * 30 * 120 * 8 },
+};
+
+/* ── Conversion bornee ───────────────────────────────────────────── */
+
+static int32_t clamp(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static int32_t round_f(float x)
+{
+    if (x != x) return 0;                         /* NaN : capteur absent */
+    if (x >= 2147483647.0f) return INT32_MAX;
+    if (x <= -2147483648.0f) return INT32_MIN;
+    return (int32_t)(x < 0.0f ? x - 0.5f : x + 0.5f);
+}
+
+static int32_t div_round(int32_t sum, int32_t n)
+{
+    return sum >= 0 ? (sum + n / 2) / n : -((-sum + n / 2) / n);
+}
+
+/* ── Accumulateurs ───────────────────────────────────────────────── */
+
+static void acc_add(bmu_chart_acc_t *a, const bmu_chart_point_t *p)
+{
+    if (a->n == 0) {
+        a->v_min = p->v_min_mv;
+        a->v_max = p->v_max_mv;
+        a->i_min = p->i_min_ca;
+        a->i_max = p->i_max_ca;
+        a->v_sum = 0;
+        a->i_sum = 0;
+    } else {
+        if (p->v_min_mv < a->v_min) a->v_min = p->v_min_mv;
+        if (p->v_max_mv > a->v_max) a->v_max = p->v_max_mv;
+        if (p->i_min_ca < a->i_min) a->i_min = p->i_min_ca;
+        if (p->i_max_ca > a->i_max) a->i_max = p->i_max_ca;
+    }
+    a->v_sum += p->v_avg_mv;
+    a->i_sum += p->i_avg_ca;
+    a->n++;
+}
+
+static bmu_chart_point_t acc_point(const bmu_chart_acc_t *a)
+{
+    bmu_chart_point_t p;
+    p.v_min_mv = (uint16_t)a->v_min;
+    p.v_max_mv = (uint16_t)a->v_max;
+    p.v_avg_mv = (uint16_t)div_round(a->v_sum, a->n);
+    p.i_min_ca = (int16_t)a->i_min;
+    p.i_max_ca = (int16_t)a->i_max;
+    p.i_avg_ca = (int16_t)div_round(a->i_sum, a->n);
+    return p;
+}
+
+/* Ajoute un point complet au niveau t et le propage au niveau suivant */
+static void tier_put(bmu_chart_hist_t *h, int t, const bmu_chart_point_t *p)
+{
+    const tier_t *d = &TIERS[t];
+    h->pts[d->offset + h->head[t]] = *p;
+    h->head[t] = (uint8_t)((h->head[t] + 1) % d->cap);
+    if (h->count[t] < d->cap) h->count[t]++;
+
+    if (t + 1 >= BMU_CHART_TIERS) return;
+    bmu_chart_acc_t *a = &h->acc[t + 1];
+    acc_add(a, p);
+    if (a->n >= TIERS[t + 1].ratio) {
+        bmu_chart_point_t up = acc_point(a);
+        a->n = 0;
+        tier_put(h, t + 1, &up);
+    }
+}
+
+/* ── API ─────────────────────────────────────────────────────────── */
+
+void bmu_chart_hist_reset(bmu_chart_hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+void bmu_chart_hist_push(bmu_chart_hist_t *h, float v_mv, float i_a)
+{
+    bmu_chart_point_t p;
+    int32_t v = clamp(round_f(v_mv), 0, UINT16_MAX);
+    int32_t i = clamp(round_f(i_a * 100.0f), INT16_MIN, INT16_MAX);
+    p.v_min_mv = p.v_max_mv = p.v_avg_mv = (uint16_t)v;
+    p.i_min_ca = p.i_max_ca = p.i_avg_ca = (int16_t)i;
+    tier_put(h, 0, &p);
+}
+
+bool bmu_chart_hist_last(const bmu_chart_hist_t *h, float *v_mv, float *i_a)
+{
+    if (h->count[0] == 0) return false;
+    int last = (h->head[0] + TIERS[0].cap - 1) % TIERS[0].cap;
+    const bmu_chart_point_t *p = &h->pts[TIERS[0].offset + last];
+    if (v_mv) *v_mv = (float)p->v_avg_mv;
+    if (i_a)  *i_a  = (float)p->i_avg_ca / 100.0f;
+    return true;
+}
+
+int bmu_chart_hist_read(const bmu_chart_hist_t *h, int tier,
+                        bmu_chart_point_t *out, int max)
+{
+    if (tier < 0 || tier >= BMU_CHART_TIERS || max <= 0) return 0;
+    const tier_t *d = &TIERS[tier];
+    bool partial = tier > 0 && h->acc[tier].n > 0;
+
+    /* Le point en cours prend la place du plus ancien si l'anneau est plein */
+    int n = h->count[tier] + (partial ? 1 : 0);
+    if (n > d->cap) n = d->cap;
+    if (n > max) n = max;
+    int stored = n - (partial ? 1 : 0);
+
+    for (int k = 0; k < stored; k++) {
+        int idx = (h->head[tier] + d->cap - stored + k) % d->cap;
+        out[k] = h->pts[d->offset + idx];
+    }
+    if (partial) out[stored] = acc_point(&h->acc[tier]);
+    return n;
+}
+
+int bmu_chart_hist_capacity(int tier)
+{
+    return tier >= 0 && tier < BMU_CHART_TIERS ? TIERS[tier].cap : 0;
+}
+
+uint32_t bmu_chart_hist_step_ms(int tier)
+{
+    return tier >= 0 && tier < BMU_CHART_TIERS ? TIERS[tier].step_ms : 0;
+}
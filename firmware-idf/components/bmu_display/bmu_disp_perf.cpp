@@ -0,0 +1,106 @@
+/**
+ * bmu_disp_perf — Mesure du rendu LVGL (voir bmu_disp_perf.h).
+ *
+ * Pas de dependance ESP-IDF (teste sur host, test_disp_perf). Avec deux
+ * buffers, le flush d'un bandeau recouvre le rendu du suivant : seul le
+ * temps ou la tache LVGL est dans flush_cb ou attend le DMA est compte en
+ * flush, le reste de l'image est du rendu.
+ */
+
+#include "bmu_disp_perf.h"
+
+#include <cstring>
+
+void bmu_disp_perf_init(bmu_disp_perf_t *p, uint32_t panel_px)
+{
+    memset(p, 0, sizeof(*p));
+    p->tot.panel_px = panel_px;
+}
+
+/* ── Evenements de l'affichage ───────────────────────────────────── */
+
+void bmu_disp_perf_invalidate(bmu_disp_perf_t *p, int32_t w, int32_t h)
+{
+    if (w <= 0 || h <= 0) return;
+    /* Zones non fusionnees : la somme peut depasser le panneau */
+    uint64_t a = (uint64_t)p->frame_area_px + (uint64_t)w * (uint64_t)h;
+    p->frame_area_px = a > p->tot.panel_px ? p->tot.panel_px : (uint32_t)a;
+}
+
+void bmu_disp_perf_frame_start(bmu_disp_perf_t *p, int64_t now_us)
+{
+    p->frame_start_us = now_us;
+    p->frame_flush_us = 0;
+    p->in_frame = true;
+    p->in_flush = false;
+}
+
+void bmu_disp_perf_flush_start(bmu_disp_perf_t *p, int64_t now_us)
+{
+    if (!p->in_frame || p->in_flush) return;
+    p->flush_start_us = now_us;
+    p->in_flush = true;
+}
+
+void bmu_disp_perf_flush_end(bmu_disp_perf_t *p, int64_t now_us)
+{
+    if (!p->in_frame || !p->in_flush) return;
+    int64_t d = now_us - p->flush_start_us;
+    if (d > 0) p->frame_flush_us += (uint32_t)d;
+    p->in_flush = false;
+}
+
+void bmu_disp_perf_frame_end(bmu_disp_perf_t *p, int64_t now_us)
+{
+    if (!p->in_frame) return;
+    if (p->in_flush) bmu_disp_perf_flush_end(p, now_us);
+    p->in_frame = false;
+
+    /* Cycle de rafraichissement a vide : rien invalide, rien envoye */
+    if (p->frame_area_px == 0 && p->frame_flush_us == 0) return;
+
+    int64_t d = now_us - p->frame_start_us;
+    uint32_t total = d > 0 ? (uint32_t)d : 0;
+    uint32_t flush = p->frame_flush_us > total ? total : p->frame_flush_us;
+
+    p->tot.frames++;
+    p->tot.render_us += total - flush;
+    p->tot.flush_us  += flush;
+    p->tot.area_px   += p->frame_area_px;
+    if (total > BMU_DISP_PERF_SLOW_US) p->tot.slow++;
+    p->frame_area_px = 0;
+}
+
+/* ── Lecture ─────────────────────────────────────────────────────── */
+
+void bmu_disp_perf_read(const bmu_disp_perf_t *p, int64_t now_us,
+                        bmu_disp_perf_totals_t *out)
+{
+    *out = p->tot;
+    out->t_us = now_us;
+}
+
+void bmu_disp_perf_stats(const bmu_disp_perf_totals_t *prev,
+                         const bmu_disp_perf_totals_t *cur,
+                         bmu_disp_perf_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    int64_t dt = cur->t_us - prev->t_us;
+    uint32_t n = cur->frames - prev->frames;
+    if (dt <= 0) return;
+
+    uint64_t render = cur->render_us - prev->render_us;
+    uint64_t flush  = cur->flush_us - prev->flush_us;
+    out->frames   = n;
+    out->slow     = cur->slow - prev->slow;
+    out->fps      = (float)n * 1e6f / (float)dt;
+    out->load_pct = (float)(render + flush) * 100.0f / (float)dt;
+    if (n == 0) return;
+
+    out->render_ms = (float)render / (float)n / 1000.0f;
+    out->flush_ms  = (float)flush / (float)n / 1000.0f;
+    if (cur->panel_px > 0) {
+        out->area_pct = (float)(cur->area_px - prev->area_px) * 100.0f
+                        / ((float)n * (float)cur->panel_px);
+    }
+}
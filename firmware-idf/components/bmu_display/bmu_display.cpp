@@ -5,6 +5,15 @@
  * Ecrans : Batteries | SOH | Systeme | Alertes | Config
  * Navigation : swipe horizontal ou tap sur les onglets en bas.
  * Tap sur une cellule batterie → ecran detail en overlay.
+ *
+ * Rafraichissement incremental : seul l'onglet visible est mis a jour, si
+ * une des donnees qu'il declare (SCREENS[]) a change, et les widgets ne
+ * sont touches que si leur valeur formatee change (setters bmu_ui_set_*).
+ *
+ * Rendu partiel : buffers de CONFIG_BMU_DISPLAY_BUF_LINES lignes (simples ou
+ * doubles, RAM interne DMA ou PSRAM selon Kconfig), seules les zones
+ * invalidees sont dessinees et envoyees. Chaque image est mesuree
+ * (bmu_disp_perf) : page debug et MQTT bmu/{device}/display.
  */
 
 #include "bmu_display.h"
@@ -12,6 +21,9 @@
 #include "bmu_vedirect.h"
 #include "bmu_climate.h"
 #include "bmu_ina237.h"
+#include "bmu_ble.h"
+#include "bmu_wifi.h"
+#include "bmu_mqtt.h"
 
 #include "bsp/esp-bsp.h"
 #include "esp_log.h"
@@ -36,9 +48,55 @@ static bool s_update_req = false;
 static bool s_ui_ready = false;
 static esp_timer_handle_t s_periodic_timer = NULL;
 
-/* Compteur pour le push chart (500ms = toutes les 1 iteration @ 500ms refresh) */
+/* Compteur pour le push chart : un echantillon toutes les BMU_CHART_SAMPLE_MS,
+ * exactement — les durees des niveaux de bmu_chart_hist en dependent */
 static int s_chart_push_counter = 0;
-#define CHART_PUSH_INTERVAL  1  // 1 * 500ms = 500ms
+#define CHART_PUSH_TICKS     (BMU_CHART_SAMPLE_MS / CONFIG_BMU_DISPLAY_REFRESH_MS)
+static_assert(CONFIG_BMU_DISPLAY_REFRESH_MS <= BMU_CHART_SAMPLE_MS &&
+              BMU_CHART_SAMPLE_MS % CONFIG_BMU_DISPLAY_REFRESH_MS == 0,
+              "BMU_DISPLAY_REFRESH_MS doit diviser BMU_CHART_SAMPLE_MS");
+
+/* ── Ecrans et dependances ─────────────────────────────────────────── */
+
+enum { TAB_BATT = 0, TAB_SOH, TAB_SYS, TAB_ALERTS, TAB_CONFIG, TAB_COUNT };
+
+typedef struct {
+    void     (*update)(bmu_ui_ctx_t *ctx);
+    uint32_t deps;            /* bmu_ui_dep_t : 0 = jamais rafraichi par le timer */
+} screen_desc_t;
+
+static void config_update(bmu_ui_ctx_t *ctx)
+{
+    (void)ctx;
+    bmu_ui_config_update();
+}
+
+/* Alertes : mises a jour a l'ajout (bmu_ui_alerts_add) ; Config statique */
+static const screen_desc_t SCREENS[TAB_COUNT] = {
+    /* TAB_BATT : bmu_ui_main_update gere grille OU detail selon nav state */
+    { bmu_ui_main_update,
+      BMU_UI_DEP_FLEET | BMU_UI_DEP_CHART | BMU_UI_DEP_LINKS | BMU_UI_DEP_ENV },
+    /* TAB_SOH */
+    { bmu_ui_soh_update,    BMU_UI_DEP_HEALTH | BMU_UI_DEP_CLOCK },
+    /* TAB_SYS */
+    { bmu_ui_system_update, BMU_UI_DEP_LINKS | BMU_UI_DEP_ENV | BMU_UI_DEP_CLOCK },
+    /* TAB_ALERTS */
+    { NULL,                 0 },
+    /* TAB_CONFIG */
+    { config_update,        0 },
+};
+
+/* Periodes des dependances lentes, en ticks de CONFIG_BMU_DISPLAY_REFRESH_MS */
+#define DEP_ENV_TICKS     ((2000 + CONFIG_BMU_DISPLAY_REFRESH_MS - 1) / CONFIG_BMU_DISPLAY_REFRESH_MS)
+#define DEP_HEALTH_TICKS  ((10000 + CONFIG_BMU_DISPLAY_REFRESH_MS - 1) / CONFIG_BMU_DISPLAY_REFRESH_MS)
+
+static uint32_t s_tick = 0;
+static uint8_t  s_nb_seen = 0;
+static uint8_t  s_links = 0xFF;       /* BLE | WiFi << 1 | MQTT << 2 au tick precedent */
+static uint32_t s_uptime_min = UINT32_MAX;
+static int      s_shown_tab = -1;     /* dernier ecran mis a jour */
+static bool     s_shown_detail = false;
+static uint32_t s_pending_dirty = 0;  /* bits accumules si le lock etait pris */
 
 /* ── Runtime UI context sync ───────────────────────────────────────── */
 
@@ -86,6 +144,45 @@ static void backlight_check_dim(void)
     }
 }
 
+/* ── Mesure du rendu (evenements de l'affichage, tache LVGL) ──────── */
+
+static bmu_disp_perf_t s_perf;
+static portMUX_TYPE s_perf_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void perf_event_cb(lv_event_t *e)
+{
+    const int64_t now = esp_timer_get_time();
+    const lv_event_code_t code = lv_event_get_code(e);
+
+    taskENTER_CRITICAL(&s_perf_mux);
+    switch (code) {
+    case LV_EVENT_INVALIDATE_AREA: {
+        const lv_area_t *a = (const lv_area_t *)lv_event_get_param(e);
+        if (a != NULL) {
+            bmu_disp_perf_invalidate(&s_perf, lv_area_get_width(a), lv_area_get_height(a));
+        }
+        break;
+    }
+    case LV_EVENT_REFR_START:
+        bmu_disp_perf_frame_start(&s_perf, now);
+        break;
+    case LV_EVENT_FLUSH_START:
+    case LV_EVENT_FLUSH_WAIT_START:
+        bmu_disp_perf_flush_start(&s_perf, now);
+        break;
+    case LV_EVENT_FLUSH_FINISH:
+    case LV_EVENT_FLUSH_WAIT_FINISH:
+        bmu_disp_perf_flush_end(&s_perf, now);
+        break;
+    case LV_EVENT_REFR_READY:
+        bmu_disp_perf_frame_end(&s_perf, now);
+        break;
+    default:
+        break;
+    }
+    taskEXIT_CRITICAL(&s_perf_mux);
+}
+
 /* ── Chart history push (500ms) ────────────────────────────────────── */
 
 static void chart_history_push_all(void)
@@ -99,8 +196,70 @@ static void chart_history_push_all(void)
             v_mv = bmu_protection_get_voltage(s_ui_ctx.prot, i);
         }
         float i_a = bmu_battery_manager_get_last_current_a(s_ui_ctx.mgr, i);
-        bmu_chart_history_push(&s_ui_ctx.chart_hist[i], v_mv, i_a);
+        bmu_chart_hist_push(&s_ui_ctx.chart_hist[i], v_mv, i_a);
+    }
+}
+
+/* ── Dependances modifiees depuis le tick precedent ─────────────────── */
+
+static uint32_t collect_dirty(bool chart_pushed)
+{
+    uint32_t dirty = BMU_UI_DEP_FLEET;
+    if (chart_pushed) dirty |= BMU_UI_DEP_CHART;
+
+    /* Batterie ajoutee / retiree : lignes a creer sur tous les ecrans */
+    if (s_ui_ctx.nb_ina != s_nb_seen) {
+        s_nb_seen = s_ui_ctx.nb_ina;
+        dirty |= BMU_UI_DEP_ALL;
+    }
+
+    uint8_t links = (uint8_t)((bmu_ble_is_connected() ? 1 : 0) |
+                              (bmu_wifi_is_connected() ? 2 : 0) |
+                              (bmu_mqtt_is_connected() ? 4 : 0));
+    if (links != s_links) {
+        s_links = links;
+        dirty |= BMU_UI_DEP_LINKS;
+    }
+
+    uint32_t minutes = (uint32_t)(esp_timer_get_time() / 60000000LL);
+    if (minutes != s_uptime_min) {
+        s_uptime_min = minutes;
+        dirty |= BMU_UI_DEP_CLOCK;
+    }
+
+    if (s_tick % DEP_ENV_TICKS == 0)    dirty |= BMU_UI_DEP_ENV;
+    if (s_tick % DEP_HEALTH_TICKS == 0) dirty |= BMU_UI_DEP_HEALTH;
+    s_tick++;
+    return dirty;
+}
+
+/* Met a jour l'ecran visible ; tout est sale a l'affichage d'un ecran ou
+ * a l'ouverture / fermeture du detail. Appele sous le lock LVGL. */
+static void update_visible_screen(uint32_t dirty)
+{
+    int tab = (int)lv_tabview_get_tab_active(s_tabview);
+    if (tab < 0 || tab >= TAB_COUNT) return;
+
+    if (tab != s_shown_tab || s_nav.detail_visible != s_shown_detail) {
+        dirty = BMU_UI_DEP_ALL;
+        s_shown_tab = tab;
+        s_shown_detail = s_nav.detail_visible;
     }
+
+    const screen_desc_t *scr = &SCREENS[tab];
+    if (scr->update == NULL || (scr->deps & dirty) == 0) return;
+    s_ui_ctx.dirty = scr->deps & dirty;
+    scr->update(&s_ui_ctx);
+}
+
+/* Changement d'onglet (tache LVGL, lock deja pris) : rafraichir tout de
+ * suite l'ecran qui apparait, sans attendre le tick suivant. */
+static void tab_changed_cb(lv_event_t *e)
+{
+    (void)e;
+    if (!s_ui_ready) return;
+    sync_ui_runtime_state();
+    update_visible_screen(0);
 }
 
 /* ── Periodic update (timer callback) ──────────────────────────────── */
@@ -114,20 +273,21 @@ static void display_periodic_cb(void *arg)
 
     sync_ui_runtime_state();
 
-    /* Push chart data toutes les 500ms */
+    /* Push chart data toutes les BMU_CHART_SAMPLE_MS (capture meme si l'ecran est cache) */
+    bool chart_pushed = false;
     s_chart_push_counter++;
-    if (s_chart_push_counter >= CHART_PUSH_INTERVAL) {
+    if (s_chart_push_counter >= CHART_PUSH_TICKS) {
         s_chart_push_counter = 0;
         chart_history_push_all();
+        chart_pushed = true;
     }
 
+    /* Sources lues hors lock : le lock LVGL ne couvre que l'ecran visible */
+    s_pending_dirty |= collect_dirty(chart_pushed);
+
     if (bsp_display_lock(0)) {
-        /* bmu_ui_main_update gere : grille OU detail selon nav state */
-        bmu_ui_main_update(&s_ui_ctx);
-        bmu_ui_soh_update(&s_ui_ctx);
-        bmu_ui_system_update(&s_ui_ctx);
-        /* alerts update on demand only */
-        bmu_ui_config_update();
+        update_visible_screen(s_pending_dirty);
+        s_pending_dirty = 0;
 
         if (s_update_req) {
             s_update_req = false;
@@ -157,10 +317,10 @@ esp_err_t bmu_display_init(bmu_display_ctx_t *ctx)
     s_nav.detail_battery = -1;
     s_nav.detail_panel = NULL;
 
-    /* Allocate chart history in PSRAM (32 × 4.8KB = 153KB) */
+    /* Allocate chart history in PSRAM (32 × ~2.2KB = 73KB, 4 niveaux jusqu'a 7 j) */
     if (s_ui_ctx.chart_hist == NULL) {
-        s_ui_ctx.chart_hist = (bmu_chart_history_t *)heap_caps_calloc(
-            BMU_MAX_BATTERIES, sizeof(bmu_chart_history_t), MALLOC_CAP_SPIRAM);
+        s_ui_ctx.chart_hist = (bmu_chart_hist_t *)heap_caps_calloc(
+            BMU_MAX_BATTERIES, sizeof(bmu_chart_hist_t), MALLOC_CAP_SPIRAM);
         if (s_ui_ctx.chart_hist == NULL) {
             ESP_LOGE(TAG, "chart_hist PSRAM alloc failed!");
         }
@@ -168,15 +328,25 @@ esp_err_t bmu_display_init(bmu_display_ctx_t *ctx)
 
     ESP_LOGI(TAG, "=== Initialisation affichage BMU via BSP BOX-3 ===");
 
-    /* Init display via BSP — utiliser PSRAM pour le buffer LVGL
-     * (la RAM interne est trop petite pour un framebuffer 320x240x2=150KB) */
+    /* Init display via BSP — rendu partiel par bandeaux (pas de framebuffer
+     * 320x240x2 = 150KB). Buffers en RAM interne DMA : rendu et envoi SPI
+     * directs ; en PSRAM : RAM interne liberee, rendu plus lent (cache). */
     bsp_display_cfg_t disp_cfg = {
         .lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG(),
-        .buffer_size = BSP_LCD_H_RES * 20, /* 20 lignes = 12.8 KB — petit buffer en RAM interne */
+        .buffer_size = BSP_LCD_H_RES * CONFIG_BMU_DISPLAY_BUF_LINES,
+#if CONFIG_BMU_DISPLAY_DOUBLE_BUFFER
+        .double_buffer = 1,        /* rendu du bandeau N+1 pendant le DMA du N */
+#else
         .double_buffer = 0,
+#endif
         .flags = {
-            .buff_dma = true,      /* DMA en RAM interne */
-            .buff_spiram = false,  /* Pas PSRAM (DMA SPI incompatible) */
+#if CONFIG_BMU_DISPLAY_BUF_PSRAM
+            .buff_dma = false,
+            .buff_spiram = true,
+#else
+            .buff_dma = true,
+            .buff_spiram = false,
+#endif
         }
     };
     s_disp = bsp_display_start_with_config(&disp_cfg);
@@ -184,12 +354,19 @@ esp_err_t bmu_display_init(bmu_display_ctx_t *ctx)
         ESP_LOGE(TAG, "bsp_display_start a echoue");
         return ESP_FAIL;
     }
+    ESP_LOGI(TAG, "Buffers LVGL : %d x %u o en %s",
+             disp_cfg.double_buffer ? 2 : 1,
+             (unsigned)(BSP_LCD_H_RES * CONFIG_BMU_DISPLAY_BUF_LINES * sizeof(lv_color16_t)),
+             disp_cfg.flags.buff_spiram ? "PSRAM" : "RAM interne DMA");
 
     if (!bsp_display_lock(0)) {
         ESP_LOGE(TAG, "Impossible de prendre le lock LVGL");
         return ESP_FAIL;
     }
 
+    bmu_disp_perf_init(&s_perf, (uint32_t)BSP_LCD_H_RES * BSP_LCD_V_RES);
+    lv_display_add_event_cb(s_disp, perf_event_cb, LV_EVENT_ALL, NULL);
+
     /* ── Fond noir pur ────────────────────────────────────────────── */
     lv_obj_set_style_bg_color(lv_scr_act(), UI_COLOR_BG, 0);
 
@@ -230,6 +407,8 @@ esp_err_t bmu_display_init(bmu_display_ctx_t *ctx)
     bmu_ui_alerts_create(tab_alerts);
     bmu_ui_config_create(tab_config);
 
+    lv_obj_add_event_cb(s_tabview, tab_changed_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
     s_ui_ready = true;
     bsp_display_unlock();
 
@@ -269,13 +448,21 @@ esp_err_t bmu_display_start_updates(void)
         s_periodic_timer,
         CONFIG_BMU_DISPLAY_REFRESH_MS * 1000ULL));
 
-    ESP_LOGI(TAG, "=== Display updates started (refresh=%dms, dim=%ds, chart=%d pts) ===",
+    ESP_LOGI(TAG, "=== Display updates started (refresh=%dms, dim=%ds, chart=%u B/batt) ===",
              CONFIG_BMU_DISPLAY_REFRESH_MS,
              CONFIG_BMU_DISPLAY_BL_DIM_TIMEOUT_S,
-             CONFIG_BMU_CHART_HISTORY_POINTS);
+             (unsigned)sizeof(bmu_chart_hist_t));
     return ESP_OK;
 }
 
+void bmu_display_get_perf(bmu_disp_perf_totals_t *out)
+{
+    const int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_perf_mux);
+    bmu_disp_perf_read(&s_perf, now, out);
+    taskEXIT_CRITICAL(&s_perf_mux);
+}
+
 void bmu_display_request_update(void)
 {
     s_update_req = true;
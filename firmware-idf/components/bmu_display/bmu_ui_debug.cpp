@@ -4,10 +4,13 @@
  *
  * Utile pour le debug terrain sans cable serie.
  * Ring buffer de 30 messages, affichage scrollable, couleurs par type.
+ * Ligne rendu LVGL : images/s, temps de rendu et de flush, surface
+ * invalidee et charge, moyennes depuis la mise a jour precedente.
  * Section supplementaire : resistance interne par batterie (si BMU_RINT_ENABLED).
  */
 
 #include "bmu_ui.h"
+#include "bmu_display.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <cstdio>
@@ -35,6 +38,8 @@ static int device_count = 0;
 static lv_obj_t *status_label = NULL;
 static lv_obj_t *error_label = NULL;
 static lv_obj_t *log_container = NULL;
+static lv_obj_t *perf_label = NULL;
+static bmu_disp_perf_totals_t s_perf_prev = {};
 
 #if CONFIG_BMU_RINT_ENABLED
 static lv_obj_t *s_rint_labels[BMU_MAX_BATTERIES] = {};
@@ -120,10 +125,18 @@ void bmu_ui_debug_create(lv_obj_t *parent)
     lv_obj_set_style_text_font(error_label, &lv_font_montserrat_14, 0);
     lv_obj_align(error_label, LV_ALIGN_TOP_LEFT, 8, 40);
 
+    /* Rendu LVGL (bmu_disp_perf) */
+    perf_label = lv_label_create(parent);
+    lv_label_set_text(perf_label, "LVGL: --");
+    lv_obj_set_style_text_color(perf_label, lv_color_hex(0x40C4FF), 0);
+    lv_obj_set_style_text_font(perf_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(perf_label, LV_ALIGN_TOP_LEFT, 8, 54);
+    bmu_display_get_perf(&s_perf_prev);
+
     /* Conteneur scrollable pour le log */
     log_container = lv_obj_create(parent);
-    lv_obj_set_size(log_container, 310, 180);
-    lv_obj_align(log_container, LV_ALIGN_TOP_MID, 0, 56);
+    lv_obj_set_size(log_container, 310, 148);
+    lv_obj_align(log_container, LV_ALIGN_TOP_MID, 0, 88);
     lv_obj_set_style_bg_color(log_container, lv_color_hex(0x121212), 0);
     lv_obj_set_style_border_width(log_container, 0, 0);
     lv_obj_set_style_radius(log_container, 4, 0);
@@ -206,6 +219,22 @@ void bmu_ui_debug_update(void)
              (unsigned long)error_count, (unsigned long)nack_count, (unsigned long)timeout_count);
     lv_label_set_text(error_label, buf);
 
+    /* Rendu LVGL depuis la mise a jour precedente */
+    if (perf_label != NULL) {
+        bmu_disp_perf_totals_t cur;
+        bmu_disp_perf_stats_t st;
+        bmu_display_get_perf(&cur);
+        bmu_disp_perf_stats(&s_perf_prev, &cur, &st);
+        s_perf_prev = cur;
+        char pbuf[96];
+        snprintf(pbuf, sizeof(pbuf),
+                 "LVGL: %.1f fps  lentes: %lu  charge: %.0f%%\n"
+                 "Rendu %.1f ms  Flush %.1f ms  Zone %.0f%%",
+                 st.fps, (unsigned long)st.slow, st.load_pct,
+                 st.render_ms, st.flush_ms, st.area_pct);
+        bmu_ui_set_text(perf_label, pbuf);
+    }
+
     /* Rafraichir le log (clear + rebuild — approche simple pour <30 items) */
     if (log_container == NULL) return;
     lv_obj_clean(log_container);
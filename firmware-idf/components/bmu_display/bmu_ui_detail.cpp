@@ -3,7 +3,9 @@
  * @brief Ecran detail batterie — graphique V/I + valeurs + boutons actions.
  *
  * Cree dynamiquement au tap sur une cellule, detruit au retour.
- * Utilise lv_chart pour l'historique temps reel.
+ * Utilise lv_chart pour l'historique (bmu_chart_hist) : tap sur le graphique
+ * = niveau suivant (15 s → 15 min → 24 h → 7 j). Au-dela de 15 s, la tension
+ * est tracee avec son enveloppe min/max.
  */
 
 #include "bmu_ui.h"
@@ -22,6 +24,11 @@ static lv_obj_t *s_panel = NULL;          // panneau overlay principal
 static lv_obj_t *s_chart = NULL;          // lv_chart widget
 static lv_chart_series_t *s_ser_v = NULL; // serie tension
 static lv_chart_series_t *s_ser_i = NULL; // serie courant
+static lv_chart_series_t *s_ser_vmin = NULL; // enveloppe tension (niveaux >= 1)
+static lv_chart_series_t *s_ser_vmax = NULL;
+static lv_obj_t *s_zoom_label = NULL;
+static int s_tier = 0;                    // niveau affiche, garde entre batteries
+static const char *const TIER_NAMES[BMU_CHART_TIERS] = { "15 s", "15 min", "24 h", "7 j" };
 static lv_obj_t *s_val_labels[8] = {};    // labels valeurs numeriques
 static int s_battery_idx = -1;
 static bmu_ui_ctx_t *s_ctx_ref = NULL;
@@ -74,20 +81,64 @@ static lv_color_t state_color(bmu_battery_state_t s)
 
 /* ── Auto-scale graphique Y ───────────────────────────────────────── */
 
-static void update_chart_range(bmu_chart_history_t *hist)
+static void update_chart_range(const bmu_chart_point_t *pts, int n)
 {
-    if (hist->count == 0) return;
-    float v_min = 35000, v_max = 15000;
-    for (int i = 0; i < hist->count; i++) {
-        int idx = (hist->head - hist->count + i + CONFIG_BMU_CHART_HISTORY_POINTS) % CONFIG_BMU_CHART_HISTORY_POINTS;
-        float v = hist->voltage_mv[idx];
-        if (v > 0 && v < v_min) v_min = v;
-        if (v > v_max) v_max = v;
+    if (n == 0) return;
+    int32_t v_min = 35000, v_max = 15000;
+    for (int i = 0; i < n; i++) {
+        /* Enveloppe affichee au-dela du niveau 0 : l'echelle la contient */
+        int32_t lo = s_tier > 0 ? pts[i].v_min_mv : pts[i].v_avg_mv;
+        int32_t hi = s_tier > 0 ? pts[i].v_max_mv : pts[i].v_avg_mv;
+        if (lo > 0 && lo < v_min) v_min = lo;
+        if (hi > v_max) v_max = hi;
     }
-    float margin = (v_max - v_min) * 0.1f;
+    int32_t margin = (v_max - v_min) / 10;
     if (margin < 500) margin = 500;
-    lv_chart_set_range(s_chart, LV_CHART_AXIS_PRIMARY_Y,
-                       (int)(v_min - margin), (int)(v_max + margin));
+    lv_chart_set_range(s_chart, LV_CHART_AXIS_PRIMARY_Y, v_min - margin, v_max + margin);
+}
+
+/* ── Trace d'un niveau d'historique ───────────────────────────────── */
+
+static void draw_chart(const bmu_chart_hist_t *h)
+{
+    static bmu_chart_point_t pts[BMU_CHART_MAX_POINTS];
+    int n = bmu_chart_hist_read(h, s_tier, pts, BMU_CHART_MAX_POINTS);
+    int cap = bmu_chart_hist_capacity(s_tier);
+
+    /* Points alignes a droite : le plus recent au bord */
+    for (int i = 0; i < cap; i++) {
+        int k = i - (cap - n);
+        if (k >= 0) {
+            lv_chart_set_value_by_id(s_chart, s_ser_v, i, pts[k].v_avg_mv);
+            lv_chart_set_value_by_id(s_chart, s_ser_i, i, pts[k].i_avg_ca * 10);
+            lv_chart_set_value_by_id(s_chart, s_ser_vmin, i,
+                                     s_tier > 0 ? pts[k].v_min_mv : LV_CHART_POINT_NONE);
+            lv_chart_set_value_by_id(s_chart, s_ser_vmax, i,
+                                     s_tier > 0 ? pts[k].v_max_mv : LV_CHART_POINT_NONE);
+        } else {
+            lv_chart_set_value_by_id(s_chart, s_ser_v, i, LV_CHART_POINT_NONE);
+            lv_chart_set_value_by_id(s_chart, s_ser_i, i, LV_CHART_POINT_NONE);
+            lv_chart_set_value_by_id(s_chart, s_ser_vmin, i, LV_CHART_POINT_NONE);
+            lv_chart_set_value_by_id(s_chart, s_ser_vmax, i, LV_CHART_POINT_NONE);
+        }
+        if ((i % 20) == 19) vTaskDelay(1); /* Yield pour le watchdog */
+    }
+
+    /* Auto-scale axe Y tension */
+    update_chart_range(pts, n);
+    lv_chart_refresh(s_chart);
+}
+
+static void chart_zoom_cb(lv_event_t *e)
+{
+    (void)e;
+    if (s_chart == NULL || s_ctx_ref == NULL || s_battery_idx < 0) return;
+    s_tier = (s_tier + 1) % BMU_CHART_TIERS;
+    lv_chart_set_point_count(s_chart, (uint32_t)bmu_chart_hist_capacity(s_tier));
+    bmu_ui_set_text(s_zoom_label, TIER_NAMES[s_tier]);
+    if (s_ctx_ref->chart_hist != NULL) {
+        draw_chart(&s_ctx_ref->chart_hist[s_battery_idx]);
+    }
 }
 
 /* ── Dialog confirmation switch ──────────────────────────────────── */
@@ -237,7 +288,7 @@ void bmu_ui_detail_create(lv_obj_t *parent, bmu_ui_ctx_t *ctx, int idx)
     lv_obj_set_size(s_chart, 150, 90);
     lv_obj_align(s_chart, LV_ALIGN_TOP_LEFT, 0, 26);
     lv_chart_set_type(s_chart, LV_CHART_TYPE_LINE);
-    lv_chart_set_point_count(s_chart, 30);  /* 30 points (15s a 500ms) — moins de RAM + plus rapide */
+    lv_chart_set_point_count(s_chart, (uint32_t)bmu_chart_hist_capacity(s_tier));
     lv_obj_set_style_bg_color(s_chart, lv_color_hex(0x121212), 0);
     lv_obj_set_style_border_color(s_chart, UI_COLOR_TEXT_DIM, 0);
     lv_obj_set_style_border_width(s_chart, 1, 0);
@@ -247,7 +298,9 @@ void bmu_ui_detail_create(lv_obj_t *parent, bmu_ui_ctx_t *ctx, int idx)
     lv_chart_set_div_line_count(s_chart, 3, 0);
     vTaskDelay(1); /* Yield avant add_series */
 
-    /* Serie tension (axe Y primaire) — bleu */
+    /* Enveloppe min/max (sous la moyenne) puis serie tension (axe Y primaire) — bleu */
+    s_ser_vmin = lv_chart_add_series(s_chart, UI_COLOR_BORDER, LV_CHART_AXIS_PRIMARY_Y);
+    s_ser_vmax = lv_chart_add_series(s_chart, UI_COLOR_BORDER, LV_CHART_AXIS_PRIMARY_Y);
     s_ser_v = lv_chart_add_series(s_chart, UI_COLOR_INFO, LV_CHART_AXIS_PRIMARY_Y);
     int32_t min_mv = BMU_MIN_VOLTAGE_MV;
     int32_t max_mv = BMU_MAX_VOLTAGE_MV;
@@ -259,6 +312,15 @@ void bmu_ui_detail_create(lv_obj_t *parent, bmu_ui_ctx_t *ctx, int idx)
     lv_chart_set_range(s_chart, LV_CHART_AXIS_SECONDARY_Y, -5000, 30000);
     vTaskDelay(1); /* Yield apres series */
 
+    /* Tap sur le graphique : niveau d'historique suivant */
+    lv_obj_add_flag(s_chart, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(s_chart, chart_zoom_cb, LV_EVENT_CLICKED, NULL);
+    s_zoom_label = lv_label_create(s_chart);
+    lv_label_set_text(s_zoom_label, TIER_NAMES[s_tier]);
+    lv_obj_set_style_text_color(s_zoom_label, UI_COLOR_TEXT_DIM, 0);
+    lv_obj_set_style_text_font(s_zoom_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(s_zoom_label, LV_ALIGN_TOP_LEFT, 0, 0);
+
     /* ── Valeurs numeriques (moitie droite) ───────────────────────── */
     const char *labels[] = {
         "V:", "I:", "P:", "T:",
@@ -312,7 +374,8 @@ void bmu_ui_detail_create(lv_obj_t *parent, bmu_ui_ctx_t *ctx, int idx)
     lv_obj_center(lbl_rst);
     lv_obj_add_event_cb(btn_reset, reset_btn_cb, LV_EVENT_CLICKED, NULL);
 
-    /* Premiere mise a jour */
+    /* Premiere mise a jour, graphique compris */
+    ctx->dirty = BMU_UI_DEP_ALL;
     bmu_ui_detail_update(ctx, idx);
 
     ESP_LOGI(TAG, "Detail cree pour BAT %d", idx + 1);
@@ -332,25 +395,24 @@ void bmu_ui_detail_update(bmu_ui_ctx_t *ctx, int idx)
     int nb_sw = 0;
     esp_err_t nb_sw_ret = bmu_protection_get_switch_count(ctx->prot, idx, &nb_sw);
 
-    /* Calculer courant et puissance depuis l'historique */
-    bmu_chart_history_t *h = (ctx->chart_hist != NULL) ? &ctx->chart_hist[idx] : NULL;
+    /* Courant : dernier echantillon de l'historique */
+    bmu_chart_hist_t *h = (ctx->chart_hist != NULL) ? &ctx->chart_hist[idx] : NULL;
     float i_a = 0.0f;
-    if (h != NULL && h->count > 0) {
-        int last = (h->head - 1 + CONFIG_BMU_CHART_HISTORY_POINTS) % CONFIG_BMU_CHART_HISTORY_POINTS;
-        i_a = h->current_a[last];
+    if (h != NULL) {
+        bmu_chart_hist_last(h, NULL, &i_a);
     }
     float p_w = v * i_a;
 
     /* Valeurs numeriques */
     char buf[20];
     snprintf(buf, sizeof(buf), "%.2fV", v);
-    lv_label_set_text(s_val_labels[0], buf);
+    bmu_ui_set_text(s_val_labels[0], buf);
 
     snprintf(buf, sizeof(buf), "%.2f A", i_a);
-    lv_label_set_text(s_val_labels[1], buf);
+    bmu_ui_set_text(s_val_labels[1], buf);
 
     snprintf(buf, sizeof(buf), "%.1f W", p_w);
-    lv_label_set_text(s_val_labels[2], buf);
+    bmu_ui_set_text(s_val_labels[2], buf);
 
     /* Temperature depuis AHT30 */
     if (bmu_climate_is_available()) {
@@ -358,48 +420,28 @@ void bmu_ui_detail_update(bmu_ui_ctx_t *ctx, int idx)
     } else {
         snprintf(buf, sizeof(buf), "---");
     }
-    lv_label_set_text(s_val_labels[3], buf);
+    bmu_ui_set_text(s_val_labels[3], buf);
 
     snprintf(buf, sizeof(buf), "%.3f", ah_c);
-    lv_label_set_text(s_val_labels[4], buf);
+    bmu_ui_set_text(s_val_labels[4], buf);
 
     snprintf(buf, sizeof(buf), "%.3f", ah_d);
-    lv_label_set_text(s_val_labels[5], buf);
+    bmu_ui_set_text(s_val_labels[5], buf);
 
     if (nb_sw_ret == ESP_OK) {
         snprintf(buf, sizeof(buf), "%d", nb_sw);
-        lv_label_set_text(s_val_labels[6], buf);
+        bmu_ui_set_text(s_val_labels[6], buf);
     } else {
-        lv_label_set_text(s_val_labels[6], "---");
+        bmu_ui_set_text(s_val_labels[6], "---");
     }
 
-    lv_label_set_text(s_val_labels[7], state_name(state));
-    lv_obj_set_style_text_color(s_val_labels[7], state_color(state), 0);
-
-    /* Mettre a jour le graphique avec les donnees du ring buffer */
-    if (s_chart != NULL && h != NULL && h->count > 0) {
-        int points = h->count < 30 ? h->count : 30;
-        int start = (h->head - points + CONFIG_BMU_CHART_HISTORY_POINTS) % CONFIG_BMU_CHART_HISTORY_POINTS;
-
-        for (int i = 0; i < 30; i++) {
-            if (i < points) {
-                int ri = (start + i) % CONFIG_BMU_CHART_HISTORY_POINTS;
-                lv_chart_set_value_by_id(s_chart, s_ser_v, i, (int32_t)h->voltage_mv[ri]);
-                lv_chart_set_value_by_id(s_chart, s_ser_i, i, (int32_t)(h->current_a[ri] * 1000.0f));
-            } else {
-                lv_chart_set_value_by_id(s_chart, s_ser_v, i, LV_CHART_POINT_NONE);
-                lv_chart_set_value_by_id(s_chart, s_ser_i, i, LV_CHART_POINT_NONE);
-            }
-            /* Yield toutes les 20 iterations pour eviter le watchdog IDLE0 */
-            if ((i % 20) == 19) {
-                vTaskDelay(1);
-            }
-        }
-
-        /* Auto-scale axe Y tension */
-        update_chart_range(h);
+    bmu_ui_set_text(s_val_labels[7], state_name(state));
+    bmu_ui_set_text_color(s_val_labels[7], state_color(state));
 
-        lv_chart_refresh(s_chart);
+    /* Mettre a jour le graphique avec l'historique, seulement quand un
+     * point a ete ajoute (ou a l'ouverture du detail) */
+    if ((ctx->dirty & BMU_UI_DEP_CHART) && s_chart != NULL && h != NULL) {
+        draw_chart(h);
     }
 }
 
@@ -414,6 +456,9 @@ void bmu_ui_detail_destroy(void)
     s_chart = NULL;
     s_ser_v = NULL;
     s_ser_i = NULL;
+    s_ser_vmin = NULL;
+    s_ser_vmax = NULL;
+    s_zoom_label = NULL;
     for (int i = 0; i < 8; i++) s_val_labels[i] = NULL;
 
     /* Mettre a jour l'etat de navigation */
@@ -260,25 +260,11 @@ static void ensure_battery_rows(int nb)
     s_bat_created = target;
 }
 
-void bmu_ui_main_update(bmu_ui_ctx_t *ctx)
-{
-    /* Si le detail est visible, mettre a jour le detail, pas la liste */
-    if (s_nav != NULL && s_nav->detail_visible) {
-        bmu_ui_detail_update(ctx, s_nav->detail_battery);
-        return;
-    }
-
-    int nb = ctx->nb_ina > 32 ? 32 : ctx->nb_ina;
-    float min_voltage_mv = (float)BMU_MIN_VOLTAGE_MV;
-    float max_voltage_mv = (float)BMU_MAX_VOLTAGE_MV;
-    load_runtime_voltage_window(&min_voltage_mv, &max_voltage_mv);
-    const float voltage_span_mv = (max_voltage_mv > min_voltage_mv)
-                                      ? (max_voltage_mv - min_voltage_mv)
-                                      : 1.0f;
-
-    /* Create battery rows lazily when nb_ina becomes known */
-    ensure_battery_rows(nb);
+/* ── Lignes batteries + barre stats + ligne PACK ──────────────────── */
 
+static void update_fleet(bmu_ui_ctx_t *ctx, int nb, float min_voltage_mv,
+                         float max_voltage_mv, float voltage_span_mv)
+{
     float sum_v = 0, sum_i = 0, sum_ah_c = 0, sum_ah_d = 0;
     float v_min = 999999.0f, v_max = 0.0f;
     int n_active = 0;
@@ -296,15 +282,15 @@ void bmu_ui_main_update(bmu_ui_ctx_t *ctx)
 
         char buf[16];
         snprintf(buf, sizeof(buf), "%.2fV", v);
-        lv_label_set_text(s_bat_vlabels[i], buf);
+        bmu_ui_set_text(s_bat_vlabels[i], buf);
         snprintf(buf, sizeof(buf), "%.1fA", i_a);
-        lv_label_set_text(s_bat_ilabels[i], buf);
+        bmu_ui_set_text(s_bat_ilabels[i], buf);
 
         /* Barre : map tension → 0-100% */
         int pct = (int)(((v_mv - min_voltage_mv) / voltage_span_mv) * 100.0f);
         if (pct < 0)   pct = 0;
         if (pct > 100) pct = 100;
-        lv_bar_set_value(s_bat_bars[i], pct, LV_ANIM_OFF);
+        bmu_ui_set_bar(s_bat_bars[i], pct);
 
         /* Couleur barre + bord selon etat */
         lv_color_t col;
@@ -321,15 +307,15 @@ void bmu_ui_main_update(bmu_ui_ctx_t *ctx)
         if (bmu_balancer_is_off((uint8_t)i)) {
             col = UI_COLOR_WARN;
         }
-        lv_obj_set_style_bg_color(s_bat_bars[i], col, LV_PART_INDICATOR);
-        lv_obj_set_style_bg_color(s_bat_borders[i], col, 0);
+        bmu_ui_set_bg_color(s_bat_bars[i], col, LV_PART_INDICATOR);
+        bmu_ui_set_bg_color(s_bat_borders[i], col, LV_PART_MAIN);
 
         /* Fond ligne : rouge sombre pour batteries OFF */
         if (state == BMU_STATE_DISCONNECTED || state == BMU_STATE_ERROR || state == BMU_STATE_LOCKED) {
-            lv_obj_set_style_bg_color(s_bat_rows[i], UI_COLOR_BG_ERR, 0);
-            lv_obj_set_style_bg_opa(s_bat_rows[i], LV_OPA_COVER, 0);
+            bmu_ui_set_bg_color(s_bat_rows[i], UI_COLOR_BG_ERR, LV_PART_MAIN);
+            bmu_ui_set_bg_opa(s_bat_rows[i], LV_OPA_COVER);
         } else {
-            lv_obj_set_style_bg_opa(s_bat_rows[i], LV_OPA_TRANSP, 0);
+            bmu_ui_set_bg_opa(s_bat_rows[i], LV_OPA_TRANSP);
         }
 
         /* Accumulation stats */
@@ -348,52 +334,80 @@ void bmu_ui_main_update(bmu_ui_ctx_t *ctx)
     char buf[24];
     float avg_v = n_active > 0 ? sum_v / n_active : 0;
     snprintf(buf, sizeof(buf), "%.2fV", avg_v);
-    lv_label_set_text(s_vmoy_label, buf);
-    lv_obj_set_style_text_color(s_vmoy_label,
+    bmu_ui_set_text(s_vmoy_label, buf);
+    bmu_ui_set_text_color(s_vmoy_label,
         (avg_v * 1000.0f >= min_voltage_mv && avg_v * 1000.0f <= max_voltage_mv)
             ? UI_COLOR_OK
-            : UI_COLOR_WARN,
-        0);
+            : UI_COLOR_WARN);
 
     snprintf(buf, sizeof(buf), "%.1fA", sum_i);
-    lv_label_set_text(s_itot_label, buf);
+    bmu_ui_set_text(s_itot_label, buf);
 
     snprintf(buf, sizeof(buf), "%.1f", sum_ah_c);
-    lv_label_set_text(s_ahin_label, buf);
+    bmu_ui_set_text(s_ahin_label, buf);
 
     snprintf(buf, sizeof(buf), "%.1f", sum_ah_d);
-    lv_label_set_text(s_ahout_label, buf);
+    bmu_ui_set_text(s_ahout_label, buf);
 
-    /* ── Ligne PACK : Vmin / Vmoy / Vmax + T°C H% ─────────────────── */
+    /* ── Ligne PACK : Vmin / Vmoy / Vmax ──────────────────────────── */
     if (n_active > 0) {
         snprintf(buf, sizeof(buf), "%.2f", v_min);
-        lv_label_set_text(s_pack_vmin_label, buf);
+        bmu_ui_set_text(s_pack_vmin_label, buf);
         snprintf(buf, sizeof(buf), "%.2fV", avg_v);
-        lv_label_set_text(s_pack_vmoy_label, buf);
+        bmu_ui_set_text(s_pack_vmoy_label, buf);
         snprintf(buf, sizeof(buf), "%.2f", v_max);
-        lv_label_set_text(s_pack_vmax_label, buf);
+        bmu_ui_set_text(s_pack_vmax_label, buf);
 
         /* Couleur déséquilibre */
         float delta = (v_max - v_min) * 1000.0f; /* mV */
         lv_color_t dcol = (delta > 1000.0f) ? UI_COLOR_ERR : (delta > 500.0f) ? UI_COLOR_WARN : UI_COLOR_OK;
-        lv_obj_set_style_text_color(s_pack_vmin_label, dcol, 0);
-        lv_obj_set_style_text_color(s_pack_vmax_label, dcol, 0);
+        bmu_ui_set_text_color(s_pack_vmin_label, dcol);
+        bmu_ui_set_text_color(s_pack_vmax_label, dcol);
     } else {
-        lv_label_set_text(s_pack_vmin_label, "--.-");
-        lv_label_set_text(s_pack_vmoy_label, "--.-V");
-        lv_label_set_text(s_pack_vmax_label, "--.-");
+        bmu_ui_set_text(s_pack_vmin_label, "--.-");
+        bmu_ui_set_text(s_pack_vmoy_label, "--.-V");
+        bmu_ui_set_text(s_pack_vmax_label, "--.-");
     }
+}
 
-    if (bmu_climate_is_available()) {
-        snprintf(buf, sizeof(buf), "%.1fC %.0f%%",
-                 bmu_climate_get_temperature(), bmu_climate_get_humidity());
-    } else {
-        snprintf(buf, sizeof(buf), "---");
+void bmu_ui_main_update(bmu_ui_ctx_t *ctx)
+{
+    /* Si le detail est visible, mettre a jour le detail, pas la liste */
+    if (s_nav != NULL && s_nav->detail_visible) {
+        bmu_ui_detail_update(ctx, s_nav->detail_battery);
+        return;
+    }
+
+    int nb = ctx->nb_ina > 32 ? 32 : ctx->nb_ina;
+    float min_voltage_mv = (float)BMU_MIN_VOLTAGE_MV;
+    float max_voltage_mv = (float)BMU_MAX_VOLTAGE_MV;
+    load_runtime_voltage_window(&min_voltage_mv, &max_voltage_mv);
+    const float voltage_span_mv = (max_voltage_mv > min_voltage_mv)
+                                      ? (max_voltage_mv - min_voltage_mv)
+                                      : 1.0f;
+
+    /* Create battery rows lazily when nb_ina becomes known */
+    ensure_battery_rows(nb);
+
+    if (ctx->dirty & BMU_UI_DEP_FLEET) {
+        update_fleet(ctx, nb, min_voltage_mv, max_voltage_mv, voltage_span_mv);
+    }
+
+    char buf[24];
+    if (ctx->dirty & BMU_UI_DEP_ENV) {
+        if (bmu_climate_is_available()) {
+            snprintf(buf, sizeof(buf), "%.1fC %.0f%%",
+                     bmu_climate_get_temperature(), bmu_climate_get_humidity());
+        } else {
+            snprintf(buf, sizeof(buf), "---");
+        }
+        bmu_ui_set_text(s_pack_temp_label, buf);
     }
-    lv_label_set_text(s_pack_temp_label, buf);
 
     /* Dots connexion */
-    lv_obj_set_style_bg_color(s_ble_dot,  bmu_ble_is_connected()  ? UI_COLOR_INFO : UI_COLOR_TEXT_DIM, 0);
-    lv_obj_set_style_bg_color(s_wifi_dot, bmu_wifi_is_connected()  ? UI_COLOR_OK   : UI_COLOR_TEXT_DIM, 0);
-    lv_obj_set_style_bg_color(s_mqtt_dot, bmu_mqtt_is_connected()  ? UI_COLOR_OK   : UI_COLOR_WARN,     0);
+    if (ctx->dirty & BMU_UI_DEP_LINKS) {
+        bmu_ui_set_bg_color(s_ble_dot,  bmu_ble_is_connected()  ? UI_COLOR_INFO : UI_COLOR_TEXT_DIM, LV_PART_MAIN);
+        bmu_ui_set_bg_color(s_wifi_dot, bmu_wifi_is_connected() ? UI_COLOR_OK   : UI_COLOR_TEXT_DIM, LV_PART_MAIN);
+        bmu_ui_set_bg_color(s_mqtt_dot, bmu_mqtt_is_connected() ? UI_COLOR_OK   : UI_COLOR_WARN,     LV_PART_MAIN);
+    }
 }
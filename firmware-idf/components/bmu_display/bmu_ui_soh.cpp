@@ -192,6 +192,16 @@ void bmu_ui_soh_update(bmu_ui_ctx_t *ctx)
 
     ensure_soh_rows(nb);
 
+    if ((ctx->dirty & BMU_UI_DEP_CLOCK) && s_timestamp_label) {
+        uint32_t secs = (uint32_t)(esp_timer_get_time() / 1000000ULL);
+        char tsbuf[16];
+        snprintf(tsbuf, sizeof(tsbuf), "%luh%02lum",
+                 (unsigned long)(secs / 3600),
+                 (unsigned long)((secs % 3600) / 60));
+        bmu_ui_set_text(s_timestamp_label, tsbuf);
+    }
+    if (!(ctx->dirty & BMU_UI_DEP_HEALTH)) return;
+
     float sum   = 0.0f;
     int   valid = 0;
 
@@ -200,8 +210,8 @@ void bmu_ui_soh_update(bmu_ui_ctx_t *ctx)
 
         if (soh < 0.0f) {
             /* Pas encore de donnée */
-            if (s_soh_pct_labels[i])  lv_label_set_text(s_soh_pct_labels[i], "---%");
-            if (s_soh_warn_labels[i]) lv_obj_add_flag(s_soh_warn_labels[i], LV_OBJ_FLAG_HIDDEN);
+            bmu_ui_set_text(s_soh_pct_labels[i], "---%");
+            bmu_ui_set_hidden(s_soh_warn_labels[i], true);
             continue;
         }
 
@@ -212,16 +222,16 @@ void bmu_ui_soh_update(bmu_ui_ctx_t *ctx)
 
         /* Barre */
         if (s_soh_bars[i]) {
-            lv_bar_set_value(s_soh_bars[i], pct, LV_ANIM_OFF);
-            lv_obj_set_style_bg_color(s_soh_bars[i], soh_color(pct_f), LV_PART_INDICATOR);
+            bmu_ui_set_bar(s_soh_bars[i], pct);
+            bmu_ui_set_bg_color(s_soh_bars[i], soh_color(pct_f), LV_PART_INDICATOR);
         }
 
         /* Pourcentage */
         if (s_soh_pct_labels[i]) {
             char buf[8];
             snprintf(buf, sizeof(buf), "%d%%", pct);
-            lv_label_set_text(s_soh_pct_labels[i], buf);
-            lv_obj_set_style_text_color(s_soh_pct_labels[i], soh_color(pct_f), 0);
+            bmu_ui_set_text(s_soh_pct_labels[i], buf);
+            bmu_ui_set_text_color(s_soh_pct_labels[i], soh_color(pct_f));
         }
 
         /* R_int */
@@ -231,7 +241,7 @@ void bmu_ui_soh_update(bmu_ui_ctx_t *ctx)
             if (rint.valid) {
                 char rbuf[16];
                 snprintf(rbuf, sizeof(rbuf), "%.1fm\xCE\xA9", rint.r_ohmic_mohm);
-                lv_label_set_text(s_soh_rint_labels[i], rbuf);
+                bmu_ui_set_text(s_soh_rint_labels[i], rbuf);
                 lv_color_t rcol;
                 if (rint.r_ohmic_mohm > CONFIG_BMU_RINT_DISPLAY_CRIT_MOHM)
                     rcol = UI_COLOR_ERR;
@@ -239,22 +249,16 @@ void bmu_ui_soh_update(bmu_ui_ctx_t *ctx)
                     rcol = UI_COLOR_WARN;
                 else
                     rcol = UI_COLOR_OK;
-                lv_obj_set_style_text_color(s_soh_rint_labels[i], rcol, 0);
+                bmu_ui_set_text_color(s_soh_rint_labels[i], rcol);
             } else {
-                lv_label_set_text(s_soh_rint_labels[i], "---");
-                lv_obj_set_style_text_color(s_soh_rint_labels[i], UI_COLOR_TEXT_DIM, 0);
+                bmu_ui_set_text(s_soh_rint_labels[i], "---");
+                bmu_ui_set_text_color(s_soh_rint_labels[i], UI_COLOR_TEXT_DIM);
             }
         }
 #endif
 
         /* Avertissement REMPLACER */
-        if (s_soh_warn_labels[i]) {
-            if (pct_f < 40.0f) {
-                lv_obj_clear_flag(s_soh_warn_labels[i], LV_OBJ_FLAG_HIDDEN);
-            } else {
-                lv_obj_add_flag(s_soh_warn_labels[i], LV_OBJ_FLAG_HIDDEN);
-            }
-        }
+        bmu_ui_set_hidden(s_soh_warn_labels[i], pct_f >= 40.0f);
 
         sum += soh;
         valid++;
@@ -269,22 +273,12 @@ void bmu_ui_soh_update(bmu_ui_ctx_t *ctx)
 
             char buf[16];
             snprintf(buf, sizeof(buf), "%d%%", mean_i);
-            lv_label_set_text(s_soh_mean_label, buf);
-            lv_bar_set_value(s_soh_mean_bar, mean_i, LV_ANIM_OFF);
-            lv_obj_set_style_bg_color(s_soh_mean_bar, soh_color(mean_pct), LV_PART_INDICATOR);
+            bmu_ui_set_text(s_soh_mean_label, buf);
+            bmu_ui_set_bar(s_soh_mean_bar, mean_i);
+            bmu_ui_set_bg_color(s_soh_mean_bar, soh_color(mean_pct), LV_PART_INDICATOR);
         } else {
-            lv_label_set_text(s_soh_mean_label, "---%");
-            lv_bar_set_value(s_soh_mean_bar, 0, LV_ANIM_OFF);
+            bmu_ui_set_text(s_soh_mean_label, "---%");
+            bmu_ui_set_bar(s_soh_mean_bar, 0);
         }
     }
-
-    /* Timestamp uptime */
-    if (s_timestamp_label) {
-        uint32_t secs = (uint32_t)(esp_timer_get_time() / 1000000ULL);
-        char tsbuf[16];
-        snprintf(tsbuf, sizeof(tsbuf), "%luh%02lum",
-                 (unsigned long)(secs / 3600),
-                 (unsigned long)((secs % 3600) / 60));
-        lv_label_set_text(s_timestamp_label, tsbuf);
-    }
 }
@@ -1,9 +1,11 @@
 /**
  * @file bmu_ui_solar.cpp
- * @brief Ecran Solar — affiche les donnees VE.Direct du chargeur Victron MPPT.
+ * @brief Ecran Solar — affiche les donnees VE.Direct des chargeurs Victron MPPT.
  *
- * Lit bmu_vedirect_get_data() et affiche PV tension, puissance, etat MPPT,
- * yield, et infos chargeur. Si VE.Direct non connecte : "Pas de chargeur detecte".
+ * Lit le modele agrege bmu_vedirect_get_solar() et affiche PV tension,
+ * puissance, etat MPPT, yield, et infos du chargeur principal. Avec plusieurs
+ * chargeurs, l'en-tete indique combien sont a jour et l'age du premier muet.
+ * Si aucun chargeur a jour : "Pas de chargeur detecte".
  */
 
 #include "bmu_ui.h"
@@ -31,6 +33,7 @@ static const char *TAG = "UI_SOLAR";
 
 static lv_obj_t *s_no_charger_label = NULL;
 static lv_obj_t *s_data_container = NULL;
+static lv_obj_t *s_chargers_label = NULL;
 
 // Donnees PV
 static lv_obj_t *s_pv_voltage = NULL;
@@ -95,6 +98,14 @@ void bmu_ui_solar_create(lv_obj_t *parent)
     lv_obj_set_style_text_font(header, &lv_font_montserrat_14, 0);
     lv_obj_align(header, LV_ALIGN_TOP_LEFT, 4, 2);
 
+    /* Chargeurs a jour (rig multi-MPPT uniquement) */
+    s_chargers_label = lv_label_create(parent);
+    lv_label_set_text(s_chargers_label, "");
+    lv_obj_set_style_text_color(s_chargers_label, COL_GREY, 0);
+    lv_obj_set_style_text_font(s_chargers_label, &lv_font_montserrat_14, 0);
+    lv_obj_align(s_chargers_label, LV_ALIGN_TOP_RIGHT, -4, 2);
+    if (bmu_vedirect_count() <= 1) lv_obj_add_flag(s_chargers_label, LV_OBJ_FLAG_HIDDEN);
+
     /* Message "pas de chargeur" (cache par defaut si connecte) */
     s_no_charger_label = lv_label_create(parent);
     lv_label_set_text(s_no_charger_label, "Pas de chargeur detecte");
@@ -137,9 +148,32 @@ void bmu_ui_solar_create(lv_obj_t *parent)
 
 /* ── Update ───────────────────────────────────────────────────────── */
 
+/* "2/3 MPPT  #3 42s" : chargeurs a jour, puis le premier muet et son age */
+static void update_chargers(const bmu_vedirect_solar_t *sol)
+{
+    char buf[40];
+    int n = snprintf(buf, sizeof(buf), "%u/%u MPPT",
+                     (unsigned)sol->n_online, (unsigned)sol->n_chargers);
+    for (uint8_t i = 0; i < sol->n_chargers; i++) {
+        if (sol->online_mask & (1u << i)) continue;
+        if (sol->age_ms[i] < 0) {
+            snprintf(buf + n, sizeof(buf) - n, "  #%u ---", (unsigned)(i + 1));
+        } else {
+            snprintf(buf + n, sizeof(buf) - n, "  #%u %lds", (unsigned)(i + 1),
+                     (long)(sol->age_ms[i] / 1000));
+        }
+        break;
+    }
+    lv_label_set_text(s_chargers_label, buf);
+    lv_obj_set_style_text_color(s_chargers_label,
+        sol->n_online == sol->n_chargers ? COL_GREY : COL_ORANGE, 0);
+}
+
 void bmu_ui_solar_update(void)
 {
-    bool connected = bmu_vedirect_is_connected();
+    bmu_vedirect_solar_t sol;
+    bool connected = bmu_vedirect_get_solar(&sol);
+    if (sol.n_chargers > 1) update_chargers(&sol);
 
     if (!connected) {
         lv_obj_remove_flag(s_no_charger_label, LV_OBJ_FLAG_HIDDEN);
@@ -150,8 +184,7 @@ void bmu_ui_solar_update(void)
     lv_obj_add_flag(s_no_charger_label, LV_OBJ_FLAG_HIDDEN);
     lv_obj_remove_flag(s_data_container, LV_OBJ_FLAG_HIDDEN);
 
-    const bmu_vedirect_data_t *d = bmu_vedirect_get_data();
-    if (d == NULL || !d->valid) return;
+    const bmu_vedirect_data_t *d = &sol.total;
 
     char buf[32];
 
@@ -182,8 +215,13 @@ void bmu_ui_solar_update(void)
     snprintf(buf, sizeof(buf), "%d W", d->max_power_today_w);
     lv_label_set_text(s_max_power, buf);
 
-    /* Infos chargeur */
-    lv_label_set_text(s_product_id, d->product_id);
+    /* Infos chargeur (principal si plusieurs) */
+    if (sol.n_chargers > 1) {
+        snprintf(buf, sizeof(buf), "%s (#%u)", d->product_id, (unsigned)(sol.primary + 1));
+        lv_label_set_text(s_product_id, buf);
+    } else {
+        lv_label_set_text(s_product_id, d->product_id);
+    }
     lv_label_set_text(s_serial, d->serial);
     lv_label_set_text(s_firmware, d->firmware);
 }
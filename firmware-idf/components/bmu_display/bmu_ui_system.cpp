@@ -267,81 +267,39 @@ void bmu_ui_system_update(bmu_ui_ctx_t *ctx)
 
     /* ── Section 1 — CONNEXION ─────────────────────────────────── */
 
-    /* BLE */
-    bool ble_ok = bmu_ble_is_connected();
-    lv_obj_set_style_bg_color(s_ble_dot,
-        ble_ok ? UI_COLOR_OK : UI_COLOR_TEXT_DIM, 0);
-
-    /* WiFi */
-    bool wifi_ok = bmu_wifi_is_connected();
-    lv_obj_set_style_bg_color(s_wifi_dot,
-        wifi_ok ? UI_COLOR_OK : UI_COLOR_TEXT_DIM, 0);
-    if (wifi_ok) {
-        char ip[20] = {};
-        bmu_wifi_get_ip(ip, sizeof(ip));
-        lv_label_set_text(s_wifi_lbl, ip);
-    } else {
-        lv_label_set_text(s_wifi_lbl, "WiFi");
-    }
-
-    /* MQTT */
-    bool mqtt_ok = bmu_mqtt_is_connected();
-    lv_obj_set_style_bg_color(s_mqtt_dot,
-        mqtt_ok ? UI_COLOR_OK : UI_COLOR_WARN, 0);
-
-    /* ── Section 2 — CLIMAT ────────────────────────────────────── */
-
-    if (bmu_climate_is_available()) {
-        snprintf(buf, sizeof(buf), "%.1f °C", bmu_climate_get_temperature());
-        lv_label_set_text(s_temp_lbl, buf);
-        snprintf(buf, sizeof(buf), "%.0f %%", bmu_climate_get_humidity());
-        lv_label_set_text(s_hum_lbl, buf);
-    } else {
-        lv_label_set_text(s_temp_lbl, "---");
-        lv_label_set_text(s_hum_lbl, "---");
-    }
-
-    /* ── Section 3 — SOLAIRE ───────────────────────────────────── */
-
-    if (bmu_vedirect_is_connected()) {
-        lv_obj_clear_flag(s_solar_container, LV_OBJ_FLAG_HIDDEN);
-        const bmu_vedirect_data_t *vd = bmu_vedirect_get_data();
-        if (vd && vd->valid) {
-            /* MPPT state avec couleur */
-            lv_label_set_text(s_mppt_state, bmu_vedirect_cs_name(vd->charge_state));
-            lv_obj_set_style_text_color(s_mppt_state, cs_color(vd->charge_state), 0);
-
-            /* PV tension + puissance + tension batterie */
-            snprintf(buf, sizeof(buf), "PV %.2fV  %dW  Batt %.2fV",
-                     vd->panel_voltage_v,
-                     vd->panel_power_w,
-                     vd->battery_voltage_v);
-            lv_label_set_text(s_pv_info, buf);
-
-            /* Rendement du jour */
-            snprintf(buf, sizeof(buf), "Yield today: %lu Wh  Max: %dW",
-                     (unsigned long)vd->yield_today_wh,
-                     vd->max_power_today_w);
-            lv_label_set_text(s_yield_info, buf);
+    if (ctx->dirty & BMU_UI_DEP_LINKS) {
+        /* BLE */
+        bool ble_ok = bmu_ble_is_connected();
+        bmu_ui_set_bg_color(s_ble_dot,
+            ble_ok ? UI_COLOR_OK : UI_COLOR_TEXT_DIM, LV_PART_MAIN);
+
+        /* WiFi */
+        bool wifi_ok = bmu_wifi_is_connected();
+        bmu_ui_set_bg_color(s_wifi_dot,
+            wifi_ok ? UI_COLOR_OK : UI_COLOR_TEXT_DIM, LV_PART_MAIN);
+        if (wifi_ok) {
+            char ip[20] = {};
+            bmu_wifi_get_ip(ip, sizeof(ip));
+            bmu_ui_set_text(s_wifi_lbl, ip);
         } else {
-            lv_label_set_text(s_mppt_state, "...");
-            lv_obj_set_style_text_color(s_mppt_state, UI_COLOR_TEXT_DIM, 0);
-            lv_label_set_text(s_pv_info, "");
-            lv_label_set_text(s_yield_info, "");
+            bmu_ui_set_text(s_wifi_lbl, "WiFi");
         }
-    } else {
-        lv_obj_add_flag(s_solar_container, LV_OBJ_FLAG_HIDDEN);
+
+        /* MQTT */
+        bool mqtt_ok = bmu_mqtt_is_connected();
+        bmu_ui_set_bg_color(s_mqtt_dot,
+            mqtt_ok ? UI_COLOR_OK : UI_COLOR_WARN, LV_PART_MAIN);
     }
 
-    /* ── Section 4 — FIRMWARE ──────────────────────────────────── */
+    /* ── Section 4 — FIRMWARE (uptime a la minute, heap avec ENV) ─ */
 
-    {
+    if (ctx->dirty & (BMU_UI_DEP_CLOCK | BMU_UI_DEP_ENV)) {
         const esp_app_desc_t *desc = esp_app_get_description();
         uint32_t heap_kb = esp_get_free_heap_size() / 1024;
         uint32_t secs    = (uint32_t)(esp_timer_get_time() / 1000000ULL);
         uint32_t h       = secs / 3600;
         uint32_t m       = (secs % 3600) / 60;
-        int nb_ina = ctx ? (int)ctx->nb_ina : 0;
+        int nb_ina = (int)ctx->nb_ina;
 
         snprintf(buf, sizeof(buf), "v%.8s %lukB %luh%02lum %dI",
                  desc->version,
@@ -349,7 +307,55 @@ void bmu_ui_system_update(bmu_ui_ctx_t *ctx)
                  (unsigned long)h,
                  (unsigned long)m,
                  nb_ina);
-        lv_label_set_text(s_fw_info, buf);
+        bmu_ui_set_text(s_fw_info, buf);
+    }
+
+    if (!(ctx->dirty & BMU_UI_DEP_ENV)) return;
+
+    /* ── Section 2 — CLIMAT ────────────────────────────────────── */
+
+    if (bmu_climate_is_available()) {
+        snprintf(buf, sizeof(buf), "%.1f °C", bmu_climate_get_temperature());
+        bmu_ui_set_text(s_temp_lbl, buf);
+        snprintf(buf, sizeof(buf), "%.0f %%", bmu_climate_get_humidity());
+        bmu_ui_set_text(s_hum_lbl, buf);
+    } else {
+        bmu_ui_set_text(s_temp_lbl, "---");
+        bmu_ui_set_text(s_hum_lbl, "---");
+    }
+
+    /* ── Section 3 — SOLAIRE ───────────────────────────────────── */
+
+    bmu_vedirect_solar_t solar;
+    if (bmu_vedirect_get_solar(&solar)) {
+        bmu_ui_set_hidden(s_solar_container, false);
+        const bmu_vedirect_data_t *vd = &solar.total;
+
+        /* MPPT state avec couleur (+ chargeurs a jour si plusieurs) */
+        if (solar.n_chargers > 1) {
+            snprintf(buf, sizeof(buf), "%s  %u/%u MPPT",
+                     bmu_vedirect_cs_name(vd->charge_state),
+                     (unsigned)solar.n_online, (unsigned)solar.n_chargers);
+            bmu_ui_set_text(s_mppt_state, buf);
+        } else {
+            bmu_ui_set_text(s_mppt_state, bmu_vedirect_cs_name(vd->charge_state));
+        }
+        bmu_ui_set_text_color(s_mppt_state, cs_color(vd->charge_state));
+
+        /* PV tension + puissance + tension batterie */
+        snprintf(buf, sizeof(buf), "PV %.2fV  %dW  Batt %.2fV",
+                 vd->panel_voltage_v,
+                 vd->panel_power_w,
+                 vd->battery_voltage_v);
+        bmu_ui_set_text(s_pv_info, buf);
+
+        /* Rendement du jour */
+        snprintf(buf, sizeof(buf), "Yield today: %lu Wh  Max: %dW",
+                 (unsigned long)vd->yield_today_wh,
+                 vd->max_power_today_w);
+        bmu_ui_set_text(s_yield_info, buf);
+    } else {
+        bmu_ui_set_hidden(s_solar_container, true);
     }
 
     /* ── Section 5 — I2C BUS ───────────────────────────────────── */
@@ -358,11 +364,11 @@ void bmu_ui_system_update(bmu_ui_ctx_t *ctx)
         int dev_count = bmu_ui_debug_get_device_count();
         int err_count = bmu_ui_debug_get_error_count();
         snprintf(buf, sizeof(buf), "%d dev  %d err", dev_count, err_count);
-        lv_label_set_text(s_i2c_info, buf);
+        bmu_ui_set_text(s_i2c_info, buf);
 
         for (int i = 0; i < 3; i++) {
             const char *line = bmu_ui_debug_get_log_line(i);
-            lv_label_set_text(s_i2c_log[i], line ? line : "");
+            bmu_ui_set_text(s_i2c_log[i], line ? line : "");
         }
     }
 
@@ -424,10 +430,10 @@ void bmu_ui_system_update(bmu_ui_ctx_t *ctx)
                                  devs[i].label[0] ? devs[i].label : "???",
                                  devs[i].record_type);
                     }
-                    lv_label_set_text(s_vic_labels[i], line);
-                    lv_obj_clear_flag(s_vic_labels[i], LV_OBJ_FLAG_HIDDEN);
+                    bmu_ui_set_text(s_vic_labels[i], line);
+                    bmu_ui_set_hidden(s_vic_labels[i], false);
                 } else {
-                    lv_obj_add_flag(s_vic_labels[i], LV_OBJ_FLAG_HIDDEN);
+                    bmu_ui_set_hidden(s_vic_labels[i], true);
                 }
             }
         }
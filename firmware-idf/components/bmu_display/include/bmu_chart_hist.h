@@ -0,0 +1,70 @@
+/**
+ * @file bmu_chart_hist.h
+ * @brief Historique graphique V/I par batterie : 4 niveaux en virgule fixe.
+ *
+ *   niveau  fenetre  points  pas     rempli par
+ *   0       15 s     30      0.5 s   echantillons (BMU_CHART_SAMPLE_MS)
+ *   1       15 min   60      15 s    min/max/moyenne de 30 points niveau 0
+ *   2       24 h     48      30 min  min/max/moyenne de 120 points niveau 1
+ *   3       7 j      42      4 h     min/max/moyenne de 8 points niveau 2
+ *
+ * Tension en mV (uint16, 0..65535), courant en 10 mA (int16, +-327 A).
+ * Les min/max de chaque niveau sont ceux des echantillons bruts : un pic
+ * de 0.5 s reste visible sur la vue 7 jours. ~2.2 ko par batterie, contre
+ * 4.8 ko pour 600 floats V/I (5 min).
+ *
+ * Aucune dependance ESP-IDF : teste sur host (test_chart_hist).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_CHART_SAMPLE_MS    500
+#define BMU_CHART_TIERS        4
+#define BMU_CHART_MAX_POINTS   60     /**< Plus grand niveau (vue la plus dense) */
+
+typedef struct {
+    uint16_t v_min_mv, v_max_mv, v_avg_mv;
+    int16_t  i_min_ca, i_max_ca, i_avg_ca;    /**< 10 mA */
+} bmu_chart_point_t;
+
+typedef struct {
+    int32_t  v_min, v_max, v_sum;
+    int32_t  i_min, i_max, i_sum;
+    uint16_t n;
+} bmu_chart_acc_t;
+
+typedef struct {
+    bmu_chart_point_t pts[30 + 60 + 48 + 42];   /**< Anneaux des 4 niveaux */
+    bmu_chart_acc_t   acc[BMU_CHART_TIERS];     /**< Point en cours (niveaux 1..3) */
+    uint8_t           head[BMU_CHART_TIERS];
+    uint8_t           count[BMU_CHART_TIERS];
+} bmu_chart_hist_t;
+
+void bmu_chart_hist_reset(bmu_chart_hist_t *h);
+
+/** Echantillon toutes les BMU_CHART_SAMPLE_MS ; valeurs saturees a la plage */
+void bmu_chart_hist_push(bmu_chart_hist_t *h, float v_mv, float i_a);
+
+/** Dernier echantillon ; false si vide */
+bool bmu_chart_hist_last(const bmu_chart_hist_t *h, float *v_mv, float *i_a);
+
+/**
+ * @brief Points d'un niveau, du plus ancien au plus recent. Pour les niveaux
+ *        1..3, le point en cours de decimation est ajoute en dernier.
+ * @return nombre de points ecrits (<= capacite du niveau, <= max)
+ */
+int bmu_chart_hist_read(const bmu_chart_hist_t *h, int tier,
+                        bmu_chart_point_t *out, int max);
+
+int      bmu_chart_hist_capacity(int tier);
+uint32_t bmu_chart_hist_step_ms(int tier);
+
+#ifdef __cplusplus
+}
+#endif
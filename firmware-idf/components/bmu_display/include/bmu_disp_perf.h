@@ -0,0 +1,78 @@
+/**
+ * @file bmu_disp_perf.h
+ * @brief Mesure du rendu LVGL image par image : temps de rendu, temps de
+ *        flush (SPI/DMA), surface invalidee, images par seconde.
+ *
+ * Alimente par les evenements de l'affichage LVGL (bmu_display.cpp) :
+ *   INVALIDATE_AREA          → bmu_disp_perf_invalidate
+ *   REFR_START / REFR_READY  → frame_start / frame_end
+ *   FLUSH_START / FLUSH_FINISH, FLUSH_WAIT_START / FLUSH_WAIT_FINISH
+ *                            → flush_start / flush_end (DMA compris)
+ *
+ * Les cycles sans zone invalidee ne comptent pas comme images. Les compteurs
+ * sont cumulatifs : chaque lecteur (page debug, MQTT) garde sa lecture
+ * precedente et bmu_disp_perf_stats() donne les moyennes sur l'intervalle.
+ *
+ * Aucune dependance ESP-IDF : teste sur host (test_disp_perf).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_DISP_PERF_SLOW_US   33000   /**< Image plus longue que 30 fps */
+
+typedef struct {
+    uint32_t frames;
+    uint32_t slow;           /**< Images > BMU_DISP_PERF_SLOW_US */
+    uint64_t render_us;      /**< Cumul rendu (image - flush) */
+    uint64_t flush_us;       /**< Cumul flush + attente DMA */
+    uint64_t area_px;        /**< Cumul surface invalidee, bornee au panneau */
+    int64_t  t_us;           /**< Horodatage de la lecture */
+    uint32_t panel_px;
+} bmu_disp_perf_totals_t;
+
+typedef struct {
+    bmu_disp_perf_totals_t tot;
+    uint32_t frame_area_px;  /**< Invalide depuis la derniere image */
+    uint32_t frame_flush_us;
+    int64_t  frame_start_us;
+    int64_t  flush_start_us;
+    bool     in_frame;
+    bool     in_flush;
+} bmu_disp_perf_t;
+
+typedef struct {
+    float    fps;
+    float    render_ms;      /**< Moyenne par image */
+    float    flush_ms;
+    float    area_pct;       /**< Surface moyenne par image, % du panneau */
+    float    load_pct;       /**< Temps rendu + flush / duree de l'intervalle */
+    uint32_t frames;
+    uint32_t slow;
+} bmu_disp_perf_stats_t;
+
+void bmu_disp_perf_init(bmu_disp_perf_t *p, uint32_t panel_px);
+
+void bmu_disp_perf_invalidate(bmu_disp_perf_t *p, int32_t w, int32_t h);
+void bmu_disp_perf_frame_start(bmu_disp_perf_t *p, int64_t now_us);
+void bmu_disp_perf_flush_start(bmu_disp_perf_t *p, int64_t now_us);
+void bmu_disp_perf_flush_end(bmu_disp_perf_t *p, int64_t now_us);
+void bmu_disp_perf_frame_end(bmu_disp_perf_t *p, int64_t now_us);
+
+/** Copie horodatee des compteurs cumulatifs */
+void bmu_disp_perf_read(const bmu_disp_perf_t *p, int64_t now_us,
+                        bmu_disp_perf_totals_t *out);
+
+/** Moyennes entre deux lectures ; tout a zero si l'intervalle est vide */
+void bmu_disp_perf_stats(const bmu_disp_perf_totals_t *prev,
+                         const bmu_disp_perf_totals_t *cur,
+                         bmu_disp_perf_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
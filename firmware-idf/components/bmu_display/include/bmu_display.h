@@ -3,6 +3,7 @@
 #include "bmu_protection.h"
 #include "bmu_battery_manager.h"
 #include "bmu_types.h"
+#include "bmu_disp_perf.h"
 
 typedef struct _lv_obj_t lv_obj_t;
 
@@ -31,6 +32,13 @@ esp_err_t bmu_display_init(bmu_display_ctx_t *ctx);
  */
 esp_err_t bmu_display_start_updates(void);
 
+/**
+ * @brief Compteurs cumulatifs du rendu LVGL (bmu_disp_perf.h), lisibles
+ * depuis n'importe quelle tache. Moyennes : bmu_disp_perf_stats() entre
+ * deux lectures.
+ */
+void bmu_display_get_perf(bmu_disp_perf_totals_t *out);
+
 /**
  * @brief Force display update (called from main loop or event).
  * Normally the display updates itself via its own task.
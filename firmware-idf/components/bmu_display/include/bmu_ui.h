@@ -3,6 +3,8 @@
 #include "bmu_protection.h"
 #include "bmu_battery_manager.h"
 #include "bmu_config.h"
+#include "bmu_chart_hist.h"
+#include <string.h>
 
 /* ── High Contrast palette ──────────────────────────────────────── */
 #define UI_COLOR_BG          lv_color_hex(0x000000)
@@ -25,14 +27,21 @@
 extern "C" {
 #endif
 
-/* ── Chart history ring buffer ────────────────────────────────────── */
+/* ── Dependances des ecrans ────────────────────────────────────────── */
 
-typedef struct {
-    float voltage_mv[CONFIG_BMU_CHART_HISTORY_POINTS];
-    float current_a[CONFIG_BMU_CHART_HISTORY_POINTS];
-    int   head;         // next write index
-    int   count;        // number of valid points (0..CONFIG_BMU_CHART_HISTORY_POINTS)
-} bmu_chart_history_t;
+/* Chaque ecran declare les donnees qu'il affiche (table dans bmu_display.cpp).
+ * A chaque tick, seul l'ecran visible est mis a jour, et seulement si une de
+ * ses dependances a change ; ctx->dirty porte les bits changes depuis le
+ * tick precedent (tous a l'affichage d'un ecran). */
+typedef enum {
+    BMU_UI_DEP_FLEET  = 1u << 0,  /* tensions, courants, etats, Ah (chaque tick) */
+    BMU_UI_DEP_CHART  = 1u << 1,  /* nouveau point d'historique graphique */
+    BMU_UI_DEP_HEALTH = 1u << 2,  /* SOH, R_int (caches lents) */
+    BMU_UI_DEP_LINKS  = 1u << 3,  /* BLE, WiFi, MQTT connectes */
+    BMU_UI_DEP_ENV    = 1u << 4,  /* climat, solaire, Victron, heap, bus I2C */
+    BMU_UI_DEP_CLOCK  = 1u << 5,  /* uptime a la minute */
+    BMU_UI_DEP_ALL    = 0x3Fu,
+} bmu_ui_dep_t;
 
 /* ── UI context ───────────────────────────────────────────────────── */
 
@@ -40,9 +49,58 @@ typedef struct {
     bmu_protection_ctx_t           *prot;
     bmu_battery_manager_t          *mgr;
     uint8_t                         nb_ina;
-    bmu_chart_history_t            *chart_hist; /* heap-allocated (PSRAM) */
+    bmu_chart_hist_t               *chart_hist; /* heap-allocated (PSRAM) */
+    uint32_t                        dirty;      /* bmu_ui_dep_t changes ce tick */
 } bmu_ui_ctx_t;
 
+/* ── Setters sans effet si la valeur affichee ne change pas ──────────── */
+
+/* lv_label_set_text, lv_bar_set_value et les styles locaux invalident la
+ * zone meme a valeur identique : comparer d'abord evite le rendu et le
+ * flush SPI des widgets inchanges. */
+static inline void bmu_ui_set_text(lv_obj_t *lbl, const char *txt)
+{
+    if (lbl == NULL) return;
+    const char *cur = lv_label_get_text(lbl);
+    if (cur != NULL && strcmp(cur, txt) == 0) return;
+    lv_label_set_text(lbl, txt);
+}
+
+static inline void bmu_ui_set_bar(lv_obj_t *bar, int32_t value)
+{
+    if (bar != NULL && lv_bar_get_value(bar) != value) {
+        lv_bar_set_value(bar, value, LV_ANIM_OFF);
+    }
+}
+
+static inline void bmu_ui_set_bg_color(lv_obj_t *obj, lv_color_t c, lv_part_t part)
+{
+    if (obj != NULL && !lv_color_eq(lv_obj_get_style_bg_color(obj, part), c)) {
+        lv_obj_set_style_bg_color(obj, c, part);
+    }
+}
+
+static inline void bmu_ui_set_bg_opa(lv_obj_t *obj, lv_opa_t opa)
+{
+    if (obj != NULL && lv_obj_get_style_bg_opa(obj, LV_PART_MAIN) != opa) {
+        lv_obj_set_style_bg_opa(obj, opa, 0);
+    }
+}
+
+static inline void bmu_ui_set_text_color(lv_obj_t *obj, lv_color_t c)
+{
+    if (obj != NULL && !lv_color_eq(lv_obj_get_style_text_color(obj, LV_PART_MAIN), c)) {
+        lv_obj_set_style_text_color(obj, c, 0);
+    }
+}
+
+static inline void bmu_ui_set_hidden(lv_obj_t *obj, bool hidden)
+{
+    if (obj == NULL || lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN) == hidden) return;
+    if (hidden) lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+    else        lv_obj_clear_flag(obj, LV_OBJ_FLAG_HIDDEN);
+}
+
 /* ── Navigation state (managed by bmu_display.cpp) ────────────────── */
 
 typedef struct {
@@ -51,16 +109,6 @@ typedef struct {
     lv_obj_t *detail_panel;   // the detail overlay object (NULL when hidden)
 } bmu_nav_state_t;
 
-/* ── Chart history helpers ────────────────────────────────────────── */
-
-static inline void bmu_chart_history_push(bmu_chart_history_t *h, float v_mv, float i_a)
-{
-    h->voltage_mv[h->head] = v_mv;
-    h->current_a[h->head]  = i_a;
-    h->head = (h->head + 1) % CONFIG_BMU_CHART_HISTORY_POINTS;
-    if (h->count < CONFIG_BMU_CHART_HISTORY_POINTS) h->count++;
-}
-
 /* ── Main grid screen ─────────────────────────────────────────────── */
 
 void bmu_ui_main_create(lv_obj_t *parent, bmu_ui_ctx_t *ctx);
@@ -3,19 +3,25 @@
  *
  * Bufferise les lignes line-protocol et les envoie par POST
  * vers l'API /api/v2/write d'InfluxDB.
+ *
+ * Un seul esp_http_client vit pendant toute la session (keep-alive) : la
+ * poignée de main TCP/TLS n'est refaite qu'après une erreur transport, avec
+ * backoff exponentiel. Corps compressés en gzip si CONFIG_BMU_INFLUX_GZIP.
  */
 
 #include "bmu_influx.h"
 #include "bmu_influx_store.h"
+#include "bmu_influx_gzip.h"
+#include "bmu_influx_lp.h"
 
 #include <cstdio>
 #include <cstring>
-#include <cinttypes>
 #include <cmath>
 
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "sdkconfig.h"
 
 static constexpr size_t URL_BUF_SIZE = 256;
@@ -36,6 +42,75 @@ static char *s_auth_header = NULL;   /* 256 bytes */
 // Indicateur d'initialisation
 static bool s_initialized = false;
 
+// Client persistant + backoff
+static esp_http_client_handle_t s_client = NULL;
+static int64_t  s_retry_after_us = 0;
+static uint32_t s_backoff_ms = 0;
+static uint8_t  s_transport_errors = 0;     /* consécutives, recrée le client à 3 */
+static bmu_influx_stats_t s_stats = {};
+
+#if CONFIG_BMU_INFLUX_GZIP
+static bmu_gzip_ws_t *s_gzip_ws = NULL;     /* ~24 KB PSRAM */
+static uint8_t *s_gzip_buf = NULL;          /* BMU_INFLUX_POST_MAX + marge */
+static constexpr size_t GZIP_BUF_SIZE = BMU_INFLUX_POST_MAX + BMU_INFLUX_POST_MAX / 8 + 64;
+#endif
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+{
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        s_stats.handshakes++;
+    }
+    return ESP_OK;
+}
+
+static esp_http_client_handle_t get_client(void)
+{
+    if (s_client) return s_client;
+
+    esp_http_client_config_t config = {};
+    config.url = s_write_url;
+    config.method = HTTP_METHOD_POST;
+    config.timeout_ms = CONFIG_BMU_INFLUX_TIMEOUT_MS;
+    config.keep_alive_enable = true;
+    config.event_handler = http_event_handler;
+
+    s_client = esp_http_client_init(&config);
+    if (s_client == nullptr) return nullptr;
+
+    esp_http_client_set_header(s_client, "Authorization", s_auth_header);
+    esp_http_client_set_header(s_client, "Content-Type", "text/plain; charset=utf-8");
+    return s_client;
+}
+
+static void drop_client(void)
+{
+    if (!s_client) return;
+    esp_http_client_close(s_client);
+    esp_http_client_cleanup(s_client);
+    s_client = NULL;
+}
+
+/* Échec transport : fermer la connexion, doubler le délai avant réessai */
+static void on_transport_error(void)
+{
+    s_backoff_ms = s_backoff_ms ? s_backoff_ms * 2 : 1000;
+    if (s_backoff_ms > CONFIG_BMU_INFLUX_BACKOFF_MAX_S * 1000u) {
+        s_backoff_ms = CONFIG_BMU_INFLUX_BACKOFF_MAX_S * 1000u;
+    }
+    s_retry_after_us = esp_timer_get_time() + (int64_t)s_backoff_ms * 1000;
+    if (++s_transport_errors >= 3) {
+        drop_client();                      /* repartir d'un état propre */
+        s_transport_errors = 0;
+    } else if (s_client) {
+        esp_http_client_close(s_client);
+    }
+}
+
+void bmu_influx_get_stats(bmu_influx_stats_t *out)
+{
+    if (out) *out = s_stats;
+}
+
 // ---------------------------------------------------------------------------
 // Init
 // ---------------------------------------------------------------------------
@@ -60,6 +135,20 @@ esp_err_t bmu_influx_init(void)
         ESP_LOGE(TAG, "Echec allocation buffers InfluxDB");
         return ESP_ERR_NO_MEM;
     }
+#if CONFIG_BMU_INFLUX_GZIP
+    if (s_gzip_ws == NULL) {
+        s_gzip_ws = (bmu_gzip_ws_t *)heap_caps_calloc(1, sizeof(bmu_gzip_ws_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        s_gzip_buf = (uint8_t *)heap_caps_calloc(1, GZIP_BUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (s_gzip_ws == NULL || s_gzip_buf == NULL) {
+            /* Pas de repli DRAM : gzip est une optimisation, on envoie en clair */
+            ESP_LOGW(TAG, "PSRAM indisponible — gzip désactivé");
+            heap_caps_free(s_gzip_ws);
+            heap_caps_free(s_gzip_buf);
+            s_gzip_ws = NULL;
+            s_gzip_buf = NULL;
+        }
+    }
+#endif
 
     const char *url = CONFIG_BMU_INFLUX_URL;
     if (strncmp(url, "http://", 7) == 0) {
@@ -99,171 +188,243 @@ esp_err_t bmu_influx_init(void)
 }
 
 // ---------------------------------------------------------------------------
-// Flush — envoie le buffer vers InfluxDB par HTTP POST
+// POST — envoie un corps line-protocol sur le client persistant
 // ---------------------------------------------------------------------------
-esp_err_t bmu_influx_flush(void)
+static esp_err_t post_body(const char *data, size_t len, int lines)
 {
-    if (!s_initialized) {
-        return ESP_ERR_INVALID_STATE;
-    }
-    if (s_buffer_len == 0) {
-        return ESP_OK;  // Rien à envoyer
+    /* Backoff en cours : pas de tentative réseau */
+    if (s_retry_after_us != 0 && esp_timer_get_time() < s_retry_after_us) {
+        return ESP_ERR_TIMEOUT;
     }
 
-    esp_http_client_config_t config = {};
-    config.url = s_write_url;
-    config.method = HTTP_METHOD_POST;
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    esp_http_client_handle_t client = get_client();
     if (client == nullptr) {
         ESP_LOGE(TAG, "Impossible de créer le client HTTP");
         return ESP_ERR_NO_MEM;
     }
 
-    esp_http_client_set_header(client, "Authorization", s_auth_header);
-    esp_http_client_set_header(client, "Content-Type", "text/plain");
-    esp_http_client_set_post_field(client, s_buffer, (int)s_buffer_len);
+    const char *body = data;
+    int body_len = (int)len;
+#if CONFIG_BMU_INFLUX_GZIP
+    size_t gz_len = 0;
+    if (s_gzip_ws && len >= CONFIG_BMU_INFLUX_GZIP_MIN_BYTES) {
+        gz_len = bmu_gzip_compress(s_gzip_ws, (const uint8_t *)data, len,
+                                   s_gzip_buf, GZIP_BUF_SIZE);
+    }
+    if (gz_len > 0 && gz_len < len) {
+        body = (const char *)s_gzip_buf;
+        body_len = (int)gz_len;
+        esp_http_client_set_header(client, "Content-Encoding", "gzip");
+    } else {
+        esp_http_client_delete_header(client, "Content-Encoding");
+    }
+#endif
+    esp_http_client_set_post_field(client, body, body_len);
 
+    int64_t t0 = esp_timer_get_time();
     esp_err_t err = esp_http_client_perform(client);
     if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Échec POST InfluxDB: %s — persistence offline", esp_err_to_name(err));
-        bmu_influx_store_append(s_buffer, s_buffer_len);
-        s_buffer_len = 0;
-        s_buffer_lines = 0;
-        esp_http_client_cleanup(client);
+        on_transport_error();
+        ESP_LOGW(TAG, "Échec POST InfluxDB: %s (retry dans %lu ms)",
+                 esp_err_to_name(err), (unsigned long)s_backoff_ms);
+        s_stats.failures++;
         return err;
     }
+    uint32_t dt_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+
+    /* Transport OK : la connexion est saine, backoff réinitialisé */
+    s_backoff_ms = 0;
+    s_retry_after_us = 0;
+    s_transport_errors = 0;
 
     int status = esp_http_client_get_status_code(client);
     if (status < 200 || status >= 300) {
-        ESP_LOGW(TAG, "InfluxDB HTTP %d — persistence offline", status);
-        bmu_influx_store_append(s_buffer, s_buffer_len);
-        s_buffer_len = 0;
-        s_buffer_lines = 0;
-        esp_http_client_cleanup(client);
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "InfluxDB HTTP %d", status);
+        s_stats.failures++;
+        /* 4xx hors 401/408/429 : corps refusé, un nouvel essai échouerait aussi */
+        bool permanent = status >= 400 && status < 500 &&
+                         status != 401 && status != 408 && status != 429;
+        return permanent ? ESP_ERR_INVALID_RESPONSE : ESP_FAIL;
     }
 
-    ESP_LOGD(TAG, "Flush OK — %d lignes envoyées, HTTP %d", s_buffer_lines, status);
-
-    // Réinitialiser le buffer
-    s_buffer_len = 0;
-    s_buffer_lines = 0;
-
-    esp_http_client_cleanup(client);
+    s_stats.flushes++;
+    s_stats.bytes_raw += len;
+    s_stats.bytes_sent += (uint64_t)body_len;
+    s_stats.last_flush_ms = dt_ms;
+    if (dt_ms > s_stats.max_flush_ms) s_stats.max_flush_ms = dt_ms;
+    s_stats.avg_flush_ms = s_stats.avg_flush_ms
+        ? s_stats.avg_flush_ms + ((int32_t)dt_ms - (int32_t)s_stats.avg_flush_ms) / 8
+        : dt_ms;
+
+    ESP_LOGD(TAG, "POST OK — %d lignes, %d→%d octets, HTTP %d, %lu ms",
+             lines, (int)len, body_len, status, (unsigned long)dt_ms);
+    if (s_stats.flushes % 100 == 0) {
+        ESP_LOGI(TAG, "Stats: %lu flush, %lu échecs, %lu handshakes, %llu octets économisés, "
+                 "latence moy %lu ms (max %lu)",
+                 (unsigned long)s_stats.flushes, (unsigned long)s_stats.failures,
+                 (unsigned long)s_stats.handshakes,
+                 (unsigned long long)(s_stats.bytes_raw - s_stats.bytes_sent),
+                 (unsigned long)s_stats.avg_flush_ms, (unsigned long)s_stats.max_flush_ms);
+    }
     return ESP_OK;
 }
 
+esp_err_t bmu_influx_post_lines(const char *body, size_t len, int lines)
+{
+    if (!s_initialized) return ESP_ERR_INVALID_STATE;
+    if (body == nullptr || len == 0 || len > BMU_INFLUX_POST_MAX) return ESP_ERR_INVALID_ARG;
+    return post_body(body, len, lines);
+}
+
 // ---------------------------------------------------------------------------
-// Write — ajoute une ligne au buffer, flush automatique si plein
+// Flush — envoie le buffer vers InfluxDB, persistance offline si échec
 // ---------------------------------------------------------------------------
-esp_err_t bmu_influx_write(const char *measurement, const char *tags, const char *fields, int64_t timestamp_ns)
+esp_err_t bmu_influx_flush(void)
 {
     if (!s_initialized) {
         return ESP_ERR_INVALID_STATE;
     }
-    if (measurement == nullptr || fields == nullptr) {
-        return ESP_ERR_INVALID_ARG;
+    if (s_buffer_len == 0) {
+        return ESP_OK;  // Rien à envoyer
     }
 
-    // Construire la ligne line-protocol dans un buffer temporaire
-    char line[512];
-    int len;
-    if (tags != nullptr && strlen(tags) > 0) {
-        len = snprintf(line, sizeof(line), "%s,%s %s %" PRId64 "\n",
-                       measurement, tags, fields, timestamp_ns);
-    } else {
-        len = snprintf(line, sizeof(line), "%s %s %" PRId64 "\n",
-                       measurement, fields, timestamp_ns);
+    esp_err_t err = post_body(s_buffer, s_buffer_len, s_buffer_lines);
+    if (err == ESP_ERR_INVALID_RESPONSE) {
+        /* Refus définitif : le rejouer bloquerait le replay */
+        ESP_LOGW(TAG, "Corps refusé par InfluxDB, %d lignes abandonnées", s_buffer_lines);
+    } else if (err != ESP_OK && err != ESP_ERR_NO_MEM) {
+        /* Backoff, transport ou HTTP 5xx/401/408/429 : persistance offline */
+        bmu_influx_store_append(s_buffer, s_buffer_len);
+        if (err == ESP_ERR_TIMEOUT) s_stats.skipped_backoff++;
     }
+    if (err == ESP_ERR_NO_MEM) return err;
 
-    if (len < 0 || (size_t)len >= sizeof(line)) {
-        ESP_LOGW(TAG, "Ligne line-protocol trop longue, ignorée");
-        return ESP_ERR_NO_MEM;
+    // Réinitialiser le buffer
+    s_buffer_len = 0;
+    s_buffer_lines = 0;
+    return err;
+}
+
+// ---------------------------------------------------------------------------
+// Write — sérialise une ligne directement en fin de buffer (bmu_influx_lp)
+// ---------------------------------------------------------------------------
+typedef void (*line_fill_fn)(bmu_lp_writer_t *w, const void *arg);
+
+/* Buffer plein → flush (ou persistance offline si échec, buffer vidé dans
+ * les deux cas) puis nouvel essai dans le buffer libéré */
+static esp_err_t buffer_line(const char *measurement, line_fill_fn fill, const void *arg,
+                             int64_t timestamp_ns)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Vérifier si le buffer peut contenir cette ligne
-    if (s_buffer_len + (size_t)len >= BUFFER_MAX_BYTES) {
-        // Flush automatique avant d'ajouter
-        esp_err_t err = bmu_influx_flush();
-        if (err != ESP_OK) {
-            // Persister le buffer courant + la nouvelle ligne sur disque
-            if (s_buffer_len > 0) {
-                bmu_influx_store_append(s_buffer, s_buffer_len);
-                s_buffer_len = 0;
-                s_buffer_lines = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bmu_lp_writer_t w;
+        bmu_lp_begin(&w, s_buffer + s_buffer_len, BUFFER_MAX_BYTES - 1 - s_buffer_len,
+                     measurement);
+        fill(&w, arg);
+        size_t len = bmu_lp_end(&w, timestamp_ns);
+        if (len > 0) {
+            s_buffer_len += len;
+            s_buffer_lines++;
+            // Flush si le nombre de lignes atteint la limite configurée
+            if (s_buffer_lines >= CONFIG_BMU_INFLUX_BUFFER_SIZE) {
+                return bmu_influx_flush();
             }
-            bmu_influx_store_append(line, (size_t)len);
-            ESP_LOGW(TAG, "Flush échoué — ligne persistée sur stockage offline");
-            return ESP_OK; // Donnée sauvée, pas perdue
+            return ESP_OK;
+        }
+        if (w.nfields == 0) return ESP_ERR_INVALID_ARG;
+        if (s_buffer_len == 0) break;  // ne tient pas même seule
+
+        esp_err_t err = bmu_influx_flush();
+        if (s_buffer_len != 0) return err;  // ESP_ERR_NO_MEM : buffer conservé
+        if (err != ESP_OK && err != ESP_ERR_INVALID_RESPONSE) {
+            ESP_LOGW(TAG, "Flush échoué — buffer persisté sur stockage offline");
         }
     }
 
-    // Copier la ligne dans le buffer
-    memcpy(s_buffer + s_buffer_len, line, (size_t)len);
-    s_buffer_len += (size_t)len;
-    s_buffer_lines++;
+    ESP_LOGW(TAG, "Ligne line-protocol trop longue, ignorée");
+    return ESP_ERR_NO_MEM;
+}
 
-    // Flush si le nombre de lignes atteint la limite configurée
-    if (s_buffer_lines >= CONFIG_BMU_INFLUX_BUFFER_SIZE) {
-        return bmu_influx_flush();
-    }
+typedef struct {
+    const char *tags;
+    const char *fields;
+} raw_line_t;
 
-    return ESP_OK;
+static void fill_raw(bmu_lp_writer_t *w, const void *arg)
+{
+    const raw_line_t *r = (const raw_line_t *)arg;
+    bmu_lp_tags_raw(w, r->tags);
+    bmu_lp_fields_raw(w, r->fields);
+}
+
+esp_err_t bmu_influx_write(const char *measurement, const char *tags, const char *fields, int64_t timestamp_ns)
+{
+    if (measurement == nullptr || fields == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    raw_line_t r = { tags, fields };
+    return buffer_line(measurement, fill_raw, &r, timestamp_ns);
 }
 
 // ---------------------------------------------------------------------------
 // Write Battery Full — télémétrie batterie étendue avec métriques santé
 // ---------------------------------------------------------------------------
-esp_err_t bmu_influx_write_battery_full(const bmu_influx_battery_full_t *d)
+static void fill_battery(bmu_lp_writer_t *w, const void *arg)
 {
-    if (!d || !d->state) return ESP_ERR_INVALID_ARG;
-
-    char tags[64];
-    snprintf(tags, sizeof(tags), "id=%d", d->battery_id);
+    const bmu_influx_battery_full_t *d = (const bmu_influx_battery_full_t *)arg;
 
     /* Schéma canonique (mV / mA / mAh) — identique au pont MQTT/Telegraf. */
-    char fields[512];
-    int len = snprintf(fields, sizeof(fields),
-        "voltage_mv=%.1f,current_ma=%.1f,ah_discharge_mah=%.1f,ah_charge_mah=%.1f,"
-        "nb_switch=%di,state=\"%s\"",
-        d->voltage_mv, d->current_a * 1000.0f,
-        d->ah_discharge * 1000.0f, d->ah_charge * 1000.0f,
-        d->nb_switch, d->state);
-
-    if (!std::isnan(d->r_ohmic_mohm)) {
-        len += snprintf(fields + len, sizeof(fields) - len,
-            ",r_ohmic_mohm=%.1f", d->r_ohmic_mohm);
-    }
-    if (!std::isnan(d->r_total_mohm)) {
-        len += snprintf(fields + len, sizeof(fields) - len,
-            ",r_total_mohm=%.1f", d->r_total_mohm);
-    }
-    if (!std::isnan(d->soh_percent)) {
-        len += snprintf(fields + len, sizeof(fields) - len,
-            ",soh_pct=%.1f", d->soh_percent);
+    bmu_lp_tag_int(w, "id", d->battery_id);
+    bmu_lp_field_fixed(w, "voltage_mv", d->voltage_mv, 1);
+    bmu_lp_field_fixed(w, "current_ma", d->current_a * 1000.0f, 1);
+    bmu_lp_field_fixed(w, "ah_discharge_mah", d->ah_discharge * 1000.0f, 1);
+    bmu_lp_field_fixed(w, "ah_charge_mah", d->ah_charge * 1000.0f, 1);
+    bmu_lp_field_fixed(w, "wh_discharge", d->wh_discharge, 1);
+    bmu_lp_field_fixed(w, "wh_charge", d->wh_charge, 1);
+    bmu_lp_field_int(w, "nb_switch", d->nb_switch);
+    bmu_lp_field_str(w, "state", d->state);
+
+    /* Métriques santé : NaN omis par le sérialiseur */
+    bmu_lp_field_fixed(w, "r_ohmic_mohm", d->r_ohmic_mohm, 1);
+    bmu_lp_field_fixed(w, "r_total_mohm", d->r_total_mohm, 1);
+    bmu_lp_field_fixed(w, "soh_pct", d->soh_percent, 1);
+    if (d->soc_percent >= 0) {
+        bmu_lp_field_fixed(w, "soc_pct", d->soc_percent, 1);
     }
     if (d->balancer_duty >= 0) {
-        len += snprintf(fields + len, sizeof(fields) - len,
-            ",balancer_duty=%di", d->balancer_duty);
+        bmu_lp_field_int(w, "balancer_duty", d->balancer_duty);
     }
+}
 
-    return bmu_influx_write("battery", tags, fields, 0);
+esp_err_t bmu_influx_write_battery_full(const bmu_influx_battery_full_t *d)
+{
+    if (!d || !d->state) return ESP_ERR_INVALID_ARG;
+    return buffer_line("battery", fill_battery, d, 0);
 }
 
 // ---------------------------------------------------------------------------
 // Write Climate — télémétrie température/humidité AHT30
 // ---------------------------------------------------------------------------
+typedef struct {
+    float temperature_c;
+    float humidity_pct;
+} climate_t;
+
+static void fill_climate(bmu_lp_writer_t *w, const void *arg)
+{
+    const climate_t *c = (const climate_t *)arg;
+    bmu_lp_field_fixed(w, "temperature_c", c->temperature_c, 2);
+    bmu_lp_field_fixed(w, "humidity_pct", c->humidity_pct, 1);
+}
+
 esp_err_t bmu_influx_write_climate(float temperature_c, float humidity_pct)
 {
     if (std::isnan(temperature_c) || std::isnan(humidity_pct)) return ESP_ERR_INVALID_ARG;
-
-    char fields[128];
-    snprintf(fields, sizeof(fields),
-        "temperature_c=%.2f,humidity_pct=%.1f",
-        temperature_c, humidity_pct);
-
-    return bmu_influx_write("climate", "", fields, 0);
+    climate_t c = { temperature_c, humidity_pct };
+    return buffer_line("climate", fill_climate, &c, 0);
 }
 
 // ---------------------------------------------------------------------------
@@ -0,0 +1,691 @@
+/**
+ * bmu_influx_columnar — Encodage colonnaire delta/varint du line-protocol
+ * pour le store offline (voir bmu_influx_columnar.h pour le format).
+ */
+
+#include "bmu_influx_columnar.h"
+#include "bmu_influx_gzip.h"   /* bmu_gzip_crc32 */
+
+#include <cstring>
+
+static const uint8_t SEG_MAGIC[5] = { 'K', 'X', 'C', 'O', 'L' };
+static constexpr uint8_t SEG_VERSION = 1;
+static constexpr uint8_t SID_RAW = 0xFF;
+static constexpr uint8_t MAX_DECIMALS = 18;
+
+/* ── Tampons varint (LEB128, zigzag pour les deltas signés) ─────────── */
+
+typedef struct {
+    uint8_t *p;
+    size_t   cap;
+    size_t   pos;
+    bool     overflow;
+} wbuf_t;
+
+static inline void put_u8(wbuf_t *w, uint8_t v)
+{
+    if (w->pos >= w->cap) { w->overflow = true; return; }
+    w->p[w->pos++] = v;
+}
+
+static inline void put_var(wbuf_t *w, uint64_t v)
+{
+    while (v >= 0x80) {
+        put_u8(w, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    put_u8(w, (uint8_t)v);
+}
+
+static inline void put_zz(wbuf_t *w, int64_t v)
+{
+    put_var(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static inline void put_bytes(wbuf_t *w, const void *src, size_t n)
+{
+    if (w->pos + n > w->cap) { w->overflow = true; return; }
+    memcpy(w->p + w->pos, src, n);
+    w->pos += n;
+}
+
+typedef struct {
+    const uint8_t *p;
+    size_t         len;
+    size_t         pos;
+    bool           err;
+} rbuf_t;
+
+static inline uint8_t get_u8(rbuf_t *r)
+{
+    if (r->pos >= r->len) { r->err = true; return 0; }
+    return r->p[r->pos++];
+}
+
+static inline uint64_t get_var(rbuf_t *r)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = get_u8(r);
+        if (r->err) return 0;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->err = true;
+    return 0;
+}
+
+static inline int64_t get_zz(rbuf_t *r)
+{
+    uint64_t u = get_var(r);
+    return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+static inline const uint8_t *get_bytes(rbuf_t *r, size_t n)
+{
+    if (n > r->len - r->pos) { r->err = true; return nullptr; }
+    const uint8_t *p = r->p + r->pos;
+    r->pos += n;
+    return p;
+}
+
+/* ── FNV-1a 64 ─────────────────────────────────────────────────────── */
+
+static constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+static constexpr uint64_t FNV_PRIME  = 0x100000001b3ULL;
+
+static inline uint64_t fnv(uint64_t h, const void *data, size_t n)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/* ── Analyse d'une ligne line-protocol ─────────────────────────────── */
+
+typedef struct {
+    uint16_t name_off;
+    uint8_t  name_len;
+    uint8_t  type;
+    uint8_t  dec;
+    int64_t  val;      /**< STR : offset << 8 | longueur (dans la ligne) */
+} field_t;
+
+typedef struct {
+    uint8_t key_len;
+    uint8_t nf;
+    field_t f[BMU_COL_MAX_FIELDS];
+    bool    has_ts;
+    int64_t ts_ms;
+} row_t;
+
+static inline bool is_field_end(const char *s, size_t n, size_t i)
+{
+    return i >= n || s[i] == ',' || s[i] == ' ';
+}
+
+/* Valeur booléenne : t, T, true, True, TRUE, f, F, false, False, FALSE */
+static bool parse_bool(const char *s, size_t n, size_t *i, int64_t *out)
+{
+    static const char *const WORDS[] = {
+        "true", "True", "TRUE", "t", "T", "false", "False", "FALSE", "f", "F"
+    };
+    for (size_t w = 0; w < sizeof(WORDS) / sizeof(WORDS[0]); w++) {
+        size_t l = strlen(WORDS[w]);
+        if (*i + l <= n && memcmp(s + *i, WORDS[w], l) == 0 && is_field_end(s, n, *i + l)) {
+            *out = (w < 5) ? 1 : 0;
+            *i += l;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Nombre : -?[0-9]*(.[0-9]+)?[iu]? — flottant converti en entier à
+ * décimales fixes (exact), refuse exposants, NaN/Inf et > 18 chiffres. */
+static bool parse_number(const char *s, size_t n, size_t *i, field_t *f)
+{
+    size_t p = *i;
+    bool neg = false;
+    if (p < n && s[p] == '-') { neg = true; p++; }
+
+    uint64_t mant = 0;
+    int digits = 0, dec = 0;
+    bool dot = false;
+    for (; p < n; p++) {
+        char c = s[p];
+        if (c >= '0' && c <= '9') {
+            if (++digits > MAX_DECIMALS) return false;
+            mant = mant * 10 + (uint64_t)(c - '0');
+            if (dot) dec++;
+        } else if (c == '.' && !dot) {
+            dot = true;
+        } else {
+            break;
+        }
+    }
+    if (digits == 0 || (dot && dec == 0)) return false;
+
+    f->type = BMU_COL_T_FLOAT;
+    if (p < n && (s[p] == 'i' || s[p] == 'u')) {
+        if (dot || (s[p] == 'u' && neg)) return false;
+        f->type = (s[p] == 'i') ? BMU_COL_T_INT : BMU_COL_T_UINT;
+        p++;
+    }
+    if (!is_field_end(s, n, p)) return false;
+
+    f->dec = (uint8_t)dec;
+    f->val = neg ? -(int64_t)mant : (int64_t)mant;
+    *i = p;
+    return true;
+}
+
+static bool parse_line(const char *s, size_t n, row_t *r)
+{
+    size_t i = 0;
+
+    /* Clé : mesure + tags jusqu'au premier espace non échappé */
+    while (i < n && s[i] != ' ') i += (s[i] == '\\') ? 2 : 1;
+    if (i == 0 || i >= n || i >= BMU_COL_KEY_MAX) return false;
+    r->key_len = (uint8_t)i;
+    i++;
+
+    r->nf = 0;
+    for (;;) {
+        if (r->nf >= BMU_COL_MAX_FIELDS) return false;
+        field_t *f = &r->f[r->nf];
+
+        size_t name = i;
+        while (i < n && s[i] != '=' && s[i] != ' ' && s[i] != ',') i += (s[i] == '\\') ? 2 : 1;
+        if (i >= n || s[i] != '=' || i == name || i - name >= BMU_COL_NAME_MAX) return false;
+        f->name_off = (uint16_t)name;
+        f->name_len = (uint8_t)(i - name);
+        i++;
+
+        if (i < n && s[i] == '"') {
+            size_t start = ++i;
+            while (i < n && s[i] != '"') i += (s[i] == '\\') ? 2 : 1;
+            if (i >= n || i - start >= BMU_COL_STR_MAX) return false;
+            f->type = BMU_COL_T_STR;
+            f->dec = 0;
+            f->val = (int64_t)((start << 8) | (i - start));
+            i++;
+            if (!is_field_end(s, n, i)) return false;
+        } else if (parse_bool(s, n, &i, &f->val)) {
+            f->type = BMU_COL_T_BOOL;
+            f->dec = 0;
+        } else if (!parse_number(s, n, &i, f)) {
+            return false;
+        }
+        r->nf++;
+
+        if (i >= n) break;
+        if (s[i] == ',') { i++; continue; }
+        i++;    /* espace : timestamp */
+        break;
+    }
+
+    r->has_ts = false;
+    r->ts_ms = 0;
+    if (i < n) {
+        int64_t ns = 0;
+        size_t start = i;
+        for (; i < n && s[i] >= '0' && s[i] <= '9'; i++) {
+            if (i - start >= 19) return false;
+            ns = ns * 10 + (s[i] - '0');
+        }
+        if (i != n || i == start) return false;
+        r->has_ts = (ns != 0);
+        r->ts_ms = ns / 1000000;
+    }
+    return true;
+}
+
+static uint64_t row_signature(const char *s, const row_t *r)
+{
+    uint64_t h = fnv(FNV_OFFSET, s, r->key_len);
+    for (int k = 0; k < r->nf; k++) {
+        const uint8_t meta[3] = { '=', r->f[k].type, r->f[k].dec };
+        h = fnv(h, s + r->f[k].name_off, r->f[k].name_len);
+        h = fnv(h, meta, sizeof(meta));
+    }
+    return h;
+}
+
+/* ── En-têtes ──────────────────────────────────────────────────────── */
+
+void bmu_col_segment_header(uint8_t out[BMU_COL_SEG_HDR_LEN])
+{
+    memcpy(out, SEG_MAGIC, sizeof(SEG_MAGIC));
+    out[5] = SEG_VERSION;
+    out[6] = 0;
+    out[7] = 0;
+}
+
+bool bmu_col_segment_header_ok(const uint8_t hdr[BMU_COL_SEG_HDR_LEN])
+{
+    return memcmp(hdr, SEG_MAGIC, sizeof(SEG_MAGIC)) == 0 && hdr[5] == SEG_VERSION;
+}
+
+static inline void put_le(uint8_t *p, uint64_t v, int n)
+{
+    for (int k = 0; k < n; k++) p[k] = (uint8_t)(v >> (8 * k));
+}
+
+static inline uint64_t get_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    for (int k = 0; k < n; k++) v |= (uint64_t)p[k] << (8 * k);
+    return v;
+}
+
+static void put_frame_header(uint8_t *out, uint8_t type, const uint8_t *payload, uint32_t len)
+{
+    out[0] = 'K';
+    out[1] = type;
+    put_le(out + 2, len, 4);
+    put_le(out + 6, bmu_gzip_crc32(0, payload, len), 4);
+}
+
+bool bmu_col_frame_parse(const uint8_t hdr[BMU_COL_FRAME_HDR_LEN], uint8_t *type,
+                         uint32_t *payload_len, uint32_t *crc)
+{
+    if (hdr[0] != 'K' || (hdr[1] != BMU_COL_FRAME_BLOCK && hdr[1] != BMU_COL_FRAME_INDEX)) {
+        return false;
+    }
+    *type = hdr[1];
+    *payload_len = (uint32_t)get_le(hdr + 2, 4);
+    *crc = (uint32_t)get_le(hdr + 6, 4);
+    return true;
+}
+
+/* ── Index de segment ──────────────────────────────────────────────── */
+
+static const uint8_t FOOTER_MAGIC[4] = { 'K', 'X', 'I', 'X' };
+
+size_t bmu_col_index_build(const bmu_col_index_entry_t *e, size_t n,
+                           uint32_t frame_offset, uint8_t *out, size_t out_cap)
+{
+    size_t plen = n * BMU_COL_INDEX_ENTRY_LEN;
+    size_t total = BMU_COL_FRAME_HDR_LEN + plen + BMU_COL_FOOTER_LEN;
+    if (!out || total > out_cap) return 0;
+
+    uint8_t *p = out + BMU_COL_FRAME_HDR_LEN;
+    for (size_t i = 0; i < n; i++, p += BMU_COL_INDEX_ENTRY_LEN) {
+        put_le(p, e[i].offset, 4);
+        put_le(p + 4, e[i].lines, 2);
+        put_le(p + 6, 0, 2);
+        put_le(p + 8, (uint64_t)e[i].t_first_ms, 8);
+        put_le(p + 16, (uint64_t)e[i].t_last_ms, 8);
+    }
+    put_frame_header(out, BMU_COL_FRAME_INDEX, out + BMU_COL_FRAME_HDR_LEN, (uint32_t)plen);
+    put_le(p, frame_offset, 4);
+    memcpy(p + 4, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+    return total;
+}
+
+bool bmu_col_footer_parse(const uint8_t f[BMU_COL_FOOTER_LEN], uint32_t *index_offset)
+{
+    if (memcmp(f + 4, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) return false;
+    *index_offset = (uint32_t)get_le(f, 4);
+    return true;
+}
+
+void bmu_col_index_entry_read(const uint8_t *p, bmu_col_index_entry_t *e)
+{
+    e->offset = (uint32_t)get_le(p, 4);
+    e->lines = (uint16_t)get_le(p + 4, 2);
+    e->t_first_ms = (int64_t)get_le(p + 8, 8);
+    e->t_last_ms = (int64_t)get_le(p + 16, 8);
+}
+
+void bmu_col_encoder_reset(bmu_col_encoder_t *enc)
+{
+    enc->n_series = 0;
+}
+
+void bmu_col_decoder_reset(bmu_col_decoder_t *dec)
+{
+    dec->n_series = 0;
+}
+
+/* ── Encodage ──────────────────────────────────────────────────────── */
+
+static int find_series(const bmu_col_encoder_t *enc, uint64_t sig, uint8_t nf)
+{
+    for (int i = 0; i < enc->n_series; i++) {
+        if (enc->s[i].sig == sig && enc->s[i].nf == nf) return i;
+    }
+    return -1;
+}
+
+size_t bmu_col_encode_block(bmu_col_encoder_t *enc, const char *text, size_t text_len,
+                            int64_t now_ms, uint8_t *out, size_t out_cap)
+{
+    if (!enc || !text || !out || out_cap < BMU_COL_FRAME_HDR_LEN + 8) return 0;
+
+    /* ── Passe 1 : découpage, analyse, affectation aux séries ── */
+    const uint8_t first_new = enc->n_series;
+    uint8_t def_row[BMU_COL_MAX_SERIES];
+    int nrows = 0, nraw = 0;
+    bool table_full = false;
+    size_t tail = text_len;
+    row_t row;
+
+    size_t pos = 0;
+    while (pos < text_len) {
+        const char *nl = (const char *)memchr(text + pos, '\n', text_len - pos);
+        size_t eol = nl ? (size_t)(nl - text) : text_len;
+        size_t len = eol - pos;
+        if (len == 0) { pos = eol + 1; continue; }
+        if (nrows == BMU_COL_MAX_LINES) { tail = pos; break; }
+
+        const char *line = text + pos;
+        int n = nrows++;
+        enc->row_off[n] = (uint32_t)pos;
+        enc->row_len[n] = (uint32_t)len;
+        enc->row_sid[n] = SID_RAW;
+
+        if (len <= BMU_COL_LINE_MAX && parse_line(line, len, &row)) {
+            uint64_t sig = row_signature(line, &row);
+            int sid = find_series(enc, sig, row.nf);
+            if (sid < 0 && enc->n_series >= BMU_COL_MAX_SERIES) {
+                table_full = true;
+            } else if (sid < 0) {
+                sid = enc->n_series++;
+                bmu_col_enc_series_t *se = &enc->s[sid];
+                memset(se, 0, sizeof(*se));
+                se->sig = sig;
+                se->nf = row.nf;
+                for (int k = 0; k < row.nf; k++) se->types[k] = row.f[k].type;
+                def_row[sid - first_new] = (uint8_t)n;
+            }
+            if (sid >= 0) {
+                enc->row_sid[n] = (uint8_t)sid;
+                enc->row_ts[n] = row.has_ts ? row.ts_ms : now_ms;
+                for (int k = 0; k < row.nf; k++) {
+                    enc->row_val[n][k] = row.f[k].val;
+                }
+            }
+        }
+        if (enc->row_sid[n] == SID_RAW) nraw++;
+        pos = eol + 1;
+    }
+    /* Encodeur déjà chargé : mieux vaut un segment neuf que des lignes raw.
+     * Encodeur vierge (> 64 séries dans un lot) : le surplus part en raw. */
+    if (table_full && first_new > 0) return 0;
+
+    const int raw_rows = nraw;
+    for (pos = tail; pos < text_len; ) {
+        const char *nl = (const char *)memchr(text + pos, '\n', text_len - pos);
+        size_t eol = nl ? (size_t)(nl - text) : text_len;
+        if (eol > pos) nraw++;
+        pos = eol + 1;
+    }
+
+    /* ── Passe 2 : définitions, groupes colonnaires, raw ── */
+    wbuf_t w = { out, out_cap, BMU_COL_FRAME_HDR_LEN, false };
+
+    put_var(&w, (uint64_t)(enc->n_series - first_new));
+    for (int sid = first_new; sid < enc->n_series; sid++) {
+        int n = def_row[sid - first_new];
+        const char *line = text + enc->row_off[n];
+        parse_line(line, enc->row_len[n], &row);
+        put_var(&w, (uint64_t)sid);
+        put_u8(&w, row.key_len);
+        put_bytes(&w, line, row.key_len);
+        put_u8(&w, row.nf);
+        for (int k = 0; k < row.nf; k++) {
+            put_u8(&w, row.f[k].name_len);
+            put_bytes(&w, line + row.f[k].name_off, row.f[k].name_len);
+            put_u8(&w, row.f[k].type);
+            put_u8(&w, row.f[k].dec);
+        }
+    }
+
+    /* Séries présentes, dans l'ordre de première apparition */
+    uint8_t order[BMU_COL_MAX_SERIES];
+    uint8_t counts[BMU_COL_MAX_SERIES] = {};
+    int ngroups = 0;
+    for (int n = 0; n < nrows; n++) {
+        uint8_t sid = enc->row_sid[n];
+        if (sid == SID_RAW) continue;
+        if (counts[sid]++ == 0) order[ngroups++] = sid;
+    }
+
+    put_var(&w, (uint64_t)ngroups);
+    for (int g = 0; g < ngroups; g++) {
+        uint8_t sid = order[g];
+        bmu_col_enc_series_t *se = &enc->s[sid];
+        put_var(&w, sid);
+        put_var(&w, counts[sid]);
+
+        for (int n = 0; n < nrows; n++) {
+            if (enc->row_sid[n] != sid) continue;
+            put_zz(&w, (int64_t)((uint64_t)enc->row_ts[n] - (uint64_t)se->last_ts));
+            se->last_ts = enc->row_ts[n];
+        }
+        for (int k = 0; k < se->nf; k++) {
+            for (int n = 0; n < nrows; n++) {
+                if (enc->row_sid[n] != sid) continue;
+                int64_t v = enc->row_val[n][k];
+                if (se->types[k] == BMU_COL_T_STR) {
+                    const char *str = text + enc->row_off[n] + (size_t)(v >> 8);
+                    size_t slen = (size_t)(v & 0xFF);
+                    uint64_t h = fnv(FNV_OFFSET, str, slen);
+                    if (h == se->str_hash[k]) {
+                        put_var(&w, 0);
+                    } else {
+                        put_var(&w, slen + 1);
+                        put_bytes(&w, str, slen);
+                        se->str_hash[k] = h;
+                    }
+                } else {
+                    put_zz(&w, (int64_t)((uint64_t)v - (uint64_t)se->last[k]));
+                    se->last[k] = v;
+                }
+            }
+        }
+    }
+
+    put_var(&w, (uint64_t)nraw);
+    for (int n = 0; n < nrows; n++) {
+        if (enc->row_sid[n] != SID_RAW) continue;
+        put_var(&w, enc->row_len[n]);
+        put_bytes(&w, text + enc->row_off[n], enc->row_len[n]);
+    }
+    for (pos = tail; pos < text_len; ) {
+        const char *nl = (const char *)memchr(text + pos, '\n', text_len - pos);
+        size_t eol = nl ? (size_t)(nl - text) : text_len;
+        if (eol > pos) {
+            put_var(&w, eol - pos);
+            put_bytes(&w, text + pos, eol - pos);
+        }
+        pos = eol + 1;
+    }
+
+    if (w.overflow) return 0;
+
+    put_frame_header(out, BMU_COL_FRAME_BLOCK, out + BMU_COL_FRAME_HDR_LEN,
+                     (uint32_t)(w.pos - BMU_COL_FRAME_HDR_LEN));
+
+    enc->blk_lines = (uint16_t)(nrows - raw_rows + nraw);
+    enc->blk_t_first = 0;
+    enc->blk_t_last = 0;
+    for (int n = 0; n < nrows; n++) {
+        int64_t t = enc->row_ts[n];
+        if (enc->row_sid[n] == SID_RAW || t <= 0) continue;
+        if (enc->blk_t_first == 0 || t < enc->blk_t_first) enc->blk_t_first = t;
+        if (t > enc->blk_t_last) enc->blk_t_last = t;
+    }
+    return w.pos;
+}
+
+/* ── Décodage ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    char  *p;
+    size_t cap;
+    size_t pos;
+} lbuf_t;
+
+static inline void lb_put(lbuf_t *b, const char *s, size_t n)
+{
+    if (b->pos + n > b->cap) { b->pos = b->cap + 1; return; }
+    memcpy(b->p + b->pos, s, n);
+    b->pos += n;
+}
+
+static void lb_u64(lbuf_t *b, uint64_t v, int min_digits)
+{
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v || n < min_digits);
+    char rev[24];
+    for (int i = 0; i < n; i++) rev[i] = tmp[n - 1 - i];
+    lb_put(b, rev, (size_t)n);
+}
+
+static void lb_value(lbuf_t *b, uint8_t type, uint8_t dec, int64_t v)
+{
+    switch (type) {
+    case BMU_COL_T_BOOL:
+        if (v) lb_put(b, "true", 4); else lb_put(b, "false", 5);
+        return;
+    case BMU_COL_T_UINT:
+        lb_u64(b, (uint64_t)v, 1);
+        lb_put(b, "u", 1);
+        return;
+    default:
+        break;
+    }
+    uint64_t a = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+    if (v < 0) lb_put(b, "-", 1);
+    if (type == BMU_COL_T_INT || dec == 0) {
+        lb_u64(b, a, 1);
+        if (type == BMU_COL_T_INT) lb_put(b, "i", 1);
+        return;
+    }
+    uint64_t p10 = 1;
+    for (int i = 0; i < dec; i++) p10 *= 10;
+    lb_u64(b, a / p10, 1);
+    lb_put(b, ".", 1);
+    lb_u64(b, a % p10, dec);
+}
+
+/* Saute une colonne de n valeurs (pour localiser la suivante) */
+static void skip_column(rbuf_t *r, uint8_t type, int n)
+{
+    for (int i = 0; i < n && !r->err; i++) {
+        uint64_t v = get_var(r);
+        if (type == BMU_COL_T_STR && v > 0) get_bytes(r, (size_t)(v - 1));
+    }
+}
+
+int bmu_col_decode_block(bmu_col_decoder_t *dec, const uint8_t *payload, size_t len,
+                         bmu_col_emit_fn emit, void *ctx)
+{
+    if (!dec || !payload) return -1;
+    rbuf_t r = { payload, len, 0, false };
+    char line[BMU_COL_LINE_MAX + 128];
+    int emitted = 0;
+
+    uint64_t ndefs = get_var(&r);
+    for (uint64_t d = 0; d < ndefs && !r.err; d++) {
+        uint64_t sid = get_var(&r);
+        if (sid != dec->n_series || sid >= BMU_COL_MAX_SERIES) return -1;
+        bmu_col_dec_series_t *se = &dec->s[sid];
+        memset(se, 0, sizeof(*se));
+
+        uint8_t kl = get_u8(&r);
+        const uint8_t *key = get_bytes(&r, kl);
+        if (r.err || kl == 0 || kl >= BMU_COL_KEY_MAX) return -1;
+        memcpy(se->key, key, kl);
+
+        se->nf = get_u8(&r);
+        if (se->nf == 0 || se->nf > BMU_COL_MAX_FIELDS) return -1;
+        for (int k = 0; k < se->nf; k++) {
+            uint8_t nl = get_u8(&r);
+            const uint8_t *name = get_bytes(&r, nl);
+            if (r.err || nl == 0 || nl >= BMU_COL_NAME_MAX) return -1;
+            memcpy(se->names[k], name, nl);
+            se->types[k] = get_u8(&r);
+            se->dec[k] = get_u8(&r);
+            if (se->types[k] > BMU_COL_T_BOOL || se->dec[k] > MAX_DECIMALS) return -1;
+        }
+        dec->n_series++;
+    }
+
+    uint64_t ngroups = get_var(&r);
+    for (uint64_t g = 0; g < ngroups && !r.err; g++) {
+        uint64_t sid = get_var(&r);
+        uint64_t nrows = get_var(&r);
+        if (r.err || sid >= dec->n_series || nrows == 0 || nrows > BMU_COL_MAX_LINES) return -1;
+        bmu_col_dec_series_t *se = &dec->s[sid];
+
+        /* Curseur par colonne : ts puis un par champ */
+        rbuf_t cur[BMU_COL_MAX_FIELDS + 1];
+        cur[0] = r;
+        skip_column(&r, BMU_COL_T_INT, (int)nrows);
+        for (int k = 0; k < se->nf; k++) {
+            cur[k + 1] = r;
+            skip_column(&r, se->types[k], (int)nrows);
+        }
+        if (r.err) return -1;
+
+        for (uint64_t n = 0; n < nrows; n++) {
+            se->last_ts = (int64_t)((uint64_t)se->last_ts + (uint64_t)get_zz(&cur[0]));
+
+            lbuf_t b = { line, sizeof(line), 0 };
+            lb_put(&b, se->key, strlen(se->key));
+            for (int k = 0; k < se->nf; k++) {
+                rbuf_t *c = &cur[k + 1];
+                lb_put(&b, k ? "," : " ", 1);
+                lb_put(&b, se->names[k], strlen(se->names[k]));
+                lb_put(&b, "=", 1);
+                if (se->types[k] == BMU_COL_T_STR) {
+                    uint64_t v = get_var(c);
+                    if (v > 0) {
+                        if (v - 1 >= BMU_COL_STR_MAX) return -1;
+                        const uint8_t *s = get_bytes(c, (size_t)(v - 1));
+                        if (!s) return -1;
+                        memcpy(se->str[k], s, (size_t)(v - 1));
+                        se->str[k][v - 1] = '\0';
+                    }
+                    lb_put(&b, "\"", 1);
+                    lb_put(&b, se->str[k], strlen(se->str[k]));
+                    lb_put(&b, "\"", 1);
+                } else {
+                    se->last[k] = (int64_t)((uint64_t)se->last[k] + (uint64_t)get_zz(c));
+                    lb_value(&b, se->types[k], se->dec[k], se->last[k]);
+                }
+            }
+            if (se->last_ts > 0) {
+                lb_put(&b, " ", 1);
+                lb_u64(&b, (uint64_t)se->last_ts, 1);
+                lb_put(&b, "000000", 6);
+            }
+            if (b.pos > b.cap) return -1;
+            if (emit) emit(line, b.pos, ctx);
+            emitted++;
+        }
+    }
+
+    uint64_t nraw = get_var(&r);
+    for (uint64_t n = 0; n < nraw && !r.err; n++) {
+        uint64_t l = get_var(&r);
+        const uint8_t *s = get_bytes(&r, (size_t)l);
+        if (!s) return -1;
+        if (emit) emit((const char *)s, (size_t)l, ctx);
+        emitted++;
+    }
+
+    if (r.err || r.pos != len) return -1;
+    return emitted;
+}
@@ -0,0 +1,171 @@
+/**
+ * bmu_influx_gzip — Deflate bloc unique, Huffman fixe (RFC 1951 §3.2.6),
+ * encapsulé gzip (RFC 1952) pour Content-Encoding: gzip.
+ */
+
+#include "bmu_influx_gzip.h"
+
+#include <cstring>
+
+/* ── CRC-32 (table 16 entrées, quartet par quartet) ─────────────────── */
+
+static const uint32_t CRC_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t bmu_gzip_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/* ── Écriture de bits (LSB d'abord) ─────────────────────────────────── */
+
+typedef struct {
+    uint8_t *out;
+    size_t   cap;
+    size_t   pos;
+    uint32_t acc;
+    int      nbits;
+    bool     overflow;
+} bitw_t;
+
+static inline void put_bits(bitw_t *w, uint32_t bits, int n)
+{
+    w->acc |= bits << w->nbits;
+    w->nbits += n;
+    while (w->nbits >= 8) {
+        if (w->pos >= w->cap) { w->overflow = true; return; }
+        w->out[w->pos++] = (uint8_t)w->acc;
+        w->acc >>= 8;
+        w->nbits -= 8;
+    }
+}
+
+/* Les codes Huffman s'écrivent MSB d'abord : on les inverse */
+static inline void put_code(bitw_t *w, uint32_t code, int n)
+{
+    uint32_t rev = 0;
+    for (int i = 0; i < n; i++) {
+        rev = (rev << 1) | (code & 1);
+        code >>= 1;
+    }
+    put_bits(w, rev, n);
+}
+
+static void put_litlen(bitw_t *w, int sym)
+{
+    if (sym < 144)      put_code(w, 0x30 + sym, 8);
+    else if (sym < 256) put_code(w, 0x190 + (sym - 144), 9);
+    else if (sym < 280) put_code(w, sym - 256, 7);
+    else                put_code(w, 0xC0 + (sym - 280), 8);
+}
+
+/* Tables longueur (257..285) et distance (0..29) */
+static const uint16_t LEN_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t LEN_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void put_match(bitw_t *w, int len, int dist)
+{
+    int lc = 28;
+    while (LEN_BASE[lc] > len) lc--;
+    put_litlen(w, 257 + lc);
+    if (LEN_EXTRA[lc]) put_bits(w, (uint32_t)(len - LEN_BASE[lc]), LEN_EXTRA[lc]);
+
+    int dc = 29;
+    while (DIST_BASE[dc] > dist) dc--;
+    put_code(w, (uint32_t)dc, 5);
+    if (DIST_EXTRA[dc]) put_bits(w, (uint32_t)(dist - DIST_BASE[dc]), DIST_EXTRA[dc]);
+}
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (v * 2654435761u) >> (32 - BMU_GZIP_HASH_BITS);
+}
+
+/* ── Compression ───────────────────────────────────────────────────── */
+
+size_t bmu_gzip_compress(bmu_gzip_ws_t *ws, const uint8_t *in, size_t in_len,
+                         uint8_t *out, size_t out_cap)
+{
+    static const uint8_t GZ_HEADER[10] = {
+        0x1F, 0x8B, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xFF  /* deflate, pas de mtime, OS inconnu */
+    };
+    if (!ws || !in || !out || in_len > BMU_GZIP_MAX_INPUT || out_cap < 18) return 0;
+
+    memcpy(out, GZ_HEADER, sizeof(GZ_HEADER));
+    bitw_t w = { out, out_cap - 8, sizeof(GZ_HEADER), 0, 0, false };
+
+    put_bits(&w, 1, 1);        /* BFINAL */
+    put_bits(&w, 1, 2);        /* BTYPE = 01 Huffman fixe */
+
+    memset(ws->head, 0, sizeof(ws->head));
+    size_t i = 0;
+    while (i < in_len && !w.overflow) {
+        int best_len = 0, best_dist = 0;
+        if (i + 3 <= in_len) {
+            uint32_t h = hash3(in + i);
+            uint16_t cand = ws->head[h];
+            size_t max_len = in_len - i < 258 ? in_len - i : 258;
+            for (int chain = 0; cand != 0 && chain < BMU_GZIP_MAX_CHAIN; chain++) {
+                size_t c = (size_t)cand - 1;
+                size_t l = 0;
+                while (l < max_len && in[c + l] == in[i + l]) l++;
+                if ((int)l > best_len) {
+                    best_len = (int)l;
+                    best_dist = (int)(i - c);
+                    if (l == max_len) break;
+                }
+                cand = ws->prev[c];
+            }
+            ws->prev[i] = ws->head[h];
+            ws->head[h] = (uint16_t)(i + 1);
+        }
+
+        if (best_len >= 3) {
+            put_match(&w, best_len, best_dist);
+            /* Indexer les positions couvertes par la correspondance */
+            for (size_t k = i + 1; k < i + (size_t)best_len && k + 3 <= in_len; k++) {
+                uint32_t h = hash3(in + k);
+                ws->prev[k] = ws->head[h];
+                ws->head[h] = (uint16_t)(k + 1);
+            }
+            i += (size_t)best_len;
+        } else {
+            put_litlen(&w, in[i]);
+            i++;
+        }
+    }
+    put_litlen(&w, 256);                      /* fin de bloc */
+    if (w.nbits > 0) put_bits(&w, 0, 8 - w.nbits);
+    if (w.overflow) return 0;
+
+    uint32_t crc = bmu_gzip_crc32(0, in, in_len);
+    uint32_t isize = (uint32_t)in_len;
+    for (int k = 0; k < 4; k++) out[w.pos++] = (uint8_t)(crc >> (8 * k));
+    for (int k = 0; k < 4; k++) out[w.pos++] = (uint8_t)(isize >> (8 * k));
+    return w.pos;
+}
@@ -0,0 +1,241 @@
+/**
+ * bmu_influx_lp — Sérialiseur line-protocol direct (voir bmu_influx_lp.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_influx_lp). Les entiers
+ * sont convertis par paires de chiffres, en 32 bits tant que possible :
+ * la division 64 bits est logicielle sur Xtensa.
+ */
+
+#include "bmu_influx_lp.h"
+
+#include <cmath>
+#include <cstring>
+
+static const char DIGITS2[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint32_t POW10[BMU_LP_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000,
+};
+
+/* ── Entiers ─────────────────────────────────────────────────────────── */
+
+/* Écrit v de droite à gauche à partir de end ; renvoie le début */
+static char *utoa_rev(char *end, uint64_t v)
+{
+    while (v > UINT32_MAX) {
+        uint64_t q = v / 100;
+        uint32_t r = (uint32_t)(v - q * 100);
+        end -= 2;
+        memcpy(end, DIGITS2 + 2 * r, 2);
+        v = q;
+    }
+    uint32_t u = (uint32_t)v;
+    while (u >= 100) {
+        uint32_t r = u % 100;
+        u /= 100;
+        end -= 2;
+        memcpy(end, DIGITS2 + 2 * r, 2);
+    }
+    if (u >= 10) {
+        end -= 2;
+        memcpy(end, DIGITS2 + 2 * u, 2);
+    } else {
+        *--end = (char)('0' + u);
+    }
+    return end;
+}
+
+size_t bmu_lp_fmt_i64(char *out, int64_t v)
+{
+    char tmp[20];
+    char *end = tmp + sizeof(tmp);
+    uint64_t mag = (v < 0) ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+    char *p = utoa_rev(end, mag);
+    size_t n = 0;
+    if (v < 0) out[n++] = '-';
+    memcpy(out + n, p, (size_t)(end - p));
+    return n + (size_t)(end - p);
+}
+
+/* ── Écriture bornée ─────────────────────────────────────────────────── */
+
+static inline bool room(bmu_lp_writer_t *w, size_t n)
+{
+    if (w->overflow || w->len + n > w->cap) {
+        w->overflow = true;
+        return false;
+    }
+    return true;
+}
+
+static inline void put(bmu_lp_writer_t *w, const char *s, size_t n)
+{
+    if (!room(w, n)) return;
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+static inline void put_c(bmu_lp_writer_t *w, char c)
+{
+    if (!room(w, 1)) return;
+    w->buf[w->len++] = c;
+}
+
+/* Caractères à échapper selon le contexte */
+enum : uint8_t { ESC_COMMA = 1, ESC_EQ = 2, ESC_SPACE = 4, ESC_QUOTE = 8, ESC_BSLASH = 16 };
+static constexpr uint8_t ESC_MEAS = ESC_COMMA | ESC_SPACE;
+static constexpr uint8_t ESC_KEY  = ESC_COMMA | ESC_EQ | ESC_SPACE;
+static constexpr uint8_t ESC_STR  = ESC_QUOTE | ESC_BSLASH;
+
+static inline uint8_t esc_class(char c)
+{
+    switch (c) {
+    case ',':  return ESC_COMMA;
+    case '=':  return ESC_EQ;
+    case ' ':  return ESC_SPACE;
+    case '"':  return ESC_QUOTE;
+    case '\\': return ESC_BSLASH;
+    default:   return 0;
+    }
+}
+
+/* Copie s en préfixant d'un antislash les caractères de la classe `mask` ;
+ * les portions sans caractère spécial sont copiées d'un bloc */
+static void put_escaped(bmu_lp_writer_t *w, const char *s, uint8_t mask)
+{
+    const char *run = s;
+    for (; *s != '\0'; s++) {
+        if ((esc_class(*s) & mask) == 0) continue;
+        put(w, run, (size_t)(s - run));
+        put_c(w, '\\');
+        run = s;
+    }
+    put(w, run, (size_t)(s - run));
+}
+
+/* Séparateur + clé + '=' d'un champ */
+static void field_key(bmu_lp_writer_t *w, const char *key)
+{
+    put_c(w, w->nfields == 0 ? ' ' : ',');
+    put_escaped(w, key, ESC_KEY);
+    put_c(w, '=');
+    w->nfields++;
+}
+
+/* ── API ─────────────────────────────────────────────────────────────── */
+
+void bmu_lp_begin(bmu_lp_writer_t *w, char *buf, size_t cap, const char *measurement)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->nfields = 0;
+    w->overflow = false;
+    put_escaped(w, measurement, ESC_MEAS);
+}
+
+void bmu_lp_tag(bmu_lp_writer_t *w, const char *key, const char *value)
+{
+    if (value == nullptr || value[0] == '\0') return;  /* tag vide interdit */
+    put_c(w, ',');
+    put_escaped(w, key, ESC_KEY);
+    put_c(w, '=');
+    put_escaped(w, value, ESC_KEY);
+}
+
+void bmu_lp_tag_int(bmu_lp_writer_t *w, const char *key, int32_t value)
+{
+    put_c(w, ',');
+    put_escaped(w, key, ESC_KEY);
+    put_c(w, '=');
+    if (room(w, 20)) w->len += bmu_lp_fmt_i64(w->buf + w->len, value);
+}
+
+void bmu_lp_tags_raw(bmu_lp_writer_t *w, const char *tags)
+{
+    if (tags == nullptr || tags[0] == '\0') return;
+    put_c(w, ',');
+    put(w, tags, strlen(tags));
+}
+
+void bmu_lp_field_fixed(bmu_lp_writer_t *w, const char *key, float value, uint8_t decimals)
+{
+    if (decimals > BMU_LP_MAX_DECIMALS) decimals = BMU_LP_MAX_DECIMALS;
+    /* Produit float × 10^d exact en double : même décision d'arrondi que
+     * printf("%.*f"), sauf égalité parfaite (arrondie loin de zéro ici) */
+    double s = (double)value * POW10[decimals];
+    if (!std::isfinite(s) || std::fabs(s) >= 9.0e18) return;
+    int64_t q = (int64_t)(s < 0 ? s - 0.5 : s + 0.5);
+
+    field_key(w, key);
+    if (!room(w, 22)) return;
+
+    uint64_t mag = (q < 0) ? (uint64_t)0 - (uint64_t)q : (uint64_t)q;
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p;
+    if (decimals == 0) {
+        p = utoa_rev(end, mag);
+    } else {
+        uint64_t ip = mag / POW10[decimals];
+        uint32_t fp = (uint32_t)(mag - ip * POW10[decimals]);
+        p = end;
+        for (uint8_t i = 0; i < decimals; i++) {
+            *--p = (char)('0' + fp % 10);
+            fp /= 10;
+        }
+        *--p = '.';
+        p = utoa_rev(p, ip);
+    }
+    if (q < 0) *--p = '-';
+    memcpy(w->buf + w->len, p, (size_t)(end - p));
+    w->len += (size_t)(end - p);
+}
+
+void bmu_lp_field_int(bmu_lp_writer_t *w, const char *key, int64_t value)
+{
+    field_key(w, key);
+    if (!room(w, 21)) return;
+    w->len += bmu_lp_fmt_i64(w->buf + w->len, value);
+    w->buf[w->len++] = 'i';
+}
+
+void bmu_lp_field_bool(bmu_lp_writer_t *w, const char *key, bool value)
+{
+    field_key(w, key);
+    if (value) {
+        put(w, "true", 4);
+    } else {
+        put(w, "false", 5);
+    }
+}
+
+void bmu_lp_field_str(bmu_lp_writer_t *w, const char *key, const char *value)
+{
+    field_key(w, key);
+    put_c(w, '"');
+    put_escaped(w, value != nullptr ? value : "", ESC_STR);
+    put_c(w, '"');
+}
+
+void bmu_lp_fields_raw(bmu_lp_writer_t *w, const char *fields)
+{
+    if (fields == nullptr || fields[0] == '\0') return;
+    put_c(w, w->nfields == 0 ? ' ' : ',');
+    put(w, fields, strlen(fields));
+    w->nfields++;
+}
+
+size_t bmu_lp_end(bmu_lp_writer_t *w, int64_t timestamp_ns)
+{
+    if (w->nfields == 0) return 0;
+    if (timestamp_ns != 0) {
+        put_c(w, ' ');
+        if (room(w, 20)) w->len += bmu_lp_fmt_i64(w->buf + w->len, timestamp_ns);
+    }
+    put_c(w, '\n');
+    return w->overflow ? 0 : w->len;
+}
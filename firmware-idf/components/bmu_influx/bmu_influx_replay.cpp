@@ -0,0 +1,83 @@
+/**
+ * bmu_influx_replay — Seau à jetons et point de reprise du replay
+ * (voir bmu_influx_replay.h pour le format de replay.ck).
+ */
+
+#include "bmu_influx_replay.h"
+#include "bmu_influx_columnar.h"   /* BMU_COL_SEG_HDR_LEN */
+#include "bmu_influx_gzip.h"       /* bmu_gzip_crc32 */
+
+/* ── Seau à jetons ───────────────────────────────────────────────────── */
+
+int32_t bmu_replay_bucket_refill(bmu_replay_bucket_t *b, int64_t now_us,
+                                 int32_t rate_bps, int32_t burst, int64_t gap_max_us)
+{
+    if (b->last_us != 0) {
+        int64_t gap = now_us - b->last_us;
+        if (gap < 0) gap = 0;
+        if (gap > gap_max_us) gap = gap_max_us;
+        int64_t add = gap * rate_bps / 1000000;
+        int64_t cap = add > burst ? add : burst;
+        int64_t t = (int64_t)b->tokens + add;
+        b->tokens = (int32_t)(t > cap ? cap : t);
+    } else {
+        b->tokens = burst;
+    }
+    b->last_us = now_us;
+    return b->tokens;
+}
+
+bool bmu_replay_bucket_spend(bmu_replay_bucket_t *b, size_t len)
+{
+    b->tokens -= (int32_t)len;
+    return b->tokens > 0;
+}
+
+/* ── Point de reprise ────────────────────────────────────────────────── */
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void bmu_replay_ck_start(bmu_replay_ck_t *ck, uint32_t seq)
+{
+    ck->seq = seq;
+    ck->offset = BMU_COL_SEG_HDR_LEN;
+    ck->skip = 0;
+}
+
+void bmu_replay_ck_encode(const bmu_replay_ck_t *ck, uint8_t *out)
+{
+    put_u32(out, BMU_REPLAY_CK_MAGIC);
+    put_u32(out + 4, ck->seq);
+    put_u32(out + 8, ck->offset);
+    put_u32(out + 12, ck->skip);
+    put_u32(out + 16, bmu_gzip_crc32(0, out, 16));
+}
+
+bool bmu_replay_ck_decode(const uint8_t *buf, size_t len, bmu_replay_ck_t *ck)
+{
+    if (buf == nullptr || len < BMU_REPLAY_CK_LEN) return false;
+    if (get_u32(buf) != BMU_REPLAY_CK_MAGIC) return false;
+    if (get_u32(buf + 16) != bmu_gzip_crc32(0, buf, 16)) return false;
+    ck->seq = get_u32(buf + 4);
+    ck->offset = get_u32(buf + 8);
+    ck->skip = get_u32(buf + 12);
+    return true;
+}
+
+uint32_t bmu_replay_ck_skip(const bmu_replay_ck_t *ck, uint32_t blk_off)
+{
+    if (blk_off < ck->offset) return BMU_REPLAY_SKIP_ALL;
+    return blk_off == ck->offset ? ck->skip : 0;
+}
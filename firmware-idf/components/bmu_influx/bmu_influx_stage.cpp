@@ -0,0 +1,85 @@
+/**
+ * bmu_influx_stage — Staging aligné secteur du segment ouvert
+ * (voir bmu_influx_stage.h).
+ */
+
+#include "bmu_influx_stage.h"
+
+#include <cstring>
+
+void bmu_stage_init(bmu_stage_t *s, uint8_t *buf, size_t cap,
+                    bmu_stage_write_fn_t write, void *ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->buf = buf;
+    s->cap = cap;
+    s->write = write;
+    s->ctx = ctx;
+}
+
+void bmu_stage_open(bmu_stage_t *s)
+{
+    s->len = 0;
+    s->file_off = 0;
+}
+
+/* Chaque écriture s'arrête sur une frontière de secteur du fichier */
+bool bmu_stage_drain(bmu_stage_t *s, bool all)
+{
+    size_t done = 0;
+    bool ok = true;
+    while (done < s->len) {
+        size_t room = BMU_STAGE_SECTOR - (s->file_off % BMU_STAGE_SECTOR);
+        size_t n = s->len - done;
+        if (n >= room) {
+            n = room;
+        } else if (!all) {
+            break;
+        }
+        if (!s->write(s->buf + done, n, s->ctx)) {
+            ok = false;
+            break;
+        }
+        done += n;
+        s->file_off += n;
+    }
+    memmove(s->buf, s->buf + done, s->len - done);
+    s->len -= done;
+    return ok;
+}
+
+bool bmu_stage_put(bmu_stage_t *s, const uint8_t *data, size_t n, int64_t now_us)
+{
+    if (s->len + n > s->cap && !bmu_stage_drain(s, false)) return false;
+    if (s->len + n > s->cap && !bmu_stage_drain(s, true)) return false;
+    if (s->len + n > s->cap) return false;      /* bloc plus grand que le tampon */
+    memcpy(s->buf + s->len, data, n);
+    s->len += n;
+    if (s->unsynced == 0) s->dirty_us = now_us;
+    s->unsynced += n;
+    return true;
+}
+
+bool bmu_stage_sync_due(const bmu_stage_t *s, int64_t now_us, size_t sync_bytes,
+                        int64_t sync_us)
+{
+    if (s->unsynced == 0) return false;
+    return s->unsynced >= sync_bytes || now_us - s->dirty_us >= sync_us;
+}
+
+bool bmu_stage_wake_due(const bmu_stage_t *s, size_t sync_bytes)
+{
+    return s->len >= BMU_STAGE_SECTOR || s->unsynced >= sync_bytes;
+}
+
+void bmu_stage_synced(bmu_stage_t *s)
+{
+    s->unsynced = 0;
+}
+
+size_t bmu_stage_discard(bmu_stage_t *s)
+{
+    size_t lost = s->len;
+    s->len = 0;
+    return lost;
+}
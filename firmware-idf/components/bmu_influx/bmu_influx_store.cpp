@@ -1,22 +1,57 @@
 /**
- * bmu_influx_store — Buffer persistant InfluxDB avec rotation et fallback SD.
+ * bmu_influx_store — Buffer persistant InfluxDB colonnaire avec fallback SD.
  *
  * Stratégie :
- *   1. Écrire dans /fatfs/influx/current.lp (line-protocol)
- *   2. Quand current.lp dépasse FILE_MAX → renommer en rotated.lp (écrase l'ancien)
- *   3. Si FAT plein ou non monté → fallback sur /sdcard/influx/
- *   4. Replay : lire rotated.lp puis current.lp, envoyer ligne par ligne via bmu_influx_flush
+ *   1. Chaque flush échoué est encodé en un bloc colonnaire (bmu_influx_columnar :
+ *      séries par batterie, deltas zigzag/varint, CRC32) ajouté au segment courant
+ *      /fatfs/influx/NNNNNNNN.col
+ *      Le segment courant reste ouvert ; les blocs passent par un staging
+ *      PSRAM que la tâche writer écrit par secteurs de 4 KB alignés, avec
+ *      fsync selon CONFIG_BMU_INFLUX_STORE_SYNC_MS / _SYNC_KB
+ *   2. Segment plein (CONFIG_BMU_INFLUX_STORE_SEG_KB) → scellé avec son index
+ *      (offset, lignes, période de chaque bloc), le suivant repart d'un état
+ *      d'encodage vierge ; au-delà de CONFIG_BMU_INFLUX_STORE_SEG_COUNT
+ *      segments, le plus ancien est supprimé
+ *   3. Si FAT non monté → fallback sur /sdcard/influx/
+ *   4. Replay : décode les segments scellés du plus ancien au plus récent,
+ *      regénère le line-protocol (timestamps explicites) dans des corps de
+ *      BMU_INFLUX_POST_MAX envoyés directement (bmu_influx_post_lines, hors
+ *      buffer live). Après chaque POST acquitté, le point de reprise
+ *      (segment, bloc, ligne) est persisté dans replay.ck ; débit limité par
+ *      seau à jetons (CONFIG_BMU_INFLUX_REPLAY_RATE_KBPS)
+ *   5. Lecture externe (historique BLE) : les segments épinglés
+ *      (bmu_influx_store_pin) ne sont ni rejoués ni supprimés par la
+ *      rotation tant que le transfert dure ; le replay attend
+ *
+ * Les anciens fichiers texte current.lp / rotated.lp sont convertis en
+ * segments au démarrage puis supprimés.
  */
 
 #include "bmu_influx_store.h"
 #include "bmu_influx.h"
+#include "bmu_influx_columnar.h"
+#include "bmu_influx_gzip.h"
+#include "bmu_influx_replay.h"
+#include "bmu_influx_stage.h"
 #include "bmu_storage.h"
 
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <strings.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <dirent.h>
+#include <unistd.h>
 
 static const char *TAG = "INFLUX_STORE";
 
@@ -33,6 +68,44 @@ static const char *SD_ROTATED   = BMU_SD_MOUNT "/influx/rotated.lp";
 static bool s_initialized = false;
 static bool s_use_sd = false;  /* true si FAT indisponible, fallback SD */
 
+/* ── Segments ────────────────────────────────────────────────────────── */
+
+static constexpr size_t SEG_MAX_BYTES = (size_t)CONFIG_BMU_INFLUX_STORE_SEG_KB * 1024;
+
+/* Segments existants : [s_first_seq, s_cur_seq], s_cur_seq seulement si s_cur_exists */
+static uint32_t s_first_seq = 1;
+static uint32_t s_cur_seq = 1;
+static bool     s_cur_exists = false;
+static size_t   s_cur_bytes = 0;
+static size_t   s_pending_bytes = 0;
+static uint32_t s_replay_seq = 0;      /* Segment en cours de replay (0 = aucun) */
+static uint32_t s_pin_first = 0;       /* Segments >= épinglés (0 = aucun) */
+static bool     s_pin_active = false;  /* Transfert en cours */
+static int64_t  s_pin_until_us = 0;    /* Sinon : rétention pour reprise */
+static uint32_t s_dropped_segments = 0;
+
+static bmu_col_encoder_t *s_enc = NULL;  /* ~38 KB, PSRAM */
+static uint8_t *s_block = NULL;          /* Bloc encodé, BMU_INFLUX_STORE_BLOCK_MAX */
+static bmu_col_index_entry_t *s_index = NULL;  /* Index du segment courant */
+static size_t s_index_n = 0;
+
+/* Segment courant : handle ouvert en continu. Les blocs s'accumulent dans
+ * un staging PSRAM écrit par secteurs entiers (bmu_influx_stage.h) ; la
+ * taille est suivie par compteur (s_cur_bytes), sans stat() sur le chemin
+ * d'écriture. */
+static constexpr size_t STAGE_MAX = (size_t)CONFIG_BMU_INFLUX_STORE_STAGE_KB * 1024;
+static constexpr size_t SYNC_BYTES = (size_t)CONFIG_BMU_INFLUX_STORE_SYNC_KB * 1024;
+static constexpr int64_t SYNC_US = (int64_t)CONFIG_BMU_INFLUX_STORE_SYNC_MS * 1000;
+
+static FILE    *s_file = nullptr;
+static uint8_t *s_stage = NULL;
+static bmu_stage_t s_stg = {};
+static uint32_t s_write_errors = 0;
+
+/* Writer (tâche store) et cloud (append, replay) */
+static SemaphoreHandle_t s_mutex = NULL;
+static TaskHandle_t s_task = NULL;
+
 /* ── Helpers ─────────────────────────────────────────────────────────── */
 
 static bool dir_exists(const char *path)
@@ -60,153 +133,689 @@ static long file_size(const char *path)
     return st.st_size;
 }
 
+static const char *store_dir(void)    { return s_use_sd ? SD_DIR : FAT_DIR; }
 static const char *current_path(void) { return s_use_sd ? SD_CURRENT : FAT_CURRENT; }
 static const char *rotated_path(void) { return s_use_sd ? SD_ROTATED : FAT_ROTATED; }
 
+/* Noms 8.3 (FATFS sans LFN) */
+static void seg_path(char *buf, size_t len, uint32_t seq)
+{
+    snprintf(buf, len, "%s/%08lu.col", store_dir(), (unsigned long)seq);
+}
+
+static void *alloc_psram(size_t size)
+{
+    void *p = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) p = calloc(1, size);  /* fallback DRAM */
+    return p;
+}
+
+/* Horodatage des lignes sans timestamp ; 0 tant que l'heure n'est pas valide */
+static int64_t clock_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < 1700000000) return 0;
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* ── Staging / écriture ──────────────────────────────────────────────── */
+
+static bool file_write(const uint8_t *data, size_t len, void *)
+{
+    return s_file != nullptr && fwrite(data, 1, len, s_file) == len;
+}
+
+static bool stage_put(const uint8_t *data, size_t n)
+{
+    return bmu_stage_put(&s_stg, data, n, esp_timer_get_time());
+}
+
+/* Tout le staging sur disque puis fsync (FAT et table d'allocation) */
+static bool file_sync(void)
+{
+    if (s_file == nullptr) return true;
+    bool ok = bmu_stage_drain(&s_stg, true);
+    if (ok) ok = fflush(s_file) == 0 && fsync(fileno(s_file)) == 0;
+    bmu_stage_synced(&s_stg);
+    return ok;
+}
+
+static void file_close(void)
+{
+    if (s_file == nullptr) return;
+    if (!file_sync()) s_write_errors++;
+    fclose(s_file);
+    s_file = nullptr;
+    bmu_stage_discard(&s_stg);
+}
+
 /* ── Rotation ────────────────────────────────────────────────────────── */
 
-static void rotate_if_needed(void)
+static void remove_segment(uint32_t seq)
 {
-    long sz = file_size(current_path());
-    if (sz < BMU_INFLUX_STORE_FILE_MAX) return;
+    char path[48];
+    seg_path(path, sizeof(path), seq);
+    long sz = file_size(path);
+    remove(path);
+    s_pending_bytes = (s_pending_bytes > (size_t)sz) ? s_pending_bytes - (size_t)sz : 0;
+}
 
-    /* Supprimer l'ancien rotated, renommer current → rotated */
-    remove(rotated_path());
-    if (rename(current_path(), rotated_path()) == 0) {
-        ESP_LOGI(TAG, "Rotation: %s → %s (%ld octets)", current_path(), rotated_path(), sz);
+/* Index en fin de segment ; facultatif (un segment sans index se relit
+ * quand même), donc un échec n'est que journalisé */
+static void stage_index(void)
+{
+    size_t n = bmu_col_index_build(s_index, s_index_n, (uint32_t)s_cur_bytes,
+                                   s_block, BMU_INFLUX_STORE_BLOCK_MAX);
+    if (n > 0 && stage_put(s_block, n)) {
+        s_cur_bytes += n;
+        s_pending_bytes += n;
     } else {
-        /* rename échoué (cross-device?) — tronquer */
-        ESP_LOGW(TAG, "Rename échoué, truncation de %s", current_path());
-        FILE *f = fopen(current_path(), "w");
-        if (f) fclose(f);
+        ESP_LOGW(TAG, "Index du segment %lu non écrit", (unsigned long)s_cur_seq);
     }
 }
 
-/* ── Init ────────────────────────────────────────────────────────────── */
+/* Scelle le segment courant : le suivant repart d'un état d'encodage vierge.
+ * with_index = false si la fin du segment est douteuse (écriture échouée). */
+static void seal_current(bool with_index)
+{
+    if (s_cur_exists) {
+        if (with_index && s_index_n > 0) stage_index();
+        file_close();
+        s_cur_seq++;
+        s_cur_exists = false;
+        s_cur_bytes = 0;
+    }
+    s_index_n = 0;
+    if (s_enc) bmu_col_encoder_reset(s_enc);
+}
 
-esp_err_t bmu_influx_store_init(void)
+/* Écriture refusée (disque plein ?) : le staging est perdu et le bloc
+ * partiel en fin de segment arrête le replay → segment scellé sans index */
+static void segment_failed(void)
 {
-    s_use_sd = false;
+    size_t lost = bmu_stage_discard(&s_stg);
+    ESP_LOGW(TAG, "Écriture segment %lu échouée (disque plein ?), %u octets perdus",
+             (unsigned long)s_cur_seq, (unsigned)lost);
+    s_write_errors++;
+    s_pending_bytes = (s_pending_bytes > lost) ? s_pending_bytes - lost : 0;
+    seal_current(false);
+}
 
-    /* Priorité FAT interne (wear-leveled, toujours disponible) */
-    if (bmu_fat_is_mounted() && ensure_dir(FAT_DIR)) {
-        s_use_sd = false;
-        s_initialized = true;
-        ESP_LOGI(TAG, "Store init sur FAT interne (%s)", FAT_DIR);
-        return ESP_OK;
+/* Sous mutex. Épinglage retenu expiré : libéré ici */
+static bool seg_pinned(uint32_t seq)
+{
+    if (s_pin_first == 0) return false;
+    if (!s_pin_active && esp_timer_get_time() >= s_pin_until_us) {
+        s_pin_first = 0;
+        return false;
     }
+    return seq >= s_pin_first;
+}
 
-    /* Fallback SD si présente */
-    if (bmu_sd_is_mounted() && ensure_dir(SD_DIR)) {
-        s_use_sd = true;
-        s_initialized = true;
-        ESP_LOGI(TAG, "Store init sur carte SD (fallback) (%s)", SD_DIR);
-        return ESP_OK;
+static void enforce_budget(void)
+{
+    while (s_cur_seq + (s_cur_exists ? 1 : 0) - s_first_seq
+               > (uint32_t)CONFIG_BMU_INFLUX_STORE_SEG_COUNT) {
+        if (s_first_seq == s_replay_seq) break;  /* ouvert par le replay */
+        if (seg_pinned(s_first_seq)) break;      /* lu par l'historique BLE */
+        remove_segment(s_first_seq);
+        s_first_seq++;
+        s_dropped_segments++;
+        ESP_LOGW(TAG, "Budget atteint — segment le plus ancien supprimé (%lu perdus)",
+                 (unsigned long)s_dropped_segments);
     }
+}
 
-    ESP_LOGW(TAG, "Aucun stockage disponible — données offline seront perdues");
-    return ESP_ERR_NOT_FOUND;
+static bool open_segment(void)
+{
+    char path[48];
+    seg_path(path, sizeof(path), s_cur_seq);
+    uint8_t hdr[BMU_COL_SEG_HDR_LEN];
+    bmu_col_segment_header(hdr);
+
+    FILE *f = fopen(path, "wb");
+    if (f == nullptr) {
+        ESP_LOGW(TAG, "Impossible de créer %s", path);
+        return false;
+    }
+    /* Écritures déjà groupées par secteur : pas de buffer stdio */
+    setvbuf(f, nullptr, _IONBF, 0);
+    s_file = f;
+    bmu_stage_open(&s_stg);
+    stage_put(hdr, sizeof(hdr));
+    s_cur_exists = true;
+    s_cur_bytes = sizeof(hdr);
+    s_pending_bytes += sizeof(hdr);
+    enforce_budget();
+    return true;
+}
+
+/* Secteurs complets, puis fsync si la politique l'exige */
+static void writer_service(void)
+{
+    if (s_file == nullptr) return;
+    bool ok = bmu_stage_drain(&s_stg, false);
+    if (ok && bmu_stage_sync_due(&s_stg, esp_timer_get_time(), SYNC_BYTES, SYNC_US)) {
+        ok = file_sync();
+    }
+    if (!ok) segment_failed();
 }
 
 /* ── Append ──────────────────────────────────────────────────────────── */
 
-esp_err_t bmu_influx_store_append(const char *line, size_t len)
+static esp_err_t append_chunk(const char *text, size_t len, int64_t now_ms)
 {
-    if (!s_initialized || line == nullptr || len == 0) {
-        return ESP_ERR_INVALID_STATE;
+    if (s_cur_exists && (s_cur_bytes >= SEG_MAX_BYTES ||
+                         s_index_n >= BMU_INFLUX_STORE_INDEX_MAX)) {
+        seal_current(true);
     }
 
-    rotate_if_needed();
+    size_t n = bmu_col_encode_block(s_enc, text, len, now_ms,
+                                    s_block, BMU_INFLUX_STORE_BLOCK_MAX);
+    if (n == 0) {
+        /* Table de séries pleine : nouveau segment, état vierge */
+        seal_current(true);
+        n = bmu_col_encode_block(s_enc, text, len, now_ms,
+                                 s_block, BMU_INFLUX_STORE_BLOCK_MAX);
+        if (n == 0) {
+            bmu_col_encoder_reset(s_enc);
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
-    FILE *f = fopen(current_path(), "a");
-    if (f == nullptr) {
-        ESP_LOGW(TAG, "Impossible d'ouvrir %s", current_path());
+    if (!s_cur_exists && !open_segment()) {
+        bmu_col_encoder_reset(s_enc);
+        return ESP_FAIL;
+    }
+    if (!stage_put(s_block, n)) {
+        segment_failed();
         return ESP_FAIL;
     }
+    bmu_col_index_entry_t *e = &s_index[s_index_n++];
+    e->offset = (uint32_t)s_cur_bytes;
+    e->lines = s_enc->blk_lines;
+    e->t_first_ms = s_enc->blk_t_first;
+    e->t_last_ms = s_enc->blk_t_last;
+    s_cur_bytes += n;
+    s_pending_bytes += n;
+
+    if (s_task == NULL) {
+        writer_service();  /* avant le démarrage de la tâche : synchrone */
+    } else if (bmu_stage_wake_due(&s_stg, SYNC_BYTES)) {
+        xTaskNotifyGive(s_task);
+    }
+    return ESP_OK;
+}
 
-    size_t written = fwrite(line, 1, len, f);
-    bool ok = (written == len);
-    /* S'assurer que la ligne se termine par \n (audit H11 : vérifier fputc
-     * ET fclose — sur disque plein une ligne sans \n corrompt le replay). */
-    if (ok && len > 0 && line[len - 1] != '\n') {
-        if (fputc('\n', f) == EOF) ok = false;
+esp_err_t bmu_influx_store_append(const char *line, size_t len)
+{
+    if (!s_initialized || line == nullptr || len == 0) {
+        return ESP_ERR_INVALID_STATE;
     }
-    if (fclose(f) != 0) ok = false;
 
-    return ok ? ESP_OK : ESP_FAIL;
+    int64_t now_ms = clock_ms();
+    esp_err_t ret = ESP_OK;
+    size_t pos = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    while (pos < len) {
+        /* Découpe aux fins de ligne pour borner la taille d'un bloc */
+        size_t chunk = len - pos;
+        if (chunk > BMU_INFLUX_STORE_CHUNK_MAX) {
+            chunk = BMU_INFLUX_STORE_CHUNK_MAX;
+            while (chunk > 0 && line[pos + chunk - 1] != '\n') chunk--;
+            if (chunk == 0) chunk = BMU_INFLUX_STORE_CHUNK_MAX;
+        }
+        ret = append_chunk(line + pos, chunk, now_ms);
+        if (ret != ESP_OK) break;
+        pos += chunk;
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
 }
 
-/* ── Replay ──────────────────────────────────────────────────────────── */
+/* ── Migration des anciens fichiers texte ────────────────────────────── */
 
-static int replay_file(const char *path)
+static void migrate_legacy(const char *path)
 {
     FILE *f = fopen(path, "r");
-    if (f == nullptr) return 0;
-
-    char line[512];
-    int count = 0;
-    int errors = 0;
-
-    while (fgets(line, sizeof(line), f) != nullptr) {
-        size_t len = strlen(line);
-        /* Audit H6 : ligne plus longue que le buffer (pas de \n et buffer
-         * plein) → tronquée. On consomme le reste de la ligne et on l'ignore
-         * plutôt que de rejouer une moitié corrompue. */
-        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
-            int c;
-            while ((c = fgetc(f)) != '\n' && c != EOF) { /* drain */ }
-            errors++;
-            continue;
-        }
-        /* Retirer le \n final */
-        if (len > 0 && line[len - 1] == '\n') {
-            line[--len] = '\0';
+    if (f == nullptr) return;
+
+    char *text = (char *)alloc_psram(BMU_INFLUX_STORE_CHUNK_MAX);
+    if (text == nullptr) {
+        fclose(f);
+        return;
+    }
+    size_t have = 0, total = 0;
+    bool ok = true;
+    for (;;) {
+        have += fread(text + have, 1, BMU_INFLUX_STORE_CHUNK_MAX - have, f);
+        if (have == 0) break;
+        size_t cut = have;
+        if (have == BMU_INFLUX_STORE_CHUNK_MAX) {
+            while (cut > 0 && text[cut - 1] != '\n') cut--;
+            if (cut == 0) cut = have;  /* ligne démesurée : passera en raw */
         }
-        if (len == 0) continue;
-
-        /* Parser la ligne line-protocol et la re-soumettre au buffer mémoire.
-         * On utilise bmu_influx_write brut — la ligne est déjà formatée.
-         * Ajout direct dans le buffer statique de bmu_influx. */
-        esp_err_t ret = bmu_influx_write_raw(line, len);
-        if (ret == ESP_OK) {
-            count++;
-        } else {
-            errors++;
-            if (errors > 5) {
-                ESP_LOGW(TAG, "Trop d'erreurs replay — arrêt (connexion perdue ?)");
-                break;
-            }
+        if (append_chunk(text, cut, clock_ms()) != ESP_OK) {
+            ok = false;
+            break;
         }
+        total += cut;
+        memmove(text, text + cut, have - cut);
+        have -= cut;
     }
-
     fclose(f);
+    free(text);
 
-    if (errors == 0) {
-        /* Fichier entièrement rejoué — supprimer */
+    if (ok) {
         remove(path);
-        ESP_LOGI(TAG, "Replay %s terminé: %d lignes", path, count);
+        ESP_LOGI(TAG, "Migration %s → segments colonnaires (%u octets)", path, (unsigned)total);
     } else {
-        ESP_LOGW(TAG, "Replay %s partiel: %d OK, %d erreurs", path, count, errors);
+        ESP_LOGW(TAG, "Migration %s interrompue, nouvel essai au prochain boot", path);
     }
+}
+
+/* ── Replay ──────────────────────────────────────────────────────────── */
+
+/* Point de reprise persisté après chaque POST acquitté : le replay reprend
+ * à la ligne près après une coupure Wi-Fi ou un reboot (bmu_influx_replay.h) */
+static bmu_replay_ck_t s_ck = {};
+static uint32_t s_replay_rejected = 0;  /* Lignes refusées par InfluxDB (4xx) */
+static bmu_replay_bucket_t s_bucket = {};  /* Octets line-protocol */
 
-    return count;
+static constexpr int32_t REPLAY_RATE_BPS = CONFIG_BMU_INFLUX_REPLAY_RATE_KBPS * 1024;
+static constexpr int32_t REPLAY_BURST = 2 * BMU_INFLUX_POST_MAX;
+/* Écart d'appel pris en compte au plus (période cloud) : au-delà, Wi-Fi
+ * coupé ou replay en pause, pas de crédit accumulé */
+static constexpr int64_t REPLAY_GAP_MAX_US = 10 * 1000000LL;
+
+static void ck_path(char *buf, size_t len)
+{
+    snprintf(buf, len, "%s/replay.ck", store_dir());
+}
+
+static void ck_load(void)
+{
+    char path[48];
+    ck_path(path, sizeof(path));
+    uint8_t buf[BMU_REPLAY_CK_LEN];
+    size_t n = 0;
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        n = fread(buf, 1, sizeof(buf), f);
+        fclose(f);
+    }
+    if (!bmu_replay_ck_decode(buf, n, &s_ck)) s_ck = bmu_replay_ck_t{};
+}
+
+static void ck_save(void)
+{
+    char path[48];
+    ck_path(path, sizeof(path));
+    uint8_t buf[BMU_REPLAY_CK_LEN];
+    bmu_replay_ck_encode(&s_ck, buf);
+    /* Écriture déchirée → CRC invalide → reprise au début du segment
+     * (doublons possibles, jamais de perte) */
+    FILE *f = fopen(path, "wb");
+    if (f == nullptr) return;
+    fwrite(buf, 1, sizeof(buf), f);
+    fclose(f);
+}
+
+typedef struct {
+    char    *body;          /* Corps POST en construction (BMU_INFLUX_POST_MAX) */
+    size_t   len;
+    int      lines;
+    uint32_t seq;
+    uint32_t blk_off;       /* Bloc en cours de décodage */
+    uint32_t line_idx;      /* Prochaine ligne de ce bloc */
+    uint32_t skip;          /* Lignes déjà acquittées à sauter */
+    int      sent;          /* Lignes acquittées pendant cet appel */
+    bool     stop;          /* Échec POST ou budget épuisé */
+} replay_ctx_t;
+
+/* POST du corps courant ; en cas de succès le checkpoint avance jusqu'à la
+ * première ligne non envoyée. Corps refusé définitivement (4xx hors
+ * 401/408/429) : sauté et compté, sinon il bloquerait tout l'arriéré ;
+ * transport, backoff, 5xx : nouvel essai au prochain appel. */
+static bool replay_post(replay_ctx_t *c)
+{
+    if (c->len == 0) return true;
+    esp_err_t err = bmu_influx_post_lines(c->body, c->len, c->lines);
+    if (err == ESP_ERR_INVALID_RESPONSE) {
+        s_replay_rejected += (uint32_t)c->lines;
+        ESP_LOGW(TAG, "Replay: corps refusé, %d lignes sautées (segment %lu octet %lu, %lu au total)",
+                 c->lines, (unsigned long)c->seq, (unsigned long)c->blk_off,
+                 (unsigned long)s_replay_rejected);
+    } else if (err != ESP_OK) {
+        c->stop = true;
+        return false;
+    } else {
+        c->sent += c->lines;
+    }
+    bool credit = bmu_replay_bucket_spend(&s_bucket, c->len);
+    c->len = 0;
+    c->lines = 0;
+    s_ck.seq = c->seq;
+    s_ck.offset = c->blk_off;
+    s_ck.skip = c->line_idx;
+    ck_save();
+    if (!credit) c->stop = true;   /* laisser passer le live */
+    return true;
+}
+
+static void replay_emit(const char *line, size_t len, void *arg)
+{
+    replay_ctx_t *c = (replay_ctx_t *)arg;
+    if (c->stop) return;   /* le décodeur termine le bloc, rien n'est envoyé */
+    if (c->skip > 0) {
+        c->skip--;
+        c->line_idx++;
+        return;
+    }
+    if (c->len + len + 1 > BMU_INFLUX_POST_MAX) {
+        if (!replay_post(c) || c->stop) return;
+    }
+    if (len + 1 <= BMU_INFLUX_POST_MAX) {
+        memcpy(c->body + c->len, line, len);
+        c->body[c->len + len] = '\n';
+        c->len += len + 1;
+        c->lines++;
+    }
+    c->line_idx++;
+}
+
+/* Lit l'index en fin de segment : lignes attendues et période couverte.
+ * false si le segment n'a pas d'index (non scellé proprement). */
+static bool read_index(FILE *f, uint8_t *buf, uint32_t *lines,
+                       int64_t *t_first, int64_t *t_last)
+{
+    uint8_t foot[BMU_COL_FOOTER_LEN];
+    uint8_t hdr[BMU_COL_FRAME_HDR_LEN];
+    uint32_t off = 0, plen = 0, crc = 0;
+    uint8_t type = 0;
+    if (fseek(f, -(long)BMU_COL_FOOTER_LEN, SEEK_END) != 0 ||
+        fread(foot, 1, sizeof(foot), f) != sizeof(foot) ||
+        !bmu_col_footer_parse(foot, &off) ||
+        fseek(f, (long)off, SEEK_SET) != 0 ||
+        fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+        !bmu_col_frame_parse(hdr, &type, &plen, &crc) || type != BMU_COL_FRAME_INDEX ||
+        plen > BMU_INFLUX_STORE_BLOCK_MAX || fread(buf, 1, plen, f) != plen ||
+        bmu_gzip_crc32(0, buf, plen) != crc) {
+        return false;
+    }
+    *lines = 0;
+    *t_first = 0;
+    *t_last = 0;
+    for (uint32_t p = 0; p + BMU_COL_INDEX_ENTRY_LEN <= plen; p += BMU_COL_INDEX_ENTRY_LEN) {
+        bmu_col_index_entry_t e;
+        bmu_col_index_entry_read(buf + p, &e);
+        *lines += e.lines;
+        if (e.t_first_ms > 0 && (*t_first == 0 || e.t_first_ms < *t_first)) *t_first = e.t_first_ms;
+        if (e.t_last_ms > *t_last) *t_last = e.t_last_ms;
+    }
+    return true;
+}
+
+/* Rejoue un segment scellé depuis le checkpoint. Les blocs déjà acquittés
+ * sont décodés sans émission (l'état delta se reconstruit depuis le début
+ * du segment). true = consommé (ou illisible), à supprimer. */
+static bool replay_segment(uint32_t seq, bmu_col_decoder_t *dec, uint8_t *buf,
+                           replay_ctx_t *ctx)
+{
+    char path[48];
+    seg_path(path, sizeof(path), seq);
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) return true;  /* trou dans la numérotation */
+
+    uint8_t hdr[BMU_COL_FRAME_HDR_LEN];
+    bmu_col_decoder_reset(dec);
+
+    if (fread(hdr, 1, BMU_COL_SEG_HDR_LEN, f) != BMU_COL_SEG_HDR_LEN ||
+        !bmu_col_segment_header_ok(hdr)) {
+        ESP_LOGW(TAG, "%s : en-tête invalide, segment ignoré", path);
+        fclose(f);
+        return true;
+    }
+
+    const bmu_replay_ck_t resume = s_ck;   /* s_ck avance à chaque POST */
+    ctx->seq = seq;
+
+    uint32_t expected = 0;
+    int64_t t_first = 0, t_last = 0;
+    if (resume.offset == BMU_COL_SEG_HDR_LEN && resume.skip == 0 &&
+        read_index(f, buf, &expected, &t_first, &t_last)) {
+        ESP_LOGI(TAG, "Segment %lu : %lu lignes, %lld s de données",
+                 (unsigned long)seq, (unsigned long)expected,
+                 (long long)((t_last - t_first) / 1000));
+    }
+    fseek(f, BMU_COL_SEG_HDR_LEN, SEEK_SET);
+
+    uint32_t off = BMU_COL_SEG_HDR_LEN;
+    for (;;) {
+        size_t got = fread(hdr, 1, sizeof(hdr), f);
+        if (got == 0) break;  /* fin propre (segment non indexé) */
+
+        uint8_t type = 0;
+        uint32_t plen = 0, crc = 0;
+        if (got == sizeof(hdr) && bmu_col_frame_parse(hdr, &type, &plen, &crc) &&
+            type == BMU_COL_FRAME_INDEX) {
+            break;  /* index : fin des blocs */
+        }
+        if (got != sizeof(hdr) || !bmu_col_frame_parse(hdr, &type, &plen, &crc) ||
+            plen > BMU_INFLUX_STORE_BLOCK_MAX ||
+            fread(buf, 1, plen, f) != plen ||
+            bmu_gzip_crc32(0, buf, plen) != crc) {
+            /* Les blocs suivants dépendent de l'état : fin du segment */
+            ESP_LOGW(TAG, "%s : bloc tronqué ou corrompu à l'octet %lu, reste ignoré",
+                     path, (unsigned long)off);
+            break;
+        }
+
+        uint32_t skip = bmu_replay_ck_skip(&resume, off);
+        bool acked = skip == BMU_REPLAY_SKIP_ALL;
+        ctx->skip = acked ? 0 : skip;
+        ctx->blk_off = off;
+        ctx->line_idx = 0;
+        if (bmu_col_decode_block(dec, buf, plen, acked ? nullptr : replay_emit, ctx) < 0) {
+            ESP_LOGW(TAG, "%s : bloc incohérent à l'octet %lu, reste ignoré",
+                     path, (unsigned long)off);
+            break;
+        }
+        off += (uint32_t)(sizeof(hdr) + plen);
+        if (ctx->stop) {
+            fclose(f);
+            return false;
+        }
+        ctx->blk_off = off;
+        ctx->line_idx = 0;
+    }
+    fclose(f);
+
+    /* Fin de segment : envoyer le reste du corps */
+    ctx->blk_off = off;
+    ctx->line_idx = 0;
+    return replay_post(ctx);
 }
 
 int bmu_influx_store_replay(void)
 {
     if (!s_initialized) return -1;
 
-    int total = 0;
-    /* Rejouer l'ancien fichier en premier (données les plus anciennes) */
-    total += replay_file(rotated_path());
-    total += replay_file(current_path());
+    /* Seau à jetons : le replay ne dépasse pas CONFIG_BMU_INFLUX_REPLAY_RATE_KBPS
+     * en moyenne, la télémétrie live garde la connexion */
+    if (bmu_replay_bucket_refill(&s_bucket, esp_timer_get_time(), REPLAY_RATE_BPS,
+                                 REPLAY_BURST, REPLAY_GAP_MAX_US) <= 0) {
+        return 0;
+    }
+
+    /* Arriéré scellé rejoué : sceller le segment courant pour le rejouer
+     * aussi (les échecs de flush suivants iront dans un nouveau segment).
+     * Les segments scellés sont immuables : seule la tenue des numéros se
+     * fait sous mutex, le décodage et les POST non. */
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_first_seq == s_cur_seq && s_cur_exists) seal_current(true);
+    bool backlog = s_first_seq < s_cur_seq;
+    xSemaphoreGive(s_mutex);
+    if (!backlog) return 0;
+
+    bmu_col_decoder_t *dec = (bmu_col_decoder_t *)alloc_psram(sizeof(bmu_col_decoder_t));
+    uint8_t *buf = (uint8_t *)alloc_psram(BMU_INFLUX_STORE_BLOCK_MAX);
+    char *body = (char *)alloc_psram(BMU_INFLUX_POST_MAX);
+    replay_ctx_t ctx = {};
+    ctx.body = body;
+
+    if (dec && buf && body) {
+        while (!ctx.stop && s_first_seq < s_cur_seq) {
+            xSemaphoreTake(s_mutex, portMAX_DELAY);
+            uint32_t seq = s_first_seq;
+            bool pinned = seg_pinned(seq);
+            if (!pinned) s_replay_seq = seq;
+            xSemaphoreGive(s_mutex);
+            if (pinned) break;                  /* transfert BLE en cours : plus tard */
+            if (s_ck.seq != seq) bmu_replay_ck_start(&s_ck, seq);
+            bool done = replay_segment(seq, dec, buf, &ctx);
+            xSemaphoreTake(s_mutex, portMAX_DELAY);
+            s_replay_seq = 0;
+            /* Épinglé pendant le replay : conservé, le checkpoint en fin de
+             * segment le fera supprimer sans renvoi au prochain passage */
+            if (done && seg_pinned(seq)) done = false;
+            if (done) {
+                remove_segment(seq);
+                if (s_first_seq == seq) s_first_seq++;
+                bmu_replay_ck_start(&s_ck, s_first_seq);
+            }
+            xSemaphoreGive(s_mutex);
+            if (!done) break;
+            ck_save();
+            ESP_LOGI(TAG, "Replay segment %lu terminé", (unsigned long)seq);
+        }
+    } else {
+        ESP_LOGE(TAG, "Allocation décodeur échouée — replay reporté");
+    }
+    free(dec);
+    free(buf);
+    free(body);
+
+    if (ctx.sent > 0) {
+        ESP_LOGI(TAG, "Replay: %d lignes acquittées, reprise segment %lu octet %lu (+%lu lignes)",
+                 ctx.sent, (unsigned long)s_ck.seq, (unsigned long)s_ck.offset,
+                 (unsigned long)s_ck.skip);
+    }
+    return ctx.sent;
+}
+
+/* ── Init ────────────────────────────────────────────────────────────── */
+
+static void scan_segments(void)
+{
+    uint32_t lo = UINT32_MAX, hi = 0;
+    s_pending_bytes = 0;
+
+    DIR *d = opendir(store_dir());
+    if (d != nullptr) {
+        struct dirent *e;
+        while ((e = readdir(d)) != nullptr) {
+            unsigned long seq = 0;
+            char ext[4] = {};
+            if (sscanf(e->d_name, "%8lu.%3s", &seq, ext) != 2) continue;
+            if (strcasecmp(ext, "col") != 0 || seq == 0) continue;
+            char path[48];
+            seg_path(path, sizeof(path), (uint32_t)seq);
+            s_pending_bytes += (size_t)file_size(path);
+            if (seq < lo) lo = (uint32_t)seq;
+            if (seq > hi) hi = (uint32_t)seq;
+        }
+        closedir(d);
+    }
+
+    /* Le dernier segment d'un boot précédent est scellé : l'état d'encodage
+     * n'a pas survécu, on écrit dans un nouveau */
+    s_first_seq = (hi > 0) ? lo : 1;
+    s_cur_seq = hi + 1;
+    s_cur_exists = false;
+    s_cur_bytes = 0;
+}
+
+esp_err_t bmu_influx_store_init(void)
+{
+    s_use_sd = false;
+
+    if (s_enc == NULL) s_enc = (bmu_col_encoder_t *)alloc_psram(sizeof(bmu_col_encoder_t));
+    if (s_block == NULL) s_block = (uint8_t *)alloc_psram(BMU_INFLUX_STORE_BLOCK_MAX);
+    if (s_index == NULL) {
+        s_index = (bmu_col_index_entry_t *)alloc_psram(
+            BMU_INFLUX_STORE_INDEX_MAX * sizeof(bmu_col_index_entry_t));
+    }
+    if (s_stage == NULL) s_stage = (uint8_t *)alloc_psram(STAGE_MAX);
+    if (s_mutex == NULL) s_mutex = xSemaphoreCreateMutex();
+    if (s_enc == NULL || s_block == NULL || s_index == NULL || s_stage == NULL ||
+        s_mutex == NULL) {
+        ESP_LOGE(TAG, "Allocation encodeur colonnaire échouée");
+        return ESP_ERR_NO_MEM;
+    }
+    if (s_stg.buf == NULL) bmu_stage_init(&s_stg, s_stage, STAGE_MAX, file_write, NULL);
+    bmu_col_encoder_reset(s_enc);
+    s_index_n = 0;
+    file_close();  /* ré-init : le segment ouvert est repris comme scellé */
 
-    /* Flush final pour envoyer ce qui reste dans le buffer mémoire */
-    if (total > 0) {
-        bmu_influx_flush();
+    /* Priorité FAT interne (wear-leveled, toujours disponible) */
+    if (bmu_fat_is_mounted() && ensure_dir(FAT_DIR)) {
+        s_use_sd = false;
+        s_initialized = true;
+    } else if (bmu_sd_is_mounted() && ensure_dir(SD_DIR)) {
+        /* Fallback SD si présente */
+        s_use_sd = true;
+        s_initialized = true;
+    } else {
+        ESP_LOGW(TAG, "Aucun stockage disponible — données offline seront perdues");
+        return ESP_ERR_NOT_FOUND;
     }
 
-    return total;
+    scan_segments();
+    ck_load();
+    /* Ancien format texte : les plus anciennes données d'abord */
+    migrate_legacy(rotated_path());
+    migrate_legacy(current_path());
+    ESP_LOGI(TAG, "Store init sur %s (%s) — %lu segments, %u octets en attente",
+             s_use_sd ? "carte SD (fallback)" : "FAT interne", store_dir(),
+             (unsigned long)(s_cur_seq - s_first_seq), (unsigned)s_pending_bytes);
+    return ESP_OK;
+}
+
+/* ── Writer ──────────────────────────────────────────────────────────── */
+
+static void writer_task(void *)
+{
+    for (;;) {
+        /* Réveil par append (secteur complet / seuil d'octets) ou à
+         * l'échéance de la politique temporelle de fsync */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_BMU_INFLUX_STORE_SYNC_MS));
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        writer_service();
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+/* Redémarrage (OTA, commande) : le staging ne doit pas être perdu */
+static void shutdown_sync(void)
+{
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    file_sync();
+    xSemaphoreGive(s_mutex);
+}
+
+esp_err_t bmu_influx_store_start_task(UBaseType_t priority, uint32_t stack_size)
+{
+    if (!s_initialized) return ESP_ERR_INVALID_STATE;
+    if (s_task != NULL) return ESP_OK;
+    BaseType_t ret = xTaskCreate(writer_task, "influx_st", stack_size, NULL, priority, &s_task);
+    if (ret != pdPASS) return ESP_FAIL;
+    esp_register_shutdown_handler(shutdown_sync);
+    ESP_LOGI(TAG, "Writer démarré (staging %u KB, fsync %d ms / %d KB)",
+             (unsigned)(STAGE_MAX / 1024), CONFIG_BMU_INFLUX_STORE_SYNC_MS,
+             CONFIG_BMU_INFLUX_STORE_SYNC_KB);
+    return ESP_OK;
 }
 
 /* ── Status ──────────────────────────────────────────────────────────── */
@@ -214,12 +823,43 @@ int bmu_influx_store_replay(void)
 bool bmu_influx_store_has_pending(void)
 {
     if (!s_initialized) return false;
-    return (file_size(current_path()) > 0 || file_size(rotated_path()) > 0);
+    return s_first_seq < s_cur_seq || s_cur_exists;
 }
 
 size_t bmu_influx_store_pending_bytes(void)
 {
     if (!s_initialized) return 0;
-    long sz = file_size(current_path()) + file_size(rotated_path());
-    return (sz > 0) ? (size_t)sz : 0;
+    return s_pending_bytes;
+}
+
+bool bmu_influx_store_pin(uint32_t *first, uint32_t *end)
+{
+    if (!s_initialized) return false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!seg_pinned(UINT32_MAX)) s_pin_first = s_first_seq;
+    s_pin_active = true;
+    *first = s_pin_first;
+    *end = s_cur_seq;
+    xSemaphoreGive(s_mutex);
+    if (*first < *end) return true;
+    bmu_influx_store_unpin(false);
+    return false;
+}
+
+void bmu_influx_store_unpin(bool keep)
+{
+    if (!s_initialized) return;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_pin_active = false;
+    if (keep) {
+        s_pin_until_us = esp_timer_get_time() + (int64_t)BMU_INFLUX_STORE_PIN_HOLD_S * 1000000;
+    } else {
+        s_pin_first = 0;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void bmu_influx_store_seg_path(uint32_t seq, char *buf, size_t len)
+{
+    seg_path(buf, len, seq);
 }
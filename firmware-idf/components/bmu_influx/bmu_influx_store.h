@@ -4,41 +4,76 @@
  *
  * Stockage primaire : partition FAT interne (/fatfs/influx/)
  * Fallback : carte SD si présente (/sdcard/influx/)
- * Rotation : 2 fichiers tournants, taille max configurable.
- * Replay : rejoue les fichiers vers InfluxDB quand la connexion revient.
+ * Format : segments colonnaires binaires (bmu_influx_columnar.h), ~10x plus
+ *          compacts que le line-protocol texte.
+ * Rotation : CONFIG_BMU_INFLUX_STORE_SEG_COUNT segments de
+ *            CONFIG_BMU_INFLUX_STORE_SEG_KB, le plus ancien est supprimé.
+ * Écriture : segment courant ouvert en continu, staging PSRAM écrit par
+ *            secteurs de 4 KB par la tâche writer, fsync par temps/octets.
+ * Replay : rejoue les segments vers InfluxDB quand la connexion revient.
  */
 
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/** Taille max d'un fichier de log avant rotation (octets) */
-#define BMU_INFLUX_STORE_FILE_MAX   (512 * 1024)  /* 512 KB par fichier */
+/** Texte max encodé en un bloc (= buffer de flush bmu_influx) */
+#define BMU_INFLUX_STORE_CHUNK_MAX  4096
 
-/** Nombre max de fichiers tournants (current + rotated) */
-#define BMU_INFLUX_STORE_FILE_COUNT 2
+/** Taille max d'un bloc encodé (borne du codec : 3·texte + 1 KB) */
+#define BMU_INFLUX_STORE_BLOCK_MAX  (3 * BMU_INFLUX_STORE_CHUNK_MAX + 1024)
+
+/** Blocs max par segment (taille de l'index en fin de segment) */
+#define BMU_INFLUX_STORE_INDEX_MAX  512
 
 /** Initialise le store. Appeler après bmu_fat_init() et optionnellement bmu_sd_init(). */
 esp_err_t bmu_influx_store_init(void);
 
-/** Persiste une ligne line-protocol sur le stockage le plus adapté.
- *  Appelé quand le flush HTTP échoue. */
+/** Démarre la tâche writer (écriture par secteurs et fsync). Sans elle,
+ *  append écrit de façon synchrone. Appeler après bmu_influx_store_init(). */
+esp_err_t bmu_influx_store_start_task(UBaseType_t priority, uint32_t stack_size);
+
+/** Persiste une ou plusieurs lignes line-protocol sur le stockage le plus
+ *  adapté. Appelé quand le flush HTTP échoue. Les lignes sans timestamp
+ *  sont horodatées maintenant (si l'heure est valide). Ne fait qu'encoder
+ *  et copier en staging : l'écriture flash est faite par la tâche writer. */
 esp_err_t bmu_influx_store_append(const char *line, size_t len);
 
-/** Rejoue les fichiers persistés vers InfluxDB.
- *  Retourne le nombre de lignes rejouées, ou <0 en cas d'erreur. */
+/** Rejoue les segments persistés vers InfluxDB, par corps de
+ *  BMU_INFLUX_POST_MAX et dans la limite du débit configuré ; reprend au
+ *  dernier POST acquitté (checkpoint persisté). À appeler périodiquement.
+ *  Retourne le nombre de lignes acquittées, ou <0 en cas d'erreur. */
 int bmu_influx_store_replay(void);
 
 /** Retourne true si des données sont en attente de replay. */
 bool bmu_influx_store_has_pending(void);
 
-/** Taille totale des fichiers en attente (octets). */
+/** Taille totale des segments en attente (octets). */
 size_t bmu_influx_store_pending_bytes(void);
 
+/** Rétention d'un épinglage après un transfert interrompu (reprise) */
+#define BMU_INFLUX_STORE_PIN_HOLD_S  300
+
+/** Épingle les segments scellés [*first, *end) pour lecture externe
+ *  (historique BLE) : ni le replay ni la rotation ne les suppriment avant
+ *  bmu_influx_store_unpin(). Un épinglage encore retenu (transfert
+ *  interrompu) garde son *first : les offsets de reprise du flux restent
+ *  valides, *end peut avancer (segments ajoutés en fin). false si aucun. */
+bool bmu_influx_store_pin(uint32_t *first, uint32_t *end);
+
+/** Fin de lecture externe. keep = true (transfert interrompu) : l'épinglage
+ *  est retenu BMU_INFLUX_STORE_PIN_HOLD_S pour une reprise, puis expire. */
+void bmu_influx_store_unpin(bool keep);
+
+/** Chemin du segment seq sur le stockage actif. */
+void bmu_influx_store_seg_path(uint32_t seq, char *buf, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
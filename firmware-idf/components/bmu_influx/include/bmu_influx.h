@@ -1,5 +1,6 @@
 #pragma once
 #include "esp_err.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -8,6 +9,7 @@ extern "C" {
 esp_err_t bmu_influx_init(void);
 
 // Write a single line protocol entry. Buffered internally, flushed when buffer full or on explicit flush.
+// tags/fields are pre-formatted ("k=v,..."); timestamp_ns 0 = no timestamp (server / store time).
 esp_err_t bmu_influx_write(const char *measurement, const char *tags, const char *fields, int64_t timestamp_ns);
 
 // Extended battery telemetry with optional health metrics
@@ -17,12 +19,15 @@ typedef struct {
     float current_a;
     float ah_discharge;
     float ah_charge;
+    float wh_discharge;
+    float wh_charge;
     const char *state;
     int   nb_switch;        /* nombre de bascules switch (protection) */
     /* Optional health metrics — set to NAN if unavailable */
     float r_ohmic_mohm;     /* NAN si non mesure */
     float r_total_mohm;     /* NAN si non mesure */
     float soh_percent;      /* NAN si non disponible */
+    float soc_percent;      /* EKF bmu_soc, < 0 si non disponible */
     int   balancer_duty;    /* -1 si non actif, sinon 0-100 */
 } bmu_influx_battery_full_t;
 
@@ -38,6 +43,30 @@ esp_err_t bmu_influx_write_raw(const char *line, size_t len);
 // Flush buffered writes to InfluxDB
 esp_err_t bmu_influx_flush(void);
 
+// Taille max d'un corps passé à bmu_influx_post_lines (entrée gzip max)
+#define BMU_INFLUX_POST_MAX 8192
+
+// POST direct d'un corps line-protocol déjà formaté (replay du store offline).
+// Contrairement à flush, un échec ne persiste rien : l'appelant garde la main.
+// ESP_ERR_TIMEOUT pendant le backoff, ESP_FAIL si HTTP 5xx/401/408/429 (à
+// réessayer), ESP_ERR_INVALID_RESPONSE si autre 4xx (corps refusé : 400, 413…).
+esp_err_t bmu_influx_post_lines(const char *body, size_t len, int lines);
+
+// Client HTTP persistant — compteurs depuis le boot
+typedef struct {
+    uint32_t flushes;           /* POST réussis (2xx) */
+    uint32_t failures;          /* Erreurs transport ou HTTP non-2xx */
+    uint32_t handshakes;        /* Connexions TCP/TLS ouvertes */
+    uint32_t skipped_backoff;   /* Flush détournés vers le store pendant le backoff */
+    uint64_t bytes_raw;         /* Line-protocol envoyé (avant gzip) */
+    uint64_t bytes_sent;        /* Corps HTTP réellement transmis */
+    uint32_t last_flush_ms;     /* Latence du dernier POST */
+    uint32_t max_flush_ms;
+    uint32_t avg_flush_ms;      /* EMA 1/8 */
+} bmu_influx_stats_t;
+
+void bmu_influx_get_stats(bmu_influx_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
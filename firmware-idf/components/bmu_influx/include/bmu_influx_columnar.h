@@ -0,0 +1,174 @@
+/**
+ * @file bmu_influx_columnar.h
+ * @brief Codec colonnaire binaire du store offline InfluxDB (host-testable).
+ *
+ * Les lignes line-protocol qui n'ont pas pu être envoyées sont analysées et
+ * rangées par série (mesure + tags + schéma de champs, donc par batterie) :
+ *
+ *   segment := "KXCOL" ver(1) rsv(2) bloc* [index footer]
+ *   bloc    := 'K' 'B' len(u32 LE) crc32(u32 LE) payload
+ *   index   := 'K' 'I' len crc32 entrée*     (écrit au scellement du segment)
+ *   entrée  := offset(u32) lignes(u16) rsv(u16) t_first_ms(i64) t_last_ms(i64)
+ *   footer  := offset_index(u32 LE) "KXIX"
+ *   payload := n_defs defs* n_groups groupes* n_raw (len ligne)*
+ *   def     := sid key_len key nf (name_len name type dec)*
+ *   groupe  := sid n_rows colonne_ts colonne_champ*
+ *
+ * Chaque colonne est encodée en delta zigzag varint par rapport à la valeur
+ * précédente de la même série dans le segment (timestamps en ms, flottants
+ * en entiers à décimales fixes tirées du texte, donc sans perte). Chaînes :
+ * 0 = identique à la précédente, sinon len+1 puis octets. Les lignes non
+ * analysables sont conservées telles quelles (section raw).
+ *
+ * Le line-protocol n'est regénéré qu'au replay, avec un timestamp explicite
+ * en ns (les lignes écrites avec ts=0 sont horodatées à l'ajout dans le
+ * store). Contrat d'aller-retour (test_influx_columnar) — le texte rejoué
+ * diffère de l'original sur deux points, sans effet pour InfluxDB :
+ *   - timestamps stockés à la milliseconde : la partie sub-ms d'un
+ *     timestamp ns fourni est perdue. Le firmware écrit ses lignes avec
+ *     ts=0, horodatées à la ms : rien n'est perdu pour elles ;
+ *   - dans un bloc, les lignes sont regénérées série par série (ordre de
+ *     première apparition, ordre d'origine conservé dans une série), puis
+ *     les lignes raw telles quelles. Chaque ligne porte son timestamp,
+ *     l'ordre d'écriture n'a donc pas d'importance.
+ *
+ * L'état (dernières valeurs par série) est propre à un segment : le décodage
+ * d'un segment se fait séquentiellement depuis son début.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_COL_MAX_SERIES   64
+#define BMU_COL_MAX_FIELDS   16
+#define BMU_COL_NAME_MAX     24      /**< Nom de champ, '\0' inclus */
+#define BMU_COL_KEY_MAX      64      /**< Mesure + tags, '\0' inclus */
+#define BMU_COL_STR_MAX      24      /**< Valeur chaîne (forme échappée), '\0' inclus */
+#define BMU_COL_MAX_LINES    128     /**< Lignes par lot encodé */
+#define BMU_COL_LINE_MAX     512     /**< Au-delà : ligne conservée en raw */
+
+#define BMU_COL_SEG_HDR_LEN  8
+#define BMU_COL_FRAME_HDR_LEN 10
+#define BMU_COL_FOOTER_LEN   8
+#define BMU_COL_INDEX_ENTRY_LEN 24
+
+#define BMU_COL_FRAME_BLOCK  'B'
+#define BMU_COL_FRAME_INDEX  'I'
+
+typedef enum {
+    BMU_COL_T_FLOAT = 0,
+    BMU_COL_T_INT   = 1,    /**< suffixe i */
+    BMU_COL_T_UINT  = 2,    /**< suffixe u */
+    BMU_COL_T_STR   = 3,
+    BMU_COL_T_BOOL  = 4,
+} bmu_col_type_t;
+
+/* ── Encodeur ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    uint64_t sig;                           /**< FNV-1a clé + schéma */
+    uint8_t  nf;
+    uint8_t  types[BMU_COL_MAX_FIELDS];
+    int64_t  last[BMU_COL_MAX_FIELDS];
+    uint64_t str_hash[BMU_COL_MAX_FIELDS];  /**< Dernière chaîne (FNV-1a) */
+    int64_t  last_ts;
+} bmu_col_enc_series_t;
+
+typedef struct {
+    bmu_col_enc_series_t s[BMU_COL_MAX_SERIES];
+    uint8_t n_series;
+    /* Lot en cours d'encodage (hors pile : ~18 KB) */
+    uint32_t row_off[BMU_COL_MAX_LINES];
+    uint32_t row_len[BMU_COL_MAX_LINES];
+    uint8_t  row_sid[BMU_COL_MAX_LINES];    /**< 0xFF = ligne raw */
+    int64_t  row_ts[BMU_COL_MAX_LINES];
+    int64_t  row_val[BMU_COL_MAX_LINES][BMU_COL_MAX_FIELDS];
+    /* Dernier bloc encodé (pour l'index du segment) */
+    uint16_t blk_lines;
+    int64_t  blk_t_first;                   /**< ms, 0 si aucune ligne horodatée */
+    int64_t  blk_t_last;
+} bmu_col_encoder_t;
+
+/** Entrée d'index : un bloc du segment */
+typedef struct {
+    uint32_t offset;                        /**< Position de l'en-tête du bloc */
+    uint16_t lines;
+    int64_t  t_first_ms;
+    int64_t  t_last_ms;
+} bmu_col_index_entry_t;
+
+/* ── Décodeur ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    char     key[BMU_COL_KEY_MAX];
+    uint8_t  nf;
+    char     names[BMU_COL_MAX_FIELDS][BMU_COL_NAME_MAX];
+    uint8_t  types[BMU_COL_MAX_FIELDS];
+    uint8_t  dec[BMU_COL_MAX_FIELDS];
+    int64_t  last[BMU_COL_MAX_FIELDS];
+    char     str[BMU_COL_MAX_FIELDS][BMU_COL_STR_MAX];
+    int64_t  last_ts;
+} bmu_col_dec_series_t;
+
+typedef struct {
+    bmu_col_dec_series_t s[BMU_COL_MAX_SERIES];
+    uint8_t n_series;
+} bmu_col_decoder_t;
+
+/** Reçoit chaque ligne regénérée (sans '\n' final). */
+typedef void (*bmu_col_emit_fn)(const char *line, size_t len, void *ctx);
+
+/** @brief En-tête de segment (BMU_COL_SEG_HDR_LEN octets). */
+void bmu_col_segment_header(uint8_t out[BMU_COL_SEG_HDR_LEN]);
+bool bmu_col_segment_header_ok(const uint8_t hdr[BMU_COL_SEG_HDR_LEN]);
+
+/** @brief Lit un en-tête de trame ; *type = BMU_COL_FRAME_BLOCK ou _INDEX. */
+bool bmu_col_frame_parse(const uint8_t hdr[BMU_COL_FRAME_HDR_LEN], uint8_t *type,
+                         uint32_t *payload_len, uint32_t *crc);
+
+/**
+ * @brief Trame d'index + footer à ajouter en fin de segment scellé.
+ * @param frame_offset Position de la trame dans le segment (taille actuelle)
+ * @return octets écrits, 0 si out_cap insuffisant
+ */
+size_t bmu_col_index_build(const bmu_col_index_entry_t *e, size_t n,
+                           uint32_t frame_offset, uint8_t *out, size_t out_cap);
+
+/** @brief Footer valide → position de la trame d'index. */
+bool bmu_col_footer_parse(const uint8_t f[BMU_COL_FOOTER_LEN], uint32_t *index_offset);
+
+/** @brief Décode une entrée (BMU_COL_INDEX_ENTRY_LEN octets) d'une charge utile d'index. */
+void bmu_col_index_entry_read(const uint8_t *p, bmu_col_index_entry_t *e);
+
+void bmu_col_encoder_reset(bmu_col_encoder_t *enc);
+void bmu_col_decoder_reset(bmu_col_decoder_t *dec);
+
+/**
+ * @brief Encode un lot de lignes line-protocol en un bloc complet (en-tête inclus).
+ *
+ * @param now_ms Horodatage (ms epoch) appliqué aux lignes sans timestamp
+ *               (ou ts=0) ; 0 = laisser sans timestamp.
+ * @return octets écrits, 0 si out_cap insuffisant ou table de séries pleine :
+ *         l'appelant ouvre alors un nouveau segment (encodeur remis à zéro)
+ *         et réessaie. Un out_cap de 3·text_len + 1024 suffit toujours, et un
+ *         encodeur vierge ne renvoie jamais 0 pour table pleine (surplus raw).
+ */
+size_t bmu_col_encode_block(bmu_col_encoder_t *enc, const char *text, size_t text_len,
+                            int64_t now_ms, uint8_t *out, size_t out_cap);
+
+/**
+ * @brief Décode la charge utile d'un bloc (CRC déjà vérifié) et regénère les lignes.
+ * @return nombre de lignes émises, -1 si bloc incohérent
+ */
+int bmu_col_decode_block(bmu_col_decoder_t *dec, const uint8_t *payload, size_t len,
+                         bmu_col_emit_fn emit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
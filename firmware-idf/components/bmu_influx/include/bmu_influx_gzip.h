@@ -0,0 +1,44 @@
+/**
+ * @file bmu_influx_gzip.h
+ * @brief Encodeur gzip compact (deflate Huffman fixe + LZ77) pour corps line-protocol.
+ *
+ * Pas de dépendance ESP-IDF (testé sur host contre zlib, test_influx_gzip).
+ * Huffman fixe seulement : le line-protocol est dominé par des répétitions
+ * longues (noms de mesure, tags, clés de champs) que LZ77 capte ; une table
+ * dynamique n'apporterait que quelques % pour beaucoup plus de code et de RAM.
+ *
+ * Mémoire : espace de travail fourni par l'appelant (~24 KB, PSRAM).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_GZIP_MAX_INPUT   8192     /**< Taille max d'un corps compressé */
+#define BMU_GZIP_HASH_BITS   12
+#define BMU_GZIP_MAX_CHAIN   16       /**< Profondeur de recherche LZ77 */
+
+typedef struct {
+    uint16_t head[1 << BMU_GZIP_HASH_BITS];  /**< Dernière position+1 par hash */
+    uint16_t prev[BMU_GZIP_MAX_INPUT];       /**< Chaîne position → précédente+1 */
+} bmu_gzip_ws_t;
+
+/** @brief CRC-32 IEEE (polynôme réfléchi 0xEDB88320), chaînable. */
+uint32_t bmu_gzip_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Compresse in[0..in_len) en flux gzip complet (en-tête + deflate + CRC/ISIZE).
+ *
+ * @return taille écrite dans out, ou 0 si in_len > BMU_GZIP_MAX_INPUT ou si
+ *         out_cap est insuffisant (l'appelant envoie alors le corps brut).
+ */
+size_t bmu_gzip_compress(bmu_gzip_ws_t *ws, const uint8_t *in, size_t in_len,
+                         uint8_t *out, size_t out_cap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,71 @@
+/**
+ * @file bmu_influx_lp.h
+ * @brief Sérialiseur line-protocol sans allocation ni snprintf (host-testable).
+ *
+ * Écrit directement dans le buffer de destination (buffer de flush
+ * bmu_influx) :
+ *
+ *   bmu_lp_writer_t w;
+ *   bmu_lp_begin(&w, dst, cap, "battery");
+ *   bmu_lp_tag_int(&w, "id", 3);
+ *   bmu_lp_field_fixed(&w, "voltage_mv", 26012.4f, 1);
+ *   bmu_lp_field_int(&w, "nb_switch", 2);
+ *   size_t n = bmu_lp_end(&w, 0);   // 0 si la ligne ne tient pas
+ *
+ * Flottants en virgule fixe par arithmétique entière (arrondi au plus proche,
+ * 0 à 6 décimales) ; NaN/inf et valeurs hors plage sont omis (InfluxDB les
+ * refuse). Échappements : mesure (virgule, espace), clés et valeurs de tag
+ * (virgule, égal, espace), chaînes de champ (guillemet, antislash).
+ * Un champ au moins est requis : sinon bmu_lp_end renvoie 0.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_LP_MAX_DECIMALS 6
+
+typedef struct {
+    char    *buf;
+    size_t   cap;
+    size_t   len;
+    uint8_t  nfields;
+    bool     overflow;
+} bmu_lp_writer_t;
+
+/** @brief Démarre une ligne à buf[0] avec la mesure (échappée). */
+void bmu_lp_begin(bmu_lp_writer_t *w, char *buf, size_t cap, const char *measurement);
+
+void bmu_lp_tag(bmu_lp_writer_t *w, const char *key, const char *value);
+void bmu_lp_tag_int(bmu_lp_writer_t *w, const char *key, int32_t value);
+
+/** @brief Tags déjà formatés ("k=v,k2=v2"), copiés tels quels. */
+void bmu_lp_tags_raw(bmu_lp_writer_t *w, const char *tags);
+
+/** @brief Flottant à `decimals` décimales ; omis si NaN/inf ou |v|·10^d hors int64. */
+void bmu_lp_field_fixed(bmu_lp_writer_t *w, const char *key, float value, uint8_t decimals);
+void bmu_lp_field_int(bmu_lp_writer_t *w, const char *key, int64_t value);    /**< suffixe i */
+void bmu_lp_field_bool(bmu_lp_writer_t *w, const char *key, bool value);
+void bmu_lp_field_str(bmu_lp_writer_t *w, const char *key, const char *value);
+
+/** @brief Champs déjà formatés ("k=v,k2=v2"), copiés tels quels. */
+void bmu_lp_fields_raw(bmu_lp_writer_t *w, const char *fields);
+
+/**
+ * @brief Termine la ligne : timestamp ns (omis si 0 → heure serveur, ou
+ *        heure d'ajout pour le store offline) puis '\n'.
+ * @return longueur de la ligne '\n' inclus, 0 si débordement ou sans champ
+ */
+size_t bmu_lp_end(bmu_lp_writer_t *w, int64_t timestamp_ns);
+
+/** @brief Entier signé en décimal ; renvoie le nombre de caractères (≤ 20). */
+size_t bmu_lp_fmt_i64(char *out, int64_t v);
+
+#ifdef __cplusplus
+}
+#endif
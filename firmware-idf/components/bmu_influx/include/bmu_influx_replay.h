@@ -0,0 +1,80 @@
+/**
+ * @file bmu_influx_replay.h
+ * @brief Politique du replay du store offline : seau à jetons et point de
+ *        reprise replay.ck (host-testable).
+ *
+ * Le store (bmu_influx_store.cpp) garde les fichiers, le décodage et les
+ * POST ; les décisions sont ici, sans dépendance ESP-IDF (test_influx_replay).
+ *
+ *   replay.ck := magic(u32 LE "RPCK") seq(u32) offset(u32) skip(u32) crc32(u32)
+ *
+ * crc32 porte sur les 16 premiers octets (bmu_gzip_crc32). Fichier court,
+ * magic ou CRC faux (écriture déchirée) : checkpoint rejeté, le replay
+ * reprend au début du plus ancien segment — doublons possibles, jamais de
+ * perte.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ── Seau à jetons (octets line-protocol) ────────────────────────────── */
+
+typedef struct {
+    int32_t tokens;
+    int64_t last_us;        /**< 0 = jamais crédité */
+} bmu_replay_bucket_t;
+
+/**
+ * @brief Crédite le seau pour l'écart depuis l'appel précédent.
+ *
+ * Premier appel : rafale pleine. Écart borné à gap_max_us (Wi-Fi coupé ou
+ * replay en pause : pas de crédit accumulé). Plafond : la rafale, ou tout le
+ * crédit d'un appel espacé, pour que le débit moyen reste rate_bps quelle
+ * que soit la période d'appel.
+ *
+ * @return jetons disponibles (≤ 0 : rien à envoyer à cet appel)
+ */
+int32_t bmu_replay_bucket_refill(bmu_replay_bucket_t *b, int64_t now_us,
+                                 int32_t rate_bps, int32_t burst, int64_t gap_max_us);
+
+/** @brief Débite len octets envoyés ; false si le seau est épuisé. */
+bool bmu_replay_bucket_spend(bmu_replay_bucket_t *b, size_t len);
+
+/* ── Point de reprise ────────────────────────────────────────────────── */
+
+#define BMU_REPLAY_CK_MAGIC  0x4B435052u   /**< "RPCK" */
+#define BMU_REPLAY_CK_LEN    20
+#define BMU_REPLAY_SKIP_ALL  UINT32_MAX    /**< Bloc entièrement acquitté */
+
+typedef struct {
+    uint32_t seq;           /**< Segment en cours de replay */
+    uint32_t offset;        /**< En-tête du bloc contenant la prochaine ligne */
+    uint32_t skip;          /**< Lignes de ce bloc déjà acquittées */
+} bmu_replay_ck_t;
+
+/** @brief Reprise au premier bloc du segment seq. */
+void bmu_replay_ck_start(bmu_replay_ck_t *ck, uint32_t seq);
+
+/** @brief Sérialise ck (magic et CRC compris) dans out[BMU_REPLAY_CK_LEN]. */
+void bmu_replay_ck_encode(const bmu_replay_ck_t *ck, uint8_t *out);
+
+/** @brief Relit un checkpoint ; false (ck inchangé) si court, magic ou CRC faux. */
+bool bmu_replay_ck_decode(const uint8_t *buf, size_t len, bmu_replay_ck_t *ck);
+
+/**
+ * @brief Lignes à sauter dans le bloc d'en-tête blk_off d'un segment repris
+ *        depuis ck : BMU_REPLAY_SKIP_ALL avant le point de reprise (bloc
+ *        décodé sans émission, l'état delta se reconstruit), ck->skip pour
+ *        le bloc du point de reprise, 0 ensuite.
+ */
+uint32_t bmu_replay_ck_skip(const bmu_replay_ck_t *ck, uint32_t blk_off);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+/**
+ * @file bmu_influx_stage.h
+ * @brief Staging d'écriture du segment ouvert du store offline (host-testable).
+ *
+ * Les blocs encodés s'accumulent dans un tampon (PSRAM) et ne sont écrits
+ * qu'en tronçons qui se terminent sur une frontière de BMU_STAGE_SECTOR du
+ * fichier : FATFS écrit des secteurs complets, sans lecture-modification-
+ * écriture côté wear-levelling. La fin partielle reste en staging jusqu'au
+ * prochain secteur complet, à un fsync ou à la fermeture (arrêt, scellement).
+ *
+ * L'écriture passe par un callback (fwrite dans bmu_influx_store.cpp, faux
+ * fichier dans test_influx_stage) : pas de dépendance ESP-IDF. Pas de verrou :
+ * l'appelant sérialise (mutex du store).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_STAGE_SECTOR  4096
+
+/** Écrit len octets à la suite du fichier ; false en cas d'échec. */
+typedef bool (*bmu_stage_write_fn_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct {
+    uint8_t  *buf;
+    size_t    cap;
+    size_t    len;          /**< Octets en staging */
+    size_t    file_off;     /**< Octets du fichier déjà écrits */
+    size_t    unsynced;     /**< Octets ajoutés depuis le dernier fsync */
+    int64_t   dirty_us;     /**< Ajout du premier octet non synchronisé */
+    bmu_stage_write_fn_t write;
+    void     *ctx;
+} bmu_stage_t;
+
+void bmu_stage_init(bmu_stage_t *s, uint8_t *buf, size_t cap,
+                    bmu_stage_write_fn_t write, void *ctx);
+
+/** Nouveau fichier : offset 0, staging vide. */
+void bmu_stage_open(bmu_stage_t *s);
+
+/**
+ * @brief Écrit le staging. all = false : secteurs complets seulement, la fin
+ *        partielle reste ; all = true : tout (fsync, fermeture, arrêt).
+ * @return false si une écriture a échoué (le reste est conservé)
+ */
+bool bmu_stage_drain(bmu_stage_t *s, bool all);
+
+/**
+ * @brief Ajoute n octets. Staging plein : secteurs complets d'abord, puis
+ *        tout s'il le faut.
+ * @return false si l'écriture a échoué ou si n ne tient pas dans le tampon
+ */
+bool bmu_stage_put(bmu_stage_t *s, const uint8_t *data, size_t n, int64_t now_us);
+
+/** Politique de fsync : octets non synchronisés ≥ sync_bytes, ou plus vieux que sync_us. */
+bool bmu_stage_sync_due(const bmu_stage_t *s, int64_t now_us, size_t sync_bytes,
+                        int64_t sync_us);
+
+/** Réveil anticipé du writer : un secteur complet à écrire, ou seuil d'octets atteint. */
+bool bmu_stage_wake_due(const bmu_stage_t *s, size_t sync_bytes);
+
+/** Après fsync (réussi ou non) : compteur non synchronisé remis à zéro. */
+void bmu_stage_synced(bmu_stage_t *s);
+
+/** Écriture refusée : staging abandonné ; retourne les octets perdus. */
+size_t bmu_stage_discard(bmu_stage_t *s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,111 @@
+/**
+ * bmu_mqtt_fleet — Encodeur de la trame binaire de flotte (voir bmu_mqtt_fleet.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_mqtt_fleet). Les valeurs
+ * sont arrondies au plus proche et saturées à la plage du champ.
+ */
+
+#include "bmu_mqtt_fleet.h"
+
+#include <cmath>
+
+/* ── Conversion bornée ───────────────────────────────────────────────── */
+
+static int64_t scaled(float v, float k, int64_t lo, int64_t hi)
+{
+    if (std::isnan(v)) return 0;
+    double s = std::round((double)v * k);
+    if (s < (double)lo) return lo;
+    if (s > (double)hi) return hi;
+    return (int64_t)s;
+}
+
+static inline uint16_t to_u16(float v, float k) { return (uint16_t)scaled(v, k, 0, UINT16_MAX); }
+static inline uint32_t to_u32(float v, float k) { return (uint32_t)scaled(v, k, 0, UINT32_MAX); }
+static inline int32_t  to_i32(float v, float k) { return (int32_t)scaled(v, k, INT32_MIN, INT32_MAX); }
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/* ── Encodage ────────────────────────────────────────────────────────── */
+
+size_t bmu_fleet_frame_encode(const bmu_fleet_batt_t *b, uint8_t n,
+                              float temp_c, float humidity_pct, uint16_t seq,
+                              uint8_t *out, size_t cap)
+{
+    size_t len = BMU_FLEET_FRAME_HDR_LEN + (size_t)n * BMU_FLEET_FRAME_REC_LEN;
+    if (n > BMU_FLEET_FRAME_MAX_BATT || (n > 0 && b == nullptr) || len > cap) return 0;
+
+    uint16_t v_min = UINT16_MAX, v_max = 0;
+    uint32_t v_sum = 0;
+    int64_t i_total = 0;
+    uint8_t n_connected = 0;
+
+    for (uint8_t k = 0; k < n; k++) {
+        const bmu_fleet_batt_t *s = &b[k];
+        uint8_t *r = out + BMU_FLEET_FRAME_HDR_LEN + (size_t)k * BMU_FLEET_FRAME_REC_LEN;
+
+        uint8_t flags = 0;
+        if (!std::isnan(s->r_ohmic_mohm)) flags |= BMU_FLEET_BAT_RINT;
+        if (!std::isnan(s->soh_percent)) flags |= BMU_FLEET_BAT_SOH;
+        if (s->soc_percent >= 0) flags |= BMU_FLEET_BAT_SOC;
+        if (s->balancer_duty >= 0) flags |= BMU_FLEET_BAT_BAL;
+
+        uint16_t v_mv = to_u16(s->voltage_mv, 1.0f);
+        int32_t i_ma = to_i32(s->current_a, 1000.0f);
+
+        r[0] = s->id;
+        r[1] = s->state;
+        r[2] = flags;
+        r[3] = (flags & BMU_FLEET_BAT_BAL) ? (uint8_t)(s->balancer_duty > 100 ? 100 : s->balancer_duty) : 0;
+        put_u16(r + 4, v_mv);
+        put_u16(r + 6, (uint16_t)(s->nb_switch < 0 ? 0 : s->nb_switch > UINT16_MAX ? UINT16_MAX : s->nb_switch));
+        put_u32(r + 8, (uint32_t)i_ma);
+        put_u32(r + 12, to_u32(s->ah_discharge, 1000.0f));
+        put_u32(r + 16, to_u32(s->ah_charge, 1000.0f));
+        put_u32(r + 20, to_u32(s->wh_discharge, 10.0f));
+        put_u32(r + 24, to_u32(s->wh_charge, 10.0f));
+        put_u16(r + 28, (flags & BMU_FLEET_BAT_RINT) ? to_u16(s->r_ohmic_mohm, 10.0f) : 0);
+        put_u16(r + 30, (flags & BMU_FLEET_BAT_RINT) ? to_u16(s->r_total_mohm, 10.0f) : 0);
+        put_u16(r + 32, (flags & BMU_FLEET_BAT_SOH) ? to_u16(s->soh_percent, 10.0f) : 0);
+        put_u16(r + 34, (flags & BMU_FLEET_BAT_SOC) ? to_u16(s->soc_percent, 10.0f) : 0);
+
+        if (v_mv < v_min) v_min = v_mv;
+        if (v_mv > v_max) v_max = v_mv;
+        v_sum += v_mv;
+        i_total += i_ma;
+        if (s->state == 0) n_connected++;  /* BMU_STATE_CONNECTED */
+    }
+
+    bool climate = !std::isnan(temp_c) && !std::isnan(humidity_pct);
+    if (i_total > INT32_MAX) i_total = INT32_MAX;
+    if (i_total < INT32_MIN) i_total = INT32_MIN;
+
+    out[0] = 'K';
+    out[1] = 'F';
+    out[2] = BMU_FLEET_FRAME_VERSION;
+    out[3] = BMU_FLEET_FRAME_HDR_LEN;
+    out[4] = BMU_FLEET_FRAME_REC_LEN;
+    out[5] = n;
+    out[6] = climate ? BMU_FLEET_FLAG_CLIMATE : 0;
+    out[7] = n_connected;
+    put_u16(out + 8, seq);
+    put_u16(out + 10, n > 0 ? v_min : 0);
+    put_u16(out + 12, v_max);
+    put_u16(out + 14, n > 0 ? (uint16_t)((v_sum + n / 2) / n) : 0);
+    put_u32(out + 16, (uint32_t)(int32_t)i_total);
+    put_u16(out + 20, climate ? (uint16_t)(int16_t)scaled(temp_c, 100.0f, INT16_MIN, INT16_MAX) : 0);
+    put_u16(out + 22, climate ? to_u16(humidity_pct, 10.0f) : 0);
+    return len;
+}
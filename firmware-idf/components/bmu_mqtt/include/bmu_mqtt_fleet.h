@@ -0,0 +1,93 @@
+/**
+ * @file bmu_mqtt_fleet.h
+ * @brief Trame MQTT binaire de flotte : toutes les batteries en une publication.
+ *
+ * Publiée sur bmu/{device}/fleet (CONFIG_BMU_MQTT_FLEET_FRAME) à la place des
+ * JSON bmu/{device}/battery/N et bmu/{device}/climate. Décodée côté serveur
+ * par kxkm-api/telegraf/bmu_fleet.py. Little-endian, sans padding :
+ *
+ *   en-tête (24 o) :
+ *     0  'K' 'F'          magic
+ *     2  u8  version      BMU_FLEET_FRAME_VERSION
+ *     3  u8  hdr_len      24 (les versions futures peuvent l'allonger)
+ *     4  u8  rec_len      36 (idem : le décodeur saute les octets inconnus)
+ *     5  u8  nb           batteries dans la trame
+ *     6  u8  flags        bit0 = climat présent
+ *     7  u8  n_connected
+ *     8  u16 seq          compteur de trames (détection de pertes)
+ *     10 u16 v_min_mv     agrégats flotte, sur les batteries de la trame
+ *     12 u16 v_max_mv
+ *     14 u16 v_avg_mv
+ *     16 i32 i_total_ma
+ *     20 i16 temp_cc      0.01 °C
+ *     22 u16 hum_dpct     0.1 %
+ *
+ *   batterie (36 o) :
+ *     0  u8  id           0-indexé
+ *     1  u8  state        bmu_battery_state_t
+ *     2  u8  flags        bit0 r_ohm/r_tot, bit1 soh, bit2 soc, bit3 bal_duty
+ *     3  u8  bal_duty     %
+ *     4  u16 v_mv
+ *     6  u16 nb_switch
+ *     8  i32 i_ma
+ *     12 u32 ah_d_mah     16 u32 ah_c_mah
+ *     20 u32 wh_d_dwh     24 u32 wh_c_dwh     (0.1 Wh)
+ *     28 u16 r_ohm_d      30 u16 r_tot_d      (0.1 mΩ)
+ *     32 u16 soh_d        34 u16 soc_d        (0.1 %)
+ *
+ * Même résolution que les JSON (mV, mA, mAh) ; 24 + 36·N octets, soit
+ * ~1.2 KB pour 32 batteries contre ~8 KB en 32 publications.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_FLEET_FRAME_VERSION   1
+#define BMU_FLEET_FRAME_HDR_LEN   24
+#define BMU_FLEET_FRAME_REC_LEN   36
+#define BMU_FLEET_FRAME_MAX_BATT  32
+#define BMU_FLEET_FRAME_MAX_LEN   (BMU_FLEET_FRAME_HDR_LEN + \
+                                   BMU_FLEET_FRAME_MAX_BATT * BMU_FLEET_FRAME_REC_LEN)
+
+#define BMU_FLEET_FLAG_CLIMATE    0x01
+
+#define BMU_FLEET_BAT_RINT        0x01
+#define BMU_FLEET_BAT_SOH         0x02
+#define BMU_FLEET_BAT_SOC         0x04
+#define BMU_FLEET_BAT_BAL         0x08
+
+/** Mesures d'une batterie, mêmes conventions que bmu_influx_battery_full_t */
+typedef struct {
+    uint8_t id;
+    uint8_t state;          /**< bmu_battery_state_t */
+    float   voltage_mv;
+    float   current_a;
+    float   ah_discharge;   /**< Ah */
+    float   ah_charge;
+    float   wh_discharge;
+    float   wh_charge;
+    int     nb_switch;
+    float   r_ohmic_mohm;   /**< NAN si non mesuré */
+    float   r_total_mohm;
+    float   soh_percent;    /**< NAN si non disponible */
+    float   soc_percent;    /**< < 0 si non disponible */
+    int     balancer_duty;  /**< -1 si non actif */
+} bmu_fleet_batt_t;
+
+/**
+ * @brief Encode la trame de flotte.
+ * @param temp_c, humidity_pct Climat ; NAN = absent
+ * @return octets écrits, 0 si n > BMU_FLEET_FRAME_MAX_BATT ou cap insuffisant
+ */
+size_t bmu_fleet_frame_encode(const bmu_fleet_batt_t *b, uint8_t n,
+                              float temp_c, float humidity_pct, uint16_t seq,
+                              uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
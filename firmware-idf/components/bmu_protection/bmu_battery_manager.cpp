@@ -1,12 +1,86 @@
 #include "bmu_battery_manager.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_system.h"
+#include "nvs.h"
 #include <cmath>
 #include <cstring>
 #include <cstdlib>
 
 static const char *TAG = "BMGR";
 
+/* ── Persistance NVS des compteurs ─────────────────────────────────────
+ * Blob unique (toutes batteries) dans le namespace "bmu_ah" : une seule
+ * écriture par checkpoint, cadencée par bmu_coulomb_checkpoint_due().
+ * Cumuls en double (voir bmu_coulomb.h). Un offset appris peut valoir
+ * exactement 0 A : sa validité est un bit de offset_valid, pas la valeur.
+ * Version ou taille inconnue : blob ignoré, compteurs à zéro. */
+#define NVS_NS_AH           "bmu_ah"
+#define NVS_KEY_COUNTERS    "counters"
+#define AH_BLOB_VERSION     1
+
+typedef struct {
+    uint32_t version;
+    uint32_t offset_valid;                  /* bit i : offset_a[i] appris */
+    float    offset_a[BMU_MAX_BATTERIES];
+    double   ah_discharge[BMU_MAX_BATTERIES];
+    double   ah_charge[BMU_MAX_BATTERIES];
+    double   wh_discharge[BMU_MAX_BATTERIES];
+    double   wh_charge[BMU_MAX_BATTERIES];
+} ah_blob_t;
+
+static_assert(BMU_MAX_BATTERIES <= 32, "offset_valid : un bit par batterie");
+
+static bmu_battery_manager_t *s_shutdown_mgr = NULL;
+
+static void load_counters(bmu_battery_manager_t *mgr)
+{
+    nvs_handle_t h;
+    esp_err_t ret = nvs_open(NVS_NS_AH, NVS_READONLY, &h);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "NVS '%s' vide — compteurs Ah à zéro", NVS_NS_AH);
+        return;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "NVS open '%s' failed: %s", NVS_NS_AH, esp_err_to_name(ret));
+        return;
+    }
+
+    ah_blob_t *blob = (ah_blob_t *)calloc(1, sizeof(ah_blob_t));
+    if (blob == NULL) {
+        nvs_close(h);
+        return;
+    }
+    size_t sz = sizeof(ah_blob_t);
+    ret = nvs_get_blob(h, NVS_KEY_COUNTERS, blob, &sz);
+    nvs_close(h);
+
+    if (ret == ESP_OK && sz == sizeof(ah_blob_t) && blob->version == AH_BLOB_VERSION) {
+        for (int i = 0; i < BMU_MAX_BATTERIES; i++) {
+            bmu_coulomb_t *c = &mgr->coulomb[i];
+            c->ah_discharge = blob->ah_discharge[i];
+            c->ah_charge    = blob->ah_charge[i];
+            c->wh_discharge = blob->wh_discharge[i];
+            c->wh_charge    = blob->wh_charge[i];
+            c->offset_a     = blob->offset_a[i];
+            c->offset_valid = (blob->offset_valid >> i) & 1u;
+            mgr->saved_throughput_ah[i] = bmu_coulomb_throughput_ah(c);
+        }
+        ESP_LOGI(TAG, "Compteurs Ah/Wh restaurés depuis NVS");
+    } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Blob compteurs invalide (ret=%s sz=%u) — ignoré",
+                 esp_err_to_name(ret), (unsigned)sz);
+    }
+    free(blob);
+}
+
+static void shutdown_checkpoint(void)
+{
+    if (s_shutdown_mgr != NULL) {
+        bmu_battery_manager_checkpoint(s_shutdown_mgr);
+    }
+}
+
 esp_err_t bmu_battery_manager_init(bmu_battery_manager_t *mgr,
                                     bmu_ina237_t *ina, uint8_t nb_ina)
 {
@@ -15,51 +89,109 @@ esp_err_t bmu_battery_manager_init(bmu_battery_manager_t *mgr,
     mgr->nb_ina = nb_ina;
     mgr->mutex = xSemaphoreCreateMutex();
     configASSERT(mgr->mutex != NULL);
+    load_counters(mgr);
+    mgr->last_checkpoint_us = esp_timer_get_time();
     ESP_LOGI(TAG, "Battery manager init: %d batteries", nb_ina);
     return ESP_OK;
 }
 
+void bmu_battery_manager_ingest_sample(bmu_battery_manager_t *mgr, int idx,
+                                       float voltage_mv, float current_a,
+                                       bool switch_closed, int64_t t_us)
+{
+    if (mgr == NULL || mgr->mutex == NULL || idx < 0 || idx >= BMU_MAX_BATTERIES) return;
+    if (std::isnan(voltage_mv) || std::isnan(current_a)) return;
+
+    if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
+        mgr->last_voltage_mv[idx] = voltage_mv;
+        mgr->last_current_a[idx] = current_a;
+        bmu_coulomb_sample(&mgr->coulomb[idx], voltage_mv, current_a, t_us,
+                           switch_closed, (int64_t)CONFIG_BMU_AH_MAX_GAP_MS * 1000);
+        xSemaphoreGive(mgr->mutex);
+    }
+}
+
+esp_err_t bmu_battery_manager_checkpoint(bmu_battery_manager_t *mgr)
+{
+    if (mgr == NULL || mgr->mutex == NULL) return ESP_ERR_INVALID_ARG;
+
+    ah_blob_t *blob = (ah_blob_t *)calloc(1, sizeof(ah_blob_t));
+    if (blob == NULL) return ESP_ERR_NO_MEM;
+
+    double throughput[BMU_MAX_BATTERIES];
+    blob->version = AH_BLOB_VERSION;
+    if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        free(blob);
+        return ESP_ERR_TIMEOUT;
+    }
+    for (int i = 0; i < BMU_MAX_BATTERIES; i++) {
+        const bmu_coulomb_t *c = &mgr->coulomb[i];
+        blob->ah_discharge[i] = c->ah_discharge;
+        blob->ah_charge[i]    = c->ah_charge;
+        blob->wh_discharge[i] = c->wh_discharge;
+        blob->wh_charge[i]    = c->wh_charge;
+        blob->offset_a[i]     = c->offset_valid ? c->offset_a : 0.0f;
+        if (c->offset_valid) blob->offset_valid |= 1u << i;
+        throughput[i]         = bmu_coulomb_throughput_ah(c);
+    }
+    xSemaphoreGive(mgr->mutex);
+
+    nvs_handle_t h;
+    esp_err_t ret = nvs_open(NVS_NS_AH, NVS_READWRITE, &h);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(h, NVS_KEY_COUNTERS, blob, sizeof(ah_blob_t));
+        if (ret == ESP_OK) ret = nvs_commit(h);
+        nvs_close(h);
+    }
+    free(blob);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Checkpoint Ah NVS failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    memcpy(mgr->saved_throughput_ah, throughput, sizeof(throughput));
+    mgr->last_checkpoint_us = esp_timer_get_time();
+    ESP_LOGD(TAG, "Checkpoint Ah/Wh NVS OK");
+    return ESP_OK;
+}
+
+/* Tâche checkpoint : l'intégration est faite à chaque acquisition par la
+ * protection (bmu_battery_manager_ingest_sample) — cette tâche ne lit plus
+ * l'INA237, elle ne fait que décider quand persister et loguer. */
 static void ah_task(void *pv)
 {
     bmu_battery_manager_t *mgr = (bmu_battery_manager_t *)pv;
-    int64_t last_us = esp_timer_get_time();
     int sample = 0;
 
     for (;;) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        int64_t now_us = esp_timer_get_time();
-        float elapsed_h = (float)(now_us - last_us) / 3.6e9f;
-        last_us = now_us;
-
-        for (int i = 0; i < mgr->nb_ina; i++) {
-            float voltage_mv = 0.0f;
-            float current_a = 0;
-            if (bmu_ina237_read_voltage_current(&mgr->ina_devices[i], &voltage_mv, &current_a) != ESP_OK
-                || std::isnan(voltage_mv) || std::isnan(current_a))
-                continue;
-
-            if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
-                mgr->last_voltage_mv[i] = voltage_mv;
-                mgr->last_current_a[i] = current_a;
-                /* Deadband 50 mA (audit M5) : ne pas intégrer le bruit / le
-                 * courant de fuite d'une batterie OFF (MOSFET ouvert → I≈0) —
-                 * évite une dérive lente des compteurs Ah. */
-                if (elapsed_h > 0) {
-                    if (current_a > 0.05f) {
-                        mgr->ah_discharge[i] += current_a * elapsed_h;
-                    } else if (current_a < -0.05f) {
-                        mgr->ah_charge[i] += (-current_a) * elapsed_h;
-                    }
-                }
-                xSemaphoreGive(mgr->mutex);
+        vTaskDelay(pdMS_TO_TICKS(10000));
+
+        float max_delta_ah = 0.0f;
+        if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+            for (int i = 0; i < BMU_MAX_BATTERIES; i++) {
+                float d = (float)(bmu_coulomb_throughput_ah(&mgr->coulomb[i])
+                          - mgr->saved_throughput_ah[i]);
+                if (d > max_delta_ah) max_delta_ah = d;
             }
+            xSemaphoreGive(mgr->mutex);
+        }
+
+        if (bmu_coulomb_checkpoint_due(max_delta_ah,
+                esp_timer_get_time() - mgr->last_checkpoint_us,
+                CONFIG_BMU_AH_CHECKPOINT_DELTA_MAH / 1000.0f,
+                (int64_t)CONFIG_BMU_AH_CHECKPOINT_MIN_S * 1000000,
+                (int64_t)CONFIG_BMU_AH_CHECKPOINT_MAX_S * 1000000)) {
+            bmu_battery_manager_checkpoint(mgr);
         }
 
         /* Periodic log every ~100s */
-        if (++sample % 100 == 0) {
+        if (++sample % 10 == 0) {
             for (int i = 0; i < mgr->nb_ina; i++) {
-                ESP_LOGI(TAG, "BAT[%d] Ah discharge=%.3f charge=%.3f",
-                         i + 1, mgr->ah_discharge[i], mgr->ah_charge[i]);
+                const bmu_coulomb_t *c = &mgr->coulomb[i];
+                ESP_LOGI(TAG, "BAT[%d] Ah d=%.3f c=%.3f  Wh d=%.1f c=%.1f  offset=%.1fmA",
+                         i + 1, c->ah_discharge, c->ah_charge,
+                         c->wh_discharge, c->wh_charge, c->offset_a * 1000.0f);
             }
         }
     }
@@ -72,13 +204,19 @@ esp_err_t bmu_battery_manager_start(bmu_battery_manager_t *mgr)
     if (mgr->ah_running) return ESP_OK;
 
     TaskHandle_t handle = NULL;
-    if (xTaskCreate(ah_task, "Ah_all", 4096, mgr, 1, &handle) != pdPASS) {
+    if (xTaskCreate(ah_task, "Ah_ckpt", 3072, mgr, 1, &handle) != pdPASS) {
         return ESP_FAIL;
     }
 
     mgr->ah_task_handle = handle;
     mgr->ah_running = true;
-    ESP_LOGI(TAG, "Ah task started (single task, %d batteries)", mgr->nb_ina);
+
+    s_shutdown_mgr = mgr;
+    esp_register_shutdown_handler(shutdown_checkpoint);
+
+    ESP_LOGI(TAG, "Ah checkpoint task started (%d batteries, delta=%dmAh min=%ds max=%ds)",
+             mgr->nb_ina, CONFIG_BMU_AH_CHECKPOINT_DELTA_MAH,
+             CONFIG_BMU_AH_CHECKPOINT_MIN_S, CONFIG_BMU_AH_CHECKPOINT_MAX_S);
     return ESP_OK;
 }
 
@@ -164,26 +302,51 @@ float bmu_battery_manager_get_avg_voltage_mv(bmu_battery_manager_t *mgr)
     return avg_mv;
 }
 
-float bmu_battery_manager_get_ah_discharge(bmu_battery_manager_t *mgr, int idx)
+/* Copie des compteurs d'une batterie sous mutex */
+static bmu_coulomb_t get_coulomb(bmu_battery_manager_t *mgr, int idx)
 {
-    if (idx < 0 || idx >= BMU_MAX_BATTERIES) return 0;
-    float v = 0;
+    bmu_coulomb_t c = {};
+    if (mgr == NULL || idx < 0 || idx >= BMU_MAX_BATTERIES) return c;
     if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
-        v = mgr->ah_discharge[idx];
+        c = mgr->coulomb[idx];
         xSemaphoreGive(mgr->mutex);
     }
-    return v;
+    return c;
+}
+
+esp_err_t bmu_battery_manager_get_coulomb_all(bmu_battery_manager_t *mgr,
+                                              bmu_coulomb_t *out, uint8_t n)
+{
+    if (mgr == NULL || out == NULL || n > BMU_MAX_BATTERIES) return ESP_ERR_INVALID_ARG;
+    if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(20)) != pdTRUE) return ESP_ERR_TIMEOUT;
+    memcpy(out, mgr->coulomb, (size_t)n * sizeof(bmu_coulomb_t));
+    xSemaphoreGive(mgr->mutex);
+    return ESP_OK;
+}
+
+float bmu_battery_manager_get_ah_discharge(bmu_battery_manager_t *mgr, int idx)
+{
+    return get_coulomb(mgr, idx).ah_discharge;
 }
 
 float bmu_battery_manager_get_ah_charge(bmu_battery_manager_t *mgr, int idx)
 {
-    if (idx < 0 || idx >= BMU_MAX_BATTERIES) return 0;
-    float v = 0;
-    if (xSemaphoreTake(mgr->mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
-        v = mgr->ah_charge[idx];
-        xSemaphoreGive(mgr->mutex);
-    }
-    return v;
+    return get_coulomb(mgr, idx).ah_charge;
+}
+
+float bmu_battery_manager_get_wh_discharge(bmu_battery_manager_t *mgr, int idx)
+{
+    return get_coulomb(mgr, idx).wh_discharge;
+}
+
+float bmu_battery_manager_get_wh_charge(bmu_battery_manager_t *mgr, int idx)
+{
+    return get_coulomb(mgr, idx).wh_charge;
+}
+
+float bmu_battery_manager_get_current_offset_a(bmu_battery_manager_t *mgr, int idx)
+{
+    return get_coulomb(mgr, idx).offset_a;
 }
 
 float bmu_battery_manager_get_total_current_a(bmu_battery_manager_t *mgr)
@@ -228,12 +391,13 @@ esp_err_t bmu_battery_manager_update_nb_ina(bmu_battery_manager_t *mgr, uint8_t
 
     uint8_t old = mgr->nb_ina;
 
-    /* Reset Ah counters for new slots */
+    /* Nouveaux slots : reset du cache V/I et de l'état d'intégration.
+     * Les compteurs Ah/Wh sont conservés — ils sont persistés par slot et
+     * un slot vu vide au boot (bus lent) retrouve ses compteurs au hotplug. */
     for (int i = old; i < new_nb_ina; i++) {
         mgr->last_voltage_mv[i] = 0;
         mgr->last_current_a[i] = 0;
-        mgr->ah_discharge[i] = 0;
-        mgr->ah_charge[i] = 0;
+        mgr->coulomb[i].has_prev = false;
     }
 
     mgr->nb_ina = new_nb_ina;
@@ -36,6 +36,12 @@ esp_err_t bmu_protection_init(bmu_protection_ctx_t *ctx,
     return ESP_OK;
 }
 
+void bmu_protection_set_battery_manager(bmu_protection_ctx_t *ctx,
+                                        bmu_battery_manager_t *mgr)
+{
+    if (ctx != NULL) ctx->mgr = mgr;
+}
+
 /* ── Helper: switch battery ON/OFF via TCA ─────────────────────────── */
 static esp_err_t switch_battery(bmu_protection_ctx_t *ctx, int idx, bool on)
 {
@@ -202,12 +208,21 @@ esp_err_t bmu_protection_check_battery_ex(bmu_protection_ctx_t *ctx, int idx, fl
     }
 
     /* Cache voltage and current (mutex-protected) */
+    bool switch_closed = false;
     if (xSemaphoreTake(ctx->state_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
         ctx->battery_voltages[idx] = v_mv;
         ctx->battery_currents[idx] = i_a;
+        switch_closed = (ctx->battery_state[idx] == BMU_STATE_CONNECTED ||
+                         ctx->battery_state[idx] == BMU_STATE_RECONNECTING);
         xSemaphoreGive(ctx->state_mutex);
     }
 
+    /* Comptage coulométrique à la cadence d'acquisition (trapèze + offset) */
+    if (ctx->mgr != NULL) {
+        bmu_battery_manager_ingest_sample(ctx->mgr, idx, v_mv, i_a,
+                                          switch_closed, esp_timer_get_time());
+    }
+
     /* Read shared state under mutex */
     int local_nb_switch = 0;
     int64_t local_reconnect_time = 0;
@@ -574,7 +589,7 @@ void bmu_protection_publish_snapshot(bmu_protection_ctx_t *ctx) {
     for (int i = 0; i < ctx->nb_ina; i++) {
         snap.battery[i].voltage_mv  = ctx->battery_voltages[i];
         snap.battery[i].state       = ctx->battery_state[i];
-        snap.battery[i].nb_switches = (uint8_t)ctx->nb_switch[i];
+        snap.battery[i].nb_switches = (uint16_t)(ctx->nb_switch[i] > UINT16_MAX ? UINT16_MAX : ctx->nb_switch[i]);
         snap.battery[i].health_score = ctx->ina_health[i].score;
         snap.battery[i].balancer_active = false;
         snap.battery[i].current_a = ctx->battery_currents[i];
@@ -600,6 +615,10 @@ void bmu_protection_publish_snapshot(bmu_protection_ctx_t *ctx) {
         xQueueOverwrite(ctx->queues.q_cloud, &snap);
     if (ctx->queues.q_ble)
         xQueueOverwrite(ctx->queues.q_ble, &snap);
+    if (ctx->queues.q_soc)
+        xQueueOverwrite(ctx->queues.q_soc, &snap);
+    if (ctx->queues.q_sdlog)
+        xQueueOverwrite(ctx->queues.q_sdlog, &snap);
 }
 
 void bmu_protection_process_commands(bmu_protection_ctx_t *ctx) {
@@ -2,6 +2,7 @@
 
 #include "bmu_ina237.h"
 #include "bmu_config.h"
+#include "bmu_coulomb.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -17,8 +18,9 @@ typedef struct {
     SemaphoreHandle_t   mutex;
     float               last_voltage_mv[BMU_MAX_BATTERIES];
     float               last_current_a[BMU_MAX_BATTERIES];
-    float               ah_discharge[BMU_MAX_BATTERIES];
-    float               ah_charge[BMU_MAX_BATTERIES];
+    bmu_coulomb_t       coulomb[BMU_MAX_BATTERIES];    /**< Ah/Wh + offset par batterie */
+    double              saved_throughput_ah[BMU_MAX_BATTERIES]; /**< Débit au dernier checkpoint */
+    int64_t             last_checkpoint_us;
     TaskHandle_t        ah_task_handle;
     bool                ah_running;
 } bmu_battery_manager_t;
@@ -26,6 +28,25 @@ typedef struct {
 esp_err_t bmu_battery_manager_init(bmu_battery_manager_t *mgr,
                                     bmu_ina237_t *ina, uint8_t nb_ina);
 esp_err_t bmu_battery_manager_start(bmu_battery_manager_t *mgr);
+
+/**
+ * @brief Injecte un échantillon d'acquisition (appelé par la tâche protection
+ *        après chaque lecture INA237 valide, 5 Hz). Met à jour le cache V/I et
+ *        intègre Ah/Wh (trapèze, offset corrigé).
+ *
+ * @param switch_closed true si la batterie est CONNECTED/RECONNECTING ;
+ *                      false = MOSFET ouvert → échantillon d'apprentissage offset
+ * @param t_us          Horodatage de la lecture (esp_timer_get_time())
+ */
+void bmu_battery_manager_ingest_sample(bmu_battery_manager_t *mgr, int idx,
+                                       float voltage_mv, float current_a,
+                                       bool switch_closed, int64_t t_us);
+
+/**
+ * @brief Écrit immédiatement les compteurs Ah/Wh + offsets en NVS
+ *        (aussi appelé au shutdown via esp_register_shutdown_handler).
+ */
+esp_err_t bmu_battery_manager_checkpoint(bmu_battery_manager_t *mgr);
 esp_err_t bmu_battery_manager_get_summary(bmu_battery_manager_t *mgr,
                                           float *avg_voltage_mv,
                                           float *total_current_a,
@@ -35,10 +56,20 @@ float bmu_battery_manager_get_min_voltage_mv(bmu_battery_manager_t *mgr);
 float bmu_battery_manager_get_avg_voltage_mv(bmu_battery_manager_t *mgr);
 float bmu_battery_manager_get_ah_discharge(bmu_battery_manager_t *mgr, int idx);
 float bmu_battery_manager_get_ah_charge(bmu_battery_manager_t *mgr, int idx);
+float bmu_battery_manager_get_wh_discharge(bmu_battery_manager_t *mgr, int idx);
+float bmu_battery_manager_get_wh_charge(bmu_battery_manager_t *mgr, int idx);
+float bmu_battery_manager_get_current_offset_a(bmu_battery_manager_t *mgr, int idx);
 float bmu_battery_manager_get_total_current_a(bmu_battery_manager_t *mgr);
 float bmu_battery_manager_get_last_voltage_mv(bmu_battery_manager_t *mgr, int idx);
 float bmu_battery_manager_get_last_current_a(bmu_battery_manager_t *mgr, int idx);
 
+/**
+ * @brief Copie les compteurs Ah/Wh des n premières batteries sous un seul
+ *        verrou (pipeline télémétrie), au lieu d'un getter par champ.
+ */
+esp_err_t bmu_battery_manager_get_coulomb_all(bmu_battery_manager_t *mgr,
+                                              bmu_coulomb_t *out, uint8_t n);
+
 /**
  * @brief Update nb_ina after hotplug topology change.
  */
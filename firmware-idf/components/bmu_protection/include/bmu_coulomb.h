@@ -0,0 +1,147 @@
+/**
+ * @file bmu_coulomb.h
+ * @brief Comptage coulométrique par batterie — logique pure (host-testable).
+ *
+ * Intégration trapézoïdale Ah / Wh alimentée par chaque échantillon
+ * d'acquisition de la tâche protection (5 Hz), au lieu de l'ancien
+ * ah_task à 1 Hz (rectangle + deadband 50 mA).
+ *
+ * Offset : quand le MOSFET est ouvert, le courant réel est nul — la lecture
+ * INA237 est alors l'offset du shunt. On l'apprend par EMA et on le soustrait
+ * quand la batterie est en ligne (remplace le deadband fixe, audit M5).
+ *
+ * Cumuls en double : un float (24 bits de mantisse) n'absorbe plus un pas
+ * de 5 Hz à 1 A (~5.6e-5 Ah) au-delà de quelques centaines d'Ah — le
+ * compteur à vie dériverait puis se figerait. Le double garde le mAs
+ * jusqu'à ~1e9 Ah.
+ *
+ * Convention de signe (identique protection) : I > 0 décharge, I < 0 charge.
+ * Aucune dépendance ESP-IDF : inclus tel quel par test/test_coulomb.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_COULOMB_OFFSET_MAX_A   0.2f  /**< Offset plausible max (au-delà : vrai courant / glitch) */
+#define BMU_COULOMB_OFFSET_SHIFT   4     /**< EMA offset : alpha = 1/16 */
+#define BMU_COULOMB_US_PER_H       3.6e9
+
+typedef struct {
+    double  ah_discharge;   /**< Ah cumulés en décharge */
+    double  ah_charge;      /**< Ah cumulés en charge */
+    double  wh_discharge;   /**< Wh cumulés en décharge */
+    double  wh_charge;      /**< Wh cumulés en charge */
+    float   offset_a;       /**< Offset courant appris (A) */
+    bool    offset_valid;   /**< true dès le premier échantillon MOSFET ouvert */
+    /* État d'intégration (non persisté) */
+    bool    has_prev;
+    float   prev_i_a;       /**< Courant corrigé de l'échantillon précédent */
+    float   prev_p_w;       /**< Puissance de l'échantillon précédent */
+    int64_t prev_us;
+} bmu_coulomb_t;
+
+/**
+ * @brief Aire trapézoïdale de y0→y1 sur dt, séparée en parties positive et
+ *        négative (point de passage par zéro interpolé linéairement).
+ */
+static inline void bmu_coulomb_trapezoid(float y0, float y1, double dt,
+                                         double *pos, double *neg)
+{
+    if ((y0 >= 0.0f) == (y1 >= 0.0f)) {
+        double a = 0.5 * ((double)y0 + y1) * dt;
+        if (a >= 0.0) *pos += a;
+        else          *neg -= a;
+        return;
+    }
+    double f = (double)y0 / ((double)y0 - y1);  /* fraction de dt avant le zéro */
+    double a0 = 0.5 * y0 * f * dt;
+    double a1 = 0.5 * y1 * (1.0 - f) * dt;
+    if (y0 > 0.0f) { *pos += a0; *neg -= a1; }
+    else           { *neg -= a0; *pos += a1; }
+}
+
+/** @brief Apprend l'offset sur une lecture MOSFET ouvert (courant réel nul). */
+static inline void bmu_coulomb_learn_offset(bmu_coulomb_t *c, float i_a)
+{
+    if (isnan(i_a) || fabsf(i_a) > BMU_COULOMB_OFFSET_MAX_A) return;
+    if (!c->offset_valid) {
+        c->offset_a = i_a;
+        c->offset_valid = true;
+        return;
+    }
+    c->offset_a += (i_a - c->offset_a) / (float)(1 << BMU_COULOMB_OFFSET_SHIFT);
+}
+
+/**
+ * @brief Intègre un échantillon d'acquisition.
+ *
+ * @param c             Compteur de la batterie
+ * @param v_mv          Tension mesurée (mV)
+ * @param i_a           Courant brut mesuré (A)
+ * @param t_us          Horodatage de la lecture (µs depuis boot)
+ * @param switch_closed true si la batterie est en ligne (CONNECTED/RECONNECTING)
+ * @param max_gap_us    Écart max entre deux échantillons ; au-delà on ne
+ *                      ponte pas le trou (lecture ratée, phase OFF balancer)
+ */
+static inline void bmu_coulomb_sample(bmu_coulomb_t *c, float v_mv, float i_a,
+                                      int64_t t_us, bool switch_closed,
+                                      int64_t max_gap_us)
+{
+    if (isnan(v_mv) || isnan(i_a)) return;
+
+    float i_corr;
+    if (!switch_closed) {
+        bmu_coulomb_learn_offset(c, i_a);
+        i_corr = 0.0f;
+    } else {
+        i_corr = i_a - (c->offset_valid ? c->offset_a : 0.0f);
+    }
+    float p_w = (v_mv / 1000.0f) * i_corr;
+
+    if (c->has_prev && t_us > c->prev_us && (t_us - c->prev_us) <= max_gap_us) {
+        double dt_h = (double)(t_us - c->prev_us) / BMU_COULOMB_US_PER_H;
+        bmu_coulomb_trapezoid(c->prev_i_a, i_corr, dt_h,
+                              &c->ah_discharge, &c->ah_charge);
+        bmu_coulomb_trapezoid(c->prev_p_w, p_w, dt_h,
+                              &c->wh_discharge, &c->wh_charge);
+    }
+
+    c->prev_i_a = i_corr;
+    c->prev_p_w = p_w;
+    c->prev_us  = t_us;
+    c->has_prev = true;
+}
+
+/** @brief Débit total (Ah charge + décharge) — base de la politique de checkpoint. */
+static inline double bmu_coulomb_throughput_ah(const bmu_coulomb_t *c)
+{
+    return c->ah_discharge + c->ah_charge;
+}
+
+/**
+ * @brief Politique de checkpoint économe en usure flash.
+ *
+ * Écrit si le débit max d'une batterie depuis le dernier checkpoint dépasse
+ * delta_ah, ou si max_interval est écoulé avec un changement non sauvé —
+ * jamais plus souvent que min_interval.
+ */
+static inline bool bmu_coulomb_checkpoint_due(float max_delta_ah,
+                                              int64_t since_last_us,
+                                              float delta_ah,
+                                              int64_t min_interval_us,
+                                              int64_t max_interval_us)
+{
+    if (since_last_us < min_interval_us) return false;
+    if (max_delta_ah >= delta_ah) return true;
+    return since_last_us >= max_interval_us && max_delta_ah > 0.0f;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,6 +4,7 @@
 #include "bmu_ina237.h"
 #include "bmu_tca9535.h"
 #include "bmu_config.h"
+#include "bmu_battery_manager.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -22,6 +23,8 @@ typedef struct {
     QueueHandle_t q_display;
     QueueHandle_t q_cloud;
     QueueHandle_t q_ble;
+    QueueHandle_t q_soc;
+    QueueHandle_t q_sdlog;      // journal SD, chaque snapshot (NULL = désactivé)
     QueueHandle_t q_cmd;
 } bmu_protection_queues_t;
 
@@ -40,6 +43,9 @@ typedef struct {
     uint8_t               imbalance_count[BMU_MAX_BATTERIES]; /**< Consecutive imbalance cycles */
     bmu_device_health_t   ina_health[BMU_MAX_BATTERIES];     /**< Per-INA I2C health score */
 
+    /** Coulomb counting fed by every acquisition sample (NULL = disabled) */
+    bmu_battery_manager_t  *mgr;
+
     // RTOS task + queue infrastructure
     bmu_protection_queues_t queues;
     uint16_t                cycle_count;
@@ -65,6 +71,13 @@ float bmu_protection_compute_fleet_max(bmu_protection_ctx_t *ctx);
 esp_err_t bmu_protection_check_battery_ex(bmu_protection_ctx_t *ctx, int battery_idx,
                                            float fleet_max_mv);
 
+/**
+ * @brief Route every valid INA237 sample to the battery manager (Ah/Wh
+ * integration at acquisition rate). Call after bmu_protection_init().
+ */
+void bmu_protection_set_battery_manager(bmu_protection_ctx_t *ctx,
+                                        bmu_battery_manager_t *mgr);
+
 esp_err_t bmu_protection_all_off(bmu_protection_ctx_t *ctx);
 
 esp_err_t bmu_protection_reset_switch_count(bmu_protection_ctx_t *ctx, int battery_idx);
@@ -391,6 +391,16 @@ bmu_rint_result_t bmu_rint_get_cached(uint8_t battery_idx)
     return result;
 }
 
+bool bmu_rint_get_cached_all(bmu_rint_result_t *out, uint8_t n)
+{
+    if (s_mutex == NULL) return false;
+    if (n > BMU_MAX_BATTERIES) n = BMU_MAX_BATTERIES;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    memcpy(out, s_cache, n * sizeof(bmu_rint_result_t));
+    xSemaphoreGive(s_mutex);
+    return true;
+}
+
 void bmu_rint_on_disconnect(uint8_t battery_idx, float v_before_mv, float i_before_a)
 {
     /* Mesure opportuniste : la batterie vient d'être déconnectée par la protection.
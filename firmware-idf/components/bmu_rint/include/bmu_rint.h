@@ -36,6 +36,11 @@ esp_err_t bmu_rint_init(void);
 esp_err_t bmu_rint_measure(uint8_t battery_idx, bmu_rint_trigger_t trigger);
 esp_err_t bmu_rint_measure_all(bmu_rint_trigger_t trigger);
 bmu_rint_result_t bmu_rint_get_cached(uint8_t battery_idx);
+/**
+ * Résultats des n premières batteries sous un seul verrou (notifications
+ * BLE). Verrou indisponible : sorties inchangées, retourne false.
+ */
+bool bmu_rint_get_cached_all(bmu_rint_result_t *out, uint8_t n);
 void bmu_rint_on_disconnect(uint8_t battery_idx, float v_before_mv, float i_before_a);
 esp_err_t bmu_rint_start_periodic(void);
 
@@ -0,0 +1,342 @@
+/**
+ * @file bmu_rul.cpp
+ * @brief Moteur de tendance embarqué — pente de dégradation et RUL par batterie.
+ *
+ * Toutes les CONFIG_BMU_RUL_SAMPLE_INTERVAL_MIN minutes (horloge SNTP requise) :
+ *   - R_int : dernière mesure bmu_rint valide si nouvelle ;
+ *   - SOH   : bmu_soh_get_cached ;
+ *   - capacité : ΔAh net (bmu_battery_manager) / ΔSOC (bmu_soc) sur ≥ 30 %.
+ * Chaque métrique alimente une régression robuste (bmu_rul_trend.h), la RUL
+ * est le minimum des jours restants avant les seuils de fin de vie.
+ *
+ * Résultats : MQTT bmu/<device>/rul/<id> (retain), BLE 0x003D (bmu_ble).
+ * L'état complet (~4.6 KB) est réécrit dans /fatfs/rul/state.bin à chaque
+ * échantillon — pas en NVS, partition trop petite pour 32 batteries.
+ */
+
+#include "bmu_rul.h"
+#include "bmu_rul_trend.h"
+#include "sdkconfig.h"
+
+#include "esp_crc.h"
+#include "esp_log.h"
+
+static const char *TAG = "RUL";
+
+#if !CONFIG_BMU_RUL_ENABLED
+
+esp_err_t bmu_rul_init(bmu_battery_manager_t *) { return ESP_OK; }
+esp_err_t bmu_rul_start_task(UBaseType_t, uint32_t) { return ESP_OK; }
+bool bmu_rul_get(int, bmu_rul_result_t *) { return false; }
+
+#else
+
+#include "bmu_rint.h"
+#include "bmu_soh.h"
+#include "bmu_soc.h"
+#include "bmu_mqtt.h"
+#include "bmu_config.h"
+#include "bmu_storage.h"
+#include "bmu_sntp.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sys/stat.h>
+
+#define RUL_DIR          BMU_FAT_MOUNT "/rul"
+#define RUL_STATE_PATH   BMU_FAT_MOUNT "/rul/state.bin"
+#define RUL_STATE_TMP    BMU_FAT_MOUNT "/rul/state.tmp"
+#define RUL_FILE_MAGIC   0x4C555242u   /* "BRUL" */
+#define RUL_FILE_VERSION 1
+
+#define RUL_LAMBDA        ((float)CONFIG_BMU_RUL_FORGET_PERMILLE / 1000.0f)
+#define RUL_CAP_MIN_DSOC  0.3f        /* ΔSOC minimum pour une mesure de capacité */
+#define RUL_REST_MAX_A    0.2f        /* Repos : même seuil que l'EKF SOC */
+#define RUL_REST_MAX_AH   0.05f       /* Débit toléré entre deux échantillons au repos */
+
+/* σ plancher par métrique (résolution de mesure) */
+#define RUL_SCALE_RINT_MOHM  0.2f
+#define RUL_SCALE_SOH_PCT    0.5f
+#define RUL_SCALE_CAP_AH     0.2f
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t nb;
+    uint32_t crc;       /* CRC-32 (esp_crc32_le) des octets de s_bat */
+} rul_file_hdr_t;
+
+static bmu_battery_manager_t *s_mgr = NULL;
+static SemaphoreHandle_t s_mutex = NULL;
+static bmu_rul_battery_t s_bat[BMU_MAX_BATTERIES];
+
+/* ── Persistance ───────────────────────────────────────────────────── */
+
+static uint32_t state_checksum(void)
+{
+    return esp_crc32_le(0, (const uint8_t *)s_bat, sizeof(s_bat));
+}
+
+static void load_state(void)
+{
+    FILE *f = fopen(RUL_STATE_PATH, "rb");
+    if (!f) {
+        ESP_LOGI(TAG, "Pas d'historique RUL — démarrage à vide");
+        return;
+    }
+    /* Version inconnue : rejetée, l'historique repart à vide */
+    rul_file_hdr_t hdr = {};
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              hdr.magic == RUL_FILE_MAGIC && hdr.version == RUL_FILE_VERSION &&
+              hdr.nb == BMU_MAX_BATTERIES &&
+              fread(s_bat, sizeof(s_bat), 1, f) == 1 &&
+              hdr.crc == state_checksum();
+    fclose(f);
+    if (!ok) {
+        ESP_LOGW(TAG, "Historique RUL invalide (version %u) — ignoré", (unsigned)hdr.version);
+        memset(s_bat, 0, sizeof(s_bat));
+        return;
+    }
+    ESP_LOGI(TAG, "Historique RUL restauré (%u octets)", (unsigned)sizeof(s_bat));
+}
+
+/* Écriture atomique : tmp puis rename (une coupure ne perd pas l'historique) */
+static void save_state(void)
+{
+    if (!bmu_fat_is_mounted()) return;
+    struct stat st;
+    if (stat(RUL_DIR, &st) != 0 && mkdir(RUL_DIR, 0755) != 0) {
+        ESP_LOGW(TAG, "mkdir(%s) échoué", RUL_DIR);
+        return;
+    }
+    FILE *f = fopen(RUL_STATE_TMP, "wb");
+    if (!f) {
+        ESP_LOGW(TAG, "fopen(%s) échoué", RUL_STATE_TMP);
+        return;
+    }
+    rul_file_hdr_t hdr = {
+        .magic = RUL_FILE_MAGIC,
+        .version = RUL_FILE_VERSION,
+        .nb = BMU_MAX_BATTERIES,
+        .crc = state_checksum(),
+    };
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              fwrite(s_bat, sizeof(s_bat), 1, f) == 1;
+    fclose(f);
+    if (!ok) {
+        ESP_LOGW(TAG, "Écriture historique RUL échouée");
+        remove(RUL_STATE_TMP);
+        return;
+    }
+    remove(RUL_STATE_PATH);
+    if (rename(RUL_STATE_TMP, RUL_STATE_PATH) != 0) {
+        ESP_LOGW(TAG, "rename(%s) échoué", RUL_STATE_TMP);
+    }
+}
+
+/* ── Calcul ────────────────────────────────────────────────────────── */
+
+static void compute_result(const bmu_rul_battery_t *b, double t_now, bmu_rul_result_t *out)
+{
+    const uint16_t min_pts = CONFIG_BMU_RUL_MIN_POINTS;
+    const float min_span = (float)CONFIG_BMU_RUL_MIN_SPAN_DAYS;
+
+    out->rul_days = BMU_RUL_DAYS_UNKNOWN;
+    out->limit = BMU_RUL_LIMIT_NONE;
+    out->rint_slope_mohm_day = bmu_rul_reg_slope(&b->rint);
+    out->soh_slope_pct_day   = bmu_rul_reg_slope(&b->soh);
+    out->cap_slope_ah_day    = bmu_rul_reg_slope(&b->cap);
+    out->capacity_ah = NAN;
+
+    uint16_t n = b->rint.count;
+    if (b->soh.count > n) n = b->soh.count;
+    if (b->cap.count > n) n = b->cap.count;
+    out->n_points = n;
+
+    float d;
+    if (b->rint_baseline > 0.0f) {
+        float eol = b->rint_baseline * (float)CONFIG_BMU_RUL_EOL_RINT_PCT / 100.0f;
+        d = bmu_rul_reg_days_to(&b->rint, t_now, eol, true, min_pts, min_span);
+        if (d >= 0.0f) { out->rul_days = d; out->limit = BMU_RUL_LIMIT_RINT; }
+    }
+
+    d = bmu_rul_reg_days_to(&b->soh, t_now, (float)CONFIG_BMU_RUL_EOL_SOH_PCT,
+                            false, min_pts, min_span);
+    if (d >= 0.0f && (out->rul_days < 0.0f || d < out->rul_days)) {
+        out->rul_days = d;
+        out->limit = BMU_RUL_LIMIT_SOH;
+    }
+
+#if CONFIG_BMU_SOC_ENABLED
+    float a, slope;
+    if (bmu_rul_reg_fit(&b->cap, &a, &slope)) {
+        out->capacity_ah = a + slope * (float)(t_now - b->cap.t_ref_days);
+    } else if (b->cap.count > 0) {
+        out->capacity_ah = (float)(b->cap.sy / b->cap.n);
+    }
+    float cap_eol = (float)CONFIG_BMU_SOC_CAPACITY_MAH / 1000.0f *
+                    (float)CONFIG_BMU_RUL_EOL_CAP_PCT / 100.0f;
+    /* Peu de cycles profonds : seuil de points réduit pour la capacité */
+    uint16_t cap_min = min_pts / 4 > 3 ? min_pts / 4 : 3;
+    d = bmu_rul_reg_days_to(&b->cap, t_now, cap_eol, false, cap_min, min_span);
+    if (d >= 0.0f && (out->rul_days < 0.0f || d < out->rul_days)) {
+        out->rul_days = d;
+        out->limit = BMU_RUL_LIMIT_CAPACITY;
+    }
+#endif
+
+    out->alert = out->rul_days >= 0.0f && out->rul_days < (float)CONFIG_BMU_RUL_ALERT_DAYS;
+}
+
+static void sample_battery(int i, double t_days)
+{
+    bmu_rul_battery_t *b = &s_bat[i];
+    const float lambda = RUL_LAMBDA;
+
+    bmu_rint_result_t r = bmu_rint_get_cached((uint8_t)i);
+    if (r.valid && r.r_ohmic_mohm > 0.0f && r.timestamp_ms != b->last_rint_ts) {
+        b->last_rint_ts = r.timestamp_ms;
+        bmu_rul_reg_add(&b->rint, t_days, r.r_ohmic_mohm, lambda, RUL_SCALE_RINT_MOHM);
+        /* R_int neuf : moyenne des premiers points, figée ensuite */
+        if (b->rint_baseline <= 0.0f && b->rint.count >= CONFIG_BMU_RUL_MIN_POINTS / 2) {
+            b->rint_baseline = (float)(b->rint.sy / b->rint.n);
+        }
+    }
+
+    float soh = bmu_soh_get_cached(i);
+    if (soh >= 0.0f) {
+        bmu_rul_reg_add(&b->soh, t_days, soh * 100.0f, lambda, RUL_SCALE_SOH_PCT);
+    }
+
+    if (!s_mgr) return;
+    /* Ancres de capacité au repos seulement, SOC lu sur l'OCV : le SOC de
+     * l'EKF dérive de capacité × SOH et ΔAh/ΔSOC renverrait cette capacité.
+     * Biais résiduel : plateau OCV plat en LFP (quelques % de SOC par mV
+     * de bruit ou de relaxation incomplète), encaissé par ΔSOC ≥
+     * RUL_CAP_MIN_DSOC et l'écrêtage Huber. */
+    float ah_chg = bmu_battery_manager_get_ah_charge(s_mgr, i);
+    float ah_dis = bmu_battery_manager_get_ah_discharge(s_mgr, i);
+    bool rested = bmu_rul_rest_check(&b->rest, (double)ah_chg + ah_dis,
+                                     bmu_battery_manager_get_last_current_a(s_mgr, i),
+                                     RUL_REST_MAX_A, RUL_REST_MAX_AH);
+    float soc = rested ? bmu_soc_from_rest_mv(
+                             bmu_battery_manager_get_last_voltage_mv(s_mgr, i))
+                       : -1.0f;
+    if (soc >= 0.0f) {
+        float cap;
+        if (bmu_rul_capacity_sample(&b->anchor, ah_chg - ah_dis, soc / 100.0f,
+                                    RUL_CAP_MIN_DSOC, &cap)) {
+            /* Pas d'oubli : quelques points par mois seulement */
+            bmu_rul_reg_add(&b->cap, t_days, cap, 1.0f, RUL_SCALE_CAP_AH);
+        }
+    }
+}
+
+static void publish_result(int i, const bmu_rul_result_t *res)
+{
+    if (!bmu_mqtt_is_connected()) return;
+
+    char payload[256];
+    int plen = snprintf(payload, sizeof(payload),
+        "{\"bat\":%d,\"rul_days\":%.0f,\"n\":%u,\"alert\":%s",
+        i, res->rul_days, (unsigned)res->n_points, res->alert ? "true" : "false");
+    if (!std::isnan(res->rint_slope_mohm_day)) {
+        plen += snprintf(payload + plen, sizeof(payload) - plen,
+            ",\"rint_slope\":%.4f", res->rint_slope_mohm_day);
+    }
+    if (!std::isnan(res->soh_slope_pct_day)) {
+        plen += snprintf(payload + plen, sizeof(payload) - plen,
+            ",\"soh_slope\":%.4f", res->soh_slope_pct_day);
+    }
+    if (!std::isnan(res->capacity_ah)) {
+        plen += snprintf(payload + plen, sizeof(payload) - plen,
+            ",\"cap_ah\":%.2f", res->capacity_ah);
+    }
+    static const char *const LIMIT_STR[] = { "none", "rint", "soh", "capacity" };
+    snprintf(payload + plen, sizeof(payload) - plen,
+        ",\"limit\":\"%s\"}", LIMIT_STR[res->limit]);
+
+    char topic[64];
+    snprintf(topic, sizeof(topic), "bmu/%s/rul/%d", bmu_config_get_device_name(), i);
+    bmu_mqtt_publish(topic, payload, 0, 1, true);
+}
+
+static void rul_task(void *arg)
+{
+    (void)arg;
+    ESP_LOGI(TAG, "RUL task started — échantillon toutes les %d min",
+             CONFIG_BMU_RUL_SAMPLE_INTERVAL_MIN);
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_BMU_RUL_SAMPLE_INTERVAL_MIN * 60 * 1000));
+
+        /* Axe temporel = jours epoch : sans SNTP pas d'échantillon (l'uptime
+         * repart de zéro à chaque boot et casserait la régression) */
+        if (!bmu_sntp_is_synced()) {
+            ESP_LOGD(TAG, "Heure non synchronisée — échantillon ignoré");
+            continue;
+        }
+        double t_days = (double)time(NULL) / 86400.0;
+
+        int nb = s_mgr ? s_mgr->nb_ina : 0;
+        if (nb > BMU_MAX_BATTERIES) nb = BMU_MAX_BATTERIES;
+
+        bmu_rul_result_t res[BMU_MAX_BATTERIES];
+        if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+        for (int i = 0; i < nb; i++) {
+            sample_battery(i, t_days);
+            compute_result(&s_bat[i], t_days, &res[i]);
+        }
+        save_state();
+        xSemaphoreGive(s_mutex);
+
+        for (int i = 0; i < nb; i++) {
+            if (res[i].alert) {
+                ESP_LOGW(TAG, "Batterie %d : RUL %.0f j (limite %d)",
+                         i, res[i].rul_days, (int)res[i].limit);
+            }
+            publish_result(i, &res[i]);
+        }
+    }
+}
+
+/* ── API ───────────────────────────────────────────────────────────── */
+
+esp_err_t bmu_rul_init(bmu_battery_manager_t *mgr)
+{
+    if (!mgr) return ESP_ERR_INVALID_ARG;
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) return ESP_ERR_NO_MEM;
+    s_mgr = mgr;
+    memset(s_bat, 0, sizeof(s_bat));
+    if (bmu_fat_is_mounted()) load_state();
+    ESP_LOGI(TAG, "Init OK — EOL SOH %d%%, R_int %d%%, alerte < %d j",
+             CONFIG_BMU_RUL_EOL_SOH_PCT, CONFIG_BMU_RUL_EOL_RINT_PCT,
+             CONFIG_BMU_RUL_ALERT_DAYS);
+    return ESP_OK;
+}
+
+esp_err_t bmu_rul_start_task(UBaseType_t priority, uint32_t stack_size)
+{
+    BaseType_t ret = xTaskCreate(rul_task, "rul", stack_size, NULL, priority, NULL);
+    return (ret == pdPASS) ? ESP_OK : ESP_FAIL;
+}
+
+bool bmu_rul_get(int idx, bmu_rul_result_t *out)
+{
+    if (idx < 0 || idx >= BMU_MAX_BATTERIES || !out || !s_mutex) return false;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(20)) != pdTRUE) return false;
+    double t_now = bmu_sntp_is_synced() ? (double)time(NULL) / 86400.0
+                                        : s_bat[idx].soh.t_ref_days + s_bat[idx].soh.t_last;
+    compute_result(&s_bat[idx], t_now, out);
+    xSemaphoreGive(s_mutex);
+    return true;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "esp_err.h"
+#include "bmu_battery_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Métrique qui limite la RUL */
+typedef enum {
+    BMU_RUL_LIMIT_NONE = 0,
+    BMU_RUL_LIMIT_RINT,
+    BMU_RUL_LIMIT_SOH,
+    BMU_RUL_LIMIT_CAPACITY,
+} bmu_rul_limit_t;
+
+typedef struct {
+    float    rul_days;              /**< Jours avant fin de vie, < 0 si inconnue */
+    float    rint_slope_mohm_day;   /**< NAN si indisponible */
+    float    soh_slope_pct_day;     /**< NAN si indisponible */
+    float    cap_slope_ah_day;      /**< NAN si indisponible */
+    float    capacity_ah;           /**< Capacité tendancielle actuelle, NAN si inconnue */
+    uint16_t n_points;              /**< Points de l'historique le plus fourni */
+    bmu_rul_limit_t limit;
+    bool     alert;                 /**< rul_days < CONFIG_BMU_RUL_ALERT_DAYS */
+} bmu_rul_result_t;
+
+/**
+ * @brief Charge l'historique persistant (/fatfs/rul/state.bin).
+ * Appeler après bmu_fat_init() et bmu_battery_manager_init().
+ */
+esp_err_t bmu_rul_init(bmu_battery_manager_t *mgr);
+
+esp_err_t bmu_rul_start_task(UBaseType_t priority, uint32_t stack_size);
+
+/** @return false si idx invalide ou moteur désactivé */
+bool bmu_rul_get(int idx, bmu_rul_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,199 @@
+/**
+ * @file bmu_rul_trend.h
+ * @brief Tendance de dégradation et RUL par batterie — logique pure (host-testable).
+ *
+ * Régression linéaire récursive robuste y = a + b·t :
+ *   - sommes pondérées (n, Σt, Σy, Σt², Σty) avec facteur d'oubli λ —
+ *     historique compact de taille fixe, sans buffer d'échantillons.
+ *     Sommes en double : n·Σt² - (Σt)² soustrait deux termes voisins, en
+ *     float la pente dérive de ~20 % après quelques années à l'heure ;
+ *   - résidu écrêté à ±k·σ avant mise à jour (Huber winsorisé) : une
+ *     mesure R_int aberrante ou un SOH TFLite bruité ne tire pas la pente ;
+ *   - σ suivi par EMA du résidu absolu (×1.4826, équivalent MAD gaussien).
+ *
+ * t est exprimé en jours relatifs à t_ref (premier échantillon).
+ *
+ * Aucune dépendance ESP-IDF : inclus tel quel par test/test_rul_trend.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_RUL_HUBER_K        2.5f    /**< Écrêtage à ±k·σ */
+#define BMU_RUL_SCALE_ALPHA    0.1f    /**< EMA de σ */
+#define BMU_RUL_DAYS_UNKNOWN   -1.0f   /**< Pas de tendance vers le seuil */
+
+typedef struct {
+    double   n, st, sy, stt, sty;  /**< Sommes pondérées (oubli λ) */
+    double   t_ref_days;           /**< Origine des temps (jours epoch) */
+    float    scale;                /**< σ robuste des résidus */
+    float    t_first, t_last;      /**< Étendue couverte (jours relatifs) */
+    uint16_t count;                /**< Échantillons acceptés */
+} bmu_rul_reg_t;
+
+/** @brief Ajuste a, b sur les sommes courantes. false si mal conditionné. */
+static inline bool bmu_rul_reg_fit(const bmu_rul_reg_t *r, float *a, float *b)
+{
+    if (r->count < 2 || r->n <= 0.0) return false;
+    double det = r->n * r->stt - r->st * r->st;
+    /* Étendue temporelle trop faible devant n : pente non définie */
+    if (det <= 1e-6 * r->n * r->n) return false;
+    double slope = (r->n * r->sty - r->st * r->sy) / det;
+    *b = (float)slope;
+    *a = (float)((r->sy - slope * r->st) / r->n);
+    return true;
+}
+
+/**
+ * @brief Ajoute un point (t en jours epoch, y dans l'unité de la métrique).
+ *
+ * @param lambda      Facteur d'oubli par échantillon (1 = pas d'oubli)
+ * @param scale_floor σ minimal (bruit de quantification de la métrique)
+ */
+static inline void bmu_rul_reg_add(bmu_rul_reg_t *r, double t_days, float y,
+                                   float lambda, float scale_floor)
+{
+    if (isnan(y) || isnan(t_days)) return;
+    if (r->count == 0) {
+        r->t_ref_days = t_days;
+        r->t_first = 0.0f;
+        r->scale = scale_floor;
+    }
+    double t = t_days - r->t_ref_days;
+
+    float a, b;
+    if (r->count >= 3 && bmu_rul_reg_fit(r, &a, &b)) {
+        float pred = a + b * (float)t;
+        float res = y - pred;
+        float lim = BMU_RUL_HUBER_K * r->scale;
+        if (res > lim)  res = lim;
+        if (res < -lim) res = -lim;
+        y = pred + res;
+        r->scale += BMU_RUL_SCALE_ALPHA * (1.4826f * fabsf(res) - r->scale);
+        if (r->scale < scale_floor) r->scale = scale_floor;
+    }
+
+    r->n   = lambda * r->n   + 1.0;
+    r->st  = lambda * r->st  + t;
+    r->sy  = lambda * r->sy  + y;
+    r->stt = lambda * r->stt + t * t;
+    r->sty = lambda * r->sty + t * y;
+    r->t_last = (float)t;
+    if (r->count < UINT16_MAX) r->count++;
+}
+
+/**
+ * @brief Jours restants avant que la tendance atteigne le seuil de fin de vie.
+ *
+ * @param t_now_days Instant courant (jours epoch)
+ * @param eol        Seuil de fin de vie
+ * @param rising     true si la métrique croît en vieillissant (R_int),
+ *                   false si elle décroît (SOH, capacité)
+ * @param min_points Échantillons minimum
+ * @param min_span   Étendue temporelle minimum (jours)
+ * @return jours (0 si seuil déjà franchi), BMU_RUL_DAYS_UNKNOWN si pas de
+ *         tendance exploitable ou pente s'éloignant du seuil
+ */
+static inline float bmu_rul_reg_days_to(const bmu_rul_reg_t *r, double t_now_days,
+                                        float eol, bool rising,
+                                        uint16_t min_points, float min_span)
+{
+    if (r->count < min_points) return BMU_RUL_DAYS_UNKNOWN;
+    if (r->t_last - r->t_first < min_span) return BMU_RUL_DAYS_UNKNOWN;
+    float a, b;
+    if (!bmu_rul_reg_fit(r, &a, &b)) return BMU_RUL_DAYS_UNKNOWN;
+
+    float y_now = a + b * (float)(t_now_days - r->t_ref_days);
+    if (rising ? (y_now >= eol) : (y_now <= eol)) return 0.0f;
+    if (rising ? (b <= 0.0f) : (b >= 0.0f)) return BMU_RUL_DAYS_UNKNOWN;
+    return (eol - y_now) / b;
+}
+
+/** @brief Pente courante (unité/jour), NAN si indisponible. */
+static inline float bmu_rul_reg_slope(const bmu_rul_reg_t *r)
+{
+    float a, b;
+    return bmu_rul_reg_fit(r, &a, &b) ? b : NAN;
+}
+
+/* ── Estimation de capacité : ΔAh net / ΔSOC entre deux ancres ──────── */
+
+/* Le SOC des ancres doit être indépendant de la capacité : le SOC de
+ * l'EKF (bmu_soc) intègre le courant sur capacité nominale × SOH, ΔAh/ΔSOC
+ * le renverrait (mesure circulaire). Les ancres sont donc prises au repos,
+ * SOC lu sur la table OCV. */
+
+typedef struct {
+    double throughput_ah;   /**< Débit Ah (charge + décharge) au dernier échantillon */
+    bool   valid;
+} bmu_rul_rest_t;
+
+/**
+ * @brief true si la batterie est restée au repos depuis l'échantillon
+ *        précédent : courant actuel sous max_a et débit accru de moins de
+ *        max_ah sur l'intervalle. Sa tension est alors l'OCV.
+ */
+static inline bool bmu_rul_rest_check(bmu_rul_rest_t *r, double throughput_ah,
+                                      float i_a, float max_a, float max_ah)
+{
+    if (isnan(i_a) || isnan(throughput_ah)) return false;
+    bool rested = r->valid && fabsf(i_a) < max_a &&
+                  throughput_ah - r->throughput_ah < (double)max_ah;
+    r->throughput_ah = throughput_ah;
+    r->valid = true;
+    return rested;
+}
+
+typedef struct {
+    float ah_net;       /**< Ah charge - Ah décharge à l'ancre */
+    float soc;          /**< SOC (0..1) à l'ancre */
+    bool  valid;
+} bmu_rul_cap_anchor_t;
+
+/**
+ * @brief Capacité mesurée quand le SOC a varié d'au moins min_dsoc depuis
+ *        l'ancre. L'ancre est alors déplacée sur le point courant.
+ * @return true si *cap_ah a été produit
+ */
+static inline bool bmu_rul_capacity_sample(bmu_rul_cap_anchor_t *an,
+                                           float ah_net, float soc,
+                                           float min_dsoc, float *cap_ah)
+{
+    if (isnan(ah_net) || isnan(soc) || soc < 0.0f) return false;
+    if (!an->valid) {
+        an->ah_net = ah_net;
+        an->soc = soc;
+        an->valid = true;
+        return false;
+    }
+    float dsoc = soc - an->soc;
+    if (fabsf(dsoc) < min_dsoc) return false;
+    float dah = ah_net - an->ah_net;
+    bool ok = (dah > 0.0f) == (dsoc > 0.0f) && dah != 0.0f;
+    if (ok) *cap_ah = dah / dsoc;
+    an->ah_net = ah_net;
+    an->soc = soc;
+    return ok;
+}
+
+/* ── État complet d'une batterie (persisté tel quel) ──────────────── */
+
+typedef struct {
+    bmu_rul_reg_t        rint;          /**< R_ohmic (mΩ) */
+    bmu_rul_reg_t        soh;           /**< SOH (%) */
+    bmu_rul_reg_t        cap;           /**< Capacité mesurée (Ah) */
+    float                rint_baseline; /**< R_int neuf (moyenne des premiers points), 0 = pas encore */
+    bmu_rul_cap_anchor_t anchor;        /**< Ancre ΔAh / ΔSOC (SOC OCV au repos) */
+    bmu_rul_rest_t       rest;
+    int64_t              last_rint_ts;  /**< Horodatage de la dernière mesure R_int intégrée */
+} bmu_rul_battery_t;
+
+#ifdef __cplusplus
+}
+#endif
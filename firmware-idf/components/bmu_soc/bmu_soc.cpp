@@ -0,0 +1,189 @@
+/**
+ * bmu_soc — Estimation d'état de charge par batterie (EKF 1 état).
+ * Consomme les snapshots de la protection ; R0 vient de bmu_rint quand
+ * une mesure valide existe, la capacité effective est pondérée par le SOH.
+ */
+
+#include "bmu_soc.h"
+#include "bmu_soc_ekf.h"
+#include "bmu_types.h"
+#include "esp_log.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "SOC";
+
+#if !CONFIG_BMU_SOC_ENABLED
+
+esp_err_t bmu_soc_init(const bmu_soc_config_t *) { return ESP_OK; }
+esp_err_t bmu_soc_start_task(UBaseType_t, uint32_t) { return ESP_OK; }
+float bmu_soc_get(int) { return -1.0f; }
+float bmu_soc_get_sigma(int) { return -1.0f; }
+bool bmu_soc_get_all(float *soc_pct, float *sigma_pct, uint8_t n)
+{
+    for (uint8_t i = 0; i < n && i < BMU_MAX_BATTERIES; i++) {
+        soc_pct[i] = -1.0f;
+        sigma_pct[i] = -1.0f;
+    }
+    return true;
+}
+float bmu_soc_get_fleet(void) { return -1.0f; }
+float bmu_soc_from_rest_mv(float) { return -1.0f; }
+
+#else
+
+#include "bmu_rint.h"
+#include "bmu_soh.h"
+#include "bmu_balancer.h"
+
+#if CONFIG_BMU_SOC_CHEM_LFP
+static const bmu_soc_ocv_table_t s_ocv = BMU_SOC_OCV_LFP;
+#define SOC_CHEM_NAME "LFP"
+#else
+static const bmu_soc_ocv_table_t s_ocv = BMU_SOC_OCV_NMC;
+#define SOC_CHEM_NAME "NMC"
+#endif
+
+static bmu_soc_config_t s_cfg;
+static SemaphoreHandle_t s_mutex = NULL;
+static bmu_soc_ekf_t s_ekf[BMU_MAX_BATTERIES];
+
+esp_err_t bmu_soc_init(const bmu_soc_config_t *cfg)
+{
+    if (!cfg) return ESP_ERR_INVALID_ARG;
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) return ESP_ERR_NO_MEM;
+
+    s_cfg = *cfg;
+    for (int i = 0; i < BMU_MAX_BATTERIES; i++) {
+        s_ekf[i] = {};
+    }
+    ESP_LOGI(TAG, "Init OK — " SOC_CHEM_NAME " %dS, Q=%d mAh, R0 defaut=%d mOhm",
+             CONFIG_BMU_SOC_CELLS_SERIES, CONFIG_BMU_SOC_CAPACITY_MAH,
+             CONFIG_BMU_SOC_R0_DEFAULT_MOHM);
+    return ESP_OK;
+}
+
+/* Paramètres par batterie : R0 mesuré et capacité dégradée par le SOH */
+static void fill_params(int idx, bmu_soc_ekf_params_t *prm)
+{
+    prm->ocv            = &s_ocv;
+    prm->cells_series   = CONFIG_BMU_SOC_CELLS_SERIES;
+    prm->capacity_ah    = (float)CONFIG_BMU_SOC_CAPACITY_MAH / 1000.0f;
+    prm->r0_mohm        = (float)CONFIG_BMU_SOC_R0_DEFAULT_MOHM;
+    prm->q_per_s        = (float)CONFIG_BMU_SOC_PROCESS_NOISE_E9 * 1e-9f;
+    prm->r_load_mv2     = (float)CONFIG_BMU_SOC_SIGMA_V_LOAD_MV * CONFIG_BMU_SOC_SIGMA_V_LOAD_MV;
+    prm->r_rest_mv2     = (float)CONFIG_BMU_SOC_SIGMA_V_REST_MV * CONFIG_BMU_SOC_SIGMA_V_REST_MV;
+    prm->rest_current_a = 0.2f;
+
+    bmu_rint_result_t r = bmu_rint_get_cached((uint8_t)idx);
+    if (r.valid && r.r_ohmic_mohm > 0.0f) prm->r0_mohm = r.r_ohmic_mohm;
+
+    float soh = bmu_soh_get_cached(idx);
+    if (soh > 0.1f && soh <= 1.0f) prm->capacity_ah *= soh;
+}
+
+static void soc_task(void *arg)
+{
+    ESP_LOGI(TAG, "SOC task started");
+    uint32_t log_counter = 0;
+
+    while (true) {
+        bmu_snapshot_t snap;
+        if (xQueueReceive(s_cfg.q_snapshot, &snap, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        int nb = snap.nb_batteries;
+        if (nb > BMU_MAX_BATTERIES) nb = BMU_MAX_BATTERIES;
+
+        if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(20)) != pdTRUE) continue;
+        for (int i = 0; i < nb; i++) {
+            const auto &b = snap.battery[i];
+            bmu_soc_ekf_params_t prm;
+            fill_params(i, &prm);
+
+            bool online = (b.state == BMU_STATE_CONNECTED ||
+                           b.state == BMU_STATE_RECONNECTING) &&
+                          !bmu_balancer_is_off((uint8_t)i);
+            bool meas_valid = b.state != BMU_STATE_ERROR && b.voltage_mv > 1000.0f;
+            /* Hors ligne : pas de courant de branche, la tension lue est l'OCV */
+            float i_a = online ? b.current_a : 0.0f;
+            bmu_soc_ekf_step(&s_ekf[i], &prm, b.voltage_mv, i_a,
+                             snap.timestamp_ms, meas_valid);
+        }
+        xSemaphoreGive(s_mutex);
+
+        if (++log_counter >= 300 && nb > 0) {   /* ~60 s à 5 Hz */
+            log_counter = 0;
+            ESP_LOGI(TAG, "SOC flotte %.1f%%", bmu_soc_get_fleet());
+        }
+    }
+}
+
+esp_err_t bmu_soc_start_task(UBaseType_t priority, uint32_t stack_size)
+{
+    BaseType_t ret = xTaskCreate(soc_task, "soc", stack_size, NULL, priority, NULL);
+    return (ret == pdPASS) ? ESP_OK : ESP_FAIL;
+}
+
+float bmu_soc_get(int idx)
+{
+    if (idx < 0 || idx >= BMU_MAX_BATTERIES || !s_mutex) return -1.0f;
+    float v = -1.0f;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        if (s_ekf[idx].initialized) v = s_ekf[idx].soc * 100.0f;
+        xSemaphoreGive(s_mutex);
+    }
+    return v;
+}
+
+float bmu_soc_get_sigma(int idx)
+{
+    if (idx < 0 || idx >= BMU_MAX_BATTERIES || !s_mutex) return -1.0f;
+    float v = -1.0f;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        if (s_ekf[idx].initialized) v = sqrtf(s_ekf[idx].p) * 100.0f;
+        xSemaphoreGive(s_mutex);
+    }
+    return v;
+}
+
+bool bmu_soc_get_all(float *soc_pct, float *sigma_pct, uint8_t n)
+{
+    if (!s_mutex) return false;
+    if (n > BMU_MAX_BATTERIES) n = BMU_MAX_BATTERIES;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(20)) != pdTRUE) return false;
+    for (uint8_t i = 0; i < n; i++) {
+        bool ok = s_ekf[i].initialized;
+        soc_pct[i]   = ok ? s_ekf[i].soc * 100.0f : -1.0f;
+        sigma_pct[i] = ok ? sqrtf(s_ekf[i].p) * 100.0f : -1.0f;
+    }
+    xSemaphoreGive(s_mutex);
+    return true;
+}
+
+float bmu_soc_get_fleet(void)
+{
+    if (!s_mutex) return -1.0f;
+    float sum = 0.0f;
+    int n = 0;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        for (int i = 0; i < BMU_MAX_BATTERIES; i++) {
+            if (!s_ekf[i].initialized) continue;
+            sum += s_ekf[i].soc;
+            n++;
+        }
+        xSemaphoreGive(s_mutex);
+    }
+    return n > 0 ? sum / (float)n * 100.0f : -1.0f;
+}
+
+float bmu_soc_from_rest_mv(float v_mv)
+{
+    if (isnan(v_mv) || v_mv <= 1000.0f) return -1.0f;
+    bmu_soc_ekf_params_t prm = {};
+    prm.ocv          = &s_ocv;
+    prm.cells_series = CONFIG_BMU_SOC_CELLS_SERIES;
+    return bmu_soc_from_ocv(&prm, v_mv) * 100.0f;
+}
+
+#endif
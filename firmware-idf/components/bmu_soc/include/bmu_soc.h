@@ -0,0 +1,42 @@
+#pragma once
+
+#include "bmu_types.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    QueueHandle_t q_snapshot;  // input: snapshot from protection (5 Hz)
+} bmu_soc_config_t;
+
+esp_err_t bmu_soc_init(const bmu_soc_config_t *cfg);
+esp_err_t bmu_soc_start_task(UBaseType_t priority, uint32_t stack_size);
+
+/** SOC batterie en % (0..100), -1 si pas encore estimé ou désactivé. */
+float bmu_soc_get(int idx);
+
+/** Écart-type d'estimation en % (racine de P), -1 si indisponible. */
+float bmu_soc_get_sigma(int idx);
+
+/**
+ * SOC et écart-type des n premières batteries sous un seul verrou
+ * (notifications BLE), mêmes valeurs que bmu_soc_get / bmu_soc_get_sigma.
+ * Verrou indisponible : sorties inchangées, retourne false.
+ */
+bool bmu_soc_get_all(float *soc_pct, float *sigma_pct, uint8_t n);
+
+/** SOC moyen des batteries estimées en %, -1 si aucune. */
+float bmu_soc_get_fleet(void);
+
+/**
+ * SOC en % lu sur la seule table OCV, -1 si désactivé. N'utilise ni la
+ * capacité ni le SOH (contrairement à bmu_soc_get) : valable uniquement
+ * batterie reposée, quand la tension mesurée est l'OCV.
+ */
+float bmu_soc_from_rest_mv(float v_mv);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file bmu_soc_ekf.h
+ * @brief EKF état de charge (SOC) mono-batterie — logique pure, float32.
+ *
+ * Modèle à un état x = SOC (0..1) :
+ *   Prédiction (coulomb counting) : x⁻ = x - I·dt / (3600·Q)
+ *   Mesure (Rint)                 : V = OCV(x) - I·R0
+ *   Jacobien                      : H = dOCV/dSOC (pente de la table OCV)
+ *
+ * Coût : ~30 flops par batterie et par cycle, aucune allocation — 32
+ * batteries à 5 Hz restent négligeables. Aucune dépendance ESP-IDF :
+ * inclus tel quel par test/test_soc_ekf.
+ *
+ * Convention de signe (identique protection) : I > 0 décharge.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_SOC_OCV_POINTS  11   /**< Table OCV par pas de 10 % SOC */
+
+/** OCV cellule (mV) à SOC = 0, 10, ..., 100 % */
+typedef struct {
+    float cell_mv[BMU_SOC_OCV_POINTS];
+} bmu_soc_ocv_table_t;
+
+/* Li-ion NMC — courbe repos typique 18650/21700 */
+#define BMU_SOC_OCV_NMC { { 3000.0f, 3450.0f, 3550.0f, 3610.0f, 3660.0f, 3720.0f, \
+                            3800.0f, 3890.0f, 3980.0f, 4080.0f, 4190.0f } }
+/* LiFePO4 — plateau plat 20..90 % : la correction OCV y est faible, le
+ * coulomb counting domine (comportement voulu de l'EKF) */
+#define BMU_SOC_OCV_LFP { { 2800.0f, 3200.0f, 3250.0f, 3280.0f, 3300.0f, 3310.0f, \
+                            3320.0f, 3330.0f, 3340.0f, 3370.0f, 3550.0f } }
+
+typedef struct {
+    const bmu_soc_ocv_table_t *ocv;
+    uint8_t cells_series;       /**< Cellules en série par pack */
+    float   capacity_ah;        /**< Capacité effective (nominale × SOH) */
+    float   r0_mohm;            /**< Résistance interne pack (bmu_rint ou défaut) */
+    float   q_per_s;            /**< Bruit process (SOC²/s) */
+    float   r_load_mv2;         /**< Bruit mesure sous charge (mV²) */
+    float   r_rest_mv2;         /**< Bruit mesure au repos (mV²), OCV fiable */
+    float   rest_current_a;     /**< |I| sous lequel la batterie est au repos */
+} bmu_soc_ekf_params_t;
+
+typedef struct {
+    float    soc;               /**< Estimation 0..1 */
+    float    p;                 /**< Variance d'estimation (SOC²) */
+    uint32_t last_ms;           /**< Horodatage du dernier pas */
+    bool     initialized;
+} bmu_soc_ekf_t;
+
+/** @brief OCV pack (mV) pour un SOC 0..1 — interpolation linéaire. */
+static inline float bmu_soc_ocv_mv(const bmu_soc_ekf_params_t *prm, float soc)
+{
+    if (soc <= 0.0f) soc = 0.0f;
+    if (soc >= 1.0f) soc = 1.0f;
+    float pos = soc * (float)(BMU_SOC_OCV_POINTS - 1);
+    int k = (int)pos;
+    if (k >= BMU_SOC_OCV_POINTS - 1) k = BMU_SOC_OCV_POINTS - 2;
+    float f = pos - (float)k;
+    const float *t = prm->ocv->cell_mv;
+    return (t[k] + f * (t[k + 1] - t[k])) * (float)prm->cells_series;
+}
+
+/** @brief dOCV/dSOC pack (mV par unité de SOC) — pente du segment courant. */
+static inline float bmu_soc_ocv_slope(const bmu_soc_ekf_params_t *prm, float soc)
+{
+    if (soc < 0.0f) soc = 0.0f;
+    if (soc > 1.0f) soc = 1.0f;
+    int k = (int)(soc * (float)(BMU_SOC_OCV_POINTS - 1));
+    if (k >= BMU_SOC_OCV_POINTS - 1) k = BMU_SOC_OCV_POINTS - 2;
+    const float *t = prm->ocv->cell_mv;
+    return (t[k + 1] - t[k]) * (float)(BMU_SOC_OCV_POINTS - 1) * (float)prm->cells_series;
+}
+
+/** @brief Inverse de la table OCV (SOC 0..1 pour une OCV pack en mV). */
+static inline float bmu_soc_from_ocv(const bmu_soc_ekf_params_t *prm, float ocv_mv)
+{
+    const float *t = prm->ocv->cell_mv;
+    float cell = ocv_mv / (float)prm->cells_series;
+    if (cell <= t[0]) return 0.0f;
+    if (cell >= t[BMU_SOC_OCV_POINTS - 1]) return 1.0f;
+    for (int k = 0; k < BMU_SOC_OCV_POINTS - 1; k++) {
+        if (cell <= t[k + 1]) {
+            float f = (cell - t[k]) / (t[k + 1] - t[k]);
+            return ((float)k + f) / (float)(BMU_SOC_OCV_POINTS - 1);
+        }
+    }
+    return 1.0f;
+}
+
+/**
+ * @brief Un pas EKF (prédiction + correction) sur un échantillon V/I.
+ *
+ * Premier appel : initialisation depuis l'OCV compensée (V + I·R0),
+ * variance large si la batterie est sous charge.
+ *
+ * @param meas_valid false → prédiction seule (batterie hors ligne / lecture
+ *                   périmée) : le SOC suit le coulomb counting, P grandit.
+ */
+static inline void bmu_soc_ekf_step(bmu_soc_ekf_t *e,
+                                    const bmu_soc_ekf_params_t *prm,
+                                    float v_mv, float i_a,
+                                    uint32_t now_ms, bool meas_valid)
+{
+    bool rest = fabsf(i_a) < prm->rest_current_a;
+
+    if (!e->initialized) {
+        if (!meas_valid || isnan(v_mv) || isnan(i_a)) return;
+        e->soc = bmu_soc_from_ocv(prm, v_mv + i_a * prm->r0_mohm);
+        e->p = rest ? 0.01f : 0.04f;
+        e->last_ms = now_ms;
+        e->initialized = true;
+        return;
+    }
+
+    float dt_s = (float)(uint32_t)(now_ms - e->last_ms) / 1000.0f;
+    e->last_ms = now_ms;
+    if (dt_s <= 0.0f || dt_s > 3600.0f) return;
+    if (isnan(i_a)) i_a = 0.0f;
+
+    /* ── Prédiction : coulomb counting ── */
+    if (prm->capacity_ah > 0.0f) {
+        e->soc -= i_a * dt_s / (3600.0f * prm->capacity_ah);
+    }
+    e->p += prm->q_per_s * dt_s;
+
+    /* ── Correction : V = OCV(soc) - I·R0 ── */
+    if (meas_valid && !isnan(v_mv)) {
+        float h = bmu_soc_ocv_slope(prm, e->soc);
+        float v_pred = bmu_soc_ocv_mv(prm, e->soc) - i_a * prm->r0_mohm;
+        float r = rest ? prm->r_rest_mv2 : prm->r_load_mv2;
+        float s = h * h * e->p + r;
+        if (s > 0.0f) {
+            float k = e->p * h / s;
+            e->soc += k * (v_mv - v_pred);
+            e->p *= (1.0f - k * h);
+        }
+    }
+
+    if (e->soc < 0.0f) e->soc = 0.0f;
+    if (e->soc > 1.0f) e->soc = 1.0f;
+    if (e->p < 1e-7f) e->p = 1e-7f;
+    if (e->p > 1.0f)  e->p = 1.0f;
+}
+
+#ifdef __cplusplus
+}
+#endif
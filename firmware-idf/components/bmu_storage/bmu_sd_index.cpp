@@ -0,0 +1,302 @@
+/**
+ * bmu_sd_index — Index temporel et requêtes du journal SD (voir bmu_sd_index.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_sd_index). Les entrées
+ * .idx sont en little-endian natif (ESP32 et host x86/ARM).
+ */
+
+#include "bmu_sd_index.h"
+
+#include <cstring>
+
+void bmu_sd_idx_builder_reset(bmu_sd_idx_builder_t *b, uint32_t bucket_s)
+{
+    b->bucket_s = bucket_s ? bucket_s : 1;
+    b->last_bucket = 0;
+    b->have = false;
+}
+
+bool bmu_sd_idx_feed(bmu_sd_idx_builder_t *b, int64_t t_ms, uint32_t offset,
+                     bmu_sd_idx_entry_t *out)
+{
+    if (t_ms <= 0) return false;
+    uint32_t t_s = (uint32_t)(t_ms / 1000);
+    uint32_t bucket = t_s / b->bucket_s;
+    if (b->have && bucket <= b->last_bucket) return false;
+    b->have = true;
+    b->last_bucket = bucket;
+    out->t_s = t_s;
+    out->offset = offset;
+    return true;
+}
+
+/* Entier décimal non signé en tête de p[0..len), -1 si absent */
+static int64_t parse_u64(const char *p, size_t len, size_t *used)
+{
+    int64_t v = 0;
+    size_t i = 0;
+    while (i < len && p[i] >= '0' && p[i] <= '9' && i < 19) {
+        v = v * 10 + (p[i] - '0');
+        i++;
+    }
+    *used = i;
+    return i ? v : -1;
+}
+
+int64_t bmu_sd_row_time(const char *row, size_t len)
+{
+    size_t used;
+    int64_t t = parse_u64(row, len, &used);
+    if (t <= 0 || used == len || row[used] != ',') return -1;
+    return t;
+}
+
+bool bmu_sd_row_match(const bmu_sd_query_t *q, const char *row, size_t len)
+{
+    int64_t t = bmu_sd_row_time(row, len);
+    if (t < 0 || t < q->from_ms || t > q->to_ms) return false;
+    if (q->key == 0) return true;
+
+    /* Colonne BMU_SD_COL_KEY */
+    size_t i = 0;
+    for (int col = 0; col < BMU_SD_COL_KEY; col++) {
+        const char *c = (const char *)memchr(row + i, ',', len - i);
+        if (c == nullptr) return false;
+        i = (size_t)(c - row) + 1;
+    }
+    size_t used;
+    int64_t key = parse_u64(row + i, len - i, &used);
+    return key == (int64_t)q->key && (i + used == len || row[i + used] == ',');
+}
+
+static bool read_entry(FILE *idx, long i, bmu_sd_idx_entry_t *e)
+{
+    return fseek(idx, i * (long)sizeof(*e), SEEK_SET) == 0 &&
+           fread(e, sizeof(*e), 1, idx) == 1;
+}
+
+uint32_t bmu_sd_idx_find(FILE *idx, int64_t t_ms, uint32_t *first_t_s)
+{
+    if (first_t_s) *first_t_s = UINT32_MAX;
+    if (idx == nullptr || fseek(idx, 0, SEEK_END) != 0) return 0;
+    long n = ftell(idx) / (long)sizeof(bmu_sd_idx_entry_t);
+    bmu_sd_idx_entry_t e;
+    if (n <= 0 || !read_entry(idx, 0, &e)) return 0;
+    if (first_t_s) *first_t_s = e.t_s;
+
+    uint32_t target = t_ms <= 0 ? 0 : (uint32_t)(t_ms / 1000);
+    if (e.t_s > target) return 0;               /* plage avant la première tranche */
+
+    /* Invariant : entrée lo <= target, entrée hi > target (hi = n : fin) */
+    long lo = 0, hi = n;
+    uint32_t off = e.offset;
+    while (hi - lo > 1) {
+        long mid = lo + (hi - lo) / 2;
+        if (!read_entry(idx, mid, &e)) break;
+        if (e.t_s <= target) {
+            lo = mid;
+            off = e.offset;
+        } else {
+            hi = mid;
+        }
+    }
+    return off;
+}
+
+bool bmu_sd_stream_rows(FILE *csv, uint32_t start, uint32_t end,
+                        const bmu_sd_query_t *q, char *buf, size_t buf_size,
+                        bmu_sd_row_fn_t fn, void *arg, uint32_t *rows)
+{
+    if (csv == nullptr || fseek(csv, (long)start, SEEK_SET) != 0) return true;
+    uint32_t pos = start;
+    size_t carry = 0;
+    for (;;) {
+        size_t want = buf_size - carry;
+        if (end > 0) {
+            if (pos >= end) break;
+            if (want > end - pos) want = end - pos;
+        }
+        size_t n = fread(buf + carry, 1, want, csv);
+        if (n == 0) break;
+        pos += (uint32_t)n;
+        n += carry;
+
+        size_t i = 0;
+        for (;;) {
+            const char *nl = (const char *)memchr(buf + i, '\n', n - i);
+            if (nl == nullptr) break;
+            size_t len = (size_t)(nl - (buf + i));
+            const char *row = buf + i;
+            if (len > 0 && row[len - 1] == '\r') len--;
+            i = (size_t)(nl - buf) + 1;
+
+            int64_t t = bmu_sd_row_time(row, len);
+            if (t > q->to_ms) return false;     /* lignes triées : plage dépassée */
+            if (bmu_sd_row_match(q, row, len)) {
+                if (rows) (*rows)++;
+                if (!fn(row, len, arg)) return false;
+            }
+        }
+        carry = n - i;
+        if (carry == buf_size) carry = 0;       /* ligne plus longue que le bloc : ignorée */
+        memmove(buf, buf + i, carry);
+    }
+    return true;
+}
+
+/* Une tranche [start, stop) en échantillonné : lecture par blocs, premier
+ * snapshot (lignes au même utc_ms) à chaque échéance de la grille. Rendu
+ * dès que l'échéance suivante tombe au-delà de until_s (tranche suivante).
+ * false : fin de plage dépassée ou arrêt demandé par fn. */
+static bool sample_slice(FILE *csv, uint32_t start, uint32_t stop, uint32_t until_s,
+                         const bmu_sd_query_t *q, uint32_t step, uint32_t *next_s,
+                         char *buf, size_t buf_size,
+                         bmu_sd_row_fn_t fn, void *arg, uint32_t *rows)
+{
+    if (fseek(csv, (long)start, SEEK_SET) != 0) return true;
+    uint32_t pos = start;
+    size_t carry = 0;
+    int64_t snap = -1;
+    for (;;) {
+        size_t want = buf_size - carry;
+        if (stop > 0) {
+            if (pos >= stop) break;
+            if (want > stop - pos) want = stop - pos;
+        }
+        size_t n = fread(buf + carry, 1, want, csv);
+        if (n == 0) break;
+        pos += (uint32_t)n;
+        n += carry;
+
+        size_t i = 0;
+        for (;;) {
+            const char *nl = (const char *)memchr(buf + i, '\n', n - i);
+            if (nl == nullptr) break;
+            size_t len = (size_t)(nl - (buf + i));
+            const char *row = buf + i;
+            if (len > 0 && row[len - 1] == '\r') len--;
+            i = (size_t)(nl - buf) + 1;
+
+            int64_t t = bmu_sd_row_time(row, len);
+            if (t < 0) continue;
+            if (t > q->to_ms) return false;
+            if (t != snap) {
+                if (snap >= 0 && *next_s >= until_s) return true;
+                if (t / 1000 < *next_s) continue;
+                snap = t;
+                *next_s = ((uint32_t)(t / 1000) / step + 1) * step;
+            }
+            if (bmu_sd_row_match(q, row, len)) {
+                if (rows) (*rows)++;
+                if (!fn(row, len, arg)) return false;
+            }
+        }
+        carry = n - i;
+        if (carry == buf_size) carry = 0;
+        memmove(buf, buf + i, carry);
+    }
+    return true;
+}
+
+bool bmu_sd_stream_sampled(FILE *csv, FILE *idx, uint32_t end,
+                           const bmu_sd_query_t *q, uint32_t *next_s,
+                           char *buf, size_t buf_size,
+                           bmu_sd_row_fn_t fn, void *arg, uint32_t *rows)
+{
+    if (csv == nullptr) return true;
+    const uint32_t step = q->step_s ? q->step_s : 1;
+    bmu_sd_idx_entry_t e, nx;
+    bool have = idx != nullptr && fseek(idx, 0, SEEK_SET) == 0 &&
+                fread(&e, sizeof(e), 1, idx) == 1;
+    if (!have) {
+        /* .idx absent ou vide (perdu, coupure avant la première entrée) :
+         * parcours linéaire du segment entier, une seule tranche */
+        return sample_slice(csv, 0, end, UINT32_MAX, q, step, next_s,
+                            buf, buf_size, fn, arg, rows);
+    }
+    while (have) {
+        bool have_nx = fread(&nx, sizeof(nx), 1, idx) == 1;
+        if ((int64_t)e.t_s * 1000 > q->to_ms) return false;
+        if (end > 0 && e.offset >= end) return true;
+
+        /* Tranche sans échéance (pas >= tranche) : sautée sans lecture */
+        uint32_t until_s = have_nx ? nx.t_s : UINT32_MAX;
+        uint32_t stop = have_nx ? nx.offset : end;
+        if (end > 0 && stop > end) stop = end;
+        if (until_s > *next_s &&
+            !sample_slice(csv, e.offset, stop, until_s, q, step, next_s,
+                          buf, buf_size, fn, arg, rows)) {
+            return false;
+        }
+        e = nx;
+        have = have_nx;
+    }
+    return true;
+}
+
+void bmu_sd_seg_path(char *buf, size_t len, const char *dir, uint32_t seq, const char *ext)
+{
+    snprintf(buf, len, "%s/%08lu.%s", dir, (unsigned long)seq, ext);
+}
+
+/* t_s de la première entrée d'index du segment, UINT32_MAX si aucune */
+static uint32_t seg_first_t(const char *dir, uint32_t seq)
+{
+    char path[BMU_SD_PATH_MAX];
+    bmu_sd_seg_path(path, sizeof(path), dir, seq, "idx");
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) return UINT32_MAX;
+    bmu_sd_idx_entry_t e;
+    uint32_t t = (fread(&e, sizeof(e), 1, f) == 1) ? e.t_s : UINT32_MAX;
+    fclose(f);
+    return t;
+}
+
+void bmu_sd_query_segments(const char *dir, uint32_t first, uint32_t cur, uint32_t cur_end,
+                           const bmu_sd_query_t *q, char *buf, size_t buf_size,
+                           bmu_sd_row_fn_t fn, void *arg, uint32_t *rows)
+{
+    /* Dichotomie sur les segments : dernier dont la première tranche est
+     * <= from (les segments sans index sont sautés ici, puis parcourus
+     * linéairement s'ils tombent dans la plage) */
+    uint32_t target = (uint32_t)(q->from_ms / 1000);
+    uint32_t start = first, lo = first, hi = cur;
+    while (lo <= hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t probe = mid, t = UINT32_MAX;
+        while (probe <= hi && (t = seg_first_t(dir, probe)) == UINT32_MAX) probe++;
+        if (probe > hi || t > target) {
+            if (mid == 0) break;
+            hi = mid - 1;
+        } else {
+            start = probe;
+            lo = probe + 1;
+        }
+    }
+
+    uint32_t next_s = q->from_ms <= 0 ? 0 : (uint32_t)((q->from_ms + 999) / 1000);
+    for (uint32_t seq = start; seq <= cur; seq++) {
+        char path[BMU_SD_PATH_MAX];
+        bmu_sd_seg_path(path, sizeof(path), dir, seq, "idx");
+        FILE *idx = fopen(path, "rb");
+        uint32_t first_t = UINT32_MAX;
+        uint32_t off = bmu_sd_idx_find(idx, q->from_ms, &first_t);
+        if (first_t != UINT32_MAX && (int64_t)first_t * 1000 > q->to_ms) {
+            fclose(idx);
+            break;
+        }
+
+        bmu_sd_seg_path(path, sizeof(path), dir, seq, "csv");
+        FILE *f = fopen(path, "rb");
+        uint32_t end = seq == cur ? cur_end : 0;
+        bool more = true;
+        if (f != nullptr) {                    /* NULL : supprimé par le budget entre-temps */
+            /* Échantillonné : index gardé ouvert, parcouru tranche par tranche */
+            more = q->step_s ? bmu_sd_stream_sampled(f, idx, end, q, &next_s, buf, buf_size, fn, arg, rows)
+                             : bmu_sd_stream_rows(f, off, end, q, buf, buf_size, fn, arg, rows);
+            fclose(f);
+        }
+        if (idx) fclose(idx);
+        if (!more) break;
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * bmu_sd_ring — Anneau MPSC sans verrou du journal SD (voir bmu_sd_ring.h).
+ *
+ * Séquence du slot i : i = libre pour la position i, pos + 1 = rempli pour
+ * la position pos, pos + nb_slots = libéré pour le tour suivant. Les
+ * builtins __atomic (GCC, Xtensa et host) gardent la structure en C.
+ */
+
+#include "bmu_sd_ring.h"
+
+#include <cstring>
+
+bool bmu_sd_ring_init(bmu_sd_ring_t *r, bmu_sd_slot_t *slots, uint32_t nb_slots)
+{
+    if (r == nullptr || slots == nullptr || nb_slots < 2) return false;
+    uint32_t n = 1;
+    while (n * 2 <= nb_slots && n < 0x80000000u) n *= 2;
+    for (uint32_t i = 0; i < n; i++) {
+        __atomic_store_n(&slots[i].seq, i, __ATOMIC_RELAXED);
+        slots[i].len = 0;
+    }
+    r->slots = slots;
+    r->mask = n - 1;
+    r->tail = 0;
+    r->dropped = 0;
+    r->truncated = 0;
+    __atomic_store_n(&r->head, 0u, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool bmu_sd_ring_push(bmu_sd_ring_t *r, const char *line, size_t len)
+{
+    uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    bmu_sd_slot_t *s;
+    for (;;) {
+        s = &r->slots[pos & r->mask];
+        uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        int32_t dif = (int32_t)(seq - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            /* pos rechargé par le CAS */
+        } else if (dif < 0) {
+            __atomic_fetch_add(&r->dropped, 1u, __ATOMIC_RELAXED);
+            return false;                       /* plein : le consommateur n'a pas libéré */
+        } else {
+            pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (len > BMU_SD_LINE_MAX - 1) {
+        len = BMU_SD_LINE_MAX - 1;
+        __atomic_fetch_add(&r->truncated, 1u, __ATOMIC_RELAXED);
+    }
+    memcpy(s->text, line, len);
+    s->text[len] = '\n';
+    s->len = (uint16_t)(len + 1);
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+size_t bmu_sd_ring_drain(bmu_sd_ring_t *r, char *out, size_t cap)
+{
+    size_t n = 0;
+    for (;;) {
+        bmu_sd_slot_t *s = &r->slots[r->tail & r->mask];
+        uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (seq != r->tail + 1) break;          /* vide, ou slot en cours d'écriture */
+        if (n + s->len > cap) break;
+        memcpy(out + n, s->text, s->len);
+        n += s->len;
+        __atomic_store_n(&s->seq, r->tail + r->mask + 1, __ATOMIC_RELEASE);
+        r->tail++;
+    }
+    return n;
+}
+
+uint32_t bmu_sd_ring_pending(const bmu_sd_ring_t *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_RELAXED) - r->tail;
+}
+
+uint32_t bmu_sd_ring_dropped(const bmu_sd_ring_t *r)
+{
+    return __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+}
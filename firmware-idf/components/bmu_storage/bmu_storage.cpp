@@ -1,22 +1,38 @@
 /**
  * bmu_storage.cpp — SD card logger (SPI on PMOD2) + NVS credentials
  *
- * SD : FAT32 via SPI bus, fichier CSV append-only
+ * SD : FAT32 via SPI bus, journal CSV en segments (anneau sans verrou →
+ *      tâche d'écriture, secteurs de 4 KB alignés, rotation taille / jour),
+ *      index temporel par segment pour les requêtes par plage
  * NVS : namespace "bmu" pour WiFi/MQTT credentials et config persistante
  */
 
 #include "bmu_storage.h"
+#include "bmu_sd_ring.h"
+#include "bmu_sd_index.h"
 
 #include "driver/sdspi_host.h"
 #include "driver/spi_common.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_vfs_fat.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "sdmmc_cmd.h"
 
+#include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <ctime>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
 
 /* ── SD Card ─────────────────────────────────────────────────────────── */
 
@@ -89,96 +105,432 @@ bool bmu_sd_is_mounted(void)
     return s_sd_mounted;
 }
 
-esp_err_t bmu_sd_log_line(const char *line)
+/* ── Journal SD ──────────────────────────────────────────────────────── */
+
+#if CONFIG_BMU_SD_LOG_ENABLED
+
+static constexpr size_t  LOG_SECTOR     = 4096;
+static constexpr size_t  LOG_STAGE_MAX  = (size_t)CONFIG_BMU_SD_LOG_STAGE_KB * 1024;
+static constexpr size_t  LOG_SEG_MAX    = (size_t)CONFIG_BMU_SD_LOG_SEG_KB * 1024;
+static constexpr size_t  LOG_SYNC_BYTES = (size_t)CONFIG_BMU_SD_LOG_SYNC_KB * 1024;
+static constexpr int64_t LOG_SYNC_US    = (int64_t)CONFIG_BMU_SD_LOG_SYNC_MS * 1000;
+static constexpr int64_t LOG_RETRY_US   = 5 * 1000 * 1000;   /* réouverture après échec */
+static constexpr uint32_t LOG_POLL_MS   = 200;
+
+static bmu_sd_ring_t s_ring;
+static bool s_ring_ready = false;
+static TaskHandle_t s_log_task = NULL;
+static SemaphoreHandle_t s_log_mutex = NULL;   /* fichier + staging : tâche vs lecture */
+static char *s_log_header = NULL;
+
+/* Segment courant, ouvert en continu ; staging PSRAM écrit par secteurs */
+static FILE    *s_log_file = nullptr;
+static char    *s_log_stage = NULL;
+static size_t   s_log_stage_len = 0;
+static size_t   s_log_off = 0;                 /* Octets du segment sur disque */
+static size_t   s_log_unsynced = 0;
+static int64_t  s_log_dirty_us = 0;
+static int64_t  s_log_retry_us = 0;
+static int      s_log_day = -1;                /* Jour local du segment, -1 = heure invalide */
+static uint32_t s_log_first_seq = 1;
+static uint32_t s_log_cur_seq = 0;             /* 0 = aucun segment ouvert depuis le boot */
+
+/* Index du segment courant : entrées en attente, écrites après le fsync des
+ * données qu'elles désignent */
+static constexpr size_t LOG_IDX_PEND = 32;
+static bmu_sd_idx_builder_t s_idx_b;
+static bmu_sd_idx_entry_t s_idx_pend[LOG_IDX_PEND];
+static size_t s_idx_n = 0;
+
+static uint32_t s_log_lost = 0;                /* Lignes perdues après l'anneau */
+static uint32_t s_log_bytes = 0;
+static uint32_t s_log_errors = 0;
+static uint32_t s_log_deleted = 0;
+
+/* Noms 8.3 (FATFS sans LFN) */
+static void log_seg_path(char *buf, size_t len, uint32_t seq)
 {
-    if (line == nullptr) {
-        return ESP_ERR_INVALID_ARG;
+    bmu_sd_seg_path(buf, len, BMU_SD_LOG_DIR, seq, "csv");
+}
+
+static void log_idx_path(char *buf, size_t len, uint32_t seq)
+{
+    bmu_sd_seg_path(buf, len, BMU_SD_LOG_DIR, seq, "idx");
+}
+
+static void *log_alloc_psram(size_t size)
+{
+    void *p = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) p = calloc(1, size);  /* fallback DRAM */
+    return p;
+}
+
+/* Jour local (année × 1000 + jour de l'année), -1 tant que SNTP n'a pas répondu */
+static int log_local_day(void)
+{
+    time_t now = time(NULL);
+    if (now < 1700000000) return -1;
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    return tm_now.tm_year * 1000 + tm_now.tm_yday;
+}
+
+static uint32_t count_lines(const char *p, size_t n)
+{
+    uint32_t c = 0;
+    for (size_t i = 0; i < n; i++) c += (p[i] == '\n');
+    return c;
+}
+
+/* Chaque fwrite s'arrête sur une frontière de 4 KB du fichier : la carte
+ * reçoit des secteurs/clusters complets. all = false : la fin partielle
+ * reste en staging. */
+static bool log_stage_drain(bool all)
+{
+    size_t done = 0;
+    bool ok = true;
+    while (done < s_log_stage_len) {
+        size_t room = LOG_SECTOR - (s_log_off % LOG_SECTOR);
+        size_t n = s_log_stage_len - done;
+        if (n >= room) {
+            n = room;
+        } else if (!all) {
+            break;
+        }
+        if (s_log_file == nullptr || fwrite(s_log_stage + done, 1, n, s_log_file) != n) {
+            ok = false;
+            break;
+        }
+        done += n;
+        s_log_off += n;
+        s_log_bytes += n;
     }
-    esp_err_t ret = ensure_sd_mounted();
-    if (ret != ESP_OK) {
-        return ret;
+    memmove(s_log_stage, s_log_stage + done, s_log_stage_len - done);
+    s_log_stage_len -= done;
+    return ok;
+}
+
+/* Entrées d'index en attente → NNNNNNNN.idx. Un index perdu ne coûte
+ * qu'une requête plus lente (lecture depuis le début du segment). */
+static void log_idx_flush(void)
+{
+    if (s_idx_n == 0) return;
+    char path[40];
+    log_idx_path(path, sizeof(path), s_log_cur_seq);
+    FILE *f = fopen(path, "ab");
+    if (f == nullptr || fwrite(s_idx_pend, sizeof(s_idx_pend[0]), s_idx_n, f) != s_idx_n) {
+        ESP_LOGW(TAG_SD, "Index %s non écrit", path);
+        s_log_errors++;
     }
+    if (f) fclose(f);
+    s_idx_n = 0;
+}
 
-    FILE *f = fopen(BMU_SD_LOG_PATH, "a");
-    if (f == nullptr) {
-        ESP_LOGW(TAG_SD, "Impossible d'ouvrir %s en écriture", BMU_SD_LOG_PATH);
-        return ESP_FAIL;
+/* Lignes stage[from..s_log_stage_len) : première ligne horodatée de chaque
+ * tranche CONFIG_BMU_SD_LOG_INDEX_S → entrée d'index */
+static void log_idx_scan(size_t from)
+{
+    size_t i = from;
+    while (i < s_log_stage_len) {
+        const char *row = s_log_stage + i;
+        const char *nl = (const char *)memchr(row, '\n', s_log_stage_len - i);
+        if (nl == nullptr) break;
+        size_t len = (size_t)(nl - row);
+        bmu_sd_idx_entry_t e;
+        if (bmu_sd_idx_feed(&s_idx_b, bmu_sd_row_time(row, len),
+                            (uint32_t)(s_log_off + i), &e)) {
+            if (s_idx_n == LOG_IDX_PEND) log_idx_flush();
+            s_idx_pend[s_idx_n++] = e;
+        }
+        i += len + 1;
     }
+}
 
-    fprintf(f, "%s\n", line);
-    fclose(f);
-    return ESP_OK;
+static bool log_sync(void)
+{
+    if (s_log_file == nullptr) return true;
+    bool ok = log_stage_drain(true);
+    if (ok) ok = fflush(s_log_file) == 0 && fsync(fileno(s_log_file)) == 0;
+    s_log_unsynced = 0;
+    if (ok) log_idx_flush();
+    return ok;
 }
 
-esp_err_t bmu_sd_read_last_lines(char *buf, size_t buf_size, int max_lines)
+/* Écriture refusée (carte retirée, pleine) : staging perdu, segment fermé,
+ * réouverture d'un nouveau segment après LOG_RETRY_US */
+static void log_failed(void)
 {
-    if (buf == nullptr || buf_size == 0 || max_lines <= 0) {
-        return ESP_ERR_INVALID_ARG;
+    uint32_t lost = count_lines(s_log_stage, s_log_stage_len);
+    ESP_LOGW(TAG_SD, "Écriture journal %08lu échouée, %lu lignes perdues",
+             (unsigned long)s_log_cur_seq, (unsigned long)lost);
+    s_log_errors++;
+    s_log_lost += lost;
+    s_log_stage_len = 0;
+    s_log_unsynced = 0;
+    s_idx_n = 0;
+    if (s_log_file) fclose(s_log_file);
+    s_log_file = nullptr;
+    s_log_retry_us = esp_timer_get_time() + LOG_RETRY_US;
+}
+
+static void log_close(void)
+{
+    if (s_log_file == nullptr) return;
+    if (!log_sync()) {
+        log_failed();
+        return;
     }
-    esp_err_t ret = ensure_sd_mounted();
-    if (ret != ESP_OK) {
-        buf[0] = '\0';
-        return ret;
+    fclose(s_log_file);
+    s_log_file = nullptr;
+}
+
+/* Segments existants au boot : [first, last], le suivant est last + 1 */
+static void log_scan_segments(void)
+{
+    uint32_t lo = UINT32_MAX, hi = 0;
+    DIR *dir = opendir(BMU_SD_LOG_DIR);
+    if (dir) {
+        struct dirent *e;
+        while ((e = readdir(dir)) != nullptr) {
+            char *end = nullptr;
+            unsigned long seq = strtoul(e->d_name, &end, 10);
+            if (end == e->d_name + 8 && strcasecmp(end, ".csv") == 0 && seq > 0) {
+                if (seq < lo) lo = (uint32_t)seq;
+                if (seq > hi) hi = (uint32_t)seq;
+            }
+        }
+        closedir(dir);
     }
+    s_log_first_seq = (hi == 0) ? 1 : lo;
+    s_log_cur_seq = hi;                 /* ouvert en hi + 1 */
+}
+
+static void log_enforce_budget(void)
+{
+    while (s_log_cur_seq + 1 - s_log_first_seq > (uint32_t)CONFIG_BMU_SD_LOG_SEG_COUNT) {
+        char path[40];
+        log_seg_path(path, sizeof(path), s_log_first_seq);
+        remove(path);
+        log_idx_path(path, sizeof(path), s_log_first_seq);
+        remove(path);
+        s_log_first_seq++;
+        s_log_deleted++;
+    }
+}
 
-    FILE *f = fopen(BMU_SD_LOG_PATH, "r");
+static bool log_open_next(void)
+{
+    if (esp_timer_get_time() < s_log_retry_us) return false;
+    struct stat st;
+    if (stat(BMU_SD_LOG_DIR, &st) != 0 && mkdir(BMU_SD_LOG_DIR, 0755) != 0) {
+        s_log_retry_us = esp_timer_get_time() + LOG_RETRY_US;
+        return false;
+    }
+    char path[40];
+    log_seg_path(path, sizeof(path), s_log_cur_seq + 1);
+    FILE *f = fopen(path, "wb");
     if (f == nullptr) {
-        buf[0] = '\0';
-        return ESP_ERR_NOT_FOUND;
+        ESP_LOGW(TAG_SD, "Impossible de créer %s", path);
+        s_log_retry_us = esp_timer_get_time() + LOG_RETRY_US;
+        return false;
     }
+    /* Écritures déjà groupées par secteur : pas de buffer stdio */
+    setvbuf(f, nullptr, _IONBF, 0);
+    s_log_file = f;
+    s_log_cur_seq++;
+    s_log_off = 0;
+    s_log_day = log_local_day();
+    s_idx_n = 0;
+    bmu_sd_idx_builder_reset(&s_idx_b, CONFIG_BMU_SD_LOG_INDEX_S);
+    if (s_log_header) {
+        size_t n = strlen(s_log_header);   /* borné à l'init */
+        memcpy(s_log_stage + s_log_stage_len, s_log_header, n);
+        s_log_stage[s_log_stage_len + n] = '\n';
+        s_log_stage_len += n + 1;
+    }
+    log_enforce_budget();
+    return true;
+}
 
-    /* Seek to end, scan backwards for max_lines newlines */
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    if (file_size <= 0) {
-        fclose(f);
-        buf[0] = '\0';
-        return ESP_OK;
+/* Rotation : taille du segment, ou changement de jour local */
+static bool log_should_rotate(void)
+{
+    if (s_log_off + s_log_stage_len >= LOG_SEG_MAX) return true;
+    int day = log_local_day();
+    return day >= 0 && day != s_log_day;
+}
+
+/* Anneau → staging → secteurs, puis fsync selon la politique */
+static void log_service(void)
+{
+    if (s_log_file != nullptr && log_should_rotate()) log_close();
+    if (s_log_file == nullptr && !log_open_next()) {
+        /* Carte indisponible : l'anneau est vidé pour que les producteurs
+         * ne perdent pas les lignes les plus récentes à la reprise */
+        size_t n;
+        while ((n = bmu_sd_ring_drain(&s_ring, s_log_stage, LOG_STAGE_MAX)) > 0) {
+            s_log_lost += count_lines(s_log_stage, n);
+        }
+        s_log_stage_len = 0;
+        return;
     }
 
-    /* Limiter la zone de scan à buf_size pour éviter lecture mémoire excessive */
-    long scan_size = (file_size < (long)buf_size) ? file_size : (long)buf_size;
-    long start_pos = file_size - scan_size;
+    /* Après log_stage_drain(false), moins d'un secteur reste en staging :
+     * la place libre couvre toujours une ligne */
+    size_t n;
+    while ((n = bmu_sd_ring_drain(&s_ring, s_log_stage + s_log_stage_len,
+                                  LOG_STAGE_MAX - s_log_stage_len)) > 0) {
+        if (s_log_unsynced == 0) s_log_dirty_us = esp_timer_get_time();
+        size_t from = s_log_stage_len;
+        s_log_stage_len += n;
+        s_log_unsynced += n;
+        log_idx_scan(from);
+        if (!log_stage_drain(false)) {
+            log_failed();
+            return;
+        }
+        if (s_log_off + s_log_stage_len >= LOG_SEG_MAX) {
+            log_close();
+            if (s_log_file == nullptr && !log_open_next()) return;
+        }
+    }
 
-    fseek(f, start_pos, SEEK_SET);
+    if (s_log_unsynced > 0 &&
+        (s_log_unsynced >= LOG_SYNC_BYTES ||
+         esp_timer_get_time() - s_log_dirty_us >= LOG_SYNC_US)) {
+        if (!log_sync()) log_failed();
+    }
+}
 
-    /* Lire le bloc en mémoire temporaire */
-    size_t to_read = (size_t)scan_size;
-    if (to_read >= buf_size) {
-        to_read = buf_size - 1;
+static void log_task(void *)
+{
+    for (;;) {
+        /* Réveil périodique, ou anticipé par un producteur (anneau à moitié plein) */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_POLL_MS));
+        xSemaphoreTake(s_log_mutex, portMAX_DELAY);
+        log_service();
+        xSemaphoreGive(s_log_mutex);
     }
+}
 
-    size_t nread = fread(buf, 1, to_read, f);
-    fclose(f);
-    buf[nread] = '\0';
+/* Redémarrage (OTA, commande) : le staging ne doit pas être perdu */
+static void log_shutdown_sync(void)
+{
+    if (xSemaphoreTake(s_log_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    log_sync();
+    xSemaphoreGive(s_log_mutex);
+}
 
-    /* Trouver la position de la (max_lines)-ième ligne depuis la fin */
-    int nl_count = 0;
-    long cut_pos = (long)nread;
+esp_err_t bmu_sd_log_start_task(const char *csv_header, UBaseType_t priority, uint32_t stack_size)
+{
+    if (s_log_task != NULL) return ESP_OK;
+    esp_err_t ret = ensure_sd_mounted();
+    if (ret != ESP_OK) return ret;
+
+    uint32_t nb = CONFIG_BMU_SD_LOG_RING_LINES;
+    bmu_sd_slot_t *slots = (bmu_sd_slot_t *)log_alloc_psram(nb * sizeof(bmu_sd_slot_t));
+    s_log_stage = (char *)log_alloc_psram(LOG_STAGE_MAX);
+    s_log_mutex = xSemaphoreCreateMutex();
+    if (slots == NULL || s_log_stage == NULL || s_log_mutex == NULL ||
+        !bmu_sd_ring_init(&s_ring, slots, nb)) {
+        ESP_LOGE(TAG_SD, "Allocation journal SD échouée");
+        return ESP_ERR_NO_MEM;
+    }
+    if (csv_header && strlen(csv_header) < LOG_SECTOR) s_log_header = strdup(csv_header);
+    log_scan_segments();
+    s_ring_ready = true;
 
-    /* Ignorer le dernier '\n' s'il termine le fichier */
-    if (cut_pos > 0 && buf[cut_pos - 1] == '\n') {
-        cut_pos--;
+    if (xTaskCreate(log_task, "sd_log", stack_size, NULL, priority, &s_log_task) != pdPASS) {
+        s_ring_ready = false;
+        return ESP_FAIL;
     }
+    esp_register_shutdown_handler(log_shutdown_sync);
+    ESP_LOGI(TAG_SD, "Journal SD : %lu lignes en RAM, segment %08lu, fsync %d ms / %d KB",
+             (unsigned long)(s_ring.mask + 1), (unsigned long)(s_log_cur_seq + 1),
+             CONFIG_BMU_SD_LOG_SYNC_MS, CONFIG_BMU_SD_LOG_SYNC_KB);
+    return ESP_OK;
+}
 
-    for (long i = cut_pos - 1; i >= 0; i--) {
-        if (buf[i] == '\n') {
-            nl_count++;
-            if (nl_count >= max_lines) {
-                /* Décaler le buffer pour ne garder que les dernières lignes */
-                size_t offset = (size_t)(i + 1);
-                size_t remaining = nread - offset;
-                memmove(buf, buf + offset, remaining);
-                buf[remaining] = '\0';
-                return ESP_OK;
-            }
-        }
+esp_err_t bmu_sd_log_line(const char *line)
+{
+    if (line == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_ring_ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!bmu_sd_ring_push(&s_ring, line, strlen(line))) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (bmu_sd_ring_pending(&s_ring) > (s_ring.mask + 1) / 2) {
+        xTaskNotifyGive(s_log_task);
+    }
+    return ESP_OK;
+}
+
+void bmu_sd_log_get_stats(bmu_sd_log_stats_t *out)
+{
+    if (out == nullptr) return;
+    memset(out, 0, sizeof(*out));
+    if (!s_ring_ready) return;
+    out->lines_dropped    = bmu_sd_ring_dropped(&s_ring) + s_log_lost;
+    out->lines_truncated  = s_ring.truncated;
+    out->lines_pending    = bmu_sd_ring_pending(&s_ring);
+    out->bytes_written    = s_log_bytes;
+    out->write_errors     = s_log_errors;
+    out->segments_deleted = s_log_deleted;
+    out->segment_seq      = s_log_cur_seq;
+}
+
+esp_err_t bmu_sd_log_query(const bmu_sd_query_t *q, bmu_sd_row_fn_t fn, void *arg,
+                           uint32_t *rows_out)
+{
+    if (q == nullptr || fn == nullptr || q->to_ms < q->from_ms) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (rows_out) *rows_out = 0;
+    if (!s_ring_ready || s_log_cur_seq == 0) {
+        return ESP_ERR_NOT_FOUND;
     }
 
-    /* Moins de max_lines lignes dans le fichier — tout renvoyer */
+    /* Données et index sur disque ; ensuite la lecture se fait sans verrou,
+     * bornée à la taille synchronisée du segment courant */
+    xSemaphoreTake(s_log_mutex, portMAX_DELAY);
+    if (!log_sync()) log_failed();
+    uint32_t first = s_log_first_seq, cur = s_log_cur_seq;
+    uint32_t cur_end = s_log_file ? (uint32_t)s_log_off : 0;
+    xSemaphoreGive(s_log_mutex);
+
+    const size_t BUF = 4096;
+    char *buf = (char *)log_alloc_psram(BUF);
+    if (buf == NULL) return ESP_ERR_NO_MEM;
+
+    uint32_t rows = 0;
+    bmu_sd_query_segments(BMU_SD_LOG_DIR, first, cur, cur_end, q, buf, BUF, fn, arg, &rows);
+    free(buf);
+    if (rows_out) *rows_out = rows;
     return ESP_OK;
 }
 
+#else  /* CONFIG_BMU_SD_LOG_ENABLED */
+
+esp_err_t bmu_sd_log_start_task(const char *csv_header, UBaseType_t priority, uint32_t stack_size)
+{
+    (void)csv_header; (void)priority; (void)stack_size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+esp_err_t bmu_sd_log_line(const char *line) { (void)line; return ESP_ERR_NOT_SUPPORTED; }
+void bmu_sd_log_get_stats(bmu_sd_log_stats_t *out) { if (out) memset(out, 0, sizeof(*out)); }
+esp_err_t bmu_sd_log_query(const bmu_sd_query_t *q, bmu_sd_row_fn_t fn, void *arg,
+                           uint32_t *rows_out)
+{
+    (void)q; (void)fn; (void)arg;
+    if (rows_out) *rows_out = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_BMU_SD_LOG_ENABLED */
+
 /* ── Internal FAT partition ──────────────────────────────────────────── */
 
 static const char *TAG_FAT = "FAT";
@@ -0,0 +1,127 @@
+/**
+ * @file bmu_sd_index.h
+ * @brief Index temporel des segments du journal SD et requêtes par plage.
+ *
+ * Convention des lignes journalisées : colonne 0 = utc_ms (0 tant que
+ * l'heure n'est pas valide), colonne 2 = clé (numéro de batterie).
+ *
+ * À côté de chaque segment NNNNNNNN.csv, NNNNNNNN.idx liste des entrées
+ * { t_s, offset } : la première ligne horodatée de chaque tranche de
+ * bucket_s secondes et sa position dans le segment. Une requête cherche par
+ * dichotomie l'entrée de départ (quelques lectures de 8 octets), puis lit
+ * le segment par blocs depuis cet offset jusqu'à dépasser la fin de plage :
+ * RAM bornée au bloc de lecture, quelle que soit la taille du segment.
+ *
+ * Aucune dépendance ESP-IDF (stdio seulement) : testé sur host (test_sd_index).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_SD_COL_TIME  0
+#define BMU_SD_COL_KEY   2
+
+typedef struct {
+    uint32_t t_s;       /**< utc_ms / 1000 de la première ligne de la tranche */
+    uint32_t offset;    /**< Position de cette ligne dans le segment */
+} bmu_sd_idx_entry_t;
+
+/** Construction de l'index pendant l'écriture (une instance par segment) */
+typedef struct {
+    uint32_t bucket_s;
+    uint32_t last_bucket;
+    bool     have;
+} bmu_sd_idx_builder_t;
+
+typedef struct {
+    int64_t  from_ms;   /**< utc_ms inclus */
+    int64_t  to_ms;     /**< utc_ms inclus */
+    uint32_t key;       /**< Colonne BMU_SD_COL_KEY, 0 = toutes */
+    uint32_t step_s;    /**< 0 = toutes les lignes, sinon un snapshot par pas (bmu_sd_stream_sampled) */
+} bmu_sd_query_t;
+
+/** Ligne trouvée (sans '\n'). Retourner false arrête la requête. */
+typedef bool (*bmu_sd_row_fn_t)(const char *row, size_t len, void *arg);
+
+void bmu_sd_idx_builder_reset(bmu_sd_idx_builder_t *b, uint32_t bucket_s);
+
+/**
+ * @brief Ligne horodatée t_ms écrite à offset : true (et *out rempli) si
+ *        elle ouvre une nouvelle tranche. Une horloge qui recule ne crée
+ *        pas d'entrée : l'index reste trié.
+ */
+bool bmu_sd_idx_feed(bmu_sd_idx_builder_t *b, int64_t t_ms, uint32_t offset,
+                     bmu_sd_idx_entry_t *out);
+
+/** utc_ms de la ligne (colonne 0), -1 si absent ou nul (heure invalide) */
+int64_t bmu_sd_row_time(const char *row, size_t len);
+
+/** true si la ligne est dans la plage et porte la clé demandée */
+bool bmu_sd_row_match(const bmu_sd_query_t *q, const char *row, size_t len);
+
+/**
+ * @brief Dichotomie dans un fichier .idx ouvert : offset de départ pour t_ms
+ *        (dernière entrée avec t_s <= t_ms / 1000, 0 si aucune).
+ * @param first_t_s  si non NULL : t_s de la première entrée, UINT32_MAX si index vide
+ */
+uint32_t bmu_sd_idx_find(FILE *idx, int64_t t_ms, uint32_t *first_t_s);
+
+/**
+ * @brief Lit csv de start à end (octets, end = 0 : fin du fichier) par blocs
+ *        de buf_size et appelle fn pour chaque ligne qui correspond. S'arrête
+ *        à la première ligne horodatée après q->to_ms (lignes triées).
+ * @param rows     lignes transmises (cumulé)
+ * @return true si la fin du segment est atteinte (continuer au suivant),
+ *         false si fn a demandé l'arrêt ou si la fin de plage est dépassée
+ */
+bool bmu_sd_stream_rows(FILE *csv, uint32_t start, uint32_t end,
+                        const bmu_sd_query_t *q, char *buf, size_t buf_size,
+                        bmu_sd_row_fn_t fn, void *arg, uint32_t *rows);
+
+/**
+ * @brief Échantillonnage (q->step_s > 0) : premier snapshot (lignes au même
+ *        utc_ms) à chaque échéance de la grille de pas q->step_s. Les
+ *        entrées de idx découpent le segment en tranches : une tranche sans
+ *        échéance est sautée sans lecture (pas >= tranche : un déplacement
+ *        et un bloc par échantillon), sinon elle est lue par blocs jusqu'à
+ *        sa dernière échéance (pas < tranche). Résolution effective :
+ *        step_s, quelle que soit la tranche d'index. idx NULL ou vide :
+ *        parcours linéaire du segment entier (même résultat, plus lent).
+ * @param end     comme bmu_sd_stream_rows (entrées au-delà ignorées)
+ * @param next_s  prochaine échéance (utc s), reportée de segment en segment ;
+ *                initialiser à from_ms / 1000 arrondi au-dessus
+ * @return comme bmu_sd_stream_rows
+ */
+bool bmu_sd_stream_sampled(FILE *csv, FILE *idx, uint32_t end,
+                           const bmu_sd_query_t *q, uint32_t *next_s,
+                           char *buf, size_t buf_size,
+                           bmu_sd_row_fn_t fn, void *arg, uint32_t *rows);
+
+#define BMU_SD_PATH_MAX  64
+
+/** Chemin 8.3 du segment seq : dir/NNNNNNNN.ext (ext = "csv" ou "idx") */
+void bmu_sd_seg_path(char *buf, size_t len, const char *dir, uint32_t seq, const char *ext);
+
+/**
+ * @brief Requête complète sur les segments first..cur de dir : dichotomie
+ *        sur la première tranche de chaque segment, puis bmu_sd_stream_rows
+ *        (q->step_s = 0) ou bmu_sd_stream_sampled, grille reportée d'un
+ *        segment au suivant. Segments absents (supprimés) sautés ;
+ *        segment sans .idx lu linéairement.
+ * @param cur_end taille synchronisée du segment courant cur (0 = fichier entier)
+ * @param rows    lignes transmises (cumulé)
+ */
+void bmu_sd_query_segments(const char *dir, uint32_t first, uint32_t cur, uint32_t cur_end,
+                           const bmu_sd_query_t *q, char *buf, size_t buf_size,
+                           bmu_sd_row_fn_t fn, void *arg, uint32_t *rows);
+
+#ifdef __cplusplus
+}
+#endif
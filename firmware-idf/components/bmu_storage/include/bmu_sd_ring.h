@@ -0,0 +1,65 @@
+/**
+ * @file bmu_sd_ring.h
+ * @brief Anneau de lignes sans verrou pour le journal SD.
+ *
+ * Plusieurs producteurs (bmu_sd_log_line depuis n'importe quelle tâche), un
+ * seul consommateur (tâche d'écriture SD). Slots de taille fixe avec numéro
+ * de séquence (file bornée de Vyukov) : un producteur réserve un slot par
+ * CAS sur head, copie sa ligne, puis le publie ; il n'attend jamais le
+ * consommateur. Anneau plein → ligne abandonnée et comptée.
+ *
+ * Aucune dépendance ESP-IDF : testé sur host (test_sd_ring).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longueur max d'une ligne, '\n' compris ; au-delà elle est tronquée */
+#define BMU_SD_LINE_MAX  122
+
+typedef struct {
+    uint32_t seq;                       /**< Accès atomiques uniquement */
+    uint16_t len;
+    char     text[BMU_SD_LINE_MAX];
+} bmu_sd_slot_t;
+
+typedef struct {
+    bmu_sd_slot_t *slots;
+    uint32_t       mask;                /**< nb_slots - 1 (puissance de 2) */
+    uint32_t       head;                /**< Producteurs (CAS) */
+    uint32_t       tail;                /**< Consommateur */
+    uint32_t       dropped;             /**< Lignes perdues, anneau plein */
+    uint32_t       truncated;           /**< Lignes tronquées à BMU_SD_LINE_MAX */
+} bmu_sd_ring_t;
+
+/**
+ * @brief Initialise l'anneau sur slots[nb_slots].
+ * nb_slots est arrondi à la puissance de 2 inférieure.
+ * @return false si nb_slots < 2
+ */
+bool bmu_sd_ring_init(bmu_sd_ring_t *r, bmu_sd_slot_t *slots, uint32_t nb_slots);
+
+/** Ajoute une ligne (sans '\n'). Jamais bloquant ; false si abandonnée. */
+bool bmu_sd_ring_push(bmu_sd_ring_t *r, const char *line, size_t len);
+
+/**
+ * @brief Consommateur : copie des lignes complètes terminées par '\n' dans
+ *        out[cap] tant qu'elles tiennent.
+ * @return octets écrits, 0 si l'anneau est vide ou la ligne suivante ne tient pas
+ */
+size_t bmu_sd_ring_drain(bmu_sd_ring_t *r, char *out, size_t cap);
+
+/** Lignes en attente (approximatif si des producteurs sont actifs) */
+uint32_t bmu_sd_ring_pending(const bmu_sd_ring_t *r);
+
+uint32_t bmu_sd_ring_dropped(const bmu_sd_ring_t *r);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,7 +1,10 @@
 #pragma once
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "bmu_sd_index.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,12 +17,39 @@ extern "C" {
 #define BMU_SD_CLK      GPIO_NUM_12
 #define BMU_SD_CS       GPIO_NUM_10
 #define BMU_SD_MOUNT    "/sdcard"
-#define BMU_SD_LOG_PATH BMU_SD_MOUNT "/bmu_log.csv"
+#define BMU_SD_LOG_DIR  BMU_SD_MOUNT "/log"
 
 esp_err_t bmu_sd_init(void);
 bool bmu_sd_is_mounted(void);
+
+/* Journal CSV : segments BMU_SD_LOG_DIR/NNNNNNNN.csv, rotation par taille
+ * et par jour, écrits par une tâche dédiée (CONFIG_BMU_SD_LOG_*). */
+typedef struct {
+    uint32_t lines_dropped;     /**< Anneau plein ou carte indisponible */
+    uint32_t lines_truncated;   /**< Plus longues que BMU_SD_LINE_MAX */
+    uint32_t lines_pending;     /**< En RAM, pas encore écrites */
+    uint32_t bytes_written;
+    uint32_t write_errors;
+    uint32_t segments_deleted;  /**< Budget CONFIG_BMU_SD_LOG_SEG_COUNT */
+    uint32_t segment_seq;       /**< Segment courant */
+} bmu_sd_log_stats_t;
+
+/** Monte la carte si besoin, crée l'anneau et la tâche d'écriture.
+ *  csv_header (copié, NULL = aucun) est écrit en tête de chaque segment. */
+esp_err_t bmu_sd_log_start_task(const char *csv_header, UBaseType_t priority, uint32_t stack_size);
+/** Ajoute une ligne (sans '\n'). Jamais bloquant : ESP_ERR_NO_MEM si abandonnée. */
 esp_err_t bmu_sd_log_line(const char *line);
-esp_err_t bmu_sd_read_last_lines(char *buf, size_t buf_size, int max_lines);
+void bmu_sd_log_get_stats(bmu_sd_log_stats_t *out);
+/**
+ * @brief Lignes dont utc_ms est dans [from_ms, to_ms] (et la clé, si non
+ *        nulle), dans l'ordre, passées à fn depuis la tâche appelante.
+ *        Dichotomie sur les index de segments puis lecture par blocs de
+ *        4 KB : RAM bornée, le journal continue d'écrire pendant la requête.
+ *        q->step_s > 0 : un snapshot par pas, par sauts dans l'index.
+ * @param rows_out  lignes transmises (peut être NULL)
+ */
+esp_err_t bmu_sd_log_query(const bmu_sd_query_t *q, bmu_sd_row_fn_t fn, void *arg,
+                           uint32_t *rows_out);
 
 /* ── Internal FAT partition (USB-accessible config) ──────────────────── */
 #define BMU_FAT_MOUNT   "/fatfs"
@@ -0,0 +1,235 @@
+/**
+ * bmu_telemetry — Pipeline de télémétrie (voir bmu_telemetry.h).
+ *
+ * Une trame par période : snapshot protection (déjà copié sous state_mutex
+ * par la protection), compteurs Ah/Wh en une prise de verrou, caches
+ * Rint / SOH / SOC / balancer / climat, puis agrégats. La trame de travail
+ * est publiée dans s_latest sous mutex avant l'appel des sinks.
+ */
+
+#include "sdkconfig.h"
+#include "bmu_telemetry.h"
+
+#include "bmu_balancer.h"
+#include "bmu_climate.h"
+#include "bmu_soc.h"
+#if CONFIG_BMU_RINT_ENABLED
+#include "bmu_rint.h"
+#endif
+#if CONFIG_BMU_SOH_ENABLED
+#include "bmu_soh.h"
+#endif
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static const char *TAG = "TELEM";
+
+#define PERIOD_MS  CONFIG_BMU_TELEM_PERIOD_MS
+#define MAX_SINKS  CONFIG_BMU_TELEM_MAX_SINKS
+
+typedef struct {
+    const char          *name;
+    uint32_t             period_ms;
+    uint32_t             last_ms;
+    bool                 ran;
+    bmu_telem_sink_fn_t  fn;
+    void                *arg;
+} sink_t;
+
+static bmu_battery_manager_t *s_mgr = NULL;
+static QueueHandle_t s_q_snapshot = NULL;
+static SemaphoreHandle_t s_mutex = NULL;       /* s_latest + s_nb_sinks + period_ms */
+static bmu_snapshot_t *s_snap = NULL;          /* dernier snapshot reçu */
+static bmu_telem_frame_t *s_work = NULL;       /* trame en construction (tâche) */
+static bmu_telem_frame_t *s_latest = NULL;     /* dernière trame publiée */
+static bool s_have_latest = false;
+static bmu_coulomb_t s_coulomb[BMU_MAX_BATTERIES];
+static sink_t s_sinks[MAX_SINKS];
+static int s_nb_sinks = 0;
+static uint32_t s_seq = 0;
+
+static void *alloc_psram(size_t size)
+{
+    void *p = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) p = calloc(1, size);  /* fallback DRAM */
+    return p;
+}
+
+/* ── Construction de la trame ────────────────────────────────────────── */
+
+static void build_frame(const bmu_snapshot_t *snap, bmu_telem_frame_t *f)
+{
+    uint8_t nb = snap->nb_batteries > BMU_MAX_BATTERIES ? BMU_MAX_BATTERIES : snap->nb_batteries;
+
+    f->seq          = ++s_seq;
+    f->timestamp_ms = snap->timestamp_ms;
+    f->cycle_count  = snap->cycle_count;
+    f->nb_batteries = nb;
+    f->topology_ok  = snap->topology_ok;
+
+    /* Verrou manager indisponible : on garde les compteurs du cycle précédent */
+    (void)bmu_battery_manager_get_coulomb_all(s_mgr, s_coulomb, nb);
+
+    for (uint8_t i = 0; i < nb; i++) {
+        bmu_telem_batt_t *b = &f->batt[i];
+        const bmu_coulomb_t *c = &s_coulomb[i];
+
+        b->voltage_mv    = snap->battery[i].voltage_mv;
+        b->current_a     = snap->battery[i].current_a;
+        b->state         = (uint8_t)snap->battery[i].state;
+        b->health_score  = snap->battery[i].health_score;
+        b->nb_switch     = snap->battery[i].nb_switches;
+        b->ah_discharge  = c->ah_discharge;
+        b->ah_charge     = c->ah_charge;
+        b->wh_discharge  = c->wh_discharge;
+        b->wh_charge     = c->wh_charge;
+        b->r_ohmic_mohm  = NAN;
+        b->r_total_mohm  = NAN;
+        b->soh_percent   = NAN;
+        b->soc_percent   = bmu_soc_get(i);
+
+#if CONFIG_BMU_RINT_ENABLED
+        bmu_rint_result_t rint = bmu_rint_get_cached(i);
+        if (rint.valid) {
+            b->r_ohmic_mohm = rint.r_ohmic_mohm;
+            b->r_total_mohm = rint.r_total_mohm;
+        }
+#endif
+#if CONFIG_BMU_SOH_ENABLED
+        float soh = bmu_soh_get_cached(i);
+        if (soh >= 0) b->soh_percent = soh * 100.0f;
+#endif
+
+        b->balancer_duty = -1;
+        if (bmu_balancer_is_off(i)) {
+            b->balancer_duty = 0;                  /* phase OFF en cours */
+        } else {
+            int duty = bmu_balancer_get_duty_pct(i);
+            if (duty < 100) b->balancer_duty = (int8_t)duty;
+        }
+    }
+
+    f->soc_fleet = bmu_soc_get_fleet();
+    f->temp_c = NAN;
+    f->humidity_pct = NAN;
+    if (bmu_climate_is_available()) {
+        f->temp_c = bmu_climate_get_temperature();
+        f->humidity_pct = bmu_climate_get_humidity();
+    }
+
+    bmu_telem_frame_aggregate(f);
+}
+
+/* ── Tâche ───────────────────────────────────────────────────────────── */
+
+static void telem_task(void *pv)
+{
+    (void)pv;
+    ESP_LOGI(TAG, "Pipeline telemetrie demarre — periode %dms", PERIOD_MS);
+
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(PERIOD_MS));
+
+        /* Sans nouveau snapshot (protection arrêtée), on republie le dernier :
+         * les sinks gardent leur cadence (heartbeats, replay, solaire). */
+        (void)xQueueReceive(s_q_snapshot, s_snap, 0);
+        build_frame(s_snap, s_work);
+
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        memcpy(s_latest, s_work, sizeof(*s_latest));
+        s_have_latest = true;
+        int nb_sinks = s_nb_sinks;
+        /* Cadences copiées sous mutex : bmu_telem_set_period depuis un
+         * callback ou une autre tâche pendant la diffusion */
+        uint32_t period[MAX_SINKS];
+        for (int k = 0; k < nb_sinks; k++) period[k] = s_sinks[k].period_ms;
+        xSemaphoreGive(s_mutex);
+
+        for (int k = 0; k < nb_sinks; k++) {
+            sink_t *s = &s_sinks[k];
+            if (period[k] == 0) continue;
+            /* Tolérance d'une demi-période pipeline : pas de dérive d'un tick */
+            if (s->ran && (uint32_t)(now_ms - s->last_ms) + PERIOD_MS / 2 < period[k]) continue;
+            s->last_ms = now_ms;
+            s->ran = true;
+            s->fn(s_work, s->arg);
+        }
+    }
+}
+
+/* ── API publique ────────────────────────────────────────────────────── */
+
+esp_err_t bmu_telem_init(bmu_battery_manager_t *mgr, QueueHandle_t q_snapshot)
+{
+    if (mgr == NULL || q_snapshot == NULL) return ESP_ERR_INVALID_ARG;
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        s_snap = (bmu_snapshot_t *)alloc_psram(sizeof(bmu_snapshot_t));
+        s_work = (bmu_telem_frame_t *)alloc_psram(sizeof(bmu_telem_frame_t));
+        s_latest = (bmu_telem_frame_t *)alloc_psram(sizeof(bmu_telem_frame_t));
+        if (s_mutex == NULL || s_snap == NULL || s_work == NULL || s_latest == NULL) {
+            ESP_LOGE(TAG, "Allocation pipeline echouee");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_mgr = mgr;
+    s_q_snapshot = q_snapshot;
+    ESP_LOGI(TAG, "Trame %u octets, %d sinks max", (unsigned)sizeof(bmu_telem_frame_t), MAX_SINKS);
+    return ESP_OK;
+}
+
+esp_err_t bmu_telem_start_task(UBaseType_t priority, uint32_t stack_size)
+{
+    if (s_mgr == NULL) return ESP_ERR_INVALID_STATE;
+    if (xTaskCreate(telem_task, "telem", stack_size, NULL, priority, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+int bmu_telem_subscribe(const char *name, uint32_t period_ms,
+                        bmu_telem_sink_fn_t fn, void *arg)
+{
+    if (s_mutex == NULL || fn == NULL) return -1;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int id = -1;
+    if (s_nb_sinks < MAX_SINKS) {
+        id = s_nb_sinks;
+        s_sinks[id] = sink_t{ name, period_ms, 0, false, fn, arg };
+        s_nb_sinks++;   /* publié après remplissage : lu par la tâche sous mutex */
+    }
+    xSemaphoreGive(s_mutex);
+    if (id < 0) {
+        ESP_LOGE(TAG, "Table des sinks pleine (%s)", name);
+    } else {
+        ESP_LOGI(TAG, "Sink %s : %lums", name, (unsigned long)period_ms);
+    }
+    return id;
+}
+
+void bmu_telem_set_period(int sink_id, uint32_t period_ms)
+{
+    if (s_mutex == NULL || sink_id < 0) return;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (sink_id < s_nb_sinks) s_sinks[sink_id].period_ms = period_ms;
+    xSemaphoreGive(s_mutex);
+}
+
+bool bmu_telem_get_latest(bmu_telem_frame_t *out)
+{
+    if (s_mutex == NULL || out == NULL) return false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool ok = s_have_latest;
+    if (ok) memcpy(out, s_latest, sizeof(*out));
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
@@ -0,0 +1,39 @@
+/**
+ * bmu_telemetry_frame — Agrégats flotte de la trame de télémétrie.
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_telemetry).
+ */
+
+#include "bmu_telemetry_frame.h"
+
+#include <cmath>
+
+void bmu_telem_frame_aggregate(bmu_telem_frame_t *f)
+{
+    uint8_t nb = f->nb_batteries > BMU_MAX_BATTERIES ? BMU_MAX_BATTERIES : f->nb_batteries;
+    float v_min = 0.0f, v_max = 0.0f, v_sum = 0.0f, i_sum = 0.0f, ah_d = 0.0f;
+    uint8_t n_valid = 0, n_connected = 0;
+
+    for (uint8_t i = 0; i < nb; i++) {
+        const bmu_telem_batt_t *b = &f->batt[i];
+        ah_d += b->ah_discharge;
+        if (b->state == BMU_STATE_CONNECTED) n_connected++;
+        if (std::isnan(b->voltage_mv) || std::isnan(b->current_a) ||
+            b->voltage_mv <= BMU_TELEM_V_VALID_MV) {
+            continue;
+        }
+        if (n_valid == 0 || b->voltage_mv < v_min) v_min = b->voltage_mv;
+        if (n_valid == 0 || b->voltage_mv > v_max) v_max = b->voltage_mv;
+        v_sum += b->voltage_mv;
+        i_sum += b->current_a;
+        n_valid++;
+    }
+
+    f->n_connected = n_connected;
+    f->n_valid = n_valid;
+    f->v_min_mv = v_min;
+    f->v_max_mv = v_max;
+    f->v_avg_mv = n_valid > 0 ? v_sum / n_valid : 0.0f;
+    f->i_total_a = i_sum;
+    f->ah_discharge_total = ah_d;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file bmu_telemetry.h
+ * @brief Pipeline de télémétrie : un snapshot, une trame, N sinks.
+ *
+ * Une tâche consomme le snapshot protection (q_cloud) toutes les
+ * CONFIG_BMU_TELEM_PERIOD_MS, le complète une seule fois (Ah/Wh sous un
+ * seul verrou, Rint, SOH, SOC, balancer, climat, agrégats) et le diffuse
+ * aux sinks abonnés, chacun à sa propre cadence et avec son propre
+ * encodeur. Les cadences de toute la télémétrie se règlent ici.
+ *
+ * Les callbacks s'exécutent dans la tâche pipeline : ils doivent être
+ * courts et non bloquants (esp_mqtt_client_enqueue, notify BLE, réveil
+ * d'une tâche). Un sink lent (HTTP) réveille sa propre tâche, qui relit
+ * la trame par bmu_telem_get_latest().
+ *
+ * Périmètre : les sinks actuels sont le cloud (MQTT / InfluxDB), VRM et le
+ * SmartShunt BLE. Le service BLE batteries, l'écran et le journal SD
+ * gardent leur propre file de snapshots (xQueueOverwrite) : ils suivent
+ * la cadence protection, plus rapide que CONFIG_BMU_TELEM_PERIOD_MS.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "bmu_battery_manager.h"
+#include "bmu_telemetry_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*bmu_telem_sink_fn_t)(const bmu_telem_frame_t *frame, void *arg);
+
+/**
+ * @param q_snapshot File du snapshot protection (longueur 1, xQueueOverwrite)
+ */
+esp_err_t bmu_telem_init(bmu_battery_manager_t *mgr, QueueHandle_t q_snapshot);
+esp_err_t bmu_telem_start_task(UBaseType_t priority, uint32_t stack_size);
+
+/**
+ * @brief Abonne un sink, appelé au plus toutes les period_ms (arrondi au
+ *        multiple de la période pipeline).
+ * @return identifiant du sink, -1 si la table est pleine
+ */
+int bmu_telem_subscribe(const char *name, uint32_t period_ms,
+                        bmu_telem_sink_fn_t fn, void *arg);
+
+/** Change la cadence d'un sink (0 = suspendu) ; appelable depuis un callback */
+void bmu_telem_set_period(int sink_id, uint32_t period_ms);
+
+/** Copie la dernière trame ; false si aucune n'a encore été produite */
+bool bmu_telem_get_latest(bmu_telem_frame_t *out);
+
+#ifdef __cplusplus
+}
+#endif
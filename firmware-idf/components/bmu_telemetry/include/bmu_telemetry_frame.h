@@ -0,0 +1,68 @@
+/**
+ * @file bmu_telemetry_frame.h
+ * @brief Trame de télémétrie : une image cohérente de la flotte par cycle.
+ *
+ * Construite une fois par cycle par le pipeline (bmu_telemetry.h) à partir
+ * du snapshot protection, des compteurs Ah/Wh et des caches Rint / SOH /
+ * SOC / balancer / climat. Les sinks (MQTT, InfluxDB, VRM, ...) lisent
+ * cette trame au lieu d'appeler les getters un par un.
+ *
+ * Aucune dépendance ESP-IDF : testé sur host (test_telemetry).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bmu_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Seuil de tension valide des agrégats (même règle que get_summary) */
+#define BMU_TELEM_V_VALID_MV  1000.0f
+
+typedef struct {
+    float    voltage_mv;
+    float    current_a;
+    float    ah_discharge;      /**< Ah */
+    float    ah_charge;
+    float    wh_discharge;      /**< Wh */
+    float    wh_charge;
+    float    r_ohmic_mohm;      /**< NAN si non mesuré */
+    float    r_total_mohm;
+    float    soh_percent;       /**< NAN si non disponible */
+    float    soc_percent;       /**< < 0 si non disponible */
+    uint16_t nb_switch;
+    int8_t   balancer_duty;     /**< %, 0 en phase OFF, -1 si inactif */
+    uint8_t  state;             /**< bmu_battery_state_t */
+    uint8_t  health_score;
+} bmu_telem_batt_t;
+
+typedef struct {
+    uint32_t seq;               /**< Numéro de trame (pipeline) */
+    uint32_t timestamp_ms;      /**< Horodatage du snapshot protection */
+    uint16_t cycle_count;
+    uint8_t  nb_batteries;
+    bool     topology_ok;
+    bmu_telem_batt_t batt[BMU_MAX_BATTERIES];
+
+    /* Agrégats : bmu_telem_frame_aggregate() */
+    uint8_t  n_connected;
+    uint8_t  n_valid;           /**< Batteries à V > BMU_TELEM_V_VALID_MV */
+    float    v_min_mv;          /**< Sur les batteries valides, 0 si aucune */
+    float    v_max_mv;
+    float    v_avg_mv;
+    float    i_total_a;
+    float    ah_discharge_total;
+    float    soc_fleet;         /**< < 0 si non disponible */
+    float    temp_c;            /**< NAN si capteur absent */
+    float    humidity_pct;
+} bmu_telem_frame_t;
+
+/** Calcule les agrégats flotte à partir de batt[0..nb_batteries-1] */
+void bmu_telem_frame_aggregate(bmu_telem_frame_t *f);
+
+#ifdef __cplusplus
+}
+#endif
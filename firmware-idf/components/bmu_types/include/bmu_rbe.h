@@ -0,0 +1,114 @@
+/**
+ * @file bmu_rbe.h
+ * @brief Report-by-exception : publication sur changement + heartbeat.
+ *
+ * Chaque flux de télémétrie (batterie MQTT, groupe VRM, caractéristique
+ * BLE) garde un slot avec les dernières valeurs envoyées. À chaque tick
+ * rapide, le flux n'est publié que si un champ a bougé de plus que sa
+ * bande morte, ou si le dernier envoi date de plus que le heartbeat :
+ * une flotte au repos se tait, un transitoire part au tick suivant.
+ *
+ * Bande morte par champ, dans l'unité du champ :
+ *   > 0          : |v - dernier| > bande
+ *   0            : tout changement (état, compteurs)
+ *   < 0 (IGNORE) : ne déclenche jamais, envoyé avec le reste
+ * NAN ↔ valeur compte comme un changement. heartbeat_ms = 0 désactive le
+ * mécanisme (publication à chaque appel).
+ *
+ * Usage : bmu_rbe_due() avant de publier, bmu_rbe_commit() seulement si
+ * la publication a réussi (broker déconnecté → retenté au tick suivant).
+ * Aucune dépendance ESP-IDF hors sdkconfig.h : inclus tel quel par test/test_rbe.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#ifndef NATIVE_TEST
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_RBE_MAX_FIELDS  8
+#define BMU_RBE_IGNORE      (-1.0f)
+
+/* Réglages Kconfig partagés cloud / VRM / BLE. RBE désactivé : heartbeat 0,
+ * chaque appel publie et les périodes fixes d'origine s'appliquent. */
+#if defined(CONFIG_BMU_RBE_ENABLED) && CONFIG_BMU_RBE_ENABLED
+#define BMU_RBE_TICK_MS       CONFIG_BMU_RBE_TICK_MS
+#define BMU_RBE_HEARTBEAT_MS  ((uint32_t)CONFIG_BMU_RBE_HEARTBEAT_S * 1000u)
+#define BMU_RBE_DB_MV         ((float)CONFIG_BMU_RBE_DEADBAND_MV)
+#define BMU_RBE_DB_MA         ((float)CONFIG_BMU_RBE_DEADBAND_MA)
+#else
+#define BMU_RBE_TICK_MS       0
+#define BMU_RBE_HEARTBEAT_MS  0u
+#define BMU_RBE_DB_MV         0.0f
+#define BMU_RBE_DB_MA         0.0f
+#endif
+
+typedef struct {
+    const float *deadband;      /**< nb_fields bandes mortes */
+    uint8_t      nb_fields;     /**< ≤ BMU_RBE_MAX_FIELDS */
+    uint32_t     heartbeat_ms;  /**< Intervalle max entre deux envois, 0 = toujours */
+} bmu_rbe_cfg_t;
+
+typedef struct {
+    float    last[BMU_RBE_MAX_FIELDS];
+    uint32_t last_ms;
+    bool     valid;             /**< false → envoi au prochain appel */
+} bmu_rbe_slot_t;
+
+/** Force l'envoi au prochain appel (démarrage, reconnexion, nouveau client) */
+static inline void bmu_rbe_reset(bmu_rbe_slot_t *s)
+{
+    s->valid = false;
+}
+
+/** true si un champ a franchi sa bande morte ou si le heartbeat est échu */
+static inline bool bmu_rbe_due(const bmu_rbe_cfg_t *c, const bmu_rbe_slot_t *s,
+                               const float *v, uint32_t now_ms)
+{
+    if (c->heartbeat_ms == 0 || !s->valid) return true;
+    if ((uint32_t)(now_ms - s->last_ms) >= c->heartbeat_ms) return true;
+    for (uint8_t k = 0; k < c->nb_fields && k < BMU_RBE_MAX_FIELDS; k++) {
+        float db = c->deadband[k];
+        if (db < 0.0f) continue;
+        bool nan_v = isnan(v[k]), nan_l = isnan(s->last[k]);
+        if (nan_v || nan_l) {
+            if (nan_v != nan_l) return true;
+            continue;
+        }
+        float d = v[k] - s->last[k];
+        if (d < 0.0f) d = -d;
+        if (db == 0.0f ? d != 0.0f : d > db) return true;
+    }
+    return false;
+}
+
+/** Enregistre les valeurs effectivement envoyées */
+static inline void bmu_rbe_commit(const bmu_rbe_cfg_t *c, bmu_rbe_slot_t *s,
+                                  const float *v, uint32_t now_ms)
+{
+    for (uint8_t k = 0; k < c->nb_fields && k < BMU_RBE_MAX_FIELDS; k++) {
+        s->last[k] = v[k];
+    }
+    s->last_ms = now_ms;
+    s->valid = true;
+}
+
+/** due + commit, pour les transports sans retour d'erreur (notify BLE) */
+static inline bool bmu_rbe_check(const bmu_rbe_cfg_t *c, bmu_rbe_slot_t *s,
+                                 const float *v, uint32_t now_ms)
+{
+    if (!bmu_rbe_due(c, s, v, now_ms)) return false;
+    bmu_rbe_commit(c, s, v, now_ms);
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -85,7 +85,7 @@ typedef struct {
         float               current_a;
         bmu_battery_state_t state;
         uint8_t             health_score;
-        uint8_t             nb_switches;
+        uint16_t            nb_switches;
         bool                balancer_active;
     } battery[BMU_MAX_BATTERIES];
 
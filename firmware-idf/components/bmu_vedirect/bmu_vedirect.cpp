@@ -7,17 +7,35 @@
  * secondes sur UART 19200 8N1.
  *
  * Format : LABEL\tVALUE\r\n  (terminé par Checksum\t<byte>)
+ *
+ * La tâche est réveillée par la file d'événements du pilote UART et vide
+ * le tampon de réception par blocs vers le parser (bmu_vedirect_parser).
+ * Si TX est câblé, les registres HEX peuvent être interrogés ; les réponses
+ * et les messages asynchrones alimentent un petit cache de registres.
+ *
+ * Plusieurs chargeurs (CONFIG_BMU_VEDIRECT_COUNT) : un port UART + une
+ * tâche par chargeur, ou un seul UART derrière un multiplexeur commuté
+ * par la tâche (CONFIG_BMU_VEDIRECT_MUX). Les trames sont agrégées à la
+ * lecture en un modèle solaire unique (bmu_vedirect_solar).
+ *
+ * Multiplexeur et HEX : les requêtes sont mises en file par chargeur et
+ * émises par la tâche au début du prochain passage sur son canal. Le
+ * canal est gardé tant qu'une réponse est attendue (HEX_REPLY_TIMEOUT_MS
+ * au plus) : sinon la commutation purgerait la réponse, ou l'attribuerait
+ * au chargeur suivant.
  */
 
 #include "bmu_vedirect.h"
 #include "driver/uart.h"
+#include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 
+#include <cstdio>
 #include <cstring>
-#include <cstdlib>
 
 static const char *TAG = "VEDR";
 
@@ -28,76 +46,118 @@ static const char *TAG = "VEDR";
 #if !defined(CONFIG_BMU_VEDIRECT_ENABLED) || !CONFIG_BMU_VEDIRECT_ENABLED
 
 esp_err_t bmu_vedirect_init(void) { return ESP_ERR_NOT_SUPPORTED; }
-const bmu_vedirect_data_t *bmu_vedirect_get_data(void) { return nullptr; }
+uint8_t bmu_vedirect_count(void) { return 0; }
 bool bmu_vedirect_is_connected(void) { return false; }
+bool bmu_vedirect_get_solar(bmu_vedirect_solar_t *out)
+{
+    bmu_vedirect_solar_aggregate(nullptr, 0, 0, 0, out);
+    return false;
+}
+bool bmu_vedirect_get_charger(uint8_t, bmu_vedirect_data_t *) { return false; }
 const char *bmu_vedirect_cs_name(uint8_t) { return "Disabled"; }
+esp_err_t bmu_vedirect_hex_get(uint8_t, uint16_t) { return ESP_ERR_NOT_SUPPORTED; }
+bool bmu_vedirect_hex_read(uint8_t, uint16_t, uint32_t *, int64_t *) { return false; }
+void bmu_vedirect_get_stats(bmu_vedirect_parser_stats_t *out) { memset(out, 0, sizeof(*out)); }
+bool bmu_vedirect_uses_gpio(int) { return false; }
 
 #else // CONFIG_BMU_VEDIRECT_ENABLED == 1
 
+#if defined(CONFIG_BMU_VEDIRECT_MUX) && CONFIG_BMU_VEDIRECT_MUX
+#define VEDIRECT_MUX 1
+#else
+#define VEDIRECT_MUX 0
+#endif
+
+#if !VEDIRECT_MUX && CONFIG_BMU_VEDIRECT_COUNT > 3
+#error "Plus de 3 chargeurs VE.Direct : activer BMU_VEDIRECT_MUX"
+#endif
+
 // ---------------------------------------------------------------------------
 // Constantes
 // ---------------------------------------------------------------------------
 static constexpr size_t   RX_BUF_SIZE        = 1024;
-static constexpr size_t   MAX_LABEL_LEN      = 16;
-static constexpr size_t   MAX_VALUE_LEN      = 32;
+static constexpr size_t   TX_BUF_SIZE        = 256;
+static constexpr size_t   READ_CHUNK         = 128;
+static constexpr int      EVENT_QUEUE_LEN    = 16;
+static constexpr size_t   REG_CACHE_SIZE     = 16;
+static constexpr uint8_t  HEX_QUEUE_LEN      = 4;
+static constexpr int64_t  HEX_REPLY_TIMEOUT_MS = 500;
+static constexpr uint8_t  N_CHARGERS         = CONFIG_BMU_VEDIRECT_COUNT;
 static constexpr uint32_t TASK_STACK_SIZE     = CONFIG_BMU_VEDIRECT_TASK_STACK;
 static constexpr int      TASK_PRIORITY       = CONFIG_BMU_VEDIRECT_TASK_PRIORITY;
+#if VEDIRECT_MUX
+// Un tour complet du multiplexeur (attente HEX comprise) + marge
+static constexpr int64_t  CONNECTION_TIMEOUT_MS =
+    (int64_t)N_CHARGERS * (CONFIG_BMU_VEDIRECT_MUX_DWELL_MS + HEX_REPLY_TIMEOUT_MS) + 2000;
+#else
 static constexpr int64_t  CONNECTION_TIMEOUT_MS = 5000;
+#endif
+
+static_assert(N_CHARGERS <= BMU_VEDIRECT_MAX_CHARGERS, "BMU_VEDIRECT_COUNT trop grand");
+
+struct port_cfg_t {
+    int uart;
+    int rx_gpio;
+    int tx_gpio;
+};
+
+// Un port par chargeur, ou un seul port derrière le multiplexeur
+static constexpr port_cfg_t PORT_CFG[] = {
+    { CONFIG_BMU_VEDIRECT_UART_NUM, CONFIG_BMU_VEDIRECT_RX_GPIO, CONFIG_BMU_VEDIRECT_TX_GPIO },
+#if !VEDIRECT_MUX && CONFIG_BMU_VEDIRECT_COUNT > 1
+    { CONFIG_BMU_VEDIRECT_UART_NUM_2, CONFIG_BMU_VEDIRECT_RX_GPIO_2, CONFIG_BMU_VEDIRECT_TX_GPIO_2 },
+#endif
+#if !VEDIRECT_MUX && CONFIG_BMU_VEDIRECT_COUNT > 2
+    { CONFIG_BMU_VEDIRECT_UART_NUM_3, CONFIG_BMU_VEDIRECT_RX_GPIO_3, CONFIG_BMU_VEDIRECT_TX_GPIO_3 },
+#endif
+};
+static constexpr uint8_t N_PORTS = sizeof(PORT_CFG) / sizeof(PORT_CFG[0]);
 
 // ---------------------------------------------------------------------------
 // État interne
 // ---------------------------------------------------------------------------
-enum class ParseState : uint8_t {
-    IDLE,
-    LABEL,
-    VALUE,
-    CHECKSUM,
+struct reg_entry_t {
+    uint16_t reg;
+    uint32_t value;
+    int64_t  t_ms;               // 0 = case libre
+};
+
+// Par chargeur : dernière trame valide + registres HEX (sous s_spinlock)
+struct charger_t {
+    bmu_vedirect_data_t data;
+    reg_entry_t         regs[REG_CACHE_SIZE];
+    uint16_t            hex_queue[HEX_QUEUE_LEN];   // GET en attente du canal (mux)
+    uint8_t             hex_queued;
 };
 
-// Double-buffer : le parser écrit dans staging_, puis copie vers public_
-static bmu_vedirect_data_t s_public;
-static bmu_vedirect_data_t s_staging;
-static portMUX_TYPE        s_spinlock = portMUX_INITIALIZER_UNLOCKED;
-static bool                s_initialized = false;
+// Par port UART : parser et file d'événements (tâche du port uniquement)
+struct port_t {
+    uint8_t               index;
+    volatile uint8_t      channel;      // canal du multiplexeur (= chargeur)
+    bool                  got_frame;    // trame valide sur le canal courant
+    bool                  hex_sent;     // file HEX du canal déjà émise
+    int64_t               channel_since_ms;
+    uint16_t              hex_wait[HEX_QUEUE_LEN];  // GET émis, réponse attendue
+    uint8_t               hex_waiting;
+    int64_t               hex_deadline_ms;
+    uart_port_t           uart;
+    QueueHandle_t         queue;
+    bmu_vedirect_parser_t parser;
+};
 
-// ---------------------------------------------------------------------------
-// parse_field — mappe un label VE.Direct vers le champ correspondant
-// ---------------------------------------------------------------------------
-static void parse_field(const char *label, const char *value,
-                        bmu_vedirect_data_t *frame)
+static charger_t    s_chargers[N_CHARGERS];
+static port_t       s_ports[N_PORTS];
+static portMUX_TYPE s_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static bool         s_initialized = false;
+
+static int64_t now_ms(void)
 {
-    if (strcmp(label, "V") == 0) {
-        frame->battery_voltage_v = atoi(value) / 1000.0f;
-    } else if (strcmp(label, "I") == 0) {
-        frame->battery_current_a = atoi(value) / 1000.0f;
-    } else if (strcmp(label, "VPV") == 0) {
-        frame->panel_voltage_v = atoi(value) / 1000.0f;
-    } else if (strcmp(label, "PPV") == 0) {
-        frame->panel_power_w = (uint16_t)atoi(value);
-    } else if (strcmp(label, "CS") == 0) {
-        frame->charge_state = (uint8_t)atoi(value);
-    } else if (strcmp(label, "MPPT") == 0) {
-        frame->mppt_state = (uint8_t)atoi(value);
-    } else if (strcmp(label, "ERR") == 0) {
-        frame->error_code = (uint8_t)atoi(value);
-    } else if (strcmp(label, "H19") == 0) {
-        frame->yield_total_wh = (uint32_t)(atoi(value) * 10);  // 0.01kWh → Wh
-    } else if (strcmp(label, "H20") == 0) {
-        frame->yield_today_wh = (uint32_t)(atoi(value) * 10);
-    } else if (strcmp(label, "H21") == 0) {
-        frame->max_power_today_w = (uint16_t)atoi(value);
-    } else if (strcmp(label, "PID") == 0) {
-        strncpy(frame->product_id, value, sizeof(frame->product_id) - 1);
-        frame->product_id[sizeof(frame->product_id) - 1] = '\0';
-    } else if (strcmp(label, "SER#") == 0) {
-        strncpy(frame->serial, value, sizeof(frame->serial) - 1);
-        frame->serial[sizeof(frame->serial) - 1] = '\0';
-    } else if (strcmp(label, "FW") == 0) {
-        strncpy(frame->firmware, value, sizeof(frame->firmware) - 1);
-        frame->firmware[sizeof(frame->firmware) - 1] = '\0';
-    } else if (strcmp(label, "LOAD") == 0) {
-        frame->load_on = (strcmp(value, "ON") == 0);
-    }
+    return esp_timer_get_time() / 1000;  // µs → ms
+}
+
+static uint8_t charger_of(const port_t *port)
+{
+    return VEDIRECT_MUX ? port->channel : port->index;
 }
 
 // ---------------------------------------------------------------------------
@@ -119,111 +179,191 @@ const char *bmu_vedirect_cs_name(uint8_t cs)
 }
 
 // ---------------------------------------------------------------------------
-// Tâche FreeRTOS — lecture UART + machine d'état
+// Callbacks parser (contexte tâche du port)
 // ---------------------------------------------------------------------------
-static void vedirect_task(void * /*arg*/)
+static void on_frame(const bmu_vedirect_data_t *frame, void *arg)
 {
-    uint8_t  rx_byte;
-    char     label[MAX_LABEL_LEN];
-    char     value[MAX_VALUE_LEN];
-    uint8_t  label_idx = 0;
-    uint8_t  value_idx = 0;
-    uint8_t  checksum  = 0;         // somme glissante de tous les octets
-    auto     state     = ParseState::IDLE;
+    port_t *port = (port_t *)arg;
+    uint8_t idx = charger_of(port);
 
-    const uart_port_t port = (uart_port_t)CONFIG_BMU_VEDIRECT_UART_NUM;
+    // Trame valide — publication atomique
+    portENTER_CRITICAL(&s_spinlock);
+    memcpy(&s_chargers[idx].data, frame, sizeof(*frame));
+    s_chargers[idx].data.last_update_ms = now_ms();
+    portEXIT_CRITICAL(&s_spinlock);
+    port->got_frame = true;
+
+    ESP_LOGD(TAG, "Trame OK #%u  V=%.2fV  I=%.2fA  CS=%s", idx + 1,
+             frame->battery_voltage_v,
+             frame->battery_current_a,
+             bmu_vedirect_cs_name(frame->charge_state));
+}
 
-    // Staging buffer nettoyé au démarrage
-    memset(&s_staging, 0, sizeof(s_staging));
+static void on_hex(const bmu_vedirect_hex_msg_t *msg, void *arg)
+{
+    if (msg->cmd != BMU_VEDIRECT_HEX_GET && msg->cmd != BMU_VEDIRECT_HEX_SET &&
+        msg->cmd != BMU_VEDIRECT_HEX_ASYNC) {
+        return;
+    }
+
+    // Réponse (même en erreur) : le canal n'a plus à l'attendre
+    port_t *port = (port_t *)arg;
+    if (msg->cmd != BMU_VEDIRECT_HEX_ASYNC) {
+        for (uint8_t i = 0; i < port->hex_waiting; i++) {
+            if (port->hex_wait[i] == msg->reg) {
+                port->hex_wait[i] = port->hex_wait[--port->hex_waiting];
+                break;
+            }
+        }
+    }
+
+    if (msg->len < 3 || msg->flags != 0) {
+        ESP_LOGD(TAG, "HEX reg 0x%04X flags 0x%02X", msg->reg, msg->flags);
+        return;
+    }
 
-    ESP_LOGI(TAG, "Tâche VE.Direct démarrée (UART%d RX=%d TX=%d @ %d baud)",
-             CONFIG_BMU_VEDIRECT_UART_NUM,
-             CONFIG_BMU_VEDIRECT_RX_GPIO,
-             CONFIG_BMU_VEDIRECT_TX_GPIO,
-             CONFIG_BMU_VEDIRECT_BAUD);
+    reg_entry_t *regs = s_chargers[charger_of(port)].regs;
+    int64_t t = now_ms();
+    reg_entry_t *slot = nullptr;
+    reg_entry_t *oldest = &regs[0];
+
+    portENTER_CRITICAL(&s_spinlock);
+    for (size_t i = 0; i < REG_CACHE_SIZE; i++) {
+        reg_entry_t &e = regs[i];
+        if (e.t_ms != 0 && e.reg == msg->reg) { slot = &e; break; }
+        if (e.t_ms < oldest->t_ms) oldest = &e;
+    }
+    if (slot == nullptr) slot = oldest;     // case libre (t_ms = 0) ou la plus ancienne
+    slot->reg   = msg->reg;
+    slot->value = msg->value;
+    slot->t_ms  = t;
+    portEXIT_CRITICAL(&s_spinlock);
+}
+
+// ---------------------------------------------------------------------------
+// Multiplexeur
+// ---------------------------------------------------------------------------
+#if VEDIRECT_MUX
+static void mux_select(port_t *port, uint8_t ch)
+{
+    if (CONFIG_BMU_VEDIRECT_MUX_SEL0_GPIO >= 0) {
+        gpio_set_level((gpio_num_t)CONFIG_BMU_VEDIRECT_MUX_SEL0_GPIO, ch & 1);
+    }
+    if (CONFIG_BMU_VEDIRECT_MUX_SEL1_GPIO >= 0) {
+        gpio_set_level((gpio_num_t)CONFIG_BMU_VEDIRECT_MUX_SEL1_GPIO, (ch >> 1) & 1);
+    }
+    // Les octets reçus pendant la commutation appartiennent à l'ancien canal
+    vTaskDelay(pdMS_TO_TICKS(2));
+    uart_flush_input(port->uart);
+    xQueueReset(port->queue);
+    bmu_vedirect_parser_reset(&port->parser);
+
+    port->channel = ch;
+    port->got_frame = false;
+    port->hex_sent = false;
+    port->hex_waiting = 0;
+    port->channel_since_ms = now_ms();
+}
+
+// Émet les GET en file pour le canal courant, une fois par passage : une
+// requête arrivée pendant l'attente part au tour suivant (attente bornée)
+static void mux_send_hex(port_t *port)
+{
+    port->hex_sent = true;
+
+    uint16_t regs[HEX_QUEUE_LEN];
+    charger_t &c = s_chargers[port->channel];
+    portENTER_CRITICAL(&s_spinlock);
+    uint8_t n = c.hex_queued;
+    memcpy(regs, c.hex_queue, n * sizeof(regs[0]));
+    c.hex_queued = 0;
+    portEXIT_CRITICAL(&s_spinlock);
+
+    for (uint8_t i = 0; i < n; i++) {
+        char cmd[16];
+        size_t len = bmu_vedirect_hex_encode_get(regs[i], cmd, sizeof(cmd));
+        if (uart_write_bytes(port->uart, cmd, len) != (int)len) {
+            ESP_LOGD(TAG, "HEX GET 0x%04X non émis (#%u)", regs[i], port->channel + 1);
+            continue;
+        }
+        port->hex_wait[port->hex_waiting++] = regs[i];
+    }
+    if (port->hex_waiting > 0) port->hex_deadline_ms = now_ms() + HEX_REPLY_TIMEOUT_MS;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Tâche FreeRTOS — événements UART + lecture par blocs (une par port)
+// ---------------------------------------------------------------------------
+static void vedirect_task(void *arg)
+{
+    port_t *port = (port_t *)arg;
+    uint8_t     buf[READ_CHUNK];
+    uart_event_t event;
+
+    ESP_LOGI(TAG, "Tâche VE.Direct démarrée (UART%d RX=%d TX=%d @ %d baud%s)",
+             PORT_CFG[port->index].uart,
+             PORT_CFG[port->index].rx_gpio,
+             PORT_CFG[port->index].tx_gpio,
+             CONFIG_BMU_VEDIRECT_BAUD,
+             VEDIRECT_MUX ? ", multiplexé" : "");
+
+#if VEDIRECT_MUX
+    mux_select(port, 0);
+#endif
 
     for (;;) {
-        int len = uart_read_bytes(port, &rx_byte, 1, pdMS_TO_TICKS(100));
-        if (len <= 0) {
-            continue;  // timeout — pas de données
+        TickType_t wait = portMAX_DELAY;
+#if VEDIRECT_MUX
+        if (!port->hex_sent) mux_send_hex(port);
+
+        // Canal suivant dès qu'une trame est passée, ou au bout du temps de
+        // garde ; pas avant les réponses HEX attendues (ou leur expiration)
+        int64_t t = now_ms();
+        int64_t left = CONFIG_BMU_VEDIRECT_MUX_DWELL_MS - (t - port->channel_since_ms);
+        bool hex_busy = port->hex_waiting > 0 && t < port->hex_deadline_ms;
+        if (!hex_busy && (port->got_frame || left <= 0)) {
+            mux_select(port, (uint8_t)((port->channel + 1) % N_CHARGERS));
+            continue;
+        }
+        wait = pdMS_TO_TICKS(hex_busy ? port->hex_deadline_ms - t : left);
+#endif
+        if (xQueueReceive(port->queue, &event, wait) != pdTRUE) {
+            continue;
         }
 
-        // Tous les octets participent au checksum (y compris \r, \n, \t)
-        checksum += rx_byte;
-
-        switch (state) {
-        // ----- IDLE : on attend le début d'un label ('\r' ou '\n' ignorés)
-        case ParseState::IDLE:
-            if (rx_byte == '\r' || rx_byte == '\n') {
-                // rester en IDLE
-            } else {
-                // Premier caractère d'un label
-                label_idx = 0;
-                label[label_idx++] = (char)rx_byte;
-                state = ParseState::LABEL;
+        switch (event.type) {
+        case UART_DATA: {
+            // Vider tout ce qui est disponible, pas seulement event.size :
+            // plusieurs événements peuvent s'être accumulés.
+            size_t avail = 0;
+            uart_get_buffered_data_len(port->uart, &avail);
+            while (avail > 0) {
+                size_t want = avail < sizeof(buf) ? avail : sizeof(buf);
+                int len = uart_read_bytes(port->uart, buf, want, 0);
+                if (len <= 0) break;
+                bmu_vedirect_parser_feed(&port->parser, buf, (size_t)len);
+                avail -= (size_t)len;
             }
             break;
+        }
 
-        // ----- LABEL : accumulation jusqu'au '\t'
-        case ParseState::LABEL:
-            if (rx_byte == '\t') {
-                label[label_idx] = '\0';
-                value_idx = 0;
-
-                // Le label "Checksum" est spécial : le prochain octet
-                // est la valeur de checksum brute (pas un texte).
-                if (strcmp(label, "Checksum") == 0) {
-                    state = ParseState::CHECKSUM;
-                } else {
-                    state = ParseState::VALUE;
-                }
-            } else {
-                if (label_idx < MAX_LABEL_LEN - 1) {
-                    label[label_idx++] = (char)rx_byte;
-                }
-            }
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Octets perdus : la trame en cours est fausse, on resynchronise
+            ESP_LOGW(TAG, "Débordement UART%d (%d), resynchronisation",
+                     (int)port->uart, (int)event.type);
+            uart_flush_input(port->uart);
+            xQueueReset(port->queue);
+            bmu_vedirect_parser_reset(&port->parser);
             break;
 
-        // ----- VALUE : accumulation jusqu'au '\r' ou '\n'
-        case ParseState::VALUE:
-            if (rx_byte == '\r' || rx_byte == '\n') {
-                value[value_idx] = '\0';
-                parse_field(label, value, &s_staging);
-                state = ParseState::IDLE;
-            } else {
-                if (value_idx < MAX_VALUE_LEN - 1) {
-                    value[value_idx++] = (char)rx_byte;
-                }
-            }
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            bmu_vedirect_parser_reset(&port->parser);
             break;
 
-        // ----- CHECKSUM : l'octet après "Checksum\t" complète la somme
-        case ParseState::CHECKSUM:
-            // L'octet de checksum a déjà été ajouté à `checksum` plus haut.
-            // Si le protocole est correct, checksum == 0 (mod 256).
-            if ((checksum & 0xFF) == 0) {
-                // Trame valide — publication atomique
-                s_staging.valid = true;
-                s_staging.last_update_ms =
-                    esp_timer_get_time() / 1000;  // µs → ms
-
-                portENTER_CRITICAL(&s_spinlock);
-                memcpy(&s_public, &s_staging, sizeof(s_public));
-                portEXIT_CRITICAL(&s_spinlock);
-
-                ESP_LOGD(TAG, "Trame OK  V=%.2fV  I=%.2fA  CS=%s",
-                         s_staging.battery_voltage_v,
-                         s_staging.battery_current_a,
-                         bmu_vedirect_cs_name(s_staging.charge_state));
-            } else {
-                ESP_LOGW(TAG, "Checksum invalide (0x%02X), trame ignorée",
-                         checksum & 0xFF);
-            }
-
-            // Réinitialisation pour la prochaine trame
-            memset(&s_staging, 0, sizeof(s_staging));
-            checksum = 0;
-            state = ParseState::IDLE;
+        default:
             break;
         }
     }
@@ -232,13 +372,10 @@ static void vedirect_task(void * /*arg*/)
 // ---------------------------------------------------------------------------
 // API publique
 // ---------------------------------------------------------------------------
-esp_err_t bmu_vedirect_init(void)
+static esp_err_t port_open(port_t *port, uint8_t index)
 {
-    if (s_initialized) {
-        return ESP_OK;
-    }
-
-    const uart_port_t port = (uart_port_t)CONFIG_BMU_VEDIRECT_UART_NUM;
+    const port_cfg_t &cfg = PORT_CFG[index];
+    const uart_port_t uart = (uart_port_t)cfg.uart;
 
     const uart_config_t uart_cfg = {
         .baud_rate  = CONFIG_BMU_VEDIRECT_BAUD,
@@ -250,20 +387,15 @@ esp_err_t bmu_vedirect_init(void)
         .source_clk = UART_SCLK_DEFAULT,
     };
 
-    esp_err_t err = uart_param_config(port, &uart_cfg);
+    esp_err_t err = uart_param_config(uart, &uart_cfg);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "uart_param_config échoué: %s", esp_err_to_name(err));
         return err;
     }
 
-    int tx_pin = CONFIG_BMU_VEDIRECT_TX_GPIO;
-    if (tx_pin < 0) {
-        tx_pin = UART_PIN_NO_CHANGE;
-    }
-
-    err = uart_set_pin(port,
-                       tx_pin,
-                       CONFIG_BMU_VEDIRECT_RX_GPIO,
+    err = uart_set_pin(uart,
+                       cfg.tx_gpio < 0 ? UART_PIN_NO_CHANGE : cfg.tx_gpio,
+                       cfg.rx_gpio,
                        UART_PIN_NO_CHANGE,
                        UART_PIN_NO_CHANGE);
     if (err != ESP_OK) {
@@ -271,48 +403,190 @@ esp_err_t bmu_vedirect_init(void)
         return err;
     }
 
-    err = uart_driver_install(port, RX_BUF_SIZE, 0, 0, nullptr, 0);
+    // TX bufferisé seulement si câblé : les requêtes HEX ne bloquent pas
+    err = uart_driver_install(uart, RX_BUF_SIZE,
+                              cfg.tx_gpio >= 0 ? TX_BUF_SIZE : 0,
+                              EVENT_QUEUE_LEN, &port->queue, 0);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "uart_driver_install échoué: %s", esp_err_to_name(err));
         return err;
     }
 
-    // Données publiques initialisées à zéro
-    memset(&s_public, 0, sizeof(s_public));
-
-    BaseType_t ret = xTaskCreate(
-        vedirect_task,
-        "vedirect",
-        TASK_STACK_SIZE,
-        nullptr,
-        TASK_PRIORITY,
-        nullptr);
+    port->index = index;
+    port->channel = 0;
+    port->uart = uart;
+    bmu_vedirect_parser_init(&port->parser, on_frame, on_hex, port);
 
+    char name[16];
+    snprintf(name, sizeof(name), "vedirect%u", index);
+    BaseType_t ret = xTaskCreate(vedirect_task, name, TASK_STACK_SIZE, port,
+                                 TASK_PRIORITY, nullptr);
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "Création tâche VE.Direct échouée");
         return ESP_ERR_NO_MEM;
     }
+    return ESP_OK;
+}
+
+esp_err_t bmu_vedirect_init(void)
+{
+    if (s_initialized) {
+        return ESP_OK;
+    }
+
+    // Données publiques initialisées à zéro
+    memset(s_chargers, 0, sizeof(s_chargers));
+
+#if VEDIRECT_MUX
+    uint64_t sel_mask = 0;
+    if (CONFIG_BMU_VEDIRECT_MUX_SEL0_GPIO >= 0) sel_mask |= 1ULL << CONFIG_BMU_VEDIRECT_MUX_SEL0_GPIO;
+    if (CONFIG_BMU_VEDIRECT_MUX_SEL1_GPIO >= 0) sel_mask |= 1ULL << CONFIG_BMU_VEDIRECT_MUX_SEL1_GPIO;
+    if (sel_mask != 0) {
+        const gpio_config_t io = {
+            .pin_bit_mask = sel_mask,
+            .mode         = GPIO_MODE_OUTPUT,
+            .pull_up_en   = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type    = GPIO_INTR_DISABLE,
+        };
+        esp_err_t err = gpio_config(&io);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "gpio_config multiplexeur échoué: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+#endif
+
+    for (uint8_t i = 0; i < N_PORTS; i++) {
+        esp_err_t err = port_open(&s_ports[i], i);
+        if (err != ESP_OK) return err;
+    }
 
     s_initialized = true;
-    ESP_LOGI(TAG, "VE.Direct initialisé sur UART%d", CONFIG_BMU_VEDIRECT_UART_NUM);
+    ESP_LOGI(TAG, "VE.Direct initialisé : %u chargeur(s) sur %u UART%s",
+             N_CHARGERS, N_PORTS, VEDIRECT_MUX ? " (multiplexeur)" : "");
     return ESP_OK;
 }
 
-const bmu_vedirect_data_t *bmu_vedirect_get_data(void)
+uint8_t bmu_vedirect_count(void)
+{
+    return N_CHARGERS;
+}
+
+bool bmu_vedirect_get_solar(bmu_vedirect_solar_t *out)
+{
+    bmu_vedirect_data_t frames[N_CHARGERS];
+
+    portENTER_CRITICAL(&s_spinlock);
+    for (uint8_t i = 0; i < N_CHARGERS; i++) frames[i] = s_chargers[i].data;
+    portEXIT_CRITICAL(&s_spinlock);
+
+    bmu_vedirect_solar_aggregate(frames, N_CHARGERS, now_ms(), CONNECTION_TIMEOUT_MS, out);
+    return out->n_online > 0;
+}
+
+bool bmu_vedirect_get_charger(uint8_t idx, bmu_vedirect_data_t *out)
 {
-    return &s_public;
+    if (idx >= N_CHARGERS) return false;
+
+    portENTER_CRITICAL(&s_spinlock);
+    *out = s_chargers[idx].data;
+    portEXIT_CRITICAL(&s_spinlock);
+
+    return out->last_update_ms > 0;
 }
 
 bool bmu_vedirect_is_connected(void)
 {
-    int64_t now_ms = esp_timer_get_time() / 1000;
-    int64_t last;
+    int64_t t = now_ms();
+    bool any = false;
 
     portENTER_CRITICAL(&s_spinlock);
-    last = s_public.last_update_ms;
+    for (uint8_t i = 0; i < N_CHARGERS && !any; i++) {
+        int64_t last = s_chargers[i].data.last_update_ms;
+        any = (last > 0) && ((t - last) < CONNECTION_TIMEOUT_MS);
+    }
     portEXIT_CRITICAL(&s_spinlock);
 
-    return (last > 0) && ((now_ms - last) < CONNECTION_TIMEOUT_MS);
+    return any;
+}
+
+esp_err_t bmu_vedirect_hex_get(uint8_t idx, uint16_t reg)
+{
+    if (!s_initialized) return ESP_ERR_INVALID_STATE;
+    if (idx >= N_CHARGERS) return ESP_ERR_INVALID_ARG;
+
+    port_t *port = &s_ports[VEDIRECT_MUX ? 0 : idx];
+    if (PORT_CFG[port->index].tx_gpio < 0) return ESP_ERR_NOT_SUPPORTED;
+
+#if VEDIRECT_MUX
+    // Émise par la tâche au prochain passage sur ce canal
+    charger_t &c = s_chargers[idx];
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_spinlock);
+    bool queued = false;
+    for (uint8_t i = 0; i < c.hex_queued && !queued; i++) queued = c.hex_queue[i] == reg;
+    if (!queued) {
+        if (c.hex_queued < HEX_QUEUE_LEN) c.hex_queue[c.hex_queued++] = reg;
+        else ret = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&s_spinlock);
+    return ret;
+#else
+    char cmd[16];
+    size_t n = bmu_vedirect_hex_encode_get(reg, cmd, sizeof(cmd));
+    int written = uart_write_bytes(port->uart, cmd, n);
+    return written == (int)n ? ESP_OK : ESP_FAIL;
+#endif
+}
+
+bool bmu_vedirect_hex_read(uint8_t idx, uint16_t reg, uint32_t *value, int64_t *age_ms)
+{
+    if (idx >= N_CHARGERS) return false;
+
+    bool found = false;
+    int64_t t_ms = 0;
+
+    portENTER_CRITICAL(&s_spinlock);
+    for (const auto &e : s_chargers[idx].regs) {
+        if (e.t_ms != 0 && e.reg == reg) {
+            if (value) *value = e.value;
+            t_ms = e.t_ms;
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_spinlock);
+
+    if (found && age_ms) *age_ms = now_ms() - t_ms;
+    return found;
+}
+
+void bmu_vedirect_get_stats(bmu_vedirect_parser_stats_t *out)
+{
+    // Compteurs 32 bits écrits par la seule tâche du port : lecture tolérée
+    memset(out, 0, sizeof(*out));
+    for (const auto &port : s_ports) {
+        out->frames_ok  += port.parser.stats.frames_ok;
+        out->frames_bad += port.parser.stats.frames_bad;
+        out->hex_ok     += port.parser.stats.hex_ok;
+        out->hex_bad    += port.parser.stats.hex_bad;
+        out->bytes      += port.parser.stats.bytes;
+    }
+}
+
+bool bmu_vedirect_uses_gpio(int gpio)
+{
+    if (gpio < 0) return false;
+    for (const auto &cfg : PORT_CFG) {
+        if (cfg.rx_gpio == gpio || cfg.tx_gpio == gpio) return true;
+    }
+#if VEDIRECT_MUX
+    if (gpio == CONFIG_BMU_VEDIRECT_MUX_SEL0_GPIO || gpio == CONFIG_BMU_VEDIRECT_MUX_SEL1_GPIO) {
+        return true;
+    }
+#endif
+    return false;
 }
 
 #endif // CONFIG_BMU_VEDIRECT_ENABLED
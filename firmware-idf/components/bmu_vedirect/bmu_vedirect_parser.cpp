@@ -0,0 +1,362 @@
+/**
+ * bmu_vedirect_parser — Parser VE.Direct TEXT + HEX (voir bmu_vedirect_parser.h).
+ *
+ * Pas de dependance ESP-IDF (teste sur host, test_vedirect_parser). La
+ * machine d'etat suit l'implementation de reference Victron : ':' ouvre
+ * un message HEX dans tout etat sauf l'octet de checksum, et le '\n' final
+ * rend la main a l'etat TEXT interrompu.
+ */
+
+#include "bmu_vedirect_parser.h"
+
+#include <cstring>
+
+enum : uint8_t { ST_IDLE, ST_LABEL, ST_VALUE, ST_CHECKSUM, ST_HEX };
+
+/* ── Labels : hachage parfait ────────────────────────────────────── */
+
+enum Field : uint8_t {
+    F_V, F_I, F_VPV, F_PPV, F_CS, F_MPPT, F_ERR, F_H19, F_H20, F_H21,
+    F_PID, F_SER, F_FW, F_LOAD, F_CHECKSUM, F_COUNT, F_NONE = 0xFF,
+};
+
+struct label_t {
+    const char *name;
+    uint8_t     len;
+};
+
+/* Ordre = enum Field */
+static constexpr label_t LABELS[F_COUNT] = {
+    { "V", 1 }, { "I", 1 }, { "VPV", 3 }, { "PPV", 3 }, { "CS", 2 },
+    { "MPPT", 4 }, { "ERR", 3 }, { "H19", 3 }, { "H20", 3 }, { "H21", 3 },
+    { "PID", 3 }, { "SER#", 4 }, { "FW", 2 }, { "LOAD", 4 }, { "Checksum", 8 },
+};
+
+static constexpr uint8_t HASH_SLOTS = 32;
+
+/* Premier, deuxieme et dernier caractere + longueur : sans collision sur
+ * LABELS (verifie ci-dessous). Les labels inconnus (AR, OR, HSDS, ...)
+ * tombent sur une case vide ou echouent a la comparaison. */
+static constexpr uint8_t label_hash(const char *s, uint8_t len)
+{
+    return (uint8_t)(((uint8_t)s[0] + (len > 1 ? (uint8_t)s[1] : 0) +
+                      6u * (uint8_t)s[len - 1] + len) & (HASH_SLOTS - 1));
+}
+
+struct hash_table_t {
+    uint8_t slot[HASH_SLOTS];
+};
+
+static constexpr hash_table_t build_table()
+{
+    hash_table_t t = {};
+    for (uint8_t i = 0; i < HASH_SLOTS; i++) t.slot[i] = F_NONE;
+    for (uint8_t f = 0; f < F_COUNT; f++) {
+        t.slot[label_hash(LABELS[f].name, LABELS[f].len)] = f;
+    }
+    return t;
+}
+
+static constexpr bool table_is_perfect()
+{
+    hash_table_t t = build_table();
+    for (uint8_t f = 0; f < F_COUNT; f++) {
+        if (t.slot[label_hash(LABELS[f].name, LABELS[f].len)] != f) return false;
+    }
+    return true;
+}
+
+static constexpr hash_table_t LABEL_TABLE = build_table();
+static_assert(table_is_perfect(), "collision dans le hachage des labels VE.Direct");
+
+static Field lookup_label(const char *s, uint8_t len)
+{
+    if (len == 0) return F_NONE;
+    uint8_t f = LABEL_TABLE.slot[label_hash(s, len)];
+    if (f == F_NONE || LABELS[f].len != len) return F_NONE;
+    /* Labels de 1 a 8 caracteres : boucle courte plutot qu'un appel memcmp */
+    for (uint8_t i = 0; i < len; i++) {
+        if (LABELS[f].name[i] != s[i]) return F_NONE;
+    }
+    return (Field)f;
+}
+
+/* ── Valeurs ─────────────────────────────────────────────────────── */
+
+/* Entier decimal signe (semantique atoi : arret au premier non-chiffre) */
+static int32_t parse_int(const char *s)
+{
+    bool neg = *s == '-';
+    if (neg || *s == '+') s++;
+    int32_t v = 0;
+    while (*s >= '0' && *s <= '9') {
+        if (v < 214748364) v = v * 10 + (*s - '0');
+        s++;
+    }
+    return neg ? -v : v;
+}
+
+static void copy_str(char *dst, size_t cap, const char *src, size_t len)
+{
+    if (len > cap - 1) len = cap - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void parse_field(Field f, const char *value, size_t len, bmu_vedirect_data_t *frame)
+{
+    switch (f) {
+    case F_V:    frame->battery_voltage_v = parse_int(value) / 1000.0f; break;
+    case F_I:    frame->battery_current_a = parse_int(value) / 1000.0f; break;
+    case F_VPV:  frame->panel_voltage_v   = parse_int(value) / 1000.0f; break;
+    case F_PPV:  frame->panel_power_w     = (uint16_t)parse_int(value); break;
+    case F_CS:   frame->charge_state      = (uint8_t)parse_int(value); break;
+    case F_MPPT: frame->mppt_state        = (uint8_t)parse_int(value); break;
+    case F_ERR:  frame->error_code        = (uint8_t)parse_int(value); break;
+    case F_H19:  frame->yield_total_wh    = (uint32_t)(parse_int(value) * 10); break;  // 0.01kWh → Wh
+    case F_H20:  frame->yield_today_wh    = (uint32_t)(parse_int(value) * 10); break;
+    case F_H21:  frame->max_power_today_w = (uint16_t)parse_int(value); break;
+    case F_PID:  copy_str(frame->product_id, sizeof(frame->product_id), value, len); break;
+    case F_SER:  copy_str(frame->serial, sizeof(frame->serial), value, len); break;
+    case F_FW:   copy_str(frame->firmware, sizeof(frame->firmware), value, len); break;
+    case F_LOAD: frame->load_on = strcmp(value, "ON") == 0; break;
+    default: break;
+    }
+}
+
+/* ── HEX ─────────────────────────────────────────────────────────── */
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+size_t bmu_vedirect_hex_encode(uint8_t cmd, const uint8_t *data, size_t len,
+                               char *out, size_t cap)
+{
+    size_t need = 2 + 2 * (len + 1) + 1;
+    if (cmd > 0xF || cap < need + 1) return 0;
+
+    char *o = out;
+    uint8_t sum = cmd;
+    *o++ = ':';
+    *o++ = HEX_DIGITS[cmd];
+    for (size_t i = 0; i < len; i++) {
+        sum += data[i];
+        *o++ = HEX_DIGITS[data[i] >> 4];
+        *o++ = HEX_DIGITS[data[i] & 0xF];
+    }
+    uint8_t cs = (uint8_t)(0x55 - sum);
+    *o++ = HEX_DIGITS[cs >> 4];
+    *o++ = HEX_DIGITS[cs & 0xF];
+    *o++ = '\n';
+    *o = '\0';
+    return need;
+}
+
+size_t bmu_vedirect_hex_encode_get(uint16_t reg, char *out, size_t cap)
+{
+    const uint8_t d[3] = { (uint8_t)reg, (uint8_t)(reg >> 8), 0 };
+    return bmu_vedirect_hex_encode(BMU_VEDIRECT_HEX_GET, d, sizeof(d), out, cap);
+}
+
+size_t bmu_vedirect_hex_encode_set(uint16_t reg, uint32_t value, uint8_t value_len,
+                                   char *out, size_t cap)
+{
+    if (value_len < 1 || value_len > 4) return 0;
+    uint8_t d[7] = { (uint8_t)reg, (uint8_t)(reg >> 8), 0 };
+    for (uint8_t i = 0; i < value_len; i++) d[3 + i] = (uint8_t)(value >> (8 * i));
+    return bmu_vedirect_hex_encode(BMU_VEDIRECT_HEX_SET, d, 3u + value_len, out, cap);
+}
+
+/* Ligne HEX complete (sans ':' ni '\n') */
+static bool hex_decode(const char *s, size_t n, bmu_vedirect_hex_msg_t *m)
+{
+    /* Commande + au moins le checksum, octets entiers */
+    if (n < 3 || (n - 1) % 2 != 0) return false;
+    int cmd = hex_nibble(s[0]);
+    if (cmd < 0) return false;
+
+    size_t nbytes = (n - 1) / 2;
+    if (nbytes - 1 > BMU_VEDIRECT_HEX_MAX_DATA) return false;
+    uint8_t sum = (uint8_t)cmd;
+    memset(m, 0, sizeof(*m));
+    for (size_t i = 0; i < nbytes; i++) {
+        int hi = hex_nibble(s[1 + 2 * i]);
+        int lo = hex_nibble(s[2 + 2 * i]);
+        if (hi < 0 || lo < 0) return false;
+        uint8_t b = (uint8_t)((hi << 4) | lo);
+        sum += b;
+        if (i < nbytes - 1) m->data[i] = b;
+    }
+    if (sum != 0x55) return false;
+
+    m->cmd = (uint8_t)cmd;
+    m->len = (uint8_t)(nbytes - 1);
+    if ((cmd == BMU_VEDIRECT_HEX_GET || cmd == BMU_VEDIRECT_HEX_SET ||
+         cmd == BMU_VEDIRECT_HEX_ASYNC) && m->len >= 3) {
+        m->reg = (uint16_t)(m->data[0] | (m->data[1] << 8));
+        m->flags = m->data[2];
+        m->value_len = (uint8_t)(m->len - 3 > 4 ? 4 : m->len - 3);
+        for (uint8_t i = 0; i < m->value_len; i++) {
+            m->value |= (uint32_t)m->data[3 + i] << (8 * i);
+        }
+    }
+    return true;
+}
+
+/* ── Parser ──────────────────────────────────────────────────────── */
+
+void bmu_vedirect_parser_init(bmu_vedirect_parser_t *p, bmu_vedirect_frame_fn_t on_frame,
+                              bmu_vedirect_hex_fn_t on_hex, void *arg)
+{
+    memset(p, 0, sizeof(*p));
+    p->on_frame = on_frame;
+    p->on_hex = on_hex;
+    p->arg = arg;
+    p->state = ST_IDLE;
+}
+
+void bmu_vedirect_parser_reset(bmu_vedirect_parser_t *p)
+{
+    memset(&p->staging, 0, sizeof(p->staging));
+    p->state = ST_IDLE;
+    p->checksum = 0;
+    p->label_len = 0;
+    p->value_len = 0;
+    p->hex_len = 0;
+}
+
+static void end_hex(bmu_vedirect_parser_t *p)
+{
+    bmu_vedirect_hex_msg_t msg;
+    if (hex_decode(p->hex, p->hex_len, &msg)) {
+        p->stats.hex_ok++;
+        if (p->on_hex) p->on_hex(&msg, p->arg);
+    } else {
+        p->stats.hex_bad++;
+    }
+}
+
+static void end_frame(bmu_vedirect_parser_t *p, uint8_t sum)
+{
+    /* L'octet de checksum est deja dans la somme : trame correcte = 0 */
+    if (sum == 0) {
+        p->stats.frames_ok++;
+        p->staging.valid = true;
+        if (p->on_frame) p->on_frame(&p->staging, p->arg);
+    } else {
+        p->stats.frames_bad++;
+    }
+    memset(&p->staging, 0, sizeof(p->staging));
+}
+
+/* Longueur de la portion de label/valeur qui suit dans le bloc : jusqu'a
+ * stop, fin de ligne ou ':' (debut HEX). Ajoute ses octets a la somme. */
+static size_t scan_run(const uint8_t *s, const uint8_t *end, uint8_t stop, uint8_t *sum)
+{
+    const uint8_t *q = s;
+    uint8_t acc = *sum;
+    while (q < end && *q != stop && *q != '\r' && *q != '\n' && *q != ':') acc = (uint8_t)(acc + *q++);
+    *sum = acc;
+    return (size_t)(q - s);
+}
+
+void bmu_vedirect_parser_feed(bmu_vedirect_parser_t *p, const uint8_t *buf, size_t len)
+{
+    p->stats.bytes += (uint32_t)len;
+
+    /* Etat en registres pendant le bloc, recopie dans p a la fin */
+    const uint8_t *s = buf;
+    const uint8_t *const end = buf + len;
+    uint8_t state = p->state;
+    uint8_t sum = p->checksum;
+
+    while (s < end) {
+        const uint8_t c = *s++;
+
+        if (state == ST_HEX) {
+            if (c == '\n') {
+                end_hex(p);
+                state = p->hex_prev_state;
+            } else if (c != '\r') {
+                if (p->hex_len < sizeof(p->hex)) {
+                    p->hex[p->hex_len++] = (char)c;
+                } else {
+                    p->stats.hex_bad++;           /* trop long : abandon */
+                    state = p->hex_prev_state;
+                }
+            }
+            continue;
+        }
+        if (c == ':' && state != ST_CHECKSUM) {
+            p->hex_prev_state = state;
+            p->hex_len = 0;
+            state = ST_HEX;
+            continue;
+        }
+
+        // Tous les octets TEXT participent au checksum (y compris \r, \n, \t)
+        sum = (uint8_t)(sum + c);
+
+        switch (state) {
+        case ST_IDLE:
+            if (c != '\r' && c != '\n') {
+                p->label[0] = (char)c;
+                p->label_len = 1;
+                state = ST_LABEL;
+            }
+            break;
+
+        case ST_LABEL:
+            if (c == '\t') {
+                Field f = lookup_label(p->label, p->label_len);
+                p->field = f;
+                p->value_len = 0;
+                state = f == F_CHECKSUM ? ST_CHECKSUM : ST_VALUE;
+            } else {
+                /* Reste du label d'un coup plutot qu'octet par octet */
+                size_t n = scan_run(s, end, '\t', &sum);
+                if (p->label_len + 1 + n > sizeof(p->label) - 1) {
+                    p->label_len = sizeof(p->label);  /* trop long : inconnu */
+                } else {
+                    p->label[p->label_len++] = (char)c;
+                    memcpy(p->label + p->label_len, s, n);
+                    p->label_len = (uint8_t)(p->label_len + n);
+                }
+                s += n;
+            }
+            break;
+
+        case ST_VALUE:
+            if (c == '\r' || c == '\n') {
+                p->value[p->value_len] = '\0';
+                parse_field((Field)p->field, p->value, p->value_len, &p->staging);
+                state = ST_IDLE;
+            } else {
+                /* Valeur tronquee a sizeof(value) - 1, comme avant */
+                size_t n = scan_run(s, end, '\r', &sum);
+                size_t room = sizeof(p->value) - 1 - p->value_len;
+                size_t k = 1 + n < room ? 1 + n : room;
+                memcpy(p->value + p->value_len, s - 1, k);
+                p->value_len = (uint8_t)(p->value_len + k);
+                s += n;
+            }
+            break;
+
+        case ST_CHECKSUM:
+            end_frame(p, sum);
+            sum = 0;
+            state = ST_IDLE;
+            break;
+        }
+    }
+
+    p->state = state;
+    p->checksum = sum;
+}
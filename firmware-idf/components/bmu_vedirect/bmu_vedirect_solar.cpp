@@ -0,0 +1,88 @@
+/**
+ * bmu_vedirect_solar — Agregation multi-chargeurs (voir bmu_vedirect_solar.h).
+ *
+ * Pas de dependance ESP-IDF (teste sur host, test_vedirect_solar).
+ */
+
+#include "bmu_vedirect_solar.h"
+
+#include <cstring>
+
+uint8_t bmu_vedirect_cs_rank(uint8_t cs)
+{
+    switch (cs) {
+    case 2:   return 7;    // Fault : masque tout le reste
+    case 3:   return 6;    // Bulk
+    case 4:   return 5;    // Absorption
+    case 7:   return 4;    // Equalize
+    case 5:   return 3;    // Float
+    case 245: return 2;    // Starting
+    case 252: return 1;    // External
+    default:  return 0;    // Off, inconnu
+    }
+}
+
+static bool seen(const bmu_vedirect_data_t *d)
+{
+    return d->valid && d->last_update_ms > 0;
+}
+
+void bmu_vedirect_solar_aggregate(const bmu_vedirect_data_t *chargers, uint8_t n,
+                                  int64_t now_ms, int64_t stale_ms,
+                                  bmu_vedirect_solar_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (n > BMU_VEDIRECT_MAX_CHARGERS) n = BMU_VEDIRECT_MAX_CHARGERS;
+    out->n_chargers = n;
+
+    bmu_vedirect_data_t *t = &out->total;
+    float v_sum = 0.0f;
+    int primary = -1;
+    uint32_t ppv = 0;
+
+    for (uint8_t i = 0; i < n; i++) {
+        const bmu_vedirect_data_t *d = &chargers[i];
+        out->age_ms[i] = -1;
+        if (!seen(d)) continue;
+
+        int64_t age = now_ms - d->last_update_ms;
+        out->age_ms[i] = age > INT32_MAX ? INT32_MAX : (int32_t)age;
+
+        /* Energie du jour : acquise meme si le chargeur ne repond plus,
+         * tant qu'elle peut encore dater d'aujourd'hui */
+        t->yield_total_wh += d->yield_total_wh;
+        if (age < BMU_VEDIRECT_DAILY_HOLD_MS) {
+            t->yield_today_wh   += d->yield_today_wh;
+            t->max_power_today_w = (uint16_t)(t->max_power_today_w + d->max_power_today_w);
+        }
+
+        if (age >= stale_ms) continue;
+
+        out->n_online++;
+        out->online_mask |= (uint8_t)(1u << i);
+        ppv += d->panel_power_w;
+        t->battery_current_a += d->battery_current_a;
+        v_sum += d->battery_voltage_v;
+        if (bmu_vedirect_cs_rank(d->charge_state) > bmu_vedirect_cs_rank(t->charge_state) ||
+            out->n_online == 1) {
+            t->charge_state = d->charge_state;
+        }
+        if (d->mppt_state > t->mppt_state) t->mppt_state = d->mppt_state;
+        if (t->error_code == 0) t->error_code = d->error_code;
+        t->load_on = t->load_on || d->load_on;
+        if (d->last_update_ms > t->last_update_ms) t->last_update_ms = d->last_update_ms;
+        if (primary < 0 || d->panel_power_w > chargers[primary].panel_power_w) primary = i;
+    }
+
+    if (out->n_online == 0) return;
+
+    const bmu_vedirect_data_t *p = &chargers[primary];
+    out->primary         = (uint8_t)primary;
+    t->panel_power_w     = ppv > UINT16_MAX ? UINT16_MAX : (uint16_t)ppv;
+    t->battery_voltage_v = v_sum / out->n_online;
+    t->panel_voltage_v   = p->panel_voltage_v;
+    memcpy(t->product_id, p->product_id, sizeof(t->product_id));
+    memcpy(t->serial, p->serial, sizeof(t->serial));
+    memcpy(t->firmware, p->firmware, sizeof(t->firmware));
+    t->valid = true;
+}
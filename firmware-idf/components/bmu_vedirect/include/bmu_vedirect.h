@@ -2,37 +2,51 @@
 #include "esp_err.h"
 #include <stdbool.h>
 #include <stdint.h>
+#include "bmu_vedirect_parser.h"
+#include "bmu_vedirect_solar.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef struct {
-    float    battery_voltage_v;    // V label (mV → V)
-    float    battery_current_a;    // I label (mA → A)
-    float    panel_voltage_v;      // VPV (mV → V)
-    uint16_t panel_power_w;        // PPV
-    uint8_t  charge_state;         // CS (0=Off, 3=Bulk, 4=Absorption, 5=Float)
-    uint8_t  mppt_state;           // MPPT (0=Off, 1=Limited, 2=Active)
-    uint8_t  error_code;           // ERR
-    uint32_t yield_total_wh;       // H19 (0.01kWh → Wh)
-    uint32_t yield_today_wh;       // H20 (0.01kWh → Wh)
-    uint16_t max_power_today_w;    // H21
-    char     product_id[8];        // PID
-    char     serial[20];           // SER#
-    char     firmware[8];          // FW
-    bool     load_on;              // LOAD
-    bool     valid;                // Checksum verified
-    int64_t  last_update_ms;       // Timestamp of last valid frame
-} bmu_vedirect_data_t;
-
 // Charge state names
 const char *bmu_vedirect_cs_name(uint8_t cs);
 
 esp_err_t bmu_vedirect_init(void);
-const bmu_vedirect_data_t *bmu_vedirect_get_data(void);
+
+// Nombre de chargeurs configurés (0 si VE.Direct désactivé)
+uint8_t bmu_vedirect_count(void);
+
+// Au moins un chargeur à jour
 bool bmu_vedirect_is_connected(void);
 
+// Modèle solaire agrégé de tous les chargeurs (voir bmu_vedirect_solar.h).
+// false si aucun chargeur à jour (out rempli quand même : âges, rendements).
+bool bmu_vedirect_get_solar(bmu_vedirect_solar_t *out);
+
+// Copie de la dernière trame valide d'un chargeur ; false si jamais reçue.
+bool bmu_vedirect_get_charger(uint8_t idx, bmu_vedirect_data_t *out);
+
+// HEX : requête GET non bloquante (réponse mise en cache par la tâche,
+// lue par bmu_vedirect_hex_read). ESP_ERR_NOT_SUPPORTED si aucune broche
+// TX n'est configurée pour ce chargeur.
+// Multiplexeur : la requête est mise en file (4 registres par chargeur,
+// ESP_ERR_NO_MEM si pleine) et émise au début du prochain passage sur ce
+// canal, soit au plus un tour de multiplexeur plus tard. Le canal reste
+// sélectionné jusqu'à la réponse ou 500 ms, la trame TEXT reçue ne
+// provoque donc pas la commutation avant.
+esp_err_t bmu_vedirect_hex_get(uint8_t idx, uint16_t reg);
+
+// Dernière valeur reçue pour un registre (réponse GET ou message ASYNC).
+// age_ms (optionnel) : ancienneté de la valeur. false si jamais reçue.
+bool bmu_vedirect_hex_read(uint8_t idx, uint16_t reg, uint32_t *value, int64_t *age_ms);
+
+// Compteurs cumulés de tous les ports
+void bmu_vedirect_get_stats(bmu_vedirect_parser_stats_t *out);
+
+// GPIO utilisé par VE.Direct (RX, TX, sélection du multiplexeur)
+bool bmu_vedirect_uses_gpio(int gpio);
+
 #ifdef __cplusplus
 }
 #endif
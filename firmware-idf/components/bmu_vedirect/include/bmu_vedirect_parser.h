@@ -0,0 +1,132 @@
+/**
+ * @file bmu_vedirect_parser.h
+ * @brief Parser VE.Direct sans E/S : protocole TEXT (trames 1 Hz) et
+ *        protocole HEX (registres), entrelaces sur la meme liaison.
+ *
+ * TEXT : LABEL\tVALUE\r\n ... Checksum\t<octet>, somme de la trame = 0.
+ *        Labels dispatches par hachage parfait verifie a la compilation.
+ * HEX  : ':' <commande 1 chiffre> <octets en hex> <checksum> '\n', somme de
+ *        la commande et des octets = 0x55. Un message HEX peut couper une
+ *        trame TEXT ; il n'entre pas dans la somme TEXT.
+ *
+ * Le parser consomme des blocs de n'importe quelle taille (lecture UART
+ * par paquets) et rappelle on_frame / on_hex.
+ *
+ * Aucune dependance ESP-IDF : teste sur host (test_vedirect_parser).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    float    battery_voltage_v;    // V label (mV → V)
+    float    battery_current_a;    // I label (mA → A)
+    float    panel_voltage_v;      // VPV (mV → V)
+    uint16_t panel_power_w;        // PPV
+    uint8_t  charge_state;         // CS (0=Off, 3=Bulk, 4=Absorption, 5=Float)
+    uint8_t  mppt_state;           // MPPT (0=Off, 1=Limited, 2=Active)
+    uint8_t  error_code;           // ERR
+    uint32_t yield_total_wh;       // H19 (0.01kWh → Wh)
+    uint32_t yield_today_wh;       // H20 (0.01kWh → Wh)
+    uint16_t max_power_today_w;    // H21
+    char     product_id[8];        // PID
+    char     serial[20];           // SER#
+    char     firmware[8];          // FW
+    bool     load_on;              // LOAD
+    bool     valid;                // Checksum verified
+    int64_t  last_update_ms;       // Timestamp of last valid frame
+} bmu_vedirect_data_t;
+
+/* ── HEX ─────────────────────────────────────────────────────────── */
+
+enum {
+    BMU_VEDIRECT_HEX_PING     = 0x1,   /**< Reponse : 0x5 version firmware */
+    BMU_VEDIRECT_HEX_APP_VER  = 0x3,
+    BMU_VEDIRECT_HEX_PROD_ID  = 0x4,
+    BMU_VEDIRECT_HEX_GET      = 0x7,
+    BMU_VEDIRECT_HEX_SET      = 0x8,
+    BMU_VEDIRECT_HEX_ASYNC    = 0xA,   /**< Emis par l'appareil sans requete */
+};
+
+/* Drapeaux des reponses GET / SET / ASYNC */
+#define BMU_VEDIRECT_HEX_F_UNKNOWN_ID   0x01
+#define BMU_VEDIRECT_HEX_F_NOT_SUPP     0x02
+#define BMU_VEDIRECT_HEX_F_PARAM_ERR    0x04
+
+#define BMU_VEDIRECT_HEX_MAX_DATA   32     /**< Octets apres la commande */
+#define BMU_VEDIRECT_HEX_MAX_LINE   (2 + 2 * (BMU_VEDIRECT_HEX_MAX_DATA + 1) + 1)
+
+typedef struct {
+    uint8_t  cmd;                  /**< Chiffre de commande / reponse */
+    uint8_t  len;                  /**< Octets dans data (checksum exclu) */
+    uint8_t  data[BMU_VEDIRECT_HEX_MAX_DATA];
+    /* GET / SET / ASYNC : data = reg (LE 16) | flags | valeur */
+    uint16_t reg;
+    uint8_t  flags;
+    uint32_t value;                /**< Valeur little-endian (<= 4 octets) */
+    uint8_t  value_len;
+} bmu_vedirect_hex_msg_t;
+
+/**
+ * @brief Encode une commande HEX ":<cmd><data><cs>\n".
+ * @return longueur ecrite (sans '\0'), 0 si cap insuffisant
+ */
+size_t bmu_vedirect_hex_encode(uint8_t cmd, const uint8_t *data, size_t len,
+                               char *out, size_t cap);
+
+/** GET registre : ":7<reg LE><00><cs>\n" */
+size_t bmu_vedirect_hex_encode_get(uint16_t reg, char *out, size_t cap);
+
+/** SET registre, valeur little-endian sur value_len octets (1..4) */
+size_t bmu_vedirect_hex_encode_set(uint16_t reg, uint32_t value, uint8_t value_len,
+                                   char *out, size_t cap);
+
+/* ── Parser ──────────────────────────────────────────────────────── */
+
+typedef void (*bmu_vedirect_frame_fn_t)(const bmu_vedirect_data_t *frame, void *arg);
+typedef void (*bmu_vedirect_hex_fn_t)(const bmu_vedirect_hex_msg_t *msg, void *arg);
+
+typedef struct {
+    uint32_t frames_ok;
+    uint32_t frames_bad;           /**< Checksum TEXT invalide */
+    uint32_t hex_ok;
+    uint32_t hex_bad;              /**< Chiffre invalide, somme != 0x55, trop long */
+    uint32_t bytes;
+} bmu_vedirect_parser_stats_t;
+
+typedef struct {
+    bmu_vedirect_frame_fn_t on_frame;
+    bmu_vedirect_hex_fn_t   on_hex;
+    void                   *arg;
+
+    bmu_vedirect_data_t     staging;
+    bmu_vedirect_parser_stats_t stats;
+    uint8_t  state;
+    uint8_t  hex_prev_state;       /**< Etat TEXT a reprendre apres le HEX */
+    uint8_t  checksum;
+    uint8_t  field;                /**< Label resolu, en attente de la valeur */
+    uint8_t  label_len;
+    uint8_t  value_len;
+    uint8_t  hex_len;
+    char     label[16];
+    char     value[32];
+    char     hex[BMU_VEDIRECT_HEX_MAX_LINE];
+} bmu_vedirect_parser_t;
+
+void bmu_vedirect_parser_init(bmu_vedirect_parser_t *p, bmu_vedirect_frame_fn_t on_frame,
+                              bmu_vedirect_hex_fn_t on_hex, void *arg);
+
+/** Perte de donnees (debordement UART) : resynchronisation sur la trame suivante */
+void bmu_vedirect_parser_reset(bmu_vedirect_parser_t *p);
+
+void bmu_vedirect_parser_feed(bmu_vedirect_parser_t *p, const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file bmu_vedirect_solar.h
+ * @brief Modele solaire de flotte : agrege les trames de plusieurs chargeurs
+ *        MPPT VE.Direct en une vue « chargeur unique ».
+ *
+ * Un chargeur est en ligne si sa derniere trame valide date de moins de
+ * stale_ms. Regles d'agregation (chargeurs en ligne) :
+ *   PPV, I                   → somme
+ *   V batterie               → moyenne (meme bus)
+ *   VPV, PID, SER#, FW       → chargeur principal (PPV maximale)
+ *   CS                       → etat le plus significatif (Fault > Bulk > ...)
+ *   ERR                      → premier code non nul
+ *   H19                      → somme sur les chargeurs deja vus, meme
+ *                              perimes (compteur a vie)
+ *   H20, H21                 → somme sur les chargeurs vus depuis moins de
+ *                              BMU_VEDIRECT_DAILY_HOLD_MS : l'energie du jour
+ *                              reste acquise apres une coupure, mais un
+ *                              chargeur muet ne reporte pas la veille
+ *
+ * Aucune dependance ESP-IDF : teste sur host (test_vedirect_solar).
+ */
+#pragma once
+
+#include "bmu_vedirect_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMU_VEDIRECT_MAX_CHARGERS   4
+
+/* Pas d'heure murale ici : borne d'age des valeurs journalieres (H20, H21)
+ * d'un chargeur perime. 8 h couvre une coupure en journee. */
+#define BMU_VEDIRECT_DAILY_HOLD_MS  (8LL * 3600 * 1000)
+
+typedef struct {
+    bmu_vedirect_data_t total;     /**< valid = au moins un chargeur en ligne */
+    uint8_t  n_chargers;           /**< Configures */
+    uint8_t  n_online;
+    uint8_t  online_mask;          /**< bit i = chargeur i a jour */
+    uint8_t  primary;              /**< Indice du chargeur principal */
+    int32_t  age_ms[BMU_VEDIRECT_MAX_CHARGERS];   /**< -1 = jamais vu */
+} bmu_vedirect_solar_t;
+
+/** Rang d'un etat CS pour l'agregation (plus grand = plus significatif) */
+uint8_t bmu_vedirect_cs_rank(uint8_t cs);
+
+void bmu_vedirect_solar_aggregate(const bmu_vedirect_data_t *chargers, uint8_t n,
+                                  int64_t now_ms, int64_t stale_ms,
+                                  bmu_vedirect_solar_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,15 +5,14 @@
 #include "bmu_vrm.h"
 #include "bmu_vedirect.h"
 #include "bmu_config.h"
-#include "bmu_protection.h"
-#include "bmu_battery_manager.h"
+#include "bmu_telemetry.h"
+#include "bmu_rbe.h"
+#include "bmu_vrm_delta.h"
 
 #include "mqtt_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 
 #include <cstdio>
 #include <cstring>
@@ -22,47 +21,83 @@ static const char *TAG = "VRM";
 
 static esp_mqtt_client_handle_t s_client = NULL;
 static bool s_connected = false;
-static bmu_protection_ctx_t *s_prot = NULL;
-static bmu_battery_manager_t *s_mgr = NULL;
-static uint8_t s_nb_ina = 0;
+static uint32_t s_last_keepalive_ms = 0;
+
+/* Report-by-exception par chemin (bmu_vrm_delta.h) : seuls les chemins dont
+ * la valeur publiée a changé partent, tous dans le même passage du sink.
+ * Le keepalive (CONFIG_BMU_VRM_PUBLISH_INTERVAL_S) republie tout : VRM
+ * expire les valeurs qui ne sont pas rafraîchies. */
+#if CONFIG_BMU_RBE_ENABLED
+#define VRM_TICK_MS       BMU_RBE_TICK_MS
+#else
+#define VRM_TICK_MS       (CONFIG_BMU_VRM_PUBLISH_INTERVAL_S * 1000)
+#endif
+
+enum {
+    P_SYS_SERIAL = 0,
+    P_BAT_V, P_BAT_I, P_BAT_SOC, P_BAT_AH,
+    P_SOL_PV_V, P_SOL_PV_P, P_SOL_V, P_SOL_I, P_SOL_STATE,
+    P_SOL_YIELD, P_SOL_ERROR, P_SOL_PID, P_SOL_SERIAL,
+    P_COUNT
+};
+
+/* Bandes mortes dans l'unité publiée (V, A, %, Ah, W, kWh) */
+static bmu_vrm_path_t s_paths[P_COUNT] = {
+    { "system/0/Serial",               BMU_VRM_STR,   0.0f,                    0, false, 0 },
+    { "battery/0/Dc/0/Voltage",        BMU_VRM_FLOAT, BMU_RBE_DB_MV / 1000.0f, 0, false, 0 },
+    { "battery/0/Dc/0/Current",        BMU_VRM_FLOAT, BMU_RBE_DB_MA / 1000.0f, 0, false, 0 },
+    { "battery/0/Soc",                 BMU_VRM_FLOAT, 1.0f,                    0, false, 0 },
+    { "battery/0/ConsumedAmphours",    BMU_VRM_FLOAT, 0.1f,                    0, false, 0 },
+    { "solarcharger/0/Pv/V",           BMU_VRM_FLOAT, 0.5f,                    0, false, 0 },
+    { "solarcharger/0/Pv/P",           BMU_VRM_INT,   10.0f,                   0, false, 0 },
+    { "solarcharger/0/Dc/0/Voltage",   BMU_VRM_FLOAT, BMU_RBE_DB_MV / 1000.0f, 0, false, 0 },
+    { "solarcharger/0/Dc/0/Current",   BMU_VRM_FLOAT, BMU_RBE_DB_MA / 1000.0f, 0, false, 0 },
+    { "solarcharger/0/State",          BMU_VRM_INT,   0.0f,                    0, false, 0 },
+    { "solarcharger/0/Yield/User",     BMU_VRM_FLOAT, 0.0f,                    0, false, 0 },
+    { "solarcharger/0/ErrorCode",      BMU_VRM_INT,   0.0f,                    0, false, 0 },
+    { "solarcharger/0/ProductId",      BMU_VRM_STR,   0.0f,                    0, false, 0 },
+    { "solarcharger/0/Serial",         BMU_VRM_STR,   0.0f,                    0, false, 0 },
+};
+static char s_topics[P_COUNT * 64];    /* N/<portal>/<path>, formatés une fois */
+static bmu_vrm_delta_t s_delta;
 
 /* ── Helpers ── */
 
-static void vrm_publish(const char *path, const char *value_json)
+static void vrm_publish(uint8_t idx, const char *json, int len)
 {
-    if (!s_connected || s_client == NULL) return;
-    char topic[128];
-    snprintf(topic, sizeof(topic), "N/%s/%s",
-             CONFIG_BMU_VRM_PORTAL_ID, path);
-    /* Audit H11 : ne pas ignorer l'échec de publication (file pleine / broker
-     * déconnecté) — sinon trous de télémétrie VRM silencieux. */
-    if (esp_mqtt_client_publish(s_client, topic, value_json, 0, 0, 0) < 0) {
+    if (len <= 0) return;                       /* inchangé */
+    const char *topic = bmu_vrm_delta_topic(&s_delta, idx);
+    /* Sink du pipeline télémétrie : enqueue (outbox, envoi par la tâche MQTT)
+     * plutôt que publish, qui bloquerait le pipeline sur l'écriture TLS.
+     * Audit H11 : ne pas ignorer l'échec de publication (file pleine / broker
+     * déconnecté) — sinon trous de télémétrie VRM silencieux. Le chemin est
+     * invalidé pour repartir au tick suivant. */
+    if (!s_connected || s_client == NULL ||
+        esp_mqtt_client_enqueue(s_client, topic, json, len, 0, 0, true) < 0) {
         ESP_LOGW(TAG, "VRM publish échoué : %s", topic);
+        bmu_vrm_delta_invalidate(&s_delta, idx);
     }
 }
 
-static void vrm_pub_float(const char *path, float val)
+static void vrm_pub_float(uint8_t idx, float val)
 {
     char json[32];
-    snprintf(json, sizeof(json), "{\"value\":%.2f}", val);
-    vrm_publish(path, json);
+    vrm_publish(idx, json, bmu_vrm_delta_float(&s_delta, idx, val, json, sizeof(json)));
 }
 
-static void vrm_pub_int(const char *path, int val)
+static void vrm_pub_int(uint8_t idx, int val)
 {
     char json[32];
-    snprintf(json, sizeof(json), "{\"value\":%d}", val);
-    vrm_publish(path, json);
+    vrm_publish(idx, json, bmu_vrm_delta_int(&s_delta, idx, val, json, sizeof(json)));
 }
 
-static void vrm_pub_str(const char *path, const char *val)
+static void vrm_pub_str(uint8_t idx, const char *val)
 {
     char json[64];
-    snprintf(json, sizeof(json), "{\"value\":\"%s\"}", val);
-    vrm_publish(path, json);
+    vrm_publish(idx, json, bmu_vrm_delta_str(&s_delta, idx, val, json, sizeof(json)));
 }
 
-/* ── SOC estimation ── */
+/* ── SOC estimation (repli si l'EKF bmu_soc n'a pas encore convergé) ── */
 
 static float estimate_soc(float avg_v)
 {
@@ -78,47 +113,37 @@ static float estimate_soc(float avg_v)
 
 static void publish_solar(void)
 {
-    if (!bmu_vedirect_is_connected()) return;
-    const bmu_vedirect_data_t *d = bmu_vedirect_get_data();
-    if (!d || !d->valid) return;
-
-    vrm_pub_float("solarcharger/0/Pv/V", d->panel_voltage_v);
-    vrm_pub_int("solarcharger/0/Pv/P", (int)d->panel_power_w);
-    vrm_pub_float("solarcharger/0/Dc/0/Voltage", d->battery_voltage_v);
-    vrm_pub_float("solarcharger/0/Dc/0/Current", d->battery_current_a);
-    vrm_pub_int("solarcharger/0/State", (int)d->charge_state);
-    vrm_pub_float("solarcharger/0/Yield/User", (float)d->yield_today_wh / 1000.0f);
-    vrm_pub_int("solarcharger/0/ErrorCode", (int)d->error_code);
-    vrm_pub_str("solarcharger/0/ProductId", d->product_id);
-    vrm_pub_str("solarcharger/0/Serial", d->serial);
+    /* Un seul solarcharger VRM : modèle agrégé de tous les MPPT */
+    bmu_vedirect_solar_t solar;
+    if (!bmu_vedirect_get_solar(&solar)) return;
+    const bmu_vedirect_data_t *d = &solar.total;
+
+    vrm_pub_float(P_SOL_PV_V, d->panel_voltage_v);
+    vrm_pub_int(P_SOL_PV_P, (int)d->panel_power_w);
+    vrm_pub_float(P_SOL_V, d->battery_voltage_v);
+    vrm_pub_float(P_SOL_I, d->battery_current_a);
+    vrm_pub_int(P_SOL_STATE, (int)d->charge_state);
+    vrm_pub_float(P_SOL_YIELD, (float)d->yield_today_wh / 1000.0f);
+    vrm_pub_int(P_SOL_ERROR, (int)d->error_code);
+    vrm_pub_str(P_SOL_PID, d->product_id);
+    vrm_pub_str(P_SOL_SERIAL, d->serial);
 }
 
 /* ── Publish battery monitor ── */
 
-static void publish_battery(void)
+static void publish_battery(const bmu_telem_frame_t *f)
 {
-    if (s_nb_ina == 0 || s_mgr == NULL) return;
-
-    /* Utilise l'API bmu_battery_manager — pas d'acces direct aux ina_devices */
-    float avg_mv = 0.0f;
-    float total_i = 0.0f;
-    if (bmu_battery_manager_get_summary(s_mgr, &avg_mv, &total_i, NULL) != ESP_OK) {
-        return;
-    }
-    float avg_v  = avg_mv / 1000.0f;
-    float soc = estimate_soc(avg_v);
-
-    /* Cumul Ah decharge sur toutes les batteries */
-    float sum_ah_d = 0.0f;
-    int nb = s_nb_ina > BMU_MAX_BATTERIES ? BMU_MAX_BATTERIES : (int)s_nb_ina;
-    for (int i = 0; i < nb; i++) {
-        sum_ah_d += bmu_battery_manager_get_ah_discharge(s_mgr, i);
-    }
-
-    vrm_pub_float("battery/0/Dc/0/Voltage", avg_v);
-    vrm_pub_float("battery/0/Dc/0/Current", total_i);
-    vrm_pub_float("battery/0/Soc", soc);
-    vrm_pub_float("battery/0/ConsumedAmphours", sum_ah_d);
+    /* Agrégats de la trame : même règle que bmu_battery_manager_get_summary */
+    if (f->n_valid == 0) return;
+    float avg_v   = f->v_avg_mv / 1000.0f;
+    float total_i = f->i_total_a;
+    float soc = f->soc_fleet;
+    if (soc < 0.0f) soc = estimate_soc(avg_v);
+
+    vrm_pub_float(P_BAT_V, avg_v);
+    vrm_pub_float(P_BAT_I, total_i);
+    vrm_pub_float(P_BAT_SOC, soc);
+    vrm_pub_float(P_BAT_AH, f->ah_discharge_total);
 }
 
 /* ── Keepalive ── */
@@ -128,7 +153,7 @@ static void publish_keepalive(void)
     if (!s_connected || s_client == NULL) return;
     char topic[64];
     snprintf(topic, sizeof(topic), "R/%s/keepalive", CONFIG_BMU_VRM_PORTAL_ID);
-    esp_mqtt_client_publish(s_client, topic, "", 0, 0, 0);
+    esp_mqtt_client_enqueue(s_client, topic, "", 0, 0, 0, true);
 }
 
 /* ── MQTT event handler ── */
@@ -142,7 +167,9 @@ static void vrm_event_handler(void *arg, esp_event_base_t base,
         case MQTT_EVENT_CONNECTED:
             s_connected = true;
             ESP_LOGI(TAG, "VRM MQTT connecte");
-            vrm_pub_str("system/0/Serial", CONFIG_BMU_VRM_PORTAL_ID);
+            s_last_keepalive_ms = (uint32_t)(esp_timer_get_time() / 1000)
+                                  - (uint32_t)CONFIG_BMU_VRM_PUBLISH_INTERVAL_S * 1000u;
+            /* Rafraîchissement complet au prochain passage du sink */
             break;
         case MQTT_EVENT_DISCONNECTED:
             s_connected = false;
@@ -153,38 +180,38 @@ static void vrm_event_handler(void *arg, esp_event_base_t base,
     }
 }
 
-/* ── Task ── */
+/* ── Sink pipeline télémétrie ── */
 
-static void vrm_task(void *pv)
+static void vrm_sink(const bmu_telem_frame_t *f, void *arg)
 {
-    (void)pv;
-    const TickType_t period = pdMS_TO_TICKS(CONFIG_BMU_VRM_PUBLISH_INTERVAL_S * 1000);
-    ESP_LOGI(TAG, "VRM task demarree — intervalle %ds, portal %s",
-             CONFIG_BMU_VRM_PUBLISH_INTERVAL_S, CONFIG_BMU_VRM_PORTAL_ID);
-
-    for (;;) {
-        vTaskDelay(period);
-        if (!s_connected) continue;
+    (void)arg;
+    if (!s_connected) return;
+    const uint32_t keepalive_ms = (uint32_t)CONFIG_BMU_VRM_PUBLISH_INTERVAL_S * 1000u;
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if ((uint32_t)(now_ms - s_last_keepalive_ms) >= keepalive_ms - VRM_TICK_MS / 2) {
         publish_keepalive();
-        publish_solar();
-        publish_battery();
+        s_last_keepalive_ms = now_ms;
+        bmu_vrm_delta_refresh_all(&s_delta);
     }
+    vrm_pub_str(P_SYS_SERIAL, CONFIG_BMU_VRM_PORTAL_ID);
+    publish_solar();
+    publish_battery(f);
 }
 
 /* ── Public API ── */
 
-esp_err_t bmu_vrm_init(bmu_protection_ctx_t *prot,
-                       bmu_battery_manager_t *mgr,
-                       uint8_t nb_ina)
+esp_err_t bmu_vrm_init(void)
 {
-    s_prot   = prot;
-    s_mgr    = mgr;
-    s_nb_ina = nb_ina;
-
     const char *broker = CONFIG_BMU_VRM_USE_TLS
         ? "mqtts://mqtt.victronenergy.com:8883"
         : "mqtt://mqtt.victronenergy.com:1883";
 
+    if (!bmu_vrm_delta_init(&s_delta, CONFIG_BMU_VRM_PORTAL_ID, s_paths, P_COUNT,
+                            s_topics, sizeof(s_topics))) {
+        ESP_LOGE(TAG, "Portal ID trop long pour la table des topics");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
     esp_mqtt_client_config_t cfg = {};
     cfg.broker.address.uri             = broker;
 #if CONFIG_BMU_VRM_USE_TLS
@@ -210,8 +237,11 @@ esp_err_t bmu_vrm_init(bmu_protection_ctx_t *prot,
         return ret;
     }
 
-    xTaskCreate(vrm_task, "vrm", 4096, NULL, 2, NULL);
-    ESP_LOGI(TAG, "VRM init OK — %s", broker);
+    if (bmu_telem_subscribe("vrm", VRM_TICK_MS, vrm_sink, NULL) < 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "VRM init OK — %s, intervalle %ds, tick %dms",
+             broker, CONFIG_BMU_VRM_PUBLISH_INTERVAL_S, VRM_TICK_MS);
     return ESP_OK;
 }
 
@@ -220,8 +250,7 @@ bool bmu_vrm_is_connected(void) { return s_connected; }
 #else  /* CONFIG_BMU_VRM_ENABLED */
 
 #include "bmu_vrm.h"
-esp_err_t bmu_vrm_init(bmu_protection_ctx_t *p, bmu_battery_manager_t *m, uint8_t n)
-{ (void)p; (void)m; (void)n; return ESP_OK; }
+esp_err_t bmu_vrm_init(void) { return ESP_OK; }
 bool bmu_vrm_is_connected(void) { return false; }
 
 #endif /* CONFIG_BMU_VRM_ENABLED */
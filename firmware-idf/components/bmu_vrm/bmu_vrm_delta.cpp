@@ -0,0 +1,107 @@
+/**
+ * bmu_vrm_delta — Cache par chemin des publications VRM (voir bmu_vrm_delta.h).
+ *
+ * Pas de dépendance ESP-IDF (testé sur host, test_vrm_delta). Les float sont
+ * comparés à la résolution publiée (centièmes) : une valeur qui s'imprime
+ * pareil n'est jamais renvoyée, même avec une bande morte nulle.
+ */
+
+#include "bmu_vrm_delta.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static int64_t hash_str(const char *s)
+{
+    uint32_t h = 2166136261u;                      /* FNV-1a 32 bits */
+    for (; *s; s++) {
+        h ^= (uint8_t)*s;
+        h *= 16777619u;
+    }
+    return (int64_t)h;
+}
+
+/* Décide et enregistre : true si la valeur q (unité interne) doit partir */
+static bool take(bmu_vrm_delta_t *d, bmu_vrm_path_t *p, int64_t q, int64_t db)
+{
+    if (p->valid) {
+        int64_t diff = q - p->last;
+        if (diff < 0) diff = -diff;
+        if (diff == 0 || diff <= db) {
+            d->skipped++;
+            return false;
+        }
+    }
+    p->last = q;
+    p->valid = true;
+    d->sent++;
+    return true;
+}
+
+bool bmu_vrm_delta_init(bmu_vrm_delta_t *d, const char *portal_id,
+                        bmu_vrm_path_t *paths, uint8_t nb_paths,
+                        char *topics, size_t cap)
+{
+    d->paths = paths;
+    d->nb_paths = nb_paths;
+    d->topics = topics;
+    d->topics_cap = cap;
+    d->sent = 0;
+    d->skipped = 0;
+
+    size_t off = 0;
+    for (uint8_t i = 0; i < nb_paths; i++) {
+        if (off > UINT16_MAX) return false;
+        int n = snprintf(topics + off, cap - off, "N/%s/%s", portal_id, paths[i].path);
+        if (n < 0 || (size_t)n >= cap - off) return false;
+        paths[i].topic_off = (uint16_t)off;
+        paths[i].valid = false;
+        off += (size_t)n + 1;
+    }
+    return true;
+}
+
+const char *bmu_vrm_delta_topic(const bmu_vrm_delta_t *d, uint8_t idx)
+{
+    return d->topics + d->paths[idx].topic_off;
+}
+
+int bmu_vrm_delta_float(bmu_vrm_delta_t *d, uint8_t idx, float v, char *json, size_t cap)
+{
+    if (idx >= d->nb_paths || std::isnan(v)) return 0;
+    bmu_vrm_path_t *p = &d->paths[idx];
+    int64_t q = (int64_t)llround((double)v * 100.0);
+    int64_t db = (int64_t)llround((double)p->deadband * 100.0);
+    if (!take(d, p, q, db)) return 0;
+    int n = snprintf(json, cap, "{\"value\":%.2f}", v);
+    return (n > 0 && (size_t)n < cap) ? n : 0;
+}
+
+int bmu_vrm_delta_int(bmu_vrm_delta_t *d, uint8_t idx, int32_t v, char *json, size_t cap)
+{
+    if (idx >= d->nb_paths) return 0;
+    bmu_vrm_path_t *p = &d->paths[idx];
+    if (!take(d, p, v, (int64_t)p->deadband)) return 0;
+    int n = snprintf(json, cap, "{\"value\":%ld}", (long)v);
+    return (n > 0 && (size_t)n < cap) ? n : 0;
+}
+
+int bmu_vrm_delta_str(bmu_vrm_delta_t *d, uint8_t idx, const char *v, char *json, size_t cap)
+{
+    if (idx >= d->nb_paths || v == nullptr) return 0;
+    bmu_vrm_path_t *p = &d->paths[idx];
+    if (!take(d, p, hash_str(v), 0)) return 0;
+    int n = snprintf(json, cap, "{\"value\":\"%s\"}", v);
+    return (n > 0 && (size_t)n < cap) ? n : 0;
+}
+
+void bmu_vrm_delta_invalidate(bmu_vrm_delta_t *d, uint8_t idx)
+{
+    if (idx < d->nb_paths) d->paths[idx].valid = false;
+}
+
+void bmu_vrm_delta_refresh_all(bmu_vrm_delta_t *d)
+{
+    for (uint8_t i = 0; i < d->nb_paths; i++) d->paths[i].valid = false;
+}
@@ -1,7 +1,5 @@
 #pragma once
 #include "esp_err.h"
-#include "bmu_protection.h"
-#include "bmu_battery_manager.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -9,9 +7,8 @@
 extern "C" {
 #endif
 
-esp_err_t bmu_vrm_init(bmu_protection_ctx_t *prot,
-                       bmu_battery_manager_t *mgr,
-                       uint8_t nb_ina);
+/** Connecte le client VRM et s'abonne au pipeline télémétrie (bmu_telem_init avant) */
+esp_err_t bmu_vrm_init(void);
 bool bmu_vrm_is_connected(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,78 @@
+/**
+ * @file bmu_vrm_delta.h
+ * @brief Publication VRM par chemin : cache de la dernière valeur envoyée.
+ *
+ * Chaque chemin dbus-mqtt (battery/0/Soc, solarcharger/0/Pv/V, ...) a son
+ * topic N/<portal>/<path> formaté une fois à l'init et sa dernière valeur
+ * publiée. Une mise à jour ne produit un payload que si la valeur, à la
+ * résolution publiée (0.01 pour les float), a bougé de plus que la bande
+ * morte du chemin, ou si un rafraîchissement complet est demandé
+ * (keepalive). Sinon rien n'est formaté.
+ *
+ * Aucune dépendance ESP-IDF : testé sur host (test_vrm_delta).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    BMU_VRM_FLOAT = 0,     /**< {"value":x.xx} */
+    BMU_VRM_INT,           /**< {"value":n} */
+    BMU_VRM_STR,           /**< {"value":"s"} */
+} bmu_vrm_kind_t;
+
+/** Description statique d'un chemin + état du cache */
+typedef struct {
+    const char *path;
+    uint8_t     kind;          /**< bmu_vrm_kind_t */
+    float       deadband;      /**< Unité de la valeur ; 0 = tout changement publié */
+    /* État (bmu_vrm_delta_*) */
+    uint16_t    topic_off;
+    bool        valid;
+    int64_t     last;          /**< Valeur publiée (float ×100) ou hash FNV-1a */
+} bmu_vrm_path_t;
+
+typedef struct {
+    bmu_vrm_path_t *paths;
+    uint8_t         nb_paths;
+    char           *topics;    /**< Topics concaténés, terminés par '\0' */
+    size_t          topics_cap;
+    uint32_t        sent;      /**< Payloads produits */
+    uint32_t        skipped;   /**< Mises à jour sans changement */
+} bmu_vrm_delta_t;
+
+/**
+ * @brief Formate les topics N/<portal_id>/<path> dans topics[cap].
+ * @return false si cap est insuffisant
+ */
+bool bmu_vrm_delta_init(bmu_vrm_delta_t *d, const char *portal_id,
+                        bmu_vrm_path_t *paths, uint8_t nb_paths,
+                        char *topics, size_t cap);
+
+/** Topic préformaté du chemin idx */
+const char *bmu_vrm_delta_topic(const bmu_vrm_delta_t *d, uint8_t idx);
+
+/**
+ * @brief Met à jour le chemin idx ; si la valeur doit partir, écrit le
+ *        payload JSON dans json et enregistre la valeur comme publiée.
+ * @return longueur du payload, 0 si inchangé (rien à publier)
+ */
+int bmu_vrm_delta_float(bmu_vrm_delta_t *d, uint8_t idx, float v, char *json, size_t cap);
+int bmu_vrm_delta_int(bmu_vrm_delta_t *d, uint8_t idx, int32_t v, char *json, size_t cap);
+int bmu_vrm_delta_str(bmu_vrm_delta_t *d, uint8_t idx, const char *v, char *json, size_t cap);
+
+/** Publication échouée : le chemin repartira à la prochaine mise à jour */
+void bmu_vrm_delta_invalidate(bmu_vrm_delta_t *d, uint8_t idx);
+
+/** Rafraîchissement complet (keepalive, reconnexion) : tout repart */
+void bmu_vrm_delta_refresh_all(bmu_vrm_delta_t *d);
+
+#ifdef __cplusplus
+}
+#endif
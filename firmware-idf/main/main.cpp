@@ -15,9 +15,12 @@
 #include "bmu_wifi.h"
 #include "bmu_storage.h"
 #include "bmu_mqtt.h"
+#include "bmu_mqtt_fleet.h"
 #include "bmu_influx.h"
 #include "bmu_influx_store.h"
 #include "bmu_balancer.h"
+#include "bmu_soc.h"
+#include "bmu_rul.h"
 #include "bmu_ble_victron_gatt.h"
 #include "bmu_ble_victron_scan.h"
 #include "bmu_sntp.h"
@@ -27,6 +30,7 @@
 #include "bmu_climate.h"
 #include "bmu_ota.h"
 #include "bmu_vrm.h"
+#include "bmu_telemetry.h"
 #include "bmu_i2c_bitbang.h"
 #if CONFIG_BMU_SOH_ENABLED
 #include "bmu_soh.h"
@@ -43,12 +47,15 @@
 #endif
 #include "esp_log.h"
 #include "esp_spiffs.h"
+#include "esp_timer.h"
 #include "bmu_types.h"
+#include "bmu_rbe.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include <cstdio>
 #include <math.h>
+#include <sys/time.h>
 
 static const char *TAG = "MAIN";
 
@@ -57,6 +64,8 @@ static QueueHandle_t s_q_balancer = NULL;
 static QueueHandle_t s_q_display  = NULL;
 static QueueHandle_t s_q_cloud    = NULL;
 static QueueHandle_t s_q_ble      = NULL;
+static QueueHandle_t s_q_soc      = NULL;
+static QueueHandle_t s_q_sdlog    = NULL;
 
 // ── Command queue → protection ──
 static QueueHandle_t s_q_cmd      = NULL;
@@ -70,48 +79,103 @@ static bool bitbang_bus_conflicts_with_vedirect(void)
 #if CONFIG_BMU_I2C_BB_ENABLED && defined(CONFIG_BMU_VEDIRECT_ENABLED) && CONFIG_BMU_VEDIRECT_ENABLED
     const int bb_sda = CONFIG_BMU_I2C_BB_SDA_GPIO;
     const int bb_scl = CONFIG_BMU_I2C_BB_SCL_GPIO;
-    const int ve_rx = CONFIG_BMU_VEDIRECT_RX_GPIO;
-    const int ve_tx = CONFIG_BMU_VEDIRECT_TX_GPIO;
-    return ve_rx == bb_sda || ve_rx == bb_scl ||
-           (ve_tx >= 0 && (ve_tx == bb_sda || ve_tx == bb_scl));
+    /* Tous les ports VE.Direct (et sélection du multiplexeur) */
+    return bmu_vedirect_uses_gpio(bb_sda) || bmu_vedirect_uses_gpio(bb_scl);
 #else
     return false;
 #endif
 }
 
 /* ── Cloud telemetry task ──────────────────────────────────────────── */
+/* Sink du pipeline bmu_telemetry : le callback réveille la tâche (MQTT et
+ * HTTP bloquants), qui relit la trame — plus aucun getter par batterie. */
 typedef struct {
     bmu_protection_ctx_t  *prot;
     bmu_battery_manager_t *mgr;
-    uint8_t               *nb_ina;   /* pointer — follows hotplug changes */
-    QueueHandle_t          q_snapshot;
-    SemaphoreHandle_t      nb_ina_mutex;
 } cloud_task_ctx_t;
 
+static TaskHandle_t s_cloud_task = NULL;
+static bmu_telem_frame_t s_cloud_frame;
+
+#if CONFIG_BMU_MQTT_FLEET_FRAME
+/* Trame de flotte : une publication binaire par cycle (bmu_mqtt_fleet.h) */
+static bmu_fleet_batt_t s_fleet[BMU_FLEET_FRAME_MAX_BATT];
+static uint8_t s_fleet_frame[BMU_FLEET_FRAME_MAX_LEN];
+static uint16_t s_fleet_seq = 0;
+#endif
+
+/* MQTT sur changement (bmu_rbe.h) : scrutation à chaque tick, envoi si une
+ * mesure franchit sa bande morte ou au heartbeat. InfluxDB, SOH et solaire
+ * restent sur la période fixe, le replay est tenté à chaque tick.
+ * Ah/Wh/Rint/SOH partent avec le reste. */
+#define CLOUD_PERIOD_MS 10000
+#if CONFIG_BMU_RBE_ENABLED
+#define CLOUD_TICK_MS   BMU_RBE_TICK_MS
+#else
+#define CLOUD_TICK_MS   CLOUD_PERIOD_MS
+#endif
+
+enum { RBE_BAT_V, RBE_BAT_I, RBE_BAT_STATE, RBE_BAT_NBSW, RBE_BAT_SOC, RBE_BAT_BAL, RBE_BAT_NB };
+static const float s_rbe_bat_db[RBE_BAT_NB] = {
+    BMU_RBE_DB_MV, BMU_RBE_DB_MA, 0.0f, 0.0f, 1.0f /* % SOC */, 0.0f,
+};
+static const bmu_rbe_cfg_t s_rbe_bat = { s_rbe_bat_db, RBE_BAT_NB, BMU_RBE_HEARTBEAT_MS };
+static bmu_rbe_slot_t s_rbe_bat_slot[BMU_MAX_BATTERIES];
+static float s_rbe_bat_cur[BMU_MAX_BATTERIES][RBE_BAT_NB];
+
+static const float s_rbe_clim_db[2] = { 0.2f /* °C */, 1.0f /* %HR */ };
+static const bmu_rbe_cfg_t s_rbe_clim = { s_rbe_clim_db, 2, BMU_RBE_HEARTBEAT_MS };
+static bmu_rbe_slot_t s_rbe_clim_slot;
+
+/* Rendu LVGL : moyennes sur la periode cloud (bmu_disp_perf.h) */
+static bmu_disp_perf_totals_t s_disp_perf_prev;
+
+static const char *state_name(uint8_t state)
+{
+    switch (state) {
+        case BMU_STATE_CONNECTED:    return "connected";
+        case BMU_STATE_DISCONNECTED: return "disconnected";
+        case BMU_STATE_RECONNECTING: return "reconnecting";
+        case BMU_STATE_ERROR:        return "error";
+        case BMU_STATE_LOCKED:       return "locked";
+    }
+    return "unknown";
+}
+
+static void cloud_sink_cb(const bmu_telem_frame_t *frame, void *arg)
+{
+    (void)frame; (void)arg;
+    if (s_cloud_task) xTaskNotifyGive(s_cloud_task);
+}
+
 static void cloud_telemetry_task(void *pv)
 {
     cloud_task_ctx_t *ctx = (cloud_task_ctx_t *)pv;
-    const TickType_t period = pdMS_TO_TICKS(10000);
+    const uint32_t ticks_per_period = CLOUD_PERIOD_MS / CLOUD_TICK_MS > 0
+                                      ? CLOUD_PERIOD_MS / CLOUD_TICK_MS : 1;
+    uint32_t n_tick = 0;
 
-    ESP_LOGI("CLOUD", "Telemetry task started — period 10s");
+    ESP_LOGI("CLOUD", "Telemetry task started — period 10s, MQTT tick %dms, heartbeat %lus",
+             CLOUD_TICK_MS, (unsigned long)(BMU_RBE_HEARTBEAT_MS / 1000));
 
     for (;;) {
-        vTaskDelay(period);
-
-        // Peek latest snapshot
-        bmu_snapshot_t snap;
-        if (xQueuePeek(ctx->q_snapshot, &snap, 0) == pdTRUE) {
-            // Snapshot available — will use for telemetry in future refactor
-        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!bmu_telem_get_latest(&s_cloud_frame)) continue;
+        const bmu_telem_frame_t *f = &s_cloud_frame;
+        const bool periodic = (++n_tick % ticks_per_period) == 0;
+        const uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
 
 #if CONFIG_BMU_SOH_ENABLED
-        bmu_soh_update_all(ctx->mgr, ctx->prot, *ctx->nb_ina);
+        if (periodic) bmu_soh_update_all(ctx->mgr, ctx->prot, f->nb_batteries);
+#else
+        (void)ctx;
 #endif
 
         if (!bmu_wifi_is_connected()) continue;
 
 #if CONFIG_BMU_INFLUX_DIRECT_ENABLED
-        /* Rejouer les données offline si présentes */
+        /* Rejouer les données offline si présentes — à chaque tick : le seau
+         * à jetons du store fixe le débit (CONFIG_BMU_INFLUX_REPLAY_RATE_KBPS) */
         if (bmu_influx_store_has_pending()) {
             int replayed = bmu_influx_store_replay();
             if (replayed > 0) {
@@ -120,80 +184,78 @@ static void cloud_telemetry_task(void *pv)
         }
 #endif
 
-        uint8_t snap_ina = 0;
-        if (ctx->nb_ina_mutex && xSemaphoreTake(ctx->nb_ina_mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
-            snap_ina = *ctx->nb_ina;
-            xSemaphoreGive(ctx->nb_ina_mutex);
-        } else {
-            snap_ina = *ctx->nb_ina;
-        }
-        for (int i = 0; i < snap_ina; i++) {
-            float v_mv = bmu_protection_get_voltage(ctx->prot, i);
-            float ah_d = bmu_battery_manager_get_ah_discharge(ctx->mgr, i);
-            float ah_c = bmu_battery_manager_get_ah_charge(ctx->mgr, i);
-            bmu_battery_state_t state = bmu_protection_get_state(ctx->prot, i);
-
-            const char *state_str = "unknown";
-            switch (state) {
-                case BMU_STATE_CONNECTED:    state_str = "connected"; break;
-                case BMU_STATE_DISCONNECTED: state_str = "disconnected"; break;
-                case BMU_STATE_RECONNECTING: state_str = "reconnecting"; break;
-                case BMU_STATE_ERROR:        state_str = "error"; break;
-                case BMU_STATE_LOCKED:       state_str = "locked"; break;
-            }
+        /* Vérifié une fois par tick : évite un warning par publish refusé */
+        const bool mqtt_up = bmu_mqtt_is_connected();
+        if (!periodic && !mqtt_up) continue;
 
-            float i_a = bmu_battery_manager_get_last_current_a(ctx->mgr, i);
-
-            int nb_sw = 0;
-            if (bmu_protection_get_switch_count(ctx->prot, i, &nb_sw) != ESP_OK) {
-                nb_sw = 0;
-            }
+#if CONFIG_BMU_MQTT_FLEET_FRAME
+        bool fleet_due = false;
+#endif
+        for (int i = 0; i < f->nb_batteries; i++) {
+            const bmu_telem_batt_t *b = &f->batt[i];
+            const char *state_str = state_name(b->state);
 
-            /* Build full payload with health metrics */
             bmu_influx_battery_full_t full = {
                 .battery_id    = i,
-                .voltage_mv    = v_mv,
-                .current_a     = i_a,
-                .ah_discharge  = ah_d,
-                .ah_charge     = ah_c,
+                .voltage_mv    = b->voltage_mv,
+                .current_a     = b->current_a,
+                .ah_discharge  = b->ah_discharge,
+                .ah_charge     = b->ah_charge,
+                .wh_discharge  = b->wh_discharge,
+                .wh_charge     = b->wh_charge,
                 .state         = state_str,
-                .nb_switch     = nb_sw,
-                .r_ohmic_mohm  = NAN,
-                .r_total_mohm  = NAN,
-                .soh_percent   = NAN,
-                .balancer_duty = -1,
+                .nb_switch     = b->nb_switch,
+                .r_ohmic_mohm  = b->r_ohmic_mohm,
+                .r_total_mohm  = b->r_total_mohm,
+                .soh_percent   = b->soh_percent,
+                .soc_percent   = b->soc_percent,
+                .balancer_duty = b->balancer_duty,
             };
 
-#if CONFIG_BMU_RINT_ENABLED
-            bmu_rint_result_t rint = bmu_rint_get_cached((uint8_t)i);
-            if (rint.valid) {
-                full.r_ohmic_mohm = rint.r_ohmic_mohm;
-                full.r_total_mohm = rint.r_total_mohm;
-            }
-#endif
-
-#if CONFIG_BMU_SOH_ENABLED
-            float soh = bmu_soh_get_cached(i);
-            if (soh >= 0) full.soh_percent = soh * 100.0f;
+#if CONFIG_BMU_INFLUX_DIRECT_ENABLED
+            if (periodic) bmu_influx_write_battery_full(&full);
 #endif
 
-            if (bmu_balancer_is_off((uint8_t)i)) {
-                full.balancer_duty = 0; /* Currently in OFF phase */
-            } else {
-                int duty = bmu_balancer_get_duty_pct((uint8_t)i);
-                if (duty < 100) full.balancer_duty = duty;
+            float *cur = s_rbe_bat_cur[i];
+            cur[RBE_BAT_V]     = b->voltage_mv;
+            cur[RBE_BAT_I]     = b->current_a * 1000.0f;
+            cur[RBE_BAT_STATE] = (float)b->state;
+            cur[RBE_BAT_NBSW]  = (float)b->nb_switch;
+            cur[RBE_BAT_SOC]   = b->soc_percent;
+            cur[RBE_BAT_BAL]   = (float)b->balancer_duty;
+            const bool due = mqtt_up && bmu_rbe_due(&s_rbe_bat, &s_rbe_bat_slot[i], cur, now_ms);
+
+#if CONFIG_BMU_MQTT_FLEET_FRAME
+            fleet_due |= due;
+            if (i < BMU_FLEET_FRAME_MAX_BATT) {
+                s_fleet[i] = bmu_fleet_batt_t{
+                    .id            = (uint8_t)i,
+                    .state         = b->state,
+                    .voltage_mv    = b->voltage_mv,
+                    .current_a     = b->current_a,
+                    .ah_discharge  = b->ah_discharge,
+                    .ah_charge     = b->ah_charge,
+                    .wh_discharge  = b->wh_discharge,
+                    .wh_charge     = b->wh_charge,
+                    .nb_switch     = b->nb_switch,
+                    .r_ohmic_mohm  = b->r_ohmic_mohm,
+                    .r_total_mohm  = b->r_total_mohm,
+                    .soh_percent   = b->soh_percent,
+                    .soc_percent   = b->soc_percent,
+                    .balancer_duty = b->balancer_duty,
+                };
             }
-
-#if CONFIG_BMU_INFLUX_DIRECT_ENABLED
-            bmu_influx_write_battery_full(&full);
-#endif
+#else
+            if (!due) continue;
 
             /* MQTT — 0-indexed, V en volts, champs optionnels */
             char payload[384];
             int plen = snprintf(payload, sizeof(payload),
                 "{\"bat\":%d,\"v\":%.3f,\"i\":%.3f,"
-                "\"ah_d\":%.3f,\"ah_c\":%.3f,\"nb_switch\":%d,\"state\":\"%s\"",
-                i, v_mv / 1000.0f, i_a, ah_d, ah_c, nb_sw, state_str);
+                "\"ah_d\":%.3f,\"ah_c\":%.3f,\"wh_d\":%.1f,\"wh_c\":%.1f,"
+                "\"nb_switch\":%d,\"state\":\"%s\"",
+                i, b->voltage_mv / 1000.0f, b->current_a, b->ah_discharge, b->ah_charge,
+                b->wh_discharge, b->wh_charge, (int)b->nb_switch, state_str);
 
             if (!isnan(full.r_ohmic_mohm)) {
                 plen += snprintf(payload + plen, sizeof(payload) - plen,
@@ -204,6 +266,10 @@ static void cloud_telemetry_task(void *pv)
                 plen += snprintf(payload + plen, sizeof(payload) - plen,
                     ",\"soh\":%.1f", full.soh_percent);
             }
+            if (full.soc_percent >= 0) {
+                plen += snprintf(payload + plen, sizeof(payload) - plen,
+                    ",\"soc\":%.1f", full.soc_percent);
+            }
             if (full.balancer_duty >= 0) {
                 plen += snprintf(payload + plen, sizeof(payload) - plen,
                     ",\"bal_duty\":%d", full.balancer_duty);
@@ -213,72 +279,174 @@ static void cloud_telemetry_task(void *pv)
             char topic[64];
             snprintf(topic, sizeof(topic), "bmu/%s/battery/%d",
                      bmu_config_get_device_name(), i);  /* 0-indexed */
-            bmu_mqtt_publish(topic, payload, 0, 0, false);
+            if (bmu_mqtt_publish(topic, payload, 0, 0, false) == ESP_OK) {
+                bmu_rbe_commit(&s_rbe_bat, &s_rbe_bat_slot[i], cur, now_ms);
+            }
+#endif
         }
 
         /* ── Climate (AHT30) ── */
-        if (bmu_climate_is_available()) {
-            float t_c = bmu_climate_get_temperature();
-            float h_pct = bmu_climate_get_humidity();
+        const float t_c = f->temp_c, h_pct = f->humidity_pct;
 #if CONFIG_BMU_INFLUX_DIRECT_ENABLED
-            bmu_influx_write_climate(t_c, h_pct);
+        if (periodic && !isnan(t_c)) bmu_influx_write_climate(t_c, h_pct);
 #endif
-
+        const float clim[2] = { t_c, h_pct };
+        const bool clim_due = mqtt_up && bmu_rbe_due(&s_rbe_clim, &s_rbe_clim_slot, clim, now_ms);
+
+#if CONFIG_BMU_MQTT_FLEET_FRAME
+        /* Une batterie ou le climat a changé : toute la trame part */
+        if (fleet_due || clim_due) {
+            uint8_t nb = f->nb_batteries < BMU_FLEET_FRAME_MAX_BATT ? f->nb_batteries : BMU_FLEET_FRAME_MAX_BATT;
+            size_t flen = bmu_fleet_frame_encode(s_fleet, nb, t_c, h_pct, s_fleet_seq++,
+                                                 s_fleet_frame, sizeof(s_fleet_frame));
+            char fleet_topic[64];
+            snprintf(fleet_topic, sizeof(fleet_topic), "bmu/%s/fleet",
+                     bmu_config_get_device_name());
+            if (bmu_mqtt_publish(fleet_topic, (const char *)s_fleet_frame, (int)flen, 0, false) == ESP_OK) {
+                for (int i = 0; i < f->nb_batteries; i++) {
+                    bmu_rbe_commit(&s_rbe_bat, &s_rbe_bat_slot[i], s_rbe_bat_cur[i], now_ms);
+                }
+                bmu_rbe_commit(&s_rbe_clim, &s_rbe_clim_slot, clim, now_ms);
+            }
+        }
+#else
+        if (clim_due && isnan(t_c)) {
+            bmu_rbe_commit(&s_rbe_clim, &s_rbe_clim_slot, clim, now_ms);   /* capteur perdu */
+        } else if (clim_due) {
             char clim_payload[96];
             snprintf(clim_payload, sizeof(clim_payload),
                 "{\"temp_c\":%.2f,\"humidity\":%.1f}", t_c, h_pct);
             char clim_topic[64];
             snprintf(clim_topic, sizeof(clim_topic), "bmu/%s/climate",
                      bmu_config_get_device_name());
-            bmu_mqtt_publish(clim_topic, clim_payload, 0, 0, false);
+            if (bmu_mqtt_publish(clim_topic, clim_payload, 0, 0, false) == ESP_OK) {
+                bmu_rbe_commit(&s_rbe_clim, &s_rbe_clim_slot, clim, now_ms);
+            }
         }
+#endif
+
+        if (!periodic) continue;
 
 #if CONFIG_BMU_INFLUX_DIRECT_ENABLED
         bmu_influx_flush();
 #endif
 
-        /* ── Solar telemetry ── */
-        if (bmu_vedirect_is_connected()) {
-            const bmu_vedirect_data_t *sol = bmu_vedirect_get_data();
-            if (sol && sol->valid) {
-                /* MQTT */
-                char solar_payload[192];
-                snprintf(solar_payload, sizeof(solar_payload),
-                    "{\"vpv\":%.1f,\"ppv\":%u,\"vbat\":%.2f,"
-                    "\"ibat\":%.2f,\"cs\":\"%s\",\"yield\":%lu,\"err\":%u}",
-                    sol->panel_voltage_v,
-                    (unsigned)sol->panel_power_w,
-                    sol->battery_voltage_v,
-                    sol->battery_current_a,
-                    bmu_vedirect_cs_name(sol->charge_state),
-                    (unsigned long)sol->yield_today_wh,
-                    (unsigned)sol->error_code);
-                char solar_topic[64];
-                snprintf(solar_topic, sizeof(solar_topic),
-                    "bmu/%s/solar", bmu_config_get_device_name());
-                bmu_mqtt_publish(solar_topic, solar_payload, 0, 0, false);
+        /* ── Rendu écran (LVGL) ── */
+        {
+            bmu_disp_perf_totals_t cur;
+            bmu_disp_perf_stats_t st;
+            bmu_display_get_perf(&cur);
+            bmu_disp_perf_stats(&s_disp_perf_prev, &cur, &st);
+            s_disp_perf_prev = cur;
+            if (mqtt_up && s_disp_perf_prev.panel_px > 0) {
+                char disp_payload[160];
+                snprintf(disp_payload, sizeof(disp_payload),
+                    "{\"fps\":%.1f,\"render_ms\":%.2f,\"flush_ms\":%.2f,"
+                    "\"area_pct\":%.1f,\"load_pct\":%.1f,\"frames\":%lu,\"slow\":%lu}",
+                    st.fps, st.render_ms, st.flush_ms, st.area_pct, st.load_pct,
+                    (unsigned long)st.frames, (unsigned long)st.slow);
+                char disp_topic[64];
+                snprintf(disp_topic, sizeof(disp_topic),
+                    "bmu/%s/display", bmu_config_get_device_name());
+                bmu_mqtt_publish(disp_topic, disp_payload, 0, 0, false);
+            }
+        }
+
+        /* ── Solar telemetry (modèle agrégé, tous chargeurs) ── */
+        bmu_vedirect_solar_t solar;
+        if (bmu_vedirect_get_solar(&solar)) {
+            const bmu_vedirect_data_t *sol = &solar.total;
+            /* MQTT */
+            char solar_payload[224];
+            snprintf(solar_payload, sizeof(solar_payload),
+                "{\"vpv\":%.1f,\"ppv\":%u,\"vbat\":%.2f,"
+                "\"ibat\":%.2f,\"cs\":\"%s\",\"yield\":%lu,\"err\":%u,"
+                "\"online\":%u,\"chargers\":%u}",
+                sol->panel_voltage_v,
+                (unsigned)sol->panel_power_w,
+                sol->battery_voltage_v,
+                sol->battery_current_a,
+                bmu_vedirect_cs_name(sol->charge_state),
+                (unsigned long)sol->yield_today_wh,
+                (unsigned)sol->error_code,
+                (unsigned)solar.n_online,
+                (unsigned)solar.n_chargers);
+            char solar_topic[64];
+            snprintf(solar_topic, sizeof(solar_topic),
+                "bmu/%s/solar", bmu_config_get_device_name());
+            bmu_mqtt_publish(solar_topic, solar_payload, 0, 0, false);
 
 #if CONFIG_BMU_INFLUX_DIRECT_ENABLED
-                /* InfluxDB */
-                char solar_tags[48];
-                snprintf(solar_tags, sizeof(solar_tags),
-                    "device=%s", bmu_config_get_device_name());
-                char solar_fields[128];
+            /* InfluxDB */
+            char solar_tags[48];
+            snprintf(solar_tags, sizeof(solar_tags),
+                "device=%s", bmu_config_get_device_name());
+            char solar_fields[160];
+            snprintf(solar_fields, sizeof(solar_fields),
+                "vpv=%.1f,ppv=%ui,vbat=%.2f,ibat=%.2f,cs=%ui,yield=%lui,online=%ui",
+                sol->panel_voltage_v,
+                (unsigned)sol->panel_power_w,
+                sol->battery_voltage_v,
+                sol->battery_current_a,
+                (unsigned)sol->charge_state,
+                (unsigned long)sol->yield_today_wh,
+                (unsigned)solar.n_online);
+            bmu_influx_write("solar", solar_tags, solar_fields, 0);
+
+            /* Détail par chargeur (rigs multi-MPPT) : âge pour repérer un port muet */
+            for (uint8_t i = 0; solar.n_chargers > 1 && i < solar.n_chargers; i++) {
+                bmu_vedirect_data_t ch;
+                if (!bmu_vedirect_get_charger(i, &ch)) continue;
+                snprintf(solar_tags, sizeof(solar_tags), "device=%s,charger=%u",
+                    bmu_config_get_device_name(), (unsigned)(i + 1));
                 snprintf(solar_fields, sizeof(solar_fields),
-                    "vpv=%.1f,ppv=%ui,vbat=%.2f,ibat=%.2f,cs=%ui,yield=%lui",
-                    sol->panel_voltage_v,
-                    (unsigned)sol->panel_power_w,
-                    sol->battery_voltage_v,
-                    sol->battery_current_a,
-                    (unsigned)sol->charge_state,
-                    (unsigned long)sol->yield_today_wh);
-                bmu_influx_write("solar", solar_tags, solar_fields, 0);
-#endif
+                    "ppv=%ui,ibat=%.2f,cs=%ui,err=%ui,yield=%lui,age_s=%ldi",
+                    (unsigned)ch.panel_power_w,
+                    ch.battery_current_a,
+                    (unsigned)ch.charge_state,
+                    (unsigned)ch.error_code,
+                    (unsigned long)ch.yield_today_wh,
+                    (long)(solar.age_ms[i] / 1000));
+                bmu_influx_write("solar_charger", solar_tags, solar_fields, 0);
             }
+#endif
         }
     }
 }
 
+/* ── Journal SD ──────────────────────────────────────────────────────── */
+
+#if CONFIG_BMU_SD_LOG_ENABLED
+/* Chaque snapshot protection (5 Hz), une ligne CSV par batterie. Le
+ * formatage est fait ici, l'écriture par la tâche sd_log de bmu_storage :
+ * une carte lente ne retient jamais cette tâche, l'anneau absorbe ses
+ * pauses et compte les lignes perdues. */
+#define SD_LOG_HEADER "utc_ms,uptime_ms,bat,mv,ma,state,switches,health"
+
+static void sd_log_task(void *pv)
+{
+    (void)pv;
+    static bmu_snapshot_t snap;   /* hors pile */
+    char line[96];
+    for (;;) {
+        if (xQueueReceive(s_q_sdlog, &snap, portMAX_DELAY) != pdTRUE) continue;
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        long long utc_ms = (tv.tv_sec < 1700000000) ? 0
+                         : (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+        uint8_t nb = snap.nb_batteries > BMU_MAX_BATTERIES ? BMU_MAX_BATTERIES : snap.nb_batteries;
+        for (uint8_t i = 0; i < nb; i++) {
+            snprintf(line, sizeof(line), "%lld,%lu,%u,%.0f,%.0f,%u,%u,%u",
+                     utc_ms, (unsigned long)snap.timestamp_ms, (unsigned)(i + 1),
+                     snap.battery[i].voltage_mv, snap.battery[i].current_a * 1000.0f,
+                     (unsigned)snap.battery[i].state, (unsigned)snap.battery[i].nb_switches,
+                     (unsigned)snap.battery[i].health_score);
+            bmu_sd_log_line(line);   /* anneau plein : ligne comptée perdue */
+        }
+    }
+}
+#endif
+
 /* ── SPIFFS init ───────────────────────────────────────────────────── */
 static esp_err_t init_spiffs(void)
 {
@@ -315,10 +483,12 @@ extern "C" void app_main(void)
     /* ── 1b. Create RTOS queues ─────────────────────────────────────── */
     s_q_balancer = xQueueCreate(1, sizeof(bmu_snapshot_t));
     s_q_display  = xQueueCreate(1, sizeof(bmu_snapshot_t));
-    s_q_cloud    = xQueueCreate(2, sizeof(bmu_snapshot_t));
+    s_q_cloud    = xQueueCreate(1, sizeof(bmu_snapshot_t));  /* pipeline télémétrie */
     s_q_ble      = xQueueCreate(1, sizeof(bmu_snapshot_t));
+    s_q_soc      = xQueueCreate(1, sizeof(bmu_snapshot_t));
     s_q_cmd      = xQueueCreate(8, sizeof(bmu_cmd_t));
-    if (!s_q_balancer || !s_q_display || !s_q_cloud || !s_q_ble || !s_q_cmd) {
+
+    if (!s_q_balancer || !s_q_display || !s_q_cloud || !s_q_ble || !s_q_soc || !s_q_cmd) {
         ESP_LOGE(TAG, "Failed to create RTOS queues");
         return;
     }
@@ -347,6 +517,7 @@ extern "C" void app_main(void)
 
 #ifdef CONFIG_BMU_BLE_ENABLED
     {
+        bmu_ble_set_snapshot_queue(s_q_ble);
         esp_err_t ble_ret = bmu_ble_init(&prot, &mgr, 0);
         if (ble_ret == ESP_OK) {
             ESP_LOGI(TAG, "BLE active — '%s'", bmu_config_get_device_name());
@@ -362,7 +533,8 @@ extern "C" void app_main(void)
     bmu_fat_init();     /* internal FAT partition (config files, USB-editable) */
     bmu_usb_msc_init();   /* TinyUSB MSC (if enabled) */
     bmu_config_load_battery_labels();  /* /fatfs/batteries.cfg */
-    /* SD externe montee a la demande pour garder un boot propre sans carte. */
+    /* SD externe montee par le journal (section 9) ou a la demande ; sans
+       carte le boot continue. */
 
     /* ── 6. SNTP ───────────────────────────────────────────────────── */
     if (bmu_wifi_is_connected()) {
@@ -522,20 +694,39 @@ extern "C" void app_main(void)
     /* ── 9. Protection + Battery Manager ───────────────────────────── */
     ESP_ERROR_CHECK(bmu_protection_init(&prot, ina, nb_ina, tca, nb_tca));
 
+#if CONFIG_BMU_SD_LOG_ENABLED
+    /* Journal SD : monte la carte ; sans carte, ni file ni tâche */
+    if (bmu_sd_log_start_task(SD_LOG_HEADER, 1, 4096) == ESP_OK) {
+        s_q_sdlog = xQueueCreate(1, sizeof(bmu_snapshot_t));
+        if (s_q_sdlog) xTaskCreate(sd_log_task, "sd_fmt", 3072, NULL, 2, NULL);
+    }
+#endif
+
     // Wire RTOS queues to protection
     bmu_protection_queues_t prot_queues = {
         .q_balancer = s_q_balancer,
         .q_display  = s_q_display,
         .q_cloud    = s_q_cloud,
         .q_ble      = s_q_ble,
+        .q_soc      = s_q_soc,
+        .q_sdlog    = s_q_sdlog,
         .q_cmd      = s_q_cmd,
     };
     bmu_protection_set_queues(&prot, &prot_queues);
 
     bmu_battery_manager_init(&mgr, ina, nb_ina);
+    bmu_protection_set_battery_manager(&prot, &mgr);  /* Ah/Wh à chaque acquisition */
     bmu_ble_set_nb_ina(nb_ina); /* Update BLE after I2C scan */
-    if (nb_ina > 0) {
-        bmu_battery_manager_start(&mgr);
+    /* Tâche checkpoint NVS — ne touche pas l'I2C, démarrée même sans batterie
+     * au boot pour couvrir les batteries ajoutées par hotplug. */
+    bmu_battery_manager_start(&mgr);
+
+    /* Pipeline télémétrie : une trame par cycle pour cloud, VRM, ... */
+    if (bmu_telem_init(&mgr, s_q_cloud) == ESP_OK) {
+        bmu_telem_start_task(2, 3072);
+#ifdef CONFIG_BMU_BLE_ENABLED
+        bmu_ble_victron_gatt_init();    /* SmartShunt GATT : sink du pipeline */
+#endif
     }
 
 #if CONFIG_BMU_SOH_ENABLED
@@ -552,6 +743,10 @@ extern "C" void app_main(void)
     }
 #endif
 
+    /* Tendance R_int/SOH/capacité → RUL (historique sur /fatfs) */
+    bmu_rul_init(&mgr);
+    bmu_rul_start_task(1, 4096);
+
     /* Display context: nb_ina_ptr pointe vers prot.nb_ina (live via hotplug) */
     disp_ctx.q_snapshot = s_q_display;
     bmu_display_request_update();
@@ -595,7 +790,9 @@ extern "C" void app_main(void)
     /* Persistance offline de la voie directe (rejeu à la reconnexion WiFi).
        Uniquement en mode InfluxDB direct ; en MQTT-only il n'y a pas de
        buffer offline (cf. compromis QoS documenté). */
-    bmu_influx_store_init();
+    if (bmu_influx_store_init() == ESP_OK) {
+        bmu_influx_store_start_task(2, 3072);
+    }
 #endif
     {
         bmu_balancer_config_t bal_cfg = {
@@ -605,23 +802,30 @@ extern "C" void app_main(void)
         bmu_balancer_init(&bal_cfg);
         bmu_balancer_start_task(3, 3072);
     }
+    {
+        bmu_soc_config_t soc_cfg = {
+            .q_snapshot = s_q_soc,
+        };
+        bmu_soc_init(&soc_cfg);
+        bmu_soc_start_task(3, 3072);
+    }
     if (bmu_wifi_is_connected()) {
         bmu_mqtt_init();
 #if CONFIG_BMU_INFLUX_DIRECT_ENABLED
         bmu_influx_init();
 #endif
 
-        /* Cloud telemetry task — push MQTT + InfluxDB toutes les 10s */
+        /* Cloud telemetry task — MQTT sur changement, InfluxDB toutes les 10s,
+         * réveillée par le pipeline télémétrie */
         static cloud_task_ctx_t cloud_ctx = {};
         cloud_ctx.prot = &prot;
         cloud_ctx.mgr = &mgr;
-        cloud_ctx.nb_ina = &nb_ina;
-        cloud_ctx.q_snapshot = s_q_cloud;
-        cloud_ctx.nb_ina_mutex = nb_ina_mutex;
-        xTaskCreate(cloud_telemetry_task, "cloud", 4096, &cloud_ctx, 2, NULL);
+        if (xTaskCreate(cloud_telemetry_task, "cloud", 4096, &cloud_ctx, 2, &s_cloud_task) == pdPASS) {
+            bmu_telem_subscribe("cloud", CLOUD_TICK_MS, cloud_sink_cb, NULL);
+        }
 
-        /* VRM — publish to Victron cloud */
-        bmu_vrm_init(&prot, &mgr, nb_ina);
+        /* VRM — publish to Victron cloud (sink du pipeline) */
+        bmu_vrm_init();
     }
 
     /* ── 12. VE.Direct ─────────────────────────────────────────────── */
@@ -0,0 +1,302 @@
+/**
+ * @file test_ble_fleet.cpp
+ * @brief Tests host de la caractéristique BLE flotte (bmu_ble_fleet) — Unity.
+ *
+ * Couverture :
+ *   - Keyframe initiale découpée au MTU, décodée à l'identique côté client
+ *   - Delta : seuls les champs hors bande morte, référence = dernier commit
+ *   - Envoi refusé (pas de commit) → keyframe au cycle suivant
+ *   - Keyframe sur changement de flotte, période key_ms, resync client
+ *   - Trou de séquence détecté par le client, MTU trop petit
+ *   - 32 batteries, 10 min : notifications/s et octets vs 32 caractéristiques
+ *   - Cadence adaptée aux intervalles de connexion (bmu_ble_notify_period_ms)
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include "bmu_ble_fleet.h"
+
+static const int32_t DB[BMU_BLE_FLEET_NB_FIELDS] = { 50, 200, 0, 10, 10, 0, 0 };
+static const bmu_ble_fleet_cfg_t CFG = { DB, 60000 };
+static const uint8_t FLEN[BMU_BLE_FLEET_NB_FIELDS] = { 2, 4, 1, 4, 4, 1, 1 };
+
+static bmu_ble_fleet_t s_f;
+static bmu_ble_fleet_batt_t s_cur[BMU_BLE_FLEET_MAX_BATT];
+static uint8_t s_buf[512];
+
+/* ── Client (application mobile) ─────────────────────────────────── */
+typedef struct {
+    bmu_ble_fleet_batt_t b[BMU_BLE_FLEET_MAX_BATT];
+    uint8_t  nb;
+    uint16_t seq;
+    bool     synced;
+    int      gaps;
+} client_t;
+
+static client_t s_cl;
+
+static uint32_t get(const uint8_t *p, uint8_t len)
+{
+    uint32_t v = 0;
+    for (uint8_t k = 0; k < len; k++) v |= (uint32_t)p[k] << (8 * k);
+    return v;
+}
+
+/* Applique une trame ; false = trou de seq (le client écrit pour resync) */
+static bool client_apply(client_t *c, const uint8_t *fr, size_t len)
+{
+    uint8_t flags = fr[0];
+    uint16_t seq = (uint16_t)get(fr + 1, 2);
+    bool in_seq = c->synced && seq == (uint16_t)(c->seq + 1);
+    c->seq = seq;
+    if (!(flags & BMU_BLE_FLEET_F_KEY) && !in_seq) {
+        c->synced = false;
+        c->gaps++;
+        return false;
+    }
+    c->synced = true;
+    c->nb = fr[3];
+    const uint8_t *p = fr + BMU_BLE_FLEET_HDR_LEN;
+    for (uint8_t r = 0; r < fr[4]; r++) {
+        uint8_t id = *p++, mask = *p++;
+        for (int k = 0; k < BMU_BLE_FLEET_NB_FIELDS; k++) {
+            if (!(mask & (1u << k))) continue;
+            c->b[id].f[k] = (int32_t)get(p, FLEN[k]);
+            p += FLEN[k];
+        }
+    }
+    TEST_ASSERT_EQUAL((size_t)(p - fr), len);
+    return true;
+}
+
+/* Un cycle complet : frames encodées, livrées (ou perdues), commit */
+static int run_cycle(uint8_t nb, uint32_t now, size_t cap, size_t *bytes, bool deliver)
+{
+    int frames = 0;
+    if (bmu_ble_fleet_prepare(&s_f, s_cur, nb, now) == 0) return 0;
+    size_t len;
+    while ((len = bmu_ble_fleet_next(&s_f, s_buf, cap)) > 0) {
+        TEST_ASSERT_TRUE(len <= cap);
+        frames++;
+        if (bytes) *bytes += len;
+        if (deliver && !client_apply(&s_cl, s_buf, len)) bmu_ble_fleet_resync(&s_f);
+    }
+    if (deliver) bmu_ble_fleet_commit(&s_f);
+    else bmu_ble_fleet_resync(&s_f);
+    return frames;
+}
+
+static void set_batt(int i, int32_t v_mv, int32_t i_ma, int32_t state)
+{
+    s_cur[i].f[BMU_BLE_FLEET_V] = v_mv;
+    s_cur[i].f[BMU_BLE_FLEET_I] = i_ma;
+    s_cur[i].f[BMU_BLE_FLEET_STATE] = state;
+    s_cur[i].f[BMU_BLE_FLEET_AH_D] = 1000 + i;
+    s_cur[i].f[BMU_BLE_FLEET_AH_C] = 500 + i;
+    s_cur[i].f[BMU_BLE_FLEET_NBSW] = i % 4;
+    s_cur[i].f[BMU_BLE_FLEET_BAL] = 100;
+}
+
+static void assert_client_matches(uint8_t nb)
+{
+    TEST_ASSERT_EQUAL(nb, s_cl.nb);
+    for (uint8_t i = 0; i < nb; i++) {
+        TEST_ASSERT_EQUAL_INT32_ARRAY(s_f.last[i].f, s_cl.b[i].f, BMU_BLE_FLEET_NB_FIELDS);
+    }
+}
+
+void setUp(void)
+{
+    bmu_ble_fleet_init(&s_f, &CFG);
+    memset(&s_cl, 0, sizeof(s_cl));
+    memset(s_cur, 0, sizeof(s_cur));
+    for (int i = 0; i < BMU_BLE_FLEET_MAX_BATT; i++) set_batt(i, 26000 + 10 * i, -500 + 40 * i, 1);
+}
+void tearDown(void) {}
+
+void test_keyframe_split_to_mtu(void)
+{
+    /* MTU 247 : 242 o utiles → 12 enregistrements complets par trame */
+    size_t bytes = 0;
+    int frames = run_cycle(32, 0, 247 - 3, &bytes, true);
+    TEST_ASSERT_EQUAL(3, frames);
+    TEST_ASSERT_EQUAL(3 * BMU_BLE_FLEET_HDR_LEN + 32 * BMU_BLE_FLEET_REC_MAX, bytes);
+    TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_LAST);
+    TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+    assert_client_matches(32);
+    TEST_ASSERT_EQUAL(-500, s_cl.b[0].f[BMU_BLE_FLEET_I]);
+
+    /* MTU 512 : deux trames ; MTU minimal : un enregistrement par trame */
+    bmu_ble_fleet_resync(&s_f);
+    TEST_ASSERT_EQUAL(2, run_cycle(32, 1000, 509, NULL, true));
+    bmu_ble_fleet_resync(&s_f);
+    TEST_ASSERT_EQUAL(32, run_cycle(32, 2000, BMU_BLE_FLEET_MIN_MTU - 3, NULL, true));
+    assert_client_matches(32);
+}
+
+void test_delta_only_changed_fields(void)
+{
+    run_cycle(8, 0, 244, NULL, true);
+    TEST_ASSERT_EQUAL(0, run_cycle(8, 500, 244, NULL, true));      /* rien n'a bougé */
+
+    s_cur[3].f[BMU_BLE_FLEET_V] += 51;                               /* > bande */
+    s_cur[5].f[BMU_BLE_FLEET_I] += 150;                              /* = bruit */
+    s_cur[6].f[BMU_BLE_FLEET_STATE] = 3;                             /* bande 0 */
+    size_t bytes = 0;
+    TEST_ASSERT_EQUAL(1, run_cycle(8, 1000, 244, &bytes, true));
+    TEST_ASSERT_EQUAL(BMU_BLE_FLEET_HDR_LEN + (2 + 2) + (2 + 1), bytes);
+    TEST_ASSERT_FALSE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+    TEST_ASSERT_EQUAL(2, s_buf[4]);
+    assert_client_matches(8);
+
+    /* Dérive lente : bande mesurée depuis la dernière valeur envoyée */
+    s_cur[5].f[BMU_BLE_FLEET_I] += 100;                              /* cumul 250 */
+    TEST_ASSERT_EQUAL(1, run_cycle(8, 1500, 244, NULL, true));
+    TEST_ASSERT_EQUAL(s_cur[5].f[BMU_BLE_FLEET_I], s_cl.b[5].f[BMU_BLE_FLEET_I]);
+}
+
+void test_clamped_fields(void)
+{
+    s_cur[0].f[BMU_BLE_FLEET_V] = -5;
+    s_cur[0].f[BMU_BLE_FLEET_BAL] = -1;                              /* phase OFF */
+    s_cur[0].f[BMU_BLE_FLEET_NBSW] = 900;
+    s_cur[1].f[BMU_BLE_FLEET_V] = 70000;
+    run_cycle(2, 0, 244, NULL, true);
+    TEST_ASSERT_EQUAL(0, s_cl.b[0].f[BMU_BLE_FLEET_V]);
+    TEST_ASSERT_EQUAL(BMU_BLE_FLEET_BAL_OFF, s_cl.b[0].f[BMU_BLE_FLEET_BAL]);
+    TEST_ASSERT_EQUAL(255, s_cl.b[0].f[BMU_BLE_FLEET_NBSW]);
+    TEST_ASSERT_EQUAL(65535, s_cl.b[1].f[BMU_BLE_FLEET_V]);
+    /* Valeur saturée inchangée : pas de delta */
+    s_cur[1].f[BMU_BLE_FLEET_V] = 80000;
+    TEST_ASSERT_EQUAL(0, run_cycle(2, 500, 244, NULL, true));
+}
+
+void test_failed_send_forces_keyframe(void)
+{
+    run_cycle(4, 0, 244, NULL, true);
+    s_cur[2].f[BMU_BLE_FLEET_STATE] = 2;
+    run_cycle(4, 500, 244, NULL, false);                             /* pile pleine */
+    size_t bytes = 0;
+    TEST_ASSERT_EQUAL(1, run_cycle(4, 1000, 244, &bytes, true));
+    TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+    TEST_ASSERT_EQUAL(BMU_BLE_FLEET_HDR_LEN + 4 * BMU_BLE_FLEET_REC_MAX, bytes);
+    assert_client_matches(4);
+    TEST_ASSERT_EQUAL(0, run_cycle(4, 1500, 244, NULL, true));
+}
+
+void test_keyframe_triggers(void)
+{
+    run_cycle(4, 0, 244, NULL, true);
+    TEST_ASSERT_EQUAL(0, run_cycle(4, 59000, 244, NULL, true));
+    TEST_ASSERT_EQUAL(1, run_cycle(4, 60000, 244, NULL, true));     /* key_ms */
+    TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+    TEST_ASSERT_EQUAL(1, run_cycle(5, 60500, 244, NULL, true));     /* hotplug */
+    TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+    assert_client_matches(5);
+    bmu_ble_fleet_resync(&s_f);                                      /* nouvel abonné */
+    TEST_ASSERT_EQUAL(1, run_cycle(5, 61000, 244, NULL, true));
+    TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+
+    /* key_ms = 0 (RBE désactivé) : keyframe à chaque cycle */
+    const bmu_ble_fleet_cfg_t always = { DB, 0 };
+    bmu_ble_fleet_init(&s_f, &always);
+    for (uint32_t t = 0; t < 3000; t += 500) {
+        TEST_ASSERT_EQUAL(1, run_cycle(5, t, 244, NULL, true));
+        TEST_ASSERT_TRUE(s_buf[0] & BMU_BLE_FLEET_F_KEY);
+    }
+}
+
+void test_sequence_gap_resync(void)
+{
+    run_cycle(4, 0, 244, NULL, true);
+    s_cur[1].f[BMU_BLE_FLEET_V] += 100;
+    /* Notification perdue côté radio : encodée, acceptée, jamais reçue */
+    TEST_ASSERT_EQUAL(1, bmu_ble_fleet_prepare(&s_f, s_cur, 4, 500));
+    TEST_ASSERT_TRUE(bmu_ble_fleet_next(&s_f, s_buf, 244) > 0);
+    bmu_ble_fleet_commit(&s_f);
+
+    s_cur[2].f[BMU_BLE_FLEET_V] += 100;
+    TEST_ASSERT_EQUAL(1, run_cycle(4, 1000, 244, NULL, true));
+    TEST_ASSERT_EQUAL(1, s_cl.gaps);
+    TEST_ASSERT_FALSE(s_cl.synced);
+    /* Le client a écrit → keyframe → état rétabli */
+    TEST_ASSERT_EQUAL(1, run_cycle(4, 1500, 244, NULL, true));
+    TEST_ASSERT_TRUE(s_cl.synced);
+    assert_client_matches(4);
+}
+
+void test_mtu_too_small(void)
+{
+    TEST_ASSERT_EQUAL(1, bmu_ble_fleet_prepare(&s_f, s_cur, 1, 0));
+    TEST_ASSERT_EQUAL(0, bmu_ble_fleet_next(&s_f, s_buf, 20));       /* MTU 23 */
+    TEST_ASSERT_TRUE(bmu_ble_fleet_next(&s_f, s_buf, BMU_BLE_FLEET_MIN_MTU - 3) > 0);
+}
+
+void test_fleet_traffic_vs_per_battery(void)
+{
+    /* 32 batteries, 10 min : bruit ±20 mV / ±100 mA, Ah +1 mAh/s sur la
+     * moitié, 3 changements d'état. Flotte à 500 ms vs 32 notifications/s. */
+    size_t bytes = 0;
+    int frames = 0;
+    for (uint32_t t = 0; t < 600000; t += 500) {
+        int k = (int)(t / 500);
+        for (int i = 0; i < 32; i++) {
+            s_cur[i].f[BMU_BLE_FLEET_V] = 26000 + 10 * i + ((k + i) % 3 - 1) * 20;
+            s_cur[i].f[BMU_BLE_FLEET_I] = -500 + 40 * i + ((k + i) % 5 - 2) * 50;
+            if (i % 2 == 0) s_cur[i].f[BMU_BLE_FLEET_AH_D] = 1000 + i + (int32_t)(t / 1000);
+        }
+        if (t == 100000 || t == 300000 || t == 450000) s_cur[k % 32].f[BMU_BLE_FLEET_STATE] ^= 2;
+        frames += run_cycle(32, t, 244, &bytes, true);
+    }
+    assert_client_matches(32);
+    TEST_ASSERT_EQUAL(0, s_cl.gaps);
+
+    const int legacy_notifs = 600 * 32;
+    const size_t legacy_bytes = (size_t)legacy_notifs * 15;
+    printf("10 min, 32 batteries : flotte %d notifications (%.2f/s, %u o) vs "
+           "%d (%d/s, %u o) par batterie\n",
+           frames, frames / 600.0, (unsigned)bytes, legacy_notifs, 32, (unsigned)legacy_bytes);
+    TEST_ASSERT_TRUE(frames <= 2 * 1200);                            /* ≤ 2 par cycle */
+    TEST_ASSERT_TRUE(bytes * 4 < legacy_bytes);
+}
+
+void test_notify_period_from_conn_interval(void)
+{
+    /* Sans client : plancher */
+    TEST_ASSERT_EQUAL_UINT32(500, bmu_ble_notify_period_ms(NULL, 0, 2, 500, 5000));
+
+    /* 1 client à 30 ms, 2 trames flotte : un événement suffit */
+    const uint16_t fast[] = { 24 };
+    TEST_ASSERT_EQUAL_UINT32(500, bmu_ble_notify_period_ms(fast, 1, 2, 500, 5000));
+    TEST_ASSERT_EQUAL_UINT32(500, bmu_ble_notify_period_ms(fast, 1, 0, 500, 5000));
+
+    /* 3 clients à 100 ms, 32 notifications par batterie : 8 événements × 300 ms */
+    const uint16_t slow[] = { 80, 80, 80 };
+    TEST_ASSERT_EQUAL_UINT32(2400, bmu_ble_notify_period_ms(slow, 3, 32, 1000, 5000));
+
+    /* Intervalle maximal 4 s : borné au plafond */
+    const uint16_t max_itvl[] = { 3200 };
+    TEST_ASSERT_EQUAL_UINT32(5000, bmu_ble_notify_period_ms(max_itvl, 1, 8, 1000, 5000));
+
+    /* 7.5 ms × 5 événements = 37.5 → arrondi supérieur */
+    const uint16_t min_itvl[] = { 6 };
+    TEST_ASSERT_EQUAL_UINT32(38, bmu_ble_notify_period_ms(min_itvl, 1, 17, 0, 5000));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_keyframe_split_to_mtu);
+    RUN_TEST(test_delta_only_changed_fields);
+    RUN_TEST(test_clamped_fields);
+    RUN_TEST(test_failed_send_forces_keyframe);
+    RUN_TEST(test_keyframe_triggers);
+    RUN_TEST(test_sequence_gap_resync);
+    RUN_TEST(test_mtu_too_small);
+    RUN_TEST(test_fleet_traffic_vs_per_battery);
+    RUN_TEST(test_notify_period_from_conn_interval);
+    return UNITY_END();
+}
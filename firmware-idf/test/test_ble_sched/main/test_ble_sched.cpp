@@ -0,0 +1,215 @@
+/**
+ * @file test_ble_sched.cpp
+ * @brief Tests host de l'ordonnanceur de notifications BLE (bmu_ble_sched) — Unity.
+ *
+ * Couverture :
+ *   - Sans client : toutes les sources dues servies dans l'ordre de priorité
+ *   - Cadence min_ms avec tolérance de demi-cycle, source à chaque cycle (0/0)
+ *   - Budget = crédit radio / événements de connexion (somme des intervalles)
+ *   - Crédit consommé par une source, budget réduit pour les suivantes
+ *   - Source lourde : les autres reportées, forcées à max_ms, reprise du crédit
+ *   - Source batteries aux cadences du firmware : cadence relevée, partage du crédit
+ *   - Cadence relevée selon le nombre de notifications et les intervalles
+ *   - Table pleine, callback nul
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstring>
+#include "bmu_ble_sched.h"
+
+#define TOL_MS  250
+
+/* Source factice : renvoie `send` notifications et trace les appels */
+typedef struct {
+    int      send;
+    int      calls;
+    int      last_budget;
+    uint32_t last_ms;
+} fake_src_t;
+
+static bmu_ble_sched_t s;
+static fake_src_t bat, vic, sys;
+static char s_order[8];
+static int  s_nb_order;
+
+static int fake_fn(uint32_t now_ms, int budget, void *arg)
+{
+    fake_src_t *f = (fake_src_t *)arg;
+    f->calls++;
+    f->last_budget = budget;
+    f->last_ms = now_ms;
+    if (s_nb_order < (int)sizeof(s_order) - 1) {
+        s_order[s_nb_order++] = f == &bat ? 'B' : f == &vic ? 'V' : 'S';
+    }
+    return f->send;
+}
+
+void setUp(void)
+{
+    memset(&bat, 0, sizeof(bat));
+    memset(&vic, 0, sizeof(vic));
+    memset(&sys, 0, sizeof(sys));
+    memset(s_order, 0, sizeof(s_order));
+    s_nb_order = 0;
+    bmu_ble_sched_init(&s, TOL_MS);
+}
+void tearDown(void) {}
+
+static void add_all(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, bmu_ble_sched_add(&s, "bat", 0, 0, fake_fn, &bat));
+    TEST_ASSERT_EQUAL_INT(1, bmu_ble_sched_add(&s, "vic", 1000, 5000, fake_fn, &vic));
+    TEST_ASSERT_EQUAL_INT(2, bmu_ble_sched_add(&s, "sys", 10000, 30000, fake_fn, &sys));
+}
+
+/* ── Ordre et cadence ────────────────────────────────────────────── */
+
+void test_no_client_all_served_in_order(void)
+{
+    add_all();
+    bmu_ble_sched_reset(&s, 100000);
+    bat.send = 40;
+    vic.send = 7;
+    sys.send = 2;
+    TEST_ASSERT_EQUAL_INT(49, bmu_ble_sched_run(&s, 100000, NULL, 0));
+    TEST_ASSERT_EQUAL_STRING("BVS", s_order);
+    TEST_ASSERT_EQUAL_INT(BMU_BLE_SCHED_UNLIMITED, sys.last_budget);
+    TEST_ASSERT_EQUAL_INT32(BMU_BLE_SCHED_WINDOW_MS, s.credit_ms);
+}
+
+void test_cadence_with_tolerance(void)
+{
+    add_all();
+    uint32_t t0 = 50000;
+    bmu_ble_sched_reset(&s, t0);
+    bmu_ble_sched_run(&s, t0, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(1, vic.calls);
+
+    bmu_ble_sched_run(&s, t0 + 500, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(1, vic.calls);
+    TEST_ASSERT_EQUAL_INT(2, bat.calls);            /* 0/0 : chaque cycle */
+
+    bmu_ble_sched_run(&s, t0 + 1000 - TOL_MS, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(2, vic.calls);
+    TEST_ASSERT_EQUAL_INT(1, sys.calls);
+
+    bmu_ble_sched_run(&s, t0 + 10000, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(2, sys.calls);
+}
+
+/* ── Budget radio ────────────────────────────────────────────────── */
+
+void test_budget_from_credit(void)
+{
+    const uint16_t fast[] = { 24 };                 /* 30 ms */
+    const uint16_t slow[] = { 80, 80, 80 };         /* 3 × 100 ms */
+    /* 1000 ms / 30 ms = 33 événements × 4 */
+    TEST_ASSERT_EQUAL_INT(132, bmu_ble_sched_budget(1000, fast, 1));
+    /* 1000 ms / 300 ms = 3 événements × 4 */
+    TEST_ASSERT_EQUAL_INT(12, bmu_ble_sched_budget(1000, slow, 3));
+    TEST_ASSERT_EQUAL_INT(0, bmu_ble_sched_budget(200, slow, 3));
+    TEST_ASSERT_EQUAL_INT(0, bmu_ble_sched_budget(-500, fast, 1));
+    TEST_ASSERT_EQUAL_INT(BMU_BLE_SCHED_UNLIMITED, bmu_ble_sched_budget(-500, NULL, 0));
+}
+
+void test_credit_consumed_by_priority_source(void)
+{
+    const uint16_t fast[] = { 24 };
+    add_all();
+    bmu_ble_sched_reset(&s, 20000);
+    bat.send = 10;                                  /* 3 événements = 90 ms */
+    bmu_ble_sched_run(&s, 20000, fast, 1);
+    TEST_ASSERT_EQUAL_INT(132, bat.last_budget);
+    TEST_ASSERT_EQUAL_INT(120, vic.last_budget);    /* 910 ms / 30 ms = 30 × 4 */
+    TEST_ASSERT_EQUAL_INT32(910, s.credit_ms);
+}
+
+/* VictronConnect + application : 32 notifications batterie par cycle
+ * saturent 3 clients lents ; le SmartShunt est reporté puis forcé à max_ms */
+void test_heavy_source_defers_others(void)
+{
+    const uint16_t slow[] = { 80, 80, 80 };
+    add_all();
+    uint32_t t0 = 100000;
+    bmu_ble_sched_reset(&s, t0);
+    bat.send = 32;
+    vic.send = 7;
+    for (uint32_t t = t0; t < t0 + 4500; t += 500) bmu_ble_sched_run(&s, t, slow, 3);
+    TEST_ASSERT_EQUAL_INT32(-BMU_BLE_SCHED_WINDOW_MS, s.credit_ms);
+    TEST_ASSERT_EQUAL_INT(1, vic.calls);            /* reset : dû d'office */
+    TEST_ASSERT_TRUE(s.src[1].deferred >= 6);
+
+    bmu_ble_sched_run(&s, t0 + 5000, slow, 3);
+    TEST_ASSERT_EQUAL_INT(2, vic.calls);            /* plafond max_ms */
+    TEST_ASSERT_EQUAL_INT(0, vic.last_budget);
+
+    /* Batteries au repos : le crédit revient, le SmartShunt à sa cadence */
+    bat.send = 0;
+    int before = vic.calls;
+    for (uint32_t t = t0 + 5500; t <= t0 + 10000; t += 500) bmu_ble_sched_run(&s, t, slow, 3);
+    TEST_ASSERT_TRUE(vic.calls >= before + 2);
+    TEST_ASSERT_TRUE(vic.last_budget > 0);
+}
+
+/* Cadences du firmware : la source batteries passe elle aussi par le
+ * crédit et voit sa cadence relevée au lieu d'être servie à chaque cycle */
+void test_battery_source_shares_credit(void)
+{
+    const uint16_t slow[] = { 80, 80, 80 };
+    TEST_ASSERT_EQUAL_INT(0, bmu_ble_sched_add(&s, "bat", 500, 5000, fake_fn, &bat));
+    TEST_ASSERT_EQUAL_INT(1, bmu_ble_sched_add(&s, "vic", 1000, 5000, fake_fn, &vic));
+    TEST_ASSERT_EQUAL_INT(2, bmu_ble_sched_add(&s, "sys", 10000, 30000, fake_fn, &sys));
+    uint32_t t0 = 200000;
+    bmu_ble_sched_reset(&s, t0);
+    bat.send = 32;
+    vic.send = 7;
+    sys.send = 2;
+    for (uint32_t t = t0; t < t0 + 20000; t += 500) bmu_ble_sched_run(&s, t, slow, 3);
+    TEST_ASSERT_TRUE(bat.calls <= 10);              /* 0/0 : 40 appels */
+    TEST_ASSERT_TRUE(s.src[0].period_ms > 500);
+    TEST_ASSERT_TRUE(vic.calls >= 4);               /* au moins tous les max_ms */
+    TEST_ASSERT_TRUE(sys.calls >= 1);
+}
+
+void test_period_follows_connections(void)
+{
+    const uint16_t slow[] = { 80, 80, 80 };
+    add_all();
+    bmu_ble_sched_reset(&s, 30000);
+    vic.send = 32;                                  /* 8 événements × 300 ms */
+    bmu_ble_sched_run(&s, 30000, slow, 3);
+    TEST_ASSERT_EQUAL_UINT32(2400, s.src[1].period_ms);
+    TEST_ASSERT_EQUAL_UINT32(0, s.src[0].period_ms);
+
+    vic.send = 4;
+    bmu_ble_sched_run(&s, 35000, slow, 3);
+    TEST_ASSERT_EQUAL_UINT32(1000, s.src[1].period_ms);
+}
+
+/* ── Bornes ──────────────────────────────────────────────────────── */
+
+void test_table_full_and_null_fn(void)
+{
+    TEST_ASSERT_EQUAL_INT(-1, bmu_ble_sched_add(&s, "nul", 0, 0, NULL, NULL));
+    for (int k = 0; k < BMU_BLE_SCHED_MAX_SRC; k++) {
+        TEST_ASSERT_EQUAL_INT(k, bmu_ble_sched_add(&s, "x", 1000, 100, fake_fn, &sys));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, bmu_ble_sched_add(&s, "trop", 0, 0, fake_fn, &sys));
+    TEST_ASSERT_EQUAL_UINT32(1000, s.src[0].max_ms);        /* max relevé au min */
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_client_all_served_in_order);
+    RUN_TEST(test_cadence_with_tolerance);
+    RUN_TEST(test_budget_from_credit);
+    RUN_TEST(test_credit_consumed_by_priority_source);
+    RUN_TEST(test_heavy_source_defers_others);
+    RUN_TEST(test_battery_source_shares_credit);
+    RUN_TEST(test_period_follows_connections);
+    RUN_TEST(test_table_full_and_null_fn);
+    return UNITY_END();
+}
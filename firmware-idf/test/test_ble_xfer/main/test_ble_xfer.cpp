@@ -0,0 +1,521 @@
+/**
+ * @file test_ble_xfer.cpp
+ * @brief Tests host du téléchargement d'historique BLE (bmu_ble_xfer) — Unity.
+ *
+ * Couverture :
+ *   - Commandes OPEN / ACK / ABORT : aller-retour, longueurs invalides, états
+ *   - Ligne CSV du journal → ligne BIN 14 o (saturation, heure invalide)
+ *   - Trames alignées sur les PDU de la couche liaison
+ *   - Flux découpé au MTU, fenêtre jamais dépassée, CRC identique des deux côtés
+ *   - Reprise après coupure : rien avant resume n'est réémis, CRC du flux entier
+ *   - Récepteur : doublon ignoré, trou signalé, ACK toutes les window / 2 trames
+ *   - Lien NimBLE simulé (intervalle, PHY, DLE, PDU par événement, mbufs) :
+ *     une journée de 32 batteries en BIN, comparée au service sans réglages
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "bmu_ble_xfer.h"
+#include "bmu_influx_gzip.h"
+
+static uint32_t get(const uint8_t *p, uint8_t len)
+{
+    uint32_t v = 0;
+    for (uint8_t k = 0; k < len; k++) v |= (uint32_t)p[k] << (8 * k);
+    return v;
+}
+
+/* Flux de référence : lignes CSV du journal, empaquetées en BIN */
+static size_t make_row(char *buf, size_t cap, uint32_t t_s, int bat)
+{
+    int ma = (int)((t_s * 37u + (uint32_t)bat * 101u) % 20000u) - 10000;
+    return (size_t)snprintf(buf, cap, "%llu,%u,%d,%d,%d,%d,%d,%d",
+                            (unsigned long long)t_s * 1000ULL, t_s * 1000u, bat,
+                            24000 + bat * 10 + (int)(t_s % 50), ma, 1, (int)(t_s / 3600), 100);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/* ── Commandes ───────────────────────────────────────────────────── */
+
+void test_cmd_roundtrip(void)
+{
+    bmu_ble_xfer_cmd_t c = {};
+    c.op = BMU_BLE_XFER_OP_OPEN;
+    c.source = BMU_BLE_XFER_SRC_SD_LOG;
+    c.format = BMU_BLE_XFER_FMT_BIN;
+    c.key = 7;
+    c.step_s = 60;
+    c.offset = 123456;
+    c.from_ms = 1760000000000LL;
+    c.to_ms = 1760086400000LL;
+    c.window = 16;
+
+    uint8_t buf[64];
+    TEST_ASSERT_EQUAL(BMU_BLE_XFER_OPEN_LEN, bmu_ble_xfer_encode_cmd(&c, buf));
+    bmu_ble_xfer_cmd_t d;
+    TEST_ASSERT_TRUE(bmu_ble_xfer_parse_cmd(buf, BMU_BLE_XFER_OPEN_LEN, &d));
+    TEST_ASSERT_EQUAL(0, memcmp(&c, &d, sizeof(c)));
+
+    /* Longueurs invalides */
+    TEST_ASSERT_FALSE(bmu_ble_xfer_parse_cmd(buf, BMU_BLE_XFER_OPEN_LEN - 1, &d));
+    TEST_ASSERT_FALSE(bmu_ble_xfer_parse_cmd(buf, 0, &d));
+
+    c.op = BMU_BLE_XFER_OP_ACK;
+    c.offset = 0xA1B2C3D4;
+    TEST_ASSERT_EQUAL(5, bmu_ble_xfer_encode_cmd(&c, buf));
+    TEST_ASSERT_TRUE(bmu_ble_xfer_parse_cmd(buf, 5, &d));
+    TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4, d.offset);
+    TEST_ASSERT_FALSE(bmu_ble_xfer_parse_cmd(buf, 4, &d));
+
+    c.op = BMU_BLE_XFER_OP_ABORT;
+    TEST_ASSERT_EQUAL(1, bmu_ble_xfer_encode_cmd(&c, buf));
+    TEST_ASSERT_TRUE(bmu_ble_xfer_parse_cmd(buf, 1, &d));
+    TEST_ASSERT_FALSE(bmu_ble_xfer_parse_cmd(buf, 2, &d));
+
+    buf[0] = 0x42;
+    TEST_ASSERT_FALSE(bmu_ble_xfer_parse_cmd(buf, 1, &d));
+
+    /* État DONE : op | total | crc */
+    TEST_ASSERT_EQUAL(BMU_BLE_XFER_STATUS_LEN,
+                      bmu_ble_xfer_encode_status(BMU_BLE_XFER_ST_DONE, 1000, 0xDEADBEEF, buf));
+    TEST_ASSERT_EQUAL_HEX8(BMU_BLE_XFER_ST_DONE, buf[0]);
+    TEST_ASSERT_EQUAL_UINT32(1000, get(buf + 1, 4));
+    TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, get(buf + 5, 4));
+}
+
+/* ── Ligne BIN ───────────────────────────────────────────────────── */
+
+void test_pack_row(void)
+{
+    uint8_t r[BMU_BLE_XFER_ROW_LEN];
+    const char *row = "1760000000500,12345,4,26410,-1520,2,7,93";
+    TEST_ASSERT_TRUE(bmu_ble_xfer_pack_row(row, strlen(row), r));
+    TEST_ASSERT_EQUAL_UINT32(1760000000, get(r, 4));
+    TEST_ASSERT_EQUAL_UINT8(4, r[4]);
+    TEST_ASSERT_EQUAL_UINT8(2, r[5]);
+    TEST_ASSERT_EQUAL_UINT32(26410, get(r + 6, 2));
+    TEST_ASSERT_EQUAL_INT32(-1520, (int32_t)get(r + 8, 4));
+    TEST_ASSERT_EQUAL_UINT8(7, r[12]);
+    TEST_ASSERT_EQUAL_UINT8(93, r[13]);
+
+    /* Saturation tension et commutations */
+    const char *sat = "1760000000000,0,1,70000,0,0,300,100";
+    TEST_ASSERT_TRUE(bmu_ble_xfer_pack_row(sat, strlen(sat), r));
+    TEST_ASSERT_EQUAL_UINT32(UINT16_MAX, get(r + 6, 2));
+    TEST_ASSERT_EQUAL_UINT8(255, r[12]);
+
+    /* Heure non synchronisée, colonne manquante, champ non numérique */
+    const char *no_time = "0,12345,4,26410,-1520,2,7,93";
+    const char *short_row = "1760000000500,12345,4,26410,-1520,2,7";
+    const char *bad = "1760000000500,12345,4,26x10,-1520,2,7,93";
+    TEST_ASSERT_FALSE(bmu_ble_xfer_pack_row(no_time, strlen(no_time), r));
+    TEST_ASSERT_FALSE(bmu_ble_xfer_pack_row(short_row, strlen(short_row), r));
+    TEST_ASSERT_FALSE(bmu_ble_xfer_pack_row(bad, strlen(bad), r));
+}
+
+void test_frame_cap_aligned_to_ll(void)
+{
+    /* MTU 512 + DLE 251 : 495 + 7 = 2 PDU pleins (509 en prendrait 3) */
+    TEST_ASSERT_EQUAL(495, bmu_ble_xfer_frame_cap(509, 251));
+    /* MTU 247 : 244 + 7 = 251, déjà aligné */
+    TEST_ASSERT_EQUAL(244, bmu_ble_xfer_frame_cap(244, 251));
+    /* Sans DLE (27 o) : 506 + 7 = 19 PDU */
+    TEST_ASSERT_EQUAL(506, bmu_ble_xfer_frame_cap(509, 27));
+    /* MTU 23 : plus petit qu'un PDU, inchangé */
+    TEST_ASSERT_EQUAL(20, bmu_ble_xfer_frame_cap(20, 251));
+    /* Borné à la valeur d'attribut max */
+    TEST_ASSERT_EQUAL(BMU_BLE_XFER_FRAME_MAX, bmu_ble_xfer_frame_cap(600, 0));
+}
+
+/* ── Flux en mémoire ─────────────────────────────────────────────── */
+
+typedef struct {
+    bmu_ble_xfer_tx_t *tx;
+    bmu_ble_xfer_rx_t  rx;
+    std::vector<uint8_t> got;
+    uint16_t max_inflight;
+    uint32_t first_off;
+    int      frames;
+    int      acks;
+    int      fail_after;      /* coupure après n trames, -1 = jamais */
+    uint32_t ack;             /* dernier ACK client, vu par le BMU à la trame suivante */
+} loop_t;
+
+/* Client immédiat : chaque trame est reçue, l'ACK arrive avant la suivante */
+static bool loop_emit(const uint8_t *frame, size_t len, void *arg)
+{
+    loop_t *l = (loop_t *)arg;
+    if (l->fail_after >= 0 && l->frames >= l->fail_after) return false;
+    bmu_ble_xfer_tx_ack(l->tx, l->ack);       /* ACK de la trame précédente */
+    TEST_ASSERT_TRUE(len <= (size_t)l->tx->payload + BMU_BLE_XFER_HDR_LEN);
+    uint16_t inflight = (uint16_t)(bmu_ble_xfer_tx_inflight(l->tx) + 1);
+    if (inflight > l->max_inflight) l->max_inflight = inflight;
+    TEST_ASSERT_TRUE(inflight <= l->tx->window);
+    if (l->frames++ == 0) l->first_off = get(frame, 4);
+
+    const uint8_t *data;
+    size_t n;
+    if (bmu_ble_xfer_rx_feed(&l->rx, frame, len, &data, &n)) {
+        l->acks++;
+        l->ack = l->rx.next;
+    }
+    l->got.insert(l->got.end(), data, data + n);
+    return true;
+}
+
+static std::vector<uint8_t> make_stream(size_t rows)
+{
+    std::vector<uint8_t> s;
+    char line[96];
+    uint8_t r[BMU_BLE_XFER_ROW_LEN];
+    for (size_t k = 0; k < rows; k++) {
+        size_t n = make_row(line, sizeof(line), 1760000000u + (uint32_t)(k / 32), (int)(k % 32) + 1);
+        TEST_ASSERT_TRUE(bmu_ble_xfer_pack_row(line, n, r));
+        s.insert(s.end(), r, r + sizeof(r));
+    }
+    return s;
+}
+
+/* Écrit le flux par morceaux irréguliers, comme les lectures du journal */
+static bool feed_stream(bmu_ble_xfer_tx_t *tx, const std::vector<uint8_t> &s,
+                        bmu_ble_xfer_emit_fn_t emit, void *arg)
+{
+    size_t pos = 0, k = 0;
+    while (pos < s.size()) {
+        size_t n = 1 + (k++ * 97) % 700;
+        if (n > s.size() - pos) n = s.size() - pos;
+        if (!bmu_ble_xfer_tx_write(tx, s.data() + pos, n, emit, arg)) return false;
+        pos += n;
+    }
+    return bmu_ble_xfer_tx_finish(tx, emit, arg);
+}
+
+void test_stream_mtu_window_crc(void)
+{
+    std::vector<uint8_t> s = make_stream(3000);
+    uint32_t ref = bmu_gzip_crc32(0, s.data(), s.size());
+    static bmu_ble_xfer_tx_t tx;
+
+    const size_t caps[] = { 20, 244, 495, 509 };
+    for (size_t c = 0; c < sizeof(caps) / sizeof(caps[0]); c++) {
+        loop_t l = {};
+        l.tx = &tx;
+        l.fail_after = -1;
+        bmu_ble_xfer_tx_open(&tx, 0, caps[c], 8);
+        bmu_ble_xfer_rx_init(&l.rx, 0, 0, 8);
+        TEST_ASSERT_TRUE(feed_stream(&tx, s, loop_emit, &l));
+
+        TEST_ASSERT_TRUE(l.rx.done);
+        TEST_ASSERT_FALSE(l.rx.gap);
+        TEST_ASSERT_EQUAL(s.size(), l.got.size());
+        TEST_ASSERT_EQUAL(0, memcmp(s.data(), l.got.data(), s.size()));
+        TEST_ASSERT_EQUAL_HEX32(ref, tx.crc);
+        TEST_ASSERT_EQUAL_HEX32(ref, l.rx.crc);
+        TEST_ASSERT_EQUAL_UINT32(s.size(), tx.sent);
+        /* Trames pleines + une de fin ; ACK toutes les 4 trames */
+        int frames = (int)(s.size() / tx.payload) + 1;
+        TEST_ASSERT_EQUAL(frames, l.frames);
+        TEST_ASSERT_TRUE(l.acks >= frames / 4);
+        TEST_ASSERT_TRUE(l.max_inflight <= 8);
+    }
+}
+
+void test_window_and_ack(void)
+{
+    static bmu_ble_xfer_tx_t tx;
+    bmu_ble_xfer_tx_open(&tx, 0, 105, 4);      /* 100 o utiles */
+    TEST_ASSERT_EQUAL(100, tx.payload);
+    TEST_ASSERT_EQUAL(4, tx.window);
+
+    tx.sent = 400;
+    TEST_ASSERT_EQUAL(4, bmu_ble_xfer_tx_inflight(&tx));
+    bmu_ble_xfer_tx_ack(&tx, 200);
+    TEST_ASSERT_EQUAL(2, bmu_ble_xfer_tx_inflight(&tx));
+    bmu_ble_xfer_tx_ack(&tx, 100);              /* recule : ignoré */
+    TEST_ASSERT_EQUAL_UINT32(200, tx.acked);
+    bmu_ble_xfer_tx_ack(&tx, 500);              /* au-delà de l'émis : ignoré */
+    TEST_ASSERT_EQUAL_UINT32(200, tx.acked);
+    bmu_ble_xfer_tx_ack(&tx, 350);              /* milieu de trame */
+    TEST_ASSERT_EQUAL(1, bmu_ble_xfer_tx_inflight(&tx));
+
+    /* Fenêtre bornée */
+    bmu_ble_xfer_tx_open(&tx, 0, 100, 0);
+    TEST_ASSERT_EQUAL(1, tx.window);
+    bmu_ble_xfer_tx_open(&tx, 0, 100, 1000);
+    TEST_ASSERT_EQUAL(BMU_BLE_XFER_WINDOW_MAX, tx.window);
+    bmu_ble_xfer_tx_open(&tx, 0, 2000, 8);
+    TEST_ASSERT_EQUAL(BMU_BLE_XFER_FRAME_MAX - BMU_BLE_XFER_HDR_LEN, tx.payload);
+}
+
+void test_resume_after_cut(void)
+{
+    std::vector<uint8_t> s = make_stream(2000);
+    uint32_t ref = bmu_gzip_crc32(0, s.data(), s.size());
+    static bmu_ble_xfer_tx_t tx;
+
+    /* Coupure après 23 trames */
+    loop_t l = {};
+    l.tx = &tx;
+    l.fail_after = 23;
+    bmu_ble_xfer_tx_open(&tx, 0, 244, 8);
+    bmu_ble_xfer_rx_init(&l.rx, 0, 0, 8);
+    TEST_ASSERT_FALSE(feed_stream(&tx, s, loop_emit, &l));
+    uint32_t resume = l.rx.next;
+    TEST_ASSERT_EQUAL_UINT32(23u * 239u, resume);
+
+    /* OPEN avec resume : le flux est regénéré depuis le début */
+    loop_t r = {};
+    r.tx = &tx;
+    r.fail_after = -1;
+    r.got = l.got;
+    bmu_ble_xfer_tx_open(&tx, resume, 244, 8);
+    bmu_ble_xfer_rx_init(&r.rx, resume, l.rx.crc, 8);
+    TEST_ASSERT_TRUE(feed_stream(&tx, s, loop_emit, &r));
+
+    TEST_ASSERT_EQUAL_UINT32(resume, r.first_off);
+    TEST_ASSERT_EQUAL((int)((s.size() - resume) / tx.payload) + 1, r.frames);
+    TEST_ASSERT_EQUAL(s.size(), r.got.size());
+    TEST_ASSERT_EQUAL(0, memcmp(s.data(), r.got.data(), s.size()));
+    TEST_ASSERT_EQUAL_HEX32(ref, tx.crc);
+    TEST_ASSERT_EQUAL_HEX32(ref, r.rx.crc);
+}
+
+void test_rx_duplicate_and_gap(void)
+{
+    bmu_ble_xfer_rx_t rx;
+    bmu_ble_xfer_rx_init(&rx, 0, 0, 4);        /* ACK toutes les 2 trames */
+    uint8_t fr[BMU_BLE_XFER_HDR_LEN + 10] = {};
+    const uint8_t *d;
+    size_t n;
+
+    TEST_ASSERT_FALSE(bmu_ble_xfer_rx_feed(&rx, fr, sizeof(fr), &d, &n));
+    TEST_ASSERT_EQUAL(10, n);
+    /* Doublon de la trame 0 : ignoré, pas de trou */
+    TEST_ASSERT_FALSE(bmu_ble_xfer_rx_feed(&rx, fr, sizeof(fr), &d, &n));
+    TEST_ASSERT_EQUAL(0, n);
+    TEST_ASSERT_FALSE(rx.gap);
+
+    fr[0] = 10;
+    TEST_ASSERT_TRUE(bmu_ble_xfer_rx_feed(&rx, fr, sizeof(fr), &d, &n));
+    TEST_ASSERT_EQUAL_UINT32(20, rx.next);
+
+    /* Trame 30 perdue, 40 reçue : trou */
+    fr[0] = 40;
+    TEST_ASSERT_FALSE(bmu_ble_xfer_rx_feed(&rx, fr, sizeof(fr), &d, &n));
+    TEST_ASSERT_TRUE(rx.gap);
+    TEST_ASSERT_EQUAL_UINT32(20, rx.next);
+
+    /* Trame de fin vide : ACK immédiat, plus rien accepté ensuite */
+    fr[0] = 20;
+    fr[4] = BMU_BLE_XFER_F_END;
+    TEST_ASSERT_TRUE(bmu_ble_xfer_rx_feed(&rx, fr, BMU_BLE_XFER_HDR_LEN, &d, &n));
+    TEST_ASSERT_TRUE(rx.done);
+    TEST_ASSERT_FALSE(bmu_ble_xfer_rx_feed(&rx, fr, sizeof(fr), &d, &n));
+
+    TEST_ASSERT_FALSE(bmu_ble_xfer_rx_feed(&rx, fr, 3, &d, &n));
+}
+
+/* ── Lien NimBLE simulé ──────────────────────────────────────────── */
+
+typedef struct {
+    const char *name;
+    double   itvl_ms;         /* intervalle de connexion accepté par le téléphone */
+    uint16_t mtu;
+    uint16_t ll_octets;       /* 27 sans DLE, 251 avec */
+    bool     phy_2m;
+    bool     align;           /* trames alignées sur les PDU (bmu_ble_xfer_frame_cap) */
+    uint16_t window;
+} link_profile_t;
+
+/* Plafond de PDU par événement côté téléphone (hypothèse prudente) */
+#define SIM_PDU_CAP     10
+/* Pool de mbufs NimBLE : 48 blocs de 256 o (sdkconfig.defaults) */
+#define SIM_MBUF_BYTES  (48 * 256)
+
+typedef struct {
+    const link_profile_t *lp;
+    bmu_ble_xfer_tx_t *tx;
+    int      pdus_ev;
+    double   now_ms;
+    std::deque<std::vector<uint8_t>> q;       /* notifications dans la pile */
+    int      head_pdus;
+    size_t   q_bytes;
+    std::deque<std::pair<double, uint32_t>> acks;   /* écritures ACK en route */
+    bmu_ble_xfer_rx_t rx;
+    uint32_t got;
+    uint32_t cut_at;          /* coupure quand le client a reçu cut_at octets */
+    bool     connected;
+    bool     stalled;
+} sim_t;
+
+static int pdus_for(const sim_t *s, size_t att_len)
+{
+    size_t sdu = att_len + 3 + 4;             /* en-têtes ATT + L2CAP */
+    return (int)((sdu + s->lp->ll_octets - 1) / s->lp->ll_octets);
+}
+
+static void sim_init(sim_t *s, const link_profile_t *lp, bmu_ble_xfer_tx_t *tx)
+{
+    s->lp = lp;
+    s->tx = tx;
+    /* PDU plein + ACK vide + 2 × T_IFS (150 µs), préambule et en-têtes compris */
+    double bits = (lp->ll_octets + 14) * 8.0;
+    double pdu_us = bits / (lp->phy_2m ? 2.0 : 1.0) + 2 * 150.0 + (lp->phy_2m ? 40.0 : 80.0);
+    s->pdus_ev = (int)(lp->itvl_ms * 1000.0 / pdu_us);
+    if (s->pdus_ev > SIM_PDU_CAP) s->pdus_ev = SIM_PDU_CAP;
+    if (s->pdus_ev < 1) s->pdus_ev = 1;
+    s->now_ms = 0;
+    s->q.clear();
+    s->head_pdus = 0;
+    s->q_bytes = 0;
+    s->acks.clear();
+    s->got = 0;
+    s->cut_at = 0;
+    s->connected = true;
+    s->stalled = false;
+}
+
+/* Un événement de connexion : PDU vers le téléphone, ACK vers le BMU */
+static void sim_event(sim_t *s)
+{
+    s->now_ms += s->lp->itvl_ms;
+    int budget = s->pdus_ev;
+    while (budget > 0 && !s->q.empty()) {
+        std::vector<uint8_t> &head = s->q.front();
+        int take = pdus_for(s, head.size()) - s->head_pdus;
+        if (take > budget) take = budget;
+        s->head_pdus += take;
+        budget -= take;
+        if (s->head_pdus < pdus_for(s, head.size())) break;
+
+        const uint8_t *d;
+        size_t n;
+        if (bmu_ble_xfer_rx_feed(&s->rx, head.data(), head.size(), &d, &n)) {
+            /* Écriture de l'ACK : part à l'événement suivant */
+            s->acks.push_back(std::make_pair(s->now_ms + s->lp->itvl_ms, s->rx.next));
+        }
+        s->got += (uint32_t)n;
+        s->q_bytes -= head.size();
+        s->q.pop_front();
+        s->head_pdus = 0;
+        if (s->cut_at && s->got >= s->cut_at) {
+            s->connected = false;
+            return;
+        }
+    }
+    while (!s->acks.empty() && s->acks.front().first <= s->now_ms) {
+        bmu_ble_xfer_tx_ack(s->tx, s->acks.front().second);
+        s->acks.pop_front();
+    }
+}
+
+/* hist_emit : attend la fenêtre et les mbufs, comme la tâche ble_hist */
+static bool sim_emit(const uint8_t *frame, size_t len, void *arg)
+{
+    sim_t *s = (sim_t *)arg;
+    double t0 = s->now_ms;
+    while (s->connected && (bmu_ble_xfer_tx_inflight(s->tx) >= s->tx->window ||
+                            s->q_bytes + len > SIM_MBUF_BYTES)) {
+        if (s->now_ms - t0 > 5000.0) {
+            s->stalled = true;
+            return false;
+        }
+        sim_event(s);
+    }
+    if (!s->connected) return false;
+    s->q.push_back(std::vector<uint8_t>(frame, frame + len));
+    s->q_bytes += len;
+    return true;
+}
+
+/* Journée de 32 batteries échantillonnée à step_s, lignes BIN, via le lien.
+ * Lien seul (lignes synthétiques) : la lecture SD au même pas est couverte
+ * par test_sd_index (test_query_segments_step). */
+static double sim_day(const link_profile_t *lp, uint32_t step_s, uint32_t *bytes, uint32_t *crc)
+{
+    static bmu_ble_xfer_tx_t tx;
+    static sim_t s;
+    size_t cap = (size_t)lp->mtu - 3;
+    if (lp->align) cap = bmu_ble_xfer_frame_cap(cap, lp->ll_octets);
+    bmu_ble_xfer_tx_open(&tx, 0, cap, lp->window);
+    sim_init(&s, lp, &tx);
+    bmu_ble_xfer_rx_init(&s.rx, 0, 0, tx.window);
+
+    char line[96];
+    uint8_t r[BMU_BLE_XFER_ROW_LEN];
+    for (uint32_t t = 0; t < 86400; t += step_s) {
+        for (int b = 1; b <= 32; b++) {
+            size_t n = make_row(line, sizeof(line), 1760000000u + t, b);
+            TEST_ASSERT_TRUE(bmu_ble_xfer_pack_row(line, n, r));
+            TEST_ASSERT_TRUE(bmu_ble_xfer_tx_write(&tx, r, sizeof(r), sim_emit, &s));
+        }
+    }
+    TEST_ASSERT_TRUE(bmu_ble_xfer_tx_finish(&tx, sim_emit, &s));
+    while (!s.rx.done) sim_event(&s);
+
+    TEST_ASSERT_FALSE(s.stalled);
+    TEST_ASSERT_FALSE(s.rx.gap);
+    TEST_ASSERT_EQUAL_HEX32(tx.crc, s.rx.crc);
+    *bytes = s.got;
+    *crc = s.rx.crc;
+    return s.now_ms / 1000.0;
+}
+
+void test_link_day_download(void)
+{
+    static const link_profile_t P_DEFAULT = { "1M, MTU 23, 30 ms",           30.0, 23,  27,  false, false, 16 };
+    static const link_profile_t P_1M      = { "1M, MTU 512, DLE, 15 ms",     15.0, 512, 251, false, true,  16 };
+    static const link_profile_t P_2M_RAW  = { "2M, MTU 512, DLE, 15 ms, 509", 15.0, 512, 251, true,  false, 16 };
+    static const link_profile_t P_2M      = { "2M, MTU 512, DLE, 15 ms",     15.0, 512, 251, true,  true,  16 };
+    static const link_profile_t P_2M_W4   = { "2M, MTU 512, DLE, 4 trames", 15.0, 512, 251, true,  true,  4 };
+    static const link_profile_t P_ANDROID = { "2M, MTU 512, DLE, 7.5 ms",    7.5,  512, 251, true,  true,  16 };
+    const link_profile_t *profiles[] = { &P_DEFAULT, &P_1M, &P_2M_RAW, &P_2M, &P_2M_W4, &P_ANDROID };
+
+    printf("\n  Journée 32 batteries, BIN %d o/ligne :\n", BMU_BLE_XFER_ROW_LEN);
+    double t_2m_10 = 0, t_default_60 = 0, t_2m_60 = 0;
+    for (size_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); p++) {
+        const link_profile_t *lp = profiles[p];
+        uint32_t b60, c60, b10, c10;
+        double t60 = sim_day(lp, 60, &b60, &c60);
+        double t10 = lp == &P_DEFAULT ? 0 : sim_day(lp, 10, &b10, &c10);
+        TEST_ASSERT_EQUAL_UINT32(86400u / 60u * 32u * BMU_BLE_XFER_ROW_LEN, b60);
+        if (lp == &P_DEFAULT) {
+            printf("  %-30s pas 60 s : %7u o en %6.1f s (%5.1f ko/s)\n",
+                   lp->name, b60, t60, b60 / t60 / 1000.0);
+            t_default_60 = t60;
+        } else {
+            TEST_ASSERT_EQUAL_UINT32(86400u / 10u * 32u * BMU_BLE_XFER_ROW_LEN, b10);
+            printf("  %-30s pas 60 s : %7u o en %6.1f s, pas 10 s : %7u o en %6.1f s (%5.1f ko/s)\n",
+                   lp->name, b60, t60, b10, t10, b10 / t10 / 1000.0);
+        }
+        if (lp == &P_2M) {
+            t_2m_10 = t10;
+            t_2m_60 = t60;
+        }
+    }
+
+    /* Une journée à 10 s en moins d'une minute sur 2M + DLE + MTU 512 */
+    TEST_ASSERT_TRUE(t_2m_10 < 60.0);
+    TEST_ASSERT_TRUE(t_2m_60 * 10.0 < t_default_60);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cmd_roundtrip);
+    RUN_TEST(test_pack_row);
+    RUN_TEST(test_frame_cap_aligned_to_ll);
+    RUN_TEST(test_stream_mtu_window_crc);
+    RUN_TEST(test_window_and_ack);
+    RUN_TEST(test_resume_after_cut);
+    RUN_TEST(test_rx_duplicate_and_gap);
+    RUN_TEST(test_link_day_download);
+    return UNITY_END();
+}
@@ -0,0 +1,191 @@
+/**
+ * @file test_chart_hist.cpp
+ * @brief Tests host de l'historique graphique multi-niveaux (bmu_chart_hist) — Unity.
+ *
+ * Couverture :
+ *   - Dernier echantillon, anneau niveau 0 (ordre, ecrasement)
+ *   - Decimation : nombre de points par niveau apres 15 s, 30 min, 4 h, 8 j
+ *   - Pic de 0.5 s conserve en min/max jusqu'au niveau 7 jours
+ *   - Moyennes arrondies (courant negatif), saturation, NaN
+ *   - Point en cours ajoute a la lecture, remplace le plus ancien si plein
+ *   - Capacites, pas, taille en PSRAM pour 32 batteries
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstdio>
+#include "bmu_chart_hist.h"
+
+static bmu_chart_hist_t h;
+static bmu_chart_point_t pts[BMU_CHART_MAX_POINTS];
+
+void setUp(void) { bmu_chart_hist_reset(&h); }
+void tearDown(void) {}
+
+static void push_n(int n, float v_mv, float i_a)
+{
+    for (int k = 0; k < n; k++) bmu_chart_hist_push(&h, v_mv, i_a);
+}
+
+/* ── Niveau 0 ────────────────────────────────────────────────────── */
+
+void test_last_empty_then_sample(void)
+{
+    float v = -1.0f, i = -1.0f;
+    TEST_ASSERT_FALSE(bmu_chart_hist_last(&h, &v, &i));
+    bmu_chart_hist_push(&h, 26543.4f, -3.217f);
+    TEST_ASSERT_TRUE(bmu_chart_hist_last(&h, &v, &i));
+    TEST_ASSERT_EQUAL_FLOAT(26543.0f, v);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -3.22f, i);
+    TEST_ASSERT_TRUE(bmu_chart_hist_last(&h, NULL, &i));
+}
+
+void test_tier0_ring_order(void)
+{
+    for (int k = 0; k < 45; k++) bmu_chart_hist_push(&h, 24000.0f + k, 0.0f);
+    int n = bmu_chart_hist_read(&h, 0, pts, BMU_CHART_MAX_POINTS);
+    TEST_ASSERT_EQUAL(30, n);
+    for (int k = 0; k < n; k++) TEST_ASSERT_EQUAL_UINT16(24015 + k, pts[k].v_avg_mv);
+
+    /* max < points disponibles : les plus recents */
+    n = bmu_chart_hist_read(&h, 0, pts, 5);
+    TEST_ASSERT_EQUAL(5, n);
+    TEST_ASSERT_EQUAL_UINT16(24040, pts[0].v_avg_mv);
+    TEST_ASSERT_EQUAL_UINT16(24044, pts[4].v_avg_mv);
+}
+
+/* ── Decimation ──────────────────────────────────────────────────── */
+
+void test_decimation_counts(void)
+{
+    push_n(30, 25000.0f, 1.0f);                        /* 15 s */
+    TEST_ASSERT_EQUAL(1, bmu_chart_hist_read(&h, 1, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL(1, bmu_chart_hist_read(&h, 2, pts, BMU_CHART_MAX_POINTS)); /* en cours */
+    TEST_ASSERT_EQUAL(0, bmu_chart_hist_read(&h, 3, pts, BMU_CHART_MAX_POINTS));
+
+    push_n(3600 - 30, 25000.0f, 1.0f);                 /* 30 min */
+    TEST_ASSERT_EQUAL(60, bmu_chart_hist_read(&h, 1, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL(1, bmu_chart_hist_read(&h, 2, pts, BMU_CHART_MAX_POINTS));
+
+    push_n(28800 - 3600, 25000.0f, 1.0f);              /* 4 h */
+    TEST_ASSERT_EQUAL(8, bmu_chart_hist_read(&h, 2, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL(1, bmu_chart_hist_read(&h, 3, pts, BMU_CHART_MAX_POINTS));
+
+    push_n(8 * 24 * 7200 - 28800, 25000.0f, 1.0f);     /* 8 jours */
+    TEST_ASSERT_EQUAL(48, bmu_chart_hist_read(&h, 2, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL(42, bmu_chart_hist_read(&h, 3, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL_UINT16(25000, pts[41].v_avg_mv);
+    TEST_ASSERT_EQUAL_INT16(100, pts[41].i_avg_ca);
+}
+
+void test_spike_kept_up_to_week_view(void)
+{
+    push_n(1000, 26000.0f, 5.0f);
+    bmu_chart_hist_push(&h, 29100.0f, 120.0f);         /* pic de 0.5 s */
+    bmu_chart_hist_push(&h, 21500.0f, -40.0f);
+    push_n(28800 - 1002, 26000.0f, 5.0f);
+
+    int n = bmu_chart_hist_read(&h, 3, pts, BMU_CHART_MAX_POINTS);
+    TEST_ASSERT_EQUAL(1, n);
+    TEST_ASSERT_EQUAL_UINT16(29100, pts[0].v_max_mv);
+    TEST_ASSERT_EQUAL_UINT16(21500, pts[0].v_min_mv);
+    TEST_ASSERT_EQUAL_INT16(12000, pts[0].i_max_ca);
+    TEST_ASSERT_EQUAL_INT16(-4000, pts[0].i_min_ca);
+    /* La moyenne, elle, lisse le pic */
+    TEST_ASSERT_EQUAL_UINT16(26000, pts[0].v_avg_mv);
+    TEST_ASSERT_EQUAL_INT16(500, pts[0].i_avg_ca);
+}
+
+void test_mean_rounding(void)
+{
+    /* 15 x 24001 + 15 x 24002 → 24001.5 → 24002 ; -0.015 A moyen → -2 ca */
+    push_n(15, 24001.0f, -0.01f);
+    push_n(15, 24002.0f, -0.02f);
+    TEST_ASSERT_EQUAL(1, bmu_chart_hist_read(&h, 1, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL_UINT16(24002, pts[0].v_avg_mv);
+    TEST_ASSERT_EQUAL_INT16(-2, pts[0].i_avg_ca);
+    TEST_ASSERT_EQUAL_INT16(-2, pts[0].i_min_ca);
+    TEST_ASSERT_EQUAL_INT16(-1, pts[0].i_max_ca);
+}
+
+void test_saturation_and_nan(void)
+{
+    bmu_chart_hist_push(&h, 70000.0f, 400.0f);
+    bmu_chart_hist_push(&h, -5.0f, -400.0f);
+    bmu_chart_hist_push(&h, 0.0f / 0.0f, 0.0f / 0.0f);
+    int n = bmu_chart_hist_read(&h, 0, pts, BMU_CHART_MAX_POINTS);
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL_UINT16(65535, pts[0].v_avg_mv);
+    TEST_ASSERT_EQUAL_INT16(32767, pts[0].i_avg_ca);
+    TEST_ASSERT_EQUAL_UINT16(0, pts[1].v_avg_mv);
+    TEST_ASSERT_EQUAL_INT16(-32768, pts[1].i_avg_ca);
+    TEST_ASSERT_EQUAL_UINT16(0, pts[2].v_avg_mv);
+    TEST_ASSERT_EQUAL_INT16(0, pts[2].i_avg_ca);
+}
+
+/* ── Point en cours ──────────────────────────────────────────────── */
+
+void test_partial_bucket_on_read(void)
+{
+    push_n(10, 25000.0f, 0.0f);
+    push_n(4, 25100.0f, 0.0f);
+    int n = bmu_chart_hist_read(&h, 1, pts, BMU_CHART_MAX_POINTS);
+    TEST_ASSERT_EQUAL(1, n);                             /* seau de 14/30 */
+    TEST_ASSERT_EQUAL_UINT16(25029, pts[0].v_avg_mv);
+    TEST_ASSERT_EQUAL_UINT16(25100, pts[0].v_max_mv);
+
+    /* Anneau plein : le point en cours remplace le plus ancien */
+    push_n(60 * 30 - 14, 25000.0f, 0.0f);
+    for (int k = 0; k < 30 + 5; k++) bmu_chart_hist_push(&h, 26000.0f + k, 0.0f);
+    n = bmu_chart_hist_read(&h, 1, pts, BMU_CHART_MAX_POINTS);
+    TEST_ASSERT_EQUAL(60, n);
+    TEST_ASSERT_EQUAL_UINT16(26015, pts[58].v_avg_mv);   /* 26000..26029 */
+    TEST_ASSERT_EQUAL_UINT16(26032, pts[59].v_avg_mv);   /* 26030..26034 */
+}
+
+/* ── Dimensions ──────────────────────────────────────────────────── */
+
+void test_capacity_and_step(void)
+{
+    TEST_ASSERT_EQUAL(30, bmu_chart_hist_capacity(0));
+    TEST_ASSERT_EQUAL(60, bmu_chart_hist_capacity(1));
+    TEST_ASSERT_EQUAL(48, bmu_chart_hist_capacity(2));
+    TEST_ASSERT_EQUAL(42, bmu_chart_hist_capacity(3));
+    TEST_ASSERT_EQUAL(0, bmu_chart_hist_capacity(4));
+    TEST_ASSERT_EQUAL_UINT32(500, bmu_chart_hist_step_ms(0));
+    TEST_ASSERT_EQUAL_UINT32(15000, bmu_chart_hist_step_ms(1));
+    TEST_ASSERT_EQUAL_UINT32(30u * 60u * 1000u, bmu_chart_hist_step_ms(2));
+    TEST_ASSERT_EQUAL_UINT32(4u * 3600u * 1000u, bmu_chart_hist_step_ms(3));
+    for (int t = 0; t < BMU_CHART_TIERS; t++) {
+        TEST_ASSERT_LESS_OR_EQUAL(BMU_CHART_MAX_POINTS, bmu_chart_hist_capacity(t));
+    }
+    TEST_ASSERT_EQUAL(0, bmu_chart_hist_read(&h, -1, pts, BMU_CHART_MAX_POINTS));
+    TEST_ASSERT_EQUAL(0, bmu_chart_hist_read(&h, 4, pts, BMU_CHART_MAX_POINTS));
+}
+
+void test_psram_footprint(void)
+{
+    size_t per_bat = sizeof(bmu_chart_hist_t);
+    size_t old_per_bat = 600 * 2 * sizeof(float);      /* 5 min V/I en float */
+    printf("chart_hist: %u o/batterie (7 j), 32 batteries = %u o (avant : %u o pour 5 min)\n",
+           (unsigned)per_bat, (unsigned)(32 * per_bat), (unsigned)(32 * old_per_bat));
+    TEST_ASSERT_LESS_OR_EQUAL(2300, per_bat);
+    TEST_ASSERT_LESS_THAN(old_per_bat / 2, per_bat);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_last_empty_then_sample);
+    RUN_TEST(test_tier0_ring_order);
+    RUN_TEST(test_decimation_counts);
+    RUN_TEST(test_spike_kept_up_to_week_view);
+    RUN_TEST(test_mean_rounding);
+    RUN_TEST(test_saturation_and_nan);
+    RUN_TEST(test_partial_bucket_on_read);
+    RUN_TEST(test_capacity_and_step);
+    RUN_TEST(test_psram_footprint);
+    return UNITY_END();
+}
@@ -0,0 +1,158 @@
+/**
+ * @file test_coulomb.cpp
+ * @brief Tests host du comptage coulométrique (bmu_coulomb.h) — Unity.
+ *
+ * Couverture :
+ *   - Intégration trapézoïdale Ah/Wh (courant constant, rampe, passage par zéro)
+ *   - Apprentissage et soustraction de l'offset MOSFET ouvert
+ *   - Compteurs à vie élevés : 1 h à 1 A ajoute toujours 1 Ah / 26 Wh
+ *   - Trous d'acquisition (pas de pont au-delà de max_gap)
+ *   - Politique de checkpoint NVS (delta mAh, min/max intervalle)
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include "bmu_coulomb.h"
+
+static const int64_t PERIOD_US = 200000;          /* protection 5 Hz */
+static const int64_t MAX_GAP_US = 2000000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/* Injecte n échantillons identiques à 5 Hz à partir de *t */
+static void feed(bmu_coulomb_t *c, int n, float v_mv, float i_a, bool closed, int64_t *t)
+{
+    for (int k = 0; k < n; k++) {
+        bmu_coulomb_sample(c, v_mv, i_a, *t, closed, MAX_GAP_US);
+        *t += PERIOD_US;
+    }
+}
+
+void test_constant_discharge_one_hour(void) {
+    bmu_coulomb_t c = {};
+    int64_t t = 0;
+    feed(&c, 5 * 3600 + 1, 26000.0f, 10.0f, true, &t);   /* 1 h à 10 A */
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, c.ah_discharge);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 260.0f, c.wh_discharge);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.ah_charge);
+}
+
+void test_charge_counts_negative_current(void) {
+    bmu_coulomb_t c = {};
+    int64_t t = 0;
+    feed(&c, 5 * 1800 + 1, 28000.0f, -4.0f, true, &t);   /* 30 min à -4 A */
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 2.0f, c.ah_charge);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 56.0f, c.wh_charge);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.ah_discharge);
+}
+
+/* Compteur à vie déjà grand : un pas de 5 Hz à 1 A (~5.6e-5 Ah) ne doit
+ * pas être absorbé par l'arrondi du cumul */
+void test_large_counter_keeps_increment(void) {
+    const double starts[] = { 100.0, 1000.0, 5000.0, 100000.0 };
+    for (double start : starts) {
+        bmu_coulomb_t c = {};
+        c.ah_discharge = start;
+        c.wh_discharge = start * 26.0;
+        int64_t t = 0;
+        feed(&c, 5 * 3600 + 1, 26000.0f, 1.0f, true, &t);   /* 1 h à 1 A */
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 1.0f, (float)(c.ah_discharge - start));
+        TEST_ASSERT_FLOAT_WITHIN(0.03f, 26.0f, (float)(c.wh_discharge - start * 26.0));
+    }
+}
+
+void test_trapezoid_ramp_is_exact(void) {
+    double pos = 0, neg = 0;
+    bmu_coulomb_trapezoid(0.0f, 2.0f, 1.0f, &pos, &neg);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, pos);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, neg);
+}
+
+void test_trapezoid_zero_crossing_split(void) {
+    double pos = 0, neg = 0;
+    /* +2 → -2 sur dt=1 : croisement au milieu, 0.5 de chaque côté */
+    bmu_coulomb_trapezoid(2.0f, -2.0f, 1.0f, &pos, &neg);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, pos);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, neg);
+}
+
+void test_small_current_integrated_without_deadband(void) {
+    /* 30 mA réels : l'ancien deadband 50 mA les ignorait */
+    bmu_coulomb_t c = {};
+    int64_t t = 0;
+    feed(&c, 5 * 3600 + 1, 26000.0f, 0.030f, true, &t);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.030f, c.ah_discharge);
+}
+
+void test_offset_learned_when_switch_open(void) {
+    bmu_coulomb_t c = {};
+    int64_t t = 0;
+    feed(&c, 200, 26000.0f, 0.040f, false, &t);          /* MOSFET ouvert : offset 40 mA */
+    TEST_ASSERT_TRUE(c.offset_valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.040f, c.offset_a);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.ah_discharge);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.ah_charge);
+
+    /* En ligne, lecture 1.040 A → 1.000 A réel intégré */
+    bmu_coulomb_t fresh = c;
+    fresh.has_prev = false;
+    t = 0;
+    feed(&fresh, 5 * 3600 + 1, 26000.0f, 1.040f, true, &t);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 1.0f, fresh.ah_discharge);
+}
+
+void test_offset_rejects_large_current(void) {
+    bmu_coulomb_t c = {};
+    bmu_coulomb_learn_offset(&c, 3.0f);
+    TEST_ASSERT_FALSE(c.offset_valid);
+    bmu_coulomb_learn_offset(&c, 0.010f);
+    TEST_ASSERT_TRUE(c.offset_valid);
+    bmu_coulomb_learn_offset(&c, 5.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.010f, c.offset_a);
+}
+
+void test_gap_not_bridged(void) {
+    bmu_coulomb_t c = {};
+    bmu_coulomb_sample(&c, 26000.0f, 10.0f, 0, true, MAX_GAP_US);
+    bmu_coulomb_sample(&c, 26000.0f, 10.0f, 60LL * 1000000, true, MAX_GAP_US);  /* trou 60 s */
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, c.ah_discharge);
+    bmu_coulomb_sample(&c, 26000.0f, 10.0f, 60LL * 1000000 + 360000, true, MAX_GAP_US);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.001f, c.ah_discharge);   /* 10 A × 0.36 s */
+}
+
+void test_nan_sample_ignored(void) {
+    bmu_coulomb_t c = {};
+    bmu_coulomb_sample(&c, NAN, 1.0f, 0, true, MAX_GAP_US);
+    TEST_ASSERT_FALSE(c.has_prev);
+}
+
+void test_checkpoint_policy(void) {
+    const int64_t S = 1000000;
+    /* Sous l'intervalle min : jamais, même avec un gros delta */
+    TEST_ASSERT_FALSE(bmu_coulomb_checkpoint_due(5.0f, 30 * S, 0.5f, 120 * S, 900 * S));
+    /* Delta atteint après min */
+    TEST_ASSERT_TRUE(bmu_coulomb_checkpoint_due(0.6f, 200 * S, 0.5f, 120 * S, 900 * S));
+    /* Petit delta : attendre max */
+    TEST_ASSERT_FALSE(bmu_coulomb_checkpoint_due(0.01f, 600 * S, 0.5f, 120 * S, 900 * S));
+    TEST_ASSERT_TRUE(bmu_coulomb_checkpoint_due(0.01f, 901 * S, 0.5f, 120 * S, 900 * S));
+    /* Rien n'a bougé : aucune écriture */
+    TEST_ASSERT_FALSE(bmu_coulomb_checkpoint_due(0.0f, 86400 * S, 0.5f, 120 * S, 900 * S));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_constant_discharge_one_hour);
+    RUN_TEST(test_charge_counts_negative_current);
+    RUN_TEST(test_large_counter_keeps_increment);
+    RUN_TEST(test_trapezoid_ramp_is_exact);
+    RUN_TEST(test_trapezoid_zero_crossing_split);
+    RUN_TEST(test_small_current_integrated_without_deadband);
+    RUN_TEST(test_offset_learned_when_switch_open);
+    RUN_TEST(test_offset_rejects_large_current);
+    RUN_TEST(test_gap_not_bridged);
+    RUN_TEST(test_nan_sample_ignored);
+    RUN_TEST(test_checkpoint_policy);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/**
+ * @file test_disp_perf.cpp
+ * @brief Tests host de la mesure du rendu LVGL (bmu_disp_perf) — Unity.
+ *
+ * Couverture :
+ *   - Image : rendu = duree - flush, flush et attente DMA cumules
+ *   - Cycle de rafraichissement a vide non compte
+ *   - Surface invalidee cumulee, bornee au panneau, zones vides ignorees
+ *   - Images lentes (> 33 ms)
+ *   - Evenements hors sequence (flush hors image, double debut)
+ *   - Moyennes entre deux lectures : fps, ms par image, % surface, charge
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include "bmu_disp_perf.h"
+
+#define PANEL_PX (320u * 240u)
+
+static bmu_disp_perf_t p;
+
+void setUp(void) { bmu_disp_perf_init(&p, PANEL_PX); }
+void tearDown(void) {}
+
+/* Image de `total` us dont `flush` us d'envoi, commencant a t0 */
+static void frame(int64_t t0, int32_t w, int32_t h, uint32_t total, uint32_t flush)
+{
+    bmu_disp_perf_invalidate(&p, w, h);
+    bmu_disp_perf_frame_start(&p, t0);
+    bmu_disp_perf_flush_start(&p, t0 + total - flush);
+    bmu_disp_perf_flush_end(&p, t0 + total);
+    bmu_disp_perf_frame_end(&p, t0 + total);
+}
+
+/* ── Image ───────────────────────────────────────────────────────── */
+
+void test_render_is_frame_minus_flush(void)
+{
+    bmu_disp_perf_invalidate(&p, 320, 40);
+    bmu_disp_perf_frame_start(&p, 1000);
+    /* Deux bandeaux : flush_cb puis attente DMA pour chacun */
+    bmu_disp_perf_flush_start(&p, 3000);
+    bmu_disp_perf_flush_end(&p, 3200);
+    bmu_disp_perf_flush_start(&p, 5000);
+    bmu_disp_perf_flush_end(&p, 6500);
+    bmu_disp_perf_frame_end(&p, 7000);
+
+    TEST_ASSERT_EQUAL_UINT32(1, p.tot.frames);
+    TEST_ASSERT_EQUAL_UINT64(1700, p.tot.flush_us);
+    TEST_ASSERT_EQUAL_UINT64(4300, p.tot.render_us);
+    TEST_ASSERT_EQUAL_UINT64(320 * 40, p.tot.area_px);
+    TEST_ASSERT_EQUAL_UINT32(0, p.tot.slow);
+}
+
+void test_idle_refresh_not_counted(void)
+{
+    bmu_disp_perf_frame_start(&p, 0);
+    bmu_disp_perf_frame_end(&p, 40);
+    TEST_ASSERT_EQUAL_UINT32(0, p.tot.frames);
+    TEST_ASSERT_EQUAL_UINT64(0, p.tot.render_us);
+}
+
+void test_area_accumulates_and_clamps(void)
+{
+    bmu_disp_perf_invalidate(&p, 100, 20);
+    bmu_disp_perf_invalidate(&p, 0, 50);        /* vide */
+    bmu_disp_perf_invalidate(&p, 50, -1);
+    bmu_disp_perf_invalidate(&p, 10, 10);
+    bmu_disp_perf_frame_start(&p, 0);
+    bmu_disp_perf_frame_end(&p, 1000);
+    TEST_ASSERT_EQUAL_UINT64(2100, p.tot.area_px);
+
+    /* Zones non fusionnees qui se recouvrent : au plus le panneau */
+    for (int k = 0; k < 5; k++) bmu_disp_perf_invalidate(&p, 320, 240);
+    bmu_disp_perf_frame_start(&p, 2000);
+    bmu_disp_perf_frame_end(&p, 3000);
+    TEST_ASSERT_EQUAL_UINT64(2100 + PANEL_PX, p.tot.area_px);
+}
+
+void test_slow_frames(void)
+{
+    frame(0, 320, 240, 20000, 15000);
+    frame(50000, 320, 240, 45000, 30000);
+    TEST_ASSERT_EQUAL_UINT32(2, p.tot.frames);
+    TEST_ASSERT_EQUAL_UINT32(1, p.tot.slow);
+}
+
+void test_out_of_sequence_events(void)
+{
+    /* Flush hors image ignore */
+    bmu_disp_perf_flush_start(&p, 0);
+    bmu_disp_perf_flush_end(&p, 500);
+    bmu_disp_perf_frame_end(&p, 600);
+    TEST_ASSERT_EQUAL_UINT32(0, p.tot.frames);
+
+    /* Flush non termine : clos a la fin de l'image, jamais > duree */
+    bmu_disp_perf_invalidate(&p, 10, 10);
+    bmu_disp_perf_frame_start(&p, 1000);
+    bmu_disp_perf_flush_start(&p, 1500);
+    bmu_disp_perf_flush_start(&p, 1800);         /* ignore : deja en flush */
+    bmu_disp_perf_frame_end(&p, 2000);
+    TEST_ASSERT_EQUAL_UINT32(1, p.tot.frames);
+    TEST_ASSERT_EQUAL_UINT64(500, p.tot.flush_us);
+    TEST_ASSERT_EQUAL_UINT64(500, p.tot.render_us);
+}
+
+/* ── Moyennes ────────────────────────────────────────────────────── */
+
+void test_stats_between_reads(void)
+{
+    bmu_disp_perf_totals_t a, b;
+    bmu_disp_perf_stats_t st;
+    frame(0, 320, 240, 10000, 6000);               /* plein ecran */
+    bmu_disp_perf_read(&p, 1000000, &a);
+
+    /* 1 s : 20 images de 1/4 d'ecran, 4 ms rendu + 2 ms flush */
+    for (int k = 0; k < 20; k++) frame(1000000 + k * 50000, 320, 60, 6000, 2000);
+    bmu_disp_perf_read(&p, 2000000, &b);
+    bmu_disp_perf_stats(&a, &b, &st);
+
+    TEST_ASSERT_EQUAL_UINT32(20, st.frames);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f, st.fps);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.0f, st.render_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f, st.flush_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 25.0f, st.area_pct);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 12.0f, st.load_pct);
+    TEST_ASSERT_EQUAL_UINT32(0, st.slow);
+}
+
+void test_stats_empty_interval(void)
+{
+    bmu_disp_perf_totals_t a, b;
+    bmu_disp_perf_stats_t st;
+    bmu_disp_perf_read(&p, 5000, &a);
+    bmu_disp_perf_read(&p, 5000, &b);
+    bmu_disp_perf_stats(&a, &b, &st);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, st.fps);
+
+    /* Aucune image sur 1 s : fps 0, pas de division par zero */
+    bmu_disp_perf_read(&p, 1005000, &b);
+    bmu_disp_perf_stats(&a, &b, &st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.frames);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, st.fps);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, st.render_ms);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, st.area_pct);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_render_is_frame_minus_flush);
+    RUN_TEST(test_idle_refresh_not_counted);
+    RUN_TEST(test_area_accumulates_and_clamps);
+    RUN_TEST(test_slow_frames);
+    RUN_TEST(test_out_of_sequence_events);
+    RUN_TEST(test_stats_between_reads);
+    RUN_TEST(test_stats_empty_interval);
+    return UNITY_END();
+}
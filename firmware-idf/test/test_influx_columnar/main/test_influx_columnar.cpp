@@ -0,0 +1,290 @@
+/**
+ * @file test_influx_columnar.cpp
+ * @brief Tests host du codec colonnaire du store offline (bmu_influx_columnar) — Unity.
+ *
+ * Couverture :
+ *   - Aller-retour exact sur plusieurs blocs (état delta partagé)
+ *   - Contrat de regénération : timestamps tronqués à la ms, lignes
+ *     regroupées par série (ordre conservé dans la série), raw en dernier
+ *   - Horodatage des lignes ts=0 à l'ajout, absence de ts sans heure valide
+ *   - Types int/uint/bool/chaîne/négatifs, fallback raw des lignes non analysables
+ *   - Gain ≥ 10x sur une heure de télémétrie 16 batteries
+ *   - Bloc tronqué → -1, table de séries pleine → 0
+ *   - Index de segment : construction, footer, relecture
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bmu_influx_columnar.h"
+#include "bmu_influx_gzip.h"
+
+static bmu_col_encoder_t s_enc;
+static bmu_col_decoder_t s_dec;
+static uint8_t s_block[3 * 4096 + 1024];
+
+void setUp(void)
+{
+    bmu_col_encoder_reset(&s_enc);
+    bmu_col_decoder_reset(&s_dec);
+}
+void tearDown(void) {}
+
+static void collect(const char *line, size_t len, void *ctx)
+{
+    std::string *out = (std::string *)ctx;
+    out->append(line, len);
+    out->push_back('\n');
+}
+
+/* Lignes triées : le décodeur émet série par série, l'ordre n'importe pas à InfluxDB */
+static std::string sorted(const std::string &text)
+{
+    std::vector<std::string> lines;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        lines.push_back(text.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    std::sort(lines.begin(), lines.end());
+    std::string out;
+    for (const auto &l : lines) out += l + "\n";
+    return out;
+}
+
+/* Encode puis décode un bloc ; renvoie le texte regénéré (trié) */
+static std::string roundtrip(const std::string &text, int64_t now_ms, size_t *encoded = nullptr)
+{
+    size_t n = bmu_col_encode_block(&s_enc, text.data(), text.size(), now_ms,
+                                    s_block, sizeof(s_block));
+    TEST_ASSERT_TRUE(n > BMU_COL_FRAME_HDR_LEN);
+    uint8_t type = 0;
+    uint32_t plen = 0, crc = 0;
+    TEST_ASSERT_TRUE(bmu_col_frame_parse(s_block, &type, &plen, &crc));
+    TEST_ASSERT_EQUAL('B', type);
+    TEST_ASSERT_EQUAL(n - BMU_COL_FRAME_HDR_LEN, plen);
+    TEST_ASSERT_EQUAL_HEX32(crc, bmu_gzip_crc32(0, s_block + BMU_COL_FRAME_HDR_LEN, plen));
+
+    std::string out;
+    int lines = bmu_col_decode_block(&s_dec, s_block + BMU_COL_FRAME_HDR_LEN, plen, collect, &out);
+    TEST_ASSERT_TRUE(lines >= 0);
+    TEST_ASSERT_EQUAL(s_enc.blk_lines, lines);
+    if (encoded) *encoded = n;
+    return sorted(out);
+}
+
+/* Télémétrie battery (schéma bmu_influx_write_battery_full), marche aléatoire
+ * lente comme sur un parc réel ; ts en ns sauf si ts_ms = 0 */
+static uint32_t s_rng;
+static double walk(double *v, double step)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    *v += step * ((int)((s_rng >> 16) % 3) - 1);
+    return *v;
+}
+
+static std::string battery_batch(int nb, int cycles, int64_t ts_ms, int64_t period_ms)
+{
+    static double v[32], i[32], ah[32];
+    static bool init = false;
+    if (!init) {
+        for (int b = 0; b < 32; b++) { v[b] = 26100.0 + b * 7; i[b] = 1200.0; ah[b] = 5000.0; }
+        init = true;
+    }
+    std::string s;
+    char line[512];
+    for (int c = 0; c < cycles; c++) {
+        for (int b = 0; b < nb; b++) {
+            ah[b] += i[b] * period_ms / 3600000.0;
+            snprintf(line, sizeof(line),
+                "battery,id=%d voltage_mv=%.1f,current_ma=%.1f,ah_discharge_mah=%.1f,"
+                "ah_charge_mah=%.1f,wh_discharge=%.1f,wh_charge=%.1f,nb_switch=%di,"
+                "state=\"connected\",soh_pct=%.1f,soc_pct=%.1f %lld\n",
+                b, walk(&v[b], 0.4), walk(&i[b], 5.0), ah[b], 1200.5 + b,
+                ah[b] * 0.0256, 31.0 + b, b % 3, 97.5 - b * 0.1, 64.2 - c * 0.01,
+                ts_ms ? (long long)(ts_ms + c * period_ms) * 1000000LL : 0LL);
+            s += line;
+        }
+    }
+    return s;
+}
+
+void test_roundtrip_multi_block_exact(void)
+{
+    int64_t t0 = 1760000000000LL;
+    for (int blk = 0; blk < 5; blk++) {
+        std::string in = battery_batch(8, 2, t0 + blk * 20000, 10000);
+        TEST_ASSERT_EQUAL_STRING(sorted(in).c_str(), roundtrip(in, 0).c_str());
+    }
+    TEST_ASSERT_EQUAL(8, s_enc.n_series);
+    TEST_ASSERT_EQUAL(8, s_dec.n_series);
+}
+
+/* Contrat documenté dans bmu_influx_columnar.h : ce que le replay renvoie
+ * diffère du texte d'origine sur ces deux points seulement */
+void test_roundtrip_contract_ms_and_series_order(void)
+{
+    const std::string in =
+        "bat,id=0 v=1i 1760000000000123456\n"
+        "bat,id=1 v=2i 1760000000001000000\n"
+        "exp value=1e-05 1760000000000000777\n"
+        "bat,id=0 v=3i 1760000000002999999\n"
+        "bat,id=1 v=4i 1760000000003000000\n";
+    size_t n = bmu_col_encode_block(&s_enc, in.data(), in.size(), 0, s_block, sizeof(s_block));
+    TEST_ASSERT_TRUE(n > BMU_COL_FRAME_HDR_LEN);
+    std::string out;
+    TEST_ASSERT_EQUAL(5, bmu_col_decode_block(&s_dec, s_block + BMU_COL_FRAME_HDR_LEN,
+                                              n - BMU_COL_FRAME_HDR_LEN, collect, &out));
+    TEST_ASSERT_EQUAL_STRING("bat,id=0 v=1i 1760000000000000000\n"   /* sub-ms perdu */
+                             "bat,id=0 v=3i 1760000000002000000\n"
+                             "bat,id=1 v=2i 1760000000001000000\n"   /* série suivante */
+                             "bat,id=1 v=4i 1760000000003000000\n"
+                             "exp value=1e-05 1760000000000000777\n", /* raw : intacte */
+                             out.c_str());
+}
+
+void test_zero_timestamp_stamped_at_append(void)
+{
+    std::string out = roundtrip("climate temperature_c=24.50,humidity_pct=41.0 0\n"
+                                "solar,device=bmu-1 vpv=38.1,ppv=210i\n", 1760000000123LL);
+    TEST_ASSERT_EQUAL_STRING("climate temperature_c=24.50,humidity_pct=41.0 1760000000123000000\n"
+                             "solar,device=bmu-1 vpv=38.1,ppv=210i 1760000000123000000\n",
+                             out.c_str());   /* déjà dans l'ordre trié */
+    /* Heure non valide : pas de timestamp, InfluxDB horodatera à la réception */
+    out = roundtrip("climate temperature_c=24.25,humidity_pct=40.5 0\n", 0);
+    TEST_ASSERT_EQUAL_STRING("climate temperature_c=24.25,humidity_pct=40.5\n", out.c_str());
+}
+
+void test_field_types_and_raw_fallback(void)
+{
+    const char *in =
+        "t,k=a\\ b i=-42i,u=18446744073709551615u,b=true,s=\"x\\\"y\",f=-0.125 1760000000000000000\n"
+        "t,k=a\\ b i=7i,u=0u,b=false,s=\"x\\\"y\",f=3.000 1760000000001000000\n"
+        "t,k=a\\ b i=7i,u=0u,b=false,s=\"z\",f=3.001 1760000000002000000\n"
+        "exp value=1e-05 1760000000000000000\n"
+        "long s=\"une chaîne beaucoup trop longue pour la colonne\"\n"
+        "broken line without fields\n";
+    std::string out = roundtrip(in, 0);
+    TEST_ASSERT_EQUAL_STRING(sorted(in).c_str(), out.c_str());
+    TEST_ASSERT_EQUAL(1, s_enc.n_series);    /* 3 lignes non analysables → raw */
+}
+
+void test_bool_spelling_normalized(void)
+{
+    std::string out = roundtrip("m ok=t,ko=F 1760000000000000000\n", 0);
+    TEST_ASSERT_EQUAL_STRING("m ok=true,ko=false 1760000000000000000\n", out.c_str());
+}
+
+void test_compression_ratio_one_hour_fleet(void)
+{
+    /* 16 batteries, 1 h à 10 s, flush de 20 lignes comme bmu_influx */
+    int64_t t0 = 1760000000000LL;
+    size_t text = 0, enc = 0;
+    std::string all = battery_batch(16, 360, t0, 10000);
+    size_t pos = 0;
+    while (pos < all.size()) {
+        size_t end = pos;
+        for (int l = 0; l < 20 && end < all.size(); l++) end = all.find('\n', end) + 1;
+        std::string chunk = all.substr(pos, end - pos);
+        size_t n = 0;
+        TEST_ASSERT_EQUAL_STRING(sorted(chunk).c_str(), roundtrip(chunk, 0, &n).c_str());
+        text += chunk.size();
+        enc += n;
+        pos = end;
+    }
+    printf("line-protocol %zu -> colonnaire %zu octets (x%.1f)\n", text, enc, (double)text / enc);
+    TEST_ASSERT_TRUE(enc * 10 <= text);
+}
+
+void test_truncated_block_rejected(void)
+{
+    std::string in = battery_batch(4, 1, 1760000000000LL, 10000);
+    size_t n = bmu_col_encode_block(&s_enc, in.data(), in.size(), 0, s_block, sizeof(s_block));
+    TEST_ASSERT_TRUE(n > 0);
+    size_t plen = n - BMU_COL_FRAME_HDR_LEN;
+    TEST_ASSERT_EQUAL(-1, bmu_col_decode_block(&s_dec, s_block + BMU_COL_FRAME_HDR_LEN,
+                                               plen - 3, nullptr, nullptr));
+    /* Octet altéré : le CRC de trame le détecte */
+    uint32_t crc = bmu_gzip_crc32(0, s_block + BMU_COL_FRAME_HDR_LEN, plen);
+    s_block[BMU_COL_FRAME_HDR_LEN + plen / 2] ^= 0x10;
+    TEST_ASSERT_NOT_EQUAL(crc, bmu_gzip_crc32(0, s_block + BMU_COL_FRAME_HDR_LEN, plen));
+}
+
+void test_series_table_full_returns_zero(void)
+{
+    std::string in;
+    char line[64];
+    for (int s = 0; s < BMU_COL_MAX_SERIES; s++) {
+        snprintf(line, sizeof(line), "m,id=%d v=1i 1760000000000000000\n", s);
+        in += line;
+    }
+    TEST_ASSERT_TRUE(bmu_col_encode_block(&s_enc, in.data(), in.size(), 0,
+                                          s_block, sizeof(s_block)) > 0);
+    /* Table pleine : 0, l'appelant scelle le segment et repart à vierge */
+    std::string extra = "m,id=999 v=2i 1760000000000000000\n";
+    TEST_ASSERT_EQUAL(0, bmu_col_encode_block(&s_enc, extra.data(), extra.size(), 0,
+                                              s_block, sizeof(s_block)));
+    bmu_col_encoder_reset(&s_enc);
+    /* Encodeur vierge et lot de 65 séries : la 65e passe en raw */
+    in += extra;
+    TEST_ASSERT_TRUE(bmu_col_encode_block(&s_enc, in.data(), in.size(), 0,
+                                          s_block, sizeof(s_block)) > 0);
+    TEST_ASSERT_EQUAL(BMU_COL_MAX_SERIES + 1, s_enc.blk_lines);
+    /* Sortie trop petite → 0 */
+    bmu_col_encoder_reset(&s_enc);
+    TEST_ASSERT_EQUAL(0, bmu_col_encode_block(&s_enc, in.data(), in.size(), 0, s_block, 64));
+}
+
+void test_segment_index_roundtrip(void)
+{
+    bmu_col_index_entry_t e[3] = {
+        { 8, 20, 1760000000000LL, 1760000010000LL },
+        { 412, 20, 1760000020000LL, 1760000030000LL },
+        { 790, 7, 0, 0 },
+    };
+    uint8_t buf[256];
+    size_t n = bmu_col_index_build(e, 3, 1200, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(BMU_COL_FRAME_HDR_LEN + 3 * BMU_COL_INDEX_ENTRY_LEN + BMU_COL_FOOTER_LEN, n);
+
+    uint32_t off = 0;
+    TEST_ASSERT_TRUE(bmu_col_footer_parse(buf + n - BMU_COL_FOOTER_LEN, &off));
+    TEST_ASSERT_EQUAL(1200, off);
+
+    uint8_t type = 0;
+    uint32_t plen = 0, crc = 0;
+    TEST_ASSERT_TRUE(bmu_col_frame_parse(buf, &type, &plen, &crc));
+    TEST_ASSERT_EQUAL('I', type);
+    TEST_ASSERT_EQUAL_HEX32(crc, bmu_gzip_crc32(0, buf + BMU_COL_FRAME_HDR_LEN, plen));
+
+    bmu_col_index_entry_t r;
+    bmu_col_index_entry_read(buf + BMU_COL_FRAME_HDR_LEN + BMU_COL_INDEX_ENTRY_LEN, &r);
+    TEST_ASSERT_EQUAL(412, r.offset);
+    TEST_ASSERT_EQUAL(20, r.lines);
+    TEST_ASSERT_TRUE(r.t_first_ms == 1760000020000LL && r.t_last_ms == 1760000030000LL);
+
+    uint8_t seg[BMU_COL_SEG_HDR_LEN];
+    bmu_col_segment_header(seg);
+    TEST_ASSERT_TRUE(bmu_col_segment_header_ok(seg));
+    TEST_ASSERT_FALSE(bmu_col_footer_parse(seg, &off));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip_multi_block_exact);
+    RUN_TEST(test_roundtrip_contract_ms_and_series_order);
+    RUN_TEST(test_zero_timestamp_stamped_at_append);
+    RUN_TEST(test_field_types_and_raw_fallback);
+    RUN_TEST(test_bool_spelling_normalized);
+    RUN_TEST(test_compression_ratio_one_hour_fleet);
+    RUN_TEST(test_truncated_block_rejected);
+    RUN_TEST(test_series_table_full_returns_zero);
+    RUN_TEST(test_segment_index_roundtrip);
+    return UNITY_END();
+}
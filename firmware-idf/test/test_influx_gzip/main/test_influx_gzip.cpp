@@ -0,0 +1,139 @@
+/**
+ * @file test_influx_gzip.cpp
+ * @brief Tests host de l'encodeur gzip line-protocol (bmu_influx_gzip) — Unity.
+ *
+ * Décompression de contrôle par zlib (host) : chaque flux produit doit être
+ * un gzip valide restituant exactement l'entrée.
+ *
+ * Couverture :
+ *   - CRC-32 vecteur de référence
+ *   - Aller-retour zlib : vide, court, line-protocol 4 KB, binaire pseudo-aléatoire
+ *   - Taux de compression sur un buffer BMU typique
+ *   - Débordement de sortie / entrée trop grande → 0 (envoi brut)
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <zlib.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "bmu_influx_gzip.h"
+
+static bmu_gzip_ws_t s_ws;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::vector<uint8_t> gunzip(const uint8_t *in, size_t len)
+{
+    std::vector<uint8_t> out(BMU_GZIP_MAX_INPUT + 16);
+    z_stream zs = {};
+    TEST_ASSERT_EQUAL(Z_OK, inflateInit2(&zs, 16 + MAX_WBITS));
+    zs.next_in = const_cast<uint8_t *>(in);
+    zs.avail_in = (uInt)len;
+    zs.next_out = out.data();
+    zs.avail_out = (uInt)out.size();
+    int rc = inflate(&zs, Z_FINISH);
+    TEST_ASSERT_EQUAL_MESSAGE(Z_STREAM_END, rc, "flux gzip invalide");
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+    return out;
+}
+
+static void roundtrip(const uint8_t *data, size_t len)
+{
+    std::vector<uint8_t> gz(len + len / 8 + 64);
+    size_t n = bmu_gzip_compress(&s_ws, data, len, gz.data(), gz.size());
+    TEST_ASSERT_TRUE(n > 0);
+    std::vector<uint8_t> back = gunzip(gz.data(), n);
+    TEST_ASSERT_EQUAL(len, back.size());
+    if (len) TEST_ASSERT_EQUAL_MEMORY(data, back.data(), len);
+}
+
+/* Buffer représentatif : 16 batteries × 2 cycles de bmu_influx_write_battery_full */
+static size_t make_line_protocol(char *buf, size_t cap)
+{
+    size_t len = 0;
+    for (int cycle = 0; cycle < 2; cycle++) {
+        for (int id = 0; id < 16 && len < cap; id++) {
+            int n = snprintf(buf + len, cap - len,
+                "battery,id=%d voltage_mv=%.1f,current_ma=%.1f,ah_discharge_mah=%.1f,"
+                "ah_charge_mah=%.1f,wh_discharge=%.1f,wh_charge=%.1f,nb_switch=%di,"
+                "state=\"connected\",soh_pct=%.1f,soc_pct=%.1f 0\n",
+                id, 26100.0 + id * 7.3 + cycle, 1200.0 - id * 11.1, 5321.0 + id,
+                1200.5 + id, 140.2 + id, 31.0 + id, id % 3, 97.5 - id * 0.1, 64.2 + id);
+            if (n < 0 || (size_t)n >= cap - len) break;
+            len += (size_t)n;
+        }
+    }
+    return len;
+}
+
+void test_crc32_reference(void) {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, bmu_gzip_crc32(0, (const uint8_t *)"123456789", 9));
+    /* Chaînage */
+    uint32_t c = bmu_gzip_crc32(0, (const uint8_t *)"1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, bmu_gzip_crc32(c, (const uint8_t *)"56789", 5));
+}
+
+void test_roundtrip_empty_and_short(void) {
+    roundtrip((const uint8_t *)"", 0);
+    roundtrip((const uint8_t *)"a", 1);
+    roundtrip((const uint8_t *)"abcabcabcabcabc", 15);
+}
+
+void test_roundtrip_line_protocol(void) {
+    static char lp[4096];
+    size_t len = make_line_protocol(lp, sizeof(lp));
+    TEST_ASSERT_TRUE(len > 3000);
+    roundtrip((const uint8_t *)lp, len);
+}
+
+void test_roundtrip_random_and_long_runs(void) {
+    static uint8_t buf[BMU_GZIP_MAX_INPUT];
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(x >> 16);
+    }
+    roundtrip(buf, sizeof(buf));
+    memset(buf, 'z', sizeof(buf));                 /* correspondances 258 max */
+    roundtrip(buf, sizeof(buf));
+}
+
+void test_line_protocol_ratio(void) {
+    static char lp[4096];
+    static uint8_t gz[4096];
+    size_t len = make_line_protocol(lp, sizeof(lp));
+    size_t n = bmu_gzip_compress(&s_ws, (const uint8_t *)lp, len, gz, sizeof(gz));
+    TEST_ASSERT_TRUE(n > 0);
+    printf("line-protocol %zu -> %zu octets (%.0f %%)\n", len, n, 100.0 * n / len);
+    TEST_ASSERT_TRUE(n * 3 < len);                 /* au moins ÷3 */
+}
+
+void test_output_overflow_returns_zero(void) {
+    static char lp[4096];
+    static uint8_t gz[64];
+    size_t len = make_line_protocol(lp, sizeof(lp));
+    TEST_ASSERT_EQUAL(0, bmu_gzip_compress(&s_ws, (const uint8_t *)lp, len, gz, sizeof(gz)));
+}
+
+void test_input_too_large_returns_zero(void) {
+    static uint8_t in[BMU_GZIP_MAX_INPUT + 1];
+    static uint8_t gz[BMU_GZIP_MAX_INPUT * 2];
+    TEST_ASSERT_EQUAL(0, bmu_gzip_compress(&s_ws, in, sizeof(in), gz, sizeof(gz)));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_reference);
+    RUN_TEST(test_roundtrip_empty_and_short);
+    RUN_TEST(test_roundtrip_line_protocol);
+    RUN_TEST(test_roundtrip_random_and_long_runs);
+    RUN_TEST(test_line_protocol_ratio);
+    RUN_TEST(test_output_overflow_returns_zero);
+    RUN_TEST(test_input_too_large_returns_zero);
+    return UNITY_END();
+}
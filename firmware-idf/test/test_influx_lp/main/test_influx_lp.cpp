@@ -0,0 +1,255 @@
+/**
+ * @file test_influx_lp.cpp
+ * @brief Tests host du sérialiseur line-protocol (bmu_influx_lp) — Unity.
+ *
+ * Couverture :
+ *   - Virgule fixe : arrondi, négatifs, 0 à 6 décimales, NaN/inf omis
+ *   - Entiers extrêmes (INT64_MIN/MAX)
+ *   - Échappements mesure / tags / chaînes
+ *   - Débordement du buffer → 0, rien d'écrit au-delà de cap
+ *   - Ligne batterie identique (à l'arrondi près) au chemin snprintf historique
+ *   - Benchmark : 32 batteries × 10 champs, sérialiseur vs snprintf
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "bmu_influx_lp.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static std::string one_field(float v, uint8_t dec)
+{
+    char buf[64];
+    bmu_lp_writer_t w;
+    bmu_lp_begin(&w, buf, sizeof(buf), "m");
+    bmu_lp_field_fixed(&w, "v", v, dec);
+    bmu_lp_field_int(&w, "k", 1);
+    size_t n = bmu_lp_end(&w, 0);
+    return std::string(buf, n);
+}
+
+void test_fixed_point_formatting(void)
+{
+    TEST_ASSERT_EQUAL_STRING("m v=26012.4,k=1i\n", one_field(26012.4f, 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=-1.5,k=1i\n", one_field(-1.5f, 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=-0.05,k=1i\n", one_field(-0.05f, 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=0.000,k=1i\n", one_field(0.0f, 3).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=3,k=1i\n", one_field(2.6f, 0).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=1.000000,k=1i\n", one_field(0.9999999f, 6).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=23.46,k=1i\n", one_field(23.456f, 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=4294967296.0,k=1i\n", one_field(4294967296.0f, 1).c_str());
+}
+
+void test_non_finite_fields_omitted(void)
+{
+    TEST_ASSERT_EQUAL_STRING("m k=1i\n", one_field(NAN, 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("m k=1i\n", one_field(INFINITY, 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("m k=1i\n", one_field(3.0e38f, 2).c_str());
+
+    /* Sans champ : pas de ligne */
+    char buf[32];
+    bmu_lp_writer_t w;
+    bmu_lp_begin(&w, buf, sizeof(buf), "m");
+    bmu_lp_field_fixed(&w, "v", NAN, 1);
+    TEST_ASSERT_EQUAL(0, bmu_lp_end(&w, 0));
+}
+
+void test_integer_extremes(void)
+{
+    char buf[32];
+    size_t n = bmu_lp_fmt_i64(buf, INT64_MIN);
+    TEST_ASSERT_EQUAL_STRING_LEN("-9223372036854775808", buf, n);
+    n = bmu_lp_fmt_i64(buf, INT64_MAX);
+    TEST_ASSERT_EQUAL_STRING_LEN("9223372036854775807", buf, n);
+    n = bmu_lp_fmt_i64(buf, 0);
+    TEST_ASSERT_EQUAL_STRING_LEN("0", buf, n);
+
+    for (int64_t v = -100000; v <= 100000; v += 7) {
+        char ref[32];
+        snprintf(ref, sizeof(ref), "%" PRId64, v);
+        n = bmu_lp_fmt_i64(buf, v);
+        TEST_ASSERT_EQUAL_STRING_LEN(ref, buf, n);
+    }
+}
+
+void test_escaping(void)
+{
+    char buf[128];
+    bmu_lp_writer_t w;
+    bmu_lp_begin(&w, buf, sizeof(buf), "my meas,x");
+    bmu_lp_tag(&w, "site", "Salle A,B=1");
+    bmu_lp_tag(&w, "empty", "");
+    bmu_lp_field_str(&w, "msg", "say \"hi\" \\o/");
+    bmu_lp_field_bool(&w, "ok", true);
+    size_t n = bmu_lp_end(&w, 1760000000000000000LL);
+    TEST_ASSERT_EQUAL_STRING_LEN(
+        "my\\ meas\\,x,site=Salle\\ A\\,B\\=1 msg=\"say \\\"hi\\\" \\\\o/\",ok=true "
+        "1760000000000000000\n", buf, n);
+}
+
+void test_overflow_returns_zero(void)
+{
+    char buf[40];
+    memset(buf, '#', sizeof(buf));
+    bmu_lp_writer_t w;
+    bmu_lp_begin(&w, buf, 24, "battery");
+    bmu_lp_tag_int(&w, "id", 12);
+    bmu_lp_field_fixed(&w, "voltage_mv", 26012.4f, 1);
+    TEST_ASSERT_EQUAL(0, bmu_lp_end(&w, 0));
+    for (size_t i = 24; i < sizeof(buf); i++) TEST_ASSERT_EQUAL_CHAR('#', buf[i]);
+}
+
+/* ── Référence : chemin snprintf historique de bmu_influx ──────────── */
+
+typedef struct {
+    int id;
+    float voltage_mv, current_a, ah_dis, ah_chg, wh_dis, wh_chg;
+    int nb_switch;
+    float r_ohmic, soh, soc;
+} bat_t;
+
+static size_t format_snprintf(char *dst, const bat_t *d)
+{
+    char tags[64];
+    snprintf(tags, sizeof(tags), "id=%d", d->id);
+    char fields[512];
+    int len = snprintf(fields, sizeof(fields),
+        "voltage_mv=%.1f,current_ma=%.1f,ah_discharge_mah=%.1f,ah_charge_mah=%.1f,"
+        "wh_discharge=%.1f,wh_charge=%.1f,nb_switch=%di,state=\"%s\"",
+        d->voltage_mv, d->current_a * 1000.0f, d->ah_dis * 1000.0f, d->ah_chg * 1000.0f,
+        d->wh_dis, d->wh_chg, d->nb_switch, "connected");
+    len += snprintf(fields + len, sizeof(fields) - len, ",r_ohmic_mohm=%.1f", d->r_ohmic);
+    len += snprintf(fields + len, sizeof(fields) - len, ",soh_pct=%.1f", d->soh);
+    snprintf(fields + len, sizeof(fields) - len, ",soc_pct=%.1f", d->soc);
+    char line[512];
+    int n = snprintf(line, sizeof(line), "%s,%s %s\n", "battery", tags, fields);
+    memcpy(dst, line, (size_t)n);
+    return (size_t)n;
+}
+
+static size_t format_lp(char *dst, size_t cap, const bat_t *d)
+{
+    bmu_lp_writer_t w;
+    bmu_lp_begin(&w, dst, cap, "battery");
+    bmu_lp_tag_int(&w, "id", d->id);
+    bmu_lp_field_fixed(&w, "voltage_mv", d->voltage_mv, 1);
+    bmu_lp_field_fixed(&w, "current_ma", d->current_a * 1000.0f, 1);
+    bmu_lp_field_fixed(&w, "ah_discharge_mah", d->ah_dis * 1000.0f, 1);
+    bmu_lp_field_fixed(&w, "ah_charge_mah", d->ah_chg * 1000.0f, 1);
+    bmu_lp_field_fixed(&w, "wh_discharge", d->wh_dis, 1);
+    bmu_lp_field_fixed(&w, "wh_charge", d->wh_chg, 1);
+    bmu_lp_field_int(&w, "nb_switch", d->nb_switch);
+    bmu_lp_field_str(&w, "state", "connected");
+    bmu_lp_field_fixed(&w, "r_ohmic_mohm", d->r_ohmic, 1);
+    bmu_lp_field_fixed(&w, "soh_pct", d->soh, 1);
+    bmu_lp_field_fixed(&w, "soc_pct", d->soc, 1);
+    return bmu_lp_end(&w, 0);
+}
+
+static void make_fleet(bat_t *b, int n, int cycle)
+{
+    for (int i = 0; i < n; i++) {
+        b[i].id = i;
+        b[i].voltage_mv = 25000.0f + (float)((cycle * 37 + i * 101) % 3000) * 0.73f;
+        b[i].current_a = -12.0f + (float)((cycle * 13 + i * 7) % 2400) * 0.01037f;
+        b[i].ah_dis = 3.25f + cycle * 0.0013f;
+        b[i].ah_chg = 2.75f + cycle * 0.0011f;
+        b[i].wh_dis = 81.6f + cycle * 0.031f;
+        b[i].wh_chg = 70.2f + cycle * 0.027f;
+        b[i].nb_switch = (cycle + i) % 9;
+        b[i].r_ohmic = 12.0f + (float)(i % 5) * 0.35f;
+        b[i].soh = 97.0f - (float)(i % 4) * 1.05f;
+        b[i].soc = (float)((cycle + i * 3) % 1000) * 0.1f;
+    }
+}
+
+/* Valeurs identiques à l'arrondi près (égalité parfaite : printf arrondit
+ * au pair, le sérialiseur loin de zéro) */
+static void assert_lines_equivalent(const char *a, size_t na, const char *b, size_t nb)
+{
+    std::string sa(a, na), sb(b, nb);
+    if (sa == sb) return;
+    size_t pa = 0, pb = 0;
+    while (pa < sa.size() && pb < sb.size()) {
+        size_t ea = sa.find_first_of(",\n", pa), eb = sb.find_first_of(",\n", pb);
+        std::string fa = sa.substr(pa, ea - pa), fb = sb.substr(pb, eb - pb);
+        if (fa != fb) {
+            size_t qa = fa.find('='), qb = fb.find('=');
+            TEST_ASSERT_EQUAL_STRING(fa.substr(0, qa).c_str(), fb.substr(0, qb).c_str());
+            double va = atof(fa.c_str() + qa + 1), vb = atof(fb.c_str() + qb + 1);
+            TEST_ASSERT_TRUE(fabs(va - vb) <= 0.1 + 1e-9);
+        }
+        pa = ea + 1;
+        pb = eb + 1;
+    }
+}
+
+void test_battery_line_matches_snprintf(void)
+{
+    bat_t fleet[32];
+    char a[512], b[512];
+    for (int cycle = 0; cycle < 200; cycle++) {
+        make_fleet(fleet, 32, cycle);
+        for (int i = 0; i < 32; i++) {
+            size_t na = format_snprintf(a, &fleet[i]);
+            size_t nb = format_lp(b, sizeof(b), &fleet[i]);
+            TEST_ASSERT_TRUE(nb > 0);
+            assert_lines_equivalent(a, na, b, nb);
+        }
+    }
+}
+
+void test_benchmark_fleet_32x10(void)
+{
+    static char buf[32 * 512];
+    static bat_t fleets[64][32];
+    const int cycles = 4000;
+    size_t sink = 0;
+    for (int c = 0; c < 64; c++) make_fleet(fleets[c], 32, c);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; c++) {
+        size_t len = 0;
+        for (int i = 0; i < 32; i++) len += format_snprintf(buf + len, &fleets[c % 64][i]);
+        sink += len;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int c = 0; c < cycles; c++) {
+        size_t len = 0;
+        for (int i = 0; i < 32; i++) {
+            len += format_lp(buf + len, sizeof(buf) - len, &fleets[c % 64][i]);
+        }
+        sink += len;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double us_old = std::chrono::duration<double, std::micro>(t1 - t0).count() / cycles;
+    double us_new = std::chrono::duration<double, std::micro>(t2 - t1).count() / cycles;
+    printf("32 batteries x 10 champs : snprintf %.1f us/cycle, bmu_lp %.1f us/cycle (x%.1f)\n",
+           us_old, us_new, us_old / us_new);
+    TEST_ASSERT_TRUE(sink > 0);
+    TEST_ASSERT_TRUE(us_new < us_old);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_point_formatting);
+    RUN_TEST(test_non_finite_fields_omitted);
+    RUN_TEST(test_integer_extremes);
+    RUN_TEST(test_escaping);
+    RUN_TEST(test_overflow_returns_zero);
+    RUN_TEST(test_battery_line_matches_snprintf);
+    RUN_TEST(test_benchmark_fleet_32x10);
+    return UNITY_END();
+}
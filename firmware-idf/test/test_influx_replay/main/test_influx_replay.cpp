@@ -0,0 +1,202 @@
+/**
+ * @file test_influx_replay.cpp
+ * @brief Tests host de la politique de replay du store offline (bmu_influx_replay) — Unity.
+ *
+ * Couverture :
+ *   - Seau à jetons : rafale initiale, débit, écart borné, plafond d'un appel espacé
+ *   - Débit consommé par les POST, seau épuisé
+ *   - replay.ck : aller-retour, octets little-endian, CRC
+ *   - Écriture déchirée (fichier court, vide, octet corrompu) → rejet
+ *   - Reprise au milieu d'un segment : ni perte ni doublon
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstring>
+#include <vector>
+#include "bmu_influx_replay.h"
+#include "bmu_influx_columnar.h"
+
+#define RATE    (8 * 1024)          /* 8 KB/s */
+#define BURST   16384
+#define GAP_MAX (10 * 1000000LL)
+
+static bmu_replay_bucket_t s_b;
+
+void setUp(void) { memset(&s_b, 0, sizeof(s_b)); }
+void tearDown(void) {}
+
+/* ── Seau à jetons ───────────────────────────────────────────────────── */
+
+void test_bucket_initial_burst(void)
+{
+    TEST_ASSERT_EQUAL_INT32(BURST, bmu_replay_bucket_refill(&s_b, 5000000, RATE, BURST, GAP_MAX));
+    /* Appel immédiat : plein, rien de plus */
+    TEST_ASSERT_EQUAL_INT32(BURST, bmu_replay_bucket_refill(&s_b, 5000000, RATE, BURST, GAP_MAX));
+}
+
+void test_bucket_rate_and_spend(void)
+{
+    bmu_replay_bucket_refill(&s_b, 1000000, RATE, BURST, GAP_MAX);
+    TEST_ASSERT_TRUE(bmu_replay_bucket_spend(&s_b, 10000));
+    TEST_ASSERT_FALSE(bmu_replay_bucket_spend(&s_b, 8000));     /* 16384 - 18000 */
+    TEST_ASSERT_EQUAL_INT32(-1616, s_b.tokens);
+
+    /* 1 s plus tard : +8192, dette remboursée d'abord */
+    TEST_ASSERT_EQUAL_INT32(6576, bmu_replay_bucket_refill(&s_b, 2000000, RATE, BURST, GAP_MAX));
+    /* 0.1 s plus tard, seau vidé : pas assez pour un POST */
+    bmu_replay_bucket_spend(&s_b, 7400);
+    TEST_ASSERT_TRUE(bmu_replay_bucket_refill(&s_b, 2100000, RATE, BURST, GAP_MAX) <= 0);
+}
+
+void test_bucket_gap_capped(void)
+{
+    bmu_replay_bucket_refill(&s_b, 1000000, RATE, BURST, GAP_MAX);
+    bmu_replay_bucket_spend(&s_b, BURST);
+    /* Wi-Fi coupé une heure : crédit d'un écart de 10 s au plus */
+    TEST_ASSERT_EQUAL_INT32(10 * RATE, bmu_replay_bucket_refill(&s_b, 3601000000LL, RATE, BURST, GAP_MAX));
+}
+
+void test_bucket_spaced_calls_keep_rate(void)
+{
+    /* Appels toutes les 5 s : plafond = crédit de l'appel (40 KB > rafale) */
+    bmu_replay_bucket_refill(&s_b, 1000000, RATE, BURST, GAP_MAX);
+    long sent = 0;
+    for (int k = 1; k <= 12; k++) {
+        int32_t t = bmu_replay_bucket_refill(&s_b, 1000000 + k * 5000000LL, RATE, BURST, GAP_MAX);
+        TEST_ASSERT_TRUE(t <= 5 * RATE);
+        sent += t;
+        bmu_replay_bucket_spend(&s_b, (size_t)t);
+    }
+    /* Une minute : 60 s × 8 KB/s */
+    TEST_ASSERT_EQUAL_INT32(60 * RATE, (int32_t)sent);
+}
+
+/* ── replay.ck ───────────────────────────────────────────────────────── */
+
+void test_ck_roundtrip_and_layout(void)
+{
+    bmu_replay_ck_t ck = { 42, 12345, 7 };
+    uint8_t buf[BMU_REPLAY_CK_LEN];
+    bmu_replay_ck_encode(&ck, buf);
+    const uint8_t magic[4] = { 'R', 'P', 'C', 'K' };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(magic, buf, 4);
+    TEST_ASSERT_EQUAL_UINT8(42, buf[4]);
+    TEST_ASSERT_EQUAL_UINT8(0x39, buf[8]);                      /* 12345 = 0x3039 LE */
+    TEST_ASSERT_EQUAL_UINT8(0x30, buf[9]);
+
+    bmu_replay_ck_t out = {};
+    TEST_ASSERT_TRUE(bmu_replay_ck_decode(buf, sizeof(buf), &out));
+    TEST_ASSERT_EQUAL_UINT32(42, out.seq);
+    TEST_ASSERT_EQUAL_UINT32(12345, out.offset);
+    TEST_ASSERT_EQUAL_UINT32(7, out.skip);
+}
+
+void test_ck_torn_write_rejected(void)
+{
+    bmu_replay_ck_t ck = { 3, 800, 2 };
+    uint8_t buf[BMU_REPLAY_CK_LEN];
+    bmu_replay_ck_encode(&ck, buf);
+
+    bmu_replay_ck_t out = { 9, 9, 9 };
+    TEST_ASSERT_FALSE(bmu_replay_ck_decode(buf, 12, &out));     /* coupé en cours d'écriture */
+    TEST_ASSERT_FALSE(bmu_replay_ck_decode(buf, 0, &out));      /* fichier créé, vide */
+    TEST_ASSERT_FALSE(bmu_replay_ck_decode(nullptr, 0, &out));  /* absent */
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        uint8_t bad[BMU_REPLAY_CK_LEN];
+        memcpy(bad, buf, sizeof(bad));
+        bad[i] ^= 0x10;
+        TEST_ASSERT_FALSE(bmu_replay_ck_decode(bad, sizeof(bad), &out));
+    }
+    uint8_t zero[BMU_REPLAY_CK_LEN] = {};
+    TEST_ASSERT_FALSE(bmu_replay_ck_decode(zero, sizeof(zero), &out));
+    TEST_ASSERT_EQUAL_UINT32(9, out.seq);                       /* inchangé */
+}
+
+void test_ck_start_and_skip(void)
+{
+    bmu_replay_ck_t ck;
+    bmu_replay_ck_start(&ck, 5);
+    TEST_ASSERT_EQUAL_UINT32(5, ck.seq);
+    TEST_ASSERT_EQUAL_UINT32(BMU_COL_SEG_HDR_LEN, ck.offset);
+    TEST_ASSERT_EQUAL_UINT32(0, bmu_replay_ck_skip(&ck, BMU_COL_SEG_HDR_LEN));
+
+    ck.offset = 300;
+    ck.skip = 4;
+    TEST_ASSERT_EQUAL_UINT32(BMU_REPLAY_SKIP_ALL, bmu_replay_ck_skip(&ck, BMU_COL_SEG_HDR_LEN));
+    TEST_ASSERT_EQUAL_UINT32(BMU_REPLAY_SKIP_ALL, bmu_replay_ck_skip(&ck, 299));
+    TEST_ASSERT_EQUAL_UINT32(4, bmu_replay_ck_skip(&ck, 300));
+    TEST_ASSERT_EQUAL_UINT32(0, bmu_replay_ck_skip(&ck, 420));
+}
+
+/* ── Reprise au milieu d'un segment ──────────────────────────────────── */
+
+/* Segment simulé : blocs (offset, lignes), même déroulé que replay_segment
+ * et replay_post du store — corps de POST_LINES lignes, checkpoint après
+ * chaque POST acquitté, arrêt après max_posts POST. */
+typedef struct { uint32_t off; uint32_t lines; } blk_t;
+static const blk_t BLK[] = { { 8, 5 }, { 120, 4 }, { 260, 6 }, { 400, 3 } };
+#define NB_BLK   (sizeof(BLK) / sizeof(BLK[0]))
+#define POST_LINES 4
+
+static void replay_sim(bmu_replay_ck_t *ck, int max_posts, std::vector<int> *acked)
+{
+    const bmu_replay_ck_t resume = *ck;
+    std::vector<int> body;
+    int posts = 0, base = 0;
+    for (size_t b = 0; b < NB_BLK; b++) {
+        uint32_t skip = bmu_replay_ck_skip(&resume, BLK[b].off);
+        if (skip != BMU_REPLAY_SKIP_ALL) {
+            for (uint32_t l = skip; l < BLK[b].lines; l++) {
+                if (body.size() == POST_LINES) {
+                    if (posts == max_posts) return;     /* coupure : corps perdu */
+                    acked->insert(acked->end(), body.begin(), body.end());
+                    body.clear();
+                    posts++;
+                    ck->offset = BLK[b].off;
+                    ck->skip = l;
+                }
+                body.push_back(base + (int)l);
+            }
+        }
+        base += (int)BLK[b].lines;
+    }
+    acked->insert(acked->end(), body.begin(), body.end());
+    ck->offset = 520;                                   /* fin de segment */
+    ck->skip = 0;
+}
+
+void test_resume_mid_segment_no_loss_no_dup(void)
+{
+    for (int cut = 0; cut <= 3; cut++) {
+        bmu_replay_ck_t ck;
+        bmu_replay_ck_start(&ck, 1);
+        std::vector<int> acked;
+        replay_sim(&ck, cut, &acked);
+
+        /* Reboot : checkpoint relu depuis replay.ck */
+        uint8_t buf[BMU_REPLAY_CK_LEN];
+        bmu_replay_ck_encode(&ck, buf);
+        bmu_replay_ck_t back = {};
+        TEST_ASSERT_TRUE(bmu_replay_ck_decode(buf, sizeof(buf), &back));
+        replay_sim(&back, 100, &acked);
+
+        TEST_ASSERT_EQUAL_INT(18, (int)acked.size());
+        for (int i = 0; i < 18; i++) TEST_ASSERT_EQUAL_INT(i, acked[i]);
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_initial_burst);
+    RUN_TEST(test_bucket_rate_and_spend);
+    RUN_TEST(test_bucket_gap_capped);
+    RUN_TEST(test_bucket_spaced_calls_keep_rate);
+    RUN_TEST(test_ck_roundtrip_and_layout);
+    RUN_TEST(test_ck_torn_write_rejected);
+    RUN_TEST(test_ck_start_and_skip);
+    RUN_TEST(test_resume_mid_segment_no_loss_no_dup);
+    return UNITY_END();
+}
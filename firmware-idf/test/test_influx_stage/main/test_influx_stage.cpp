@@ -0,0 +1,201 @@
+/**
+ * @file test_influx_stage.cpp
+ * @brief Tests host du staging d'écriture du store offline (bmu_influx_stage) — Unity.
+ *
+ * Couverture :
+ *   - Écritures terminées sur une frontière de secteur, fin partielle conservée
+ *   - Réalignement après une écriture partielle (fsync, fermeture)
+ *   - Arrêt : le staging partiel est écrit en entier, octets dans l'ordre
+ *   - Staging plein : secteurs d'abord, puis tout ; bloc trop grand refusé
+ *   - Échec d'écriture : reste conservé, abandon compté
+ *   - Politique fsync (octets / ancienneté) et réveil anticipé du writer
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstring>
+#include <vector>
+#include "bmu_influx_stage.h"
+
+#define SECTOR BMU_STAGE_SECTOR
+
+/* Faux fichier : contenu et taille de chaque écriture */
+typedef struct {
+    std::vector<uint8_t> data;
+    std::vector<size_t>  writes;
+    int                  fail_after;    /* < 0 : jamais */
+} fake_file_t;
+
+static fake_file_t s_file;
+static uint8_t s_buf[4 * SECTOR];
+static bmu_stage_t s;
+static uint8_t s_src[4 * SECTOR];
+
+static bool fake_write(const uint8_t *data, size_t len, void *ctx)
+{
+    fake_file_t *f = (fake_file_t *)ctx;
+    if (f->fail_after == 0) return false;
+    if (f->fail_after > 0) f->fail_after--;
+    f->data.insert(f->data.end(), data, data + len);
+    f->writes.push_back(len);
+    return true;
+}
+
+void setUp(void)
+{
+    s_file.data.clear();
+    s_file.writes.clear();
+    s_file.fail_after = -1;
+    for (size_t i = 0; i < sizeof(s_src); i++) s_src[i] = (uint8_t)(i * 7 + 3);
+    bmu_stage_init(&s, s_buf, sizeof(s_buf), fake_write, &s_file);
+    bmu_stage_open(&s);
+}
+void tearDown(void) {}
+
+/* Toutes les écritures sauf la dernière (écriture finale, all) finissent
+ * sur une frontière de secteur */
+static void assert_sector_aligned(size_t n_partial)
+{
+    size_t off = 0;
+    for (size_t k = 0; k < s_file.writes.size(); k++) {
+        off += s_file.writes[k];
+        if (k + n_partial < s_file.writes.size()) {
+            TEST_ASSERT_EQUAL_UINT32(0, off % SECTOR);
+        }
+    }
+}
+
+/* ── Alignement ──────────────────────────────────────────────────────── */
+
+void test_partial_sector_stays_staged(void)
+{
+    TEST_ASSERT_TRUE(bmu_stage_put(&s, s_src, 3000, 0));
+    TEST_ASSERT_TRUE(bmu_stage_drain(&s, false));
+    TEST_ASSERT_EQUAL_UINT32(0, s_file.writes.size());
+    TEST_ASSERT_EQUAL_UINT32(3000, s.len);
+
+    TEST_ASSERT_TRUE(bmu_stage_put(&s, s_src + 3000, 6000, 0));
+    TEST_ASSERT_TRUE(bmu_stage_drain(&s, false));
+    TEST_ASSERT_EQUAL_UINT32(2, s_file.writes.size());
+    TEST_ASSERT_EQUAL_UINT32(2 * SECTOR, s.file_off);
+    TEST_ASSERT_EQUAL_UINT32(9000 - 2 * SECTOR, s.len);
+    assert_sector_aligned(0);
+}
+
+void test_realign_after_partial_write(void)
+{
+    /* fsync : 100 octets écrits, le fichier n'est plus aligné */
+    bmu_stage_put(&s, s_src, 100, 0);
+    TEST_ASSERT_TRUE(bmu_stage_drain(&s, true));
+    TEST_ASSERT_EQUAL_UINT32(100, s.file_off);
+
+    /* La suite complète d'abord le secteur, puis secteurs entiers */
+    bmu_stage_put(&s, s_src + 100, 9000, 0);
+    bmu_stage_drain(&s, false);
+    TEST_ASSERT_EQUAL_UINT32(3, s_file.writes.size());
+    TEST_ASSERT_EQUAL_UINT32(SECTOR - 100, s_file.writes[1]);
+    TEST_ASSERT_EQUAL_UINT32(SECTOR, s_file.writes[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, s.file_off % SECTOR);
+}
+
+void test_shutdown_flushes_partial_buffer(void)
+{
+    size_t total = 0;
+    const size_t sizes[] = { 700, 5000, 1234, 4096, 333 };
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        TEST_ASSERT_TRUE(bmu_stage_put(&s, s_src + total, sizes[k], 0));
+        total += sizes[k];
+        bmu_stage_drain(&s, false);
+    }
+    TEST_ASSERT_TRUE(s.len > 0 && s.len < SECTOR);
+
+    /* Arrêt (shutdown handler) : tout sur disque, dans l'ordre */
+    TEST_ASSERT_TRUE(bmu_stage_drain(&s, true));
+    TEST_ASSERT_EQUAL_UINT32(0, s.len);
+    TEST_ASSERT_EQUAL_UINT32(total, s.file_off);
+    TEST_ASSERT_EQUAL_UINT32(total, s_file.data.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(s_src, s_file.data.data(), total);
+    assert_sector_aligned(1);
+}
+
+/* ── Staging plein, échecs ───────────────────────────────────────────── */
+
+void test_full_stage_drains_before_put(void)
+{
+    bmu_stage_put(&s, s_src, 3 * SECTOR + 500, 0);
+    /* 4 KB de plus ne tiennent pas : secteurs complets écrits d'abord */
+    TEST_ASSERT_TRUE(bmu_stage_put(&s, s_src + 3 * SECTOR + 500, SECTOR, 0));
+    TEST_ASSERT_EQUAL_UINT32(3 * SECTOR, s.file_off);
+    TEST_ASSERT_EQUAL_UINT32(500 + SECTOR, s.len);
+
+    /* Bloc plus grand que le tampon : refusé, staging intact */
+    bmu_stage_t small;
+    uint8_t tiny[64];
+    bmu_stage_init(&small, tiny, sizeof(tiny), fake_write, &s_file);
+    TEST_ASSERT_FALSE(bmu_stage_put(&small, s_src, 65, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, small.unsynced);
+}
+
+void test_write_failure_keeps_rest(void)
+{
+    bmu_stage_put(&s, s_src, 3 * SECTOR, 0);
+    s_file.fail_after = 1;                      /* disque plein au 2e secteur */
+    TEST_ASSERT_FALSE(bmu_stage_drain(&s, false));
+    TEST_ASSERT_EQUAL_UINT32(SECTOR, s.file_off);
+    TEST_ASSERT_EQUAL_UINT32(2 * SECTOR, s.len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(s_src + SECTOR, s_buf, 2 * SECTOR);
+
+    TEST_ASSERT_EQUAL_UINT32(2 * SECTOR, bmu_stage_discard(&s));
+    TEST_ASSERT_EQUAL_UINT32(0, s.len);
+}
+
+/* ── Politique fsync ─────────────────────────────────────────────────── */
+
+void test_sync_policy(void)
+{
+    const size_t SYNC_B = 16 * 1024;
+    const int64_t SYNC_US = 5000000;
+    TEST_ASSERT_FALSE(bmu_stage_sync_due(&s, 99000000, SYNC_B, SYNC_US));  /* rien à écrire */
+
+    bmu_stage_put(&s, s_src, 1000, 10000000);
+    bmu_stage_put(&s, s_src, 1000, 12000000);   /* ancienneté : premier octet */
+    TEST_ASSERT_EQUAL_INT64(10000000, s.dirty_us);
+    TEST_ASSERT_FALSE(bmu_stage_sync_due(&s, 14999999, SYNC_B, SYNC_US));
+    TEST_ASSERT_TRUE(bmu_stage_sync_due(&s, 15000000, SYNC_B, SYNC_US));
+
+    bmu_stage_synced(&s);
+    TEST_ASSERT_FALSE(bmu_stage_sync_due(&s, 30000000, SYNC_B, SYNC_US));
+
+    /* Seuil d'octets atteint avant le délai */
+    for (int k = 0; k < 4; k++) {
+        bmu_stage_put(&s, s_src, SECTOR, 31000000);
+        bmu_stage_drain(&s, false);
+    }
+    TEST_ASSERT_TRUE(bmu_stage_sync_due(&s, 31000001, SYNC_B, SYNC_US));
+}
+
+void test_wake_policy(void)
+{
+    const size_t SYNC_B = 16 * 1024;
+    bmu_stage_put(&s, s_src, SECTOR - 1, 0);
+    TEST_ASSERT_FALSE(bmu_stage_wake_due(&s, SYNC_B));
+    bmu_stage_put(&s, s_src, 1, 0);
+    TEST_ASSERT_TRUE(bmu_stage_wake_due(&s, SYNC_B));   /* secteur complet */
+    bmu_stage_drain(&s, false);
+    TEST_ASSERT_FALSE(bmu_stage_wake_due(&s, SYNC_B));
+    TEST_ASSERT_TRUE(bmu_stage_wake_due(&s, SECTOR));   /* seuil d'octets */
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_partial_sector_stays_staged);
+    RUN_TEST(test_realign_after_partial_write);
+    RUN_TEST(test_shutdown_flushes_partial_buffer);
+    RUN_TEST(test_full_stage_drains_before_put);
+    RUN_TEST(test_write_failure_keeps_rest);
+    RUN_TEST(test_sync_policy);
+    RUN_TEST(test_wake_policy);
+    return UNITY_END();
+}
@@ -0,0 +1,159 @@
+/**
+ * @file test_mqtt_fleet.cpp
+ * @brief Tests host de la trame MQTT binaire de flotte (bmu_mqtt_fleet) — Unity.
+ *
+ * Couverture :
+ *   - Vecteur de référence octet par octet (partagé avec le décodeur Python,
+ *     kxkm-api/tests/test_fleet_frame.py)
+ *   - Agrégats flotte, drapeaux des champs optionnels, climat absent
+ *   - Saturation des valeurs hors plage, arrondi au plus proche
+ *   - Bornes : trop de batteries, buffer trop petit, trame vide
+ *   - Taille sur le fil : 32 batteries en une trame vs 32 JSON
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "bmu_mqtt_fleet.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static uint8_t s_out[BMU_FLEET_FRAME_MAX_LEN];
+
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const bmu_fleet_batt_t GOLDEN_BATT[2] = {
+    {0, 0, 26012.4f, -1.234f, 3.25f, 2.75f, 81.6f, 70.2f, 3, 12.3f, 15.0f, 97.5f, 55.5f, 40},
+    {1, 3, 25950.0f, 0.5f, 0.0f, 0.001f, 0.0f, 0.1f, 0, NAN, NAN, NAN, -1.0f, -1},
+};
+
+/* Même vecteur que GOLDEN_HEX dans kxkm-api/tests/test_fleet_frame.py */
+static const char GOLDEN_HEX[] =
+    "4b4601182402010102015e659c657d6522fdffff29099c01"
+    "00000f289c6503002efbffffb20c0000be0a000030030000be0200007b009600cf032b02"
+    "010300005e650000f4010000000000000100000000000000010000000000000000000000";
+
+void test_golden_vector(void)
+{
+    size_t n = bmu_fleet_frame_encode(GOLDEN_BATT, 2, 23.45f, 41.2f, 258, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL(BMU_FLEET_FRAME_HDR_LEN + 2 * BMU_FLEET_FRAME_REC_LEN, n);
+    char hex[2 * sizeof(s_out) + 1];
+    for (size_t i = 0; i < n; i++) snprintf(hex + 2 * i, 3, "%02x", s_out[i]);
+    TEST_ASSERT_EQUAL_STRING(GOLDEN_HEX, hex);
+}
+
+void test_header_and_aggregates(void)
+{
+    size_t n = bmu_fleet_frame_encode(GOLDEN_BATT, 2, 23.45f, 41.2f, 258, s_out, sizeof(s_out));
+    TEST_ASSERT_TRUE(n > 0);
+    TEST_ASSERT_EQUAL_MEMORY("KF", s_out, 2);
+    TEST_ASSERT_EQUAL(BMU_FLEET_FRAME_VERSION, s_out[2]);
+    TEST_ASSERT_EQUAL(2, s_out[5]);
+    TEST_ASSERT_EQUAL(BMU_FLEET_FLAG_CLIMATE, s_out[6]);
+    TEST_ASSERT_EQUAL(1, s_out[7]);                    /* une seule CONNECTED */
+    TEST_ASSERT_EQUAL(258, rd16(s_out + 8));
+    TEST_ASSERT_EQUAL(25950, rd16(s_out + 10));
+    TEST_ASSERT_EQUAL(26012, rd16(s_out + 12));
+    TEST_ASSERT_EQUAL(25981, rd16(s_out + 14));
+    TEST_ASSERT_EQUAL_INT32(-734, (int32_t)rd32(s_out + 16));
+    TEST_ASSERT_EQUAL_INT16(2345, (int16_t)rd16(s_out + 20));
+    TEST_ASSERT_EQUAL(412, rd16(s_out + 22));
+}
+
+void test_optional_fields_flags(void)
+{
+    bmu_fleet_frame_encode(GOLDEN_BATT, 2, NAN, 50.0f, 0, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL(0, s_out[6]);                    /* climat incomplet → absent */
+    TEST_ASSERT_EQUAL(0, rd16(s_out + 20));
+
+    const uint8_t *r0 = s_out + BMU_FLEET_FRAME_HDR_LEN;
+    const uint8_t *r1 = r0 + BMU_FLEET_FRAME_REC_LEN;
+    TEST_ASSERT_EQUAL_HEX8(BMU_FLEET_BAT_RINT | BMU_FLEET_BAT_SOH | BMU_FLEET_BAT_SOC |
+                           BMU_FLEET_BAT_BAL, r0[2]);
+    TEST_ASSERT_EQUAL(40, r0[3]);
+    TEST_ASSERT_EQUAL(123, rd16(r0 + 28));
+    TEST_ASSERT_EQUAL(975, rd16(r0 + 32));
+    TEST_ASSERT_EQUAL(0, r1[2]);
+    TEST_ASSERT_EQUAL(0, rd16(r1 + 28));
+    TEST_ASSERT_EQUAL(3, r1[1]);                       /* BMU_STATE_ERROR */
+}
+
+void test_saturation_and_rounding(void)
+{
+    bmu_fleet_batt_t b = {7, 0, 70000.0f, -3000000.0f, -1.0f, 5000000.0f, 0.04f, 0.05f,
+                          100000, 7000.0f, 0.04f, 120.0f, 100.0f, 250};
+    /* r_ohm 7000 mΩ → 70000 en 0.1 mΩ : saturé */
+    bmu_fleet_frame_encode(&b, 1, NAN, NAN, 0, s_out, sizeof(s_out));
+    const uint8_t *r = s_out + BMU_FLEET_FRAME_HDR_LEN;
+    TEST_ASSERT_EQUAL(UINT16_MAX, rd16(r + 4));
+    TEST_ASSERT_EQUAL(UINT16_MAX, rd16(r + 6));
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, (int32_t)rd32(r + 8));
+    TEST_ASSERT_EQUAL_UINT32(0, rd32(r + 12));           /* négatif → 0 */
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, rd32(r + 16));
+    TEST_ASSERT_EQUAL_UINT32(0, rd32(r + 20));           /* 0.04 Wh → 0.0 */
+    TEST_ASSERT_EQUAL_UINT32(1, rd32(r + 24));           /* 0.05 Wh → 0.1 */
+    TEST_ASSERT_EQUAL(UINT16_MAX, rd16(r + 28));
+    TEST_ASSERT_EQUAL(0, rd16(r + 30));
+    TEST_ASSERT_EQUAL(1200, rd16(r + 32));
+    TEST_ASSERT_EQUAL(100, r[3]);
+    TEST_ASSERT_EQUAL_INT32(INT32_MIN, (int32_t)rd32(s_out + 16));
+}
+
+void test_bounds(void)
+{
+    static bmu_fleet_batt_t many[BMU_FLEET_FRAME_MAX_BATT + 1] = {};
+    TEST_ASSERT_EQUAL(0, bmu_fleet_frame_encode(many, BMU_FLEET_FRAME_MAX_BATT + 1,
+                                                NAN, NAN, 0, s_out, sizeof(s_out)));
+    TEST_ASSERT_EQUAL(0, bmu_fleet_frame_encode(GOLDEN_BATT, 2, NAN, NAN, 0, s_out,
+                                                BMU_FLEET_FRAME_HDR_LEN + BMU_FLEET_FRAME_REC_LEN));
+    size_t n = bmu_fleet_frame_encode(nullptr, 0, NAN, NAN, 9, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL(BMU_FLEET_FRAME_HDR_LEN, n);
+    TEST_ASSERT_EQUAL(0, rd16(s_out + 10));
+    TEST_ASSERT_EQUAL(0, rd16(s_out + 14));
+}
+
+void test_fleet_frame_vs_json_size(void)
+{
+    static bmu_fleet_batt_t fleet[32];
+    /* Octets MQTT par publication hors payload : en-tête fixe + longueur et
+     * texte du topic (bmu/kxkm-bmu-01/battery/NN) */
+    const size_t per_pub = 2 + 2 + 26;
+    size_t json = 0;
+    for (int i = 0; i < 32; i++) {
+        fleet[i] = GOLDEN_BATT[0];
+        fleet[i].id = (uint8_t)i;
+        char payload[384];
+        json += per_pub + (size_t)snprintf(payload, sizeof(payload),
+            "{\"bat\":%d,\"v\":%.3f,\"i\":%.3f,\"ah_d\":%.3f,\"ah_c\":%.3f,\"wh_d\":%.1f,"
+            "\"wh_c\":%.1f,\"nb_switch\":%d,\"state\":\"%s\",\"r_ohm\":%.1f,\"r_tot\":%.1f,"
+            "\"soh\":%.1f,\"soc\":%.1f,\"bal_duty\":%d}",
+            i, 26.0124, -1.234, 3.25, 2.75, 81.6, 70.2, 3, "connected", 12.3, 15.0,
+            97.5, 55.5, 40);
+    }
+    size_t n = bmu_fleet_frame_encode(fleet, 32, 23.45f, 41.2f, 0, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL(BMU_FLEET_FRAME_MAX_LEN, n);
+    size_t frame = per_pub + n;
+    printf("32 batteries : trame %zu octets / 1 publish, JSON %zu octets / 32 publish (x%.1f)\n",
+           frame, json, (double)json / frame);
+    TEST_ASSERT_TRUE(json > 5 * frame);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_vector);
+    RUN_TEST(test_header_and_aggregates);
+    RUN_TEST(test_optional_fields_flags);
+    RUN_TEST(test_saturation_and_rounding);
+    RUN_TEST(test_bounds);
+    RUN_TEST(test_fleet_frame_vs_json_size);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+/**
+ * @file test_rbe.cpp
+ * @brief Tests host du report-by-exception (bmu_rbe.h) — Unity.
+ *
+ * Couverture :
+ *   - Premier appel et reset : envoi forcé
+ *   - Bande morte > 0 (strictement dépassée), 0 (tout changement), IGNORE
+ *   - Transitions NAN ↔ valeur
+ *   - Heartbeat, y compris au débordement du compteur ms
+ *   - heartbeat_ms = 0 : publication à chaque appel (RBE désactivé)
+ *   - Publication échouée : pas de commit, retenté au tick suivant
+ *   - Flotte au repos vs transitoire, comparé à la période fixe de 10 s
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include "bmu_rbe.h"
+
+/* V (mV), I (mA), état, Ah ignoré */
+static const float DB[4] = { 50.0f, 200.0f, 0.0f, BMU_RBE_IGNORE };
+static const bmu_rbe_cfg_t CFG = { DB, 4, 60000 };
+static bmu_rbe_slot_t s_slot;
+
+void setUp(void)
+{
+    s_slot = bmu_rbe_slot_t{};
+}
+void tearDown(void) {}
+
+void test_first_call_and_reset(void)
+{
+    const float v[4] = { 26000.0f, 0.0f, 0.0f, 1.0f };
+    TEST_ASSERT_TRUE(bmu_rbe_check(&CFG, &s_slot, v, 1000));
+    TEST_ASSERT_FALSE(bmu_rbe_check(&CFG, &s_slot, v, 2000));
+    bmu_rbe_reset(&s_slot);
+    TEST_ASSERT_TRUE(bmu_rbe_check(&CFG, &s_slot, v, 3000));
+}
+
+void test_deadbands(void)
+{
+    float v[4] = { 26000.0f, 1000.0f, 0.0f, 1.0f };
+    bmu_rbe_commit(&CFG, &s_slot, v, 0);
+
+    v[0] = 26050.0f;                                   /* = bande : rien */
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 100));
+    v[0] = 25949.0f;                                   /* > bande, négatif */
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 100));
+    v[0] = 26000.0f;
+
+    v[1] = 1150.0f;
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 100));
+    v[1] = 1201.0f;
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 100));
+    v[1] = 1000.0f;
+
+    v[2] = 1.0f;                                       /* bande 0 : état */
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 100));
+    v[2] = 0.0f;
+
+    v[3] = 1e6f;                                       /* IGNORE */
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 100));
+}
+
+void test_deadband_measured_from_last_sent(void)
+{
+    /* Dérive lente : mesurée depuis le dernier envoi, pas le tick précédent */
+    float v[4] = { 26000.0f, 0.0f, 0.0f, 0.0f };
+    bmu_rbe_commit(&CFG, &s_slot, v, 0);
+    int sent = 0;
+    for (int k = 1; k <= 20; k++) {
+        v[0] = 26000.0f + 10.0f * k;
+        if (bmu_rbe_check(&CFG, &s_slot, v, (uint32_t)k * 1000)) sent++;
+    }
+    TEST_ASSERT_EQUAL(3, sent);                        /* +60, +120, +180 mV */
+    TEST_ASSERT_EQUAL_FLOAT(26180.0f, s_slot.last[0]);
+}
+
+void test_nan_transitions(void)
+{
+    float v[4] = { NAN, 0.0f, 0.0f, 0.0f };
+    bmu_rbe_commit(&CFG, &s_slot, v, 0);
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 10));   /* NAN → NAN */
+    v[0] = 26000.0f;
+    TEST_ASSERT_TRUE(bmu_rbe_check(&CFG, &s_slot, v, 10));
+    v[0] = NAN;
+    TEST_ASSERT_TRUE(bmu_rbe_check(&CFG, &s_slot, v, 20));
+}
+
+void test_heartbeat_and_wrap(void)
+{
+    const float v[4] = { 26000.0f, 0.0f, 0.0f, 0.0f };
+    bmu_rbe_commit(&CFG, &s_slot, v, 1000);
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 60999));
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 61000));
+
+    bmu_rbe_commit(&CFG, &s_slot, v, UINT32_MAX - 10000);
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 20000));
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 50000));
+}
+
+void test_disabled_publishes_every_call(void)
+{
+    const bmu_rbe_cfg_t off = { DB, 4, 0 };
+    const float v[4] = { 26000.0f, 0.0f, 0.0f, 0.0f };
+    for (int k = 0; k < 5; k++) {
+        TEST_ASSERT_TRUE(bmu_rbe_check(&off, &s_slot, v, (uint32_t)k));
+    }
+}
+
+void test_failed_publish_retried(void)
+{
+    float v[4] = { 26000.0f, 0.0f, 0.0f, 0.0f };
+    bmu_rbe_commit(&CFG, &s_slot, v, 0);
+    v[2] = 3.0f;                                       /* passage en erreur */
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 1000));
+    /* broker déconnecté : pas de commit → toujours dû */
+    TEST_ASSERT_TRUE(bmu_rbe_due(&CFG, &s_slot, v, 2000));
+    bmu_rbe_commit(&CFG, &s_slot, v, 2000);
+    TEST_ASSERT_FALSE(bmu_rbe_due(&CFG, &s_slot, v, 3000));
+}
+
+void test_idle_quiet_transient_fast(void)
+{
+    /* 10 min à tick 1 s : bruit ±20 mV / ±100 mA, puis un transitoire */
+    float v[4] = { 26000.0f, 0.0f, 0.0f, 0.0f };
+    int sent = 0;
+    uint32_t t_step = 0, t_sent = 0;
+    for (uint32_t t = 0; t < 600000; t += 1000) {
+        int k = (int)(t / 1000);
+        v[0] = 26000.0f + ((k % 3) - 1) * 20.0f;
+        v[1] = ((k % 5) - 2) * 50.0f;
+        if (t == 300000) t_step = t;                   /* charge 15 A */
+        if (t_step && t >= t_step) v[1] = 15000.0f;
+        if (bmu_rbe_check(&CFG, &s_slot, v, t)) {
+            sent++;
+            if (t_step && !t_sent && t >= t_step) t_sent = t;
+        }
+    }
+    const int fixed = 600000 / 10000;
+    printf("10 min : %d envois RBE vs %d à période fixe, transitoire en %lu ms\n",
+           sent, fixed, (unsigned long)(t_sent - t_step));
+    TEST_ASSERT_EQUAL(t_step, t_sent);                 /* dès le tick du changement */
+    TEST_ASSERT_TRUE(sent <= 12);                      /* ~1 heartbeat / min + transitoire */
+    TEST_ASSERT_TRUE(sent * 5 <= fixed);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_call_and_reset);
+    RUN_TEST(test_deadbands);
+    RUN_TEST(test_deadband_measured_from_last_sent);
+    RUN_TEST(test_nan_transitions);
+    RUN_TEST(test_heartbeat_and_wrap);
+    RUN_TEST(test_disabled_publishes_every_call);
+    RUN_TEST(test_failed_publish_retried);
+    RUN_TEST(test_idle_quiet_transient_fast);
+    return UNITY_END();
+}
@@ -0,0 +1,186 @@
+/**
+ * @file test_rul_trend.cpp
+ * @brief Tests host du moteur de tendance RUL (bmu_rul_trend.h) — Unity.
+ *
+ * Couverture :
+ *   - Régression récursive : pente/ordonnée exactes sur données linéaires
+ *   - Robustesse : points aberrants écrêtés (Huber)
+ *   - Facteur d'oubli : suit un changement de pente
+ *   - Précision : 4 ans horaires, λ = 0.999 (sommes double)
+ *   - Jours avant seuil : métrique croissante (R_int), décroissante (SOH),
+ *     seuil franchi, tendance favorable, historique insuffisant
+ *   - Capacité ΔAh / ΔSOC, détection du repos pour les ancres
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include "bmu_rul_trend.h"
+
+static const float T0 = 20000.0f;      /* jours epoch (~2024) */
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_linear_fit_exact(void) {
+    bmu_rul_reg_t r = {};
+    for (int h = 0; h < 24 * 30; h++) {             /* 30 jours, horaire */
+        float t = T0 + (float)h / 24.0f;
+        bmu_rul_reg_add(&r, t, 20.0f + 0.05f * (t - T0), 1.0f, 0.2f);
+    }
+    float a, b;
+    TEST_ASSERT_TRUE(bmu_rul_reg_fit(&r, &a, &b));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.05f, b);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 20.0f, a);
+}
+
+void test_fit_needs_time_span(void) {
+    bmu_rul_reg_t r = {};
+    bmu_rul_reg_add(&r, T0, 10.0f, 1.0f, 0.1f);
+    bmu_rul_reg_add(&r, T0, 11.0f, 1.0f, 0.1f);
+    float a, b;
+    TEST_ASSERT_FALSE(bmu_rul_reg_fit(&r, &a, &b));
+    TEST_ASSERT_TRUE(isnan(bmu_rul_reg_slope(&r)));
+}
+
+void test_outliers_clipped(void) {
+    bmu_rul_reg_t clean = {}, dirty = {};
+    for (int d = 0; d < 60; d++) {
+        float t = T0 + (float)d;
+        float y = 30.0f + 0.02f * (float)d + ((d & 1) ? 0.1f : -0.1f);
+        bmu_rul_reg_add(&clean, t, y, 1.0f, 0.2f);
+        /* 1 mesure R_int sur 10 aberrante (+20 mΩ, contact douteux) */
+        bmu_rul_reg_add(&dirty, t, (d % 10 == 5) ? y + 20.0f : y, 1.0f, 0.2f);
+    }
+    float slope_clean = bmu_rul_reg_slope(&clean);
+    float slope_dirty = bmu_rul_reg_slope(&dirty);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.02f, slope_clean);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, slope_clean, slope_dirty);
+}
+
+void test_forgetting_tracks_new_slope(void) {
+    bmu_rul_reg_t r = {};
+    float y = 100.0f;
+    for (int d = 0; d < 400; d++) {                 /* plat 200 j puis -0.1 %/j */
+        if (d >= 200) y -= 0.1f;
+        bmu_rul_reg_add(&r, T0 + (float)d, y, 0.97f, 0.1f);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -0.1f, bmu_rul_reg_slope(&r));
+}
+
+void test_long_history_precision(void) {
+    /* 4 ans horaires, oubli 0.999 : en float les sommes Σt² et Σt
+     * s'annulent mal dans le déterminant, la pente dérivait de ~20 % */
+    bmu_rul_reg_t r = {};
+    uint32_t seed = 12345u;
+    const int hours = 4 * 365 * 24;
+    double t = T0;
+    for (int h = 0; h < hours; h++) {
+        t = (double)T0 + (double)h / 24.0;
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((float)(seed >> 8) / 16777216.0f - 0.5f) * 0.04f;
+        bmu_rul_reg_add(&r, t, 100.0f - 0.010f * (float)(t - T0) + noise, 0.999f, 0.5f);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(5e-4f, -0.010f, bmu_rul_reg_slope(&r));
+    float y_now = 100.0f - 0.010f * (float)(t - T0);
+    float expected = (y_now - 80.0f) / 0.010f;
+    float d = bmu_rul_reg_days_to(&r, t, 80.0f, false, 10, 30.0f);
+    TEST_ASSERT_FLOAT_WITHIN(expected * 0.05f, expected, d);
+}
+
+void test_days_to_rising_metric(void) {
+    bmu_rul_reg_t r = {};
+    for (int d = 0; d <= 30; d++) {                 /* R_int 20 → 23 mΩ en 30 j */
+        bmu_rul_reg_add(&r, T0 + (float)d, 20.0f + 0.1f * (float)d, 1.0f, 0.1f);
+    }
+    /* Seuil 40 mΩ : (40 - 23) / 0.1 = 170 j */
+    float days = bmu_rul_reg_days_to(&r, T0 + 30.0f, 40.0f, true, 8, 7.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 170.0f, days);
+}
+
+void test_days_to_falling_metric(void) {
+    bmu_rul_reg_t r = {};
+    for (int d = 0; d <= 100; d++) {                /* SOH 98 → 93 % */
+        bmu_rul_reg_add(&r, T0 + (float)d, 98.0f - 0.05f * (float)d, 1.0f, 0.1f);
+    }
+    float days = bmu_rul_reg_days_to(&r, T0 + 100.0f, 80.0f, false, 8, 7.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 260.0f, days);
+}
+
+void test_days_unknown_when_improving_or_short(void) {
+    bmu_rul_reg_t r = {};
+    for (int d = 0; d <= 30; d++) {
+        bmu_rul_reg_add(&r, T0 + (float)d, 95.0f + 0.01f * (float)d, 1.0f, 0.1f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(BMU_RUL_DAYS_UNKNOWN,
+        bmu_rul_reg_days_to(&r, T0 + 30.0f, 80.0f, false, 8, 7.0f));
+    /* Étendue < min_span */
+    TEST_ASSERT_EQUAL_FLOAT(BMU_RUL_DAYS_UNKNOWN,
+        bmu_rul_reg_days_to(&r, T0 + 30.0f, 80.0f, false, 8, 60.0f));
+    /* Pas assez de points */
+    TEST_ASSERT_EQUAL_FLOAT(BMU_RUL_DAYS_UNKNOWN,
+        bmu_rul_reg_days_to(&r, T0 + 30.0f, 80.0f, false, 100, 7.0f));
+}
+
+void test_days_zero_when_past_threshold(void) {
+    bmu_rul_reg_t r = {};
+    for (int d = 0; d <= 30; d++) {
+        bmu_rul_reg_add(&r, T0 + (float)d, 79.0f - 0.01f * (float)d, 1.0f, 0.1f);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, bmu_rul_reg_days_to(&r, T0 + 30.0f, 80.0f, false, 8, 7.0f));
+}
+
+void test_capacity_from_soc_swing(void) {
+    bmu_rul_cap_anchor_t an = {};
+    float cap = 0.0f;
+    TEST_ASSERT_FALSE(bmu_rul_capacity_sample(&an, 0.0f, 0.9f, 0.3f, &cap));  /* ancre */
+    TEST_ASSERT_FALSE(bmu_rul_capacity_sample(&an, -2.0f, 0.8f, 0.3f, &cap)); /* ΔSOC trop faible */
+    /* -9 Ah net pour 0.9 → 0.4 : 18 Ah */
+    TEST_ASSERT_TRUE(bmu_rul_capacity_sample(&an, -9.0f, 0.4f, 0.3f, &cap));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 18.0f, cap);
+    /* Recharge +7.2 Ah pour 0.4 → 0.8 */
+    TEST_ASSERT_TRUE(bmu_rul_capacity_sample(&an, -1.8f, 0.8f, 0.3f, &cap));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 18.0f, cap);
+}
+
+void test_capacity_rejects_inconsistent_sign(void) {
+    bmu_rul_cap_anchor_t an = {};
+    float cap = -1.0f;
+    bmu_rul_capacity_sample(&an, 0.0f, 0.2f, 0.3f, &cap);
+    /* SOC monte alors que l'Ah net baisse : compteurs incohérents */
+    TEST_ASSERT_FALSE(bmu_rul_capacity_sample(&an, -3.0f, 0.7f, 0.3f, &cap));
+    TEST_ASSERT_EQUAL_FLOAT(-1.0f, cap);
+}
+
+void test_rest_check(void) {
+    bmu_rul_rest_t rs = {};
+    /* Premier appel : pas de référence de débit */
+    TEST_ASSERT_FALSE(bmu_rul_rest_check(&rs, 100.0, 0.0f, 0.2f, 0.05f));
+    TEST_ASSERT_TRUE(bmu_rul_rest_check(&rs, 100.01, 0.05f, 0.2f, 0.05f));
+    /* Courant de charge en cours */
+    TEST_ASSERT_FALSE(bmu_rul_rest_check(&rs, 100.02, -3.0f, 0.2f, 0.05f));
+    /* Courant nul à l'instant, mais la batterie a travaillé entre-temps */
+    TEST_ASSERT_FALSE(bmu_rul_rest_check(&rs, 112.0, 0.0f, 0.2f, 0.05f));
+    TEST_ASSERT_TRUE(bmu_rul_rest_check(&rs, 112.0, 0.0f, 0.2f, 0.05f));
+    /* Débit élevé (compteurs à plusieurs milliers d'Ah) : delta seul compte */
+    rs = {};
+    bmu_rul_rest_check(&rs, 50000.0, 0.0f, 0.2f, 0.05f);
+    TEST_ASSERT_TRUE(bmu_rul_rest_check(&rs, 50000.01, 0.0f, 0.2f, 0.05f));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_linear_fit_exact);
+    RUN_TEST(test_fit_needs_time_span);
+    RUN_TEST(test_outliers_clipped);
+    RUN_TEST(test_forgetting_tracks_new_slope);
+    RUN_TEST(test_long_history_precision);
+    RUN_TEST(test_days_to_rising_metric);
+    RUN_TEST(test_days_to_falling_metric);
+    RUN_TEST(test_days_unknown_when_improving_or_short);
+    RUN_TEST(test_days_zero_when_past_threshold);
+    RUN_TEST(test_capacity_from_soc_swing);
+    RUN_TEST(test_capacity_rejects_inconsistent_sign);
+    RUN_TEST(test_rest_check);
+    return UNITY_END();
+}
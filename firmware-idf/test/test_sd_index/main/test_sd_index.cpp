@@ -0,0 +1,349 @@
+/**
+ * @file test_sd_index.cpp
+ * @brief Tests host de l'index temporel du journal SD (bmu_sd_index) — Unity.
+ *
+ * Couverture :
+ *   - Lecture utc_ms / clé d'une ligne, en-tête et heure invalide ignorés
+ *   - Une entrée par tranche, horloge qui recule sans entrée
+ *   - Dichotomie : avant, dans, après l'index ; index vide
+ *   - Requête batterie + plage sur 3 h à 5 Hz : lignes exactes, lecture
+ *     limitée à la plage (position du fichier à l'arrêt)
+ *   - Arrêt demandé par le callback, borne de fin du segment courant
+ *   - Échantillonnage par pas : un snapshot par échéance, grille reportée
+ *     d'un segment au suivant, pas plus fin que la tranche d'index
+ *   - Requête sur un répertoire de segments (chemin de bmu_sd_log_query) :
+ *     pas de 10 s à travers les segments, segment supprimé
+ *   - Segment sans .idx (absent ou vide) : échantillonnage par parcours
+ *     linéaire, mêmes lignes qu'avec l'index
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include "bmu_sd_index.h"
+
+static const int64_t T0 = 1792000020000LL;    /* utc_ms de départ, début de minute */
+static FILE *s_csv, *s_idx;
+static char s_buf[4096];
+
+void setUp(void)
+{
+    s_csv = tmpfile();
+    s_idx = tmpfile();
+}
+void tearDown(void)
+{
+    fclose(s_csv);
+    fclose(s_idx);
+}
+
+/* Segment comme l'écrit le journal : en-tête puis 4 batteries par snapshot */
+static void write_segment(int seconds, int hz, uint32_t bucket_s)
+{
+    bmu_sd_idx_builder_t b;
+    bmu_sd_idx_builder_reset(&b, bucket_s);
+    fputs("utc_ms,uptime_ms,bat,mv,ma,state,switches,health\n", s_csv);
+    for (int k = 0; k < seconds * hz; k++) {
+        int64_t t = T0 + (int64_t)k * 1000 / hz;
+        for (int bat = 1; bat <= 4; bat++) {
+            uint32_t off = (uint32_t)ftell(s_csv);
+            fprintf(s_csv, "%lld,%d,%d,%d,-1500,1,12,100\n", (long long)t, k * 200, bat, 26000 + bat);
+            bmu_sd_idx_entry_t e;
+            if (bmu_sd_idx_feed(&b, t, off, &e)) fwrite(&e, sizeof(e), 1, s_idx);
+        }
+    }
+    fflush(s_csv);
+    fflush(s_idx);
+}
+
+struct sink_t {
+    std::vector<long long> t;
+    int limit;
+};
+
+static bool collect(const char *row, size_t len, void *arg)
+{
+    sink_t *s = (sink_t *)arg;
+    s->t.push_back(bmu_sd_row_time(row, len));
+    return s->limit == 0 || (int)s->t.size() < s->limit;
+}
+
+void test_row_parsing(void)
+{
+    const char *r = "1792000000123,5000,7,26010,-1500,1,12,100";
+    TEST_ASSERT_EQUAL_INT64(1792000000123LL, bmu_sd_row_time(r, strlen(r)));
+    TEST_ASSERT_EQUAL_INT64(-1, bmu_sd_row_time("utc_ms,uptime_ms", 16));
+    TEST_ASSERT_EQUAL_INT64(-1, bmu_sd_row_time("0,5000,7", 8));     /* heure invalide */
+    TEST_ASSERT_EQUAL_INT64(-1, bmu_sd_row_time("123", 3));          /* colonne seule */
+
+    bmu_sd_query_t q = { 1792000000000LL, 1792000001000LL, 7, 0 };
+    TEST_ASSERT_TRUE(bmu_sd_row_match(&q, r, strlen(r)));
+    q.key = 17;
+    TEST_ASSERT_FALSE(bmu_sd_row_match(&q, r, strlen(r)));
+    q.key = 0;
+    TEST_ASSERT_TRUE(bmu_sd_row_match(&q, r, strlen(r)));
+    q.to_ms = 1792000000122LL;
+    TEST_ASSERT_FALSE(bmu_sd_row_match(&q, r, strlen(r)));
+}
+
+void test_builder_buckets_and_backward_clock(void)
+{
+    bmu_sd_idx_builder_t b;
+    bmu_sd_idx_entry_t e;
+    bmu_sd_idx_builder_reset(&b, 60);
+    TEST_ASSERT_FALSE(bmu_sd_idx_feed(&b, -1, 0, &e));
+    TEST_ASSERT_TRUE(bmu_sd_idx_feed(&b, T0, 100, &e));
+    TEST_ASSERT_EQUAL_UINT32(100, e.offset);
+    TEST_ASSERT_FALSE(bmu_sd_idx_feed(&b, T0 + 30000, 200, &e));    /* même tranche */
+    TEST_ASSERT_TRUE(bmu_sd_idx_feed(&b, T0 + 60000, 300, &e));
+    TEST_ASSERT_FALSE(bmu_sd_idx_feed(&b, T0 - 3600000, 400, &e));  /* SNTP recule */
+    TEST_ASSERT_TRUE(bmu_sd_idx_feed(&b, T0 + 120000, 500, &e));
+}
+
+void test_find(void)
+{
+    uint32_t first;
+    TEST_ASSERT_EQUAL_UINT32(0, bmu_sd_idx_find(s_idx, T0, &first));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, first);
+
+    write_segment(600, 5, 60);                          /* 10 tranches */
+    fseek(s_idx, 0, SEEK_END);
+    TEST_ASSERT_EQUAL(10 * (long)sizeof(bmu_sd_idx_entry_t), ftell(s_idx));
+
+    TEST_ASSERT_EQUAL_UINT32(0, bmu_sd_idx_find(s_idx, T0 - 5000, &first));
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(T0 / 1000), first);
+
+    bmu_sd_idx_entry_t e[10];
+    fseek(s_idx, 0, SEEK_SET);
+    TEST_ASSERT_EQUAL(10, (int)fread(e, sizeof(e[0]), 10, s_idx));
+    TEST_ASSERT_EQUAL_UINT32(e[0].offset, bmu_sd_idx_find(s_idx, T0, NULL));
+    TEST_ASSERT_EQUAL_UINT32(e[4].offset, bmu_sd_idx_find(s_idx, T0 + 4 * 60000 + 59999, NULL));
+    TEST_ASSERT_EQUAL_UINT32(e[5].offset, bmu_sd_idx_find(s_idx, T0 + 5 * 60000, NULL));
+    TEST_ASSERT_EQUAL_UINT32(e[9].offset, bmu_sd_idx_find(s_idx, T0 + 86400000, NULL));
+}
+
+void test_range_query_battery(void)
+{
+    write_segment(3 * 3600, 5, 60);                     /* 3 h, 216 000 lignes */
+    long seg_size = ftell(s_csv);
+
+    /* batterie 3, de T0+1h à T0+1h+10min */
+    bmu_sd_query_t q = { T0 + 3600000, T0 + 3600000 + 600000, 3, 0 };
+    uint32_t off = bmu_sd_idx_find(s_idx, q.from_ms, NULL);
+    sink_t out = {};
+    uint32_t rows = 0;
+    bool more = bmu_sd_stream_rows(s_csv, off, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows);
+    long stop = ftell(s_csv);
+
+    TEST_ASSERT_FALSE(more);                            /* fin de plage dans ce segment */
+    TEST_ASSERT_EQUAL_UINT32(600 * 5 + 1, rows);        /* bornes incluses */
+    TEST_ASSERT_EQUAL_UINT32(rows, (uint32_t)out.t.size());
+    TEST_ASSERT_EQUAL_INT64(q.from_ms, out.t.front());
+    TEST_ASSERT_EQUAL_INT64(q.to_ms, out.t.back());
+    for (size_t i = 1; i < out.t.size(); i++) TEST_ASSERT_EQUAL_INT64(200, out.t[i] - out.t[i - 1]);
+
+    /* Lu : la plage + au plus une tranche d'index + un bloc */
+    long per_minute = seg_size / (3 * 60);
+    long read = stop - (long)off;
+    printf("3 h = %ld octets, requête 10 min batterie 3 : %ld octets lus (%.1f %%)\n",
+           seg_size, read, 100.0 * read / seg_size);
+    TEST_ASSERT_TRUE(read <= 11 * per_minute + (long)sizeof(s_buf));
+}
+
+void test_callback_stop_and_end_bound(void)
+{
+    write_segment(120, 5, 60);
+    bmu_sd_query_t q = { T0, T0 + 3600000, 0, 0 };
+    sink_t out = {};
+    out.limit = 10;
+    uint32_t rows = 0;
+    TEST_ASSERT_FALSE(bmu_sd_stream_rows(s_csv, 0, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows));
+    TEST_ASSERT_EQUAL_UINT32(10, rows);
+
+    /* Segment courant : lecture bornée à la taille synchronisée */
+    bmu_sd_idx_entry_t e[2];
+    fseek(s_idx, 0, SEEK_SET);
+    TEST_ASSERT_EQUAL(2, (int)fread(e, sizeof(e[0]), 2, s_idx));
+    out = sink_t{};
+    rows = 0;
+    TEST_ASSERT_TRUE(bmu_sd_stream_rows(s_csv, 0, e[1].offset, &q, s_buf, sizeof(s_buf), collect, &out, &rows));
+    TEST_ASSERT_EQUAL_UINT32(60 * 5 * 4, rows);         /* première minute, 4 batteries */
+}
+
+void test_sampled_query(void)
+{
+    write_segment(3 * 3600, 5, 60);
+
+    /* 2 h à partir de T0+10 min, pas de 5 min : grille alignée sur 300 s */
+    bmu_sd_query_t q = { T0 + 600000, T0 + 600000 + 7200000, 0, 300 };
+    uint32_t next_s = (uint32_t)((q.from_ms + 999) / 1000);
+    sink_t out = {};
+    uint32_t rows = 0;
+    TEST_ASSERT_FALSE(bmu_sd_stream_sampled(s_csv, s_idx, 0, &q, &next_s, s_buf, sizeof(s_buf),
+                                            collect, &out, &rows));
+    TEST_ASSERT_EQUAL_UINT32(25 * 4, rows);            /* départ + 24 échéances, 4 batteries */
+    TEST_ASSERT_EQUAL_INT64(q.from_ms, out.t.front());
+    for (size_t i = 0; i < out.t.size(); i += 4) {
+        TEST_ASSERT_EQUAL_INT64(out.t[i], out.t[i + 3]);             /* un snapshot complet */
+        if (i >= 8) TEST_ASSERT_EQUAL_INT64(300000, out.t[i] - out.t[i - 4]);
+        TEST_ASSERT_EQUAL_INT64(0, (out.t[i] / 1000) % (i == 0 ? 60 : 300));
+    }
+
+    /* Une batterie ; le pas se poursuit depuis next_s (segment suivant) */
+    q.key = 3;
+    next_s = (uint32_t)((q.from_ms + 999) / 1000);
+    out = sink_t{};
+    rows = 0;
+    bmu_sd_stream_sampled(s_csv, s_idx, 0, &q, &next_s, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(25, rows);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(out.t.back() / 1000) + 300, next_s);
+
+    /* Pas plus fin que la tranche d'index : tranche lue jusqu'à chaque échéance */
+    q = bmu_sd_query_t{ T0, T0 + 600000 - 1, 0, 10 };
+    next_s = (uint32_t)(T0 / 1000);
+    rows = 0;
+    out = sink_t{};
+    bmu_sd_stream_sampled(s_csv, s_idx, 0, &q, &next_s, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(60 * 4, rows);
+    for (size_t i = 4; i < out.t.size(); i += 4) {
+        TEST_ASSERT_EQUAL_INT64(10000, out.t[i] - out.t[i - 4]);
+    }
+}
+
+/* Index absent ou vide : parcours linéaire, mêmes échantillons qu'avec l'index */
+void test_sampled_query_without_index(void)
+{
+    write_segment(3600, 5, 60);
+    bmu_sd_query_t q = { T0 + 600000, T0 + 600000 + 1800000, 2, 10 };
+
+    uint32_t next_s = (uint32_t)((q.from_ms + 999) / 1000);
+    sink_t ref = {};
+    uint32_t ref_rows = 0;
+    bmu_sd_stream_sampled(s_csv, s_idx, 0, &q, &next_s, s_buf, sizeof(s_buf), collect, &ref, &ref_rows);
+    uint32_t ref_next = next_s;
+    TEST_ASSERT_EQUAL_UINT32(181, ref_rows);
+
+    FILE *empty = tmpfile();
+    FILE *const idx[] = { nullptr, empty };
+    for (size_t k = 0; k < 2; k++) {
+        next_s = (uint32_t)((q.from_ms + 999) / 1000);
+        sink_t out = {};
+        uint32_t rows = 0;
+        TEST_ASSERT_FALSE(bmu_sd_stream_sampled(s_csv, idx[k], 0, &q, &next_s, s_buf, sizeof(s_buf),
+                                                collect, &out, &rows));
+        TEST_ASSERT_EQUAL_UINT32(ref_rows, rows);
+        TEST_ASSERT_EQUAL_INT64_ARRAY(ref.t.data(), out.t.data(), ref.t.size());
+        TEST_ASSERT_EQUAL_UINT32(ref_next, next_s);
+    }
+    fclose(empty);
+}
+
+/* Segments NNNNNNNN.csv/.idx dans un répertoire, comme le journal */
+static void write_dir_segment(const char *dir, uint32_t seq, int64_t t0, int seconds, int hz)
+{
+    char path[BMU_SD_PATH_MAX];
+    bmu_sd_seg_path(path, sizeof(path), dir, seq, "csv");
+    FILE *csv = fopen(path, "wb");
+    bmu_sd_seg_path(path, sizeof(path), dir, seq, "idx");
+    FILE *idx = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(csv);
+    TEST_ASSERT_NOT_NULL(idx);
+    bmu_sd_idx_builder_t b;
+    bmu_sd_idx_builder_reset(&b, 60);
+    fputs("utc_ms,uptime_ms,bat,mv,ma,state,switches,health\n", csv);
+    for (int k = 0; k < seconds * hz; k++) {
+        int64_t t = t0 + (int64_t)k * 1000 / hz;
+        for (int bat = 1; bat <= 4; bat++) {
+            uint32_t off = (uint32_t)ftell(csv);
+            fprintf(csv, "%lld,%d,%d,%d,-1500,1,12,100\n", (long long)t, k * 200, bat, 26000 + bat);
+            bmu_sd_idx_entry_t e;
+            if (bmu_sd_idx_feed(&b, t, off, &e)) fwrite(&e, sizeof(e), 1, idx);
+        }
+    }
+    fclose(csv);
+    fclose(idx);
+}
+
+static void remove_dir_segment(const char *dir, uint32_t seq)
+{
+    char path[BMU_SD_PATH_MAX];
+    bmu_sd_seg_path(path, sizeof(path), dir, seq, "csv");
+    remove(path);
+    bmu_sd_seg_path(path, sizeof(path), dir, seq, "idx");
+    remove(path);
+}
+
+/* Requête complète sur plusieurs segments (chemin de bmu_sd_log_query) :
+ * le pas demandé est tenu même plus fin que la tranche d'index, à travers
+ * les frontières de segment */
+void test_query_segments_step(void)
+{
+    char dir[] = "/tmp/sdidxXXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        write_dir_segment(dir, seq, T0 + (int64_t)(seq - 1) * 1800000, 1800, 5);
+    }
+
+    /* 1 h à 10 s à cheval sur les segments 1..3, batterie 2 */
+    bmu_sd_query_t q = { T0 + 900000, T0 + 900000 + 3600000 - 1, 2, 10 };
+    sink_t out = {};
+    uint32_t rows = 0;
+    bmu_sd_query_segments(dir, 1, 3, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(360, rows);
+    TEST_ASSERT_EQUAL_INT64(q.from_ms, out.t.front());
+    for (size_t i = 1; i < out.t.size(); i++) TEST_ASSERT_EQUAL_INT64(10000, out.t[i] - out.t[i - 1]);
+
+    /* Pas de 5 min et lignes complètes sur la même plage */
+    q.step_s = 300;
+    out = sink_t{};
+    rows = 0;
+    bmu_sd_query_segments(dir, 1, 3, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(13, rows);                /* départ hors grille + 12 échéances */
+    q.step_s = 0;
+    rows = 0;
+    out = sink_t{};
+    bmu_sd_query_segments(dir, 1, 3, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(3600 * 5, rows);
+
+    /* Segment du milieu supprimé par le budget : sauté */
+    remove_dir_segment(dir, 2);
+    q.step_s = 10;
+    rows = 0;
+    out = sink_t{};
+    bmu_sd_query_segments(dir, 1, 3, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(180, rows);
+
+    /* Index du segment 3 perdu : segment lu linéairement, pas tenu */
+    char path[BMU_SD_PATH_MAX];
+    bmu_sd_seg_path(path, sizeof(path), dir, 3, "idx");
+    remove(path);
+    rows = 0;
+    out = sink_t{};
+    bmu_sd_query_segments(dir, 1, 3, 0, &q, s_buf, sizeof(s_buf), collect, &out, &rows);
+    TEST_ASSERT_EQUAL_UINT32(180, rows);
+    TEST_ASSERT_EQUAL_INT64(T0 + 3600000, out.t[90]);             /* début du segment 3 */
+    for (size_t i = 91; i < out.t.size(); i++) TEST_ASSERT_EQUAL_INT64(10000, out.t[i] - out.t[i - 1]);
+    TEST_ASSERT_EQUAL_INT64(q.to_ms - 9999, out.t.back());
+
+    remove_dir_segment(dir, 1);
+    remove_dir_segment(dir, 3);
+    rmdir(dir);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_row_parsing);
+    RUN_TEST(test_builder_buckets_and_backward_clock);
+    RUN_TEST(test_find);
+    RUN_TEST(test_range_query_battery);
+    RUN_TEST(test_callback_stop_and_end_bound);
+    RUN_TEST(test_sampled_query);
+    RUN_TEST(test_sampled_query_without_index);
+    RUN_TEST(test_query_segments_step);
+    return UNITY_END();
+}
@@ -0,0 +1,167 @@
+/**
+ * @file test_sd_ring.cpp
+ * @brief Tests host de l'anneau sans verrou du journal SD (bmu_sd_ring) — Unity.
+ *
+ * Couverture :
+ *   - Ordre FIFO, '\n' ajouté, tour complet de l'anneau
+ *   - Anneau plein : ligne abandonnée et comptée, reprise après drain
+ *   - Troncature à BMU_SD_LINE_MAX, drain borné par la place disponible
+ *   - 4 producteurs concurrents, 1 consommateur : aucune perte ni doublon
+ *   - Flotte 32 batteries à 5 Hz, carte qui se fige 2 s : aucune perte
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "bmu_sd_ring.h"
+
+static bmu_sd_slot_t s_slots[2048];
+static bmu_sd_ring_t s_r;
+static char s_out[65536];
+
+void setUp(void)
+{
+    TEST_ASSERT_TRUE(bmu_sd_ring_init(&s_r, s_slots, 8));
+}
+void tearDown(void) {}
+
+static bool push(const char *s)
+{
+    return bmu_sd_ring_push(&s_r, s, strlen(s));
+}
+
+void test_fifo_and_wrap(void)
+{
+    TEST_ASSERT_FALSE(bmu_sd_ring_init(&s_r, s_slots, 1));
+    TEST_ASSERT_TRUE(bmu_sd_ring_init(&s_r, s_slots, 12));   /* arrondi à 8 */
+    TEST_ASSERT_EQUAL_UINT32(7, s_r.mask);
+
+    for (int round = 0; round < 5; round++) {
+        TEST_ASSERT_TRUE(push("a,1"));
+        TEST_ASSERT_TRUE(push("bb,22"));
+        TEST_ASSERT_EQUAL_UINT32(2, bmu_sd_ring_pending(&s_r));
+        size_t n = bmu_sd_ring_drain(&s_r, s_out, sizeof(s_out));
+        TEST_ASSERT_EQUAL(10, (int)n);
+        TEST_ASSERT_EQUAL_MEMORY("a,1\nbb,22\n", s_out, n);
+    }
+    TEST_ASSERT_EQUAL(0, (int)bmu_sd_ring_drain(&s_r, s_out, sizeof(s_out)));
+}
+
+void test_full_drops_and_recovers(void)
+{
+    char line[16];
+    for (int i = 0; i < 8; i++) {
+        snprintf(line, sizeof(line), "%d", i);
+        TEST_ASSERT_TRUE(push(line));
+    }
+    TEST_ASSERT_FALSE(push("x"));
+    TEST_ASSERT_FALSE(push("y"));
+    TEST_ASSERT_EQUAL_UINT32(2, bmu_sd_ring_dropped(&s_r));
+
+    size_t n = bmu_sd_ring_drain(&s_r, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL_MEMORY("0\n1\n2\n3\n4\n5\n6\n7\n", s_out, n);
+    TEST_ASSERT_TRUE(push("z"));
+    n = bmu_sd_ring_drain(&s_r, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL_MEMORY("z\n", s_out, n);
+}
+
+void test_truncate_and_bounded_drain(void)
+{
+    char big[300];
+    memset(big, 'x', sizeof(big));
+    TEST_ASSERT_TRUE(bmu_sd_ring_push(&s_r, big, sizeof(big)));
+    TEST_ASSERT_EQUAL_UINT32(1, s_r.truncated);
+    TEST_ASSERT_TRUE(push("abc"));
+
+    /* 100 octets : la ligne tronquée (BMU_SD_LINE_MAX) ne tient pas */
+    TEST_ASSERT_EQUAL(0, (int)bmu_sd_ring_drain(&s_r, s_out, 100));
+    size_t n = bmu_sd_ring_drain(&s_r, s_out, BMU_SD_LINE_MAX + 2);
+    TEST_ASSERT_EQUAL(BMU_SD_LINE_MAX, (int)n);
+    TEST_ASSERT_EQUAL('\n', s_out[n - 1]);
+    n = bmu_sd_ring_drain(&s_r, s_out, sizeof(s_out));
+    TEST_ASSERT_EQUAL_MEMORY("abc\n", s_out, n);
+}
+
+void test_concurrent_producers(void)
+{
+    TEST_ASSERT_TRUE(bmu_sd_ring_init(&s_r, s_slots, 64));
+    const int NP = 4, PER = 20000;
+    std::atomic<int> done{0};
+    std::vector<std::thread> th;
+    for (int p = 0; p < NP; p++) {
+        th.emplace_back([p, &done]() {
+            char line[32];
+            for (int k = 0; k < PER; k++) {
+                int len = snprintf(line, sizeof(line), "%d,%d", p, k);
+                while (!bmu_sd_ring_push(&s_r, line, (size_t)len)) std::this_thread::yield();
+            }
+            done++;
+        });
+    }
+
+    std::vector<int> next(NP, 0);
+    int total = 0;
+    bool order_ok = true;
+    while (done.load() < NP || bmu_sd_ring_pending(&s_r) > 0) {
+        size_t n = bmu_sd_ring_drain(&s_r, s_out, 4096);
+        for (size_t i = 0; i < n;) {
+            int p = atoi(s_out + i);
+            const char *comma = (const char *)memchr(s_out + i, ',', n - i);
+            int k = atoi(comma + 1);
+            if (k != next[p]) order_ok = false;   /* FIFO par producteur */
+            next[p] = k + 1;
+            total++;
+            i = (size_t)((const char *)memchr(s_out + i, '\n', n - i) - s_out) + 1;
+        }
+        if (n == 0) std::this_thread::yield();
+    }
+    for (auto &t : th) t.join();
+    TEST_ASSERT_TRUE(order_ok);
+    TEST_ASSERT_EQUAL(NP * PER, total);
+}
+
+void test_fleet_5hz_with_card_stall(void)
+{
+    /* Temps simulé par pas de 200 ms : 32 lignes par snapshot. Le writer
+     * draine toutes les 200 ms sauf pendant une pause de 2 s toutes les
+     * 30 s (allocation FAT, GC interne de la carte). */
+    TEST_ASSERT_TRUE(bmu_sd_ring_init(&s_r, s_slots, 2048));
+    char line[96];
+    size_t bytes = 0;
+    uint32_t max_pending = 0;
+    for (int t_ms = 0; t_ms < 600000; t_ms += 200) {
+        for (int b = 0; b < 32; b++) {
+            snprintf(line, sizeof(line), "1792345678901,%d,%d,26%03d,%d,1,12,100",
+                     t_ms, b + 1, b * 7, -1500 + b * 100);
+            bmu_sd_ring_push(&s_r, line, strlen(line));
+        }
+        if (bmu_sd_ring_pending(&s_r) > max_pending) max_pending = bmu_sd_ring_pending(&s_r);
+        bool stalled = (t_ms % 30000) < 2000;
+        if (!stalled) {
+            size_t n;
+            while ((n = bmu_sd_ring_drain(&s_r, s_out, 16384)) > 0) bytes += n;
+        }
+    }
+    printf("10 min : %u octets (%.1f KB/s), pic %lu lignes en RAM, %lu perdues\n",
+           (unsigned)bytes, bytes / 600.0 / 1024.0, (unsigned long)max_pending,
+           (unsigned long)bmu_sd_ring_dropped(&s_r));
+    TEST_ASSERT_EQUAL_UINT32(0, bmu_sd_ring_dropped(&s_r));
+    TEST_ASSERT_TRUE(max_pending <= 2048);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_and_wrap);
+    RUN_TEST(test_full_drops_and_recovers);
+    RUN_TEST(test_truncate_and_bounded_drain);
+    RUN_TEST(test_concurrent_producers);
+    RUN_TEST(test_fleet_5hz_with_card_stall);
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+/**
+ * @file test_soc_ekf.cpp
+ * @brief Tests host de l'EKF état de charge (bmu_soc_ekf.h) — Unity.
+ *
+ * Couverture :
+ *   - Table OCV : interpolation, inversion, pente
+ *   - Initialisation depuis l'OCV compensée I·R0
+ *   - Prédiction seule (coulomb counting) et croissance de la variance
+ *   - Convergence depuis un SOC initial faux (repos)
+ *   - Suivi en décharge avec erreur de capacité et chute ohmique
+ *   - Bornes 0..1
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include "bmu_soc_ekf.h"
+
+static const bmu_soc_ocv_table_t OCV_NMC = BMU_SOC_OCV_NMC;
+static const uint32_t PERIOD_MS = 200;              /* protection 5 Hz */
+
+static bmu_soc_ekf_params_t s_prm;
+
+void setUp(void)
+{
+    s_prm.ocv            = &OCV_NMC;
+    s_prm.cells_series   = 7;
+    s_prm.capacity_ah    = 20.0f;
+    s_prm.r0_mohm        = 50.0f;
+    s_prm.q_per_s        = 1e-8f;
+    s_prm.r_load_mv2     = 150.0f * 150.0f;
+    s_prm.r_rest_mv2     = 30.0f * 30.0f;
+    s_prm.rest_current_a = 0.2f;
+}
+void tearDown(void) {}
+
+void test_ocv_roundtrip(void) {
+    for (int k = 0; k <= 20; k++) {
+        float soc = (float)k / 20.0f;
+        float v = bmu_soc_ocv_mv(&s_prm, soc);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, soc, bmu_soc_from_ocv(&s_prm, v));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 7 * 4190.0f, bmu_soc_ocv_mv(&s_prm, 1.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, bmu_soc_from_ocv(&s_prm, 10000.0f));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, bmu_soc_from_ocv(&s_prm, 40000.0f));
+}
+
+void test_ocv_slope_positive(void) {
+    for (int k = 0; k <= 10; k++) {
+        TEST_ASSERT_TRUE(bmu_soc_ocv_slope(&s_prm, (float)k / 10.0f) > 0.0f);
+    }
+    /* Segment 50-60 % : (3800-3720) mV × 10 × 7 cellules */
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 80.0f * 10.0f * 7.0f, bmu_soc_ocv_slope(&s_prm, 0.55f));
+}
+
+void test_init_compensates_ir_drop(void) {
+    bmu_soc_ekf_t e = {};
+    float ocv = bmu_soc_ocv_mv(&s_prm, 0.6f);
+    /* Décharge 10 A : V aux bornes = OCV - 10 A × 50 mΩ */
+    bmu_soc_ekf_step(&e, &s_prm, ocv - 500.0f, 10.0f, 1000, true);
+    TEST_ASSERT_TRUE(e.initialized);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.6f, e.soc);
+}
+
+void test_no_init_without_measurement(void) {
+    bmu_soc_ekf_t e = {};
+    bmu_soc_ekf_step(&e, &s_prm, 0.0f, 0.0f, 1000, false);
+    TEST_ASSERT_FALSE(e.initialized);
+}
+
+void test_prediction_only_is_coulomb_counting(void) {
+    bmu_soc_ekf_t e = {};
+    e.soc = 0.9f; e.p = 1e-4f; e.initialized = true; e.last_ms = 0;
+    uint32_t t = 0;
+    for (int k = 0; k < 5 * 3600; k++) {                /* 1 h à 10 A sur 20 Ah */
+        t += PERIOD_MS;
+        bmu_soc_ekf_step(&e, &s_prm, 0.0f, 10.0f, t, false);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.002f, 0.4f, e.soc);
+    TEST_ASSERT_TRUE(e.p > 1e-4f);
+}
+
+void test_converges_at_rest_from_wrong_init(void) {
+    bmu_soc_ekf_t e = {};
+    e.soc = 0.9f; e.p = 0.04f; e.initialized = true; e.last_ms = 0;
+    float v = bmu_soc_ocv_mv(&s_prm, 0.5f);
+    uint32_t t = 0;
+    for (int k = 0; k < 50; k++) {                      /* 10 s de repos */
+        t += PERIOD_MS;
+        bmu_soc_ekf_step(&e, &s_prm, v, 0.0f, t, true);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.5f, e.soc);
+    TEST_ASSERT_TRUE(e.p < 1e-3f);
+}
+
+void test_tracks_discharge_with_capacity_error(void) {
+    /* Vérité : 20 Ah ; filtre : capacité sous-estimée de 10 % */
+    s_prm.capacity_ah = 18.0f;
+    bmu_soc_ekf_t e = {};
+    float truth = 0.95f;
+    uint32_t t = 0;
+    bmu_soc_ekf_step(&e, &s_prm, bmu_soc_ocv_mv(&s_prm, truth), 0.0f, t, true);
+    for (int k = 0; k < 5 * 3600; k++) {                /* 1 h à 15 A */
+        t += PERIOD_MS;
+        truth -= 15.0f * 0.2f / (3600.0f * 20.0f);
+        float v = bmu_soc_ocv_mv(&s_prm, truth) - 15.0f * s_prm.r0_mohm;
+        bmu_soc_ekf_step(&e, &s_prm, v, 15.0f, t, true);
+    }
+    /* Coulomb counting seul donnerait 0.95 - 15/18 = 0.117 (erreur 8 %) */
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, truth, e.soc);
+}
+
+void test_clamped_to_unit_range(void) {
+    bmu_soc_ekf_t e = {};
+    e.soc = 0.01f; e.p = 1e-4f; e.initialized = true; e.last_ms = 0;
+    bmu_soc_ekf_step(&e, &s_prm, 0.0f, 100.0f, 60000, false);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, e.soc);
+    e.soc = 0.99f;
+    bmu_soc_ekf_step(&e, &s_prm, 0.0f, -100.0f, 120000, false);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, e.soc);
+}
+
+void test_timestamp_wraparound(void) {
+    bmu_soc_ekf_t e = {};
+    e.soc = 0.5f; e.p = 1e-4f; e.initialized = true; e.last_ms = 0xFFFFFF00u;
+    /* uint32 ms : dt = 0x100 + 0x100 = 512 ms malgré le débordement */
+    bmu_soc_ekf_step(&e, &s_prm, 0.0f, 20.0f, 0x100u, false);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f - 20.0f * 0.512f / (3600.0f * 20.0f), e.soc);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ocv_roundtrip);
+    RUN_TEST(test_ocv_slope_positive);
+    RUN_TEST(test_init_compensates_ir_drop);
+    RUN_TEST(test_no_init_without_measurement);
+    RUN_TEST(test_prediction_only_is_coulomb_counting);
+    RUN_TEST(test_converges_at_rest_from_wrong_init);
+    RUN_TEST(test_tracks_discharge_with_capacity_error);
+    RUN_TEST(test_clamped_to_unit_range);
+    RUN_TEST(test_timestamp_wraparound);
+    return UNITY_END();
+}
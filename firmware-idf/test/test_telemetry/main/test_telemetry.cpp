@@ -0,0 +1,106 @@
+/**
+ * @file test_telemetry.cpp
+ * @brief Tests host des agrégats de la trame télémétrie (bmu_telemetry_frame) — Unity.
+ *
+ * Couverture :
+ *   - Min / max / moyenne / courant total sur les batteries valides
+ *   - Exclusion V ≤ 1 V et NAN (même règle que bmu_battery_manager_get_summary)
+ *   - Comptage CONNECTED, cumul Ah décharge sur toutes les batteries
+ *   - Flotte vide, nb_batteries hors borne
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cmath>
+#include <cstring>
+#include "bmu_telemetry_frame.h"
+
+static bmu_telem_frame_t s_f;
+
+void setUp(void)
+{
+    memset(&s_f, 0, sizeof(s_f));
+}
+void tearDown(void) {}
+
+static void set_batt(int i, float v_mv, float i_a, bmu_battery_state_t st, float ah_d)
+{
+    s_f.batt[i].voltage_mv = v_mv;
+    s_f.batt[i].current_a = i_a;
+    s_f.batt[i].state = (uint8_t)st;
+    s_f.batt[i].ah_discharge = ah_d;
+}
+
+void test_aggregates_over_valid_batteries(void)
+{
+    s_f.nb_batteries = 3;
+    set_batt(0, 26000.0f, 1.5f, BMU_STATE_CONNECTED, 2.0f);
+    set_batt(1, 25800.0f, -0.5f, BMU_STATE_CONNECTED, 1.0f);
+    set_batt(2, 26300.0f, 0.0f, BMU_STATE_DISCONNECTED, 0.5f);
+    bmu_telem_frame_aggregate(&s_f);
+
+    TEST_ASSERT_EQUAL(3, s_f.n_valid);
+    TEST_ASSERT_EQUAL(2, s_f.n_connected);
+    TEST_ASSERT_EQUAL_FLOAT(25800.0f, s_f.v_min_mv);
+    TEST_ASSERT_EQUAL_FLOAT(26300.0f, s_f.v_max_mv);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 26033.33f, s_f.v_avg_mv);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, s_f.i_total_a);
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, s_f.ah_discharge_total);
+}
+
+void test_invalid_voltages_excluded(void)
+{
+    s_f.nb_batteries = 4;
+    set_batt(0, 26000.0f, 2.0f, BMU_STATE_CONNECTED, 1.0f);
+    set_batt(1, 1000.0f, 5.0f, BMU_STATE_ERROR, 1.0f);         /* ≤ 1 V */
+    set_batt(2, NAN, 5.0f, BMU_STATE_ERROR, 1.0f);
+    set_batt(3, 25000.0f, NAN, BMU_STATE_CONNECTED, 1.0f);
+    bmu_telem_frame_aggregate(&s_f);
+
+    TEST_ASSERT_EQUAL(1, s_f.n_valid);
+    TEST_ASSERT_EQUAL(2, s_f.n_connected);
+    TEST_ASSERT_EQUAL_FLOAT(26000.0f, s_f.v_min_mv);
+    TEST_ASSERT_EQUAL_FLOAT(26000.0f, s_f.v_avg_mv);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, s_f.i_total_a);
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, s_f.ah_discharge_total);  /* Ah : toutes */
+}
+
+void test_empty_and_out_of_range(void)
+{
+    bmu_telem_frame_aggregate(&s_f);
+    TEST_ASSERT_EQUAL(0, s_f.n_valid);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, s_f.v_min_mv);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, s_f.v_avg_mv);
+
+    /* nb_batteries corrompu : borné à BMU_MAX_BATTERIES */
+    s_f.nb_batteries = 255;
+    for (int i = 0; i < BMU_MAX_BATTERIES; i++) set_batt(i, 26000.0f, 0.1f, BMU_STATE_CONNECTED, 0.0f);
+    bmu_telem_frame_aggregate(&s_f);
+    TEST_ASSERT_EQUAL(BMU_MAX_BATTERIES, s_f.n_valid);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.1f * BMU_MAX_BATTERIES, s_f.i_total_a);
+}
+
+void test_reaggregate_resets(void)
+{
+    s_f.nb_batteries = 2;
+    set_batt(0, 26000.0f, 1.0f, BMU_STATE_CONNECTED, 0.0f);
+    set_batt(1, 27000.0f, 1.0f, BMU_STATE_CONNECTED, 0.0f);
+    bmu_telem_frame_aggregate(&s_f);
+    s_f.nb_batteries = 1;                              /* hotplug : une batterie retirée */
+    bmu_telem_frame_aggregate(&s_f);
+    TEST_ASSERT_EQUAL(1, s_f.n_valid);
+    TEST_ASSERT_EQUAL(1, s_f.n_connected);
+    TEST_ASSERT_EQUAL_FLOAT(26000.0f, s_f.v_max_mv);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, s_f.i_total_a);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_aggregates_over_valid_batteries);
+    RUN_TEST(test_invalid_voltages_excluded);
+    RUN_TEST(test_empty_and_out_of_range);
+    RUN_TEST(test_reaggregate_resets);
+    return UNITY_END();
+}
@@ -4,10 +4,13 @@ extern "C" void setUp(void) {}
 extern "C" void tearDown(void) {}
 
 #include "unity.h"
+#include "bmu_vedirect_parser.h"
+#include <chrono>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
 #include <cstdint>
+#include <string>
 
 typedef struct {
     float    battery_voltage_v;
@@ -115,6 +118,363 @@ void test_checksum_invalid(void) {
     TEST_ASSERT_FALSE(validate_checksum(frame, 6));
 }
 
+/* ── bmu_vedirect_parser : TEXT par blocs + HEX ─────────────────────── */
+
+struct capture_t {
+    bmu_vedirect_data_t    last;
+    bmu_vedirect_hex_msg_t hex;
+    int frames;
+    int hexes;
+};
+
+static void cap_frame(const bmu_vedirect_data_t *f, void *arg)
+{
+    capture_t *c = (capture_t *)arg;
+    c->last = *f;
+    c->frames++;
+}
+
+static void cap_hex(const bmu_vedirect_hex_msg_t *m, void *arg)
+{
+    capture_t *c = (capture_t *)arg;
+    c->hex = *m;
+    c->hexes++;
+}
+
+/* Trame MPPT complete, octet de checksum calcule pour une somme nulle */
+static std::string make_frame(int v_mv, int i_ma)
+{
+    char body[256];
+    snprintf(body, sizeof(body),
+             "\r\nPID\t0xA053\r\nFW\t159\r\nSER#\tHQ2132ABCDE\r\nV\t%d\r\nI\t%d\r\n"
+             "VPV\t45200\r\nPPV\t340\r\nCS\t5\r\nMPPT\t2\r\nOR\t0x00000000\r\nERR\t0\r\n"
+             "LOAD\tON\r\nIL\t0\r\nH19\t10344\r\nH20\t125\r\nH21\t410\r\nH22\t98\r\n"
+             "H23\t390\r\nHSDS\t231\r\nChecksum\t", v_mv, i_ma);
+    std::string f(body);
+    uint8_t sum = 0;
+    for (unsigned char c : f) sum += c;
+    f.push_back((char)(uint8_t)(0 - sum));
+    return f;
+}
+
+static void feed_str(bmu_vedirect_parser_t *p, const std::string &s)
+{
+    bmu_vedirect_parser_feed(p, (const uint8_t *)s.data(), s.size());
+}
+
+void test_parser_full_frame(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, cap_frame, cap_hex, &c);
+    feed_str(&p, make_frame(27140, -500));
+    TEST_ASSERT_EQUAL_INT(1, c.frames);
+    TEST_ASSERT_TRUE(c.last.valid);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 27.14f, c.last.battery_voltage_v);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -0.5f, c.last.battery_current_a);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 45.2f, c.last.panel_voltage_v);
+    TEST_ASSERT_EQUAL_UINT16(340, c.last.panel_power_w);
+    TEST_ASSERT_EQUAL_UINT8(5, c.last.charge_state);
+    TEST_ASSERT_EQUAL_UINT8(2, c.last.mppt_state);
+    TEST_ASSERT_EQUAL_UINT32(103440, c.last.yield_total_wh);
+    TEST_ASSERT_EQUAL_UINT32(1250, c.last.yield_today_wh);
+    TEST_ASSERT_EQUAL_UINT16(410, c.last.max_power_today_w);
+    TEST_ASSERT_EQUAL_STRING("0xA053", c.last.product_id);
+    TEST_ASSERT_EQUAL_STRING("HQ2132ABCDE", c.last.serial);
+    TEST_ASSERT_EQUAL_STRING("159", c.last.firmware);
+    TEST_ASSERT_TRUE(c.last.load_on);
+    TEST_ASSERT_EQUAL_UINT32(1, p.stats.frames_ok);
+    TEST_ASSERT_EQUAL_UINT32(0, p.stats.frames_bad);
+}
+
+/* Lecture UART par blocs : le resultat ne depend pas du decoupage */
+void test_parser_block_split(void) {
+    std::string f = make_frame(26500, 1200);
+    for (size_t chunk = 1; chunk <= f.size(); chunk++) {
+        capture_t c = {};
+        bmu_vedirect_parser_t p;
+        bmu_vedirect_parser_init(&p, cap_frame, nullptr, &c);
+        for (size_t off = 0; off < f.size(); off += chunk) {
+            size_t n = f.size() - off < chunk ? f.size() - off : chunk;
+            bmu_vedirect_parser_feed(&p, (const uint8_t *)f.data() + off, n);
+        }
+        TEST_ASSERT_EQUAL_INT(1, c.frames);
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, 26.5f, c.last.battery_voltage_v);
+    }
+}
+
+void test_parser_bad_checksum(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, cap_frame, nullptr, &c);
+    std::string f = make_frame(27000, 0);
+    f[f.size() - 1] = (char)(f[f.size() - 1] + 1);
+    feed_str(&p, f);
+    TEST_ASSERT_EQUAL_INT(0, c.frames);
+    TEST_ASSERT_EQUAL_UINT32(1, p.stats.frames_bad);
+
+    /* Trame suivante correcte : resynchronise, rien ne fuit de la precedente */
+    feed_str(&p, make_frame(25000, 0));
+    TEST_ASSERT_EQUAL_INT(1, c.frames);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.0f, c.last.battery_voltage_v);
+}
+
+void test_parser_unknown_and_long_labels(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, cap_frame, nullptr, &c);
+    std::string f = "\r\nAR\t0\r\nVV\t1\r\nVERYLONGLABELNAME_OVERFLOW\t12\r\n"
+                    "V\t12800\r\nI\t99999999999999999999\r\nChecksum\t";
+    uint8_t sum = 0;
+    for (unsigned char ch : f) sum += ch;
+    f.push_back((char)(uint8_t)(0 - sum));
+    feed_str(&p, f);
+    TEST_ASSERT_EQUAL_INT(1, c.frames);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.8f, c.last.battery_voltage_v);
+    TEST_ASSERT_EQUAL_UINT16(0, c.last.panel_power_w);
+}
+
+void test_hex_encode_get(void) {
+    char out[32];
+    size_t n = bmu_vedirect_hex_encode_get(0xEDF0, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING(":7F0ED0071\n", out);
+    TEST_ASSERT_EQUAL_size_t(11, n);
+
+    n = bmu_vedirect_hex_encode(BMU_VEDIRECT_HEX_PING, nullptr, 0, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING(":154\n", out);
+    TEST_ASSERT_EQUAL_size_t(0, bmu_vedirect_hex_encode_get(0xEDF0, out, 11));
+    TEST_ASSERT_EQUAL_size_t(0, bmu_vedirect_hex_encode_set(0xEDF0, 1, 5, out, sizeof(out)));
+}
+
+void test_hex_roundtrip_set(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, nullptr, cap_hex, &c);
+    char out[32];
+    size_t n = bmu_vedirect_hex_encode_set(0xEDF0, 0x1234, 2, out, sizeof(out));
+    TEST_ASSERT_TRUE(n > 0);
+    bmu_vedirect_parser_feed(&p, (const uint8_t *)out, n);
+    TEST_ASSERT_EQUAL_INT(1, c.hexes);
+    TEST_ASSERT_EQUAL_UINT8(BMU_VEDIRECT_HEX_SET, c.hex.cmd);
+    TEST_ASSERT_EQUAL_HEX16(0xEDF0, c.hex.reg);
+    TEST_ASSERT_EQUAL_UINT8(0, c.hex.flags);
+    TEST_ASSERT_EQUAL_HEX32(0x1234, c.hex.value);
+    TEST_ASSERT_EQUAL_UINT8(2, c.hex.value_len);
+}
+
+/* Message ASYNC au milieu d'une ligne TEXT : ni la trame ni sa somme ne
+ * sont affectees (comportement de la reference Victron) */
+void test_hex_interleaved_in_text(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, cap_frame, cap_hex, &c);
+    const uint8_t d[5] = { 0xD5, 0xED, 0x00, 0x10, 0x0A };   /* 0xEDD5 = 2576 */
+    char hex[32];
+    size_t n = bmu_vedirect_hex_encode(BMU_VEDIRECT_HEX_ASYNC, d, sizeof(d), hex, sizeof(hex));
+    std::string f = make_frame(27140, 300);
+    size_t at = f.find("VPV\t") + 2;
+    f.insert(at, std::string(hex, n));
+    feed_str(&p, f);
+    TEST_ASSERT_EQUAL_INT(1, c.hexes);
+    TEST_ASSERT_EQUAL_HEX16(0xEDD5, c.hex.reg);
+    TEST_ASSERT_EQUAL_UINT32(2576, c.hex.value);
+    TEST_ASSERT_EQUAL_INT(1, c.frames);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 45.2f, c.last.panel_voltage_v);
+}
+
+void test_hex_bad_messages(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, nullptr, cap_hex, &c);
+    const char *bad[] = {
+        ":7F0ED0072\n",          /* somme != 0x55 */
+        ":7F0ED007\n",           /* nombre impair de chiffres */
+        ":7F0EG0071\n",          /* chiffre invalide */
+        ":\n",
+    };
+    for (const char *b : bad) {
+        bmu_vedirect_parser_feed(&p, (const uint8_t *)b, strlen(b));
+    }
+    std::string lng = ":7" + std::string(200, '0') + "\n";
+    feed_str(&p, lng);
+    TEST_ASSERT_EQUAL_INT(0, c.hexes);
+    TEST_ASSERT_EQUAL_UINT32(5, p.stats.hex_bad);
+
+    /* Minuscules acceptees en reception */
+    const char *ok = ":7f0ed0071\r\n";
+    bmu_vedirect_parser_feed(&p, (const uint8_t *)ok, strlen(ok));
+    TEST_ASSERT_EQUAL_INT(1, c.hexes);
+}
+
+/* Generateur deterministe (LCG) : fuzz reproductible */
+static uint32_t s_rng = 0x12345678;
+static uint32_t rng(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return s_rng >> 8;
+}
+
+/* Octets aleatoires puis trames mutees : pas de plantage (ASan/UBSan via
+ * le Makefile), compteurs coherents, resynchronisation apres le bruit */
+void test_fuzz_random_and_mutated(void) {
+    capture_t c = {};
+    bmu_vedirect_parser_t p;
+    bmu_vedirect_parser_init(&p, cap_frame, cap_hex, &c);
+
+    static uint8_t noise[4096];
+    for (int round = 0; round < 200; round++) {
+        for (auto &b : noise) {
+            /* Alphabet biaise vers les delimiteurs du protocole */
+            uint32_t r = rng();
+            static const char delim[] = "\t\r\n:C";
+            b = (r & 3) == 0 ? (uint8_t)delim[(r >> 2) % 5] : (uint8_t)(r >> 4);
+        }
+        bmu_vedirect_parser_feed(&p, noise, 1 + rng() % sizeof(noise));
+    }
+
+    std::string ref = make_frame(27140, 300);
+    for (int round = 0; round < 2000; round++) {
+        std::string f = ref;
+        int flips = 1 + (int)(rng() % 4);
+        for (int k = 0; k < flips; k++) {
+            size_t at = rng() % f.size();
+            switch (rng() % 3) {
+            case 0: f[at] = (char)rng(); break;
+            case 1: f.erase(at, 1); break;
+            default: f.insert(at, 1, (char)rng()); break;
+            }
+        }
+        feed_str(&p, f);
+    }
+    TEST_ASSERT_TRUE(p.state <= 4);
+    TEST_ASSERT_TRUE(p.label_len <= sizeof(p.label));
+    TEST_ASSERT_TRUE(p.value_len < sizeof(p.value));
+    TEST_ASSERT_TRUE(p.hex_len <= sizeof(p.hex));
+
+    /* Apres le bruit : une ligne vide puis deux trames propres sont decodees.
+     * La premiere peut etre perdue si le bruit a laisse un ':' ouvert. */
+    bmu_vedirect_parser_reset(&p);
+    int before = c.frames;
+    feed_str(&p, ref);
+    feed_str(&p, make_frame(25000, 0));
+    TEST_ASSERT_EQUAL_INT(before + 2, c.frames);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.0f, c.last.battery_voltage_v);
+    TEST_ASSERT_EQUAL_UINT32(c.frames, p.stats.frames_ok);
+}
+
+/* ── Benchmark : parser par blocs vs machine d'etat historique ─────── */
+
+/* Copie de l'ancienne boucle de vedirect_task (octet par octet, chaine de
+ * strcmp + atoi) */
+struct legacy_t {
+    bmu_vedirect_data_t staging;
+    char label[16], value[32];
+    uint8_t li, vi, checksum, state;
+    int frames;
+};
+
+static void legacy_copy(char *dst, size_t cap, const char *src)
+{
+    size_t n = strnlen(src, cap - 1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+static void legacy_field(const char *label, const char *value, bmu_vedirect_data_t *f)
+{
+    if (strcmp(label, "V") == 0) f->battery_voltage_v = atoi(value) / 1000.0f;
+    else if (strcmp(label, "I") == 0) f->battery_current_a = atoi(value) / 1000.0f;
+    else if (strcmp(label, "VPV") == 0) f->panel_voltage_v = atoi(value) / 1000.0f;
+    else if (strcmp(label, "PPV") == 0) f->panel_power_w = (uint16_t)atoi(value);
+    else if (strcmp(label, "CS") == 0) f->charge_state = (uint8_t)atoi(value);
+    else if (strcmp(label, "MPPT") == 0) f->mppt_state = (uint8_t)atoi(value);
+    else if (strcmp(label, "ERR") == 0) f->error_code = (uint8_t)atoi(value);
+    else if (strcmp(label, "H19") == 0) f->yield_total_wh = (uint32_t)(atoi(value) * 10);
+    else if (strcmp(label, "H20") == 0) f->yield_today_wh = (uint32_t)(atoi(value) * 10);
+    else if (strcmp(label, "H21") == 0) f->max_power_today_w = (uint16_t)atoi(value);
+    else if (strcmp(label, "PID") == 0) legacy_copy(f->product_id, sizeof(f->product_id), value);
+    else if (strcmp(label, "SER#") == 0) legacy_copy(f->serial, sizeof(f->serial), value);
+    else if (strcmp(label, "FW") == 0) legacy_copy(f->firmware, sizeof(f->firmware), value);
+    else if (strcmp(label, "LOAD") == 0) f->load_on = strcmp(value, "ON") == 0;
+}
+
+static void legacy_byte(legacy_t *l, uint8_t b)
+{
+    l->checksum += b;
+    switch (l->state) {
+    case 0:
+        if (b != '\r' && b != '\n') { l->li = 0; l->label[l->li++] = (char)b; l->state = 1; }
+        break;
+    case 1:
+        if (b == '\t') {
+            l->label[l->li] = '\0';
+            l->vi = 0;
+            l->state = strcmp(l->label, "Checksum") == 0 ? 3 : 2;
+        } else if (l->li < 15) {
+            l->label[l->li++] = (char)b;
+        }
+        break;
+    case 2:
+        if (b == '\r' || b == '\n') {
+            l->value[l->vi] = '\0';
+            legacy_field(l->label, l->value, &l->staging);
+            l->state = 0;
+        } else if (l->vi < 31) {
+            l->value[l->vi++] = (char)b;
+        }
+        break;
+    case 3:
+        if (l->checksum == 0) l->frames++;
+        memset(&l->staging, 0, sizeof(l->staging));
+        l->checksum = 0;
+        l->state = 0;
+        break;
+    }
+}
+
+void test_benchmark_throughput(void) {
+    std::string stream;
+    for (int i = 0; i < 64; i++) stream += make_frame(25000 + i * 37, -3000 + i * 101);
+    const int reps = 400;
+    const double mb = (double)stream.size() * reps / 1e6;
+    const uint8_t *data = (const uint8_t *)stream.data();
+
+    /* Meilleur de 5 passes alternees : la machine de test est bruitee. Sous
+     * ASan/UBSan (Makefile) seul le rapport compte. Sur cible le gain vient
+     * surtout de la lecture UART par blocs, hors de ce banc. */
+    double s_old = 1e9, s_new = 1e9;
+    int frames_old = 0, frames_new = 0;
+    for (int pass = 0; pass < 5; pass++) {
+        legacy_t l = {};
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            for (size_t i = 0; i < stream.size(); i++) legacy_byte(&l, data[i]);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        capture_t c = {};
+        bmu_vedirect_parser_t p;
+        bmu_vedirect_parser_init(&p, cap_frame, cap_hex, &c);
+        for (int r = 0; r < reps; r++) {
+            for (size_t off = 0; off < stream.size(); off += 128) {
+                size_t n = stream.size() - off < 128 ? stream.size() - off : 128;
+                bmu_vedirect_parser_feed(&p, data + off, n);
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double d_old = std::chrono::duration<double>(t1 - t0).count();
+        double d_new = std::chrono::duration<double>(t2 - t1).count();
+        if (d_old < s_old) s_old = d_old;
+        if (d_new < s_new) s_new = d_new;
+        frames_old = l.frames;
+        frames_new = c.frames;
+    }
+    printf("VE.Direct %.1f Mo : historique %.1f Mo/s, bmu_vedirect_parser %.1f Mo/s (x%.1f)\n",
+           mb, mb / s_old, mb / s_new, s_old / s_new);
+    TEST_ASSERT_EQUAL_INT(64 * reps, frames_old);
+    TEST_ASSERT_EQUAL_INT(64 * reps, frames_new);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_parse_voltage);
@@ -127,6 +487,16 @@ int main(void) {
     RUN_TEST(test_parse_multi_field);
     RUN_TEST(test_checksum_valid);
     RUN_TEST(test_checksum_invalid);
+    RUN_TEST(test_parser_full_frame);
+    RUN_TEST(test_parser_block_split);
+    RUN_TEST(test_parser_bad_checksum);
+    RUN_TEST(test_parser_unknown_and_long_labels);
+    RUN_TEST(test_hex_encode_get);
+    RUN_TEST(test_hex_roundtrip_set);
+    RUN_TEST(test_hex_interleaved_in_text);
+    RUN_TEST(test_hex_bad_messages);
+    RUN_TEST(test_fuzz_random_and_mutated);
+    RUN_TEST(test_benchmark_throughput);
     return UNITY_END();
 }
 
@@ -0,0 +1,214 @@
+/**
+ * @file test_vedirect_solar.cpp
+ * @brief Tests host du modele solaire multi-chargeurs (bmu_vedirect_solar) — Unity.
+ *
+ * Couverture :
+ *   - Un chargeur : vue agregee identique a la trame
+ *   - Sommes PPV / I, moyenne V batterie, chargeur principal (VPV, PID, serie)
+ *   - Etat de charge le plus significatif, premier code d'erreur
+ *   - Chargeur perime : exclu des mesures instantanees, rendement conserve
+ *     jusqu'a BMU_VEDIRECT_DAILY_HOLD_MS, compteur a vie toujours
+ *   - Chargeur jamais vu : age -1, aucun chargeur en ligne → valid = false
+ *   - Borne du nombre de chargeurs et saturation PPV
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include "bmu_vedirect_solar.h"
+
+#define NOW_MS     100000
+#define STALE_MS   5000
+
+static bmu_vedirect_data_t ch[BMU_VEDIRECT_MAX_CHARGERS];
+static bmu_vedirect_solar_t sol;
+
+void setUp(void) { memset(ch, 0, sizeof(ch)); }
+void tearDown(void) {}
+
+/* Trame valide recue il y a age_ms */
+static void charger(int i, float v, float a, uint16_t ppv, uint8_t cs, int64_t age_ms)
+{
+    ch[i].battery_voltage_v = v;
+    ch[i].battery_current_a = a;
+    ch[i].panel_voltage_v   = 40.0f + (float)i;
+    ch[i].panel_power_w     = ppv;
+    ch[i].charge_state      = cs;
+    ch[i].mppt_state        = 2;
+    ch[i].yield_today_wh    = 1000u * (uint32_t)(i + 1);
+    ch[i].yield_total_wh    = 100000u;
+    ch[i].max_power_today_w = 300;
+    snprintf(ch[i].product_id, sizeof(ch[i].product_id), "0xA05%d", i);
+    snprintf(ch[i].serial, sizeof(ch[i].serial), "HQ%d", i);
+    ch[i].valid          = true;
+    ch[i].last_update_ms = NOW_MS - age_ms;
+}
+
+/* ── Agregation ──────────────────────────────────────────────────── */
+
+void test_single_charger_passthrough(void)
+{
+    charger(0, 26.5f, 12.0f, 340, 3, 200);
+    bmu_vedirect_solar_aggregate(ch, 1, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_TRUE(sol.total.valid);
+    TEST_ASSERT_EQUAL_UINT8(1, sol.n_online);
+    TEST_ASSERT_EQUAL_UINT8(0x01, sol.online_mask);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 26.5f, sol.total.battery_voltage_v);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.0f, sol.total.battery_current_a);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 40.0f, sol.total.panel_voltage_v);
+    TEST_ASSERT_EQUAL_UINT16(340, sol.total.panel_power_w);
+    TEST_ASSERT_EQUAL_UINT8(3, sol.total.charge_state);
+    TEST_ASSERT_EQUAL_UINT32(1000, sol.total.yield_today_wh);
+    TEST_ASSERT_EQUAL_STRING("0xA050", sol.total.product_id);
+    TEST_ASSERT_EQUAL_INT32(200, sol.age_ms[0]);
+    TEST_ASSERT_EQUAL_INT64(NOW_MS - 200, sol.total.last_update_ms);
+}
+
+void test_sums_and_primary(void)
+{
+    charger(0, 26.4f, 10.0f, 300, 5, 100);
+    charger(1, 26.6f, 15.0f, 450, 5, 300);
+    charger(2, 26.5f, 5.0f, 120, 5, 900);
+    bmu_vedirect_solar_aggregate(ch, 3, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT8(3, sol.n_chargers);
+    TEST_ASSERT_EQUAL_UINT8(3, sol.n_online);
+    TEST_ASSERT_EQUAL_UINT16(870, sol.total.panel_power_w);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 30.0f, sol.total.battery_current_a);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 26.5f, sol.total.battery_voltage_v);
+    TEST_ASSERT_EQUAL_UINT32(6000, sol.total.yield_today_wh);
+    TEST_ASSERT_EQUAL_UINT32(300000, sol.total.yield_total_wh);
+    TEST_ASSERT_EQUAL_UINT16(900, sol.total.max_power_today_w);
+
+    /* Principal = PPV maximale */
+    TEST_ASSERT_EQUAL_UINT8(1, sol.primary);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 41.0f, sol.total.panel_voltage_v);
+    TEST_ASSERT_EQUAL_STRING("0xA051", sol.total.product_id);
+    TEST_ASSERT_EQUAL_STRING("HQ1", sol.total.serial);
+    TEST_ASSERT_EQUAL_INT64(NOW_MS - 100, sol.total.last_update_ms);
+}
+
+void test_charge_state_and_error_priority(void)
+{
+    charger(0, 26.0f, 1.0f, 50, 5, 0);     /* Float */
+    charger(1, 26.0f, 1.0f, 50, 3, 0);     /* Bulk */
+    charger(2, 26.0f, 1.0f, 50, 4, 0);     /* Absorption */
+    bmu_vedirect_solar_aggregate(ch, 3, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT8(3, sol.total.charge_state);
+    TEST_ASSERT_EQUAL_UINT8(0, sol.total.error_code);
+
+    ch[2].charge_state = 2;                 /* Fault masque tout */
+    ch[2].error_code = 17;
+    ch[0].error_code = 0;
+    bmu_vedirect_solar_aggregate(ch, 3, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT8(2, sol.total.charge_state);
+    TEST_ASSERT_EQUAL_UINT8(17, sol.total.error_code);
+
+    TEST_ASSERT_TRUE(bmu_vedirect_cs_rank(3) > bmu_vedirect_cs_rank(5));
+    TEST_ASSERT_TRUE(bmu_vedirect_cs_rank(5) > bmu_vedirect_cs_rank(0));
+    TEST_ASSERT_EQUAL_UINT8(0, bmu_vedirect_cs_rank(99));
+}
+
+/* Premier chargeur en ligne a l'etat Off : l'etat reste celui du chargeur */
+void test_all_off_state(void)
+{
+    charger(0, 26.0f, 0.0f, 0, 0, 0);
+    charger(1, 26.0f, 0.0f, 0, 0, 0);
+    bmu_vedirect_solar_aggregate(ch, 2, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_TRUE(sol.total.valid);
+    TEST_ASSERT_EQUAL_UINT8(0, sol.total.charge_state);
+    TEST_ASSERT_EQUAL_UINT8(0, sol.primary);
+}
+
+/* ── Peremption ──────────────────────────────────────────────────── */
+
+void test_stale_charger_excluded_yield_kept(void)
+{
+    charger(0, 26.0f, 10.0f, 300, 3, 1000);
+    charger(1, 30.0f, 20.0f, 600, 3, STALE_MS);     /* perime (age = seuil) */
+    bmu_vedirect_solar_aggregate(ch, 2, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT8(1, sol.n_online);
+    TEST_ASSERT_EQUAL_UINT8(0x01, sol.online_mask);
+    TEST_ASSERT_EQUAL_UINT16(300, sol.total.panel_power_w);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 26.0f, sol.total.battery_voltage_v);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, sol.total.battery_current_a);
+    TEST_ASSERT_EQUAL_UINT8(0, sol.primary);
+    /* L'energie du jour du chargeur muet reste comptee */
+    TEST_ASSERT_EQUAL_UINT32(3000, sol.total.yield_today_wh);
+    TEST_ASSERT_EQUAL_INT32(STALE_MS, sol.age_ms[1]);
+}
+
+void test_stale_daily_fields_expire(void)
+{
+    /* Horloge a 20 h de fonctionnement : chargeur 1 muet depuis la veille */
+    const int64_t now = 20LL * 3600 * 1000;
+    charger(0, 26.0f, 10.0f, 300, 3, 0);
+    charger(1, 26.0f, 10.0f, 300, 3, 0);
+    ch[0].last_update_ms = now - 1000;
+    ch[1].last_update_ms = now - BMU_VEDIRECT_DAILY_HOLD_MS + 1;
+    bmu_vedirect_solar_aggregate(ch, 2, now, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT32(3000, sol.total.yield_today_wh);
+    TEST_ASSERT_EQUAL_UINT16(600, sol.total.max_power_today_w);
+
+    ch[1].last_update_ms = now - BMU_VEDIRECT_DAILY_HOLD_MS;
+    bmu_vedirect_solar_aggregate(ch, 2, now, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT32(1000, sol.total.yield_today_wh);
+    TEST_ASSERT_EQUAL_UINT16(300, sol.total.max_power_today_w);
+    /* Compteur a vie : toujours acquis */
+    TEST_ASSERT_EQUAL_UINT32(200000, sol.total.yield_total_wh);
+    TEST_ASSERT_EQUAL_UINT8(1, sol.n_online);
+}
+
+void test_never_seen_and_none_online(void)
+{
+    charger(1, 26.0f, 10.0f, 300, 3, 60000);
+    bmu_vedirect_solar_aggregate(ch, 3, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_FALSE(sol.total.valid);
+    TEST_ASSERT_EQUAL_UINT8(0, sol.n_online);
+    TEST_ASSERT_EQUAL_INT32(-1, sol.age_ms[0]);
+    TEST_ASSERT_EQUAL_INT32(60000, sol.age_ms[1]);
+    TEST_ASSERT_EQUAL_INT32(-1, sol.age_ms[2]);
+    TEST_ASSERT_EQUAL_UINT16(0, sol.total.panel_power_w);
+    TEST_ASSERT_EQUAL_UINT32(2000, sol.total.yield_today_wh);
+
+    /* Trame marquee invalide = jamais vue */
+    ch[1].valid = false;
+    bmu_vedirect_solar_aggregate(ch, 3, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_INT32(-1, sol.age_ms[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, sol.total.yield_today_wh);
+
+    bmu_vedirect_solar_aggregate(nullptr, 0, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT8(0, sol.n_chargers);
+    TEST_ASSERT_FALSE(sol.total.valid);
+}
+
+/* ── Bornes ──────────────────────────────────────────────────────── */
+
+void test_count_clamped_and_ppv_saturates(void)
+{
+    bmu_vedirect_data_t many[BMU_VEDIRECT_MAX_CHARGERS + 2] = {};
+    for (int i = 0; i < BMU_VEDIRECT_MAX_CHARGERS + 2; i++) {
+        many[i].valid = true;
+        many[i].last_update_ms = NOW_MS;
+        many[i].panel_power_w = 30000;
+    }
+    bmu_vedirect_solar_aggregate(many, BMU_VEDIRECT_MAX_CHARGERS + 2, NOW_MS, STALE_MS, &sol);
+    TEST_ASSERT_EQUAL_UINT8(BMU_VEDIRECT_MAX_CHARGERS, sol.n_chargers);
+    TEST_ASSERT_EQUAL_UINT8(BMU_VEDIRECT_MAX_CHARGERS, sol.n_online);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, sol.total.panel_power_w);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_charger_passthrough);
+    RUN_TEST(test_sums_and_primary);
+    RUN_TEST(test_charge_state_and_error_priority);
+    RUN_TEST(test_all_off_state);
+    RUN_TEST(test_stale_charger_excluded_yield_kept);
+    RUN_TEST(test_stale_daily_fields_expire);
+    RUN_TEST(test_never_seen_and_none_online);
+    RUN_TEST(test_count_clamped_and_ppv_saturates);
+    return UNITY_END();
+}
@@ -1,6 +1,23 @@
+/**
+ * @file test_victron_gatt.cpp
+ * @brief Tests host du service GATT SmartShunt (bmu_vic_shunt) — Unity.
+ *
+ * Couverture :
+ *   - Encodages unitaires (0.01 V, 0.01 %, 0.01 K, TTG en minutes)
+ *   - Modele depuis la trame : V, I (signe Victron), SOC flotte ou de repli
+ *   - Capacite x SOH, consomme, TTG fini / infini
+ *   - Alarmes V, temperature, etats ; capteur absent, flotte vide
+ *   - V et alarmes V sur les seules batteries connectees
+ *   - Masque de changement pour la coalescence des notifications
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
 #include "unity.h"
+#include <cmath>
 #include <cstring>
 #include <cstdint>
+#include "bmu_vic_shunt.h"
 
 void setUp(void) {}
 void tearDown(void) {}
@@ -80,6 +97,133 @@ void test_ttg_discharge(void)
     TEST_ASSERT_EQUAL_UINT16(600, ttg);
 }
 
+/* ── Modele SmartShunt (bmu_vic_shunt) ───────────────────────────── */
+
+static bmu_telem_frame_t s_f;
+static const bmu_vic_shunt_cfg_t CFG = { 24000, 30000, 20.0f };
+
+/* n batteries connectees a v_mv, courant i_a chacune (> 0 decharge) */
+static void fleet(int n, float v_mv, float i_a)
+{
+    memset(&s_f, 0, sizeof(s_f));
+    s_f.nb_batteries = (uint8_t)n;
+    for (int i = 0; i < n; i++) {
+        s_f.batt[i].voltage_mv   = v_mv;
+        s_f.batt[i].current_a    = i_a;
+        s_f.batt[i].ah_discharge = 1.5f;
+        s_f.batt[i].soh_percent  = NAN;
+        s_f.batt[i].state        = BMU_STATE_CONNECTED;
+    }
+    s_f.temp_c = NAN;
+    bmu_telem_frame_aggregate(&s_f);
+    s_f.soc_fleet = -1.0f;
+}
+
+void test_shunt_from_frame(void)
+{
+    fleet(4, 26000.0f, 2.5f);
+    s_f.soc_fleet = 50.0f;
+    s_f.temp_c = 25.0f;
+    bmu_vic_shunt_t v;
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(2600, v.voltage_cv);
+    TEST_ASSERT_EQUAL_INT16(-100, v.current_da);        /* 10 A en decharge */
+    TEST_ASSERT_EQUAL_UINT16(5000, v.soc_cpct);
+    TEST_ASSERT_EQUAL_INT32(400, v.consumed_dah);       /* 80 Ah x 50 % */
+    TEST_ASSERT_EQUAL_UINT16(240, v.ttg_min);           /* 40 Ah / 10 A */
+    TEST_ASSERT_EQUAL_UINT16(29815, v.temp_ck);
+    TEST_ASSERT_EQUAL_UINT16(0, v.alarm);
+}
+
+void test_shunt_soh_and_fallback_soc(void)
+{
+    fleet(2, 26000.0f, -3.0f);                          /* charge */
+    s_f.batt[0].soh_percent = 50.0f;
+    bmu_vic_shunt_t v;
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(3333, v.soc_cpct);         /* repli sur la tension */
+    TEST_ASSERT_EQUAL_INT16(60, v.current_da);
+    TEST_ASSERT_EQUAL_UINT16(BMU_VIC_TTG_INFINITE, v.ttg_min);
+    TEST_ASSERT_EQUAL_INT32(200, v.consumed_dah);       /* 30 Ah x 2/3 */
+
+    /* Capacite inconnue : Ah decharges cumules, TTG infini */
+    const bmu_vic_shunt_cfg_t no_cap = { 24000, 30000, 0.0f };
+    s_f.i_total_a = 10.0f;
+    bmu_vic_shunt_compute(&s_f, &no_cap, &v);
+    TEST_ASSERT_EQUAL_INT32(30, v.consumed_dah);
+    TEST_ASSERT_EQUAL_UINT16(BMU_VIC_TTG_INFINITE, v.ttg_min);
+}
+
+void test_shunt_alarms(void)
+{
+    fleet(3, 23000.0f, 0.0f);
+    s_f.batt[1].state = BMU_STATE_ERROR;
+    s_f.batt[2].state = BMU_STATE_LOCKED;
+    s_f.temp_c = 65.0f;
+    bmu_vic_shunt_t v;
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(BMU_VIC_ALARM_LOW_V | BMU_VIC_ALARM_HIGH_T |
+                             BMU_VIC_ALARM_ERROR | BMU_VIC_ALARM_LOCKED, v.alarm);
+    TEST_ASSERT_EQUAL_UINT16(0, v.soc_cpct);            /* sous le seuil : borne */
+    TEST_ASSERT_EQUAL_UINT16(33815, v.temp_ck);         /* > int16 : non tronque */
+
+    fleet(1, 31000.0f, 0.0f);
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(BMU_VIC_ALARM_HIGH_V, v.alarm);
+    TEST_ASSERT_EQUAL_UINT16(10000, v.soc_cpct);
+}
+
+void test_shunt_voltage_connected_only(void)
+{
+    /* Batterie 2 isolee en surtension : ni V ni alarme haute */
+    fleet(3, 26000.0f, 1.0f);
+    s_f.batt[2].voltage_mv = 33000.0f;
+    s_f.batt[2].state = BMU_STATE_DISCONNECTED;
+    bmu_telem_frame_aggregate(&s_f);
+    s_f.soc_fleet = -1.0f;
+    bmu_vic_shunt_t v;
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(2600, v.voltage_cv);
+    TEST_ASSERT_EQUAL_UINT16(0, v.alarm);
+    TEST_ASSERT_EQUAL_UINT16(3333, v.soc_cpct);
+
+    /* Batterie isolee en sous-tension : ne masque pas l'alarme haute */
+    fleet(2, 31000.0f, 0.0f);
+    s_f.batt[1].voltage_mv = 20000.0f;
+    s_f.batt[1].state = BMU_STATE_DISCONNECTED;
+    bmu_telem_frame_aggregate(&s_f);
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(3100, v.voltage_cv);
+    TEST_ASSERT_EQUAL_UINT16(BMU_VIC_ALARM_HIGH_V, v.alarm);
+}
+
+void test_shunt_empty_fleet(void)
+{
+    fleet(0, 0.0f, 0.0f);
+    bmu_vic_shunt_t v;
+    bmu_vic_shunt_compute(&s_f, &CFG, &v);
+    TEST_ASSERT_EQUAL_UINT16(0, v.voltage_cv);
+    TEST_ASSERT_EQUAL_UINT16(0, v.soc_cpct);
+    TEST_ASSERT_EQUAL_UINT16(0, v.temp_ck);
+    TEST_ASSERT_EQUAL_UINT16(BMU_VIC_TTG_INFINITE, v.ttg_min);
+    TEST_ASSERT_EQUAL_UINT16(0, v.alarm);
+}
+
+void test_shunt_diff_mask(void)
+{
+    fleet(2, 26000.0f, 1.0f);
+    bmu_vic_shunt_t a, b;
+    bmu_vic_shunt_compute(&s_f, &CFG, &a);
+    b = a;
+    TEST_ASSERT_EQUAL_UINT8(0, bmu_vic_shunt_diff(&a, &b));
+    b.current_da++;
+    b.alarm = BMU_VIC_ALARM_ERROR;
+    TEST_ASSERT_EQUAL_UINT8((1u << BMU_VIC_CHR_CURRENT) | (1u << BMU_VIC_CHR_ALARM),
+                            bmu_vic_shunt_diff(&a, &b));
+    memset(&b, 0xFF, sizeof(b));
+    TEST_ASSERT_EQUAL_UINT8(BMU_VIC_CHR_ALL, bmu_vic_shunt_diff(&a, &b));
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -91,5 +235,11 @@ int main(void)
     RUN_TEST(test_alarm_high_voltage);
     RUN_TEST(test_temperature_kelvin);
     RUN_TEST(test_ttg_discharge);
+    RUN_TEST(test_shunt_from_frame);
+    RUN_TEST(test_shunt_soh_and_fallback_soc);
+    RUN_TEST(test_shunt_alarms);
+    RUN_TEST(test_shunt_voltage_connected_only);
+    RUN_TEST(test_shunt_empty_fleet);
+    RUN_TEST(test_shunt_diff_mask);
     return UNITY_END();
 }
@@ -1,6 +1,8 @@
 #include "unity.h"
 #include <cstring>
 #include <cstdint>
+#include <cstdio>
+#include "bmu_vic_adv.h"
 
 void setUp(void) {}
 void tearDown(void) {}
@@ -78,6 +80,131 @@ void test_company_id_filter(void)
     TEST_ASSERT_EQUAL_UINT16(0x02E1, company);
 }
 
+/* ── bmu_vic_adv : annonces brutes ─────────────────────────────────── */
+
+/* Annonce : flags + nom + donnees constructeur Victron (nouveau format) */
+static size_t make_adv(uint8_t *ad, uint16_t counter, uint8_t fill)
+{
+    size_t n = 0;
+    const uint8_t flags[] = { 0x02, 0x01, 0x06 };
+    memcpy(ad + n, flags, sizeof(flags)); n += sizeof(flags);
+    const uint8_t name[] = { 0x05, 0x09, 'M', 'P', 'P', 'T' };
+    memcpy(ad + n, name, sizeof(name)); n += sizeof(name);
+    ad[n++] = 1 + 18;
+    ad[n++] = 0xFF;
+    const uint8_t hdr[] = { 0xE1, 0x02, 0x10, 0xA0, 0x42, 0x01,
+                            (uint8_t)counter, (uint8_t)(counter >> 8) };
+    memcpy(ad + n, hdr, sizeof(hdr)); n += sizeof(hdr);
+    for (int k = 0; k < BMU_VIC_ADV_CIPHER_LEN; k++) ad[n++] = (uint8_t)(fill + k);
+    return n;
+}
+
+void test_adv_find_new_format(void)
+{
+    uint8_t ad[31];
+    size_t n = make_adv(ad, 0x1234, 0x80);
+    bmu_vic_adv_t a;
+    TEST_ASSERT_TRUE(bmu_vic_adv_find(ad, n, &a));
+    TEST_ASSERT_EQUAL_UINT8(0x01, a.record_type);
+    TEST_ASSERT_EQUAL_UINT16(0x1234, a.counter);
+    TEST_ASSERT_EQUAL_PTR(ad + n - BMU_VIC_ADV_CIPHER_LEN, a.cipher);
+    TEST_ASSERT_EQUAL_UINT8(0x80, a.cipher[0]);
+}
+
+void test_adv_find_legacy_format(void)
+{
+    uint8_t ad[] = { 16, 0xFF, 0xE1, 0x02, 0x02, 0x07, 0x00,
+                     1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    bmu_vic_adv_t a;
+    TEST_ASSERT_TRUE(bmu_vic_adv_find(ad, sizeof(ad), &a));
+    TEST_ASSERT_EQUAL_UINT8(0x02, a.record_type);
+    TEST_ASSERT_EQUAL_UINT16(7, a.counter);
+    TEST_ASSERT_EQUAL_PTR(ad + 7, a.cipher);
+}
+
+void test_adv_find_rejects(void)
+{
+    uint8_t ad[31];
+    size_t n = make_adv(ad, 1, 0);
+    bmu_vic_adv_t a;
+
+    /* Autre constructeur (Apple 0x004C) */
+    uint8_t other[31];
+    memcpy(other, ad, n);
+    other[11] = 0x4C; other[12] = 0x00;
+    TEST_ASSERT_FALSE(bmu_vic_adv_find(other, n, &a));
+
+    /* Structure tronquee, longueur nulle, pas de donnees constructeur */
+    TEST_ASSERT_FALSE(bmu_vic_adv_find(ad, n - 1, &a));
+    const uint8_t zero[] = { 0x00, 0xFF, 0xE1, 0x02 };
+    TEST_ASSERT_FALSE(bmu_vic_adv_find(zero, sizeof(zero), &a));
+    TEST_ASSERT_FALSE(bmu_vic_adv_find(ad, 9, &a));
+
+    /* Donnees Victron trop courtes */
+    const uint8_t shortm[] = { 0x05, 0xFF, 0xE1, 0x02, 0x01, 0x00 };
+    TEST_ASSERT_FALSE(bmu_vic_adv_find(shortm, sizeof(shortm), &a));
+}
+
+void test_adv_dedup(void)
+{
+    uint8_t ad[31];
+    size_t n = make_adv(ad, 100, 0x10);
+    bmu_vic_adv_t a;
+    bmu_vic_adv_last_t last = {};
+    TEST_ASSERT_TRUE(bmu_vic_adv_find(ad, n, &a));
+    TEST_ASSERT_FALSE(bmu_vic_adv_is_dup(&last, &a));     /* jamais vu */
+    bmu_vic_adv_remember(&last, &a);
+    TEST_ASSERT_TRUE(bmu_vic_adv_is_dup(&last, &a));
+
+    /* Compteur suivant : donnees nouvelles */
+    n = make_adv(ad, 101, 0x10);
+    bmu_vic_adv_find(ad, n, &a);
+    TEST_ASSERT_FALSE(bmu_vic_adv_is_dup(&last, &a));
+
+    /* Meme compteur, chiffre different (autre cle, corruption) */
+    n = make_adv(ad, 100, 0x11);
+    bmu_vic_adv_find(ad, n, &a);
+    TEST_ASSERT_FALSE(bmu_vic_adv_is_dup(&last, &a));
+}
+
+void test_adv_dense_site(void)
+{
+    /* 16 SmartSolar, annonce toutes les 100 ms, donnees changees chaque
+     * seconde, scan de 5 s : 1 annonce sur 10 dechiffree */
+    bmu_vic_adv_last_t last[16] = {};
+    uint8_t ad[31];
+    int rx = 0, decrypt = 0;
+    for (int t = 0; t < 50; t++) {
+        for (int d = 0; d < 16; d++) {
+            size_t n = make_adv(ad, (uint16_t)(d * 1000 + t / 10), (uint8_t)(d + t / 10));
+            bmu_vic_adv_t a;
+            TEST_ASSERT_TRUE(bmu_vic_adv_find(ad, n, &a));
+            rx++;
+            if (!bmu_vic_adv_is_dup(&last[d], &a)) {
+                decrypt++;
+                bmu_vic_adv_remember(&last[d], &a);
+            }
+        }
+    }
+    printf("dense site: %d annonces, %d dechiffrements\n", rx, decrypt);
+    TEST_ASSERT_EQUAL(800, rx);
+    TEST_ASSERT_EQUAL(80, decrypt);
+}
+
+void test_parse_key(void)
+{
+    uint8_t key[16];
+    TEST_ASSERT_TRUE(bmu_vic_adv_parse_key("00112233445566778899aabbccddEEFF", key));
+    TEST_ASSERT_EQUAL_HEX8(0x00, key[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x99, key[9]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, key[10]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, key[15]);
+    TEST_ASSERT_FALSE(bmu_vic_adv_parse_key("00112233445566778899aabbccddeeF", key));
+    TEST_ASSERT_FALSE(bmu_vic_adv_parse_key("00112233445566778899aabbccddeeFF0", key));
+    TEST_ASSERT_FALSE(bmu_vic_adv_parse_key("0011223344556677889Gaabbccddeeff", key));
+    TEST_ASSERT_FALSE(bmu_vic_adv_parse_key("", key));
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -86,5 +213,11 @@ int main(void)
     RUN_TEST(test_device_expiry);
     RUN_TEST(test_mac_to_hex);
     RUN_TEST(test_company_id_filter);
+    RUN_TEST(test_adv_find_new_format);
+    RUN_TEST(test_adv_find_legacy_format);
+    RUN_TEST(test_adv_find_rejects);
+    RUN_TEST(test_adv_dedup);
+    RUN_TEST(test_adv_dense_site);
+    RUN_TEST(test_parse_key);
     return UNITY_END();
 }
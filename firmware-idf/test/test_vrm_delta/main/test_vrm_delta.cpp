@@ -0,0 +1,160 @@
+/**
+ * @file test_vrm_delta.cpp
+ * @brief Tests host du cache par chemin des publications VRM (bmu_vrm_delta) — Unity.
+ *
+ * Couverture :
+ *   - Topics N/<portal>/<path> formatés une fois, table trop petite refusée
+ *   - Premier envoi, valeur inchangée à la résolution publiée (%.2f)
+ *   - Bande morte mesurée depuis la dernière valeur publiée
+ *   - Entiers et chaînes (hash), NAN jamais publié
+ *   - Échec de publication (invalidate) et keepalive (refresh_all)
+ *   - Trafic sur une heure comparé au RBE par groupe (tout republié si un chemin bouge)
+ */
+#ifndef NATIVE_TEST
+#define NATIVE_TEST
+#endif
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "bmu_vrm_delta.h"
+
+enum { P_SERIAL, P_V, P_I, P_SOC, P_STATE, P_COUNT };
+
+static bmu_vrm_path_t s_paths[P_COUNT];
+static char s_topics[256];
+static bmu_vrm_delta_t s_d;
+static char s_json[64];
+
+void setUp(void)
+{
+    const bmu_vrm_path_t init[P_COUNT] = {
+        { "system/0/Serial",        BMU_VRM_STR,   0.0f,  0, false, 0 },
+        { "battery/0/Dc/0/Voltage", BMU_VRM_FLOAT, 0.05f, 0, false, 0 },
+        { "battery/0/Dc/0/Current", BMU_VRM_FLOAT, 0.2f,  0, false, 0 },
+        { "battery/0/Soc",          BMU_VRM_FLOAT, 1.0f,  0, false, 0 },
+        { "solarcharger/0/State",   BMU_VRM_INT,   0.0f,  0, false, 0 },
+    };
+    memcpy(s_paths, init, sizeof(s_paths));
+    TEST_ASSERT_TRUE(bmu_vrm_delta_init(&s_d, "70b3d549969af37b", s_paths, P_COUNT,
+                                        s_topics, sizeof(s_topics)));
+}
+void tearDown(void) {}
+
+void test_topics_preformatted(void)
+{
+    TEST_ASSERT_EQUAL_STRING("N/70b3d549969af37b/system/0/Serial", bmu_vrm_delta_topic(&s_d, P_SERIAL));
+    TEST_ASSERT_EQUAL_STRING("N/70b3d549969af37b/battery/0/Soc", bmu_vrm_delta_topic(&s_d, P_SOC));
+    TEST_ASSERT_EQUAL_STRING("N/70b3d549969af37b/solarcharger/0/State", bmu_vrm_delta_topic(&s_d, P_STATE));
+
+    char small[40];
+    TEST_ASSERT_FALSE(bmu_vrm_delta_init(&s_d, "70b3d549969af37b", s_paths, P_COUNT,
+                                         small, sizeof(small)));
+}
+
+void test_first_send_then_unchanged(void)
+{
+    int n = bmu_vrm_delta_float(&s_d, P_V, 26.5f, s_json, sizeof(s_json));
+    TEST_ASSERT_EQUAL((int)strlen("{\"value\":26.50}"), n);
+    TEST_ASSERT_EQUAL_STRING("{\"value\":26.50}", s_json);
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_float(&s_d, P_V, 26.5f, s_json, sizeof(s_json)));
+
+    /* Bande morte nulle : même texte publié → rien */
+    s_paths[P_V].deadband = 0.0f;
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_float(&s_d, P_V, 26.501f, s_json, sizeof(s_json)));
+    TEST_ASSERT_TRUE(bmu_vrm_delta_float(&s_d, P_V, 26.51f, s_json, sizeof(s_json)) > 0);
+    TEST_ASSERT_EQUAL_UINT32(2, s_d.sent);
+    TEST_ASSERT_EQUAL_UINT32(2, s_d.skipped);
+}
+
+void test_deadband_from_last_published(void)
+{
+    bmu_vrm_delta_float(&s_d, P_V, 26.00f, s_json, sizeof(s_json));
+    int sent = 0;
+    for (int k = 1; k <= 20; k++) {                    /* dérive +10 mV / tick */
+        if (bmu_vrm_delta_float(&s_d, P_V, 26.00f + 0.01f * k, s_json, sizeof(s_json)) > 0) sent++;
+    }
+    TEST_ASSERT_EQUAL(3, sent);                        /* +60, +120, +180 mV */
+    TEST_ASSERT_EQUAL_STRING("{\"value\":26.18}", s_json);
+
+    bmu_vrm_delta_float(&s_d, P_I, 0.0f, s_json, sizeof(s_json));
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_float(&s_d, P_I, -0.2f, s_json, sizeof(s_json)));
+    TEST_ASSERT_TRUE(bmu_vrm_delta_float(&s_d, P_I, -0.21f, s_json, sizeof(s_json)) > 0);
+}
+
+void test_int_str_nan(void)
+{
+    TEST_ASSERT_TRUE(bmu_vrm_delta_int(&s_d, P_STATE, 3, s_json, sizeof(s_json)) > 0);
+    TEST_ASSERT_EQUAL_STRING("{\"value\":3}", s_json);
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_int(&s_d, P_STATE, 3, s_json, sizeof(s_json)));
+    TEST_ASSERT_TRUE(bmu_vrm_delta_int(&s_d, P_STATE, 4, s_json, sizeof(s_json)) > 0);
+
+    TEST_ASSERT_TRUE(bmu_vrm_delta_str(&s_d, P_SERIAL, "HQ2231ABCDE", s_json, sizeof(s_json)) > 0);
+    TEST_ASSERT_EQUAL_STRING("{\"value\":\"HQ2231ABCDE\"}", s_json);
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_str(&s_d, P_SERIAL, "HQ2231ABCDE", s_json, sizeof(s_json)));
+    TEST_ASSERT_TRUE(bmu_vrm_delta_str(&s_d, P_SERIAL, "HQ2231ABCDF", s_json, sizeof(s_json)) > 0);
+
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_float(&s_d, P_SOC, NAN, s_json, sizeof(s_json)));
+    TEST_ASSERT_FALSE(s_paths[P_SOC].valid);
+}
+
+void test_invalidate_and_refresh(void)
+{
+    bmu_vrm_delta_float(&s_d, P_V, 26.0f, s_json, sizeof(s_json));
+    bmu_vrm_delta_float(&s_d, P_SOC, 80.0f, s_json, sizeof(s_json));
+
+    bmu_vrm_delta_invalidate(&s_d, P_V);               /* outbox pleine */
+    TEST_ASSERT_TRUE(bmu_vrm_delta_float(&s_d, P_V, 26.0f, s_json, sizeof(s_json)) > 0);
+    TEST_ASSERT_EQUAL(0, bmu_vrm_delta_float(&s_d, P_SOC, 80.0f, s_json, sizeof(s_json)));
+
+    bmu_vrm_delta_refresh_all(&s_d);                   /* keepalive */
+    TEST_ASSERT_TRUE(bmu_vrm_delta_float(&s_d, P_V, 26.0f, s_json, sizeof(s_json)) > 0);
+    TEST_ASSERT_TRUE(bmu_vrm_delta_float(&s_d, P_SOC, 80.0f, s_json, sizeof(s_json)) > 0);
+}
+
+void test_hour_traffic_vs_group(void)
+{
+    /* 1 h à tick 1 s, keepalive 30 s : bruit ±20 mV, charge qui change de
+     * palier toutes les 20 s, SOC qui descend d'1 % toutes les 6 min.
+     * Référence : RBE par groupe, tous les chemins republiés dès qu'un seul bouge. */
+    size_t bytes = 0, baseline = 0;
+    int msgs = 0;
+    for (int t = 0; t < 3600; t++) {
+        bool keepalive = (t % 30) == 0;
+        if (keepalive) bmu_vrm_delta_refresh_all(&s_d);
+        float v = 26.0f + ((t % 3) - 1) * 0.02f;
+        float i = (float)((t / 20) % 4) * 2.5f;
+        float soc = 90.0f - (float)(t / 360);
+        const int lens[P_COUNT] = {
+            bmu_vrm_delta_str(&s_d, P_SERIAL, "70b3d549969af37b", s_json, sizeof(s_json)),
+            bmu_vrm_delta_float(&s_d, P_V, v, s_json, sizeof(s_json)),
+            bmu_vrm_delta_float(&s_d, P_I, i, s_json, sizeof(s_json)),
+            bmu_vrm_delta_float(&s_d, P_SOC, soc, s_json, sizeof(s_json)),
+            bmu_vrm_delta_int(&s_d, P_STATE, 3, s_json, sizeof(s_json)),
+        };
+        bool any = false;
+        size_t all = 0;
+        for (int k = 0; k < P_COUNT; k++) {
+            size_t msg = strlen(bmu_vrm_delta_topic(&s_d, (uint8_t)k)) + 16;
+            all += msg;
+            if (lens[k] > 0) { bytes += msg; msgs++; any = true; }
+        }
+        if (any) baseline += all;
+    }
+    printf("1 h : %d messages, %u octets (RBE par groupe : %u)\n",
+           msgs, (unsigned)bytes, (unsigned)baseline);
+    TEST_ASSERT_TRUE(bytes * 3 <= baseline * 2);
+    TEST_ASSERT_EQUAL_UINT32(3600u * P_COUNT - (uint32_t)msgs, s_d.skipped);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_topics_preformatted);
+    RUN_TEST(test_first_send_then_unchanged);
+    RUN_TEST(test_deadband_from_last_published);
+    RUN_TEST(test_int_str_nan);
+    RUN_TEST(test_invalidate_and_refresh);
+    RUN_TEST(test_hour_traffic_vs_group);
+    return UNITY_END();
+}
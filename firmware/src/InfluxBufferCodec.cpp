@@ -1,76 +1,229 @@
 #include "InfluxBufferCodec.h"
 
-#include <cctype>
+#include <cstring>
 
 namespace {
-std::string trimCopy(const std::string &in) {
-  size_t first = 0;
-  while (first < in.size() && std::isspace(static_cast<unsigned char>(in[first]))) {
-    ++first;
+bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Avance jusqu'au premier ',' ou ' ' non échappé (et '=' si stopAtEq) ; un
+// '\' final sans caractère à échapper est refusé.
+const char *scanToken(const char *p, const char *end, bool stopAtEq, bool &ok) {
+  for (; p < end; ++p) {
+    const char c = *p;
+    if (c == ',' || c == ' ' || (stopAtEq && c == '=')) {
+      return p;
+    }
+    if (c == '\\' && ++p == end) {
+      ok = false;
+      return end;
+    }
+  }
+  return end;
+}
+
+// Premier ' ' non échappé (nombre pair de '\' devant), ou end.
+const char *findSpace(const char *p, const char *end) {
+  const char *from = p;
+  while (from < end) {
+    const char *sp = static_cast<const char *>(
+        std::memchr(from, ' ', static_cast<size_t>(end - from)));
+    if (sp == nullptr) {
+      return end;
+    }
+    size_t slashes = 0;
+    for (const char *b = sp; b > p && b[-1] == '\\'; --b) {
+      ++slashes;
+    }
+    if ((slashes & 1u) == 0) {
+      return sp;
+    }
+    from = sp + 1;
+  }
+  return end;
+}
+
+// Valeur chaîne "..." (échappements \" et \\) : virgules et espaces permis.
+const char *scanQuoted(const char *p, const char *end, bool &ok) {
+  ++p;
+  while (p < end) {
+    if (*p == '\\') {
+      p += 2;
+      continue;
+    }
+    if (*p == '"') {
+      return p + 1;
+    }
+    ++p;
+  }
+  ok = false;
+  return end;
+}
+
+// Un couple k=v terminé par ',', ' ' ou fin de plage. key et value non vides.
+const char *parseKv(const char *p, const char *end, bool quotedValues,
+                    InfluxKV &kv, bool &ok) {
+  const char *eq = scanToken(p, end, true, ok);
+  if (!ok || eq == end || *eq != '=' || eq == p) {
+    ok = false;
+    return end;
   }
-  if (first >= in.size()) {
-    return "";
+  kv.key.data = p;
+  kv.key.len = static_cast<size_t>(eq - p);
+
+  const char *v = eq + 1;
+  const char *vEnd = (quotedValues && v < end && *v == '"')
+                         ? scanQuoted(v, end, ok)
+                         : scanToken(v, end, false, ok);
+  if (!ok || vEnd == v || (vEnd < end && *vEnd != ',' && *vEnd != ' ')) {
+    ok = false;
+    return end;
   }
-  size_t last = in.size() - 1;
-  while (last > first && std::isspace(static_cast<unsigned char>(in[last]))) {
-    --last;
+  kv.value.data = v;
+  kv.value.len = static_cast<size_t>(vEnd - v);
+  return vEnd;
+}
+
+// Liste de couples séparés par ',' jusqu'au premier ' ' non échappé ou la fin.
+const char *parseKvList(const char *p, const char *end, bool quotedValues,
+                        InfluxKV *kvs, size_t cap, size_t &count, bool &ok) {
+  for (;;) {
+    if (count >= cap) {
+      ok = false;
+      return end;
+    }
+    p = parseKv(p, end, quotedValues, kvs[count], ok);
+    if (!ok) {
+      return end;
+    }
+    ++count;
+    if (p == end || *p == ' ') {
+      return p;
+    }
+    ++p; // ','
   }
-  return in.substr(first, last - first + 1);
 }
 
-bool parseKv(const std::string &kv, std::string &key, std::string &value) {
-  const size_t eq = kv.find('=');
-  if (eq == std::string::npos || eq == 0 || eq == kv.size() - 1) {
+bool parseTimestamp(const char *p, const char *end, int64_t &out) {
+  bool negative = false;
+  if (p < end && *p == '-') {
+    negative = true;
+    ++p;
+  }
+  if (p == end || end - p > 19) {
+    return false;
+  }
+  uint64_t value = 0;
+  for (; p < end; ++p) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<uint64_t>(*p - '0');
+  }
+  if (value > static_cast<uint64_t>(INT64_MAX)) {
     return false;
   }
-  key = kv.substr(0, eq);
-  value = kv.substr(eq + 1);
-  return !key.empty() && !value.empty();
+  out = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+  return true;
 }
 } // namespace
 
-bool parseInfluxBufferLine(const std::string &line, ParsedInfluxBufferLine &out) {
-  const std::string trimmed = trimCopy(line);
-  if (trimmed.empty()) {
+bool parseInfluxLine(const char *line, size_t len, InfluxLineView &out) {
+  out.tagCount = 0;
+  out.fieldCount = 0;
+  out.hasTimestamp = false;
+  out.timestamp = 0;
+  if (line == nullptr) {
     return false;
   }
 
-  const size_t firstComma = trimmed.find(',');
-  if (firstComma == std::string::npos || firstComma == 0 || firstComma >= trimmed.size() - 1) {
+  const char *p = line;
+  const char *end = line + len;
+  while (p < end && isBlank(*p)) {
+    ++p;
+  }
+  while (end > p && isBlank(end[-1])) {
+    --end;
+  }
+  if (p == end) {
     return false;
   }
 
-  const size_t secondComma = trimmed.find(',', firstComma + 1);
-  if (secondComma == std::string::npos || secondComma <= firstComma + 1 || secondComma >= trimmed.size() - 1) {
+  bool ok = true;
+  const char *mEnd = scanToken(p, end, false, ok);
+  if (!ok || mEnd == p || mEnd == end) {
     return false;
   }
+  out.measurement.data = p;
+  out.measurement.len = static_cast<size_t>(mEnd - p);
 
-  out.measurement = trimmed.substr(0, firstComma);
-  out.fields.clear();
+  // Le premier espace non échappé sépare tags et champs ; absent, la ligne
+  // est au format tampon historique.
+  const char *section = findSpace(mEnd, end);
 
-  const std::string tagPart = trimmed.substr(firstComma + 1, secondComma - firstComma - 1);
-  if (!parseKv(tagPart, out.tag.key, out.tag.value)) {
-    return false;
+  if (section == end) {
+    p = parseKv(mEnd + 1, end, false, out.tags[0], ok);
+    if (!ok || p == end) {
+      return false;
+    }
+    out.tagCount = 1;
+    p = parseKvList(p + 1, end, false, out.fields, kInfluxMaxFields,
+                    out.fieldCount, ok);
+    return ok && p == end;
   }
 
-  const std::string fieldsPart = trimmed.substr(secondComma + 1);
-  size_t start = 0;
-  while (start < fieldsPart.size()) {
-    const size_t comma = fieldsPart.find(',', start);
-    const size_t end = (comma == std::string::npos) ? fieldsPart.size() : comma;
-    const std::string field = fieldsPart.substr(start, end - start);
-    std::string key;
-    std::string value;
-    if (!parseKv(field, key, value)) {
+  if (*mEnd == ',') {
+    p = parseKvList(mEnd + 1, section, false, out.tags, kInfluxMaxTags,
+                    out.tagCount, ok);
+    if (!ok || p != section) {
       return false;
     }
-    out.fields.push_back({key, value});
+  }
 
-    if (comma == std::string::npos) {
-      break;
+  p = parseKvList(section + 1, end, true, out.fields, kInfluxMaxFields,
+                  out.fieldCount, ok);
+  if (!ok) {
+    return false;
+  }
+  if (p == end) {
+    return true;
+  }
+  out.hasTimestamp = parseTimestamp(p + 1, end, out.timestamp);
+  return out.hasTimestamp;
+}
+
+bool influxSpanEquals(const InfluxSpan &span, const char *text) {
+  size_t i = 0;
+  for (; i < span.len; ++i) {
+    if (text[i] == '\0' || text[i] != span.data[i]) {
+      return false;
     }
-    start = comma + 1;
   }
+  return text[i] == '\0';
+}
 
-  return !out.measurement.empty() && !out.fields.empty();
+size_t influxUnescape(const InfluxSpan &span, char *out, size_t cap) {
+  const char *p = span.data;
+  const char *end = span.data + span.len;
+  // Valeur chaîne : guillemets retirés
+  if (span.len >= 2 && p[0] == '"' && end[-1] == '"') {
+    ++p;
+    --end;
+  }
+  size_t n = 0;
+  while (p < end) {
+    if (*p == '\\' && p + 1 < end) {
+      ++p;
+    }
+    if (n + 1 >= cap) {
+      return 0;
+    }
+    out[n++] = *p++;
+  }
+  if (cap == 0) {
+    return 0;
+  }
+  out[n] = '\0';
+  return n;
 }
@@ -1,25 +1,48 @@
 #ifndef INFLUX_BUFFER_CODEC_H
 #define INFLUX_BUFFER_CODEC_H
 
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
 
-struct InfluxTagKV {
-  std::string key;
-  std::string value;
+// Vue non possédante sur une portion de la ligne d'entrée. Les échappements
+// (\, \= \espace \" \\) sont conservés tels quels : influxUnescape() les
+// retire dans un tampon fourni par l'appelant.
+struct InfluxSpan {
+  const char *data;
+  size_t len;
 };
 
-struct InfluxFieldKV {
-  std::string key;
-  std::string value;
+struct InfluxKV {
+  InfluxSpan key;
+  InfluxSpan value;
 };
 
-struct ParsedInfluxBufferLine {
-  std::string measurement;
-  InfluxTagKV tag;
-  std::vector<InfluxFieldKV> fields;
+static constexpr size_t kInfluxMaxTags = 8;
+static constexpr size_t kInfluxMaxFields = 16;
+
+// Résultat du parseur : uniquement des spans dans la ligne d'origine, aucune
+// allocation. La ligne doit rester valide tant que la vue est utilisée.
+struct InfluxLineView {
+  InfluxSpan measurement;
+  InfluxKV tags[kInfluxMaxTags];
+  size_t tagCount;
+  InfluxKV fields[kInfluxMaxFields];
+  size_t fieldCount;
+  bool hasTimestamp;
+  int64_t timestamp;
 };
 
-bool parseInfluxBufferLine(const std::string &line, ParsedInfluxBufferLine &out);
+// Deux formes acceptées (espaces/CR/LF de bord ignorés) :
+//  - line protocol : "mesure[,tag=v...] champ=v[,champ=v...] [timestamp]",
+//    tags multiples, valeurs chaîne entre guillemets, échappements ;
+//  - tampon historique : "mesure,tag=v,champ=v[,champ=v...]" (sans espace),
+//    premier couple = tag unique, pour rejouer les fichiers SPIFFS existants.
+bool parseInfluxLine(const char *line, size_t len, InfluxLineView &out);
+
+bool influxSpanEquals(const InfluxSpan &span, const char *text);
+
+// Copie la span sans ses échappements, terminée par '\0'. Retourne la longueur
+// copiée, ou 0 si le tampon est trop petit.
+size_t influxUnescape(const InfluxSpan &span, char *out, size_t cap);
 
 #endif // INFLUX_BUFFER_CODEC_H
@@ -18,7 +18,6 @@
 //#include <ESP_SSLClient.h>
 #include <WiFiClientSecure.h> // Ajoutez cette ligne pour utiliser WiFiClientSecure
 #include <cstdlib>
-#include <string>
 
 #if KXKM_HAS_INFLUX_LIB
 
@@ -61,6 +60,46 @@ bool rotateInfluxTempIfNeeded() {
     return true;
 }
 
+// Tampons de rejeu : une ligne, une clé et une valeur désechappées à la fois.
+// Le parseur ne renvoie que des spans dans s_replayLine, aucune allocation
+// par ligne hors des String internes de Point.
+char s_replayLine[kInfluxMaxBufferedLineLen + 1];
+char s_replayKey[kInfluxMaxBufferedLineLen + 1];
+char s_replayValue[kInfluxMaxBufferedLineLen + 1];
+InfluxLineView s_replayView;
+
+void addParsedField(Point &point, const InfluxKV &kv) {
+    if (influxUnescape(kv.key, s_replayKey, sizeof(s_replayKey)) == 0) {
+        return;
+    }
+    const InfluxSpan &v = kv.value;
+    if (v.data[0] == '"') {
+        influxUnescape(v, s_replayValue, sizeof(s_replayValue));
+        point.addField(s_replayKey, s_replayValue);
+    } else if (v.data[v.len - 1] == 'i') {
+        point.addField(s_replayKey, std::strtoll(v.data, nullptr, 10));
+    } else {
+        point.addField(s_replayKey, static_cast<float>(std::strtod(v.data, nullptr)));
+    }
+}
+
+bool buildPoint(const InfluxLineView &view, Point &point) {
+    for (size_t i = 0; i < view.tagCount; ++i) {
+        if (influxUnescape(view.tags[i].key, s_replayKey, sizeof(s_replayKey)) == 0 ||
+            influxUnescape(view.tags[i].value, s_replayValue, sizeof(s_replayValue)) == 0) {
+            return false;
+        }
+        point.addTag(s_replayKey, s_replayValue);
+    }
+    for (size_t i = 0; i < view.fieldCount; ++i) {
+        addParsedField(point, view.fields[i]);
+    }
+    if (view.hasTimestamp) {
+        point.setTime(static_cast<unsigned long long>(view.timestamp));
+    }
+    return true;
+}
+
 bool replayStoredFile(const char *filePath, InfluxDBClient &clientRef) {
     if (!SPIFFS.exists(filePath)) {
         return true;
@@ -72,22 +111,22 @@ bool replayStoredFile(const char *filePath, InfluxDBClient &clientRef) {
     }
 
     while (file.available()) {
-        String lineStr = file.readStringUntil('\n');
-        lineStr.trim();
-        if (lineStr.length() == 0) {
+        // storeData borne l'écriture à kInfluxMaxBufferedLineLen : une ligne
+        // plus longue vient d'un fichier corrompu, ses morceaux sont rejetés.
+        const size_t len = file.readBytesUntil('\n', s_replayLine,
+                                               kInfluxMaxBufferedLineLen);
+        s_replayLine[len] = '\0'; // strtod/strtoll sur la dernière valeur
+        if (!parseInfluxLine(s_replayLine, len, s_replayView)) {
             continue;
         }
-
-        ParsedInfluxBufferLine parsed;
-        if (!parseInfluxBufferLine(std::string(lineStr.c_str()), parsed)) {
+        if (influxUnescape(s_replayView.measurement, s_replayKey,
+                           sizeof(s_replayKey)) == 0) {
             continue;
         }
 
-        Point point(parsed.measurement.c_str());
-        point.addTag(parsed.tag.key.c_str(), parsed.tag.value.c_str());
-        for (size_t i = 0; i < parsed.fields.size(); ++i) {
-            point.addField(parsed.fields[i].key.c_str(),
-                           static_cast<float>(std::atof(parsed.fields[i].value.c_str())));
+        Point point(s_replayKey);
+        if (!buildPoint(s_replayView, point)) {
+            continue;
         }
 
         if (!clientRef.writePoint(point)) {
@@ -268,14 +307,11 @@ void InfluxDBHandler::writeAggregatedBatteryData(const char *measurement,
     point.addTag("profile",
                  (profileTag == nullptr) ? "normal" : profileTag);
 
-    ParsedInfluxBufferLine parsed;
-    if (!parseInfluxBufferLine(std::string((String(measurement) + ",profile=" +
-                                           String((profileTag == nullptr)
-                                                      ? "normal"
-                                                      : profileTag) +
-                                           "," + fields)
-                                              .c_str()),
-                              parsed)) {
+    const String line = String(measurement) + ",profile=" +
+                        String((profileTag == nullptr) ? "normal" : profileTag) +
+                        "," + fields;
+    InfluxLineView parsed;
+    if (!parseInfluxLine(line.c_str(), line.length(), parsed)) {
         storeData(measurement,
                   ("profile=" + String(profileTag == nullptr ? "normal"
                                                               : profileTag))
@@ -284,15 +320,8 @@ void InfluxDBHandler::writeAggregatedBatteryData(const char *measurement,
         return;
     }
 
-    for (size_t i = 0; i < parsed.fields.size(); ++i) {
-        const String key = parsed.fields[i].key.c_str();
-        const String rawValue = parsed.fields[i].value.c_str();
-        if (rawValue.endsWith("i")) {
-            const String intPart = rawValue.substring(0, rawValue.length() - 1);
-            point.addField(key.c_str(), intPart.toInt());
-        } else {
-            point.addField(key.c_str(), static_cast<float>(std::atof(rawValue.c_str())));
-        }
+    for (size_t i = 0; i < parsed.fieldCount; ++i) {
+        addParsedField(point, parsed.fields[i]);
     }
 
     if (!client->writePoint(point)) {
@@ -327,8 +356,8 @@ void InfluxDBHandler::storeData(const char *measurement, const char *tags,
         return;
     }
 
-    ParsedInfluxBufferLine parsed;
-    if (!parseInfluxBufferLine(std::string(line.c_str()), parsed)) {
+    InfluxLineView parsed;
+    if (!parseInfluxLine(line.c_str(), line.length(), parsed)) {
         debugLogger.println(KxLogger::INFLUXDB,
                             "storeData refused: malformed line");
         return;
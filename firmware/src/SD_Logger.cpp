@@ -25,6 +25,7 @@
 #include <SD.h>
 #include <Arduino.h>
 #include <time.h>
+#include <stdarg.h>
 
 extern KxLogger debugLogger;
 
@@ -129,6 +130,16 @@ void SDLogger::logData(const char *time, int bat_nb, float volt, float current,
   this->totalConsumption = totalConsumption;
 }
 
+// snprintf cumulatif : n reste borné à cap - 1 si la ligne déborde
+static void appendf(char *buf, size_t cap, size_t *n, const char *fmt, ...) {
+  if (*n >= cap - 1) return;
+  va_list ap;
+  va_start(ap, fmt);
+  int w = vsnprintf(buf + *n, cap - *n, fmt, ap);
+  va_end(ap);
+  if (w > 0) *n = (*n + (size_t)w < cap - 1) ? *n + (size_t)w : cap - 1;
+}
+
 void SDLogger::flushLine() {
   for (int i = 0; i < batteryCount; ++i) {
     if (!batteryBuffer[i].valid) {
@@ -136,20 +147,32 @@ void SDLogger::flushLine() {
       return;
     }
   }
-  dataFile = SD.open(filename, FILE_APPEND);
+  // Fichier gardé ouvert depuis begin() : rouvert seulement après une erreur
+  if (!dataFile) dataFile = SD.open(filename, FILE_APPEND);
   if (dataFile) {
-    dataFile.print(lastTime);
-    for (int i = 0; i < batteryCount; ++i) dataFile.print(csvConfig.separator), dataFile.print(batteryBuffer[i].volt);
-    for (int i = 0; i < batteryCount; ++i) dataFile.print(csvConfig.separator), dataFile.print(batteryBuffer[i].current);
-    for (int i = 0; i < batteryCount; ++i) dataFile.print(csvConfig.separator), dataFile.print(batteryBuffer[i].switchState ? "ON" : "OFF");
-    for (int i = 0; i < batteryCount; ++i) dataFile.print(csvConfig.separator), dataFile.print(batteryBuffer[i].ampereHourConsumption, 4);
-    for (int i = 0; i < batteryCount; ++i) dataFile.print(csvConfig.separator), dataFile.print(batteryBuffer[i].ampereHourCharge, 4);
-    dataFile.print(csvConfig.separator); dataFile.print(totalCurrent, 1);
-    dataFile.print(csvConfig.separator); dataFile.print(totalCharge, 1);
-    dataFile.print(csvConfig.separator); dataFile.print(totalConsumption, 1);
-    dataFile.println();
-    dataFile.flush();
-    dataFile.close();
+    // Ligne complète formatée en RAM puis un seul write (au lieu d'un print par champ)
+    char line[1024];
+    size_t n = 0;
+    const char sep = csvConfig.separator;
+    appendf(line, sizeof(line), &n, "%s", lastTime);
+    for (int i = 0; i < batteryCount; ++i) appendf(line, sizeof(line), &n, "%c%.2f", sep, batteryBuffer[i].volt);
+    for (int i = 0; i < batteryCount; ++i) appendf(line, sizeof(line), &n, "%c%.2f", sep, batteryBuffer[i].current);
+    for (int i = 0; i < batteryCount; ++i) appendf(line, sizeof(line), &n, "%c%s", sep, batteryBuffer[i].switchState ? "ON" : "OFF");
+    for (int i = 0; i < batteryCount; ++i) appendf(line, sizeof(line), &n, "%c%.4f", sep, batteryBuffer[i].ampereHourConsumption);
+    for (int i = 0; i < batteryCount; ++i) appendf(line, sizeof(line), &n, "%c%.4f", sep, batteryBuffer[i].ampereHourCharge);
+    appendf(line, sizeof(line), &n, "%c%.1f%c%.1f%c%.1f\r\n",
+            sep, totalCurrent, sep, totalCharge, sep, totalConsumption);
+
+    if (dataFile.write((const uint8_t *)line, n) != n) {
+      debugLogger.println(KxLogger::ERROR, "flushLine: écriture SD échouée, fichier rouvert au prochain appel");
+      dataFile.close();
+      return;
+    }
+    // flush borné : au plus une mise à jour FAT toutes les flushIntervalMs
+    if (millis() - lastFlushMs >= flushIntervalMs) {
+      dataFile.flush();
+      lastFlushMs = millis();
+    }
 
     debugLogger.print(KxLogger::SD, "Données ligne CSV: ");
     debugLogger.print(KxLogger::SD, String(lastTime));
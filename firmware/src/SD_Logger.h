@@ -91,6 +91,8 @@ private:
   const int chipSelect = 21; // Pin de sélection de la carte SD
   File dataFile;
   unsigned long lastLogTime = 0;
+  unsigned long lastFlushMs = 0;
+  static const unsigned long flushIntervalMs = 30000; // Perte max sur coupure d'alimentation
   int log_at_time = 10; // Temps entre chaque enregistrement en secondes
   CSVConfig csvConfig;  // Ajouter cette ligne
   char *filename = nullptr; // Modifié pour être un pointeur modifiable
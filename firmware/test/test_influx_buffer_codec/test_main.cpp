@@ -1,57 +1,252 @@
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <string>
+#include <vector>
 
 #include "../../src/InfluxBufferCodec.h"
 
+// Compteur d'allocations : le parseur ne doit jamais passer par le tas.
+static size_t g_allocs = 0;
+
+void *operator new(size_t size) {
+  ++g_allocs;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+static bool parse(const char *line, InfluxLineView &view) {
+  return parseInfluxLine(line, std::strlen(line), view);
+}
+
+static std::string unescaped(const InfluxSpan &span) {
+  char buf[128];
+  const size_t n = influxUnescape(span, buf, sizeof(buf));
+  return std::string(buf, n);
+}
+
 static void test_parse_valid_line_with_three_fields() {
-  ParsedInfluxBufferLine parsed;
-  const bool ok = parseInfluxBufferLine(
+  InfluxLineView parsed;
+  const bool ok = parse(
       "battery_data,battery=3,voltage=28.4,current=1.2,temperature=24.5",
       parsed);
 
   assert(ok);
-  assert(parsed.measurement == "battery_data");
-  assert(parsed.tag.key == "battery");
-  assert(parsed.tag.value == "3");
-  assert(parsed.fields.size() == 3);
-  assert(parsed.fields[0].key == "voltage");
-  assert(parsed.fields[0].value == "28.4");
-  assert(parsed.fields[1].key == "current");
-  assert(parsed.fields[1].value == "1.2");
-  assert(parsed.fields[2].key == "temperature");
-  assert(parsed.fields[2].value == "24.5");
+  assert(influxSpanEquals(parsed.measurement, "battery_data"));
+  assert(parsed.tagCount == 1);
+  assert(influxSpanEquals(parsed.tags[0].key, "battery"));
+  assert(influxSpanEquals(parsed.tags[0].value, "3"));
+  assert(parsed.fieldCount == 3);
+  assert(influxSpanEquals(parsed.fields[0].key, "voltage"));
+  assert(influxSpanEquals(parsed.fields[0].value, "28.4"));
+  assert(influxSpanEquals(parsed.fields[1].key, "current"));
+  assert(influxSpanEquals(parsed.fields[1].value, "1.2"));
+  assert(influxSpanEquals(parsed.fields[2].key, "temperature"));
+  assert(influxSpanEquals(parsed.fields[2].value, "24.5"));
+  assert(!parsed.hasTimestamp);
 }
 
 static void test_parse_rejects_malformed_tag_segment() {
-  ParsedInfluxBufferLine parsed;
-  const bool ok = parseInfluxBufferLine(
-      "battery_data,battery,voltage=28.4,current=1.2", parsed);
+  InfluxLineView parsed;
+  const bool ok = parse("battery_data,battery,voltage=28.4,current=1.2", parsed);
   assert(!ok);
 }
 
 static void test_parse_rejects_malformed_field_segment() {
-  ParsedInfluxBufferLine parsed;
-  const bool ok = parseInfluxBufferLine(
-      "battery_data,battery=3,voltage=28.4,current", parsed);
+  InfluxLineView parsed;
+  const bool ok = parse("battery_data,battery=3,voltage=28.4,current", parsed);
   assert(!ok);
 }
 
 static void test_parse_rejects_empty_or_whitespace_line() {
-  ParsedInfluxBufferLine parsed;
-  assert(!parseInfluxBufferLine("", parsed));
-  assert(!parseInfluxBufferLine("   \t  ", parsed));
+  InfluxLineView parsed;
+  assert(!parse("", parsed));
+  assert(!parse("   \t  ", parsed));
+  assert(!parseInfluxLine(nullptr, 0, parsed));
 }
 
 static void test_parse_accepts_trimmed_line() {
-  ParsedInfluxBufferLine parsed;
-  const bool ok = parseInfluxBufferLine(
-      "  battery_data,battery=9,voltage=27.0,current=-0.6  ", parsed);
+  InfluxLineView parsed;
+  const bool ok =
+      parse("  battery_data,battery=9,voltage=27.0,current=-0.6  \r\n", parsed);
 
   assert(ok);
-  assert(parsed.measurement == "battery_data");
-  assert(parsed.tag.key == "battery");
-  assert(parsed.tag.value == "9");
-  assert(parsed.fields.size() == 2);
+  assert(influxSpanEquals(parsed.measurement, "battery_data"));
+  assert(influxSpanEquals(parsed.tags[0].key, "battery"));
+  assert(influxSpanEquals(parsed.tags[0].value, "9"));
+  assert(parsed.fieldCount == 2);
+  assert(influxSpanEquals(parsed.fields[1].value, "-0.6"));
+}
+
+static void test_parse_line_protocol_multi_tag_timestamp() {
+  InfluxLineView parsed;
+  const bool ok = parse("battery,device=bmu-01,bat=3,profile=normal "
+                        "voltage_mv=27500i,current_a=1.5 1712500000",
+                        parsed);
+
+  assert(ok);
+  assert(influxSpanEquals(parsed.measurement, "battery"));
+  assert(parsed.tagCount == 3);
+  assert(influxSpanEquals(parsed.tags[0].value, "bmu-01"));
+  assert(influxSpanEquals(parsed.tags[1].key, "bat"));
+  assert(influxSpanEquals(parsed.tags[2].value, "normal"));
+  assert(parsed.fieldCount == 2);
+  assert(influxSpanEquals(parsed.fields[0].value, "27500i"));
+  assert(parsed.hasTimestamp);
+  assert(parsed.timestamp == 1712500000);
+
+  // Sans tag ni timestamp
+  assert(parse("uptime s=42i", parsed));
+  assert(parsed.tagCount == 0);
+  assert(parsed.fieldCount == 1);
+  assert(!parsed.hasTimestamp);
+}
+
+static void test_parse_escapes_and_quoted_strings() {
+  InfluxLineView parsed;
+  const char *line = "my\\ meas,site=Salle\\ A,k\\=v=x\\,y "
+                     "state=\"connected, ok\",note=\"say \\\"hi\\\"\" 17";
+  assert(parse(line, parsed));
+  assert(unescaped(parsed.measurement) == "my meas");
+  assert(parsed.tagCount == 2);
+  assert(unescaped(parsed.tags[0].value) == "Salle A");
+  assert(unescaped(parsed.tags[1].key) == "k=v");
+  assert(unescaped(parsed.tags[1].value) == "x,y");
+  assert(parsed.fieldCount == 2);
+  assert(unescaped(parsed.fields[0].value) == "connected, ok");
+  assert(unescaped(parsed.fields[1].value) == "say \"hi\"");
+  assert(parsed.timestamp == 17);
+
+  // Spans : pointeurs dans la ligne d'origine, aucune copie
+  assert(parsed.measurement.data == line);
+  assert(parsed.fields[0].value.data > line &&
+         parsed.fields[0].value.data < line + std::strlen(line));
+
+  // Tampon trop petit
+  char tiny[4];
+  assert(influxUnescape(parsed.tags[0].value, tiny, sizeof(tiny)) == 0);
+}
+
+static void test_parse_rejects_malformed_line_protocol() {
+  InfluxLineView parsed;
+  assert(!parse("m,a=1 f=1 12x", parsed));        // timestamp non numérique
+  assert(!parse("m,a=1 f=1 1 2", parsed));        // segment en trop
+  assert(!parse("m,a=1 f=\"open", parsed));       // guillemet non fermé
+  assert(!parse("m,a= f=1", parsed));             // valeur de tag vide
+  assert(!parse("m,a=1 f=", parsed));             // valeur de champ vide
+  assert(!parse("m,a=1 ", parsed));               // aucun champ
+  assert(!parse("m f=1\\", parsed));              // échappement final
+  assert(!parse("m,a=1 f=1 99999999999999999999", parsed));
+
+  std::string many = "m";
+  for (size_t i = 0; i <= kInfluxMaxTags; ++i) {
+    many += ",t" + std::to_string(i) + "=v";
+  }
+  many += " f=1";
+  assert(!parseInfluxLine(many.data(), many.size(), parsed));
+}
+
+// Rejeu d'un tampon SPIFFS de 32 Ko : ~220 lignes de 7 champs, parcourues
+// 50 fois. Comparé à l'ancien parseur std::string + vector reproduit ici.
+struct LegacyKV {
+  std::string key;
+  std::string value;
+};
+
+static bool legacyParse(const std::string &line, std::string &measurement,
+                        LegacyKV &tag, std::vector<LegacyKV> &fields) {
+  const size_t c1 = line.find(',');
+  const size_t c2 = line.find(',', c1 + 1);
+  if (c1 == std::string::npos || c2 == std::string::npos) {
+    return false;
+  }
+  measurement = line.substr(0, c1);
+  const std::string tagPart = line.substr(c1 + 1, c2 - c1 - 1);
+  tag.key = tagPart.substr(0, tagPart.find('='));
+  tag.value = tagPart.substr(tagPart.find('=') + 1);
+  fields.clear();
+  size_t start = c2 + 1;
+  while (start < line.size()) {
+    size_t comma = line.find(',', start);
+    if (comma == std::string::npos) {
+      comma = line.size();
+    }
+    const std::string kv = line.substr(start, comma - start);
+    const size_t eq = kv.find('=');
+    fields.push_back({kv.substr(0, eq), kv.substr(eq + 1)});
+    start = comma + 1;
+  }
+  return true;
+}
+
+static void test_replay_benchmark_no_heap() {
+  std::vector<std::string> lines;
+  size_t bytes = 0;
+  while (bytes < 32 * 1024) {
+    char buf[256];
+    const int n = std::snprintf(
+        buf, sizeof(buf),
+        "battery_data,battery=%zu,voltage=27.%06zu,current=1.250000,"
+        "ah_consumption=12.500000,ah_charge=3.250000,"
+        "total_consumption=180.000000,total_charge=42.000000,"
+        "total_current=18.750000",
+        lines.size() % 16, lines.size());
+    lines.emplace_back(buf, static_cast<size_t>(n));
+    bytes += static_cast<size_t>(n) + 1;
+  }
+  const int passes = 50;
+
+  InfluxLineView view;
+  size_t fields = 0;
+  g_allocs = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; ++p) {
+    for (const std::string &l : lines) {
+      assert(parseInfluxLine(l.data(), l.size(), view));
+      fields += view.fieldCount;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  const size_t viewAllocs = g_allocs;
+
+  std::string measurement;
+  LegacyKV tag;
+  std::vector<LegacyKV> legacyFields;
+  size_t legacyCount = 0;
+  g_allocs = 0;
+  auto t2 = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; ++p) {
+    for (const std::string &l : lines) {
+      // Nouvelle std::string par ligne, comme l'ancien rejeu
+      assert(legacyParse(std::string(l.c_str()), measurement, tag, legacyFields));
+      legacyCount += legacyFields.size();
+    }
+  }
+  auto t3 = std::chrono::steady_clock::now();
+  const size_t legacyAllocs = g_allocs;
+
+  const double n = static_cast<double>(lines.size()) * passes;
+  const double viewNs =
+      std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+  const double legacyNs =
+      std::chrono::duration<double, std::nano>(t3 - t2).count() / n;
+  std::printf("rejeu %zu lignes x %d : spans %.0f ns/ligne, %zu allocs | "
+              "std::string %.0f ns/ligne, %.1f allocs/ligne\n",
+              lines.size(), passes, viewNs, viewAllocs, legacyNs,
+              static_cast<double>(legacyAllocs) / n);
+
+  assert(fields == legacyCount);
+  assert(viewAllocs == 0);
+  assert(legacyAllocs > 0);
 }
 
 int main() {
@@ -60,5 +255,9 @@ int main() {
   test_parse_rejects_malformed_field_segment();
   test_parse_rejects_empty_or_whitespace_line();
   test_parse_accepts_trimmed_line();
+  test_parse_line_protocol_multi_tag_timestamp();
+  test_parse_escapes_and_quoted_strings();
+  test_parse_rejects_malformed_line_protocol();
+  test_replay_benchmark_no_heap();
   return 0;
 }
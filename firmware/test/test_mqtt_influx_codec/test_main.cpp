@@ -1,9 +1,14 @@
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstdint>
 #include <cstring>
 #include <string>
 #include <sstream>
+#include <vector>
+
+#include "../../src/InfluxBufferCodec.h"
 
 /* ------------------------------------------------------------------ */
 /*  Lightweight helpers — MQTT JSON payload and InfluxDB line protocol */
@@ -188,9 +193,60 @@ static void test_influx_line_protocol_battery() {
   assert(timestamp == "1712500000000000000");
 }
 
+static void test_influx_line_protocol_roundtrip_parser() {
+  const std::string line = buildInfluxLineBattery(
+      "bmu-01", 7, 27500, -1500, "connected", 1712500000000000000ULL);
+
+  InfluxLineView view;
+  assert(parseInfluxLine(line.data(), line.size(), view));
+  assert(influxSpanEquals(view.measurement, "battery"));
+  assert(view.tagCount == 2);
+  assert(influxSpanEquals(view.tags[0].key, "device"));
+  assert(influxSpanEquals(view.tags[0].value, "bmu-01"));
+  assert(influxSpanEquals(view.tags[1].key, "bat"));
+  assert(influxSpanEquals(view.tags[1].value, "7"));
+  assert(view.fieldCount == 3);
+  assert(influxSpanEquals(view.fields[0].value, "27500i"));
+  assert(influxSpanEquals(view.fields[1].value, "-1500i"));
+  assert(influxSpanEquals(view.fields[2].value, "\"connected\""));
+  assert(view.hasTimestamp);
+  assert(view.timestamp == 1712500000000000000LL);
+
+  char state[16];
+  assert(influxUnescape(view.fields[2].value, state, sizeof(state)) == 9);
+  assert(std::string(state) == "connected");
+}
+
+static void test_influx_line_protocol_parse_throughput() {
+  // Une trame flotte de 16 batteries, parsée 2000 fois
+  std::vector<std::string> lines;
+  for (int b = 0; b < 16; ++b) {
+    lines.push_back(buildInfluxLineBattery("bmu-01", b, 27000 + b, 100 * b,
+                                           b % 3 ? "connected" : "disconnected",
+                                           1712500000000000000ULL + b));
+  }
+  const int passes = 2000;
+  InfluxLineView view;
+  int64_t tsSum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int p = 0; p < passes; ++p) {
+    for (const std::string &l : lines) {
+      assert(parseInfluxLine(l.data(), l.size(), view));
+      tsSum += view.timestamp & 0xFF;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                    (static_cast<double>(lines.size()) * passes);
+  std::printf("line protocol 2 tags, 3 champs, timestamp : %.0f ns/ligne\n", ns);
+  assert(tsSum > 0);
+}
+
 int main() {
   test_mqtt_battery_payload_format();
   test_mqtt_topic_parsing();
   test_influx_line_protocol_battery();
+  test_influx_line_protocol_roundtrip_parser();
+  test_influx_line_protocol_parse_throughput();
   return 0;
 }
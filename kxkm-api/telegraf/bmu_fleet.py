@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Décodeur de la trame MQTT binaire de flotte (bmu/{device}/fleet).
+
+Lancé par Telegraf (`inputs.execd`, voir telegraf.conf) : s'abonne au
+broker, décode chaque trame et écrit du line-protocol sur stdout. Les
+mesures `battery` et `climate` reprennent les noms courts et unités des
+payloads JSON (v en V, i en A, ...) : les processors rename/scale de
+telegraf.conf s'appliquent tels quels. Les agrégats vont dans `fleet`.
+
+Les tags sont ceux du chemin JSON (`mqtt_consumer` ajoute `topic`) : une
+batterie reste une seule série InfluxDB quel que soit le format publié.
+
+Format : firmware-idf/components/bmu_mqtt/include/bmu_mqtt_fleet.h.
+Tous les champs numériques sont émis en float, comme le parser JSON de
+Telegraf, pour ne pas créer de conflit de type dans InfluxDB.
+"""
+
+from __future__ import annotations
+
+import os
+import struct
+import sys
+
+MAGIC = b"KF"
+VERSION = 1
+HDR = struct.Struct("<2sBBBBBBHHHHihH")       # 24 octets (v1)
+REC = struct.Struct("<BBBBHHiIIIIHHHH")      # 36 octets (v1)
+
+FLAG_CLIMATE = 0x01
+BAT_RINT, BAT_SOH, BAT_SOC, BAT_BAL = 0x01, 0x02, 0x04, 0x08
+
+STATES = ("connected", "disconnected", "reconnecting", "error", "locked")
+
+
+class FrameError(ValueError):
+    """Trame invalide (magic, version ou longueur)."""
+
+
+def decode(payload: bytes) -> dict:
+    """Décode une trame ; lève FrameError si elle est invalide."""
+    if len(payload) < HDR.size:
+        raise FrameError("trame trop courte")
+    (magic, version, hdr_len, rec_len, nb, flags, n_connected, seq,
+     v_min, v_max, v_avg, i_total, temp_cc, hum_dpct) = HDR.unpack_from(payload)
+    if magic != MAGIC:
+        raise FrameError("magic invalide")
+    if version < VERSION or hdr_len < HDR.size or rec_len < REC.size:
+        raise FrameError(f"version {version} non supportée")
+    if len(payload) < hdr_len + nb * rec_len:
+        raise FrameError("trame tronquée")
+
+    frame = {
+        "seq": seq,
+        "fleet": {
+            "nb": nb,
+            "n_connected": n_connected,
+            "v_min_mv": v_min,
+            "v_max_mv": v_max,
+            "v_avg_mv": v_avg,
+            "i_total_ma": i_total,
+        },
+        "climate": None,
+        "batteries": [],
+    }
+    if flags & FLAG_CLIMATE:
+        frame["climate"] = {"temp_c": temp_cc / 100.0, "humidity": hum_dpct / 10.0}
+
+    # Versions futures : en-tête et enregistrements plus longs, champs v1 en tête
+    for k in range(nb):
+        (bid, state, bflags, bal, v_mv, nb_sw, i_ma, ah_d, ah_c, wh_d, wh_c,
+         r_ohm, r_tot, soh, soc) = REC.unpack_from(payload, hdr_len + k * rec_len)
+        bat = {
+            "id": bid,
+            "v": v_mv / 1000.0,
+            "i": i_ma / 1000.0,
+            "ah_d": ah_d / 1000.0,
+            "ah_c": ah_c / 1000.0,
+            "wh_d": wh_d / 10.0,
+            "wh_c": wh_c / 10.0,
+            "nb_switch": nb_sw,
+            "state": STATES[state] if state < len(STATES) else "unknown",
+        }
+        if bflags & BAT_RINT:
+            bat["r_ohm"] = r_ohm / 10.0
+            bat["r_tot"] = r_tot / 10.0
+        if bflags & BAT_SOH:
+            bat["soh"] = soh / 10.0
+        if bflags & BAT_SOC:
+            bat["soc"] = soc / 10.0
+        if bflags & BAT_BAL:
+            bat["bal_duty"] = bal
+        frame["batteries"].append(bat)
+    return frame
+
+
+def _escape_tag(v: str) -> str:
+    return v.replace("\\", "\\\\").replace(",", "\\,").replace("=", "\\=").replace(" ", "\\ ")
+
+
+def _fields(d: dict) -> str:
+    out = []
+    for k, v in d.items():
+        if isinstance(v, str):
+            out.append(f'{k}="{v}"')
+        else:
+            out.append(f"{k}={float(v)!r}")
+    return ",".join(out)
+
+
+def to_line_protocol(device: str, frame: dict) -> list[str]:
+    """Lignes `battery`, `climate` et `fleet` (sans timestamp : heure Telegraf).
+
+    `battery` et `climate` portent le tag `topic` du payload JSON équivalent
+    (bmu/{device}/battery/{id}, bmu/{device}/climate).
+    """
+    dev = _escape_tag(device)
+    lines = []
+    for bat in frame["batteries"]:
+        fields = {k: v for k, v in bat.items() if k != "id"}
+        topic = _escape_tag(f"bmu/{device}/battery/{bat['id']}")
+        lines.append(f"battery,bmu={dev},id={bat['id']},topic={topic} {_fields(fields)}")
+    if frame["climate"] is not None:
+        topic = _escape_tag(f"bmu/{device}/climate")
+        lines.append(f"climate,bmu={dev},topic={topic} {_fields(frame['climate'])}")
+    fleet = dict(frame["fleet"], seq=frame["seq"])
+    lines.append(f"fleet,bmu={dev} {_fields(fleet)}")
+    return lines
+
+
+def device_from_topic(topic: str) -> str | None:
+    """bmu/{device}/fleet → device."""
+    parts = topic.split("/")
+    if len(parts) == 3 and parts[0] == "bmu" and parts[2] == "fleet":
+        return parts[1]
+    return None
+
+
+def main() -> int:
+    import paho.mqtt.client as mqtt
+
+    def on_connect(client, _userdata, _flags, rc, *_):
+        if rc == 0:
+            client.subscribe("bmu/+/fleet", qos=0)
+        else:
+            print(f"bmu_fleet: connexion MQTT refusée ({rc})", file=sys.stderr)
+
+    def on_message(_client, _userdata, msg):
+        device = device_from_topic(msg.topic)
+        if device is None:
+            return
+        try:
+            lines = to_line_protocol(device, decode(msg.payload))
+        except (FrameError, struct.error) as e:
+            print(f"bmu_fleet: {msg.topic}: {e}", file=sys.stderr)
+            return
+        sys.stdout.write("\n".join(lines) + "\n")
+        sys.stdout.flush()
+
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)  # paho ≥ 2
+    except AttributeError:
+        client = mqtt.Client()
+    user = os.environ.get("MQTT_USERNAME")
+    if user:
+        client.username_pw_set(user, os.environ.get("MQTT_PASSWORD"))
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(os.environ.get("MQTT_HOST", "mosquitto"),
+                   int(os.environ.get("MQTT_PORT", "1883")))
+    client.loop_forever(retry_first_connection=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
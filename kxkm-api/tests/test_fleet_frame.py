@@ -0,0 +1,92 @@
+"""Tests of the binary MQTT fleet frame decoder (telegraf/bmu_fleet.py).
+
+Run with: cd kxkm-api && python -m pytest tests/ -v
+"""
+
+from __future__ import annotations
+
+import pathlib
+import struct
+import sys
+
+import pytest
+
+sys.path.insert(0, str(pathlib.Path(__file__).resolve().parents[1] / "telegraf"))
+
+import bmu_fleet  # noqa: E402
+
+# Same vector as GOLDEN_HEX in firmware-idf/test/test_mqtt_fleet
+GOLDEN_HEX = (
+    "4b4601182402010102015e659c657d6522fdffff29099c01"
+    "00000f289c6503002efbffffb20c0000be0a000030030000be0200007b009600cf032b02"
+    "010300005e650000f4010000000000000100000000000000010000000000000000000000"
+)
+
+
+def test_decode_golden_vector():
+    f = bmu_fleet.decode(bytes.fromhex(GOLDEN_HEX))
+    assert f["seq"] == 258
+    assert f["fleet"] == {
+        "nb": 2, "n_connected": 1, "v_min_mv": 25950, "v_max_mv": 26012,
+        "v_avg_mv": 25981, "i_total_ma": -734,
+    }
+    assert f["climate"] == {"temp_c": 23.45, "humidity": 41.2}
+
+    b0, b1 = f["batteries"]
+    assert b0 == {
+        "id": 0, "v": 26.012, "i": -1.234, "ah_d": 3.25, "ah_c": 2.75,
+        "wh_d": 81.6, "wh_c": 70.2, "nb_switch": 3, "state": "connected",
+        "r_ohm": 12.3, "r_tot": 15.0, "soh": 97.5, "soc": 55.5, "bal_duty": 40,
+    }
+    assert b1["state"] == "error"
+    assert b1["ah_c"] == 0.001
+    assert "r_ohm" not in b1 and "soh" not in b1 and "soc" not in b1 and "bal_duty" not in b1
+
+
+def test_line_protocol_matches_json_schema():
+    lines = bmu_fleet.to_line_protocol("kxkm bmu", bmu_fleet.decode(bytes.fromhex(GOLDEN_HEX)))
+    assert lines[0].startswith(
+        "battery,bmu=kxkm\\ bmu,id=0,topic=bmu/kxkm\\ bmu/battery/0 v=26.012,i=-1.234,")
+    assert 'state="connected"' in lines[0]
+    assert "nb_switch=3.0" in lines[0]   # float, comme le parser JSON
+    assert lines[2] == "climate,bmu=kxkm\\ bmu,topic=bmu/kxkm\\ bmu/climate temp_c=23.45,humidity=41.2"
+    assert lines[3].startswith("fleet,bmu=kxkm\\ bmu nb=2.0,")
+    assert lines[3].endswith(",seq=258.0")
+
+
+def test_future_version_with_longer_records():
+    raw = bytearray(bytes.fromhex(GOLDEN_HEX))
+    hdr, recs = raw[:24], raw[24:]
+    hdr[2], hdr[3], hdr[4] = 2, 28, 40
+    ext = bytearray(hdr) + b"\xaa" * 4
+    for k in range(2):
+        ext += recs[k * 36:(k + 1) * 36] + b"\xbb" * 4
+    f = bmu_fleet.decode(bytes(ext))
+    assert [b["id"] for b in f["batteries"]] == [0, 1]
+    assert f["batteries"][0]["v"] == 26.012
+
+
+@pytest.mark.parametrize("payload", [
+    b"",
+    b"XX" + bytes(22),
+    bytes.fromhex(GOLDEN_HEX)[:-1],
+    b"KF\x00" + bytes(21),
+])
+def test_invalid_frames_rejected(payload):
+    with pytest.raises(bmu_fleet.FrameError):
+        bmu_fleet.decode(payload)
+
+
+def test_empty_fleet_frame():
+    hdr = struct.pack("<2sBBBBBBHHHHihH", b"KF", 1, 24, 36, 0, 0, 0, 7, 0, 0, 0, 0, 0, 0)
+    f = bmu_fleet.decode(hdr)
+    assert f["batteries"] == [] and f["climate"] is None
+    assert bmu_fleet.to_line_protocol("b", f) == [
+        "fleet,bmu=b nb=0.0,n_connected=0.0,v_min_mv=0.0,v_max_mv=0.0,"
+        "v_avg_mv=0.0,i_total_ma=0.0,seq=7.0"
+    ]
+
+
+def test_device_from_topic():
+    assert bmu_fleet.device_from_topic("bmu/kxkm-bmu-01/fleet") == "kxkm-bmu-01"
+    assert bmu_fleet.device_from_topic("bmu/kxkm-bmu-01/battery/3") is None